@@ -18,6 +18,11 @@
 #define _VULKANVIDEOCAPABILITIES_H_
 
 #include "string.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+
 #include "vulkan_interfaces.h"
 #include "VkCodecUtils/VulkanDeviceContext.h"
 #include "VkCodecUtils/Helpers.h"
@@ -128,6 +133,28 @@ public:
             assert(!"Unsupported codec");
             return VK_ERROR_FORMAT_NOT_SUPPORTED;
         }
+
+        CapsCacheKey cacheKey;
+        MakeCapsCacheKey(vkDevCtx, videoProfile, 0, cacheKey);
+        CapsCacheEntry cachedEntry;
+        if (!dumpData && LookupCapsCache(cacheKey, cachedEntry)) {
+            // Replay the cached query results into the caller's structure
+            // chain, keeping the caller's pNext links intact.
+            cachedEntry.videoCapabilities.pNext = pVideoCapabilities->pNext;
+            *pVideoCapabilities = cachedEntry.videoCapabilities;
+            cachedEntry.decodeCapabilities.pNext = pVideoDecodeCapabilities->pNext;
+            *pVideoDecodeCapabilities = cachedEntry.decodeCapabilities;
+            if (pH264Capabilities != nullptr) {
+                cachedEntry.h264Capabilities.pNext = pH264Capabilities->pNext;
+                *pH264Capabilities = cachedEntry.h264Capabilities;
+            }
+            if (pH265Capabilities != nullptr) {
+                cachedEntry.h265Capabilities.pNext = pH265Capabilities->pNext;
+                *pH265Capabilities = cachedEntry.h265Capabilities;
+            }
+            return VK_SUCCESS;
+        }
+
         VkResult result = vkDevCtx->GetPhysicalDeviceVideoCapabilitiesKHR(vkDevCtx->getPhysicalDevice(),
                                                                             videoProfile.GetProfile(),
                                                                             pVideoCapabilities);
@@ -136,6 +163,24 @@ public:
             return result;
         }
 
+        if (!dumpData) {
+            CapsCacheEntry entry;
+            memset(&entry, 0x00, sizeof(entry));
+            entry.videoCapabilities = *pVideoCapabilities;
+            entry.videoCapabilities.pNext = nullptr;
+            entry.decodeCapabilities = *pVideoDecodeCapabilities;
+            entry.decodeCapabilities.pNext = nullptr;
+            if (pH264Capabilities != nullptr) {
+                entry.h264Capabilities = *pH264Capabilities;
+                entry.h264Capabilities.pNext = nullptr;
+            }
+            if (pH265Capabilities != nullptr) {
+                entry.h265Capabilities = *pH265Capabilities;
+                entry.h265Capabilities.pNext = nullptr;
+            }
+            InsertCapsCache(cacheKey, entry);
+        }
+
         if (dumpData) {
             std::cout << "\t\t\t" << ((videoProfile.GetCodecType() == VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR) ? "h264" : "h265") << "decode capabilities: " << std::endl;
 
@@ -188,6 +233,17 @@ public:
             formats[i] = VK_FORMAT_UNDEFINED;
         }
 
+        CapsCacheKey cacheKey;
+        MakeCapsCacheKey(vkDevCtx, videoProfile, imageUsage, cacheKey);
+        CapsCacheEntry cachedEntry;
+        if (!dumpData && LookupCapsCache(cacheKey, cachedEntry)) {
+            formatCount = std::min(cachedEntry.formatCount, formatCount);
+            for (uint32_t i = 0; i < formatCount; i++) {
+                formats[i] = cachedEntry.formats[i];
+            }
+            return VK_SUCCESS;
+        }
+
         const VkVideoProfileListInfoKHR videoProfiles = { VK_STRUCTURE_TYPE_VIDEO_PROFILE_LIST_INFO_KHR, nullptr, 1, videoProfile.GetProfile() };
         const VkPhysicalDeviceVideoFormatInfoKHR videoFormatInfo = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VIDEO_FORMAT_INFO_KHR, const_cast<VkVideoProfileListInfoKHR *>(&videoProfiles),
                                                                      imageUsage };
@@ -212,6 +268,16 @@ public:
             }
         }
 
+        if (!dumpData && (result == VK_SUCCESS)) {
+            CapsCacheEntry entry;
+            memset(&entry, 0x00, sizeof(entry));
+            entry.formatCount = std::min(supportedFormatCount, (uint32_t)MAX_CACHED_FORMATS);
+            for (uint32_t i = 0; i < entry.formatCount; i++) {
+                entry.formats[i] = pSupportedFormats[i].format;
+            }
+            InsertCapsCache(cacheKey, entry);
+        }
+
         formatCount = std::min(supportedFormatCount, formatCount);
 
         for (uint32_t i = 0; i < formatCount; i++) {
@@ -334,6 +400,162 @@ public:
                                                                &videoDecodeCapabilities);
     }
 
+    // Enables persisting the capability cache under cacheDir, so a cold
+    // process start answers the per-profile queries from disk instead of
+    // the driver. Any entries already saved by a previous run are loaded
+    // immediately. The device identity embedded in each cache key keeps
+    // entries of other devices or driver builds from matching.
+    static void SetPersistentCacheDir(const char* cacheDir)
+    {
+        CapsCache& cache = GetCapsCache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        cache.persistentCacheFile = std::string(cacheDir) + "/video_capabilities.cache";
+        LoadCapsCacheLocked(cache);
+    }
+
+private:
+    // Cache of the per-(device, profile) physical device query results. The
+    // results are immutable for a given device and driver build, so when many
+    // sessions start at once only the first one pays for the driver
+    // round-trips; every repeat query is answered from memory.
+    enum { MAX_CACHED_FORMATS = 8 };
+
+    struct CapsCacheKey {
+        uint8_t  deviceUuid[VK_UUID_SIZE]; // pipelineCacheUUID: changes with the device and driver build
+        uint32_t codecOperation;
+        uint32_t chromaSubsampling;
+        uint32_t lumaBitDepth;
+        uint32_t chromaBitDepth;
+        uint32_t profileIdc;
+        uint32_t imageUsage; // non-zero only for the format property queries
+
+        bool operator<(const CapsCacheKey& other) const {
+            return memcmp(this, &other, sizeof(CapsCacheKey)) < 0;
+        }
+    };
+
+    struct CapsCacheEntry {
+        VkVideoCapabilitiesKHR           videoCapabilities;
+        VkVideoDecodeCapabilitiesKHR     decodeCapabilities;
+        VkVideoDecodeH264CapabilitiesKHR h264Capabilities;
+        VkVideoDecodeH265CapabilitiesKHR h265Capabilities;
+        uint32_t                         formatCount;
+        VkFormat                         formats[MAX_CACHED_FORMATS];
+    };
+
+    struct CapsCache {
+        std::mutex                             mutex;
+        std::map<CapsCacheKey, CapsCacheEntry> entries;
+        std::string                            persistentCacheFile;
+    };
+
+    static CapsCache& GetCapsCache()
+    {
+        static CapsCache s_capsCache;
+        return s_capsCache;
+    }
+
+    static void MakeCapsCacheKey(const VulkanDeviceContext* vkDevCtx,
+                                 const VkVideoCoreProfile& videoProfile,
+                                 VkImageUsageFlags imageUsage,
+                                 CapsCacheKey& key)
+    {
+        VkPhysicalDeviceProperties deviceProperties;
+        vkDevCtx->GetPhysicalDeviceProperties(vkDevCtx->getPhysicalDevice(), &deviceProperties);
+
+        // The key is compared and persisted as raw bytes - clear the padding.
+        memset(&key, 0x00, sizeof(key));
+        memcpy(key.deviceUuid, deviceProperties.pipelineCacheUUID, VK_UUID_SIZE);
+        const VkVideoProfileInfoKHR* pProfile = videoProfile.GetProfile();
+        key.codecOperation    = (uint32_t)pProfile->videoCodecOperation;
+        key.chromaSubsampling = (uint32_t)pProfile->chromaSubsampling;
+        key.lumaBitDepth      = (uint32_t)pProfile->lumaBitDepth;
+        key.chromaBitDepth    = (uint32_t)pProfile->chromaBitDepth;
+        if (videoProfile.GetDecodeH264Profile() != NULL) {
+            key.profileIdc = (uint32_t)videoProfile.GetDecodeH264Profile()->stdProfileIdc;
+        } else if (videoProfile.GetDecodeH265Profile() != NULL) {
+            key.profileIdc = (uint32_t)videoProfile.GetDecodeH265Profile()->stdProfileIdc;
+        }
+        key.imageUsage = (uint32_t)imageUsage;
+    }
+
+    static bool LookupCapsCache(const CapsCacheKey& key, CapsCacheEntry& entry)
+    {
+        CapsCache& cache = GetCapsCache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        std::map<CapsCacheKey, CapsCacheEntry>::const_iterator it = cache.entries.find(key);
+        if (it == cache.entries.end()) {
+            return false;
+        }
+        entry = it->second;
+        return true;
+    }
+
+    static void InsertCapsCache(const CapsCacheKey& key, const CapsCacheEntry& entry)
+    {
+        CapsCache& cache = GetCapsCache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        if (!cache.entries.insert(std::make_pair(key, entry)).second) {
+            return; // another session cached this profile first
+        }
+        if (!cache.persistentCacheFile.empty()) {
+            SaveCapsCacheLocked(cache);
+        }
+    }
+
+    // The on-disk layout is the raw key/entry pairs behind a small header;
+    // the struct sizes in the header reject files from incompatible builds.
+    struct CapsCacheFileHeader {
+        uint32_t magic;     // 'V' 'C' 'A' 'P'
+        uint32_t keySize;
+        uint32_t entrySize;
+        uint32_t entryCount;
+    };
+    static const uint32_t CapsCacheFileMagic = 0x50414356; // "VCAP"
+
+    static void SaveCapsCacheLocked(const CapsCache& cache)
+    {
+        FILE* cacheFile = fopen(cache.persistentCacheFile.c_str(), "wb");
+        if (cacheFile == NULL) {
+            return;
+        }
+
+        CapsCacheFileHeader header = { CapsCacheFileMagic,
+                                       (uint32_t)sizeof(CapsCacheKey), (uint32_t)sizeof(CapsCacheEntry),
+                                       (uint32_t)cache.entries.size() };
+        fwrite(&header, sizeof(header), 1, cacheFile);
+        for (std::map<CapsCacheKey, CapsCacheEntry>::const_iterator it = cache.entries.begin();
+                it != cache.entries.end(); ++it) {
+            fwrite(&it->first, sizeof(CapsCacheKey), 1, cacheFile);
+            fwrite(&it->second, sizeof(CapsCacheEntry), 1, cacheFile);
+        }
+        fclose(cacheFile);
+    }
+
+    static void LoadCapsCacheLocked(CapsCache& cache)
+    {
+        FILE* cacheFile = fopen(cache.persistentCacheFile.c_str(), "rb");
+        if (cacheFile == NULL) {
+            return;
+        }
+
+        CapsCacheFileHeader header = {};
+        if ((fread(&header, sizeof(header), 1, cacheFile) == 1) &&
+                (header.magic == CapsCacheFileMagic) &&
+                (header.keySize == sizeof(CapsCacheKey)) &&
+                (header.entrySize == sizeof(CapsCacheEntry))) {
+            for (uint32_t i = 0; i < header.entryCount; i++) {
+                CapsCacheKey key;
+                CapsCacheEntry entry;
+                if ((fread(&key, sizeof(key), 1, cacheFile) != 1) ||
+                        (fread(&entry, sizeof(entry), 1, cacheFile) != 1)) {
+                    break;
+                }
+                cache.entries.insert(std::make_pair(key, entry));
+            }
+        }
+        fclose(cacheFile);
+    }
 };
 
 #endif /* _VULKANVIDEOCAPABILITIES_H_ */
@@ -63,8 +63,10 @@
 #define YCBCR_UNSUPPORTED_LAYOUT(vkfrmt) {\
                          YCBCR_BASE_FORMAT_UNSUPPORTED() vkfrmt, {{{ YCBCR_SINGLE_PLANE_INTERLEAVED, 0,  0,  false, false, 0,   CC_UN, CC_UN, CC_UN, CC_UN}}, 0, 0, 0, 0    },      {VK_FORMAT_UNDEFINED,   VK_FORMAT_UNDEFINED,  VK_FORMAT_UNDEFINED, VK_FORMAT_UNDEFINED } }
 
-// Multi-planar format info
-static const VkMpFormatInfo vkMpFormatInfo[] = {
+// Multi-planar format info. constexpr keeps the descriptors in read-only
+// pages (shared between the decoder processes by the OS) and lets the
+// index mapping below be verified at compile time.
+static constexpr VkMpFormatInfo vkMpFormatInfo[] = {
 //          Planes Memory layout                 vkColor Format                                            vkformat(0)            bpp        xSS   ySS    ch0   ch1    ch2    ch3         vkformat(1)      vkformat(2)
 //  ############################################### 8-bit formats #########################################################################################################################################################################
     YCBCR_SINGLE_PLANE_INTERLEAVED_LAYOUT(VK_FORMAT_G8B8G8R8_422_UNORM,                                 VK_FORMAT_R8G8_UNORM, YCBCRA_8BPP,                CC_Y0, CC_CB, CC_Y1, CC_CR,  VK_FORMAT_R8G8B8A8_UNORM),
@@ -130,29 +132,48 @@ static const VkMpFormatInfo vkMpFormatInfo[] = {
 #define VK_YCBCR_FORMAT_EXT_END_RANGE    (VkFormat)VK_FORMAT_G16_B16R16_2PLANE_444_UNORM_EXT
 #define VK_YCBCR_FORMAT_EXT_RANGE_SIZE   (VkFormat)(VK_YCBCR_FORMAT_EXT_END_RANGE - VK_YCBCR_FORMAT_EXT_BEGIN_RANGE + 1)
 
-static const VkMpFormatInfo * __ycbcrVkFormatInfo(const VkFormat format)
+static_assert((sizeof(vkMpFormatInfo)/sizeof(vkMpFormatInfo[0])) ==
+                  (size_t)(VK_YCBCR_FORMAT_RANGE_SIZE + VK_YCBCR_FORMAT_EXT_RANGE_SIZE),
+              "vkMpFormatInfo[] must cover the core and EXT YCbCr format ranges exactly");
+
+// Verifies at compile time that every table entry sits at the slot the
+// O(1) index arithmetic of __ycbcrVkFormatInfo() computes for its format,
+// so a reordered or missing row is a build error, not a runtime assert.
+// The walks recurse instead of looping - this header is included into
+// C++11 translation units, where a constexpr function body must be a
+// single return statement.
+static constexpr bool __ycbcrVkFormatInfoCoreRangeIsIndexable(uint32_t i = 0)
 {
-    const VkMpFormatInfo *info = NULL;
-
-    assert((sizeof(vkMpFormatInfo)/sizeof(vkMpFormatInfo[0])) == (VK_YCBCR_FORMAT_RANGE_SIZE + VK_YCBCR_FORMAT_EXT_RANGE_SIZE));
-
-    if ((format >= static_cast<VkFormat>(VK_YCBCR_FORMAT_BEGIN_RANGE)) &&
-            (format <= static_cast<VkFormat>(VK_YCBCR_FORMAT_END_RANGE))) {
-
-        info = &vkMpFormatInfo[format - VK_YCBCR_FORMAT_BEGIN_RANGE];
-
-        assert(vkMpFormatInfo[format - VK_YCBCR_FORMAT_BEGIN_RANGE].vkFormat == format);
-    } else if ((format >= static_cast<VkFormat>(VK_YCBCR_FORMAT_EXT_BEGIN_RANGE)) &&
-            (format <= static_cast<VkFormat>(VK_YCBCR_FORMAT_EXT_END_RANGE))) {
+    return (i == (uint32_t)VK_YCBCR_FORMAT_RANGE_SIZE) ||
+           ((vkMpFormatInfo[i].vkFormat == (VkFormat)(VK_YCBCR_FORMAT_BEGIN_RANGE + i)) &&
+            __ycbcrVkFormatInfoCoreRangeIsIndexable(i + 1));
+}
 
-        uint32_t extFormatIndex = VK_YCBCR_FORMAT_EXT_TBL_START + (format - VK_YCBCR_FORMAT_EXT_BEGIN_RANGE);
+static constexpr bool __ycbcrVkFormatInfoExtRangeIsIndexable(uint32_t i = 0)
+{
+    return (i == (uint32_t)VK_YCBCR_FORMAT_EXT_RANGE_SIZE) ||
+           ((vkMpFormatInfo[VK_YCBCR_FORMAT_EXT_TBL_START + i].vkFormat ==
+             (VkFormat)(VK_YCBCR_FORMAT_EXT_BEGIN_RANGE + i)) &&
+            __ycbcrVkFormatInfoExtRangeIsIndexable(i + 1));
+}
 
-        info = &vkMpFormatInfo[extFormatIndex];
+static constexpr bool __ycbcrVkFormatInfoTableIsIndexable()
+{
+    return __ycbcrVkFormatInfoCoreRangeIsIndexable() && __ycbcrVkFormatInfoExtRangeIsIndexable();
+}
 
-        assert(vkMpFormatInfo[extFormatIndex].vkFormat == format);
-    }
+static_assert(__ycbcrVkFormatInfoTableIsIndexable(),
+              "vkMpFormatInfo[] entries must be ordered by their VkFormat values");
 
-    return info;
+static constexpr const VkMpFormatInfo * __ycbcrVkFormatInfo(const VkFormat format)
+{
+    return ((format >= static_cast<VkFormat>(VK_YCBCR_FORMAT_BEGIN_RANGE)) &&
+            (format <= static_cast<VkFormat>(VK_YCBCR_FORMAT_END_RANGE))) ?
+                   &vkMpFormatInfo[format - VK_YCBCR_FORMAT_BEGIN_RANGE] :
+           ((format >= static_cast<VkFormat>(VK_YCBCR_FORMAT_EXT_BEGIN_RANGE)) &&
+            (format <= static_cast<VkFormat>(VK_YCBCR_FORMAT_EXT_END_RANGE))) ?
+                   &vkMpFormatInfo[VK_YCBCR_FORMAT_EXT_TBL_START + (format - VK_YCBCR_FORMAT_EXT_BEGIN_RANGE)] :
+                   NULL;
 }
 
 #endif /* YCBCRINFOTBL_H_ */
@@ -20,17 +20,613 @@
 #include <vector>
 #include <cstring>
 #include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <thread>
 #include "VkCodecUtils/VulkanDeviceContext.h"
 #include "VkCodecUtils/FrameProcessorFactory.h"
 #include "VkCodecUtils/ProgramConfig.h"
+#include "VkCodecUtils/DecodeBenchmark.h"
+#include "VkCodecUtils/VulkanShaderCompiler.h"
+#include "VkVideoCore/VulkanVideoCapabilities.h"
 #include "VkCodecUtils/VulkanVideoProcessor.h"
+#include "VkCodecUtils/VulkanMemoryBudget.h"
+#include "VkCodecUtils/VulkanDeviceMemoryImpl.h"
+#include "VkCodecUtils/VulkanVideoFrameReactor.h"
+#include "VkCodecUtils/VulkanThreadAffinity.h"
+#include "VkVideoDecoder/VkVideoDecoderPool.h"
 #include "VkShell/Shell.h"
 
+// The device extensions every decode device needs, shared between the
+// single-device path in main() and the per-GPU contexts of the multi-GPU
+// mode. The WSI extensions are added separately - only the presenting
+// device needs them.
+static void AddVideoDeviceExtensions(const ProgramConfig& programConfig, VulkanDeviceContext& vkDevCtxt)
+{
+#if defined(__linux) || defined(__linux__) || defined(linux)
+    vkDevCtxt.AddRequiredDeviceExtension(VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME);
+    vkDevCtxt.AddRequiredDeviceExtension(VK_KHR_EXTERNAL_FENCE_FD_EXTENSION_NAME);
+#endif
+    { // Vulkan Video required extensions
+        vkDevCtxt.AddRequiredDeviceExtension(VK_EXT_YCBCR_2PLANE_444_FORMATS_EXTENSION_NAME);
+        vkDevCtxt.AddRequiredDeviceExtension(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+        vkDevCtxt.AddRequiredDeviceExtension(VK_KHR_VIDEO_QUEUE_EXTENSION_NAME);
+        vkDevCtxt.AddRequiredDeviceExtension(VK_KHR_VIDEO_DECODE_QUEUE_EXTENSION_NAME);
+    }
+
+    // Improves the decoder's memory admission control when available.
+    vkDevCtxt.AddOptionalDeviceExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    // Backs large host staging allocations with imported huge-page memory
+    // when --hugePageStaging is set (see VulkanDeviceMemoryImpl).
+    if (programConfig.hostHugePageThresholdKb > 0) {
+        vkDevCtxt.AddOptionalDeviceExtension(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+    }
+
+    if (programConfig.enableTimelineFrameSync || programConfig.enableGpuFrameChecksums ||
+            programConfig.enableGpuFrameAnalysis) {
+        vkDevCtxt.AddRequiredDeviceExtension(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    }
+
+    // Cross-process decoded-frame export (see
+    // VulkanVideoFrameBuffer::EnableDecodedFrameExport()). The opaque-fd
+    // memory export extension is already required on Linux above.
+    if (programConfig.enableDecodedFrameExport) {
+        vkDevCtxt.AddRequiredDeviceExtension(VK_KHR_EXTERNAL_SEMAPHORE_FD_EXTENSION_NAME);
+    }
+
+    // Raises the decode queues' scheduling priority against other processes
+    // when the primary stream runs in the realtime QoS class (see
+    // VulkanDeviceContext::CreateVulkanDevice()).
+    if (programConfig.enableRealtimeDecodeQos) {
+        vkDevCtxt.AddOptionalDeviceExtension(VK_KHR_GLOBAL_PRIORITY_EXTENSION_NAME);
+        vkDevCtxt.AddOptionalDeviceExtension(VK_EXT_GLOBAL_PRIORITY_EXTENSION_NAME);
+        vkDevCtxt.SetVideoDecodeGlobalPriority(VK_QUEUE_GLOBAL_PRIORITY_HIGH_KHR);
+    }
+}
+
+static int ReadBatchFileList(const std::string& batchFileListName, std::vector<std::string>& batchFileNames)
+{
+    std::ifstream batchFileList(batchFileListName.c_str());
+    if (!batchFileList) {
+        fprintf(stderr, "\nERROR: Could not open the batch file list %s\n",
+                batchFileListName.c_str());
+        return -1;
+    }
+    std::string fileName;
+    while (std::getline(batchFileList, fileName)) {
+        if (!fileName.empty()) {
+            batchFileNames.push_back(fileName);
+        }
+    }
+    if (batchFileNames.empty()) {
+        fprintf(stderr, "\nERROR: The batch file list %s is empty\n",
+                batchFileListName.c_str());
+        return -1;
+    }
+    return 0;
+}
+
+// Resolves --numaAffinity into concrete per-role CPU sets once the device
+// is known, and pins the calling thread, which runs the decode role unless
+// --decoupledPresent moves it to its own thread (which then pins itself in
+// VulkanFrame::DecodeThreadProc()). The parser and output writer threads
+// pin themselves when they start.
+static void SetupThreadAffinity(ProgramConfig& programConfig, const VulkanDeviceContext& vkDevCtxt)
+{
+    if (programConfig.enableNumaAutoAffinity) {
+        const std::string deviceLocalCpus = VulkanThreadAffinity::GetDeviceLocalCpuSet(&vkDevCtxt);
+        if (!deviceLocalCpus.empty()) {
+            if (programConfig.parserThreadCpuSet.empty()) {
+                programConfig.parserThreadCpuSet = deviceLocalCpus;
+            }
+            if (programConfig.decodeThreadCpuSet.empty()) {
+                programConfig.decodeThreadCpuSet = deviceLocalCpus;
+            }
+            if (programConfig.outputThreadCpuSet.empty()) {
+                programConfig.outputThreadCpuSet = deviceLocalCpus;
+            }
+            if (programConfig.verbose) {
+                std::cout << "NUMA affinity: GPU-local CPUs are " << deviceLocalCpus << std::endl;
+            }
+        }
+        VulkanThreadAffinity::SetPreferNumaLocalHostAllocations(true);
+    }
+
+    if (!programConfig.enableDecoupledPresent) {
+        VulkanThreadAffinity::PinCurrentThread(programConfig.decodeThreadCpuSet, "decode");
+    }
+}
+
+// Offline parallel GOP decode (--parallelGopDecode <count>): the stream is
+// split into keyframe-aligned time segments that partition it disjointly,
+// and each segment is decoded by its own VulkanVideoProcessor - a separate
+// demuxer, parser, video session and frame pool - on the shared Vulkan
+// device. The engines are spread over the available decode queues (the
+// per-queue submit mutexes in VulkanDeviceContext make sharing a queue safe)
+// and drained concurrently by per-engine worker threads. Because the
+// segments are disjoint and in stream order, the merging stage reduces to
+// concatenating the per-engine outputs in segment order.
+static int RunParallelGopDecode(ProgramConfig& programConfig, VulkanDeviceContext& vkDevCtxt)
+{
+    int32_t numEngines = programConfig.parallelGopDecodeCount;
+
+    std::vector<ProgramConfig> engineConfigs((size_t)numEngines, programConfig);
+    std::vector<VkSharedBaseObj<VulkanVideoProcessor>> engines((size_t)numEngines);
+
+    // Probe the stream duration first - the segment boundaries are derived
+    // from it. The probe engine is re-initialized as engine 0 below.
+    VkResult result = VulkanVideoProcessor::Create(&vkDevCtxt, engines[0]);
+    if (result != VK_SUCCESS) {
+        return -1;
+    }
+    ProgramConfig probeConfig(programConfig);
+    probeConfig.outputFileName.clear();
+    if (engines[0]->Initialize(&vkDevCtxt, probeConfig) != 0) {
+        fprintf(stderr, "\nERROR: Could not initialize the decoder for %s\n",
+                programConfig.videoFileName.c_str());
+        return -1;
+    }
+    const int64_t durationNs = engines[0]->GetStreamDurationNs();
+    if (durationNs <= 0) {
+        std::cout << "The container does not report a duration - falling back to a single decode engine"
+                  << std::endl;
+        numEngines = 1;
+        engineConfigs.erase(engineConfigs.begin() + 1, engineConfigs.end());
+        engines.resize(1);
+    }
+    const double durationSec = (double)durationNs / 1e9;
+
+    std::vector<VkSharedBaseObj<FrameProcessor>> engineFrameProcessors((size_t)numEngines);
+    for (int32_t e = 0; e < numEngines; e++) {
+        ProgramConfig& engineConfig = engineConfigs[e];
+        engineConfig.queueId = (int)(e % vkDevCtxt.GetVideoDecodeNumQueues());
+        engineConfig.startTime = (durationSec * e) / numEngines;
+        engineConfig.stopTime = (e == (numEngines - 1)) ? 0.0 : ((durationSec * (e + 1)) / numEngines);
+        engineConfig.alignStartTimeToNextKeyFrame = (e > 0);
+        if (!programConfig.outputFileName.empty()) {
+            engineConfig.outputFileName = programConfig.outputFileName + ".seg" + std::to_string(e);
+        }
+        if (e > 0) {
+            result = VulkanVideoProcessor::Create(&vkDevCtxt, engines[e]);
+            if (result != VK_SUCCESS) {
+                return -1;
+            }
+        }
+        if (engines[e]->Initialize(&vkDevCtxt, engineConfig) != 0) {
+            fprintf(stderr, "\nERROR: Could not initialize decode engine %d for %s\n",
+                    e, programConfig.videoFileName.c_str());
+            return -1;
+        }
+        result = CreateFrameProcessor(engineConfig, &vkDevCtxt, engines[e], engineFrameProcessors[e]);
+        if (result != VK_SUCCESS) {
+            return -1;
+        }
+        const int numberOfFrames = 6;
+        int ret = engineFrameProcessors[e]->CreateFrameData(numberOfFrames);
+        assert(ret == numberOfFrames);
+        if (ret != numberOfFrames) {
+            return -1;
+        }
+    }
+
+    std::vector<uint64_t> engineFrameCounts((size_t)numEngines, 0);
+    std::vector<std::thread> engineWorkers;
+    const auto decodeStartTime = std::chrono::steady_clock::now();
+    for (int32_t e = 0; e < numEngines; e++) {
+        engineWorkers.emplace_back([&, e]() {
+            bool continueLoop = true;
+            do {
+                const DecodedFrame* pOutFrame = nullptr;
+                continueLoop = engineFrameProcessors[e]->OnFrame(0,
+                                                                 0, // waitSemaphoreCount
+                                                                 nullptr,
+                                                                 0, // signalSemaphoreCount
+                                                                 nullptr,
+                                                                 &pOutFrame);
+                if (continueLoop) {
+                    engineFrameCounts[e]++;
+                }
+            } while (continueLoop);
+        });
+    }
+    for (auto& engineWorker : engineWorkers) {
+        engineWorker.join();
+    }
+    const double decodeSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - decodeStartTime).count();
+
+    uint64_t totalFrameCount = 0;
+    for (int32_t e = 0; e < numEngines; e++) {
+        totalFrameCount += engineFrameCounts[e];
+        std::cout << "Engine " << e << " [" << engineConfigs[e].startTime << " - "
+                  << ((engineConfigs[e].stopTime > 0.0) ? engineConfigs[e].stopTime : durationSec)
+                  << " sec]: " << engineFrameCounts[e] << " frames" << std::endl;
+    }
+    std::cout << "Parallel GOP decode total: " << totalFrameCount << " frames on "
+              << numEngines << " engines in " << decodeSeconds << " sec"
+              << " (" << ((decodeSeconds > 0.0) ? (totalFrameCount / decodeSeconds) : 0.0)
+              << " FPS)" << std::endl;
+
+    // Release the engines before the merge below, so the per-engine output
+    // files are flushed and closed.
+    for (int32_t e = 0; e < numEngines; e++) {
+        engineFrameProcessors[e]->DestroyFrameData();
+        engineFrameProcessors[e] = nullptr;
+        engines[e] = nullptr;
+    }
+
+    if (!programConfig.outputFileName.empty()) {
+        std::ofstream mergedFile(programConfig.outputFileName.c_str(), std::ios::binary | std::ios::trunc);
+        if (!mergedFile) {
+            fprintf(stderr, "\nERROR: Could not open the output file %s\n",
+                    programConfig.outputFileName.c_str());
+            return -1;
+        }
+        for (int32_t e = 0; e < numEngines; e++) {
+            std::ifstream segmentFile(engineConfigs[e].outputFileName.c_str(), std::ios::binary);
+            if (!segmentFile) {
+                fprintf(stderr, "\nERROR: Missing the output segment file %s\n",
+                        engineConfigs[e].outputFileName.c_str());
+                return -1;
+            }
+            mergedFile << segmentFile.rdbuf();
+            segmentFile.close();
+            std::remove(engineConfigs[e].outputFileName.c_str());
+        }
+    }
+
+    return 0;
+}
+
+// Per-stream statistics client for the reactor decode mode below: counts
+// the delivered frames and records the completion time, so the per-stream
+// rates can be reported after the run.
+class ReactorStreamStats : public VulkanVideoFrameReactor::Client {
+public:
+    ReactorStreamStats()
+        : m_frameCount(0)
+        , m_completionSeconds(0.0)
+        , m_startTime(std::chrono::steady_clock::now())
+    {
+    }
+
+    virtual void OnFrameReady(VulkanVideoProcessor*, const DecodedFrame*)
+    {
+        m_frameCount++;
+    }
+
+    virtual void OnStreamComplete(VulkanVideoProcessor*)
+    {
+        m_completionSeconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - m_startTime).count();
+    }
+
+    uint64_t GetFrameCount() const { return m_frameCount; }
+    double GetCompletionSeconds() const { return m_completionSeconds; }
+
+private:
+    uint64_t m_frameCount;
+    double   m_completionSeconds;
+    std::chrono::steady_clock::time_point m_startTime;
+};
+
+// Reactor decode (--reactorDecode, implies noPresent): every stream of the
+// --batchFileList (or the single input file) is decoded concurrently, but
+// all of them are driven by this one thread through the non-blocking
+// TryGetNextFrame()/fence-poll loop of VulkanVideoFrameReactor - no
+// consumer thread per stream. Combine with --parserWorkers to keep the
+// parse work off the reactor thread as well.
+static int RunReactorDecode(ProgramConfig& programConfig, VulkanDeviceContext& vkDevCtxt)
+{
+    std::vector<std::string> streamFileNames;
+    if (!programConfig.batchFileListName.empty()) {
+        if (ReadBatchFileList(programConfig.batchFileListName, streamFileNames) != 0) {
+            return -1;
+        }
+    } else {
+        streamFileNames.push_back(programConfig.videoFileName);
+    }
+    const size_t numStreams = streamFileNames.size();
+
+    std::vector<ProgramConfig> streamConfigs(numStreams, programConfig);
+    std::vector<VkSharedBaseObj<VulkanVideoProcessor>> streamProcessors(numStreams);
+    std::vector<ReactorStreamStats> streamStats(numStreams);
+
+    VulkanVideoFrameReactor reactor(&vkDevCtxt);
+    for (size_t s = 0; s < numStreams; s++) {
+        ProgramConfig& streamConfig = streamConfigs[s];
+        streamConfig.videoFileName = streamFileNames[s];
+        // Spread the streams over the available decode queues.
+        streamConfig.queueId = (int)(s % vkDevCtxt.GetVideoDecodeNumQueues());
+        // Only the first stream carries the realtime QoS class; the rest of
+        // the set decodes best-effort behind it.
+        streamConfig.enableRealtimeDecodeQos = (s == 0) ? programConfig.enableRealtimeDecodeQos : 0;
+        if (!programConfig.outputFileName.empty() && (numStreams > 1)) {
+            streamConfig.outputFileName = programConfig.outputFileName + ".s" + std::to_string(s);
+        }
+        VkResult result = VulkanVideoProcessor::Create(&vkDevCtxt, streamProcessors[s]);
+        if (result != VK_SUCCESS) {
+            return -1;
+        }
+        if (streamProcessors[s]->Initialize(&vkDevCtxt, streamConfig) != 0) {
+            fprintf(stderr, "\nERROR: Could not initialize the decoder for %s\n",
+                    streamConfig.videoFileName.c_str());
+            return -1;
+        }
+        reactor.AddStream(streamProcessors[s], &streamStats[s]);
+    }
+
+    const auto decodeStartTime = std::chrono::steady_clock::now();
+    reactor.Run();
+    const double decodeSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - decodeStartTime).count();
+
+    uint64_t totalFrameCount = 0;
+    for (size_t s = 0; s < numStreams; s++) {
+        totalFrameCount += streamStats[s].GetFrameCount();
+        std::cout << "Reactor stream " << s << " " << streamFileNames[s]
+                  << ": " << streamStats[s].GetFrameCount() << " frames in "
+                  << streamStats[s].GetCompletionSeconds() << " sec" << std::endl;
+        streamProcessors[s] = nullptr;
+    }
+    std::cout << "Reactor decode total: " << totalFrameCount << " frames from "
+              << numStreams << " streams on one thread in " << decodeSeconds << " sec"
+              << " (" << ((decodeSeconds > 0.0) ? (totalFrameCount / decodeSeconds) : 0.0)
+              << " FPS)" << std::endl;
+
+    VkVideoDecoderPool::GetInstance().Clear(&vkDevCtxt);
+
+    return 0;
+}
+
+// In-process multi-GPU stream sharding (--multiGpu <count|all>): one Vulkan
+// instance and device is created per physical device - the N-th context
+// selects the N-th suitable device (see
+// VulkanDeviceContext::InitPhysicalDevice()) - and the --batchFileList
+// streams are sharded across them. A list entry of the form "N:file" pins
+// the file to GPU N; unprefixed entries go into a shared work queue the
+// per-GPU workers pull from, so faster (or less loaded) GPUs naturally
+// take more streams. Per-GPU decode throughput and the driver-reported
+// device-local memory usage are printed along with the aggregate, so a
+// single supervisor process can drive and monitor the whole host.
+static int RunMultiGpuDecode(ProgramConfig& programConfig)
+{
+    std::vector<std::string> batchFileNames;
+    if (!programConfig.batchFileListName.empty()) {
+        if (ReadBatchFileList(programConfig.batchFileListName, batchFileNames) != 0) {
+            return -1;
+        }
+    } else {
+        batchFileNames.push_back(programConfig.videoFileName);
+    }
+
+    // Split the explicit "N:file" assignments from the shared pool.
+    std::vector<std::pair<uint32_t, std::string>> explicitAssignments;
+    std::vector<std::string> sharedFiles;
+    for (size_t fileIndx = 0; fileIndx < batchFileNames.size(); fileIndx++) {
+        const std::string& entry = batchFileNames[fileIndx];
+        const size_t colonPos = entry.find(':');
+        if ((colonPos != std::string::npos) && (colonPos > 0) &&
+                (entry.find_first_not_of("0123456789") == colonPos)) {
+            explicitAssignments.emplace_back((uint32_t)std::atoi(entry.c_str()),
+                                             entry.substr(colonPos + 1));
+        } else {
+            sharedFiles.push_back(entry);
+        }
+    }
+
+    // Create one Vulkan instance and device per physical device. With
+    // "all" the suitable devices are probed until selection fails.
+    std::vector<std::unique_ptr<VulkanDeviceContext>> deviceContexts;
+    const int32_t requestedGpuCount = programConfig.multiGpuCount;
+    for (int32_t gpu = 0; (requestedGpuCount < 0) || (gpu < requestedGpuCount); gpu++) {
+        std::unique_ptr<VulkanDeviceContext> vkDevCtxt(
+                new VulkanDeviceContext(programConfig.deviceId, gpu));
+        AddVideoDeviceExtensions(programConfig, *vkDevCtxt);
+        VkResult result = vkDevCtxt->InitVulkanDevice(programConfig.name.c_str(),
+                                                      programConfig.verbose);
+        if (result != VK_SUCCESS) {
+            printf("Could not initialize the Vulkan device!\n");
+            return -1;
+        }
+        result = vkDevCtxt->InitDebugReport(programConfig.validate,
+                                            programConfig.validateVerbose);
+        if (result != VK_SUCCESS) {
+            return -1;
+        }
+        result = vkDevCtxt->InitPhysicalDevice((VK_QUEUE_GRAPHICS_BIT |
+                                                VK_QUEUE_VIDEO_DECODE_BIT_KHR),
+                                                nullptr);
+        if (result != VK_SUCCESS) {
+            if (requestedGpuCount < 0) {
+                // Probed past the last suitable device.
+                break;
+            }
+            fprintf(stderr, "\nERROR: Could not find %d suitable physical devices (found %d)\n",
+                    requestedGpuCount, gpu);
+            return -1;
+        }
+        vkDevCtxt->CreateVulkanDevice();
+        deviceContexts.push_back(std::move(vkDevCtxt));
+    }
+    const int32_t numGpus = (int32_t)deviceContexts.size();
+    if (numGpus == 0) {
+        fprintf(stderr, "\nERROR: No suitable physical device for --multiGpu\n");
+        return -1;
+    }
+
+    std::vector<std::vector<std::string>> explicitFiles((size_t)numGpus);
+    for (size_t a = 0; a < explicitAssignments.size(); a++) {
+        if (explicitAssignments[a].first >= (uint32_t)numGpus) {
+            fprintf(stderr, "\nERROR: Batch list entry %u:%s targets a GPU beyond the %d available\n",
+                    explicitAssignments[a].first, explicitAssignments[a].second.c_str(), numGpus);
+            return -1;
+        }
+        explicitFiles[explicitAssignments[a].first].push_back(explicitAssignments[a].second);
+    }
+
+    if (programConfig.enableNumaAutoAffinity) {
+        VulkanThreadAffinity::SetPreferNumaLocalHostAllocations(true);
+    }
+
+    std::vector<ProgramConfig> gpuConfigs((size_t)numGpus, programConfig);
+    std::vector<VkSharedBaseObj<VulkanVideoProcessor>> gpuProcessors((size_t)numGpus);
+    std::vector<VkSharedBaseObj<FrameProcessor>> gpuFrameProcessors((size_t)numGpus);
+    for (int32_t gpu = 0; gpu < numGpus; gpu++) {
+        ProgramConfig& gpuConfig = gpuConfigs[gpu];
+        // Each worker pins to its own GPU's local CPUs, so on a multi-socket
+        // host every decode stays on the right NUMA node.
+        if (gpuConfig.enableNumaAutoAffinity) {
+            const std::string deviceLocalCpus =
+                    VulkanThreadAffinity::GetDeviceLocalCpuSet(deviceContexts[gpu].get());
+            if (!deviceLocalCpus.empty()) {
+                if (gpuConfig.parserThreadCpuSet.empty()) {
+                    gpuConfig.parserThreadCpuSet = deviceLocalCpus;
+                }
+                if (gpuConfig.decodeThreadCpuSet.empty()) {
+                    gpuConfig.decodeThreadCpuSet = deviceLocalCpus;
+                }
+                if (gpuConfig.outputThreadCpuSet.empty()) {
+                    gpuConfig.outputThreadCpuSet = deviceLocalCpus;
+                }
+            }
+        }
+        // The GPUs decode concurrently - give each its own output file.
+        if (!gpuConfig.outputFileName.empty()) {
+            gpuConfig.outputFileName = programConfig.outputFileName + ".gpu" + std::to_string(gpu);
+        }
+        VkResult result = VulkanVideoProcessor::Create(deviceContexts[gpu].get(), gpuProcessors[gpu]);
+        if (result != VK_SUCCESS) {
+            return -1;
+        }
+        result = CreateFrameProcessor(gpuConfig, deviceContexts[gpu].get(),
+                                      gpuProcessors[gpu], gpuFrameProcessors[gpu]);
+        if (result != VK_SUCCESS) {
+            return -1;
+        }
+    }
+
+    std::atomic<size_t> nextSharedFile(0);
+    std::vector<uint64_t> gpuFrameCounts((size_t)numGpus, 0);
+    std::vector<uint32_t> gpuFileCounts((size_t)numGpus, 0);
+    std::vector<uint32_t> gpuFailedFileCounts((size_t)numGpus, 0);
+    std::vector<double>   gpuSeconds((size_t)numGpus, 0.0);
+    std::vector<std::thread> gpuWorkers;
+    const auto decodeStartTime = std::chrono::steady_clock::now();
+    for (int32_t gpu = 0; gpu < numGpus; gpu++) {
+        gpuWorkers.emplace_back([&, gpu]() {
+            ProgramConfig& gpuConfig = gpuConfigs[gpu];
+            VulkanThreadAffinity::PinCurrentThread(gpuConfig.decodeThreadCpuSet, "decode");
+            const auto gpuStartTime = std::chrono::steady_clock::now();
+            size_t nextExplicitFile = 0;
+            for (;;) {
+                if (nextExplicitFile < explicitFiles[gpu].size()) {
+                    gpuConfig.videoFileName = explicitFiles[gpu][nextExplicitFile++];
+                } else {
+                    const size_t sharedIndx = nextSharedFile.fetch_add(1);
+                    if (sharedIndx >= sharedFiles.size()) {
+                        break;
+                    }
+                    gpuConfig.videoFileName = sharedFiles[sharedIndx];
+                }
+                if (gpuProcessors[gpu]->Initialize(deviceContexts[gpu].get(), gpuConfig) != 0) {
+                    fprintf(stderr, "\nERROR: Could not initialize the decoder for %s on GPU %d\n",
+                            gpuConfig.videoFileName.c_str(), gpu);
+                    gpuFailedFileCounts[gpu]++;
+                    continue;
+                }
+                const int numberOfFrames = 6;
+                int ret = gpuFrameProcessors[gpu]->CreateFrameData(numberOfFrames);
+                assert(ret == numberOfFrames);
+                if (ret != numberOfFrames) {
+                    gpuFailedFileCounts[gpu]++;
+                    break;
+                }
+                bool continueLoop = true;
+                do {
+                    const DecodedFrame* pOutFrame = nullptr;
+                    continueLoop = gpuFrameProcessors[gpu]->OnFrame(0,
+                                                                   0, // waitSemaphoreCount
+                                                                   nullptr,
+                                                                   0, // signalSemaphoreCount
+                                                                   nullptr,
+                                                                   &pOutFrame);
+                    if (continueLoop) {
+                        gpuFrameCounts[gpu]++;
+                    }
+                } while (continueLoop);
+                gpuFileCounts[gpu]++;
+            }
+            gpuFrameProcessors[gpu]->DestroyFrameData();
+            gpuSeconds[gpu] = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - gpuStartTime).count();
+        });
+    }
+    for (auto& gpuWorker : gpuWorkers) {
+        gpuWorker.join();
+    }
+    const double totalSeconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - decodeStartTime).count();
+
+    uint64_t totalFrameCount = 0;
+    uint32_t totalFileCount = 0;
+    uint32_t totalFailedFileCount = 0;
+    for (int32_t gpu = 0; gpu < numGpus; gpu++) {
+        totalFrameCount += gpuFrameCounts[gpu];
+        totalFileCount += gpuFileCounts[gpu];
+        totalFailedFileCount += gpuFailedFileCounts[gpu];
+        VkPhysicalDeviceProperties props;
+        deviceContexts[gpu]->GetPhysicalDeviceProperties(deviceContexts[gpu]->getPhysicalDevice(), &props);
+        std::cout << "GPU " << gpu << " (" << props.deviceName << "): "
+                  << gpuFrameCounts[gpu] << " frames from " << gpuFileCounts[gpu]
+                  << " files in " << gpuSeconds[gpu] << " sec"
+                  << " (" << ((gpuSeconds[gpu] > 0.0) ? (gpuFrameCounts[gpu] / gpuSeconds[gpu]) : 0.0)
+                  << " FPS)";
+        const VulkanMemoryBudget::Snapshot snapshot =
+                VulkanMemoryBudget::GetSnapshot(deviceContexts[gpu].get());
+        if (snapshot.deviceLocalBudgetBytes != 0) {
+            std::cout << ", device-local " << (snapshot.deviceLocalUsageBytes / (1024 * 1024))
+                      << " / " << (snapshot.deviceLocalBudgetBytes / (1024 * 1024)) << " MB";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "Multi-GPU total: " << totalFrameCount << " frames from "
+              << totalFileCount << "/" << (totalFileCount + totalFailedFileCount)
+              << " files on " << numGpus << " GPUs in " << totalSeconds << " sec"
+              << " (" << ((totalSeconds > 0.0) ? (totalFrameCount / totalSeconds) : 0.0)
+              << " FPS)" << std::endl;
+
+    // Release the per-GPU decoders before their device contexts go away.
+    for (int32_t gpu = 0; gpu < numGpus; gpu++) {
+        gpuFrameProcessors[gpu] = nullptr;
+        gpuProcessors[gpu] = nullptr;
+        VkVideoDecoderPool::GetInstance().Clear(deviceContexts[gpu].get());
+    }
+
+    return (totalFailedFileCount != 0) ? -1 : 0;
+}
+
 int main(int argc, char **argv) {
 
     ProgramConfig programConfig(argv[0]);
     programConfig.ParseArgs(argc, argv);
 
+    if (!programConfig.shaderCacheDir.empty()) {
+        vulkanVideoUtils::VulkanShaderCompiler::SetShaderCacheDirectory(programConfig.shaderCacheDir.c_str());
+        VulkanVideoCapabilities::SetPersistentCacheDir(programConfig.shaderCacheDir.c_str());
+    }
+
+    if (programConfig.hostHugePageThresholdKb > 0) {
+        VulkanDeviceMemoryImpl::SetHostHugePageThreshold((size_t)programConfig.hostHugePageThresholdKb * 1024);
+    }
+
+    if (programConfig.multiGpuCount != 0) {
+        return RunMultiGpuDecode(programConfig);
+    }
+
     VulkanDeviceContext vkDevCtxt(programConfig.deviceId);
 
     if (programConfig.validate) {
@@ -57,16 +653,9 @@ int main(int argc, char **argv) {
     }
     /********** End WSI instance extensions support *******************************************/
 
-#if defined(__linux) || defined(__linux__) || defined(linux)
-    vkDevCtxt.AddRequiredDeviceExtension(VK_KHR_EXTERNAL_MEMORY_FD_EXTENSION_NAME);
-    vkDevCtxt.AddRequiredDeviceExtension(VK_KHR_EXTERNAL_FENCE_FD_EXTENSION_NAME);
-#endif
-    { // Vulkan Video required extensions
-        vkDevCtxt.AddRequiredDeviceExtension(VK_EXT_YCBCR_2PLANE_444_FORMATS_EXTENSION_NAME);
-        vkDevCtxt.AddRequiredDeviceExtension(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
-        vkDevCtxt.AddRequiredDeviceExtension(VK_KHR_VIDEO_QUEUE_EXTENSION_NAME);
-        vkDevCtxt.AddRequiredDeviceExtension(VK_KHR_VIDEO_DECODE_QUEUE_EXTENSION_NAME);
-    }
+    AddVideoDeviceExtensions(programConfig, vkDevCtxt);
+
+    vkDevCtxt.SetStartupCacheFile(programConfig.deviceStartupCacheFile);
 
     VkResult result = vkDevCtxt.InitVulkanDevice(programConfig.name.c_str(),
                                                            programConfig.verbose);
@@ -116,8 +705,63 @@ int main(int argc, char **argv) {
 
         vkDevCtxt.CreateVulkanDevice();
 
+        SetupThreadAffinity(programConfig, vkDevCtxt);
+
+        // Mosaic composition (--mosaic N): every tile gets its own decoder
+        // instance, all of them presented by the one frame processor with a
+        // single submit+present per display frame. The tile inputs come
+        // from --batchFileList when given (repeating from the top when it
+        // is shorter than the grid), otherwise every tile plays the
+        // primary input.
+        std::vector<std::string> mosaicFileNames;
+        if (programConfig.mosaicStreamCount > 1) {
+            if (!programConfig.batchFileListName.empty()) {
+                if (ReadBatchFileList(programConfig.batchFileListName, mosaicFileNames) != 0) {
+                    return -1;
+                }
+            }
+            if (mosaicFileNames.empty()) {
+                mosaicFileNames.push_back(programConfig.videoFileName);
+            }
+            programConfig.videoFileName = mosaicFileNames[0];
+        }
+
         vulkanVideoProcessor->Initialize(&vkDevCtxt, programConfig);
 
+        std::vector<VkSharedBaseObj<VulkanVideoProcessor>> mosaicProcessors;
+        if (programConfig.mosaicStreamCount > 1) {
+
+            frameProcessor->AddMosaicStream(vulkanVideoProcessor);
+
+            for (int32_t streamIndx = 1; streamIndx < programConfig.mosaicStreamCount; streamIndx++) {
+
+                ProgramConfig streamConfig = programConfig;
+                streamConfig.videoFileName = mosaicFileNames[(size_t)streamIndx % mosaicFileNames.size()];
+                // Spread the decoder instances over the available decode
+                // queues the same way the parallel decode modes do.
+                streamConfig.queueId = (int)(streamIndx % vkDevCtxt.GetVideoDecodeNumQueues());
+                // The primary tile keeps the realtime QoS class; the extra
+                // tiles decode best-effort behind it.
+                streamConfig.enableRealtimeDecodeQos = 0;
+                if (!streamConfig.outputFileName.empty()) {
+                    streamConfig.outputFileName += ".s" + std::to_string(streamIndx);
+                }
+
+                VkSharedBaseObj<VulkanVideoProcessor> streamProcessor;
+                result = VulkanVideoProcessor::Create(&vkDevCtxt, streamProcessor);
+                if (result != VK_SUCCESS) {
+                    return -1;
+                }
+                if (streamProcessor->Initialize(&vkDevCtxt, streamConfig) != 0) {
+                    fprintf(stderr, "\nERROR: Could not initialize the decoder for %s\n",
+                            streamConfig.videoFileName.c_str());
+                    return -1;
+                }
+
+                frameProcessor->AddMosaicStream(streamProcessor);
+                mosaicProcessors.push_back(streamProcessor);
+            }
+        }
 
         displayShell->RunLoop();
 
@@ -134,25 +778,134 @@ int main(int argc, char **argv) {
 
         vkDevCtxt.CreateVulkanDevice();
 
-        vulkanVideoProcessor->Initialize(&vkDevCtxt, programConfig);
+        SetupThreadAffinity(programConfig, vkDevCtxt);
 
-        const int numberOfFrames = 6;
-        int ret = frameProcessor->CreateFrameData(numberOfFrames);
-        assert(ret == numberOfFrames);
-        if (ret != numberOfFrames) {
-            return -1;
+        if (programConfig.parallelGopDecodeCount > 1) {
+            return RunParallelGopDecode(programConfig, vkDevCtxt);
+        }
+
+        if (programConfig.enableReactorDecode) {
+            return RunReactorDecode(programConfig, vkDevCtxt);
+        }
+
+        const bool batchMode = !programConfig.batchFileListName.empty();
+        std::vector<std::string> batchFileNames;
+        if (batchMode) {
+            if (ReadBatchFileList(programConfig.batchFileListName, batchFileNames) != 0) {
+                return -1;
+            }
+        } else {
+            batchFileNames.push_back(programConfig.videoFileName);
+        }
+
+        DecodeBenchmark benchmark(programConfig.benchmarkWarmupFrames);
+        InFlightDepthCalibration calibration;
+        std::vector<int32_t> sweepDepths(1, programConfig.numDecodeImagesInFlight);
+        if (programConfig.calibrateInFlight) {
+            sweepDepths = InFlightDepthCalibration::GetSweepDepths(programConfig.numDecodeImagesInFlight);
+            // A parked decoder keeps the depth it was created with and the
+            // adaptive controller would second-guess the fixed depth under
+            // test - neither can be active during a calibration sweep.
+            programConfig.enableDecoderPool = false;
+            programConfig.enableAdaptiveInFlight = false;
+        }
+        uint64_t totalFrameCount = 0;
+        double totalDecodeSeconds = 0.0;
+        uint32_t failedFileCount = 0;
+        for (size_t fileIndx = 0; fileIndx < batchFileNames.size(); fileIndx++) {
+
+            programConfig.videoFileName = batchFileNames[fileIndx];
+            for (size_t depthIndx = 0; depthIndx < sweepDepths.size(); depthIndx++) {
+
+                programConfig.numDecodeImagesInFlight = sweepDepths[depthIndx];
+                // Initialize() tears down the previous file's decoder state first,
+                // so across the batch the Vulkan instance, device, queues and the
+                // shader/pipeline caches stay warm and only the per-file demuxer,
+                // parser and video session are recreated.
+                int32_t initResult = vulkanVideoProcessor->Initialize(&vkDevCtxt, programConfig);
+                if (initResult != 0) {
+                    fprintf(stderr, "\nERROR: Could not initialize the decoder for %s\n",
+                            programConfig.videoFileName.c_str());
+                    failedFileCount++;
+                    break;
+                }
+
+                const int numberOfFrames = 6;
+                int ret = frameProcessor->CreateFrameData(numberOfFrames);
+                assert(ret == numberOfFrames);
+                if (ret != numberOfFrames) {
+                    return -1;
+                }
+                uint64_t fileFrameCount = 0;
+                const auto fileStartTime = std::chrono::steady_clock::now();
+                bool continueLoop = true;
+                do {
+                    if (programConfig.benchmark) {
+                        benchmark.BeginFrame();
+                    }
+                    const DecodedFrame* pOutFrame = nullptr;
+                    continueLoop = frameProcessor->OnFrame(0,
+                                                           0, // waitSemaphoreCount
+                                                           nullptr,
+                                                           0, // signalSemaphoreCount
+                                                           nullptr,
+                                                           &pOutFrame);
+                    if (continueLoop) {
+                        fileFrameCount++;
+                        if (programConfig.benchmark) {
+                            // OnFrame() has already waited for the frame-complete fence on
+                            // the noPresent path, so the sample spans parse to decode-complete.
+                            benchmark.EndFrame();
+                        }
+                    }
+                } while (continueLoop);
+
+                const double fileSeconds = std::chrono::duration<double>(
+                        std::chrono::steady_clock::now() - fileStartTime).count();
+                totalFrameCount += fileFrameCount;
+                totalDecodeSeconds += fileSeconds;
+                if (programConfig.calibrateInFlight) {
+                    calibration.AddSample(programConfig.videoFileName, sweepDepths[depthIndx],
+                                          fileFrameCount, fileSeconds);
+                    std::cout << "Calibration " << programConfig.videoFileName
+                              << " depth " << sweepDepths[depthIndx]
+                              << ": " << fileFrameCount << " frames in " << fileSeconds << " sec"
+                              << " (" << ((fileSeconds > 0.0) ? (fileFrameCount / fileSeconds) : 0.0)
+                              << " FPS)" << std::endl;
+                } else if (batchMode) {
+                    std::cout << "Batch file " << (fileIndx + 1) << "/" << batchFileNames.size()
+                              << " " << programConfig.videoFileName
+                              << ": " << fileFrameCount << " frames in " << fileSeconds << " sec"
+                              << " (" << ((fileSeconds > 0.0) ? (fileFrameCount / fileSeconds) : 0.0)
+                              << " FPS)" << std::endl;
+                }
+            }
         }
-        bool continueLoop = true;
-        do {
-            const DecodedFrame* pOutFrame = nullptr;
-            continueLoop = frameProcessor->OnFrame(0,
-                                                   0, // waitSemaphoreCount
-                                                   nullptr,
-                                                   0, // signalSemaphoreCount
-                                                   nullptr,
-                                                   &pOutFrame);
-        } while (continueLoop);
         frameProcessor->DestroyFrameData();
+
+        // Decoders parked by the batch loop (--decoderPool) hold device
+        // objects - release them before the device context goes away.
+        VkVideoDecoderPool::GetInstance().Clear(&vkDevCtxt);
+
+        if (batchMode) {
+            std::cout << "Batch total: " << totalFrameCount << " frames from "
+                      << (batchFileNames.size() - failedFileCount) << "/" << batchFileNames.size()
+                      << " files in " << totalDecodeSeconds << " sec"
+                      << " (" << ((totalDecodeSeconds > 0.0) ? (totalFrameCount / totalDecodeSeconds) : 0.0)
+                      << " FPS)" << std::endl;
+        }
+
+        if (programConfig.benchmark) {
+            benchmark.Report(std::cout);
+        }
+
+        if (programConfig.calibrateInFlight) {
+            calibration.Report(std::cout);
+        }
+
+        if (failedFileCount != 0) {
+            return -1;
+        }
     }
 
     return 0;
@@ -0,0 +1,20 @@
+#version 450 core
+// The fixed vertex shader of the built-in video display pipeline
+// (see VulkanVideoUtils.cpp). It is precompiled to SPIR-V at build time
+// by the glsl-to-spirv step and embedded into the binary, so keep it in
+// sync with the runtime GLSL fallback string in CreateGraphicsPipeline().
+layout(location = 0) in vec2 aVertex;
+layout(location = 1) in vec2 aTexCoord;
+layout(location = 0) out vec2 vTexCoord;
+
+layout( push_constant ) uniform constants
+{
+    mat4 posMatrix;
+    mat2 texMatrix;
+} transformPushConstants;
+
+void main()
+{
+    vTexCoord = transformPushConstants.texMatrix * aTexCoord;
+    gl_Position = vec4(aVertex, 0, 1);
+}
@@ -267,6 +267,20 @@ vk_khr_external_fence_fd = Extension(name='VK_KHR_external_fence_fd', version=1,
     Command(name='GetFenceFdKHR', dispatch='VkDevice'),
 ])
 
+vk_khr_external_semaphore_fd = Extension(name='VK_KHR_external_semaphore_fd', version=1, guard=None, commands=[
+    Command(name='GetSemaphoreFdKHR', dispatch='VkDevice'),
+])
+
+vk_ext_external_memory_host = Extension(name='VK_EXT_external_memory_host', version=1, guard=None, commands=[
+    Command(name='GetMemoryHostPointerPropertiesEXT', dispatch='VkDevice'),
+])
+
+vk_khr_timeline_semaphore = Extension(name='VK_KHR_timeline_semaphore', version=2, guard=None, commands=[
+    Command(name='GetSemaphoreCounterValueKHR', dispatch='VkDevice'),
+    Command(name='WaitSemaphoresKHR', dispatch='VkDevice'),
+    Command(name='SignalSemaphoreKHR', dispatch='VkDevice'),
+])
+
 vk_khr_surface = Extension(name='VK_KHR_surface', version=25, guard=None, commands=[
     Command(name='DestroySurfaceKHR', dispatch='VkInstance'),
     Command(name='GetPhysicalDeviceSurfaceSupportKHR', dispatch='VkPhysicalDevice'),
@@ -380,6 +394,9 @@ extensions = [
     vk_core,
     vk_khr_external_memory_fd,
     vk_khr_external_fence_fd,
+    vk_khr_external_semaphore_fd,
+    vk_ext_external_memory_host,
+    vk_khr_timeline_semaphore,
     vk_khr_surface,
     vk_khr_swapchain,
     vk_khr_display,
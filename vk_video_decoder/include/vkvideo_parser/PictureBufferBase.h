@@ -41,8 +41,11 @@ private:
 
 public:
     int32_t m_picIdx;
-    int32_t m_displayOrder;
-    int32_t m_decodeOrder;
+    // The ordering counters are slot-local atomics: the parser/decode and
+    // display threads update them concurrently for disjoint pictures, so the
+    // frame buffer accessors do not need a global lock for them.
+    std::atomic<int32_t> m_displayOrder;
+    std::atomic<int32_t> m_decodeOrder;
     uint64_t m_timestamp;
     uint64_t m_presentTime;
 
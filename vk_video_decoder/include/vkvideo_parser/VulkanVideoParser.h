@@ -72,6 +72,13 @@ public:
                                     size_t* pParsedBytes,
                                     bool doPartialParsing = false) = 0;
 
+    // Decode decimation for preview-style consumers: when keepEveryNth is
+    // greater than one, only every Nth non-reference picture is decoded and
+    // displayed - the rest are dropped before submission. Reference pictures
+    // are always decoded to keep the DPB valid. 0 or 1 disables decimation
+    // (the default).
+    virtual void SetDecodeDecimation(uint32_t keepEveryNth) { (void)keepEveryNth; }
+
 protected:
     virtual ~IVulkanVideoParser() { }
 };
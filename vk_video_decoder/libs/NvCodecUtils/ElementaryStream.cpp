@@ -15,9 +15,16 @@
  */
 
 #include <string.h>
+#include <algorithm>
 #include <fstream>
 #include "mio/mio.hpp"
 #include "NvCodecUtils/VideoStreamDemuxer.h"
+#include "NvCodecUtils/NalStartCodeScanner.h"
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 class ElementaryStream : public VideoStreamDemuxer {
 
@@ -26,7 +33,9 @@ public:
                      VkVideoCodecOperationFlagBitsKHR forceParserType,
                      int32_t defaultWidth,
                      int32_t defaultHeight,
-                     int32_t defaultBitDepth)
+                     int32_t defaultBitDepth,
+                     size_t chunkSize,
+                     size_t readAheadSize)
         : VideoStreamDemuxer(),
           m_width(defaultWidth)
         , m_height(defaultHeight)
@@ -35,7 +44,10 @@ public:
         , m_inputVideoStreamMmap()
         , m_pBitstreamData(nullptr)
         , m_bitstreamDataSize(0)
-        , m_bytesRead(0) {
+        , m_bytesRead(0)
+        , m_chunkSize((chunkSize != 0) ? chunkSize : (size_t)DEFAULT_CHUNK_SIZE)
+        , m_readAheadSize(readAheadSize)
+        , m_prefetchedUpTo(0) {
 
         std::error_code error;
         m_inputVideoStreamMmap.map(pFilePath, 0, mio::map_entire_file, error);
@@ -49,6 +61,15 @@ public:
         m_bitstreamDataSize = m_inputVideoStreamMmap.mapped_length();
 
         m_pBitstreamData = m_inputVideoStreamMmap.data();
+
+#if !defined(_WIN32)
+        // The parse cursor only ever moves forward, so let the kernel
+        // readahead run with the sequential heuristics from the start.
+        if (m_inputVideoStreamMmap.is_mapped()) {
+            madvise(const_cast<uint8_t*>(m_pBitstreamData), m_bitstreamDataSize, MADV_SEQUENTIAL);
+        }
+#endif
+        PrefetchAhead(0);
     }
 
     ElementaryStream(const uint8_t *pInput, const size_t len,
@@ -60,7 +81,10 @@ public:
         , m_inputVideoStreamMmap()
         , m_pBitstreamData(pInput)
         , m_bitstreamDataSize(0)
-        , m_bytesRead(0) {
+        , m_bytesRead(0)
+        , m_chunkSize(DEFAULT_CHUNK_SIZE)
+        , m_readAheadSize(0)
+        , m_prefetchedUpTo(0) {
 
     }
 
@@ -71,12 +95,16 @@ public:
                            int32_t defaultWidth,
                            int32_t defaultHeight,
                            int32_t defaultBitDepth,
+                           size_t chunkSize,
+                           size_t readAheadSize,
                            VkSharedBaseObj<ElementaryStream>& elementaryStream)
     {
         VkSharedBaseObj<ElementaryStream> newElementaryStream(new ElementaryStream(pFilePath, codecType,
                                                                                    defaultWidth,
                                                                                    defaultHeight,
-                                                                                   defaultBitDepth));
+                                                                                   defaultBitDepth,
+                                                                                   chunkSize,
+                                                                                   readAheadSize));
 
          if ((newElementaryStream) && (newElementaryStream->Initialize() >= 0)) {
              elementaryStream = newElementaryStream;
@@ -91,7 +119,11 @@ public:
 
     virtual bool IsStreamDemuxerEnabled() const { return false; }
     virtual bool HasFramePreparser() const { return false; }
-    virtual void Rewind() { m_bytesRead = 0; }
+    virtual void Rewind() {
+        m_bytesRead = 0;
+        m_prefetchedUpTo = 0;
+        PrefetchAhead(0);
+    }
     virtual VkVideoCodecOperationFlagBitsKHR GetVideoCodec() const { return m_videoCodecType; }
 
     virtual VkVideoComponentBitDepthFlagsKHR GetLumaBitDepth() const
@@ -152,36 +184,96 @@ public:
         assert(m_bitstreamDataSize != 0);
         assert(m_pBitstreamData != nullptr);
 
+        // Keep the prefetch window running ahead of the parse cursor.
+        PrefetchAhead((size_t)offset);
+
         // Compute and return the pointer to data at new offset.
         *ppVideo = (m_pBitstreamData + offset);
-        return m_bitstreamDataSize - offset;
+        const int64_t remainingSize = m_bitstreamDataSize - offset;
+
+        // Hand the parser bounded chunks ending right before a NAL start
+        // code instead of the whole remaining mapping, so each parse call
+        // works on a span it can consume completely. The start codes are
+        // located with the vectorized scanner; if the window happens to
+        // contain none past its first NAL, the full window is returned and
+        // the parser splits it with its own partial parsing.
+        if (remainingSize > (int64_t)m_chunkSize) {
+            const int64_t lastStartCode = FindLastAnnexBStartCode(m_pBitstreamData + offset,
+                                                                  (size_t)remainingSize,
+                                                                  m_chunkSize);
+            if (lastStartCode > 4) {
+                return lastStartCode;
+            }
+            return (int64_t)m_chunkSize;
+        }
+        return remainingSize;
     }
 
     virtual void DumpStreamParameters() const {
     }
 
 private:
+    // Asks the kernel to start paging in the window ahead of the parse
+    // cursor, so the major faults are serviced by background readahead
+    // instead of synchronously on the parse thread when it walks into a
+    // cold page. The advised range only ever grows forward, so each page
+    // is advised once per pass over the stream.
+    void PrefetchAhead(size_t offset)
+    {
+#if !defined(_WIN32)
+        if ((m_readAheadSize == 0) || !m_inputVideoStreamMmap.is_mapped()) {
+            return;
+        }
+
+        const size_t desiredEnd = std::min(offset + m_readAheadSize, m_bitstreamDataSize);
+        if (desiredEnd <= m_prefetchedUpTo) {
+            return;
+        }
+
+        const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+        const size_t start = m_prefetchedUpTo & ~(pageSize - 1);
+        madvise(const_cast<uint8_t*>(m_pBitstreamData) + start, desiredEnd - start, MADV_WILLNEED);
+        m_prefetchedUpTo = desiredEnd;
+#else
+        (void)offset;
+#endif
+    }
+
+    // Default upper bound of the span a single ReadBitstreamData() call
+    // returns (the end is aligned down to the last NAL start code in the
+    // window), used when no chunk size is configured.
+    static const size_t DEFAULT_CHUNK_SIZE = 2 * 1024 * 1024;
+
     int32_t    m_width, m_height, m_bitDepth;
     VkVideoCodecOperationFlagBitsKHR m_videoCodecType;
     mio::basic_mmap<mio::access_mode::read, uint8_t> m_inputVideoStreamMmap;
     const uint8_t* m_pBitstreamData;
     size_t   m_bitstreamDataSize;
     size_t   m_bytesRead;
+    size_t   m_chunkSize;        // span cap per ReadBitstreamData() call
+    size_t   m_readAheadSize;    // prefetch distance ahead of the cursor; 0 disables
+    size_t   m_prefetchedUpTo;   // end of the range already advised WILLNEED
 };
 
-VkResult ElementaryStreamCreate(const char *pFilePath,
-                                VkVideoCodecOperationFlagBitsKHR codecType,
-                                int32_t defaultWidth,
-                                int32_t defaultHeight,
-                                int32_t defaultBitDepth,
-                                VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer)
+// The fallback backend: a raw elementary stream of a known codec needs no
+// container probing, so it is registered with the lowest priority and
+// accepts whatever the other backends passed on.
+static bool ElementaryStreamProbe(const VideoStreamDemuxer::CreateParams& params)
+{
+    return (params.pFilePath != nullptr);
+}
+
+static VkResult ElementaryStreamCreate(const VideoStreamDemuxer::CreateParams& params,
+                                       VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer)
 {
     VkSharedBaseObj<ElementaryStream> elementaryStream;
-    VkResult result = ElementaryStream::Create(pFilePath,
-                                               codecType,
-                                               defaultWidth,
-                                               defaultHeight,
-                                               defaultBitDepth,
+    VkResult result = ElementaryStream::Create(params.pFilePath,
+                                               params.codecType,
+                                               params.defaultWidth,
+                                               params.defaultHeight,
+                                               params.defaultBitDepth,
+                                               params.esChunkSize,
+                                               params.esReadAheadSize,
                                                elementaryStream);
     if (result == VK_SUCCESS) {
         videoStreamDemuxer = elementaryStream;
@@ -189,3 +281,8 @@ VkResult ElementaryStreamCreate(const char *pFilePath,
 
     return result;
 }
+
+static const bool s_elementaryStreamRegistered =
+        VideoStreamDemuxer::RegisterBackend("elementaryStream", 0,
+                                            ElementaryStreamProbe,
+                                            ElementaryStreamCreate);
@@ -26,6 +26,17 @@ extern "C" {
 #endif
 }
 
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<liburing.h>)
+#define DEMUXER_HAVE_IO_URING 1
+#include <liburing.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+#endif
+#endif
+
 inline bool check(int e, int iLine, const char *szFile) {
     if (e < 0) {
         LOG(ERROR) << "General error " << e << " at line " << iLine << " in file " << szFile;
@@ -36,6 +47,242 @@ inline bool check(int e, int iLine, const char *szFile) {
 
 #define ck(call) check(call, __LINE__, __FILE__)
 
+#if defined(DEMUXER_HAVE_IO_URING)
+// Asynchronous file readahead for the demuxer's AVIOContext
+// (--demuxReadAhead <depth>): the file is tiled into fixed-size chunks and
+// a ring of <depth> chunk reads is kept in flight through io_uring ahead
+// of the demux position. Sequential reads are then served from completed
+// chunks and each drained chunk is immediately resubmitted at the readahead
+// frontier, so with a cold page cache the kernel reads several megabytes of
+// compressed data ahead of the demuxer and the demux thread only blocks
+// when it catches up with the storage.
+class IoUringFileReader {
+public:
+    static const int64_t CHUNK_SIZE = 1024 * 1024;
+    static const int32_t MAX_QUEUE_DEPTH = 32;
+
+    IoUringFileReader()
+        : m_fd(-1)
+        , m_fileSize(0)
+        , m_readPos(0)
+        , m_nextSubmitPos(0)
+        , m_depth(0)
+        , m_ring()
+        , m_chunks() { }
+
+    ~IoUringFileReader()
+    {
+        Close();
+    }
+
+    bool Open(const char* pFilePath, int32_t depth)
+    {
+        m_fd = open(pFilePath, O_RDONLY);
+        if (m_fd < 0) {
+            return false;
+        }
+        struct stat fileStat;
+        if ((fstat(m_fd, &fileStat) != 0) || !S_ISREG(fileStat.st_mode)) {
+            close(m_fd);
+            m_fd = -1;
+            return false;
+        }
+        m_fileSize = fileStat.st_size;
+
+        m_depth = depth;
+        if (m_depth < 1) {
+            m_depth = 1;
+        } else if (m_depth > MAX_QUEUE_DEPTH) {
+            m_depth = MAX_QUEUE_DEPTH;
+        }
+        if (io_uring_queue_init(m_depth, &m_ring, 0) != 0) {
+            close(m_fd);
+            m_fd = -1;
+            return false;
+        }
+        m_chunks.resize(m_depth);
+        for (size_t c = 0; c < m_chunks.size(); c++) {
+            m_chunks[c].data.resize(CHUNK_SIZE);
+            m_chunks[c].fileOffset = -1;
+            m_chunks[c].length = 0;
+            m_chunks[c].inFlight = false;
+        }
+        RestartReadAhead(0);
+        return true;
+    }
+
+    // AVIOContext read callback: serve from the chunk covering the read
+    // position, waiting for its completion only if the readahead has not
+    // got there yet, and refill the pipeline as chunks are drained.
+    static int ReadPacket(void* opaque, uint8_t* pBuf, int nBuf)
+    {
+        IoUringFileReader* pReader = reinterpret_cast<IoUringFileReader*>(opaque);
+
+        if (pReader->m_readPos >= pReader->m_fileSize) {
+            return AVERROR_EOF;
+        }
+        int copiedSize = 0;
+        while ((copiedSize < nBuf) && (pReader->m_readPos < pReader->m_fileSize)) {
+            Chunk* pChunk = pReader->FindChunk(pReader->m_readPos);
+            if (pChunk == nullptr) {
+                // A seek moved the position outside the in-flight window -
+                // restart the pipeline at the containing chunk boundary.
+                pReader->RestartReadAhead(pReader->m_readPos);
+                pChunk = pReader->FindChunk(pReader->m_readPos);
+                if (pChunk == nullptr) {
+                    break;
+                }
+            }
+            if (pChunk->inFlight) {
+                pReader->WaitForChunk(pChunk);
+            }
+            const int64_t chunkPos = pReader->m_readPos - pChunk->fileOffset;
+            const int64_t availSize = pChunk->length - chunkPos;
+            if (availSize <= 0) {
+                // Short read - the storage returned less than requested.
+                break;
+            }
+            int64_t copySize = nBuf - copiedSize;
+            if (copySize > availSize) {
+                copySize = availSize;
+            }
+            memcpy(pBuf + copiedSize, pChunk->data.data() + chunkPos, copySize);
+            copiedSize += (int)copySize;
+            pReader->m_readPos += copySize;
+            if (pReader->m_readPos >= (pChunk->fileOffset + pChunk->length)) {
+                pReader->SubmitChunk(pChunk);
+            }
+        }
+        return (copiedSize > 0) ? copiedSize : AVERROR_EOF;
+    }
+
+    // AVIOContext seek callback. Only the position is updated here; the
+    // read callback restarts the readahead pipeline when the new position
+    // falls outside the in-flight window.
+    static int64_t SeekPacket(void* opaque, int64_t offset, int whence)
+    {
+        IoUringFileReader* pReader = reinterpret_cast<IoUringFileReader*>(opaque);
+
+        if (whence & AVSEEK_SIZE) {
+            return pReader->m_fileSize;
+        }
+        int64_t newPos = -1;
+        switch (whence & ~AVSEEK_FORCE) {
+        case SEEK_SET:
+            newPos = offset;
+            break;
+        case SEEK_CUR:
+            newPos = pReader->m_readPos + offset;
+            break;
+        case SEEK_END:
+            newPos = pReader->m_fileSize + offset;
+            break;
+        default:
+            return -1;
+        }
+        if (newPos < 0) {
+            return -1;
+        }
+        pReader->m_readPos = newPos;
+        return newPos;
+    }
+
+private:
+    struct Chunk {
+        std::vector<uint8_t> data;
+        int64_t fileOffset; // -1 when the chunk holds no data
+        int64_t length;
+        bool    inFlight;
+    };
+
+    Chunk* FindChunk(int64_t filePos)
+    {
+        for (size_t c = 0; c < m_chunks.size(); c++) {
+            if ((m_chunks[c].fileOffset >= 0) && (filePos >= m_chunks[c].fileOffset) &&
+                    (filePos < (m_chunks[c].fileOffset + CHUNK_SIZE))) {
+                return &m_chunks[c];
+            }
+        }
+        return nullptr;
+    }
+
+    // Queue the chunk's read at the readahead frontier, or park it when
+    // the frontier has reached the end of the file.
+    void SubmitChunk(Chunk* pChunk)
+    {
+        if (m_nextSubmitPos >= m_fileSize) {
+            pChunk->fileOffset = -1;
+            pChunk->length = 0;
+            return;
+        }
+        struct io_uring_sqe* pSqe = io_uring_get_sqe(&m_ring);
+        if (pSqe == nullptr) {
+            pChunk->fileOffset = -1;
+            pChunk->length = 0;
+            return;
+        }
+        pChunk->fileOffset = m_nextSubmitPos;
+        pChunk->length = 0;
+        pChunk->inFlight = true;
+        io_uring_prep_read(pSqe, m_fd, pChunk->data.data(), CHUNK_SIZE, m_nextSubmitPos);
+        io_uring_sqe_set_data(pSqe, (void*)(pChunk - m_chunks.data()));
+        m_nextSubmitPos += CHUNK_SIZE;
+        io_uring_submit(&m_ring);
+    }
+
+    // Reap completions until the given chunk's read has finished.
+    void WaitForChunk(const Chunk* pChunk)
+    {
+        while (pChunk->inFlight) {
+            struct io_uring_cqe* pCqe = nullptr;
+            if (io_uring_wait_cqe(&m_ring, &pCqe) != 0) {
+                break;
+            }
+            Chunk& completed = m_chunks[(size_t)io_uring_cqe_get_data(pCqe)];
+            completed.length = (pCqe->res > 0) ? pCqe->res : 0;
+            completed.inFlight = false;
+            io_uring_cqe_seen(&m_ring, pCqe);
+        }
+    }
+
+    void DrainInFlight()
+    {
+        for (size_t c = 0; c < m_chunks.size(); c++) {
+            WaitForChunk(&m_chunks[c]);
+        }
+    }
+
+    // Restart the readahead pipeline at the chunk boundary containing
+    // startPos, e.g. after a seek outside the in-flight window.
+    void RestartReadAhead(int64_t startPos)
+    {
+        DrainInFlight();
+        m_nextSubmitPos = startPos - (startPos % CHUNK_SIZE);
+        for (size_t c = 0; c < m_chunks.size(); c++) {
+            SubmitChunk(&m_chunks[c]);
+        }
+    }
+
+    void Close()
+    {
+        if (m_fd >= 0) {
+            DrainInFlight();
+            io_uring_queue_exit(&m_ring);
+            close(m_fd);
+            m_fd = -1;
+        }
+    }
+
+    int     m_fd;
+    int64_t m_fileSize;
+    int64_t m_readPos;       // the demuxer's current read position
+    int64_t m_nextSubmitPos; // the readahead frontier
+    int32_t m_depth;
+    struct io_uring m_ring;
+    std::vector<Chunk> m_chunks;
+};
+#endif // DEMUXER_HAVE_IO_URING
+
 class FFmpegDemuxer : public VideoStreamDemuxer {
 
 public:
@@ -69,6 +316,10 @@ private:
 
         //fmtc->streams[iVideoStream]->need_parsing = AVSTREAM_PARSE_NONE;
         videoCodec = fmtc->streams[videoStream]->codecpar->codec_id;
+        if (fastStartProbing && (videoCodec == AV_CODEC_ID_NONE)) {
+            LOG(WARNING) << "Fast-start probing could not identify the video codec";
+            return -1;
+        }
         codedWidth = fmtc->streams[videoStream]->codecpar->width;
         codedHeight = fmtc->streams[videoStream]->codecpar->height;
         format = (AVPixelFormat)fmtc->streams[videoStream]->codecpar->format;
@@ -147,6 +398,23 @@ private:
             ck(av_bsf_alloc(bsf, &bsfc));
             bsfc->par_in = fmtc->streams[videoStream]->codecpar;
             ck(av_bsf_init(bsfc));
+
+            // In-place annex-B fast path (see DemuxFrame()): when the
+            // container carries AVCC/HVCC length-prefixed NAL units with
+            // 4-byte length fields, converting a non-key packet only
+            // replaces each length field with a start code of the same
+            // size, so no new packet buffer is needed. The length field
+            // size comes from the avcC/hvcC configuration record.
+            const AVCodecParameters* codecpar = fmtc->streams[videoStream]->codecpar;
+            nalLengthSize = 0;
+            if (codecpar->extradata && (codecpar->extradata_size > 4) &&
+                    (codecpar->extradata[0] == 1)) {
+                if (videoCodec == AV_CODEC_ID_H264) {
+                    nalLengthSize = (codecpar->extradata[4] & 0x3) + 1;
+                } else if ((videoCodec == AV_CODEC_ID_HEVC) && (codecpar->extradata_size > 21)) {
+                    nalLengthSize = (codecpar->extradata[21] & 0x3) + 1;
+                }
+            }
         }
 
         if (fmtc->streams[videoStream]->codecpar->width == 0) {
@@ -189,7 +457,8 @@ private:
         return ctx;
     }
 
-    AVFormatContext *CreateFormatContext(const char *pFilePath, enum AVCodecID videoCodecId) {
+    AVFormatContext *CreateFormatContext(const char *pFilePath, enum AVCodecID videoCodecId,
+                                         int32_t readAheadDepth) {
         avformat_network_init();
 
         AVFormatContext *ctx = avformat_alloc_context();
@@ -197,18 +466,65 @@ private:
         if (videoCodecId != AV_CODEC_ID_NONE) {
             ctx->video_codec = avcodec_find_decoder(videoCodecId);
         }
+        if (fastStartProbing) {
+            // Fast-start mode: cap the amount of data avformat_open_input()
+            // and avformat_find_stream_info() may read before the first
+            // packet is demuxed. A transport stream probed with the default
+            // limits can spend hundreds of ms here; the Vulkan parser
+            // re-derives the real codec parameters from the first SPS
+            // anyway, so a shallow probe is sufficient for stream setup.
+            ctx->probesize = FAST_START_PROBE_SIZE;
+            ctx->max_analyze_duration = FAST_START_MAX_ANALYZE_DURATION;
+        }
+
+        // Asynchronous readahead (--demuxReadAhead): local files are read
+        // through our own AVIOContext instead of libavformat's synchronous
+        // file protocol. Network protocol URLs keep libavformat's own I/O.
+        if ((readAheadDepth > 0) && (strstr(pFilePath, "://") == NULL)) {
+#if defined(DEMUXER_HAVE_IO_URING)
+            readAheadReader = new IoUringFileReader();
+            if (readAheadReader->Open(pFilePath, readAheadDepth)) {
+                const int avioc_buffer_size = (int)IoUringFileReader::CHUNK_SIZE;
+                uint8_t* avioc_buffer = (uint8_t *)av_malloc(avioc_buffer_size);
+                if (avioc_buffer) {
+                    avioc = avio_alloc_context(avioc_buffer, avioc_buffer_size,
+                        0, readAheadReader, &IoUringFileReader::ReadPacket, NULL,
+                        &IoUringFileReader::SeekPacket);
+                }
+                if (avioc) {
+                    ctx->pb = avioc;
+                    ck(avformat_open_input(&ctx, NULL, NULL, NULL));
+                    return ctx;
+                }
+                if (avioc_buffer) {
+                    av_freep(&avioc_buffer);
+                }
+            }
+            // Could not set the readahead up (pipe, special file, io_uring
+            // unavailable at runtime) - fall back to synchronous I/O.
+            delete readAheadReader;
+            readAheadReader = nullptr;
+#else
+            LOG(WARNING) << "--demuxReadAhead requires an io_uring-enabled build (liburing) - using synchronous file I/O";
+#endif
+        }
+
         ck(avformat_open_input(&ctx, pFilePath, NULL, NULL));
         return ctx;
     }
 
     FFmpegDemuxer(const char *pFilePath,
-                  enum AVCodecID video_codec_id = AV_CODEC_ID_NONE /* Forced video codec_id */)
+                  enum AVCodecID video_codec_id = AV_CODEC_ID_NONE, /* Forced video codec_id */
+                  bool enableFastStartProbing = false,
+                  int32_t readAheadDepth = 0)
         : VideoStreamDemuxer(),
-          fmtc()
+          fastStartProbing(enableFastStartProbing)
+        , fmtc()
         , avioc()
         , pPkt()
         , pktFiltered()
         , bsfc()
+        , nalLengthSize()
         , videoStream()
         , isStreamDemuxer()
         , videoCodec()
@@ -227,7 +543,7 @@ private:
         , colorSpace()
         , chromaLocation()
         {
-            fmtc = CreateFormatContext(pFilePath, video_codec_id);
+            fmtc = CreateFormatContext(pFilePath, video_codec_id, readAheadDepth);
         }
 
     virtual ~FFmpegDemuxer() {
@@ -266,6 +582,13 @@ private:
              av_freep(&avioc->buffer);
              av_freep(&avioc);
          }
+
+#if defined(DEMUXER_HAVE_IO_URING)
+        if (readAheadReader) {
+            delete readAheadReader;
+            readAheadReader = nullptr;
+        }
+#endif
     }
 
 public:
@@ -275,6 +598,8 @@ public:
                            int32_t defaultWidth,
                            int32_t defaultHeight,
                            int32_t defaultBitDepth,
+                           bool enableFastStartProbing,
+                           int32_t ioReadAheadDepth,
                            VkSharedBaseObj<FFmpegDemuxer>& ffmpegDemuxer)
     {
         enum AVCodecID videoCodecId = AV_CODEC_ID_NONE;
@@ -287,12 +612,24 @@ public:
             }
         }
 
-        VkSharedBaseObj<FFmpegDemuxer> demuxer(new FFmpegDemuxer(pFilePath, videoCodecId));
+        VkSharedBaseObj<FFmpegDemuxer> demuxer(new FFmpegDemuxer(pFilePath, videoCodecId,
+                                                                 enableFastStartProbing,
+                                                                 ioReadAheadDepth));
 
         if (demuxer && (demuxer->Initialize() >= 0)) {
             ffmpegDemuxer = demuxer;
             return VK_SUCCESS;
         }
+
+        if (enableFastStartProbing) {
+            // The capped probe was not enough to identify the stream -
+            // retry with the default full stream analysis.
+            demuxer = new FFmpegDemuxer(pFilePath, videoCodecId, false, ioReadAheadDepth);
+            if (demuxer && (demuxer->Initialize() >= 0)) {
+                ffmpegDemuxer = demuxer;
+                return VK_SUCCESS;
+            }
+        }
         return VK_ERROR_INITIALIZATION_FAILED;
     }
 
@@ -420,7 +757,26 @@ public:
             return e;
         }
 
+        lastPacketIsKeyFrame = ((pPkt->flags & AV_PKT_FLAG_KEY) != 0);
+        if (pPkt->pts != AV_NOPTS_VALUE) {
+            const AVRational nanoSecondTimeBase = { 1, 1000000000 };
+            lastPacketPtsNs = av_rescale_q(pPkt->pts, fmtc->streams[videoStream]->time_base,
+                                           nanoSecondTimeBase);
+        } else {
+            lastPacketPtsNs = -1;
+        }
+
         if (isStreamDemuxer) {
+            // Fast path: non-key packets with 4-byte NAL length prefixes are
+            // converted to annex-B in place, reusing the packet's own buffer.
+            // Keyframes still go through the bitstream filter, which inserts
+            // the parameter sets from the extradata in front of them.
+            if ((nalLengthSize == 4) && !(pPkt->flags & AV_PKT_FLAG_KEY) &&
+                    (av_packet_make_writable(pPkt) >= 0) &&
+                    ConvertToAnnexBInPlace(pPkt)) {
+                *ppVideo = pPkt->data;
+                return pPkt->size;
+            }
             if (pktFiltered->data) {
                 av_packet_unref(pktFiltered);
             }
@@ -438,6 +794,39 @@ public:
         return -1;
     }
 
+    // Returns true when the packet is a clean sequence of 4-byte
+    // length-prefixed NAL units and rewrites the length prefixes to annex-B
+    // start codes in place (both are four bytes). The packet is validated
+    // before any byte is touched, so on failure the bitstream filter
+    // fallback still sees the original, unmodified packet.
+    static bool ConvertToAnnexBInPlace(AVPacket *pkt) {
+        uint8_t *data = pkt->data;
+        const uint32_t size = (pkt->size > 0) ? (uint32_t)pkt->size : 0;
+        uint32_t pos = 0;
+        while (pos + 4 <= size) {
+            const uint32_t naluSize = ((uint32_t)data[pos] << 24) | ((uint32_t)data[pos + 1] << 16) |
+                                      ((uint32_t)data[pos + 2] << 8) | (uint32_t)data[pos + 3];
+            if ((naluSize == 0) || (naluSize > (size - pos - 4))) {
+                return false;
+            }
+            pos += 4 + naluSize;
+        }
+        if ((pos != size) || (size == 0)) {
+            return false;
+        }
+        pos = 0;
+        while (pos < size) {
+            const uint32_t naluSize = ((uint32_t)data[pos] << 24) | ((uint32_t)data[pos + 1] << 16) |
+                                      ((uint32_t)data[pos + 2] << 8) | (uint32_t)data[pos + 3];
+            data[pos + 0] = 0;
+            data[pos + 1] = 0;
+            data[pos + 2] = 0;
+            data[pos + 3] = 1;
+            pos += 4 + naluSize;
+        }
+        return true;
+    }
+
     static int ReadPacket(void *opaque, uint8_t *pBuf, int nBuf) {
         return ((DataProvider *)opaque)->GetData(pBuf, nBuf);
     }
@@ -447,6 +836,40 @@ public:
         av_seek_frame(fmtc, videoStream, 0, isStreamDemuxer ? AVSEEK_FLAG_ANY : AVSEEK_FLAG_BYTE);
     }
 
+    // Seeks on the container's own keyframe index: AVSEEK_FLAG_BACKWARD
+    // selects the nearest keyframe at or before the requested time. For the
+    // stream-demuxed containers the bitstream filter re-inserts the parameter
+    // sets in front of the keyframe packet, so the parser resynchronizes at
+    // that IDR without having seen the skipped part of the stream.
+    virtual bool SeekToTimestamp(int64_t timestampNs)
+    {
+        if (!fmtc || (videoStream < 0)) {
+            return false;
+        }
+        const AVRational nanoSecondTimeBase = { 1, 1000000000 };
+        const int64_t seekTarget = av_rescale_q(timestampNs, nanoSecondTimeBase,
+                                                fmtc->streams[videoStream]->time_base);
+        if (av_seek_frame(fmtc, videoStream, seekTarget, AVSEEK_FLAG_BACKWARD) < 0) {
+            return false;
+        }
+        if (bsfc) {
+            av_bsf_flush(bsfc);
+        }
+        return true;
+    }
+
+    virtual int64_t GetStreamDurationNs() const
+    {
+        if (!fmtc || (fmtc->duration == AV_NOPTS_VALUE)) {
+            return -1;
+        }
+        return av_rescale(fmtc->duration, 1000000000, AV_TIME_BASE);
+    }
+
+    virtual int64_t GetLastPacketPtsNs() const { return lastPacketPtsNs; }
+
+    virtual bool IsLastPacketKeyFrame() const { return lastPacketIsKeyFrame; }
+
     virtual void DumpStreamParameters() const {
 
         std::cout << "Width: "    << codedWidth << std::endl;
@@ -552,13 +975,35 @@ public:
     }
 
 private:
+    // Probe caps applied in fast-start mode (see CreateFormatContext()):
+    // enough for the container header plus the first access units of a
+    // typical broadcast mux, while keeping the probe well under the
+    // channel-change latency budget.
+    static const int64_t FAST_START_PROBE_SIZE = 512 * 1024; // bytes
+    static const int64_t FAST_START_MAX_ANALYZE_DURATION = AV_TIME_BASE / 10; // 100 ms
+
+    // When set, the stream analysis of Initialize() runs with the capped
+    // probe limits above instead of the FFmpeg defaults.
+    bool fastStartProbing = false;
     AVFormatContext *fmtc = NULL;
     AVIOContext *avioc = NULL;
+#if defined(DEMUXER_HAVE_IO_URING)
+    // Backs avioc for local files when --demuxReadAhead is enabled.
+    IoUringFileReader *readAheadReader = NULL;
+#endif
     AVPacket *pPkt, *pktFiltered;
     AVBSFContext *bsfc = NULL;
+    // NAL unit length field size from the avcC/hvcC configuration record,
+    // or 0 when unknown. 4 enables the in-place annex-B conversion fast
+    // path of DemuxFrame().
+    int nalLengthSize = 0;
 
     int videoStream;
     bool isStreamDemuxer;
+    // pts (in nanoseconds) and keyframe flag of the last demuxed packet
+    // (see GetLastPacketPtsNs() / IsLastPacketKeyFrame()).
+    int64_t lastPacketPtsNs = -1;
+    bool lastPacketIsKeyFrame = false;
     AVCodecID videoCodec;
     int codedWidth, codedHeight, codedLumaBitDepth, codedChromaBitDepth;
 
@@ -594,21 +1039,28 @@ private:
 
 };
 
-VkResult FFmpegDemuxerCreate(const char *pFilePath,
-                             VkVideoCodecOperationFlagBitsKHR codecType,
-                             bool requiresStreamDemuxing,
-                             int32_t defaultWidth,
-                             int32_t defaultHeight,
-                             int32_t defaultBitDepth,
-                             VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer)
+// Container inputs and inputs of an unknown codec need the libavformat
+// probe. This registrar is the only path from the generic dispatch into the
+// FFmpeg libraries, so nothing of theirs is initialized for the inputs the
+// elementary-stream backends take.
+static bool FFmpegDemuxerProbe(const VideoStreamDemuxer::CreateParams& params)
+{
+    return params.requiresStreamDemuxing ||
+           (params.codecType == VK_VIDEO_CODEC_OPERATION_NONE_KHR);
+}
+
+static VkResult FFmpegDemuxerCreate(const VideoStreamDemuxer::CreateParams& params,
+                                    VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer)
 {
     VkSharedBaseObj<FFmpegDemuxer> ffmpegDemuxer;
-    VkResult result = FFmpegDemuxer::Create(pFilePath,
-                                            codecType,
-                                            requiresStreamDemuxing,
-                                            defaultWidth,
-                                            defaultHeight,
-                                            defaultBitDepth,
+    VkResult result = FFmpegDemuxer::Create(params.pFilePath,
+                                            params.codecType,
+                                            params.requiresStreamDemuxing,
+                                            params.defaultWidth,
+                                            params.defaultHeight,
+                                            params.defaultBitDepth,
+                                            params.enableFastStartProbing,
+                                            params.ioReadAheadDepth,
                                             ffmpegDemuxer);
     if (result == VK_SUCCESS) {
         videoStreamDemuxer = ffmpegDemuxer;
@@ -616,3 +1068,8 @@ VkResult FFmpegDemuxerCreate(const char *pFilePath,
 
     return result;
 }
+
+static const bool s_ffmpegDemuxerRegistered =
+        VideoStreamDemuxer::RegisterBackend("ffmpeg", 1,
+                                            FFmpegDemuxerProbe,
+                                            FFmpegDemuxerCreate);
@@ -0,0 +1,348 @@
+/*
+* Copyright 2023 NVIDIA Corporation.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "NvCodecUtils/NalStartCodeScanner.h"
+
+// Lightweight H.264 header scan for keyframe-index construction and stream
+// validation. The scanner reads only what picture boundary and reference
+// tracking need - NAL type and ref idc, first_mb_in_slice, frame_num,
+// pic_order_cnt_lsb and the IDR flag - plus the handful of SPS/PPS fields
+// those depend on, and stops right there: reference list modifications,
+// weighted prediction tables and everything entropy-coded stay untouched.
+// That makes a pass over a stream an order of magnitude cheaper than a full
+// parse, which is all the fast-seek scanning path needs.
+
+// Exp-Golomb/bit reader over one RBSP, removing the 00 00 03 emulation
+// prevention bytes on the fly.
+class H264RbspBitReader {
+public:
+    H264RbspBitReader(const uint8_t* pData, size_t size)
+        : m_pData(pData)
+        , m_size(size)
+        , m_bytePos(0)
+        , m_bitPos(0)
+        , m_numConsecutiveZeroBytes(0)
+        , m_overrun(false)
+    {
+    }
+
+    uint32_t u(uint32_t numBits)
+    {
+        uint32_t value = 0;
+        for (uint32_t bit = 0; bit < numBits; bit++) {
+            value = (value << 1) | ReadBit();
+        }
+        return value;
+    }
+
+    // ue(v) - unsigned Exp-Golomb.
+    uint32_t ue()
+    {
+        uint32_t leadingZeroBits = 0;
+        while (!m_overrun && (ReadBit() == 0)) {
+            if (++leadingZeroBits > 31) {
+                m_overrun = true;
+                return 0;
+            }
+        }
+        return ((1u << leadingZeroBits) - 1) + u(leadingZeroBits);
+    }
+
+    // se(v) - signed Exp-Golomb.
+    int32_t se()
+    {
+        const uint32_t codeNum = ue();
+        const int32_t value = (int32_t)((codeNum + 1) >> 1);
+        return (codeNum & 1) ? value : -value;
+    }
+
+    bool overrun() const { return m_overrun; }
+
+private:
+    uint32_t ReadBit()
+    {
+        if (m_bitPos == 0) {
+            // Drop the emulation prevention byte of a 00 00 03 sequence.
+            if ((m_numConsecutiveZeroBytes >= 2) &&
+                    (m_bytePos < m_size) && (m_pData[m_bytePos] == 3)) {
+                m_numConsecutiveZeroBytes = 0;
+                m_bytePos++;
+            }
+            if (m_bytePos >= m_size) {
+                m_overrun = true;
+                return 0;
+            }
+            m_numConsecutiveZeroBytes = (m_pData[m_bytePos] == 0) ?
+                                            (m_numConsecutiveZeroBytes + 1) : 0;
+        }
+        const uint32_t bit = (m_pData[m_bytePos] >> (7 - m_bitPos)) & 1;
+        m_bitPos++;
+        if (m_bitPos == 8) {
+            m_bitPos = 0;
+            m_bytePos++;
+        }
+        return bit;
+    }
+
+    const uint8_t* m_pData;
+    size_t         m_size;
+    size_t         m_bytePos;
+    uint32_t       m_bitPos;
+    uint32_t       m_numConsecutiveZeroBytes;
+    bool           m_overrun;
+};
+
+// What the scan extracts per slice NAL - exactly the DPB-only tracking set.
+struct H264NalScanInfo {
+    uint8_t  nalUnitType;
+    uint8_t  nalRefIdc;
+    bool     isIdr;           // nal_unit_type 5
+    bool     isReference;     // nal_ref_idc != 0
+    bool     startsNewPicture; // first_mb_in_slice == 0
+    uint32_t firstMbInSlice;
+    uint32_t sliceType;
+    uint32_t frameNum;
+    // pic_order_cnt_lsb, or -1 when the active SPS uses pic_order_cnt_type
+    // != 0 (the POC then follows frame_num, which is always filled in).
+    int32_t  picOrderCntLsb;
+};
+
+class H264HeaderScanner {
+public:
+    H264HeaderScanner()
+        : m_sps()
+        , m_pps()
+    {
+    }
+
+    // Examines one NAL unit (pNal points at the byte after the start code).
+    // SPS and PPS NALs update the scanner's parameter state and return
+    // false; slice NALs fill pInfo and return true. Anything else (SEI,
+    // AUD, filler) is skipped cheaply by NAL type alone.
+    bool ScanNalUnit(const uint8_t* pNal, size_t size, H264NalScanInfo* pInfo)
+    {
+        if ((size < 1) || ((pNal[0] & 0x80) != 0)) { // forbidden_zero_bit
+            return false;
+        }
+        const uint8_t nalRefIdc = (pNal[0] >> 5) & 0x3;
+        const uint8_t nalUnitType = pNal[0] & 0x1f;
+
+        switch (nalUnitType) {
+        case 7: // SPS
+            ParseSps(pNal + 1, size - 1);
+            return false;
+        case 8: // PPS
+            ParsePps(pNal + 1, size - 1);
+            return false;
+        case 1: // non-IDR slice
+        case 5: // IDR slice
+            return ParseSliceHeader(pNal + 1, size - 1, nalRefIdc, nalUnitType, pInfo);
+        default:
+            return false;
+        }
+    }
+
+    // Walks every NAL of an annex-B buffer with the vectorized start code
+    // scanner and hands the slice scan results to the callback; NALs that
+    // do not start a new picture are counted but not reported. Returns the
+    // number of NAL units visited.
+    template <typename PictureCallback>
+    size_t ScanAnnexBBuffer(const uint8_t* pData, size_t size, size_t baseOffset,
+                            PictureCallback&& pictureCallback)
+    {
+        size_t numNalUnits = 0;
+        int64_t startCode = FindNextAnnexBStartCode(pData, size, 0);
+        while (startCode >= 0) {
+            const size_t nalStart = (size_t)startCode + 3;
+            const int64_t nextStartCode = FindNextAnnexBStartCode(pData, size, nalStart);
+            // A 4-byte start code's leading zero belongs to the previous
+            // NAL's trailing zero bytes - harmless for header parsing.
+            const size_t nalEnd = (nextStartCode >= 0) ? (size_t)nextStartCode : size;
+
+            H264NalScanInfo info;
+            if (ScanNalUnit(pData + nalStart, nalEnd - nalStart, &info) &&
+                    info.startsNewPicture) {
+                pictureCallback(baseOffset + (size_t)startCode, info);
+            }
+            numNalUnits++;
+            startCode = nextStartCode;
+        }
+        return numNalUnits;
+    }
+
+private:
+    enum { MAX_SPS_IDS = 32, MAX_PPS_IDS = 256 };
+
+    // The SPS fields the slice header scan depends on.
+    struct ScanSps {
+        bool     valid;
+        uint32_t log2MaxFrameNum;
+        uint32_t picOrderCntType;
+        uint32_t log2MaxPicOrderCntLsb;
+        bool     frameMbsOnlyFlag;
+        bool     separateColourPlaneFlag;
+    };
+
+    struct ScanPps {
+        bool    valid;
+        uint8_t spsId;
+    };
+
+    static bool ProfileHasChromaInfo(uint32_t profileIdc)
+    {
+        switch (profileIdc) {
+        case 100: case 110: case 122: case 244: case 44:
+        case 83: case 86: case 118: case 128: case 138:
+        case 139: case 134: case 135:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    static void SkipScalingList(H264RbspBitReader& br, uint32_t sizeOfScalingList)
+    {
+        int32_t lastScale = 8;
+        int32_t nextScale = 8;
+        for (uint32_t j = 0; j < sizeOfScalingList; j++) {
+            if (nextScale != 0) {
+                nextScale = (lastScale + br.se() + 256) % 256;
+            }
+            lastScale = (nextScale == 0) ? lastScale : nextScale;
+        }
+    }
+
+    void ParseSps(const uint8_t* pRbsp, size_t size)
+    {
+        H264RbspBitReader br(pRbsp, size);
+        const uint32_t profileIdc = br.u(8);
+        br.u(8); // constraint flags + reserved
+        br.u(8); // level_idc
+        const uint32_t spsId = br.ue();
+        if (spsId >= MAX_SPS_IDS) {
+            return;
+        }
+
+        ScanSps sps = ScanSps();
+        if (ProfileHasChromaInfo(profileIdc)) {
+            const uint32_t chromaFormatIdc = br.ue();
+            if (chromaFormatIdc == 3) {
+                sps.separateColourPlaneFlag = (br.u(1) != 0);
+            }
+            br.ue(); // bit_depth_luma_minus8
+            br.ue(); // bit_depth_chroma_minus8
+            br.u(1); // qpprime_y_zero_transform_bypass_flag
+            if (br.u(1)) { // seq_scaling_matrix_present_flag
+                const uint32_t numScalingLists = (chromaFormatIdc != 3) ? 8 : 12;
+                for (uint32_t i = 0; i < numScalingLists; i++) {
+                    if (br.u(1)) {
+                        SkipScalingList(br, (i < 6) ? 16 : 64);
+                    }
+                }
+            }
+        }
+        sps.log2MaxFrameNum = br.ue() + 4;
+        sps.picOrderCntType = br.ue();
+        if (sps.picOrderCntType == 0) {
+            sps.log2MaxPicOrderCntLsb = br.ue() + 4;
+        } else if (sps.picOrderCntType == 1) {
+            br.u(1); // delta_pic_order_always_zero_flag
+            br.se(); // offset_for_non_ref_pic
+            br.se(); // offset_for_top_to_bottom_field
+            const uint32_t numRefFramesInPocCycle = br.ue();
+            for (uint32_t i = 0; (i < numRefFramesInPocCycle) && !br.overrun(); i++) {
+                br.se();
+            }
+        }
+        br.ue(); // max_num_ref_frames
+        br.u(1); // gaps_in_frame_num_value_allowed_flag
+        br.ue(); // pic_width_in_mbs_minus1
+        br.ue(); // pic_height_in_map_units_minus1
+        sps.frameMbsOnlyFlag = (br.u(1) != 0);
+
+        if ((sps.log2MaxFrameNum <= 16) && !br.overrun()) {
+            sps.valid = true;
+            m_sps[spsId] = sps;
+        }
+    }
+
+    void ParsePps(const uint8_t* pRbsp, size_t size)
+    {
+        H264RbspBitReader br(pRbsp, size);
+        const uint32_t ppsId = br.ue();
+        const uint32_t spsId = br.ue();
+        if ((ppsId >= MAX_PPS_IDS) || (spsId >= MAX_SPS_IDS) || br.overrun()) {
+            return;
+        }
+        m_pps[ppsId].valid = true;
+        m_pps[ppsId].spsId = (uint8_t)spsId;
+    }
+
+    bool ParseSliceHeader(const uint8_t* pRbsp, size_t size,
+                          uint8_t nalRefIdc, uint8_t nalUnitType,
+                          H264NalScanInfo* pInfo)
+    {
+        H264RbspBitReader br(pRbsp, size);
+        const uint32_t firstMbInSlice = br.ue();
+        const uint32_t sliceType = br.ue();
+        const uint32_t ppsId = br.ue();
+        if ((ppsId >= MAX_PPS_IDS) || !m_pps[ppsId].valid) {
+            return false;
+        }
+        const ScanSps& sps = m_sps[m_pps[ppsId].spsId];
+        if (!sps.valid) {
+            return false;
+        }
+        if (sps.separateColourPlaneFlag) {
+            br.u(2); // colour_plane_id
+        }
+        const uint32_t frameNum = br.u(sps.log2MaxFrameNum);
+        if (!sps.frameMbsOnlyFlag) {
+            if (br.u(1)) { // field_pic_flag
+                br.u(1);   // bottom_field_flag
+            }
+        }
+        if (nalUnitType == 5) {
+            br.ue(); // idr_pic_id
+        }
+        int32_t picOrderCntLsb = -1;
+        if (sps.picOrderCntType == 0) {
+            picOrderCntLsb = (int32_t)br.u(sps.log2MaxPicOrderCntLsb);
+        }
+        if (br.overrun()) {
+            return false;
+        }
+
+        pInfo->nalUnitType = nalUnitType;
+        pInfo->nalRefIdc = nalRefIdc;
+        pInfo->isIdr = (nalUnitType == 5);
+        pInfo->isReference = (nalRefIdc != 0);
+        pInfo->startsNewPicture = (firstMbInSlice == 0);
+        pInfo->firstMbInSlice = firstMbInSlice;
+        pInfo->sliceType = sliceType;
+        pInfo->frameNum = frameNum;
+        pInfo->picOrderCntLsb = picOrderCntLsb;
+        return true;
+    }
+
+    ScanSps m_sps[MAX_SPS_IDS];
+    ScanPps m_pps[MAX_PPS_IDS];
+};
@@ -20,7 +20,10 @@
 #include <fstream>
 #include <string>
 #include <sstream>
-#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <assert.h>
 #include <time.h>
 
 #ifndef _WIN32
@@ -40,16 +43,34 @@ enum LogLevel {
     FATAL
 };
 
+// The logger back-end is asynchronous: LOG() formats the record locally on
+// the calling thread and pushes the finished string into a fixed-size
+// lock-free multi-producer ring; a drain thread owned by the Logger does the
+// actual stream I/O and flushing. When the ring is full the record is
+// dropped and counted instead of blocking the caller, so logging can never
+// stall the decode or parse threads - the drain thread reports the number
+// of dropped records once the ring has space again.
 class Logger {
 public:
-    Logger(LogLevel level, bool bPrintTimeStamp) : level(level), bPrintTimeStamp(bPrintTimeStamp) {}
-    virtual ~Logger() {}
+    Logger(LogLevel level, bool bPrintTimeStamp)
+    : level(level), bPrintTimeStamp(bPrintTimeStamp)
+    , enqueuePos(0), dequeuePos(0), droppedRecords(0), shutdownWriter(false) {
+        for (uint32_t i = 0; i < RING_SIZE; i++) {
+            ring[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        writerThread = std::thread(&Logger::WriterThreadProc, this);
+    }
+    virtual ~Logger() {
+        // The derived class must call ShutdownLogWriter() from its own
+        // destructor, while the stream it owns is still alive.
+        assert(shutdownWriter.load());
+    }
     virtual std::ostream& GetStream() = 0;
     virtual void FlushStream() {}
     bool ShouldLogFor(LogLevel l) {
         return l >= level;
     }
-    char* GetLead(LogLevel l, const char *szFile, int nLine, const char *szFunc) {
+    const char* GetLead(LogLevel l, char szLead[80]) {
         if (l < TRACE || l > FATAL) {
             sprintf(szLead, "[?????] ");
             return szLead;
@@ -65,17 +86,98 @@ public:
         }
         return szLead;
     }
-    void EnterCriticalSection() {
-        mtx.lock();
+    // Hand a preformatted record over to the drain thread. Never blocks: if
+    // the ring is full the record is dropped and counted instead.
+    void SubmitRecord(std::string&& record) {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            RingEntry& entry = ring[pos & (RING_SIZE - 1)];
+            size_t seq = entry.sequence.load(std::memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1,
+                                                     std::memory_order_relaxed)) {
+                    entry.record = std::move(record);
+                    entry.sequence.store(pos + 1, std::memory_order_release);
+                    return;
+                }
+            } else if (dif < 0) {
+                // The ring is full - drop the record rather than block.
+                droppedRecords.fetch_add(1, std::memory_order_relaxed);
+                return;
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
     }
-    void LeaveCriticalSection() {
-        mtx.unlock();
+    // Wait until every record submitted so far has reached the stream.
+    // Only used on the FATAL path, right before the process exits.
+    void WaitForPendingRecords() {
+        while (dequeuePos.load(std::memory_order_acquire) <
+                   enqueuePos.load(std::memory_order_acquire)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+protected:
+    // Stop the drain thread after writing out whatever is still queued.
+    // Must be called from the destructor of the derived class, before the
+    // stream returned by GetStream() goes away.
+    void ShutdownLogWriter() {
+        if (!shutdownWriter.exchange(true)) {
+            writerThread.join();
+        }
     }
 private:
+    void WriterThreadProc() {
+        bool streamIsDirty = false;
+        for (;;) {
+            RingEntry& entry = ring[dequeuePos.load(std::memory_order_relaxed) & (RING_SIZE - 1)];
+            size_t pos = dequeuePos.load(std::memory_order_relaxed);
+            size_t seq = entry.sequence.load(std::memory_order_acquire);
+            if ((intptr_t)seq - (intptr_t)(pos + 1) == 0) {
+                GetStream() << entry.record;
+                entry.record.clear();
+                entry.sequence.store(pos + RING_SIZE, std::memory_order_release);
+                dequeuePos.store(pos + 1, std::memory_order_release);
+                streamIsDirty = true;
+                continue;
+            }
+            // The ring is empty: report any drops, flush and idle.
+            uint64_t numDropped = droppedRecords.exchange(0, std::memory_order_relaxed);
+            if (numDropped != 0) {
+                GetStream() << "[WARN ] Dropped " << numDropped
+                            << " log record(s) - the log ring was full!" << std::endl;
+                streamIsDirty = true;
+            }
+            if (streamIsDirty) {
+                GetStream().flush();
+                FlushStream();
+                streamIsDirty = false;
+            }
+            if (shutdownWriter.load(std::memory_order_acquire)) {
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
     LogLevel level;
-    char szLead[80];
     bool bPrintTimeStamp;
-    std::mutex mtx;
+
+    // Bounded lock-free multi-producer ring (single consumer - the drain
+    // thread). Each entry carries a sequence number that tells producers
+    // and the consumer whether the slot is theirs to use.
+    enum { RING_SIZE = 1024 }; // must be a power of two
+    struct RingEntry {
+        std::atomic<size_t> sequence;
+        std::string         record;
+    };
+    RingEntry ring[RING_SIZE];
+    std::atomic<size_t>   enqueuePos;
+    std::atomic<size_t>   dequeuePos;
+    std::atomic<uint64_t> droppedRecords;
+    std::atomic<bool>     shutdownWriter;
+    std::thread           writerThread;
 };
 
 class LoggerFactory {
@@ -100,6 +202,7 @@ private:
             pFileOut->open(strFilePath.c_str());
         }
         ~FileLogger() {
+            ShutdownLogWriter();
             pFileOut->close();
         }
         std::ostream& GetStream() {
@@ -113,6 +216,9 @@ private:
     public:
         ConsoleLogger(LogLevel level, bool bPrintTimeStamp)
         : Logger(level, bPrintTimeStamp) {}
+        ~ConsoleLogger() {
+            ShutdownLogWriter();
+        }
         std::ostream& GetStream() {
             return std::cout;
         }
@@ -130,8 +236,11 @@ public:
         if (!pLogger->ShouldLogFor(level)) {
             return;
         }
-        pLogger->EnterCriticalSection();
-        pLogger->GetStream() << pLogger->GetLead(level, szFile, nLine, szFunc);
+        // The whole record is formatted into the local stream below, so
+        // concurrent LOG() calls never contend with each other or with the
+        // stream I/O - only the finished string is handed to the logger.
+        char szLead[80];
+        ossRecord << pLogger->GetLead(level, szLead);
     }
     ~LogTransaction() {
         if (!pLogger) {
@@ -141,10 +250,12 @@ public:
         if (!pLogger->ShouldLogFor(level)) {
             return;
         }
-        pLogger->GetStream() << std::endl;
-        pLogger->FlushStream();
-        pLogger->LeaveCriticalSection();
+        ossRecord << "\n";
+        pLogger->SubmitRecord(ossRecord.str());
         if (level == FATAL) {
+            // Make sure the record actually reached the stream before
+            // taking the process down.
+            pLogger->WaitForPendingRecords();
             exit(1);
         }
     }
@@ -155,11 +266,12 @@ public:
         if (!pLogger->ShouldLogFor(level)) {
             return ossNull;
         }
-        return pLogger->GetStream();
+        return ossRecord;
     }
 private:
     Logger *pLogger;
     LogLevel level;
+    std::ostringstream ossRecord;
     std::ostringstream ossNull;
 };
 
@@ -0,0 +1,119 @@
+/*
+* Copyright 2023 NVIDIA Corporation.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__SSE2__) || (defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define NAL_SCANNER_USE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define NAL_SCANNER_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Vectorized annex-B NAL start code search. The 00 00 01 prefix is located
+// 16 bytes at a time by building a per-byte zero mask with SIMD compares,
+// AND-ing it with itself shifted by one byte position to find 00 00 pairs,
+// and only then checking the single candidate byte behind each pair for
+// 0x01 - byte-wise scanning is reserved for the few bytes of the tail.
+
+#if defined(NAL_SCANNER_USE_SSE2) || defined(NAL_SCANNER_USE_NEON)
+static inline int64_t FindNextAnnexBStartCodeScalar(const uint8_t* pData, size_t size, size_t offset)
+#else
+static inline int64_t FindNextAnnexBStartCode(const uint8_t* pData, size_t size, size_t offset)
+#endif
+{
+    if (size < 3) {
+        return -1;
+    }
+    for (size_t pos = offset; pos + 3 <= size; pos++) {
+        if ((pData[pos] == 0) && (pData[pos + 1] == 0) && (pData[pos + 2] == 1)) {
+            return (int64_t)pos;
+        }
+    }
+    return -1;
+}
+
+#if defined(NAL_SCANNER_USE_SSE2) || defined(NAL_SCANNER_USE_NEON)
+// Returns the offset of the first 00 00 01 start code prefix at or after
+// offset, or -1 when the remainder of the buffer does not contain one.
+static inline int64_t FindNextAnnexBStartCode(const uint8_t* pData, size_t size, size_t offset)
+{
+    size_t pos = offset;
+#if defined(NAL_SCANNER_USE_SSE2)
+    while (pos + 16 <= size) {
+        const __m128i block = _mm_loadu_si128((const __m128i*)(pData + pos));
+        const uint32_t zeroMask =
+            (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_setzero_si128()));
+        // Bit i set: a 00 00 pair starts at pos + i (i = 0..14).
+        uint32_t pairMask = zeroMask & (zeroMask >> 1);
+        while (pairMask != 0) {
+            const uint32_t i = (uint32_t)__builtin_ctz(pairMask);
+            if ((pos + i + 2 < size) && (pData[pos + i + 2] == 1)) {
+                return (int64_t)(pos + i);
+            }
+            pairMask &= (pairMask - 1);
+        }
+        // Overlap by one byte so a pair starting at the last block byte is
+        // seen as bit 0 of the next block.
+        pos += 15;
+    }
+#else // NAL_SCANNER_USE_NEON
+    while (pos + 16 <= size) {
+        const uint8x16_t block = vld1q_u8(pData + pos);
+        const uint8x16_t eqZero = vceqq_u8(block, vdupq_n_u8(0));
+        // Narrow the per-byte compare result to 4 bits per byte.
+        const uint64_t zeroMask = vget_lane_u64(vreinterpret_u64_u8(
+            vshrn_n_u16(vreinterpretq_u16_u8(eqZero), 4)), 0);
+        uint64_t pairMask = zeroMask & (zeroMask >> 4);
+        while (pairMask != 0) {
+            const uint32_t i = (uint32_t)(__builtin_ctzll(pairMask) >> 2);
+            if ((pos + i + 2 < size) && (pData[pos + i + 2] == 1)) {
+                return (int64_t)(pos + i);
+            }
+            pairMask &= ~(0xfull << (i * 4));
+        }
+        pos += 15;
+    }
+#endif
+    return FindNextAnnexBStartCodeScalar(pData, size, pos);
+}
+#endif // NAL_SCANNER_USE_SSE2 || NAL_SCANNER_USE_NEON
+
+// Returns the offset of the last 00 00 01 start code prefix that begins
+// before limit, or -1 when there is none. When the prefix is preceded by a
+// zero byte (a 4-byte 00 00 00 01 start code) the offset of that leading
+// zero is returned instead, so a buffer split at the returned offset keeps
+// the whole start code in the second part.
+static inline int64_t FindLastAnnexBStartCode(const uint8_t* pData, size_t size, size_t limit)
+{
+    if (limit > size) {
+        limit = size;
+    }
+    int64_t lastStartCode = -1;
+    int64_t nextStartCode = FindNextAnnexBStartCode(pData, limit, 0);
+    while ((nextStartCode >= 0) && ((size_t)nextStartCode < limit)) {
+        lastStartCode = nextStartCode;
+        nextStartCode = FindNextAnnexBStartCode(pData, limit, (size_t)nextStartCode + 3);
+    }
+    if ((lastStartCode > 0) && (pData[lastStartCode - 1] == 0)) {
+        lastStartCode--;
+    }
+    return lastStartCode;
+}
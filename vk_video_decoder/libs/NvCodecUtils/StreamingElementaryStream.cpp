@@ -0,0 +1,318 @@
+/*
+ * Copyright 2023 NVIDIA Corporation.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "NvCodecUtils/VideoStreamDemuxer.h"
+
+// Elementary-stream input from a non-seekable file descriptor (a socket or
+// stdin). A reader thread drains the descriptor into a fixed-size
+// single-producer/single-consumer ring buffer, so the stream is never
+// materialized on disk and the descriptor is read ahead of the parser. The
+// producer and the consumer synchronize on two atomic stream offsets only:
+// the reader blocks (backpressure) when the parser is a full ring behind,
+// and ReadBitstreamData() blocks while the ring is empty and the stream has
+// not ended yet.
+class StreamingElementaryStream : public VideoStreamDemuxer {
+
+public:
+    StreamingElementaryStream(int fd,
+                              bool closeFdOnDestroy,
+                              VkVideoCodecOperationFlagBitsKHR forceParserType,
+                              int32_t defaultWidth,
+                              int32_t defaultHeight,
+                              int32_t defaultBitDepth)
+        : VideoStreamDemuxer(),
+          m_width(defaultWidth)
+        , m_height(defaultHeight)
+        , m_bitDepth(defaultBitDepth)
+        , m_videoCodecType(forceParserType)
+        , m_fd(fd)
+        , m_closeFdOnDestroy(closeFdOnDestroy)
+        , m_ringBuffer(ringBufferSize)
+        , m_writeOffset(0)
+        , m_readOffset(0)
+        , m_streamEnded(false)
+        , m_exitReaderThread(false)
+        , m_readerThread() {
+    }
+
+    int32_t Initialize()
+    {
+        if (m_fd < 0) {
+            return -1;
+        }
+        m_readerThread = std::thread(&StreamingElementaryStream::ReaderThreadProc, this);
+        return m_readerThread.joinable() ? 0 : -1;
+    }
+
+    static VkResult Create(const char *pFilePath,
+                           VkVideoCodecOperationFlagBitsKHR codecType,
+                           int32_t defaultWidth,
+                           int32_t defaultHeight,
+                           int32_t defaultBitDepth,
+                           VkSharedBaseObj<StreamingElementaryStream>& streamingStream)
+    {
+        int fd = -1;
+        bool closeFdOnDestroy = false;
+        if (strcmp(pFilePath, "-") == 0) {
+            fd = 0; // stdin
+        } else if (strncmp(pFilePath, "fd://", 5) == 0) {
+            // An already connected descriptor (an RTP/TCP feed socket)
+            // inherited from the launching process.
+            fd = atoi(pFilePath + 5);
+            closeFdOnDestroy = true;
+        }
+
+        VkSharedBaseObj<StreamingElementaryStream> newStreamingStream(
+                new StreamingElementaryStream(fd, closeFdOnDestroy, codecType,
+                                              defaultWidth,
+                                              defaultHeight,
+                                              defaultBitDepth));
+
+        if ((newStreamingStream) && (newStreamingStream->Initialize() >= 0)) {
+            streamingStream = newStreamingStream;
+            return VK_SUCCESS;
+        }
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    virtual ~StreamingElementaryStream()
+    {
+        m_exitReaderThread = true;
+        if (m_readerThread.joinable()) {
+            m_readerThread.join();
+        }
+        if (m_closeFdOnDestroy && (m_fd >= 0)) {
+#if defined(_WIN32)
+            _close(m_fd);
+#else
+            close(m_fd);
+#endif
+        }
+    }
+
+    virtual bool IsStreamDemuxerEnabled() const { return false; }
+    virtual bool HasFramePreparser() const { return false; }
+
+    virtual void Rewind()
+    {
+        // A socket or a pipe cannot be rewound. The next ReadBitstreamData()
+        // call reports end-of-stream, so looped playback terminates cleanly.
+        printf("WARNING: a streaming input cannot be rewound - ignoring the stream restart.\n");
+    }
+
+    virtual VkVideoCodecOperationFlagBitsKHR GetVideoCodec() const { return m_videoCodecType; }
+
+    virtual VkVideoComponentBitDepthFlagsKHR GetLumaBitDepth() const
+    {
+        switch (m_bitDepth) {
+        case 8:
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_8_BIT_KHR;
+            break;
+        case 10:
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_10_BIT_KHR;
+            break;
+        case 12:
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_12_BIT_KHR;
+            break;
+        default:
+            assert(!"Unknown Luma Bit Depth!");
+        }
+        assert(!"Unknown Luma Bit Depth!");
+        return VK_VIDEO_COMPONENT_BIT_DEPTH_INVALID_KHR;
+    }
+
+    virtual VkVideoChromaSubsamplingFlagsKHR GetChromaSubsampling() const
+    {
+        return VK_VIDEO_CHROMA_SUBSAMPLING_420_BIT_KHR;
+    }
+
+    virtual VkVideoComponentBitDepthFlagsKHR GetChromaBitDepth() const
+    {
+        switch (m_bitDepth) {
+        case 8:
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_8_BIT_KHR;
+            break;
+        case 10:
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_10_BIT_KHR;
+            break;
+        case 12:
+            return VK_VIDEO_COMPONENT_BIT_DEPTH_12_BIT_KHR;
+            break;
+        default:
+            assert(!"Unknown Chroma Bit Depth!");
+        }
+        assert(!"Unknown Chroma Bit Depth!");
+        return VK_VIDEO_COMPONENT_BIT_DEPTH_INVALID_KHR;
+    }
+
+    virtual uint32_t GetProfileIdc() const
+    {
+        return STD_VIDEO_H264_PROFILE_IDC_MAIN;
+    }
+
+    virtual int32_t GetWidth() const { return m_width; }
+    virtual int32_t GetHeight() const { return m_height; }
+    virtual int32_t GetBitDepth() const { return m_bitDepth; }
+
+    virtual int64_t DemuxFrame(const uint8_t **ppVideo)
+    {
+        return -1;
+    }
+
+    virtual int64_t ReadBitstreamData(const uint8_t **ppVideo, int64_t offset)
+    {
+        assert(offset >= 0);
+
+        if ((uint64_t)offset < m_readOffset.load(std::memory_order_relaxed)) {
+            // The data before the released offset has already been recycled
+            // by the reader thread - the caller tried to seek backwards.
+            *ppVideo = nullptr;
+            return 0;
+        }
+
+        // Everything before offset has been consumed by the parser - release
+        // it, unblocking the reader thread.
+        m_readOffset.store((uint64_t)offset, std::memory_order_release);
+
+        // Wait for the reader thread to produce data past the offset.
+        uint64_t writeOffset = m_writeOffset.load(std::memory_order_acquire);
+        while ((writeOffset <= (uint64_t)offset) && !m_streamEnded.load(std::memory_order_acquire)) {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            writeOffset = m_writeOffset.load(std::memory_order_acquire);
+        }
+
+        if (writeOffset <= (uint64_t)offset) {
+            // End of the stream and no more buffered data.
+            *ppVideo = nullptr;
+            return 0;
+        }
+
+        // Return the contiguous span starting at offset - at most up to the
+        // end of the ring storage; the caller comes back with an advanced
+        // offset for the wrapped-around remainder. The span stays valid
+        // until the next ReadBitstreamData() call releases it.
+        const uint64_t available = writeOffset - (uint64_t)offset;
+        const uint64_t contiguous = ringBufferSize - ((uint64_t)offset & (ringBufferSize - 1));
+        const uint64_t chunkSize = std::min(available, contiguous);
+
+        *ppVideo = &m_ringBuffer[(uint64_t)offset & (ringBufferSize - 1)];
+        return (int64_t)chunkSize;
+    }
+
+    virtual void DumpStreamParameters() const {
+    }
+
+private:
+    void ReaderThreadProc()
+    {
+        while (!m_exitReaderThread.load(std::memory_order_relaxed)) {
+
+            const uint64_t writeOffset = m_writeOffset.load(std::memory_order_relaxed);
+            const uint64_t readOffset  = m_readOffset.load(std::memory_order_acquire);
+            const uint64_t freeSpace   = ringBufferSize - (writeOffset - readOffset);
+
+            if (freeSpace == 0) {
+                // Backpressure: the parser is a full ring behind.
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+                continue;
+            }
+
+            // Fill at most up to the end of the ring storage in one read.
+            const uint64_t contiguous = ringBufferSize - (writeOffset & (ringBufferSize - 1));
+            const size_t maxReadSize = (size_t)std::min(freeSpace, contiguous);
+
+#if defined(_WIN32)
+            const int bytesRead = _read(m_fd, &m_ringBuffer[writeOffset & (ringBufferSize - 1)],
+                                        (unsigned int)maxReadSize);
+#else
+            const ssize_t bytesRead = read(m_fd, &m_ringBuffer[writeOffset & (ringBufferSize - 1)],
+                                           maxReadSize);
+#endif
+            if (bytesRead <= 0) {
+                // End of the stream (or a read error - either way no more
+                // data is coming).
+                break;
+            }
+
+            m_writeOffset.store(writeOffset + (uint64_t)bytesRead, std::memory_order_release);
+        }
+
+        m_streamEnded.store(true, std::memory_order_release);
+    }
+
+    // Must be a power of two - the ring offsets are masked, not wrapped.
+    static const uint64_t ringBufferSize = 8 * 1024 * 1024;
+
+    int32_t    m_width, m_height, m_bitDepth;
+    VkVideoCodecOperationFlagBitsKHR m_videoCodecType;
+    int        m_fd;
+    bool       m_closeFdOnDestroy;
+    std::vector<uint8_t>  m_ringBuffer;
+    std::atomic<uint64_t> m_writeOffset; // absolute stream offset of the ring head (reader thread)
+    std::atomic<uint64_t> m_readOffset;  // absolute stream offset released by the parser
+    std::atomic<bool>     m_streamEnded;
+    std::atomic<bool>     m_exitReaderThread;
+    std::thread           m_readerThread;
+};
+
+bool VideoStreamDemuxer::IsStreamingInput(const char* pFilePath)
+{
+    return (pFilePath != nullptr) &&
+           ((strcmp(pFilePath, "-") == 0) || (strncmp(pFilePath, "fd://", 5) == 0));
+}
+
+// A socket or stdin cannot be mmapped or seeked - only this backend can
+// consume it, so it is probed ahead of the file-based ones. The codec type
+// must be provided, since an elementary stream carries no container metadata.
+static bool StreamingElementaryStreamProbe(const VideoStreamDemuxer::CreateParams& params)
+{
+    return VideoStreamDemuxer::IsStreamingInput(params.pFilePath);
+}
+
+static VkResult StreamingElementaryStreamCreate(const VideoStreamDemuxer::CreateParams& params,
+                                                VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer)
+{
+    VkSharedBaseObj<StreamingElementaryStream> streamingStream;
+    VkResult result = StreamingElementaryStream::Create(params.pFilePath,
+                                                        params.codecType,
+                                                        params.defaultWidth,
+                                                        params.defaultHeight,
+                                                        params.defaultBitDepth,
+                                                        streamingStream);
+    if (result == VK_SUCCESS) {
+        videoStreamDemuxer = streamingStream;
+    }
+
+    return result;
+}
+
+static const bool s_streamingElementaryStreamRegistered =
+        VideoStreamDemuxer::RegisterBackend("streamingElementaryStream", 2,
+                                            StreamingElementaryStreamProbe,
+                                            StreamingElementaryStreamCreate);
@@ -0,0 +1,136 @@
+/*
+* Copyright 2023 NVIDIA Corporation.  All rights reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(__SSE2__) || (defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2)))
+#define TEN_BIT_PACKER_USE_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define TEN_BIT_PACKER_USE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Vectorized 10-bit sample conversions for the P010/P016 readback path
+// (see VulkanVideoProcessor::OutputFrameToFile()). The decoder's 10/12-bit
+// surfaces read back as 16-bit words with the sample MSB-aligned; these
+// kernels either normalize such words to canonical P010 (the 6 LSBs
+// zeroed) or pack the top 10 bits tightly - 4 samples per 40-bit
+// little-endian group, sample N at bit 10*N - cutting the bytes written to
+// disk for 10-bit content by 3/8.
+
+// Normalizes MSB-aligned 16-bit samples to canonical P010 in place by
+// clearing the 6 fractional LSBs, so downstream comparisons see identical
+// words regardless of how the driver filled the low bits.
+static inline void ConvertMsb16SamplesToP010(uint16_t* pSamples, size_t numSamples)
+{
+    size_t sampleIndx = 0;
+#if defined(TEN_BIT_PACKER_USE_SSE2)
+    const __m128i p010Mask = _mm_set1_epi16((short)0xFFC0);
+    while (sampleIndx + 8 <= numSamples) {
+        const __m128i block = _mm_loadu_si128((const __m128i*)(pSamples + sampleIndx));
+        _mm_storeu_si128((__m128i*)(pSamples + sampleIndx), _mm_and_si128(block, p010Mask));
+        sampleIndx += 8;
+    }
+#elif defined(TEN_BIT_PACKER_USE_NEON)
+    const uint16x8_t p010Mask = vdupq_n_u16(0xFFC0);
+    while (sampleIndx + 8 <= numSamples) {
+        const uint16x8_t block = vld1q_u16(pSamples + sampleIndx);
+        vst1q_u16(pSamples + sampleIndx, vandq_u16(block, p010Mask));
+        sampleIndx += 8;
+    }
+#endif
+    for (; sampleIndx < numSamples; sampleIndx++) {
+        pSamples[sampleIndx] = (uint16_t)(pSamples[sampleIndx] & 0xFFC0);
+    }
+}
+
+// Writes one 40-bit packed group of 4 samples byte by byte, so the layout
+// is little-endian on every host.
+static inline uint8_t* TenBitPackerWriteGroup(uint8_t* pDst, uint64_t packedGroup)
+{
+    pDst[0] = (uint8_t)(packedGroup);
+    pDst[1] = (uint8_t)(packedGroup >> 8);
+    pDst[2] = (uint8_t)(packedGroup >> 16);
+    pDst[3] = (uint8_t)(packedGroup >> 24);
+    pDst[4] = (uint8_t)(packedGroup >> 32);
+    return pDst + 5;
+}
+
+// Packs the top 10 bits of MSB-aligned 16-bit samples into the tight
+// 40-bit-per-4-samples layout described above and returns the packed size
+// in bytes. A trailing partial group is padded with zero samples, so the
+// output is always ((numSamples + 3) / 4) * 5 bytes. In-place operation
+// (pDst aliasing pSrc) is safe: every group is read into registers before
+// its shorter packed form is written, and the writer never passes the
+// reader.
+static inline size_t PackMsb16SamplesTo10Bit(const uint16_t* pSrc, size_t numSamples, uint8_t* pDst)
+{
+    uint8_t* pDstStart = pDst;
+    size_t sampleIndx = 0;
+#if defined(TEN_BIT_PACKER_USE_SSE2)
+    // 8 samples per iteration: shift the samples down to their 10 bits,
+    // then merge the sample pairs into 20-bit words with one
+    // multiply-accumulate - lane i becomes s(2i) + (s(2i+1) << 10) - and
+    // combine two such words per 40-bit group.
+    const __m128i pairCoefficients = _mm_set1_epi32(0x04000001);
+    while (sampleIndx + 8 <= numSamples) {
+        const __m128i block = _mm_loadu_si128((const __m128i*)(pSrc + sampleIndx));
+        const __m128i msb10 = _mm_srli_epi16(block, 6);
+        const __m128i pairs20 = _mm_madd_epi16(msb10, pairCoefficients);
+        uint32_t pairValues[4];
+        _mm_storeu_si128((__m128i*)pairValues, pairs20);
+        pDst = TenBitPackerWriteGroup(pDst, (uint64_t)pairValues[0] | ((uint64_t)pairValues[1] << 20));
+        pDst = TenBitPackerWriteGroup(pDst, (uint64_t)pairValues[2] | ((uint64_t)pairValues[3] << 20));
+        sampleIndx += 8;
+    }
+#elif defined(TEN_BIT_PACKER_USE_NEON)
+    while (sampleIndx + 8 <= numSamples) {
+        const uint16x8_t block = vld1q_u16(pSrc + sampleIndx);
+        const uint16x8_t msb10 = vshrq_n_u16(block, 6);
+        // Split the even and odd samples, then widen the pairs to the
+        // 20-bit words s(2i) + (s(2i+1) << 10) with one widening
+        // multiply-accumulate.
+        const uint16x8x2_t parts = vuzpq_u16(msb10, msb10);
+        const uint32x4_t pairs20 = vmlal_n_u16(vmovl_u16(vget_low_u16(parts.val[0])),
+                                               vget_low_u16(parts.val[1]), 1024);
+        uint32_t pairValues[4];
+        vst1q_u32(pairValues, pairs20);
+        pDst = TenBitPackerWriteGroup(pDst, (uint64_t)pairValues[0] | ((uint64_t)pairValues[1] << 20));
+        pDst = TenBitPackerWriteGroup(pDst, (uint64_t)pairValues[2] | ((uint64_t)pairValues[3] << 20));
+        sampleIndx += 8;
+    }
+#endif
+    while (sampleIndx + 4 <= numSamples) {
+        const uint64_t packedGroup = ((uint64_t)(pSrc[sampleIndx] >> 6)) |
+                                     ((uint64_t)(pSrc[sampleIndx + 1] >> 6) << 10) |
+                                     ((uint64_t)(pSrc[sampleIndx + 2] >> 6) << 20) |
+                                     ((uint64_t)(pSrc[sampleIndx + 3] >> 6) << 30);
+        pDst = TenBitPackerWriteGroup(pDst, packedGroup);
+        sampleIndx += 4;
+    }
+    if (sampleIndx < numSamples) {
+        uint64_t packedGroup = 0;
+        for (uint32_t tailIndx = 0; sampleIndx < numSamples; sampleIndx++, tailIndx++) {
+            packedGroup |= ((uint64_t)(pSrc[sampleIndx] >> 6) << (10 * tailIndx));
+        }
+        pDst = TenBitPackerWriteGroup(pDst, packedGroup);
+    }
+    return (size_t)(pDst - pDstStart);
+}
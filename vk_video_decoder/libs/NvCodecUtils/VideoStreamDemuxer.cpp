@@ -14,22 +14,45 @@
 * limitations under the License.
 */
 
+#include <assert.h>
+#include <stdio.h>
+
 #include "NvCodecUtils/VideoStreamDemuxer.h"
 
-VkResult FFmpegDemuxerCreate(const char *pFilePath,
-                             VkVideoCodecOperationFlagBitsKHR codecType,
-                             bool requiresStreamDemuxing,
-                             int32_t defaultWidth,
-                             int32_t defaultHeight,
-                             int32_t defaultBitDepth,
-                             VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer);
-
-VkResult ElementaryStreamCreate(const char *pFilePath,
-                                VkVideoCodecOperationFlagBitsKHR codecType,
-                                int32_t defaultWidth,
-                                int32_t defaultHeight,
-                                int32_t defaultBitDepth,
-                                VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer);
+// The backend registry (see VideoStreamDemuxer::RegisterBackend()). The
+// storage is zero-initialized POD, so the backends' static registrars can
+// run in any order relative to this translation unit's initialization.
+struct DemuxerBackendEntry {
+    const char*                         name;
+    int32_t                             priority;
+    VideoStreamDemuxer::BackendProbeFn  probe;
+    VideoStreamDemuxer::BackendCreateFn create;
+};
+
+static const uint32_t maxDemuxerBackends = 8;
+static DemuxerBackendEntry s_demuxerBackends[maxDemuxerBackends];
+static uint32_t s_numDemuxerBackends;
+
+bool VideoStreamDemuxer::RegisterBackend(const char* name, int32_t priority,
+                                         BackendProbeFn probe, BackendCreateFn create)
+{
+    assert((name != nullptr) && (probe != nullptr) && (create != nullptr));
+    if (s_numDemuxerBackends >= maxDemuxerBackends) {
+        assert(!"Too many demuxer backends");
+        return false;
+    }
+
+    // Insertion sort by descending priority - the registry is tiny and only
+    // written during static initialization.
+    uint32_t entry = s_numDemuxerBackends;
+    while ((entry > 0) && (s_demuxerBackends[entry - 1].priority < priority)) {
+        s_demuxerBackends[entry] = s_demuxerBackends[entry - 1];
+        entry--;
+    }
+    s_demuxerBackends[entry] = DemuxerBackendEntry{ name, priority, probe, create };
+    s_numDemuxerBackends++;
+    return true;
+}
 
 VkResult VideoStreamDemuxer::Create(const char *pFilePath,
                                     VkVideoCodecOperationFlagBitsKHR codecType,
@@ -37,25 +60,31 @@ VkResult VideoStreamDemuxer::Create(const char *pFilePath,
                                     int32_t defaultWidth,
                                     int32_t defaultHeight,
                                     int32_t defaultBitDepth,
+                                    bool enableFastStartProbing,
+                                    int32_t ioReadAheadDepth,
+                                    size_t esChunkSize,
+                                    size_t esReadAheadSize,
                                     VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer)
 {
-    if (requiresStreamDemuxing || (codecType == VK_VIDEO_CODEC_OPERATION_NONE_KHR)) {
-        return FFmpegDemuxerCreate(pFilePath,
-                                   codecType,
-                                   requiresStreamDemuxing,
-                                   defaultWidth,
-                                   defaultHeight,
-                                   defaultBitDepth,
-                                   videoStreamDemuxer);
-    }  else {
-        return ElementaryStreamCreate(pFilePath,
-                                      codecType,
-                                      defaultWidth,
-                                      defaultHeight,
-                                      defaultBitDepth,
-                                      videoStreamDemuxer);
-    }
-}
-
+    const CreateParams params = { pFilePath,
+                                  codecType,
+                                  requiresStreamDemuxing,
+                                  defaultWidth,
+                                  defaultHeight,
+                                  defaultBitDepth,
+                                  enableFastStartProbing,
+                                  ioReadAheadDepth,
+                                  esChunkSize,
+                                  esReadAheadSize };
 
+    for (uint32_t entry = 0; entry < s_numDemuxerBackends; entry++) {
+        if (s_demuxerBackends[entry].probe(params)) {
+            return s_demuxerBackends[entry].create(params, videoStreamDemuxer);
+        }
+    }
 
+    assert(!"No demuxer backend accepted the input");
+    fprintf(stderr, "\nERROR: no demuxer backend accepted the input %s\n",
+            (pFilePath != nullptr) ? pFilePath : "(null)");
+    return VK_ERROR_INITIALIZATION_FAILED;
+}
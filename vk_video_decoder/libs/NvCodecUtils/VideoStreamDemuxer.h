@@ -19,6 +19,7 @@
 #include <atomic>
 #include <vulkan_interfaces.h>
 #include "VkVideoCore/VkVideoRefCountBase.h"
+#include "vkvideo_parser/VulkanBitstreamBuffer.h"
 
 class VideoStreamDemuxer : public VkVideoRefCountBase {
 
@@ -26,14 +27,74 @@ class VideoStreamDemuxer : public VkVideoRefCountBase {
 
 public:
 
+    // enableFastStartProbing caps the container probing of the FFmpeg-based
+    // demuxer (probe size and analysis duration) so the first packet comes
+    // out quickly; codec parameters the capped probe could not determine
+    // fall back to the defaults below until the parser derives the real
+    // ones from the first SPS. When even the capped probe cannot identify
+    // the stream, the demuxer retries with the default full analysis.
+    //
+    // ioReadAheadDepth > 0 makes the FFmpeg-based demuxer read local files
+    // through its own asynchronous I/O context with that many read chunks
+    // in flight ahead of the demux position (io_uring-backed when built
+    // with liburing), so cold-cache read stalls do not block the demux
+    // thread; 0 keeps libavformat's synchronous file I/O.
+    //
+    // esChunkSize and esReadAheadSize (both in bytes) apply to the mmap-based
+    // elementary stream demuxer only: esChunkSize caps the span a single
+    // ReadBitstreamData() call hands to the parser (0 keeps the built-in
+    // default) and esReadAheadSize is the madvise(WILLNEED) prefetch distance
+    // kept ahead of the parse cursor, so cold page faults are serviced by
+    // kernel readahead instead of on the parse thread; 0 disables the
+    // prefetch.
     static VkResult Create(const char *pFilePath,
                            VkVideoCodecOperationFlagBitsKHR codecType = VK_VIDEO_CODEC_OPERATION_NONE_KHR,
                            bool requiresStreamDemuxing = true,
                            int32_t defaultWidth = 1920,
                            int32_t defaultHeight = 1080,
                            int32_t defaultBitDepth = 12,
+                           bool enableFastStartProbing = false,
+                           int32_t ioReadAheadDepth = 0,
+                           size_t esChunkSize = 0,
+                           size_t esReadAheadSize = 0,
                            VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer = invalidDemuxer);
 
+    // Returns true when pFilePath designates a non-seekable streaming input -
+    // "-" for stdin or "fd://<n>" for an inherited socket/pipe descriptor -
+    // consumed by the StreamingElementaryStream demuxer instead of a file.
+    static bool IsStreamingInput(const char* pFilePath);
+
+    // Backend self-registration: each demuxer backend registers a probe and
+    // a factory from its own translation unit (see RegisterBackend()), and
+    // Create() dispatches to the highest-priority backend whose probe
+    // accepts the input. The generic dispatch therefore references no
+    // backend directly - in particular, nothing touches the FFmpeg
+    // libraries unless the container backend is actually selected, so raw
+    // elementary-stream jobs never pay their initialization.
+    struct CreateParams {
+        const char*                      pFilePath;
+        VkVideoCodecOperationFlagBitsKHR codecType;
+        bool                             requiresStreamDemuxing;
+        int32_t                          defaultWidth;
+        int32_t                          defaultHeight;
+        int32_t                          defaultBitDepth;
+        bool                             enableFastStartProbing;
+        int32_t                          ioReadAheadDepth;
+        size_t                           esChunkSize;
+        size_t                           esReadAheadSize;
+    };
+
+    typedef bool (*BackendProbeFn)(const CreateParams& params);
+    typedef VkResult (*BackendCreateFn)(const CreateParams& params,
+                                        VkSharedBaseObj<VideoStreamDemuxer>& videoStreamDemuxer);
+
+    // Registers a demuxer backend; a higher priority is probed first. Called
+    // from the backends' static registrars; the registry is zero-initialized
+    // POD storage, so the registration order across translation units does
+    // not matter. Returns true so a registrar can be a static initializer.
+    static bool RegisterBackend(const char* name, int32_t priority,
+                                BackendProbeFn probe, BackendCreateFn create);
+
     virtual int32_t AddRef()
     {
         return ++m_refCount;
@@ -62,9 +123,61 @@ public:
     virtual bool IsStreamDemuxerEnabled() const = 0;
     virtual bool HasFramePreparser() const = 0;
     virtual int64_t DemuxFrame(const uint8_t **ppVideo) = 0;
+
+    // Demuxes the next frame directly into a persistently mapped, host-visible
+    // bitstream buffer at dstOffset, growing the buffer if required. On success,
+    // *ppVideo points at the mapped location of the demuxed data inside dstBuffer,
+    // so the data can be handed to the parser without an intermediate host bounce
+    // buffer. For AVPacket-based demuxers this is the minimal single copy, because
+    // the demuxer library owns the packet allocation.
+    virtual int64_t DemuxFrameIntoBuffer(VkSharedBaseObj<VulkanBitstreamBuffer>& dstBuffer,
+                                         size_t dstOffset, const uint8_t **ppVideo)
+    {
+        const uint8_t* pVideo = nullptr;
+        int64_t frameSize = DemuxFrame(&pVideo);
+        if ((frameSize <= 0) || (pVideo == nullptr)) {
+            return frameSize;
+        }
+
+        if ((dstOffset + (size_t)frameSize) > dstBuffer->GetMaxSize()) {
+            dstBuffer->Resize(dstOffset + (size_t)frameSize);
+        }
+
+        int64_t copiedSize = dstBuffer->CopyDataFromBuffer(pVideo, 0, dstOffset, (size_t)frameSize);
+        if (copiedSize < frameSize) {
+            return -1;
+        }
+
+        size_t maxSize = 0;
+        *ppVideo = dstBuffer->GetReadOnlyDataPtr(dstOffset, maxSize);
+        assert(maxSize >= (size_t)frameSize);
+        return frameSize;
+    }
+
     virtual int64_t ReadBitstreamData(const uint8_t **ppVideo, int64_t offset) = 0;
     virtual void Rewind() = 0;
 
+    // Positions the demuxer at the nearest keyframe at or before the given
+    // presentation time (in nanoseconds), so decode can resynchronize at that
+    // IDR instead of parsing the whole stream up to it. Returns false when
+    // the demuxer has no index to seek with (elementary streams, streaming
+    // inputs); the read position is then left unchanged.
+    virtual bool SeekToTimestamp(int64_t timestampNs) { (void)timestampNs; return false; }
+
+    // Total stream duration in nanoseconds as reported by the container,
+    // or -1 when it is unknown (elementary streams, streaming inputs).
+    virtual int64_t GetStreamDurationNs() const { return -1; }
+
+    // Presentation timestamp in nanoseconds of the frame most recently
+    // returned by DemuxFrame(), or -1 when the container does not provide
+    // one. Used together with IsLastPacketKeyFrame() to recognize
+    // keyframe-aligned segment boundaries.
+    virtual int64_t GetLastPacketPtsNs() const { return -1; }
+
+    // Whether the frame most recently returned by DemuxFrame() is a
+    // keyframe (IDR), i.e. a point the decoder can resynchronize at.
+    virtual bool IsLastPacketKeyFrame() const { return false; }
+
     virtual void DumpStreamParameters() const = 0;
 
 
@@ -0,0 +1,214 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _DECODEBENCHMARK_H_
+#define _DECODEBENCHMARK_H_
+
+#include <algorithm>
+#include <assert.h>
+#include <chrono>
+#include <iostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Collects per-frame latency samples (parse to decode-complete) for the
+// headless benchmark mode (--benchmark) and reports decode throughput plus
+// p50/p95/p99 latency over the measured frames. Frames decoded during the
+// warmup phase are counted but excluded from the statistics.
+class DecodeBenchmark {
+
+public:
+
+    DecodeBenchmark(uint32_t warmupFrameCount)
+        : m_warmupFrameCount(warmupFrameCount)
+        , m_totalFrameCount(0)
+        , m_frameTimesNanoseconds()
+        , m_frameStartTime()
+    {
+        m_frameTimesNanoseconds.reserve(4096);
+    }
+
+    void BeginFrame()
+    {
+        m_frameStartTime = std::chrono::steady_clock::now();
+    }
+
+    void EndFrame()
+    {
+        const auto frameEndTime = std::chrono::steady_clock::now();
+        m_totalFrameCount++;
+        if (m_totalFrameCount <= m_warmupFrameCount) {
+            return;
+        }
+        m_frameTimesNanoseconds.push_back(
+            (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    frameEndTime - m_frameStartTime).count());
+    }
+
+    uint64_t GetMeasuredFrameCount() const { return m_frameTimesNanoseconds.size(); }
+
+    void Report(std::ostream& outputStream) const
+    {
+        const size_t measuredFrames = m_frameTimesNanoseconds.size();
+
+        outputStream << "Benchmark results:" << std::endl
+                     << "\tWarmup frames:   " << std::min<uint64_t>(m_totalFrameCount, m_warmupFrameCount) << std::endl
+                     << "\tMeasured frames: " << measuredFrames << std::endl;
+
+        if (measuredFrames == 0) {
+            outputStream << "\tNo frames were measured - increase the frame count or decrease the warmup count." << std::endl;
+            return;
+        }
+
+        uint64_t totalTimeNanoseconds = 0;
+        for (size_t frame = 0; frame < measuredFrames; frame++) {
+            totalTimeNanoseconds += m_frameTimesNanoseconds[frame];
+        }
+
+        std::vector<uint64_t> sortedFrameTimes(m_frameTimesNanoseconds);
+        std::sort(sortedFrameTimes.begin(), sortedFrameTimes.end());
+
+        const double fps = (double)measuredFrames * 1e9 / (double)totalTimeNanoseconds;
+        outputStream << "\tThroughput:      " << fps << " frames/sec" << std::endl
+                     << "\tLatency p50:     " << GetPercentileMilliseconds(sortedFrameTimes, 50) << " ms" << std::endl
+                     << "\tLatency p95:     " << GetPercentileMilliseconds(sortedFrameTimes, 95) << " ms" << std::endl
+                     << "\tLatency p99:     " << GetPercentileMilliseconds(sortedFrameTimes, 99) << " ms" << std::endl;
+    }
+
+private:
+
+    static double GetPercentileMilliseconds(const std::vector<uint64_t>& sortedFrameTimes,
+                                            uint32_t percentile)
+    {
+        assert(!sortedFrameTimes.empty());
+        size_t index = (sortedFrameTimes.size() * percentile) / 100;
+        if (index >= sortedFrameTimes.size()) {
+            index = sortedFrameTimes.size() - 1;
+        }
+        return (double)sortedFrameTimes[index] / 1e6;
+    }
+
+private:
+    const uint32_t        m_warmupFrameCount;
+    uint64_t              m_totalFrameCount;
+    std::vector<uint64_t> m_frameTimesNanoseconds;
+    std::chrono::time_point<std::chrono::steady_clock> m_frameStartTime;
+};
+
+// Calibration of the in-flight decode surface depth (--calibrateInFlight):
+// the batch loop decodes each input once per candidate depth and records the
+// measured throughput here; the report then recommends, per input, the
+// smallest depth whose throughput stays within a small tolerance of the
+// best one. Extra depth beyond that point only costs decode surface memory,
+// so the recommendation is what numDecodeImagesInFlight should be configured
+// to for content of that kind.
+class InFlightDepthCalibration {
+
+public:
+
+    InFlightDepthCalibration()
+        : m_samples()
+    {
+    }
+
+    // The candidate depths for a sweep, capped at the configured maximum
+    // (which is always included, so the sweep covers the current setting).
+    static std::vector<int32_t> GetSweepDepths(int32_t maxDepth)
+    {
+        static const int32_t candidateDepths[] = { 2, 3, 4, 6, 8, 12, 16 };
+        std::vector<int32_t> sweepDepths;
+        for (size_t depthIndx = 0; depthIndx < sizeof(candidateDepths) / sizeof(candidateDepths[0]); depthIndx++) {
+            if (candidateDepths[depthIndx] < maxDepth) {
+                sweepDepths.push_back(candidateDepths[depthIndx]);
+            }
+        }
+        sweepDepths.push_back(maxDepth);
+        return sweepDepths;
+    }
+
+    void AddSample(const std::string& fileName, int32_t inFlightDepth,
+                   uint64_t frameCount, double elapsedSeconds)
+    {
+        m_samples.push_back(Sample{ fileName, inFlightDepth, frameCount, elapsedSeconds });
+    }
+
+    void Report(std::ostream& outputStream) const
+    {
+        // A depth sustains the peak when it is within 2% of the best
+        // throughput of its input - beyond that the extra surfaces only
+        // buy measurement noise.
+        const double sustainedFraction = 0.98;
+
+        outputStream << "In-flight depth calibration results:" << std::endl;
+        if (m_samples.empty()) {
+            outputStream << "\tNo samples were collected." << std::endl;
+            return;
+        }
+
+        int32_t overallRecommendedDepth = 0;
+        for (size_t sampleIndx = 0; sampleIndx < m_samples.size(); sampleIndx++) {
+            const std::string& fileName = m_samples[sampleIndx].fileName;
+            if ((sampleIndx > 0) && (m_samples[sampleIndx - 1].fileName == fileName)) {
+                continue; // this input's group has already been reported
+            }
+
+            double bestFps = 0.0;
+            for (size_t groupIndx = sampleIndx; (groupIndx < m_samples.size()) &&
+                    (m_samples[groupIndx].fileName == fileName); groupIndx++) {
+                bestFps = std::max(bestFps, m_samples[groupIndx].GetFps());
+            }
+
+            int32_t recommendedDepth = 0;
+            outputStream << "\t" << fileName << ":" << std::endl;
+            for (size_t groupIndx = sampleIndx; (groupIndx < m_samples.size()) &&
+                    (m_samples[groupIndx].fileName == fileName); groupIndx++) {
+                const double fps = m_samples[groupIndx].GetFps();
+                outputStream << "\t\tdepth " << m_samples[groupIndx].inFlightDepth
+                             << ": " << fps << " frames/sec" << std::endl;
+                if ((recommendedDepth == 0) && (fps >= (sustainedFraction * bestFps))) {
+                    recommendedDepth = m_samples[groupIndx].inFlightDepth;
+                }
+            }
+            outputStream << "\t\trecommended --numDecodeImagesInFlight: "
+                         << recommendedDepth << std::endl;
+            overallRecommendedDepth = std::max(overallRecommendedDepth, recommendedDepth);
+        }
+
+        // The depth that covers every input of the sweep - the safe setting
+        // when one deployment has to serve all of the measured content.
+        outputStream << "\tRecommended depth across all inputs: "
+                     << overallRecommendedDepth << std::endl;
+    }
+
+private:
+
+    struct Sample {
+        std::string fileName;
+        int32_t     inFlightDepth;
+        uint64_t    frameCount;
+        double      elapsedSeconds;
+
+        double GetFps() const
+        {
+            return (elapsedSeconds > 0.0) ? ((double)frameCount / elapsedSeconds) : 0.0;
+        }
+    };
+
+    std::vector<Sample> m_samples;
+};
+
+#endif /* _DECODEBENCHMARK_H_ */
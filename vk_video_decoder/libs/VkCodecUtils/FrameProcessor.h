@@ -27,6 +27,7 @@
 #include "VkCodecUtils/ProgramConfig.h"
 
 class Shell;
+class VulkanVideoProcessor;
 struct DecodedFrame;
 
 class FrameProcessor : public VkVideoRefCountBase {
@@ -58,6 +59,21 @@ public:
     virtual int AttachSwapchain(const Shell &shell) = 0;
     virtual void DetachSwapchain() {}
 
+    // The format of the decoded frames this processor presents, so the shell
+    // can prefer a matching swapchain format for direct scanout
+    // (--directScanout). VK_FORMAT_UNDEFINED when no video is attached.
+    virtual VkFormat GetFrameImageFormat() { return VK_FORMAT_UNDEFINED; }
+
+    // Mosaic composition (--mosaic): decode streams registered here are
+    // advanced in lockstep and composited as tiles of the same display
+    // frame (see VulkanFrame::OnMosaicFrame()). Processors that do not
+    // composite reject the registration.
+    virtual int32_t AddMosaicStream(VkSharedBaseObj<VulkanVideoProcessor>& videoProcessor)
+    {
+        (void)videoProcessor;
+        return -1;
+    }
+
     virtual int CreateFrameData(int count) = 0;
     virtual void DestroyFrameData() = 0;
 
@@ -139,6 +139,46 @@ inline VkResult MapMemoryTypeToIndex(const VkInterfaceFunctions* vkIf,
     return VK_ERROR_VALIDATION_FAILED_EXT;
 }
 
+// Selects a memory type for host-visible allocations with a preference
+// chain instead of a single exact match. CPU reads from uncached coherent
+// memory are many times slower than from host-cached memory, so the
+// readback paths first try to add HOST_CACHED to the request, then accept
+// a cached non-coherent type (which needs explicit flush/invalidate calls)
+// and only then fall back to the plain coherent type. On success
+// memoryPropertyFlags is replaced with the property flags of the memory
+// type that was actually selected, so the caller can tell whether explicit
+// vkFlush/InvalidateMappedMemoryRanges calls are required.
+inline VkResult MapMemoryTypeToIndexWithFallback(const VkInterfaceFunctions* vkIf,
+                                                 VkPhysicalDevice vkPhysicalDev,
+                                                 uint32_t typeBits,
+                                                 VkMemoryPropertyFlags& memoryPropertyFlags,
+                                                 uint32_t *typeIndex)
+{
+    if ((memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) == 0) {
+        return MapMemoryTypeToIndex(vkIf, vkPhysicalDev, typeBits,
+                                    memoryPropertyFlags, typeIndex);
+    }
+
+    const VkMemoryPropertyFlags preferenceChain[] = {
+        memoryPropertyFlags | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        (memoryPropertyFlags | VK_MEMORY_PROPERTY_HOST_CACHED_BIT) &
+                ~VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        memoryPropertyFlags,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    };
+
+    for (size_t chainIndex = 0; chainIndex < (sizeof(preferenceChain) / sizeof(preferenceChain[0])); chainIndex++) {
+        if (MapMemoryTypeToIndex(vkIf, vkPhysicalDev, typeBits,
+                                 preferenceChain[chainIndex], typeIndex) == VK_SUCCESS) {
+            VkPhysicalDeviceMemoryProperties memoryProperties;
+            vkIf->GetPhysicalDeviceMemoryProperties(vkPhysicalDev, &memoryProperties);
+            memoryPropertyFlags = memoryProperties.memoryTypes[*typeIndex].propertyFlags;
+            return VK_SUCCESS;
+        }
+    }
+    return VK_ERROR_VALIDATION_FAILED_EXT;
+}
+
 }  // namespace vk
 
 #endif  // HELPERS_H
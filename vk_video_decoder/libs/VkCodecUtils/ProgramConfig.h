@@ -27,6 +27,25 @@
 
 struct ProgramConfig {
 
+    // Decode image layout modes (--decodeImageLayout), mapped onto the
+    // decoder's image organization flags (see
+    // VkVideoDecoder::SetImageLayoutPreferences()).
+    enum DecodeImageLayoutMode {
+        // The decoder's built-in choice: DPB and output coincide when the
+        // implementation supports it, separate output images otherwise.
+        DecodeImageLayoutDefault = 0,
+        // Separate output images even when coinciding is supported.
+        DecodeImageLayoutSeparateOutput,
+        // One image array shared by all DPB slots.
+        DecodeImageLayoutImageArray,
+        // An image view array on top of the image array.
+        DecodeImageLayoutImageViewArray,
+        // Session-start auto-benchmark: decode a short warmup in each viable
+        // mode and lock in the fastest (see
+        // VulkanVideoProcessor::BenchmarkDecodeImageLayouts()).
+        DecodeImageLayoutAutoBenchmark,
+    };
+
     ProgramConfig(const char* programName) {
         name = programName;
         initialWidth = 1920;
@@ -38,6 +57,10 @@ struct ProgramConfig {
         numDecodeImagesInFlight = 8;
         numDecodeImagesToPreallocate = -1; // pre-allocate the maximum num of images
         numBitstreamBuffersToPreallocate = 8;
+        decodeSubmitBatchSize = 1;
+        decodeDecimateRatio = 0;
+        decodeImageLayoutMode = DecodeImageLayoutDefault;
+        imageLayoutBenchmarkFrames = 48;
         backBufferCount = 3;
         ticksPerSecond = 30;
         vsync = true;
@@ -50,14 +73,69 @@ struct ProgramConfig {
         noPresent = false;
 
         maxFrameCount = -1;
+        benchmark = false;
+        benchmarkWarmupFrames = 16;
         videoFileName = "";
         loopCount = 1;
         queueId = 0;
         gpuIndex = -1;
         forceParserType = VK_VIDEO_CODEC_OPERATION_NONE_KHR;
+        presentMode = VK_PRESENT_MODE_MAX_ENUM_KHR;
+        targetDisplayRate = 0;
+        startTime = 0.0;
+        stopTime = 0.0;
+        parallelGopDecodeCount = 0;
+        multiGpuCount = 0;
+        demuxReadAheadDepth = 0;
+        displayDeadlineBudgetMs = 0;
+        esChunkSizeKb = 0;
+        esReadAheadSizeKb = 16 * 1024;
+        parserWorkerCount = 0;
+        hostHugePageThresholdKb = 0;
+        alignStartTimeToNextKeyFrame = false;
         enableStreamDemuxing = true;
+        enableZeroCopyDemux = false;
+        enableAsyncOutputToFile = false;
+        enableMappedOutputToFile = false;
+        enableDecodeGpuTimeStats = false;
+        enablePipelinedParsing = false;
+        enableStreamHeaderScan = false;
+        enableReactorDecode = false;
+        enableEncoderInputSharing = false;
+        enableTimelineFrameSync = false;
+        enableGpuFrameChecksums = false;
+        enableGpuFrameAnalysis = false;
+        enableDecodedFrameExport = false;
+        enableOnDemandDpbAllocation = false;
+        enableAdaptiveInFlight = false;
+        enableAdaptiveBitstreamPool = false;
+        bitstreamPoolMinBuffers = 2;
+        bitstreamPoolMaxBuffers = 32;
+        enableDisplayOrderPrediction = false;
+        calibrateInFlight = false;
+        enableBatchedFrameRelease = false;
+        enableDecoupledPresent = false;
+        enableFastStartProbing = false;
+        enableNumaAutoAffinity = false;
+        enableDecoderPool = false;
+        enableMemoryDeltaReport = false;
+        enableRealtimeDecodeQos = false;
+        enablePacked10BitOutput = false;
+        enableP010Output = false;
+        enableErrorResilience = false;
+        parseAheadHighWatermark = 0;
+        parseAheadLowWatermark = 0;
+        scaledOutputWidth = 0;
+        scaledOutputHeight = 0;
+        scaledOutputCropX = 0;
+        scaledOutputCropY = 0;
+        scaledOutputCropWidth = 0;
+        scaledOutputCropHeight = 0;
         deviceId = (uint32_t)-1;
         directMode = false;
+        enableDirectScanout = false;
+        mosaicStreamCount = 0;
+        perfCountersPeriodMs = 0;
     }
 
     void ParseArgs(int argc, char* argv[]) {
@@ -66,6 +144,193 @@ struct ProgramConfig {
                 enableStreamDemuxing = true;
             } else if (nullptr != strstr(argv[i], "--disableStrDemux")) {
                 enableStreamDemuxing = false;
+            } else if (nullptr != strstr(argv[i], "--zeroCopyDemux")) {
+                enableZeroCopyDemux = true;
+            } else if (nullptr != strstr(argv[i], "--asyncOutput")) {
+                enableAsyncOutputToFile = true;
+            } else if (nullptr != strstr(argv[i], "--mappedOutput")) {
+                enableMappedOutputToFile = true;
+            } else if (nullptr != strstr(argv[i], "--pipelinedParsing")) {
+                enablePipelinedParsing = true;
+            } else if (nullptr != strstr(argv[i], "--streamHeaderScan")) {
+                enableStreamHeaderScan = true;
+            } else if (nullptr != strstr(argv[i], "--parserWorkers")) {
+                i++;
+                parserWorkerCount = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--reactorDecode")) {
+                enableReactorDecode = true;
+                noPresent = true;
+            } else if (nullptr != strstr(argv[i], "--encoderInputSharing")) {
+                enableEncoderInputSharing = true;
+            } else if (nullptr != strstr(argv[i], "--timelineFrameSync")) {
+                enableTimelineFrameSync = true;
+            } else if (nullptr != strstr(argv[i], "--gpuFrameChecksums")) {
+                enableGpuFrameChecksums = true;
+            } else if (nullptr != strstr(argv[i], "--gpuFrameAnalysis")) {
+                enableGpuFrameAnalysis = true;
+            } else if (nullptr != strstr(argv[i], "--exportDecodedFrames")) {
+                enableDecodedFrameExport = true;
+            } else if (nullptr != strstr(argv[i], "--decoupledPresent")) {
+                enableDecoupledPresent = true;
+            } else if (nullptr != strstr(argv[i], "--fastStartProbing")) {
+                enableFastStartProbing = true;
+            } else if (nullptr != strstr(argv[i], "--decoderPool")) {
+                enableDecoderPool = true;
+            } else if (nullptr != strstr(argv[i], "--onDemandDpb")) {
+                enableOnDemandDpbAllocation = true;
+            } else if (nullptr != strstr(argv[i], "--adaptiveInFlight")) {
+                enableAdaptiveInFlight = true;
+            } else if (nullptr != strstr(argv[i], "--adaptiveBitstreamPool")) {
+                enableAdaptiveBitstreamPool = true;
+            } else if (nullptr != strstr(argv[i], "--bitstreamPoolMinBuffers")) {
+                i++;
+                bitstreamPoolMinBuffers = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--bitstreamPoolMaxBuffers")) {
+                i++;
+                bitstreamPoolMaxBuffers = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--displayOrderPrediction")) {
+                enableDisplayOrderPrediction = true;
+            } else if (nullptr != strstr(argv[i], "--calibrateInFlight")) {
+                calibrateInFlight = true;
+                noPresent = true;
+            } else if (nullptr != strstr(argv[i], "--batchedFrameRelease")) {
+                enableBatchedFrameRelease = true;
+            } else if (nullptr != strstr(argv[i], "--scaledOutputCrop")) {
+                i++;
+                sscanf(argv[i], "%d,%d,%dx%d", &scaledOutputCropX, &scaledOutputCropY,
+                       &scaledOutputCropWidth, &scaledOutputCropHeight);
+            } else if (nullptr != strstr(argv[i], "--scaledOutput")) {
+                i++;
+                sscanf(argv[i], "%dx%d", &scaledOutputWidth, &scaledOutputHeight);
+            } else if (nullptr != strstr(argv[i], "--packed10BitOutput")) {
+                enablePacked10BitOutput = true;
+            } else if (nullptr != strstr(argv[i], "--p010Output")) {
+                enableP010Output = true;
+            } else if (nullptr != strstr(argv[i], "--pinParserThread")) {
+                i++;
+                parserThreadCpuSet = argv[i];
+            } else if (nullptr != strstr(argv[i], "--pinDecodeThread")) {
+                i++;
+                decodeThreadCpuSet = argv[i];
+            } else if (nullptr != strstr(argv[i], "--pinOutputThread")) {
+                i++;
+                outputThreadCpuSet = argv[i];
+            } else if (nullptr != strstr(argv[i], "--numaAffinity")) {
+                enableNumaAutoAffinity = true;
+            } else if (nullptr != strstr(argv[i], "--batchFileList")) {
+                i++;
+                batchFileListName = argv[i];
+                noPresent = true;
+            } else if (nullptr != strstr(argv[i], "--transcodeJson")) {
+                i++;
+                transcodeBenchmarkJsonFile = argv[i];
+            } else if (nullptr != strstr(argv[i], "--frameLatencyTrace")) {
+                i++;
+                frameLatencyTraceFile = argv[i];
+            } else if (nullptr != strstr(argv[i], "--perfCountersPeriod")) {
+                i++;
+                perfCountersPeriodMs = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--perfCountersFile")) {
+                i++;
+                perfCountersFile = argv[i];
+            } else if (nullptr != strstr(argv[i], "--memoryDeltaReport")) {
+                enableMemoryDeltaReport = true;
+            } else if (nullptr != strstr(argv[i], "--realtimeDecodeQos")) {
+                enableRealtimeDecodeQos = true;
+            } else if (nullptr != strstr(argv[i], "--errorResilient")) {
+                enableErrorResilience = true;
+            } else if (nullptr != strstr(argv[i], "--parseAheadHighWatermark")) {
+                i++;
+                parseAheadHighWatermark = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--parseAheadLowWatermark")) {
+                i++;
+                parseAheadLowWatermark = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--decodeImageLayoutFrames")) {
+                i++;
+                imageLayoutBenchmarkFrames = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--decodeImageLayout")) {
+                i++;
+                if (nullptr != strstr(argv[i], "auto")) {
+                    decodeImageLayoutMode = DecodeImageLayoutAutoBenchmark;
+                } else if (nullptr != strstr(argv[i], "imageViewArray")) {
+                    decodeImageLayoutMode = DecodeImageLayoutImageViewArray;
+                } else if (nullptr != strstr(argv[i], "imageArray")) {
+                    decodeImageLayoutMode = DecodeImageLayoutImageArray;
+                } else if (nullptr != strstr(argv[i], "separateOutput")) {
+                    decodeImageLayoutMode = DecodeImageLayoutSeparateOutput;
+                } else {
+                    decodeImageLayoutMode = DecodeImageLayoutDefault;
+                }
+            } else if (nullptr != strstr(argv[i], "--gpuDecodeTimeStats")) {
+                enableDecodeGpuTimeStats = true;
+            } else if (nullptr != strstr(argv[i], "--presentMode")) {
+                i++;
+                if (nullptr != strstr(argv[i], "immediate")) {
+                    presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+                } else if (nullptr != strstr(argv[i], "mailbox")) {
+                    presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+                } else if (nullptr != strstr(argv[i], "relaxed")) {
+                    presentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+                } else if (nullptr != strstr(argv[i], "fifo")) {
+                    presentMode = VK_PRESENT_MODE_FIFO_KHR;
+                }
+            } else if (nullptr != strstr(argv[i], "--targetDisplayRate")) {
+                i++;
+                targetDisplayRate = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--startTime")) {
+                i++;
+                startTime = std::atof(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--stopTime")) {
+                i++;
+                stopTime = std::atof(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--parallelGopDecode")) {
+                i++;
+                parallelGopDecodeCount = std::atoi(argv[i]);
+                noPresent = true;
+            } else if (nullptr != strstr(argv[i], "--demuxReadAhead")) {
+                i++;
+                demuxReadAheadDepth = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--displayDeadline")) {
+                i++;
+                displayDeadlineBudgetMs = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--esChunkSize")) {
+                i++;
+                esChunkSizeKb = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--esReadAhead")) {
+                i++;
+                esReadAheadSizeKb = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--hugePageStaging")) {
+                i++;
+                hostHugePageThresholdKb = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--multiGpu")) {
+                i++;
+                if (nullptr != strstr(argv[i], "all")) {
+                    multiGpuCount = -1;
+                } else {
+                    multiGpuCount = std::atoi(argv[i]);
+                }
+                noPresent = true;
+            } else if (nullptr != strstr(argv[i], "--decodeDecimateRatio")) {
+                i++;
+                decodeDecimateRatio = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--decodeSubmitBatchSize")) {
+                i++;
+                decodeSubmitBatchSize = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--numDecodeImagesToPreallocate")) {
+                i++;
+                numDecodeImagesToPreallocate = std::atoi(argv[i]);
+            } else if (nullptr != strstr(argv[i], "--shaderCacheDir")) {
+                i++;
+                shaderCacheDir = argv[i];
+            } else if (nullptr != strstr(argv[i], "--deviceStartupCache")) {
+                i++;
+                deviceStartupCacheFile = argv[i];
+            } else if (nullptr != strstr(argv[i], "--benchmark")) {
+                benchmark = true;
+                noPresent = true;
+            } else if (nullptr != strstr(argv[i], "--warmupFrames")) {
+                i++;
+                benchmarkWarmupFrames = std::atoi(argv[i]);
             } else if (nullptr != strstr(argv[i], "--codec")) {
                 i++;
                 if ((nullptr != strstr(argv[i], "5")) || (nullptr != strstr(argv[i], "hevc"))) {
@@ -117,6 +382,19 @@ struct ProgramConfig {
                 sscanf(argv[i], "%x", &deviceId);
             } else if (!strcmp(argv[i], "--direct")) {
                 directMode = true;
+            } else if (!strcmp(argv[i], "--directScanout")) {
+                // Scanout only makes sense on a display plane the application
+                // owns, so the option implies direct-to-display mode.
+                enableDirectScanout = true;
+                directMode = true;
+            } else if (!strcmp(argv[i], "--mosaic")) {
+                i++;
+                mosaicStreamCount = std::atoi(argv[i]);
+                // The tiles are composited by the direct scanout copy
+                // engine path, so the swapchain must carry the decoder
+                // output format.
+                enableDirectScanout = true;
+                directMode = true;
             }
         }
     }
@@ -131,25 +409,270 @@ struct ProgramConfig {
     int32_t numDecodeImagesInFlight;
     int32_t numDecodeImagesToPreallocate;
     int32_t numBitstreamBuffersToPreallocate;
+    // Occupancy bounds of the adaptive bitstream pool mode
+    // (--adaptiveBitstreamPool).
+    int32_t bitstreamPoolMinBuffers;
+    int32_t bitstreamPoolMaxBuffers;
+    int32_t decodeSubmitBatchSize;
+    // With a ratio N > 1 only every Nth non-reference picture is decoded and
+    // displayed (see IVulkanVideoParser::SetDecodeDecimation()).
+    int32_t decodeDecimateRatio;
+    // Decode image layout selection (--decodeImageLayout
+    // default|separateOutput|imageArray|imageViewArray|auto): the relative
+    // cost of discrete decode images, image arrays and separate output
+    // images differs across drivers and GPU generations, so the built-in
+    // choice can be overridden, or measured and locked in by the auto mode
+    // at session start.
+    int32_t decodeImageLayoutMode;
+    // Warmup frames decoded per candidate mode by the auto benchmark
+    // (--decodeImageLayoutFrames <count>).
+    int32_t imageLayoutBenchmarkFrames;
+    // Watermark throttling of the demux/parse run-ahead, in decoded frames
+    // not yet consumed by the display side: the demux pauses once the
+    // backlog reaches the high mark and resumes when the consumer drains it
+    // to the low mark, keeping the compressed-data buffering and the
+    // stream-switch abort latency bounded on fast storage. Zero disables
+    // the throttle; an unset low mark defaults to half the high mark (see
+    // VulkanVideoProcessor::ParserProcessNextDataChunk()).
+    int32_t parseAheadHighWatermark;
+    int32_t parseAheadLowWatermark;
     int backBufferCount;
     int ticksPerSecond;
     int maxFrameCount;
+    int benchmarkWarmupFrames;
 
     std::string videoFileName;
+    // Batch decode mode: a text file with one input file name per line. All
+    // files are decoded back to back on the same Vulkan instance and device
+    // (implies noPresent) and per-file plus aggregate throughput is reported.
+    std::string batchFileListName;
     std::string outputFileName;
+    std::string shaderCacheDir;
+    // Warm-start snapshot of the selected physical device and its queue
+    // family topology (--deviceStartupCache <file>), so short-lived worker
+    // processes skip the full startup enumeration (see
+    // VulkanDeviceContext::SetStartupCacheFile()).
+    std::string deviceStartupCacheFile;
+    // When set, a per-frame pipeline latency trace is written to this file at
+    // exit, as JSON (".json" extension) or CSV (anything else).
+    std::string frameLatencyTraceFile;
+    // When set, stage-resolved transcode timing (demux, parse, decode GPU,
+    // convert, encode GPU, writeback) is written to this file at exit as one
+    // JSON document with a stable shape, diffable run-over-run by CI (see
+    // TranscodeBenchmark).
+    std::string transcodeBenchmarkJsonFile;
+    // When set, the live pipeline counters are periodically exported to this
+    // text file for fleet scraping (see VulkanPerfCounters).
+    std::string perfCountersFile;
+    // Export sample period in milliseconds; 0 uses the exporter default.
+    uint32_t perfCountersPeriodMs;
+    // Number of decode streams composited as tiles of a single display
+    // frame (see VulkanFrame::OnMosaicFrame()); 0 disables the mosaic
+    // mode. Implies enableDirectScanout.
+    int32_t mosaicStreamCount;
+    // Per-role CPU pinning on NUMA hosts, as Linux cpulists such as
+    // "0-7,16-23" (see VulkanThreadAffinity). Empty leaves the role
+    // unpinned; --numaAffinity fills empty sets from the GPU's PCIe
+    // locality. The parser set covers the demux/parse/submit thread, the
+    // decode set the frame consumer (main or decoupled decode thread), the
+    // output set the async file writer.
+    std::string parserThreadCpuSet;
+    std::string decodeThreadCpuSet;
+    std::string outputThreadCpuSet;
+    // Scaled file output (--scaledOutput <WxH>, e.g. 320x180): the frames
+    // written with -o are downsampled to this size by a GPU compute stage
+    // (see VulkanFrameScaler) instead of being read back at full
+    // resolution; 0 writes full-resolution frames. --scaledOutputCrop
+    // <x,y,WxH> restricts the source to a crop rectangle; 0 extents scale
+    // the whole visible frame.
+    int32_t scaledOutputWidth;
+    int32_t scaledOutputHeight;
+    int32_t scaledOutputCropX;
+    int32_t scaledOutputCropY;
+    int32_t scaledOutputCropWidth;
+    int32_t scaledOutputCropHeight;
     int gpuIndex;
     int loopCount;
     int queueId;
     VkVideoCodecOperationFlagBitsKHR forceParserType;
+    // Explicitly requested swapchain present mode (--presentMode
+    // fifo|relaxed|mailbox|immediate); VK_PRESENT_MODE_MAX_ENUM_KHR lets the
+    // Shell pick one from the vsync setting.
+    VkPresentModeKHR presentMode;
+    // Frame pacing target in frames per second (see Shell::PaceFrame());
+    // 0 runs unpaced.
+    int32_t targetDisplayRate;
+    // Initial stream position in seconds (--startTime): decoding starts at
+    // the nearest keyframe at or before this time when the demuxer can seek
+    // (see VideoStreamDemuxer::SeekToTimestamp()); 0 decodes from the start.
+    double startTime;
+    // Stream position in seconds (--stopTime) past which no further GOP is
+    // decoded: demuxing ends at the first keyframe at or after this time;
+    // 0 decodes to the end of the stream.
+    double stopTime;
+    // Number of independent decode engines for the offline parallel GOP mode
+    // (--parallelGopDecode <count>, implies noPresent): the stream is split
+    // into keyframe-aligned time segments that are decoded concurrently on
+    // separate video sessions and queues; 0 or 1 decodes single-engine.
+    int32_t parallelGopDecodeCount;
+    // Number of physical devices for the in-process multi-GPU batch mode
+    // (--multiGpu <count|all>, implies noPresent): the --batchFileList
+    // streams are sharded across one Vulkan device per GPU, either
+    // explicitly ("N:file" list entries) or load-based from a shared work
+    // queue; -1 uses every suitable device, 0 decodes single-device.
+    int32_t multiGpuCount;
+    // Number of 1 MB read chunks the FFmpeg-based demuxer keeps in flight
+    // ahead of the demux position (--demuxReadAhead <depth>), so cold-cache
+    // reads from slow storage overlap with demux and decode. Uses io_uring
+    // when built with liburing; 0 uses FFmpeg's synchronous file I/O.
+    int32_t demuxReadAheadDepth;
+    // Deadline-aware display (--displayDeadline <ms>): frames get a target
+    // display time from their demuxed PTS, frames that miss it by more than
+    // this budget are shed before they consume graphics work, and the
+    // dropped/late/repeated counts are reported (see
+    // VulkanFrame::ApplyDisplayDeadlinePolicy()); 0 displays every frame.
+    int32_t displayDeadlineBudgetMs;
+    // Span in KB a single elementary-stream ReadBitstreamData() call hands
+    // to the parser (--esChunkSize <KB>); 0 keeps the demuxer's built-in
+    // 2 MB default.
+    int32_t esChunkSizeKb;
+    // Distance in KB the elementary-stream demuxer keeps prefetched ahead
+    // of the parse cursor with madvise(WILLNEED) (--esReadAhead <KB>), so
+    // cold page faults of the mmap-ed input are serviced by kernel
+    // readahead instead of stalling the parse thread; 0 disables the
+    // prefetch.
+    int32_t esReadAheadSizeKb;
+    // Size of the shared parser worker pool (--parserWorkers <count>): the
+    // demux/parse/submit quanta of every stream run on this process-wide
+    // pool instead of one dedicated parser thread per stream, so many
+    // streams of the same codec share a few hot parse cores (see
+    // VulkanParserServicePool); 0 keeps the per-stream threading modes.
+    int32_t parserWorkerCount;
+    // Host-visible allocations of at least this many KB - the bitstream
+    // buffers and the linear readback images dominate - get huge-page
+    // backed host memory imported with VK_EXT_external_memory_host
+    // (--hugePageStaging <KB>, see
+    // VulkanDeviceMemoryImpl::SetHostHugePageThreshold()), cutting TLB
+    // misses in the copy loops; 0 keeps regular driver allocations.
+    int32_t hostHugePageThresholdKb;
     uint32_t deviceId;
     uint32_t enableStreamDemuxing:1;
+    uint32_t enableZeroCopyDemux:1;
+    uint32_t enableAsyncOutputToFile:1;
+    // Write decoded frames through an mmap()-ed view of the output file
+    // instead of fwrite (see VkFrameVideoToFile::StartMappedWriter());
+    // falls back to buffered writes on platforms without mmap.
+    uint32_t enableMappedOutputToFile:1;
+    uint32_t enableDecodeGpuTimeStats:1;
+    uint32_t enablePipelinedParsing:1;
+    // Run the lightweight H.264 header scan over the elementary stream
+    // before decoding starts (--streamHeaderScan): picture boundaries, POC
+    // and reference flags from the first slice header fields only, an order
+    // of magnitude cheaper than a full parse (see H264HeaderScanner and
+    // VulkanVideoProcessor::ScanStreamHeaders()).
+    uint32_t enableStreamHeaderScan:1;
+    // Decode every stream of the batch on one reactor thread
+    // (--reactorDecode, implies noPresent): non-blocking frame dequeues and
+    // fence polls multiplex the streams instead of a consumer thread per
+    // stream (see VulkanVideoFrameReactor).
+    uint32_t enableReactorDecode:1;
+    uint32_t enableEncoderInputSharing:1;
+    uint32_t enableTimelineFrameSync:1;
+    uint32_t enableGpuFrameChecksums:1;
+    // Accumulate per-frame luma histograms and average-luma statistics with
+    // GPU compute dispatches appended after each decode, reporting black and
+    // freeze frames at end of stream without any per-frame readback (see
+    // VulkanFrameAnalysis).
+    uint32_t enableGpuFrameAnalysis:1;
+    // Create the decoded output pictures and their frame-complete semaphores
+    // exportable as opaque fds, so another process (a compositor) can import
+    // and sample them without a copy (see
+    // VulkanVideoFrameBuffer::EnableDecodedFrameExport()).
+    uint32_t enableDecodedFrameExport:1;
+    // Back decode surfaces only when the stream first references their DPB
+    // slot, so level-mandated worst-case slot counts do not cost real
+    // memory (see VkVideoDecoder::EnableOnDemandDpbAllocation()).
+    uint32_t enableOnDemandDpbAllocation:1;
+    // Grow and shrink the decoder's in-flight picture window at runtime
+    // from measured surface-starvation waits, instead of always running
+    // numDecodeImagesInFlight ahead of the consumer (see
+    // VkVideoDecoder::EnableAdaptiveInFlightDepth()).
+    uint32_t enableAdaptiveInFlight:1;
+    // Grow the bitstream buffer pool from observed acquisition misses and
+    // shrink it back after sustained idleness, instead of holding the fixed
+    // preallocation count for the whole session, within the
+    // --bitstreamPoolMinBuffers/--bitstreamPoolMaxBuffers bounds (see
+    // VkVideoDecoder::EnableAdaptiveBitstreamPool()).
+    uint32_t enableAdaptiveBitstreamPool:1;
+    // Release decoded frames to the display queue as soon as the stream's
+    // SPS-signaled reorder depth allows, instead of after the parser's
+    // conservative DPB output delay - cuts the glass-to-glass latency of
+    // no-B-frame streams (see VkVideoDecoder::EnableDisplayOrderPrediction()).
+    uint32_t enableDisplayOrderPrediction:1;
+    // Decode each input repeatedly over a sweep of in-flight depths and
+    // report the smallest depth that still sustains the peak throughput, so
+    // numDecodeImagesInFlight does not have to be hand-tuned per deployment
+    // (implies noPresent; see InFlightDepthCalibration in DecodeBenchmark.h).
+    uint32_t calibrateInFlight:1;
+    // Return displayed frames to the frame buffer in batches instead of one
+    // locked call per frame (see
+    // VulkanVideoProcessor::FlushPendingFrameReleases()).
+    uint32_t enableBatchedFrameRelease:1;
+    // Print each memory pool's live/peak/delta accounting on every stream
+    // loop, so soak tests attribute growth per iteration (see
+    // VulkanMemoryBudget::DumpRestartDelta()).
+    uint32_t enableMemoryDeltaReport:1;
+    // Place this process's primary decode stream in the realtime QoS class:
+    // its queue submissions take precedence over best-effort streams sharing
+    // a decode queue (see VulkanDeviceContext::MultiThreadedQueueSubmitBatchQos())
+    // and the decode queues request a high VK_EXT_global_priority when the
+    // device supports it. Extra mosaic streams stay best-effort.
+    uint32_t enableRealtimeDecodeQos:1;
+    // Pack the 16-bit MSB-aligned readback of 10-bit content down to tight
+    // 10-bit groups before the file write, shrinking the output by 3/8 (see
+    // PackMsb16SamplesTo10Bit() in NvCodecUtils/TenBitPacker.h). Ignored
+    // for 8-bit content.
+    uint32_t enablePacked10BitOutput:1;
+    // Zero the 6 fractional LSBs of the 16-bit readback words so the output
+    // is canonical P010 (see ConvertMsb16SamplesToP010()). Ignored for
+    // 8-bit content and when --packed10BitOutput is set.
+    uint32_t enableP010Output:1;
+    // Contained recovery on corrupted input: a picture whose decode result
+    // status query reports an error is dropped back to the decoder instead
+    // of reaching the display or the output file, and decoding continues
+    // from the next access unit without a session reset (see
+    // VulkanVideoProcessor::DequeueValidDecodedPicture()).
+    uint32_t enableErrorResilience:1;
+    uint32_t enableDecoupledPresent:1;
+    // Caps the demuxer's container probing so the first frame comes out
+    // quickly (see VideoStreamDemuxer::Create()).
+    uint32_t enableFastStartProbing:1;
+    // Derive the pipeline threads' CPU sets from the GPU's PCIe locality
+    // and prefer NUMA-local host allocations (see VulkanThreadAffinity).
+    uint32_t enableNumaAutoAffinity:1;
+    // Park initialized decoders on stream close and reuse them for the next
+    // stream with a matching sequence, so switching between streams of the
+    // same codec and resolution skips the video session and image pool
+    // setup (see VkVideoDecoderPool).
+    uint32_t enableDecoderPool:1;
+    // Engine-internal, no command line option: align startTime to the first
+    // keyframe at or after it instead of the nearest one before, so the
+    // disjoint [startTime, stopTime) segments of the parallel GOP decode
+    // engines partition the stream exactly at keyframes.
+    uint32_t alignStartTimeToNextKeyFrame:1;
     uint32_t directMode:1;
+    // Direct-to-display mode only: present decoded frames with a
+    // plane-for-plane copy into a swapchain carrying the decoder output
+    // format, instead of drawing them through the graphics render pass
+    // (see VulkanFrame::AttachSwapchain()). Implies directMode.
+    uint32_t enableDirectScanout:1;
     uint32_t vsync:1;
     uint32_t validate:1;
     uint32_t validateVerbose:1;
     uint32_t verbose:1;
     uint32_t noTick:1;
     uint32_t noPresent:1;
+    uint32_t benchmark:1;
 };
 
 #endif /* _PROGRAMSETTINGS_H_ */
@@ -0,0 +1,137 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _TRANSCODEBENCHMARK_H_
+#define _TRANSCODEBENCHMARK_H_
+
+#include <algorithm>
+#include <assert.h>
+#include <ostream>
+#include <stdint.h>
+#include <vector>
+
+// Stage-resolved timing for the end-to-end transcode path (--transcodeJson
+// <file>). Each pipeline stage accumulates per-item duration samples - demux
+// and parse per chunk, decode GPU, convert and writeback per frame, encode
+// GPU per encoded frame - and the report is one JSON document with a fixed
+// stage order and fixed keys, so CI can diff it run-over-run to catch
+// regressions per stage instead of only end-to-end. Stages a configuration
+// does not exercise (e.g. encode_gpu without an in-process encode consumer,
+// writeback without -o) are reported with zero samples rather than omitted,
+// keeping the document shape stable across configurations.
+class TranscodeBenchmark {
+
+public:
+
+    enum Stage {
+        STAGE_DEMUX = 0,
+        STAGE_PARSE,
+        STAGE_DECODE_GPU,
+        STAGE_CONVERT,
+        STAGE_ENCODE_GPU,
+        STAGE_WRITEBACK,
+        NUM_STAGES
+    };
+
+    TranscodeBenchmark()
+        : m_frameCount(0)
+        , m_stageSamplesNanoseconds()
+    {
+        for (uint32_t stage = 0; stage < NUM_STAGES; stage++) {
+            m_stageSamplesNanoseconds[stage].reserve(4096);
+        }
+    }
+
+    static const char* GetStageName(Stage stage)
+    {
+        static const char* stageNames[NUM_STAGES] = {
+            "demux",
+            "parse",
+            "decode_gpu",
+            "convert",
+            "encode_gpu",
+            "writeback",
+        };
+        assert((uint32_t)stage < NUM_STAGES);
+        return stageNames[stage];
+    }
+
+    void AddStageSample(Stage stage, uint64_t durationNanoseconds)
+    {
+        assert((uint32_t)stage < NUM_STAGES);
+        m_stageSamplesNanoseconds[stage].push_back(durationNanoseconds);
+    }
+
+    void AddFrame() { m_frameCount++; }
+
+    uint64_t GetFrameCount() const { return m_frameCount; }
+
+    void ReportJson(std::ostream& outputStream) const
+    {
+        outputStream << "{\n"
+                     << "  \"transcode_benchmark\": {\n"
+                     << "    \"frames\": " << m_frameCount << ",\n"
+                     << "    \"stages\": {\n";
+
+        for (uint32_t stage = 0; stage < NUM_STAGES; stage++) {
+
+            const std::vector<uint64_t>& samples = m_stageSamplesNanoseconds[stage];
+
+            uint64_t totalNanoseconds = 0;
+            for (size_t sample = 0; sample < samples.size(); sample++) {
+                totalNanoseconds += samples[sample];
+            }
+
+            std::vector<uint64_t> sortedSamples(samples);
+            std::sort(sortedSamples.begin(), sortedSamples.end());
+
+            outputStream << "      \"" << GetStageName((Stage)stage) << "\": { "
+                         << "\"samples\": " << samples.size() << ", "
+                         << "\"total_ms\": " << ((double)totalNanoseconds / 1e6) << ", "
+                         << "\"avg_ms\": "
+                         << (samples.empty() ? 0.0 : ((double)totalNanoseconds / (1e6 * (double)samples.size()))) << ", "
+                         << "\"p50_ms\": " << GetPercentileMilliseconds(sortedSamples, 50) << ", "
+                         << "\"p95_ms\": " << GetPercentileMilliseconds(sortedSamples, 95) << ", "
+                         << "\"p99_ms\": " << GetPercentileMilliseconds(sortedSamples, 99)
+                         << " }" << (((stage + 1) < NUM_STAGES) ? "," : "") << "\n";
+        }
+
+        outputStream << "    }\n"
+                     << "  }\n"
+                     << "}\n";
+    }
+
+private:
+
+    static double GetPercentileMilliseconds(const std::vector<uint64_t>& sortedSamples,
+                                            uint32_t percentile)
+    {
+        if (sortedSamples.empty()) {
+            return 0.0;
+        }
+        size_t index = (sortedSamples.size() * percentile) / 100;
+        if (index >= sortedSamples.size()) {
+            index = sortedSamples.size() - 1;
+        }
+        return (double)sortedSamples[index] / 1e6;
+    }
+
+private:
+    uint64_t              m_frameCount;
+    std::vector<uint64_t> m_stageSamplesNanoseconds[NUM_STAGES];
+};
+
+#endif /* _TRANSCODEBENCHMARK_H_ */
@@ -18,21 +18,37 @@
 #include "VkCodecUtils/HelpersDispatchTable.h"
 #include "VkCodecUtils/Helpers.h"
 #include "VkCodecUtils/VulkanDeviceContext.h"
+#include "VkCodecUtils/VulkanMemoryBudget.h"
 #include "VkImageResource.h"
 
 VkResult VkImageResource::Create(const VulkanDeviceContext* vkDevCtx,
                                  const VkImageCreateInfo* pImageCreateInfo,
                                  VkMemoryPropertyFlags memoryPropertyFlags,
-                                 VkSharedBaseObj<VkImageResource>& imageResource)
+                                 VkSharedBaseObj<VkImageResource>& imageResource,
+                                 bool exportMemoryFd)
 {
     VkResult result = VK_ERROR_INITIALIZATION_FAILED;
 
     VkDevice device = vkDevCtx->getDevice();
     VkImage image = VK_NULL_HANDLE;
 
+    // Exportable images declare the opaque-fd handle type at creation, and
+    // their memory comes from a dedicated exportable allocation below.
+    VkExternalMemoryImageCreateInfo externalMemCreateInfo = VkExternalMemoryImageCreateInfo();
+    externalMemCreateInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_IMAGE_CREATE_INFO;
+    externalMemCreateInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+    VkImageCreateInfo exportImageCreateInfo;
+    const VkImageCreateInfo* pCreateImageInfo = pImageCreateInfo;
+    if (exportMemoryFd) {
+        exportImageCreateInfo = *pImageCreateInfo;
+        externalMemCreateInfo.pNext = pImageCreateInfo->pNext;
+        exportImageCreateInfo.pNext = &externalMemCreateInfo;
+        pCreateImageInfo = &exportImageCreateInfo;
+    }
+
     do {
 
-        result = vkDevCtx->CreateImage(device, pImageCreateInfo, nullptr, &image);
+        result = vkDevCtx->CreateImage(device, pCreateImageInfo, nullptr, &image);
         if (result != VK_SUCCESS) {
             assert(!"CreateImage Failed!");
             break;
@@ -49,14 +65,18 @@ VkResult VkImageResource::Create(const VulkanDeviceContext* vkDevCtx,
                                                 nullptr, // pInitializeMemory
                                                 0,       // initializeMemorySize
                                                 false,   // clearMemory
-                                                vkDeviceMemory);
+                                                vkDeviceMemory,
+                                                false,   // allowHostImport
+                                                exportMemoryFd);
         if (result != VK_SUCCESS) {
             assert(!"Create Memory Failed!");
             break;
         }
 
+        // The memory can be a slice suballocated from the shared arena - bind
+        // at the slice offset. imageOffset stays relative to the memory impl.
         VkDeviceSize imageOffset = 0;
-        result = vkDevCtx->BindImageMemory(device, image, *vkDeviceMemory, imageOffset);
+        result = vkDevCtx->BindImageMemory(device, image, *vkDeviceMemory, vkDeviceMemory->GetMemoryOffset());
         if (result != VK_SUCCESS) {
             assert(!"BindImageMemory Failed!");
             break;
@@ -71,6 +91,8 @@ VkResult VkImageResource::Create(const VulkanDeviceContext* vkDevCtx,
         if (imageResource == nullptr) {
             break;
         }
+        VulkanMemoryBudget::RecordAllocation(VulkanMemoryBudget::MEMORY_POOL_IMAGES,
+                                             memoryRequirements.size);
         return result;
 
     } while (0);
@@ -93,6 +115,7 @@ void VkImageResource::Destroy()
     if (m_image != VK_NULL_HANDLE) {
         m_vkDevCtx->DestroyImage(*m_vkDevCtx, m_image, nullptr);
         m_image = VK_NULL_HANDLE;
+        VulkanMemoryBudget::RecordFree(VulkanMemoryBudget::MEMORY_POOL_IMAGES, m_imageSize);
     }
 
     m_vulkanDeviceMemory = nullptr;
@@ -24,10 +24,22 @@
 class VkImageResource : public VkVideoRefCountBase
 {
 public:
+    // exportMemoryFd creates the image with an opaque-fd external memory
+    // handle type and backs it with a dedicated exportable allocation, so
+    // another process can import the decoded picture without a copy (see
+    // GetMemoryFd()).
     static VkResult Create(const VulkanDeviceContext* vkDevCtx,
                            const VkImageCreateInfo* pImageCreateInfo,
                            VkMemoryPropertyFlags memoryPropertyFlags,
-                           VkSharedBaseObj<VkImageResource>& imageResource);
+                           VkSharedBaseObj<VkImageResource>& imageResource,
+                           bool exportMemoryFd = false);
+
+    // Exports the image's allocation as an opaque fd (ownership passes to
+    // the caller). Only valid on images created with exportMemoryFd.
+    VkResult GetMemoryFd(int* pFd) const
+    {
+        return m_vulkanDeviceMemory->GetExportMemoryFd(pFd);
+    }
 
     bool IsCompatible ( VkDevice dev,
                         const VkImageCreateInfo* pImageCreateInfo)
@@ -0,0 +1,89 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "VulkanAllocationAudit.h"
+
+#if VK_VIDEO_ALLOCATION_AUDIT
+
+#include <cstdlib>
+#include <new>
+
+// Process-wide counting forwarders around the C heap. They must live in
+// exactly one translation unit; the stage attribution itself is in the
+// header (see VulkanAllocationAudit::OnAllocation()). Counting is branch-
+// and allocation-free, so interposing does not distort what it measures
+// beyond the malloc call it forwards to.
+
+void* operator new(size_t size)
+{
+    void* ptr = std::malloc(size ? size : 1);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    VulkanAllocationAudit::OnAllocation(size);
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    void* ptr = std::malloc(size ? size : 1);
+    if (ptr != nullptr) {
+        VulkanAllocationAudit::OnAllocation(size);
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+#endif /* VK_VIDEO_ALLOCATION_AUDIT */
@@ -0,0 +1,175 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VKCODECUTILS_VULKANALLOCATIONAUDIT_H_
+#define _VKCODECUTILS_VULKANALLOCATIONAUDIT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+
+// Heap allocation audit for the decode and display hot paths. After warmup
+// the steady-state loop is supposed to allocate nothing - every malloc on
+// those paths is latency jitter and allocator lock traffic. The audit is
+// selected at configure time with the VULKAN_VIDEO_ALLOCATION_AUDIT CMake
+// cache variable and compiled in as VK_VIDEO_ALLOCATION_AUDIT:
+//
+//   0 (off) - the default. The global operator new/delete are untouched and
+//             all audit macros below expand to ((void)0).
+//   1 (on)  - VulkanAllocationAudit.cpp replaces the global operator
+//             new/delete with counting forwarders, the pipeline stages tag
+//             their sections with the scope macro, and every frame past the
+//             warmup that still allocated prints a per-stage report line.
+//
+// The counting forwarders are process-wide, so the audit build is a
+// diagnostic configuration, not a production one.
+#ifndef VK_VIDEO_ALLOCATION_AUDIT
+#define VK_VIDEO_ALLOCATION_AUDIT 0
+#endif
+
+// Frames before per-frame reporting starts; pool growth and lazy init during
+// these frames is expected and only shows up in the final summary.
+#ifndef VK_VIDEO_ALLOCATION_AUDIT_WARMUP_FRAMES
+#define VK_VIDEO_ALLOCATION_AUDIT_WARMUP_FRAMES 60
+#endif
+
+class VulkanAllocationAudit {
+
+public:
+    enum Stage {
+        STAGE_UNTAGGED = 0, // outside any tagged section (startup, teardown)
+        STAGE_DEMUX,        // container/elementary stream packet production
+        STAGE_PARSE,        // CPU bitstream parse and decode submission
+        STAGE_DECODE,       // decode queue submission and flush
+        STAGE_DISPLAY,      // frame dequeue, output conversion and release
+        NUM_STAGES
+    };
+
+    static constexpr bool Enabled() { return VK_VIDEO_ALLOCATION_AUDIT != 0; }
+
+#if VK_VIDEO_ALLOCATION_AUDIT
+    // Called from the global operator new replacements (see
+    // VulkanAllocationAudit.cpp); counts against the calling thread's
+    // current stage tag.
+    static void OnAllocation(size_t size)
+    {
+        const int32_t stage = m_currentStage;
+        m_allocationCounts[stage].fetch_add(1, std::memory_order_relaxed);
+        m_allocationBytes[stage].fetch_add((uint64_t)size, std::memory_order_relaxed);
+    }
+
+    // Tags all allocations of the enclosing scope (on this thread) with the
+    // given stage; restores the previous tag on exit, so nested sections
+    // attribute correctly.
+    class StageScope {
+    public:
+        StageScope(Stage stage)
+            : m_previousStage(m_currentStage)
+        {
+            m_currentStage = stage;
+        }
+        ~StageScope()
+        {
+            m_currentStage = m_previousStage;
+        }
+    private:
+        int32_t m_previousStage;
+    };
+
+    // Re-tags the remainder of an already tagged scope - for functions that
+    // run several stages back to back (see
+    // VulkanVideoProcessor::ParserProcessNextDataChunk()).
+    static void SetStage(Stage stage) { m_currentStage = stage; }
+
+    // Per-frame audit line, driven by the consumer's frame counter. Frames
+    // within the warmup only advance the snapshot; past it, any frame whose
+    // allocation count moved prints the per-stage delta, so a verified
+    // zero-allocation steady state is simply a silent run.
+    static void ReportFrame(uint32_t frameNumber)
+    {
+        uint64_t counts[NUM_STAGES];
+        uint64_t totalDelta = 0;
+        for (int32_t stage = 0; stage < NUM_STAGES; stage++) {
+            counts[stage] = m_allocationCounts[stage].load(std::memory_order_relaxed);
+            totalDelta += counts[stage] - m_frameSnapshot[stage];
+        }
+        if ((frameNumber > VK_VIDEO_ALLOCATION_AUDIT_WARMUP_FRAMES) && (totalDelta != 0)) {
+            fprintf(stderr, "ALLOC-AUDIT: frame %u allocated %llu time(s):",
+                    frameNumber, (unsigned long long)totalDelta);
+            for (int32_t stage = 0; stage < NUM_STAGES; stage++) {
+                const uint64_t stageDelta = counts[stage] - m_frameSnapshot[stage];
+                if (stageDelta != 0) {
+                    fprintf(stderr, " %s %llu", StageName((Stage)stage),
+                            (unsigned long long)stageDelta);
+                }
+            }
+            fprintf(stderr, "\n");
+        }
+        for (int32_t stage = 0; stage < NUM_STAGES; stage++) {
+            m_frameSnapshot[stage] = counts[stage];
+        }
+    }
+
+    // Prints the whole-run per-stage totals (warmup included).
+    static void Report(std::ostream& outStr)
+    {
+        outStr << "Allocation audit totals:" << std::endl;
+        for (int32_t stage = 0; stage < NUM_STAGES; stage++) {
+            outStr << "\t" << StageName((Stage)stage) << ": "
+                   << m_allocationCounts[stage].load(std::memory_order_relaxed)
+                   << " allocations, "
+                   << m_allocationBytes[stage].load(std::memory_order_relaxed)
+                   << " bytes" << std::endl;
+        }
+    }
+
+private:
+    static const char* StageName(Stage stage)
+    {
+        switch (stage) {
+        case STAGE_DEMUX:   return "demux";
+        case STAGE_PARSE:   return "parse";
+        case STAGE_DECODE:  return "decode";
+        case STAGE_DISPLAY: return "display";
+        default:            return "untagged";
+        }
+    }
+
+    static inline thread_local int32_t m_currentStage = STAGE_UNTAGGED;
+    static inline std::atomic<uint64_t> m_allocationCounts[NUM_STAGES] = {};
+    static inline std::atomic<uint64_t> m_allocationBytes[NUM_STAGES] = {};
+    // Only touched from the consumer thread in ReportFrame().
+    static inline uint64_t m_frameSnapshot[NUM_STAGES] = {};
+#else
+    static void Report(std::ostream& outStr) { (void)outStr; }
+#endif
+};
+
+#if VK_VIDEO_ALLOCATION_AUDIT
+#define VK_VIDEO_ALLOC_AUDIT_SCOPE(stage) \
+    VulkanAllocationAudit::StageScope vkVideoAllocAuditScope(VulkanAllocationAudit::stage)
+#define VK_VIDEO_ALLOC_AUDIT_STAGE(stage) \
+    VulkanAllocationAudit::SetStage(VulkanAllocationAudit::stage)
+#define VK_VIDEO_ALLOC_AUDIT_FRAME(frameNumber) \
+    VulkanAllocationAudit::ReportFrame(frameNumber)
+#else
+#define VK_VIDEO_ALLOC_AUDIT_SCOPE(stage)      ((void)0)
+#define VK_VIDEO_ALLOC_AUDIT_STAGE(stage)      ((void)0)
+#define VK_VIDEO_ALLOC_AUDIT_FRAME(frameNumber) ((void)0)
+#endif
+
+#endif /* _VKCODECUTILS_VULKANALLOCATIONAUDIT_H_ */
@@ -0,0 +1,134 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "VkCodecUtils/VulkanCommandPoolShards.h"
+
+VulkanCommandPoolShards::RecordingContext::RecordingContext(const VulkanDeviceContext* vkDevCtx,
+                                                            uint32_t queueFamilyIndex,
+                                                            std::thread::id threadId)
+    : m_vkDevCtx(vkDevCtx)
+    , m_threadId(threadId)
+    , m_cmdPool()
+    , m_cmdBuffers()
+    , m_nextCmdBuffer(0)
+{
+    VkCommandPoolCreateInfo cmdPoolInfo = VkCommandPoolCreateInfo();
+    cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    cmdPoolInfo.queueFamilyIndex = queueFamilyIndex;
+    VkResult result = m_vkDevCtx->CreateCommandPool(*m_vkDevCtx, &cmdPoolInfo, nullptr, &m_cmdPool);
+    assert(result == VK_SUCCESS);
+    if (result != VK_SUCCESS) {
+        fprintf(stderr, "\nERROR: CreateCommandPool() result: 0x%x\n", result);
+    }
+}
+
+VulkanCommandPoolShards::RecordingContext::~RecordingContext()
+{
+    if (m_cmdPool != VkCommandPool()) {
+        if (!m_cmdBuffers.empty()) {
+            m_vkDevCtx->FreeCommandBuffers(*m_vkDevCtx, m_cmdPool,
+                                           (uint32_t)m_cmdBuffers.size(), m_cmdBuffers.data());
+            m_cmdBuffers.clear();
+        }
+        m_vkDevCtx->DestroyCommandPool(*m_vkDevCtx, m_cmdPool, nullptr);
+        m_cmdPool = VkCommandPool();
+    }
+}
+
+VkResult VulkanCommandPoolShards::RecordingContext::AllocateCommandBuffers(uint32_t numCommandBuffers,
+                                                                           VkCommandBuffer* commandBuffers)
+{
+    assert(std::this_thread::get_id() == m_threadId);
+
+    VkCommandBufferAllocateInfo cmdInfo = VkCommandBufferAllocateInfo();
+    cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmdInfo.commandBufferCount = numCommandBuffers;
+    cmdInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmdInfo.commandPool = m_cmdPool;
+
+    VkResult result = m_vkDevCtx->AllocateCommandBuffers(*m_vkDevCtx, &cmdInfo, commandBuffers);
+    assert(result == VK_SUCCESS);
+    if (result != VK_SUCCESS) {
+        fprintf(stderr, "\nERROR: AllocateCommandBuffers() result: 0x%x\n", result);
+    }
+    return result;
+}
+
+VkCommandBuffer VulkanCommandPoolShards::RecordingContext::AcquireCommandBuffer()
+{
+    assert(std::this_thread::get_id() == m_threadId);
+
+    if (m_nextCmdBuffer >= (uint32_t)m_cmdBuffers.size()) {
+        const size_t oldSize = m_cmdBuffers.size();
+        m_cmdBuffers.resize(oldSize + allocationChunkSize, VkCommandBuffer());
+        VkResult result = AllocateCommandBuffers(allocationChunkSize, m_cmdBuffers.data() + oldSize);
+        if (result != VK_SUCCESS) {
+            m_cmdBuffers.resize(oldSize);
+            return VkCommandBuffer();
+        }
+    }
+
+    return m_cmdBuffers[m_nextCmdBuffer++];
+}
+
+VkResult VulkanCommandPoolShards::RecordingContext::ResetAll(bool releaseResources)
+{
+    assert(std::this_thread::get_id() == m_threadId);
+
+    m_nextCmdBuffer = 0;
+    return m_vkDevCtx->ResetCommandPool(*m_vkDevCtx, m_cmdPool,
+                                        releaseResources ? (VkCommandPoolResetFlags)VK_COMMAND_POOL_RESET_RELEASE_RESOURCES_BIT :
+                                                           (VkCommandPoolResetFlags)0);
+}
+
+VkResult VulkanCommandPoolShards::Init(const VulkanDeviceContext* vkDevCtx, uint32_t queueFamilyIndex)
+{
+    assert(vkDevCtx != nullptr);
+    assert(m_contexts.empty());
+    m_vkDevCtx = vkDevCtx;
+    m_queueFamilyIndex = queueFamilyIndex;
+    return VK_SUCCESS;
+}
+
+void VulkanCommandPoolShards::Deinit()
+{
+    std::lock_guard<std::mutex> lock(m_contextsMutex);
+    m_contexts.clear();
+    m_vkDevCtx = nullptr;
+    m_queueFamilyIndex = (uint32_t)-1;
+}
+
+VulkanCommandPoolShards::RecordingContext* VulkanCommandPoolShards::GetRecordingContext()
+{
+    assert(IsInitialized());
+
+    const std::thread::id threadId = std::this_thread::get_id();
+
+    std::lock_guard<std::mutex> lock(m_contextsMutex);
+    for (auto& context : m_contexts) {
+        if (context->m_threadId == threadId) {
+            return context.get();
+        }
+    }
+
+    m_contexts.emplace_back(std::unique_ptr<RecordingContext>(
+            new RecordingContext(m_vkDevCtx, m_queueFamilyIndex, threadId)));
+    return m_contexts.back().get();
+}
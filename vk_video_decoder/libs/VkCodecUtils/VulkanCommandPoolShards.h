@@ -0,0 +1,119 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VKCODECUTILS_VULKANCOMMANDPOOLSHARDS_H_
+#define _VKCODECUTILS_VULKANCOMMANDPOOLSHARDS_H_
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "VkCodecUtils/VulkanDeviceContext.h"
+
+// Command pool sharding for one queue family: every recording thread gets
+// its own VkCommandPool - its recording context - created on the thread's
+// first use, so concurrent command recording never serializes on a shared
+// pool. A single-threaded user simply ends up with one shard and the same
+// driver-call pattern as a plain pool.
+//
+// Within a context, buffers are either acquired transiently
+// (AcquireCommandBuffer()) and recycled in bulk with a single
+// vkResetCommandPool() (ResetAll()) - the cheap periodic-reset recording
+// pattern - or allocated as long-lived per-slot buffers
+// (AllocateCommandBuffers()) that the caller re-begins itself; the pools
+// carry VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT for that. The two
+// styles should not be mixed in one context, since ResetAll() resets every
+// buffer of the shard's pool.
+//
+// The shards live until Deinit(); a context pointer stays valid for its
+// thread's lifetime and must only be used from the thread it was returned
+// to.
+class VulkanCommandPoolShards {
+public:
+
+    class RecordingContext {
+    public:
+        // The next free command buffer of this thread's shard, growing the
+        // shard by a fixed chunk when it is exhausted. The buffer stays
+        // owned by the shard and is recycled by the next ResetAll().
+        VkCommandBuffer AcquireCommandBuffer();
+
+        // Allocates numCommandBuffers long-lived command buffers for a
+        // caller with its own per-slot recycling (see NvVkDecodeFrameData).
+        VkResult AllocateCommandBuffers(uint32_t numCommandBuffers, VkCommandBuffer* commandBuffers);
+
+        // Bulk-recycles every buffer acquired from this context with one
+        // vkResetCommandPool(). The caller must know the buffers' GPU work
+        // has completed.
+        VkResult ResetAll(bool releaseResources = false);
+
+        VkCommandPool GetCommandPool() const { return m_cmdPool; }
+
+        ~RecordingContext();
+
+    private:
+        friend class VulkanCommandPoolShards;
+
+        static const uint32_t allocationChunkSize = 8;
+
+        RecordingContext(const VulkanDeviceContext* vkDevCtx,
+                         uint32_t queueFamilyIndex,
+                         std::thread::id threadId);
+
+        RecordingContext(const RecordingContext&) = delete;
+        RecordingContext& operator=(const RecordingContext&) = delete;
+
+        const VulkanDeviceContext*   m_vkDevCtx;
+        std::thread::id              m_threadId;
+        VkCommandPool                m_cmdPool;
+        std::vector<VkCommandBuffer> m_cmdBuffers;       // transient, recycled by ResetAll()
+        uint32_t                     m_nextCmdBuffer;
+    };
+
+    VulkanCommandPoolShards()
+        : m_vkDevCtx()
+        , m_queueFamilyIndex((uint32_t)-1)
+        , m_contextsMutex()
+        , m_contexts()
+    {
+    }
+
+    ~VulkanCommandPoolShards()
+    {
+        Deinit();
+    }
+
+    VkResult Init(const VulkanDeviceContext* vkDevCtx, uint32_t queueFamilyIndex);
+    void Deinit();
+
+    bool IsInitialized() const { return (m_vkDevCtx != nullptr); }
+
+    // The calling thread's recording context, created on the thread's first
+    // call. The lookup takes the shard mutex, but the only call site runs
+    // once per video sequence start (see NvVkDecodeFrameData::resize()), so
+    // it is never on the per-frame recording path.
+    RecordingContext* GetRecordingContext();
+
+private:
+    const VulkanDeviceContext* m_vkDevCtx;
+    uint32_t                   m_queueFamilyIndex;
+    // Only taken on a thread's first lookup and at Deinit().
+    std::mutex                 m_contextsMutex;
+    std::vector<std::unique_ptr<RecordingContext>> m_contexts;
+};
+
+#endif /* _VKCODECUTILS_VULKANCOMMANDPOOLSHARDS_H_ */
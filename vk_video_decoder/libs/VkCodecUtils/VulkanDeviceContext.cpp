@@ -27,8 +27,10 @@
 #include <sstream>
 #include <set>
 #include <algorithm>    // std::find_if
+#include <thread>       // std::this_thread::yield
 #include "VkCodecUtils/Helpers.h"
 #include "VkCodecUtils/VulkanDeviceContext.h"
+#include "VkCodecUtils/VulkanPerfCounters.h"
 
 #if !defined(VK_USE_PLATFORM_WIN32_KHR)
 PFN_vkGetInstanceProcAddr VulkanDeviceContext::LoadVk(VulkanLibraryHandleType &vulkanLibHandle,
@@ -206,13 +208,19 @@ static int DumpSoLibs()
 
 VkResult VulkanDeviceContext::InitVkInstance(const char * pAppName, bool verbose)
 {
-    VkResult result = CheckAllInstanceLayers(verbose);
-    if (result != VK_SUCCESS) {
-        return result;
-    }
-    result = CheckAllInstanceExtensions(verbose);
-    if (result != VK_SUCCESS) {
-        return result;
+    // With a validated startup snapshot the layer and extension pre-checks
+    // are skipped: vkCreateInstance() fails with the same error codes if the
+    // environment changed, and the fallback below reports the details.
+    VkResult result = VK_SUCCESS;
+    if (!m_startupCacheValid) {
+        result = CheckAllInstanceLayers(verbose);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        result = CheckAllInstanceExtensions(verbose);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
     }
 
     VkApplicationInfo app_info = {};
@@ -231,6 +239,15 @@ VkResult VulkanDeviceContext::InitVkInstance(const char * pAppName, bool verbose
 
     result = CreateInstance(&instance_info, nullptr, &m_instance);
 
+    if ((result != VK_SUCCESS) && m_startupCacheValid) {
+        // The snapshot is stale - drop it and run the full checks for
+        // proper diagnostics.
+        m_startupCacheValid = false;
+        CheckAllInstanceLayers(verbose);
+        CheckAllInstanceExtensions(verbose);
+        return result;
+    }
+
 #if !defined(VK_USE_PLATFORM_WIN32_KHR)
     // For debugging which .so libraries are loaded and in use
     if (false) {
@@ -309,6 +326,16 @@ VkResult VulkanDeviceContext::InitPhysicalDevice(const VkQueueFlags requestQueue
     }
 
     m_physDevice = VK_NULL_HANDLE;
+
+    if (m_startupCacheValid &&
+            TryRestoreFromStartupCache(requestQueueTypes, pWsiDisplay,
+                                       requestVideoDecodeQueueOperations,
+                                       requestVideoEncodeQueueOperations,
+                                       availablePhysicalDevices)) {
+        return VK_SUCCESS;
+    }
+
+    int32_t suitableDeviceOrdinal = 0;
     for (auto physicalDevice : availablePhysicalDevices) {
 
         VkPhysicalDeviceProperties props;
@@ -333,11 +360,21 @@ VkResult VulkanDeviceContext::InitPhysicalDevice(const VkQueueFlags requestQueue
             videoDecodeQueueFamily = -1,
             videoDecodeQueueCount  = 0,
             videoEncodeQueueFamily = -1,
-            videoEncodeQueueCount  = 0;
+            videoEncodeQueueCount  = 0,
+            transferQueueFamily = -1;
 
         for (uint32_t i = 0; i < queues.size(); i++) {
             const VkQueueFamilyProperties2 &queue = queues[i];
 
+            // A dedicated DMA queue family (transfer-only) is optional - it is
+            // used to overlap image copies with the other queues when present.
+            if ((transferQueueFamily < 0) &&
+                    (queue.queueFamilyProperties.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+                    ((queue.queueFamilyProperties.queueFlags &
+                            (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) == 0)) {
+                transferQueueFamily = i;
+            }
+
             if ((queue.queueFamilyProperties.queueFlags & requestQueueTypes) == 0) {
                 continue;
             }
@@ -380,6 +417,12 @@ VkResult VulkanDeviceContext::InitPhysicalDevice(const VkQueueFlags requestQueue
             if (((foundQueueTypes & requestQueueTypes) == requestQueueTypes) &&
                     ((pWsiDisplay == nullptr) || (presentQueueFamily >= 0))) {
 
+                if ((m_physicalDeviceIndex >= 0) && (suitableDeviceOrdinal++ != m_physicalDeviceIndex)) {
+                    // The device is suitable, but the caller asked for a later
+                    // one - keep looking (used by the multi-GPU sharding mode).
+                    break;
+                }
+
                 // Selected a physical device
                 m_physDevice = physicalDevice;
                 m_gfxQueueFamily = gfxQueueFamily;
@@ -388,6 +431,7 @@ VkResult VulkanDeviceContext::InitPhysicalDevice(const VkQueueFlags requestQueue
                 m_videoDecodeNumQueues = videoDecodeQueueCount;
                 m_videoEncodeQueueFamily = videoEncodeQueueFamily;
                 m_videoEncodeNumQueues = videoEncodeQueueCount;
+                m_transferQueueFamily = transferQueueFamily;
 
                 assert(m_physDevice != VK_NULL_HANDLE);
                 PopulateDeviceExtensions();
@@ -395,6 +439,12 @@ VkResult VulkanDeviceContext::InitPhysicalDevice(const VkQueueFlags requestQueue
                     PrintExtensions(true);
                 }
 
+                if (!m_startupCacheFile.empty()) {
+                    SaveStartupCache(requestQueueTypes,
+                                     requestVideoDecodeQueueOperations,
+                                     requestVideoEncodeQueueOperations);
+                }
+
                 return VK_SUCCESS;
             }
         }
@@ -457,11 +507,26 @@ VkResult VulkanDeviceContext::CreateVulkanDevice(int32_t numDecodeQueues, int32_
         devInfo.queueCreateInfoCount++;
     }
 
+    VkDeviceQueueGlobalPriorityCreateInfoKHR decodeQueueGlobalPriorityInfo = {};
     if (m_videoDecodeQueueFamily != -1) {
         queueInfo[devInfo.queueCreateInfoCount].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueInfo[devInfo.queueCreateInfoCount].queueFamilyIndex = m_videoDecodeQueueFamily;
         queueInfo[devInfo.queueCreateInfoCount].queueCount = numDecodeQueues;
         queueInfo[devInfo.queueCreateInfoCount].pQueuePriorities = queuePriorities.data();
+        if (m_videoDecodeGlobalPriority != VK_QUEUE_GLOBAL_PRIORITY_MEDIUM_KHR) {
+            // Raise the decode queues' scheduling priority against other
+            // processes (see SetVideoDecodeGlobalPriority()); the queue
+            // mutex gate handles the priorities within this process.
+            if ((FindDeviceExtension(VK_KHR_GLOBAL_PRIORITY_EXTENSION_NAME) != nullptr) ||
+                (FindDeviceExtension(VK_EXT_GLOBAL_PRIORITY_EXTENSION_NAME) != nullptr)) {
+                decodeQueueGlobalPriorityInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_GLOBAL_PRIORITY_CREATE_INFO_KHR;
+                decodeQueueGlobalPriorityInfo.globalPriority = m_videoDecodeGlobalPriority;
+                queueInfo[devInfo.queueCreateInfoCount].pNext = &decodeQueueGlobalPriorityInfo;
+            } else {
+                fprintf(stderr, "\nWARNING: VK_EXT_global_priority is not supported - "
+                                "the decode queues keep the default global priority.\n");
+            }
+        }
         devInfo.queueCreateInfoCount++;
     }
 
@@ -473,12 +538,30 @@ VkResult VulkanDeviceContext::CreateVulkanDevice(int32_t numDecodeQueues, int32_
         devInfo.queueCreateInfoCount++;
     }
 
+    if (m_transferQueueFamily != -1) {
+        queueInfo[devInfo.queueCreateInfoCount].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueInfo[devInfo.queueCreateInfoCount].queueFamilyIndex = m_transferQueueFamily;
+        queueInfo[devInfo.queueCreateInfoCount].queueCount = 1;
+        queueInfo[devInfo.queueCreateInfoCount].pQueuePriorities = queuePriorities.data();
+        devInfo.queueCreateInfoCount++;
+    }
+
     assert(devInfo.queueCreateInfoCount <= MAX_QUEUE_FAMILIES);
 
     devInfo.pQueueCreateInfos = queueInfo.data();
 
-    devInfo.enabledExtensionCount = static_cast<uint32_t>(m_reqDeviceExtensions.size());
-    devInfo.ppEnabledExtensionNames = m_reqDeviceExtensions.data();
+    // The optional extensions are enabled only when the selected physical
+    // device supports them; the required ones were already checked during
+    // the physical device selection.
+    m_enabledDeviceExtensions = m_reqDeviceExtensions;
+    for (const auto& name : m_optDeviceExtensions) {
+        if (FindDeviceExtension(name) != nullptr) {
+            m_enabledDeviceExtensions.push_back(name);
+        }
+    }
+
+    devInfo.enabledExtensionCount = static_cast<uint32_t>(m_enabledDeviceExtensions.size());
+    devInfo.ppEnabledExtensionNames = m_enabledDeviceExtensions.data();
 
     // disable all features
     VkPhysicalDeviceFeatures features = {};
@@ -514,11 +597,16 @@ VkResult VulkanDeviceContext::CreateVulkanDevice(int32_t numDecodeQueues, int32_
         }
     }
 
+    if (GetTransferQueueFamilyIdx() != -1) {
+        GetDeviceQueue(m_device, GetTransferQueueFamilyIdx(), 0, &m_transferQueue);
+    }
+
     return result;
 }
 
-VulkanDeviceContext::VulkanDeviceContext(uint32_t deviceId)
+VulkanDeviceContext::VulkanDeviceContext(uint32_t deviceId, int32_t physicalDeviceIndex)
     : m_deviceId(deviceId)
+    , m_physicalDeviceIndex(physicalDeviceIndex)
     , m_libHandle()
     , m_instance()
     , m_physDevice()
@@ -530,11 +618,18 @@ VulkanDeviceContext::VulkanDeviceContext(uint32_t deviceId)
     , m_videoDecodeNumQueues(0)
     , m_videoEncodeQueueFamily(-1)
     , m_videoEncodeNumQueues(0)
+    , m_transferQueueFamily(-1)
     , m_device()
     , m_gfxQueue()
     , m_presentQueue()
+    , m_transferQueue()
+    , m_videoDecodeRealtimeWaiters{}
+    , m_videoDecodeGlobalPriority(VK_QUEUE_GLOBAL_PRIORITY_MEDIUM_KHR)
     , m_isExternallyManagedDevice()
     , m_debugReport()
+    , m_startupCacheFile()
+    , m_startupCacheData()
+    , m_startupCacheValid(false)
 {
 
 }
@@ -544,6 +639,55 @@ void VulkanDeviceContext::DeviceWaitIdle() const
     vk::VkInterfaceFunctions::DeviceWaitIdle(m_device);
 }
 
+VkResult VulkanDeviceContext::MultiThreadedQueueSubmitBatchQos(const QueueFamilySubmitType submitType, const int32_t queueIndex,
+                                                               bool realtimeSubmit,
+                                                               uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence,
+                                                               uint32_t signalOnlyFenceCount,
+                                                               const VkFence* pSignalOnlyFences) const
+{
+    if (submitType != DECODE) {
+        // Only the decode queues carry QoS classes.
+        return MultiThreadedQueueSubmitBatch(submitType, queueIndex, submitCount, pSubmits, fence,
+                                             signalOnlyFenceCount, pSignalOnlyFences);
+    }
+
+    assert((queueIndex >= 0) && (queueIndex < m_videoDecodeNumQueues));
+    std::mutex* queueMutex = (std::mutex*)&m_videoDecodeQueueMutexes[queueIndex];
+    std::atomic<int32_t>& realtimeWaiters = m_videoDecodeRealtimeWaiters[queueIndex];
+
+    if (realtimeSubmit) {
+        // Announce the pending realtime submission before taking the mutex,
+        // so concurrent best-effort submitters back off instead of queueing
+        // up on the mutex ahead of it.
+        realtimeWaiters++;
+        if (!queueMutex->try_lock()) {
+            // The queue is busy issuing another submission - at most that one
+            // is ahead of this realtime submission.
+            VulkanPerfCounters::Get().Add(VulkanPerfCounters::QOS_REALTIME_BLOCKED);
+            queueMutex->lock();
+        }
+    } else {
+        if (realtimeWaiters.load(std::memory_order_relaxed) > 0) {
+            VulkanPerfCounters::Get().Add(VulkanPerfCounters::QOS_SUBMITS_DEFERRED);
+            do {
+                std::this_thread::yield();
+            } while (realtimeWaiters.load(std::memory_order_relaxed) > 0);
+        }
+        queueMutex->lock();
+    }
+
+    VkResult result = QueueSubmit(m_videoDecodeQueues[queueIndex], submitCount, pSubmits, fence);
+    for (uint32_t i = 0; (result == VK_SUCCESS) && (i < signalOnlyFenceCount); i++) {
+        result = QueueSubmit(m_videoDecodeQueues[queueIndex], 0, nullptr, pSignalOnlyFences[i]);
+    }
+
+    if (realtimeSubmit) {
+        realtimeWaiters--;
+    }
+    queueMutex->unlock();
+    return result;
+}
+
 VulkanDeviceContext::~VulkanDeviceContext() {
 
     if (m_device) {
@@ -627,6 +771,140 @@ VkResult VulkanDeviceContext::PopulateInstanceExtensions()
     return result;
 }
 
+void VulkanDeviceContext::SetStartupCacheFile(const std::string& cacheFileName)
+{
+    m_startupCacheFile = cacheFileName;
+    m_startupCacheValid = false;
+
+    if (m_startupCacheFile.empty()) {
+        return;
+    }
+
+    FILE* cacheFile = fopen(m_startupCacheFile.c_str(), "rt");
+    if (cacheFile == nullptr) {
+        // First run - the snapshot is written after the device selection.
+        return;
+    }
+
+    StartupCacheData& cache = m_startupCacheData;
+    uint32_t version = 0;
+    bool valid = (fscanf(cacheFile, "vulkanVideoStartupCache %u\n", &version) == 1) &&
+                 (version == 1);
+
+    valid = valid && (fscanf(cacheFile, "%x %x %x\n", &cache.vendorID, &cache.deviceID,
+                             &cache.driverVersion) == 3);
+
+    for (uint32_t i = 0; valid && (i < VK_UUID_SIZE); i++) {
+        uint32_t uuidByte = 0;
+        valid = (fscanf(cacheFile, "%2x", &uuidByte) == 1);
+        cache.pipelineCacheUUID[i] = (uint8_t)uuidByte;
+    }
+
+    valid = valid && (fscanf(cacheFile, "\n%x %x %x\n", &cache.requestedQueueTypes,
+                             &cache.requestedDecodeOperations,
+                             &cache.requestedEncodeOperations) == 3);
+
+    valid = valid && (fscanf(cacheFile, "%d %d %d %d %d %d %d\n",
+                             &cache.gfxQueueFamily, &cache.presentQueueFamily,
+                             &cache.videoDecodeQueueFamily, &cache.videoDecodeNumQueues,
+                             &cache.videoEncodeQueueFamily, &cache.videoEncodeNumQueues,
+                             &cache.transferQueueFamily) == 7);
+
+    fclose(cacheFile);
+    m_startupCacheValid = valid;
+}
+
+void VulkanDeviceContext::SaveStartupCache(VkQueueFlags requestQueueTypes,
+                                           VkVideoCodecOperationFlagsKHR requestVideoDecodeQueueOperations,
+                                           VkVideoCodecOperationFlagsKHR requestVideoEncodeQueueOperations) const
+{
+    VkPhysicalDeviceProperties props;
+    GetPhysicalDeviceProperties(m_physDevice, &props);
+
+    FILE* cacheFile = fopen(m_startupCacheFile.c_str(), "wt");
+    if (cacheFile == nullptr) {
+        fprintf(stderr, "\nWARNING: could not write the device startup cache %s\n",
+                m_startupCacheFile.c_str());
+        return;
+    }
+
+    fprintf(cacheFile, "vulkanVideoStartupCache 1\n");
+    fprintf(cacheFile, "%x %x %x\n", props.vendorID, props.deviceID, props.driverVersion);
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+        fprintf(cacheFile, "%02x", props.pipelineCacheUUID[i]);
+    }
+    fprintf(cacheFile, "\n%x %x %x\n", (uint32_t)requestQueueTypes,
+            (uint32_t)requestVideoDecodeQueueOperations,
+            (uint32_t)requestVideoEncodeQueueOperations);
+    fprintf(cacheFile, "%d %d %d %d %d %d %d\n",
+            m_gfxQueueFamily, m_presentQueueFamily,
+            m_videoDecodeQueueFamily, m_videoDecodeNumQueues,
+            m_videoEncodeQueueFamily, m_videoEncodeNumQueues,
+            m_transferQueueFamily);
+    fclose(cacheFile);
+}
+
+bool VulkanDeviceContext::TryRestoreFromStartupCache(VkQueueFlags requestQueueTypes,
+                                                     const VkWsiDisplay* pWsiDisplay,
+                                                     VkVideoCodecOperationFlagsKHR requestVideoDecodeQueueOperations,
+                                                     VkVideoCodecOperationFlagsKHR requestVideoEncodeQueueOperations,
+                                                     const std::vector<VkPhysicalDevice>& availablePhysicalDevices)
+{
+    // Present support can not be validated from the snapshot alone, and the
+    // multi-GPU ordinal selection always needs the full enumeration.
+    if ((pWsiDisplay != nullptr) || (m_physicalDeviceIndex >= 0)) {
+        return false;
+    }
+
+    const StartupCacheData& cache = m_startupCacheData;
+    if ((cache.requestedQueueTypes != (uint32_t)requestQueueTypes) ||
+            (cache.requestedDecodeOperations != (uint32_t)requestVideoDecodeQueueOperations) ||
+            (cache.requestedEncodeOperations != (uint32_t)requestVideoEncodeQueueOperations)) {
+        return false;
+    }
+
+    for (auto physicalDevice : availablePhysicalDevices) {
+
+        VkPhysicalDeviceProperties props;
+        GetPhysicalDeviceProperties(physicalDevice, &props);
+        if ((m_deviceId != (uint32_t)-1) && (props.deviceID != m_deviceId)) {
+            continue;
+        }
+
+        if ((props.vendorID != cache.vendorID) ||
+                (props.deviceID != cache.deviceID) ||
+                (props.driverVersion != cache.driverVersion) ||
+                (memcmp(props.pipelineCacheUUID, cache.pipelineCacheUUID, VK_UUID_SIZE) != 0)) {
+            continue;
+        }
+
+        // Adopt the cached queue family topology instead of re-probing it.
+        m_physDevice = physicalDevice;
+        m_gfxQueueFamily = cache.gfxQueueFamily;
+        m_presentQueueFamily = cache.presentQueueFamily;
+        m_videoDecodeQueueFamily = cache.videoDecodeQueueFamily;
+        m_videoDecodeNumQueues = cache.videoDecodeNumQueues;
+        m_videoEncodeQueueFamily = cache.videoEncodeQueueFamily;
+        m_videoEncodeNumQueues = cache.videoEncodeNumQueues;
+        m_transferQueueFamily = cache.transferQueueFamily;
+
+        // A single-device extension query is still needed for the optional
+        // extension checks in CreateVulkanDevice(); it also validates the
+        // required extensions cheaply against the populated list.
+        PopulateDeviceExtensions();
+        for (const auto& name : m_reqDeviceExtensions) {
+            if (FindDeviceExtension(name) == nullptr) {
+                m_physDevice = VK_NULL_HANDLE;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
 VkResult VulkanDeviceContext::PopulateDeviceExtensions()
 {
     uint32_t extensions_count = 0;
@@ -18,8 +18,11 @@
 #define _VULKANDEVICECONTEXT_H_
 
 #include <assert.h>
+#include <string.h>
+#include <string>
 #include <vector>
 #include <array>
+#include <atomic>
 #include <mutex>
 #include <vulkan_interfaces.h>
 #include <VkCodecUtils/HelpersDispatchTable.h>
@@ -39,14 +42,19 @@ public:
     enum QueueFamilySubmitType {
         DECODE = VK_QUEUE_VIDEO_DECODE_BIT_KHR,
         ENCODE = VK_QUEUE_VIDEO_ENCODE_BIT_KHR,
+        TRANSFER = VK_QUEUE_TRANSFER_BIT,
     };
 
     enum {
         MAX_QUEUE_INSTANCES = 8,
-        MAX_QUEUE_FAMILIES = 4, // Gfx, Present, Decode, Encode
+        MAX_QUEUE_FAMILIES = 5, // Gfx, Present, Decode, Encode, Transfer
     };
 
-    VulkanDeviceContext(uint32_t deviceId = (uint32_t)-1);
+    // deviceId filters the physical devices by VkPhysicalDeviceProperties
+    // deviceID; physicalDeviceIndex selects the N-th suitable physical
+    // device, so multiple contexts can shard the GPUs of a multi-GPU host
+    // (see the --multiGpu mode). -1 takes the first suitable device.
+    VulkanDeviceContext(uint32_t deviceId = (uint32_t)-1, int32_t physicalDeviceIndex = -1);
 
     VkInstance getInstance() const {
         return m_instance;
@@ -71,6 +79,10 @@ public:
     int32_t GetVideoEncodeQueueFamilyIdx() const { return m_videoEncodeQueueFamily; }
     int32_t GetVideoEncodeNumQueues() const { return m_videoEncodeNumQueues; }
     VkQueue GetVideoEncodeQueue(int32_t index = 0) const { return m_videoEncodeQueues[index]; }
+    // A dedicated DMA queue family (transfer without graphics/compute), when
+    // the device has one. -1 / NULL otherwise.
+    int32_t GetTransferQueueFamilyIdx() const { return m_transferQueueFamily; }
+    VkQueue GetTransferQueue() const { return m_transferQueue; }
 
     class MtQueueMutex {
 
@@ -85,6 +97,9 @@ public:
                 assert((queueIndex >= 0) && (queueIndex < devCtx.m_videoEncodeNumQueues));
                 m_queue = &devCtx.m_videoEncodeQueues[queueIndex];
                 m_mutex = &devCtx.m_videoEncodeQueueMutexes[queueIndex];
+            } else if (submitType == TRANSFER) {
+                m_queue = &devCtx.m_transferQueue;
+                m_mutex = &devCtx.m_transferQueueMutexes;
             } else {
                 m_queue = nullptr;
                 m_mutex = &devCtx.m_gfxQueueMutexes;
@@ -123,6 +138,40 @@ public:
         }
     }
 
+    // Submits a batch of submit infos with a single fence, followed by extra
+    // fence-only submissions, all under a single queue-mutex acquisition.
+    // A fence-only submission signals when all the work previously submitted
+    // to the queue has completed. The batched decode submission path uses
+    // this to keep the per-frame fences valid while issuing one real
+    // vkQueueSubmit per batch.
+    VkResult MultiThreadedQueueSubmitBatch(const QueueFamilySubmitType submitType, const int32_t queueIndex,
+                                           uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence,
+                                           uint32_t signalOnlyFenceCount, const VkFence* pSignalOnlyFences) const
+    {
+        MtQueueMutex queue(*this, submitType, queueIndex);
+        if (!queue) {
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+        VkResult result = QueueSubmit(queue, submitCount, pSubmits, fence);
+        for (uint32_t i = 0; (result == VK_SUCCESS) && (i < signalOnlyFenceCount); i++) {
+            result = QueueSubmit(queue, 0, nullptr, pSignalOnlyFences[i]);
+        }
+        return result;
+    }
+
+    // Priority-aware variant of MultiThreadedQueueSubmitBatch() for the
+    // decode queues (see VkVideoDecoder::Create()'s realtimePriority). A
+    // realtime submission announces itself before taking the queue mutex and
+    // best-effort submissions yield while one is pending, so a realtime
+    // stream sharing a queue instance with best-effort streams waits behind
+    // at most the submission already being issued. Deferral and blocking
+    // events feed the QOS_* runtime counters (see VulkanPerfCounters).
+    VkResult MultiThreadedQueueSubmitBatchQos(const QueueFamilySubmitType submitType, const int32_t queueIndex,
+                                              bool realtimeSubmit,
+                                              uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence fence,
+                                              uint32_t signalOnlyFenceCount = 0,
+                                              const VkFence* pSignalOnlyFences = nullptr) const;
+
     VkResult MultiThreadedQueueWaitIdle(const QueueFamilySubmitType submitType, const int32_t queueIndex) const
     {
         MtQueueMutex queue(*this, submitType, queueIndex);
@@ -160,6 +209,24 @@ public:
         return (int32_t)m_reqDeviceExtensions.size();
     }
 
+    // Optional device extensions are enabled by CreateVulkanDevice() only
+    // when the selected physical device supports them; a device without the
+    // extension is still accepted, unlike with the required extensions.
+    int32_t AddOptionalDeviceExtension(const char* deviceExtensionName) {
+        m_optDeviceExtensions.push_back(deviceExtensionName);
+        return (int32_t)m_optDeviceExtensions.size();
+    }
+
+    // Whether the extension was actually enabled on the created device.
+    bool IsDeviceExtensionEnabled(const char* deviceExtensionName) const {
+        for (const auto& name : m_enabledDeviceExtensions) {
+            if (strcmp(name, deviceExtensionName) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     const VkExtensionProperties* FindExtension(
         const std::vector<VkExtensionProperties>& extensions,
         const char* name) const;
@@ -201,7 +268,28 @@ public:
                                                                    VK_VIDEO_CODEC_OPERATION_ENCODE_H265_BIT_EXT));
 
     VkResult CreateVulkanDevice(int32_t numDecodeQueues = 1, int32_t numEncodeQueues = 1);
+
+    // Requests a VK_EXT_global_priority level for the video decode queues of
+    // the device created by CreateVulkanDevice(), so realtime decode streams
+    // also hold their deadlines against other processes on the GPU. Must be
+    // called before CreateVulkanDevice(); the default (medium) adds nothing
+    // to the queue creation and a device without the extension keeps the
+    // default priority with a warning.
+    void SetVideoDecodeGlobalPriority(VkQueueGlobalPriorityKHR globalPriority) {
+        m_videoDecodeGlobalPriority = globalPriority;
+    }
     VkResult InitDebugReport(bool validate = false, bool validateVerbose = false);
+
+    // Optional warm-start snapshot (see ProgramConfig::deviceStartupCacheFile):
+    // after the first successful physical-device selection the chosen device's
+    // identity (pipeline cache UUID, IDs, driver version) and queue family
+    // topology are saved to cacheFileName. Later runs match the snapshot
+    // against the enumerated devices' identity only and skip the per-device
+    // extension and queue family probing, as well as the instance layer and
+    // extension pre-checks - cutting the startup enumeration time for
+    // short-lived worker processes. A stale snapshot (driver update, changed
+    // request) falls back to the full enumeration transparently.
+    void SetStartupCacheFile(const std::string& cacheFileName);
 private:
 
     static PFN_vkGetInstanceProcAddr LoadVk(VulkanLibraryHandleType &vulkanLibHandle,
@@ -213,8 +301,36 @@ private:
 
     VkResult PopulateDeviceExtensions();
 
+    // Startup snapshot helpers (see SetStartupCacheFile()).
+    void SaveStartupCache(VkQueueFlags requestQueueTypes,
+                          VkVideoCodecOperationFlagsKHR requestVideoDecodeQueueOperations,
+                          VkVideoCodecOperationFlagsKHR requestVideoEncodeQueueOperations) const;
+    bool TryRestoreFromStartupCache(VkQueueFlags requestQueueTypes,
+                                    const VkWsiDisplay* pWsiDisplay,
+                                    VkVideoCodecOperationFlagsKHR requestVideoDecodeQueueOperations,
+                                    VkVideoCodecOperationFlagsKHR requestVideoEncodeQueueOperations,
+                                    const std::vector<VkPhysicalDevice>& availablePhysicalDevices);
+
+    struct StartupCacheData {
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t  pipelineCacheUUID[VK_UUID_SIZE];
+        uint32_t requestedQueueTypes;
+        uint32_t requestedDecodeOperations;
+        uint32_t requestedEncodeOperations;
+        int32_t  gfxQueueFamily;
+        int32_t  presentQueueFamily;
+        int32_t  videoDecodeQueueFamily;
+        int32_t  videoDecodeNumQueues;
+        int32_t  videoEncodeQueueFamily;
+        int32_t  videoEncodeNumQueues;
+        int32_t  transferQueueFamily;
+    };
+
 private:
     uint32_t   m_deviceId;
+    int32_t    m_physicalDeviceIndex;
     VulkanLibraryHandleType m_libHandle;
     VkInstance m_instance;
     VkPhysicalDevice m_physDevice;
@@ -226,21 +342,36 @@ private:
     int32_t m_videoDecodeNumQueues;
     int32_t m_videoEncodeQueueFamily;
     int32_t m_videoEncodeNumQueues;
+    int32_t m_transferQueueFamily;
     VkDevice                m_device;
     VkQueue                 m_gfxQueue;
     VkQueue                 m_presentQueue;
+    VkQueue                 m_transferQueue;
     std::vector<VkQueue>    m_videoDecodeQueues;
     std::vector<VkQueue>    m_videoEncodeQueues;
     std::mutex                                  m_gfxQueueMutexes;
+    std::mutex                                  m_transferQueueMutexes;
     std::array<std::mutex, MAX_QUEUE_INSTANCES> m_videoDecodeQueueMutexes;
     std::array<std::mutex, MAX_QUEUE_INSTANCES> m_videoEncodeQueueMutexes;
+    // Pending realtime decode submissions per decode queue instance (see
+    // MultiThreadedQueueSubmitBatchQos()).
+    mutable std::array<std::atomic<int32_t>, MAX_QUEUE_INSTANCES> m_videoDecodeRealtimeWaiters;
+    // Global priority requested for the decode queues at device creation
+    // (see SetVideoDecodeGlobalPriority()).
+    VkQueueGlobalPriorityKHR m_videoDecodeGlobalPriority;
     bool m_isExternallyManagedDevice;
     VkDebugReportCallbackEXT           m_debugReport;
     std::vector<const char *>          m_reqInstanceLayers;
     std::vector<const char *>          m_reqInstanceExtensions;
     std::vector<const char *>          m_reqDeviceExtensions;
+    std::vector<const char *>          m_optDeviceExtensions;
+    std::vector<const char *>          m_enabledDeviceExtensions;
     std::vector<VkExtensionProperties> m_instanceExtensions;
     std::vector<VkExtensionProperties> m_deviceExtensions;
+    // Warm-start snapshot state (see SetStartupCacheFile()).
+    std::string      m_startupCacheFile;
+    StartupCacheData m_startupCacheData;
+    bool             m_startupCacheValid;
 };
 
 #endif /* _VULKANDEVICECONTEXT_H_ */
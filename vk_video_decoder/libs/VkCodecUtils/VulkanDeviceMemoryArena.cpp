@@ -0,0 +1,279 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <algorithm>
+#include <map>
+#include "VkCodecUtils/VulkanDeviceMemoryArena.h"
+#include "VkCodecUtils/Helpers.h"
+
+// Registry of the per-device arenas. The registry holds plain pointers - the
+// arena's lifetime is driven by its clients' references and the destructor
+// unregisters the arena, both under s_arenaRegistryMutex, so a concurrent
+// GetOrCreateArena() can never resurrect an arena that is being destroyed.
+static std::mutex s_arenaRegistryMutex;
+static std::map<const VulkanDeviceContext*, VulkanDeviceMemoryArena*> s_arenaRegistry;
+
+VkResult VulkanDeviceMemoryArena::GetOrCreateArena(const VulkanDeviceContext* vkDevCtx,
+                                                   VkSharedBaseObj<VulkanDeviceMemoryArena>& memoryArena)
+{
+    std::lock_guard<std::mutex> lock(s_arenaRegistryMutex);
+
+    auto arenaEntry = s_arenaRegistry.find(vkDevCtx);
+    if (arenaEntry != s_arenaRegistry.end()) {
+        memoryArena = arenaEntry->second;
+        return VK_SUCCESS;
+    }
+
+    VulkanDeviceMemoryArena* newArena = new VulkanDeviceMemoryArena(vkDevCtx);
+    if (newArena == nullptr) {
+        assert(!"Couldn't allocate host memory!");
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    s_arenaRegistry[vkDevCtx] = newArena;
+    memoryArena = newArena;
+    return VK_SUCCESS;
+}
+
+int32_t VulkanDeviceMemoryArena::Release()
+{
+    std::lock_guard<std::mutex> lock(s_arenaRegistryMutex);
+    uint32_t ret = --m_refCount;
+    // Destroy the arena if ref-count reaches zero
+    if (ret == 0) {
+        s_arenaRegistry.erase(m_vkDevCtx);
+        delete this;
+    }
+    return ret;
+}
+
+VulkanDeviceMemoryArena::VulkanDeviceMemoryArena(const VulkanDeviceContext* vkDevCtx)
+    : m_refCount(0)
+    , m_vkDevCtx(vkDevCtx)
+    , m_bufferImageGranularity(1)
+    , m_nonCoherentAtomSize(1)
+    , m_mutex()
+    , m_blocks()
+{
+    VkPhysicalDeviceProperties deviceProperties;
+    m_vkDevCtx->GetPhysicalDeviceProperties(m_vkDevCtx->getPhysicalDevice(), &deviceProperties);
+    m_bufferImageGranularity = deviceProperties.limits.bufferImageGranularity;
+    m_nonCoherentAtomSize    = deviceProperties.limits.nonCoherentAtomSize;
+}
+
+VulkanDeviceMemoryArena::~VulkanDeviceMemoryArena()
+{
+    for (size_t blockIndex = 0; blockIndex < m_blocks.size(); blockIndex++) {
+        MemoryBlock& block = m_blocks[blockIndex];
+        assert(block.usedSlices.empty());
+        if (block.mappedDataPtr != nullptr) {
+            m_vkDevCtx->UnmapMemory(*m_vkDevCtx, block.memory);
+            block.mappedDataPtr = nullptr;
+        }
+        if (block.memory != VK_NULL_HANDLE) {
+            m_vkDevCtx->FreeMemory(*m_vkDevCtx, block.memory, nullptr);
+            block.memory = VK_NULL_HANDLE;
+        }
+    }
+    m_blocks.clear();
+}
+
+VkDeviceSize VulkanDeviceMemoryArena::GetSliceAlignment(VkDeviceSize alignment) const
+{
+    // Aligning every slice to the bufferImageGranularity allows linear and
+    // optimal resources to share a block, and aligning to the
+    // nonCoherentAtomSize keeps host flush/invalidate ranges of one slice
+    // away from its neighbors.
+    alignment = std::max(alignment, m_bufferImageGranularity);
+    alignment = std::max(alignment, m_nonCoherentAtomSize);
+    return alignment;
+}
+
+VkResult VulkanDeviceMemoryArena::CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize blockSize,
+                                              bool hostVisible, size_t& blockIndex)
+{
+    VkMemoryAllocateInfo allocInfo = VkMemoryAllocateInfo();
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = blockSize;
+    allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+    VkDeviceMemory blockMemory = VK_NULL_HANDLE;
+    VkResult result = m_vkDevCtx->AllocateMemory(*m_vkDevCtx, &allocInfo, nullptr, &blockMemory);
+    if (result != VK_SUCCESS) {
+        assert(!"Couldn't allocate an arena memory block!");
+        return result;
+    }
+
+    uint8_t* mappedDataPtr = nullptr;
+    if (hostVisible) {
+        result = m_vkDevCtx->MapMemory(*m_vkDevCtx, blockMemory, 0, blockSize, 0,
+                                       (void**)&mappedDataPtr);
+        if ((result != VK_SUCCESS) || (mappedDataPtr == nullptr)) {
+            m_vkDevCtx->FreeMemory(*m_vkDevCtx, blockMemory, nullptr);
+            assert(!"Couldn't MapMemory()!");
+            return (result != VK_SUCCESS) ? result : VK_ERROR_MEMORY_MAP_FAILED;
+        }
+    }
+
+    MemoryBlock newBlock = MemoryBlock();
+    newBlock.memory = blockMemory;
+    newBlock.memoryTypeIndex = memoryTypeIndex;
+    newBlock.size = blockSize;
+    newBlock.mappedDataPtr = mappedDataPtr;
+    newBlock.freeSlices.push_back(MemorySlice{ 0, blockSize });
+
+    blockIndex = m_blocks.size();
+    m_blocks.push_back(newBlock);
+    return VK_SUCCESS;
+}
+
+bool VulkanDeviceMemoryArena::AllocateFromBlock(MemoryBlock& block, VkDeviceSize size,
+                                                VkDeviceSize alignment, VkDeviceSize& sliceOffset)
+{
+    // First-fit over the free list. The aligned slice is cut out of the
+    // middle of the free slice it lands in; the remainders, if any, stay on
+    // the free list.
+    for (size_t freeIndex = 0; freeIndex < block.freeSlices.size(); freeIndex++) {
+
+        const MemorySlice freeSlice = block.freeSlices[freeIndex];
+        const VkDeviceSize alignedOffset = (freeSlice.offset + (alignment - 1)) & ~(alignment - 1);
+        if ((alignedOffset + size) > (freeSlice.offset + freeSlice.size)) {
+            continue;
+        }
+
+        block.freeSlices.erase(block.freeSlices.begin() + freeIndex);
+        if (alignedOffset > freeSlice.offset) {
+            block.freeSlices.push_back(MemorySlice{ freeSlice.offset,
+                                                    alignedOffset - freeSlice.offset });
+        }
+        const VkDeviceSize tailOffset = alignedOffset + size;
+        if (tailOffset < (freeSlice.offset + freeSlice.size)) {
+            block.freeSlices.push_back(MemorySlice{ tailOffset,
+                                                    (freeSlice.offset + freeSlice.size) - tailOffset });
+        }
+
+        block.usedSlices.push_back(MemorySlice{ alignedOffset, size });
+        sliceOffset = alignedOffset;
+        return true;
+    }
+
+    return false;
+}
+
+VkResult VulkanDeviceMemoryArena::AllocateSlice(const VkMemoryRequirements& memoryRequirements,
+                                                VkMemoryPropertyFlags& memoryPropertyFlags,
+                                                VkDeviceMemory& deviceMemory,
+                                                VkDeviceSize&   deviceMemoryOffset,
+                                                uint8_t**       ppMappedSliceData)
+{
+    uint32_t memoryTypeIndex = 0;
+    VkResult mapResult = MapMemoryTypeToIndexWithFallback(m_vkDevCtx, m_vkDevCtx->getPhysicalDevice(),
+                                                          memoryRequirements.memoryTypeBits,
+                                                          memoryPropertyFlags,
+                                                          &memoryTypeIndex);
+    if (mapResult != VK_SUCCESS) {
+        assert(!"Couldn't map the requested memory type!");
+        return mapResult;
+    }
+    const bool hostVisible = ((memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0);
+
+    const VkDeviceSize sliceAlignment = GetSliceAlignment(memoryRequirements.alignment);
+    const VkDeviceSize sliceSize = (memoryRequirements.size + (sliceAlignment - 1)) & ~(sliceAlignment - 1);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    VkDeviceSize sliceOffset = 0;
+    for (size_t blockIndex = 0; blockIndex < m_blocks.size(); blockIndex++) {
+        MemoryBlock& block = m_blocks[blockIndex];
+        if (block.memoryTypeIndex != memoryTypeIndex) {
+            continue;
+        }
+        if (AllocateFromBlock(block, sliceSize, sliceAlignment, sliceOffset)) {
+            deviceMemory = block.memory;
+            deviceMemoryOffset = sliceOffset;
+            *ppMappedSliceData = (block.mappedDataPtr != nullptr) ?
+                                     (block.mappedDataPtr + sliceOffset) : nullptr;
+            return VK_SUCCESS;
+        }
+    }
+
+    // No block of this memory type has room - grow the arena. Oversize
+    // requests get a block of their own size.
+    const VkDeviceSize blockSize = std::max<VkDeviceSize>(DefaultBlockSize, sliceSize);
+    size_t blockIndex = 0;
+    VkResult result = CreateBlock(memoryTypeIndex, blockSize, hostVisible, blockIndex);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    MemoryBlock& newBlock = m_blocks[blockIndex];
+    if (!AllocateFromBlock(newBlock, sliceSize, sliceAlignment, sliceOffset)) {
+        assert(!"Couldn't suballocate from a new arena block!");
+        return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+    }
+
+    deviceMemory = newBlock.memory;
+    deviceMemoryOffset = sliceOffset;
+    *ppMappedSliceData = (newBlock.mappedDataPtr != nullptr) ?
+                             (newBlock.mappedDataPtr + sliceOffset) : nullptr;
+    return VK_SUCCESS;
+}
+
+void VulkanDeviceMemoryArena::FreeSlice(VkDeviceMemory deviceMemory, VkDeviceSize deviceMemoryOffset)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (size_t blockIndex = 0; blockIndex < m_blocks.size(); blockIndex++) {
+        MemoryBlock& block = m_blocks[blockIndex];
+        if (block.memory != deviceMemory) {
+            continue;
+        }
+
+        for (size_t usedIndex = 0; usedIndex < block.usedSlices.size(); usedIndex++) {
+            if (block.usedSlices[usedIndex].offset != deviceMemoryOffset) {
+                continue;
+            }
+
+            MemorySlice freedSlice = block.usedSlices[usedIndex];
+            block.usedSlices.erase(block.usedSlices.begin() + usedIndex);
+
+            // Merge with adjacent free slices before putting the freed slice
+            // back on the free list.
+            for (size_t freeIndex = 0; freeIndex < block.freeSlices.size(); /* advanced below */) {
+                const MemorySlice& freeSlice = block.freeSlices[freeIndex];
+                if ((freeSlice.offset + freeSlice.size) == freedSlice.offset) {
+                    freedSlice.offset = freeSlice.offset;
+                    freedSlice.size += freeSlice.size;
+                    block.freeSlices.erase(block.freeSlices.begin() + freeIndex);
+                    freeIndex = 0; // the merged slice may now touch another free slice
+                } else if ((freedSlice.offset + freedSlice.size) == freeSlice.offset) {
+                    freedSlice.size += freeSlice.size;
+                    block.freeSlices.erase(block.freeSlices.begin() + freeIndex);
+                    freeIndex = 0;
+                } else {
+                    freeIndex++;
+                }
+            }
+            block.freeSlices.push_back(freedSlice);
+            return;
+        }
+
+        assert(!"FreeSlice() - the slice offset is not allocated from this block!");
+        return;
+    }
+
+    assert(!"FreeSlice() - the memory does not belong to the arena!");
+}
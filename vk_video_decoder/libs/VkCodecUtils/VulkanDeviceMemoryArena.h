@@ -0,0 +1,108 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VULKANDEVICEMEMORYARENA_H_
+#define _VULKANDEVICEMEMORYARENA_H_
+
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include "VkVideoCore/VkVideoRefCountBase.h"
+#include "VkCodecUtils/VulkanDeviceContext.h"
+
+// Suballocating device memory arena: carves large vkAllocateMemory blocks
+// into aligned slices and recycles freed slices through a per-block free
+// list. VulkanDeviceMemoryImpl allocates its backing store from the arena,
+// so the bitstream buffers and the DPB images of many parallel streams
+// share a few big blocks instead of hitting the driver's allocation-count
+// limit with one vkAllocateMemory per resource.
+//
+// Every slice is aligned to max(alignment, bufferImageGranularity,
+// nonCoherentAtomSize), so buffers and images can share a block and
+// host-range flushes of one slice never touch a neighboring one.
+// Host-visible blocks are persistently mapped once at block creation.
+class VulkanDeviceMemoryArena : public VkVideoRefCountBase
+{
+public:
+
+    // Returns the shared arena of the given device, creating it on first use.
+    // The arena stays alive for as long as at least one client holds a
+    // reference to it.
+    static VkResult GetOrCreateArena(const VulkanDeviceContext* vkDevCtx,
+                                     VkSharedBaseObj<VulkanDeviceMemoryArena>& memoryArena);
+
+    virtual int32_t AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    virtual int32_t Release();
+
+    // Allocates an aligned slice satisfying memoryRequirements from one of
+    // the arena's blocks, growing the arena with a new block when required.
+    // Requests bigger than the default block size get a block of their own.
+    // ppMappedSliceData is set to the persistently mapped slice start for
+    // host-visible memory types and to nullptr otherwise.
+    VkResult AllocateSlice(const VkMemoryRequirements& memoryRequirements,
+                           VkMemoryPropertyFlags& memoryPropertyFlags,
+                           VkDeviceMemory& deviceMemory,
+                           VkDeviceSize&   deviceMemoryOffset,
+                           uint8_t**       ppMappedSliceData);
+
+    // Returns a slice previously obtained from AllocateSlice() to its
+    // block's free list, merging it with adjacent free slices.
+    void FreeSlice(VkDeviceMemory deviceMemory, VkDeviceSize deviceMemoryOffset);
+
+private:
+
+    static const VkDeviceSize DefaultBlockSize = 64 * 1024 * 1024; // 64 MB
+
+    struct MemorySlice {
+        VkDeviceSize offset;
+        VkDeviceSize size;
+    };
+
+    struct MemoryBlock {
+        VkDeviceMemory            memory;
+        uint32_t                  memoryTypeIndex;
+        VkDeviceSize              size;
+        uint8_t*                  mappedDataPtr; // nullptr if not host-visible
+        std::vector<MemorySlice>  freeSlices;
+        std::vector<MemorySlice>  usedSlices;
+    };
+
+    VulkanDeviceMemoryArena(const VulkanDeviceContext* vkDevCtx);
+
+    virtual ~VulkanDeviceMemoryArena();
+
+    VkResult CreateBlock(uint32_t memoryTypeIndex, VkDeviceSize blockSize,
+                         bool hostVisible, size_t& blockIndex);
+
+    bool AllocateFromBlock(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment,
+                           VkDeviceSize& sliceOffset);
+
+    VkDeviceSize GetSliceAlignment(VkDeviceSize alignment) const;
+
+private:
+    std::atomic<int32_t>       m_refCount;
+    const VulkanDeviceContext* m_vkDevCtx;
+    VkDeviceSize               m_bufferImageGranularity;
+    VkDeviceSize               m_nonCoherentAtomSize;
+    mutable std::mutex         m_mutex;
+    std::vector<MemoryBlock>   m_blocks;
+};
+
+#endif /* _VULKANDEVICEMEMORYARENA_H_ */
@@ -17,13 +17,34 @@
 #include <string.h>
 #include "VkCodecUtils/VulkanDeviceMemoryImpl.h"
 #include "VkCodecUtils/Helpers.h"
+#include "VkCodecUtils/VulkanThreadAffinity.h"
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+// Host-visible allocations at or above this size are backed by imported
+// huge-page host memory (--hugePageStaging <KB>); 0 keeps the driver's
+// regular allocations. Written once at startup, before any allocation.
+static size_t s_hostHugePageThresholdBytes = 0;
+
+void VulkanDeviceMemoryImpl::SetHostHugePageThreshold(size_t thresholdBytes)
+{
+    s_hostHugePageThresholdBytes = thresholdBytes;
+}
+
+size_t VulkanDeviceMemoryImpl::GetHostHugePageThreshold()
+{
+    return s_hostHugePageThresholdBytes;
+}
 
 VkResult
 VulkanDeviceMemoryImpl::Create(const VulkanDeviceContext* vkDevCtx,
                                const VkMemoryRequirements& memoryRequirements,
                                VkMemoryPropertyFlags& memoryPropertyFlags,
                                const void* pInitializeMemory, size_t initializeMemorySize, bool clearMemory,
-                               VkSharedBaseObj<VulkanDeviceMemoryImpl>& vulkanDeviceMemory)
+                               VkSharedBaseObj<VulkanDeviceMemoryImpl>& vulkanDeviceMemory,
+                               bool allowHostImport, bool exportMemoryFd)
 {
     VkSharedBaseObj<VulkanDeviceMemoryImpl> vkDeviceMemory(new VulkanDeviceMemoryImpl(vkDevCtx));
     if (!vkDeviceMemory) {
@@ -31,6 +52,11 @@ VulkanDeviceMemoryImpl::Create(const VulkanDeviceContext* vkDevCtx,
         return VK_ERROR_OUT_OF_HOST_MEMORY;
     }
 
+    // Exportable memory is always a dedicated allocation, never a host
+    // import or an arena slice (see AllocateDeviceMemory()).
+    assert(!(allowHostImport && exportMemoryFd));
+    vkDeviceMemory->m_allowHostImport = allowHostImport;
+    vkDeviceMemory->m_exportMemoryFd = exportMemoryFd;
     VkResult result = vkDeviceMemory->Initialize(memoryRequirements, memoryPropertyFlags,
                                                  pInitializeMemory,
                                                  initializeMemorySize,
@@ -46,25 +72,40 @@ VkResult VulkanDeviceMemoryImpl::CreateDeviceMemory(const VulkanDeviceContext* v
                                                     const VkMemoryRequirements& memoryRequirements,
                                                     VkMemoryPropertyFlags& memoryPropertyFlags,
                                                     VkDeviceMemory& deviceMemory,
-                                                    VkDeviceSize&   deviceMemoryOffset)
+                                                    VkDeviceSize&   deviceMemoryOffset,
+                                                    bool exportMemoryFd)
 {
     assert(memoryRequirements.size ==
             ((memoryRequirements.size + (memoryRequirements.alignment - 1)) & ~(memoryRequirements.alignment - 1)));
     deviceMemoryOffset = 0;
 
+    // Cross-process export: the compositor (or another consumer process)
+    // imports the fd of this allocation and binds its own image to it (see
+    // GetExportMemoryFd()).
+    VkExportMemoryAllocateInfo exportAllocInfo = VkExportMemoryAllocateInfo();
+    exportAllocInfo.sType = VK_STRUCTURE_TYPE_EXPORT_MEMORY_ALLOCATE_INFO;
+    exportAllocInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+
     VkMemoryAllocateInfo allocInfo = VkMemoryAllocateInfo();
     allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = exportMemoryFd ? &exportAllocInfo : nullptr;
     allocInfo.memoryTypeIndex = 0;  // Memory type assigned in the next step
 
-    // Assign the proper memory type for that buffer
+    // Assign the proper memory type for that buffer. Host-visible requests
+    // go through the host-cached preference chain and memoryPropertyFlags
+    // reports the flags of the type that was actually selected.
     allocInfo.allocationSize = memoryRequirements.size;
-    MapMemoryTypeToIndex(vkDevCtx, vkDevCtx->getPhysicalDevice(),
-                         memoryRequirements.memoryTypeBits,
-                         memoryPropertyFlags,
-                         &allocInfo.memoryTypeIndex);
+    VkResult result = MapMemoryTypeToIndexWithFallback(vkDevCtx, vkDevCtx->getPhysicalDevice(),
+                                                       memoryRequirements.memoryTypeBits,
+                                                       memoryPropertyFlags,
+                                                       &allocInfo.memoryTypeIndex);
+    if (result != VK_SUCCESS) {
+        assert(!"Couldn't map the requested memory type!");
+        return result;
+    }
 
     // Allocate memory for the buffer
-    VkResult result = vkDevCtx->AllocateMemory(*vkDevCtx, &allocInfo, nullptr, &deviceMemory);
+    result = vkDevCtx->AllocateMemory(*vkDevCtx, &allocInfo, nullptr, &deviceMemory);
     if (result != VK_SUCCESS) {
         assert(!"Couldn't allocate device memory!");
         return result;
@@ -73,6 +114,126 @@ VkResult VulkanDeviceMemoryImpl::CreateDeviceMemory(const VulkanDeviceContext* v
     return result;
 }
 
+VkResult VulkanDeviceMemoryImpl::AllocateImportedHostMemory(const VkMemoryRequirements& memoryRequirements,
+                                                            VkMemoryPropertyFlags& memoryPropertyFlags,
+                                                            VkDeviceMemory& deviceMemory,
+                                                            uint8_t*&       hostImportBase,
+                                                            size_t&         hostImportSize)
+{
+    hostImportBase = nullptr;
+    hostImportSize = 0;
+
+#if !defined(_WIN32)
+    if (!m_vkDevCtx->IsDeviceExtensionEnabled(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME)) {
+        return VK_ERROR_EXTENSION_NOT_PRESENT;
+    }
+
+    VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProperties = VkPhysicalDeviceExternalMemoryHostPropertiesEXT();
+    hostProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2 deviceProperties = VkPhysicalDeviceProperties2();
+    deviceProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    deviceProperties.pNext = &hostProperties;
+    m_vkDevCtx->GetPhysicalDeviceProperties2(m_vkDevCtx->getPhysicalDevice(), &deviceProperties);
+
+    // The imported pointer and size must be aligned to
+    // minImportedHostPointerAlignment; aligning to the huge page size as
+    // well makes the whole mapping eligible for transparent huge pages.
+    const size_t hugePageSize = 2 * 1024 * 1024;
+    const size_t importAlignment = std::max((size_t)hostProperties.minImportedHostPointerAlignment,
+                                            hugePageSize);
+    const size_t importSize = (memoryRequirements.size + (importAlignment - 1)) & ~(importAlignment - 1);
+
+    // mmap() only guarantees page alignment, so over-reserve by one
+    // alignment unit and trim the misaligned head and tail.
+    const size_t reserveSize = importSize + importAlignment;
+    uint8_t* reserveBase = (uint8_t*)mmap(nullptr, reserveSize, PROT_READ | PROT_WRITE,
+                                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserveBase == MAP_FAILED) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    uint8_t* alignedBase = (uint8_t*)(((uintptr_t)reserveBase + (importAlignment - 1)) & ~(uintptr_t)(importAlignment - 1));
+    const size_t headSize = (size_t)(alignedBase - reserveBase);
+    if (headSize != 0) {
+        munmap(reserveBase, headSize);
+    }
+    const size_t tailSize = reserveSize - headSize - importSize;
+    if (tailSize != 0) {
+        munmap(alignedBase + importSize, tailSize);
+    }
+
+#if defined(MADV_HUGEPAGE)
+    // Advisory only - without THP support the import still works, just on
+    // 4 KB pages.
+    madvise(alignedBase, importSize, MADV_HUGEPAGE);
+#endif
+
+    VkMemoryHostPointerPropertiesEXT hostPointerProperties = VkMemoryHostPointerPropertiesEXT();
+    hostPointerProperties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+    VkResult result = m_vkDevCtx->GetMemoryHostPointerPropertiesEXT(*m_vkDevCtx,
+                                                                    VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+                                                                    alignedBase,
+                                                                    &hostPointerProperties);
+    if (result != VK_SUCCESS) {
+        munmap(alignedBase, importSize);
+        return result;
+    }
+
+    const uint32_t importTypeBits = hostPointerProperties.memoryTypeBits & memoryRequirements.memoryTypeBits;
+
+    // The imported memory is accessed through the host pointer and never
+    // vkMapMemory()-ed, so only host-coherent types qualify - a
+    // non-coherent type would require flushing a mapping that does not
+    // exist. Prefer host-cached coherent types for the readback users.
+    const VkMemoryPropertyFlags importPreferenceChain[] = {
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    };
+
+    VkMemoryAllocateInfo allocInfo = VkMemoryAllocateInfo();
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = importSize;
+    result = VK_ERROR_VALIDATION_FAILED_EXT;
+    for (size_t chainIndex = 0; chainIndex < (sizeof(importPreferenceChain) / sizeof(importPreferenceChain[0])); chainIndex++) {
+        result = MapMemoryTypeToIndex(m_vkDevCtx, m_vkDevCtx->getPhysicalDevice(),
+                                          importTypeBits, importPreferenceChain[chainIndex],
+                                          &allocInfo.memoryTypeIndex);
+        if (result == VK_SUCCESS) {
+            break;
+        }
+    }
+    if (result != VK_SUCCESS) {
+        munmap(alignedBase, importSize);
+        return result;
+    }
+
+    VkImportMemoryHostPointerInfoEXT importInfo = VkImportMemoryHostPointerInfoEXT();
+    importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+    importInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+    importInfo.pHostPointer = alignedBase;
+    allocInfo.pNext = &importInfo;
+
+    result = m_vkDevCtx->AllocateMemory(*m_vkDevCtx, &allocInfo, nullptr, &deviceMemory);
+    if (result != VK_SUCCESS) {
+        munmap(alignedBase, importSize);
+        return result;
+    }
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    m_vkDevCtx->GetMemoryProperties(memoryProperties);
+    memoryPropertyFlags = memoryProperties.memoryTypes[allocInfo.memoryTypeIndex].propertyFlags;
+
+    hostImportBase = alignedBase;
+    hostImportSize = importSize;
+    return VK_SUCCESS;
+#else
+    (void)memoryRequirements;
+    (void)memoryPropertyFlags;
+    (void)deviceMemory;
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+#endif // !defined(_WIN32)
+}
+
 VkResult VulkanDeviceMemoryImpl::Initialize(const VkMemoryRequirements& memoryRequirements,
                                             VkMemoryPropertyFlags& memoryPropertyFlags,
                                             const void* pInitializeMemory,
@@ -90,20 +251,37 @@ VkResult VulkanDeviceMemoryImpl::Initialize(const VkMemoryRequirements& memoryRe
 
     Deinitialize();
 
-    VkResult result = CreateDeviceMemory(m_vkDevCtx,
-                                         memoryRequirements,
-                                         memoryPropertyFlags,
-                                         m_deviceMemory,
-                                         m_deviceMemoryOffset);
+    uint8_t* mappedSliceData = nullptr;
+    VkResult result = AllocateDeviceMemory(memoryRequirements,
+                                           memoryPropertyFlags,
+                                           m_deviceMemory,
+                                           m_deviceMemoryOffset,
+                                           mappedSliceData,
+                                           m_memoryArena,
+                                           m_hostImportBase,
+                                           m_hostImportSize);
 
     if (result != VK_SUCCESS) {
-        assert(!"Couldn't CreateDeviceMemory()!");
+        assert(!"Couldn't AllocateDeviceMemory()!");
         return result;
     }
 
+    m_deviceMemoryDataPtr = mappedSliceData;
     m_memoryPropertyFlags = memoryPropertyFlags;
     m_memoryRequirements = memoryRequirements;
 
+    if ((m_memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+            (m_deviceMemoryDataPtr != nullptr) &&
+            VulkanThreadAffinity::PreferNumaLocalHostAllocations()) {
+        // First-touch the mapping from the allocating (pinned) thread, so
+        // pages the driver faults in lazily land on the GPU-local NUMA node
+        // instead of wherever the memory happens to be used first.
+        volatile uint8_t* mappedPages = m_deviceMemoryDataPtr;
+        for (size_t pageOffset = 0; pageOffset < m_memoryRequirements.size; pageOffset += 4096) {
+            mappedPages[pageOffset] = 0;
+        }
+    }
+
     if (m_memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
 
         size_t copySize = std::min(initializeMemorySize, m_memoryRequirements.size);
@@ -120,8 +298,88 @@ VkResult VulkanDeviceMemoryImpl::Initialize(const VkMemoryRequirements& memoryRe
     return result;
 }
 
+VkResult VulkanDeviceMemoryImpl::AllocateDeviceMemory(const VkMemoryRequirements& memoryRequirements,
+                                                      VkMemoryPropertyFlags& memoryPropertyFlags,
+                                                      VkDeviceMemory& deviceMemory,
+                                                      VkDeviceSize&   deviceMemoryOffset,
+                                                      uint8_t*&       mappedSliceData,
+                                                      VkSharedBaseObj<VulkanDeviceMemoryArena>& memoryArena,
+                                                      uint8_t*&       hostImportBase,
+                                                      size_t&         hostImportSize)
+{
+    mappedSliceData = nullptr;
+    memoryArena = nullptr;
+    hostImportBase = nullptr;
+    hostImportSize = 0;
+
+    if (m_exportMemoryFd) {
+        // Exportable allocations must own their VkDeviceMemory outright -
+        // an fd of an arena block would leak the other slices to the
+        // importing process, and imported host memory has no fd to export.
+        return CreateDeviceMemory(m_vkDevCtx,
+                                  memoryRequirements,
+                                  memoryPropertyFlags,
+                                  deviceMemory,
+                                  deviceMemoryOffset,
+                                  true /* exportMemoryFd */);
+    }
+
+    const size_t hugePageThreshold = GetHostHugePageThreshold();
+    if (m_allowHostImport && (hugePageThreshold != 0) &&
+            ((memoryPropertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0) &&
+            (memoryRequirements.size >= hugePageThreshold)) {
+        VkResult result = AllocateImportedHostMemory(memoryRequirements, memoryPropertyFlags,
+                                                     deviceMemory, hostImportBase, hostImportSize);
+        if (result == VK_SUCCESS) {
+            deviceMemoryOffset = 0;
+            mappedSliceData = hostImportBase;
+            return VK_SUCCESS;
+        }
+        // No huge-page import - continue with the regular allocation paths.
+    }
+
+    VkSharedBaseObj<VulkanDeviceMemoryArena> arena;
+    if (VulkanDeviceMemoryArena::GetOrCreateArena(m_vkDevCtx, arena) == VK_SUCCESS) {
+        VkResult result = arena->AllocateSlice(memoryRequirements, memoryPropertyFlags,
+                                               deviceMemory, deviceMemoryOffset,
+                                               &mappedSliceData);
+        if (result == VK_SUCCESS) {
+            memoryArena = arena;
+            return VK_SUCCESS;
+        }
+    }
+
+    // Fall back to a dedicated allocation.
+    return CreateDeviceMemory(m_vkDevCtx,
+                              memoryRequirements,
+                              memoryPropertyFlags,
+                              deviceMemory,
+                              deviceMemoryOffset);
+}
+
 void VulkanDeviceMemoryImpl::Deinitialize()
 {
+    if (m_hostImportBase != nullptr) {
+        // The device memory only imports the mapping; free it before the
+        // mapping it points into goes away.
+        m_vkDevCtx->FreeMemory(*m_vkDevCtx, m_deviceMemory, nullptr);
+        m_deviceMemory = VK_NULL_HANDLE;
+#if !defined(_WIN32)
+        munmap(m_hostImportBase, m_hostImportSize);
+#endif
+        m_hostImportBase = nullptr;
+        m_hostImportSize = 0;
+        m_deviceMemoryDataPtr = nullptr;
+    }
+
+    if (m_memoryArena) {
+        // The slice and its mapping are owned by the arena's block.
+        m_memoryArena->FreeSlice(m_deviceMemory, m_deviceMemoryOffset);
+        m_memoryArena = nullptr;
+        m_deviceMemory = VK_NULL_HANDLE;
+        m_deviceMemoryDataPtr = nullptr;
+    }
+
     if (m_deviceMemoryDataPtr != nullptr) {
         m_vkDevCtx->UnmapMemory(*m_vkDevCtx, m_deviceMemory);
         m_deviceMemoryDataPtr = nullptr;
@@ -135,6 +393,20 @@ void VulkanDeviceMemoryImpl::Deinitialize()
     m_deviceMemoryOffset = 0;
 }
 
+VkResult VulkanDeviceMemoryImpl::GetExportMemoryFd(int* pFd) const
+{
+    if (!m_exportMemoryFd || (m_deviceMemory == VK_NULL_HANDLE)) {
+        assert(!"The allocation was not created with exportMemoryFd!");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    VkMemoryGetFdInfoKHR getFdInfo = VkMemoryGetFdInfoKHR();
+    getFdInfo.sType = VK_STRUCTURE_TYPE_MEMORY_GET_FD_INFO_KHR;
+    getFdInfo.memory = m_deviceMemory;
+    getFdInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT;
+    return m_vkDevCtx->GetMemoryFdKHR(*m_vkDevCtx, &getFdInfo, pFd);
+}
+
 VkResult VulkanDeviceMemoryImpl::FlushInvalidateMappedMemoryRange(VkDeviceSize offset, VkDeviceSize size,
                                                                   bool flush) const
 {
@@ -147,7 +419,7 @@ VkResult VulkanDeviceMemoryImpl::FlushInvalidateMappedMemoryRange(VkDeviceSize o
             VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,  // sType
             NULL,                                   // pNext
             m_deviceMemory,                         // memory
-            offset,                                 // offset
+            m_deviceMemoryOffset + offset,          // offset
             size,                                   // size
         };
 
@@ -180,25 +452,21 @@ VkResult VulkanDeviceMemoryImpl::CopyDataToMemory(const uint8_t* pData,
         return VK_ERROR_INITIALIZATION_FAILED;
     }
 
-    uint8_t* pDst = NULL;
     assert((memoryOffset + size) <= m_memoryRequirements.size);
-    VkResult result = m_vkDevCtx->MapMemory(*m_vkDevCtx, m_deviceMemory, memoryOffset,
-                                            size, 0, (void**)&pDst);
-
-    if (result != VK_SUCCESS) {
-        return result;
+    uint8_t* pDst = CheckAccess((size_t)memoryOffset, (size_t)size);
+    if (pDst == nullptr) {
+        assert(!"Couldn't CopyDataToMemory()!");
+        return VK_ERROR_INITIALIZATION_FAILED;
     }
 
     memcpy(pDst, pData, (size_t)size);
 
-    result = FlushInvalidateMappedMemoryRange(memoryOffset, size);
+    VkResult result = FlushInvalidateMappedMemoryRange(memoryOffset, size);
     if (result != VK_SUCCESS) {
         assert(!"Couldn't FlushMappedMemoryRange()!");
         return result;
     }
 
-    m_vkDevCtx->UnmapMemory(*m_vkDevCtx, m_deviceMemory);
-
     return VK_SUCCESS;
 }
 
@@ -222,29 +490,44 @@ size_t VulkanDeviceMemoryImpl::Resize(size_t newSize, size_t copySize, size_t co
     memoryRequirements.size = ((newSize + (memoryRequirements.alignment - 1)) & ~(memoryRequirements.alignment - 1));
     VkDeviceMemory  newDeviceMemory = VK_NULL_HANDLE;
     VkDeviceSize    newBufferOffset = 0;
+    uint8_t*        newBufferDataPtr = nullptr;
+    VkSharedBaseObj<VulkanDeviceMemoryArena> newMemoryArena;
+    uint8_t* newHostImportBase = nullptr;
+    size_t   newHostImportSize = 0;
     VkMemoryPropertyFlags newMemoryPropertyFlags = m_memoryPropertyFlags;
-    VkResult result = CreateDeviceMemory(m_vkDevCtx,
-                                         memoryRequirements,
-                                         newMemoryPropertyFlags,
-                                         newDeviceMemory,
-                                         newBufferOffset);
+    VkResult result = AllocateDeviceMemory(memoryRequirements,
+                                           newMemoryPropertyFlags,
+                                           newDeviceMemory,
+                                           newBufferOffset,
+                                           newBufferDataPtr,
+                                           newMemoryArena,
+                                           newHostImportBase,
+                                           newHostImportSize);
 
     if (result != VK_SUCCESS) {
-        assert(!"Couldn't CreateDeviceMemory()!");
+        assert(!"Couldn't AllocateDeviceMemory()!");
         return 0;
     }
 
-    uint8_t* newBufferDataPtr = nullptr;
     if (copySize != 0) {
-        result = m_vkDevCtx->MapMemory(*m_vkDevCtx, newDeviceMemory, newBufferOffset,
-                                        newSize, 0, (void**)&newBufferDataPtr);
-
-        if ((result != VK_SUCCESS) || (newBufferDataPtr == nullptr)) {
-            m_vkDevCtx->UnmapMemory(*m_vkDevCtx, newDeviceMemory);
-            m_vkDevCtx->FreeMemory(*m_vkDevCtx, newDeviceMemory, nullptr);
-            assert(!"Couldn't MapMemory()!");
+        // Arena slices of host-visible memory are already mapped; a dedicated
+        // allocation has to be mapped here.
+        if ((newBufferDataPtr == nullptr) && newMemoryArena) {
+            newMemoryArena->FreeSlice(newDeviceMemory, newBufferOffset);
+            assert(!"Can't copy into a non host-visible arena slice!");
             return 0;
         }
+        if (newBufferDataPtr == nullptr) {
+            result = m_vkDevCtx->MapMemory(*m_vkDevCtx, newDeviceMemory, newBufferOffset,
+                                            newSize, 0, (void**)&newBufferDataPtr);
+
+            if ((result != VK_SUCCESS) || (newBufferDataPtr == nullptr)) {
+                m_vkDevCtx->UnmapMemory(*m_vkDevCtx, newDeviceMemory);
+                m_vkDevCtx->FreeMemory(*m_vkDevCtx, newDeviceMemory, nullptr);
+                assert(!"Couldn't MapMemory()!");
+                return 0;
+            }
+        }
 
         copySize = std::min(copyOffset + copySize, m_memoryRequirements.size);
         memset(newBufferDataPtr + copySize, 0x00, newSize - copySize);
@@ -261,6 +544,9 @@ size_t VulkanDeviceMemoryImpl::Resize(size_t newSize, size_t copySize, size_t co
     m_deviceMemory = newDeviceMemory;
     m_deviceMemoryOffset = newBufferOffset;
     m_deviceMemoryDataPtr = newBufferDataPtr;
+    m_memoryArena = newMemoryArena;
+    m_hostImportBase = newHostImportBase;
+    m_hostImportSize = newHostImportSize;
 
     if (copySize == 0) {
         MemsetData(0x0, 0, newSize);
@@ -273,6 +559,12 @@ uint8_t* VulkanDeviceMemoryImpl::CheckAccess(size_t offset, size_t size) const
 {
     if (offset + size <= m_memoryRequirements.size) {
         if (m_deviceMemoryDataPtr == nullptr) {
+            if (m_memoryArena) {
+                // Arena slices are mapped by the arena's block only when the
+                // memory type is host-visible.
+                assert(!"CheckAccess() failed - the arena slice is not host-visible!");
+                return nullptr;
+            }
             VkResult result = m_vkDevCtx->MapMemory(*m_vkDevCtx, m_deviceMemory, m_deviceMemoryOffset,
                                                     m_memoryRequirements.size, 0, (void**)&m_deviceMemoryDataPtr);
             if ((result != VK_SUCCESS) || (m_deviceMemoryDataPtr == nullptr)) {
@@ -20,16 +20,45 @@
 #include <atomic>
 #include "VkVideoCore/VkVideoRefCountBase.h"
 #include "VkCodecUtils/VulkanDeviceContext.h"
+#include "VkCodecUtils/VulkanDeviceMemoryArena.h"
 
 class VulkanDeviceMemoryImpl : public VkVideoRefCountBase
 {
 public:
 
+    // allowHostImport opts the allocation into the huge-page host import
+    // path below. Only resources created to bind external host memory
+    // (VkExternalMemoryBufferCreateInfo - see
+    // VulkanBitstreamBufferImpl::CreateBuffer()) may pass true; images
+    // would additionally need VkExternalMemoryImageCreateInfo and stay on
+    // the regular allocation paths.
+    // exportMemoryFd makes the allocation exportable as an opaque fd
+    // (VK_KHR_external_memory_fd - see GetExportMemoryFd()). Exportable
+    // allocations are always dedicated: a suballocated arena slice or an
+    // imported host mapping cannot hand out an fd of its own. The resource
+    // bound to the memory must have been created with a matching
+    // VkExternalMemoryImageCreateInfo/VkExternalMemoryBufferCreateInfo.
     static VkResult Create(const VulkanDeviceContext* vkDevCtx,
                            const VkMemoryRequirements& memoryRequirements,
                            VkMemoryPropertyFlags& memoryPropertyFlags,
                            const void* pInitializeMemory, size_t initializeMemorySize, bool clearMemory,
-                           VkSharedBaseObj<VulkanDeviceMemoryImpl>& vulkanDeviceMemory);
+                           VkSharedBaseObj<VulkanDeviceMemoryImpl>& vulkanDeviceMemory,
+                           bool allowHostImport = false,
+                           bool exportMemoryFd = false);
+
+    // Exports the allocation as an opaque fd the importing process binds
+    // with VkImportMemoryFdInfoKHR. Each call hands out a new fd and the
+    // caller owns it. Only valid on allocations created with exportMemoryFd.
+    VkResult GetExportMemoryFd(int* pFd) const;
+
+    // Host-visible allocations of at least thresholdBytes bytes get their
+    // backing store from a huge-page-eligible anonymous mapping imported
+    // with VK_EXT_external_memory_host instead of a driver allocation, so
+    // the copy kernels walking large bitstream and staging buffers take 2 MB
+    // TLB entries instead of 4 KB ones (--hugePageStaging <KB>). 0 disables
+    // the import path. Set once at startup, before any memory is allocated.
+    static void   SetHostHugePageThreshold(size_t thresholdBytes);
+    static size_t GetHostHugePageThreshold();
 
     virtual int32_t AddRef()
     {
@@ -69,6 +98,12 @@ public:
     operator VkDeviceMemory() { return m_deviceMemory; }
     operator bool() { return m_deviceMemory != VK_NULL_HANDLE; }
 
+    // Offset of this allocation within GetDeviceMemory(). Non-zero when the
+    // memory is a slice suballocated from the shared arena - resources must
+    // bind at this offset. All of the data access methods of this class take
+    // offsets relative to the slice, not to the VkDeviceMemory.
+    VkDeviceSize GetMemoryOffset() const { return m_deviceMemoryOffset; }
+
     const VkMemoryRequirements& GetMemoryRequirements() const { return m_memoryRequirements; }
 
     VkResult FlushInvalidateMappedMemoryRange(VkDeviceSize offset, VkDeviceSize size, bool flush = true)  const;
@@ -84,7 +119,35 @@ private:
                                        const VkMemoryRequirements& memoryRequirements,
                                        VkMemoryPropertyFlags& memoryPropertyFlags,
                                        VkDeviceMemory& deviceMemory,
-                                       VkDeviceSize&   deviceMemoryOffset);
+                                       VkDeviceSize&   deviceMemoryOffset,
+                                       bool exportMemoryFd = false);
+
+    // Allocates huge-page-eligible anonymous host memory and imports it as
+    // VkDeviceMemory with VK_EXT_external_memory_host. hostImportBase and
+    // hostImportSize describe the mapping the allocation owns; the memory
+    // is usable through the host pointer directly, without vkMapMemory().
+    // Only host-coherent memory types are accepted, so the non-coherent
+    // flush/invalidate path never has to operate on imported memory.
+    VkResult AllocateImportedHostMemory(const VkMemoryRequirements& memoryRequirements,
+                                        VkMemoryPropertyFlags& memoryPropertyFlags,
+                                        VkDeviceMemory& deviceMemory,
+                                        uint8_t*&       hostImportBase,
+                                        size_t&         hostImportSize);
+
+    // Suballocates from the shared arena, falling back to a dedicated
+    // CreateDeviceMemory() allocation when the arena can't satisfy the
+    // request. Host-visible requests at or above the huge-page threshold
+    // try AllocateImportedHostMemory() first. mappedSliceData is set for
+    // host-visible arena slices, which are persistently mapped by the
+    // arena's block, and for imported host memory.
+    VkResult AllocateDeviceMemory(const VkMemoryRequirements& memoryRequirements,
+                                  VkMemoryPropertyFlags& memoryPropertyFlags,
+                                  VkDeviceMemory& deviceMemory,
+                                  VkDeviceSize&   deviceMemoryOffset,
+                                  uint8_t*&       mappedSliceData,
+                                  VkSharedBaseObj<VulkanDeviceMemoryArena>& memoryArena,
+                                  uint8_t*&       hostImportBase,
+                                  size_t&         hostImportSize);
 
 
     VkResult Initialize(const VkMemoryRequirements& memoryRequirements,
@@ -100,7 +163,12 @@ private:
         , m_memoryPropertyFlags()
         , m_deviceMemory()
         , m_deviceMemoryOffset()
-        , m_deviceMemoryDataPtr(nullptr) { }
+        , m_deviceMemoryDataPtr(nullptr)
+        , m_memoryArena()
+        , m_hostImportBase(nullptr)
+        , m_hostImportSize(0)
+        , m_allowHostImport(false)
+        , m_exportMemoryFd(false) { }
 
     void Deinitialize();
 
@@ -113,7 +181,20 @@ private:
     VkMemoryPropertyFlags      m_memoryPropertyFlags;
     VkDeviceMemory             m_deviceMemory;
     VkDeviceSize               m_deviceMemoryOffset;
-    uint8_t*                   m_deviceMemoryDataPtr;
+    mutable uint8_t*           m_deviceMemoryDataPtr;
+    // Non-null when m_deviceMemory is a slice owned by the shared arena.
+    VkSharedBaseObj<VulkanDeviceMemoryArena> m_memoryArena;
+    // Non-null when m_deviceMemory imports this anonymous host mapping via
+    // VK_EXT_external_memory_host; Deinitialize() unmaps it after the
+    // VkDeviceMemory that imported it is freed.
+    uint8_t*                   m_hostImportBase;
+    size_t                     m_hostImportSize;
+    // Whether this allocation may use the huge-page host import path; set
+    // from Create() and kept across Resize().
+    bool                       m_allowHostImport;
+    // Whether this allocation is exportable as an opaque fd; forces the
+    // dedicated allocation path (see GetExportMemoryFd()).
+    bool                       m_exportMemoryFd;
 };
 
 #endif /* _VULKANDEVICEMEMORYIMPL_H_ */
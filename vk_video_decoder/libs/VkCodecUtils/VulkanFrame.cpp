@@ -22,6 +22,8 @@
 
 #include "VkCodecUtils/Helpers.h"
 #include "VkCodecUtils/VulkanDeviceContext.h"
+#include "VkCodecUtils/VulkanPerfCounters.h"
+#include "VkCodecUtils/VulkanThreadAffinity.h"
 #include "VkShell/Shell.h"
 #include "VulkanFrame.h"
 
@@ -60,9 +62,16 @@ VulkanFrame::VulkanFrame(const ProgramConfig& programConfig,
     , m_codecPaused(false)
     , m_gfxQueue()
     , m_vkFormat()
+    , m_useDirectScanout(false)
     , m_physicalDevProps()
     , m_frameData()
     , m_frameDataIndex()
+    , m_exitDecodeThread(false)
+    , m_decodeThreadEndOfStream(false)
+    , m_playoutBaseRealTimeNs(0)
+    , m_framesDropped(0)
+    , m_framesLate(0)
+    , m_framesRepeated(0)
 {
 }
 
@@ -75,6 +84,8 @@ int VulkanFrame::GetVideoWidth() { return m_videoProcessor->IsValid() ? m_videoP
 
 int VulkanFrame::GetVideoHeight() { return m_videoProcessor->IsValid() ? m_videoProcessor->GetHeight() : m_scissor.extent.height; }
 
+VkFormat VulkanFrame::GetFrameImageFormat() { return m_videoProcessor->IsValid() ? m_videoProcessor->GetFrameImageFormat() : VK_FORMAT_UNDEFINED; }
+
 int VulkanFrame::AttachShell(const Shell& sh)
 {
     const Shell::Context& ctx = sh.GetContext();
@@ -127,6 +138,8 @@ int VulkanFrame::AttachShell(const Shell& sh)
 
 void VulkanFrame::DetachShell()
 {
+    StopDecodeThread();
+
     DestroyFrameData();
 
     delete m_videoRenderer;
@@ -173,29 +186,58 @@ int VulkanFrame::AttachSwapchain(const Shell& sh)
 
     PrepareViewport(ctx.extent);
 
+    // Direct scanout (--directScanout): when the shell managed to create the
+    // swapchain with the decoder output format and transfer-destination
+    // usage, decoded frames are copied plane-for-plane into the swapchain
+    // image and handed straight to the display plane - no sampler, render
+    // pass or graphics pipeline is involved and the 3D engine stays idle.
+    m_useDirectScanout = false;
+    if (m_settings.enableDirectScanout && !m_videoRenderer->m_useTestImage) {
+        if ((ctx.format.format == GetFrameImageFormat()) &&
+                (ctx.imageUsage & VK_IMAGE_USAGE_TRANSFER_DST_BIT)) {
+            m_useDirectScanout = true;
+        } else {
+            std::cout << "--directScanout is not supported by the display surface - using the render path" << std::endl;
+        }
+    }
+
+    if (m_useDirectScanout) {
+        // Only the swapchain images, command pools and sync primitives are
+        // needed for the copy streams.
+        m_videoRenderer->m_renderInfo.CreatePerDrawContexts(m_videoRenderer->m_vkDevCtx,
+                                                            ctx.swapchain, &ctx.extent, &m_viewport, &m_scissor,
+                                                            &ctx.format, VK_NULL_HANDLE);
+        return 0;
+    }
+
     uint32_t imageWidth = GetVideoWidth();
     uint32_t imageHeight = GetVideoHeight();
 
-    // Create test image, if enabled.
-    VkImageCreateInfo imageCreateInfo = VkImageCreateInfo();
-    imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageCreateInfo.pNext = NULL;
-    imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageCreateInfo.format = m_videoProcessor->GetFrameImageFormat();
-    imageCreateInfo.extent = { imageWidth, imageHeight, 1 };
-    imageCreateInfo.mipLevels = 1;
-    imageCreateInfo.arrayLayers = 1;
-    imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    imageCreateInfo.tiling = VK_IMAGE_TILING_LINEAR;
-    imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
-    imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    imageCreateInfo.queueFamilyIndexCount = 1;
-    const uint32_t queueFamilyIndices = m_videoRenderer->m_vkDevCtx->GetGfxQueueFamilyIdx();
-    imageCreateInfo.pQueueFamilyIndices = &queueFamilyIndices;
-    imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
-    imageCreateInfo.flags = 0;
-    m_videoRenderer->m_testFrameImage.CreateImage(m_videoRenderer->m_vkDevCtx, &imageCreateInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-        1 /* ColorPatternColorBars */, VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT);
+    // The test image and the render pass depend on the video and surface
+    // formats, not on the window extent, so on a swapchain resize the ones
+    // created by the first attach are kept.
+    if (!m_videoRenderer->m_testFrameImage) {
+        // Create test image, if enabled.
+        VkImageCreateInfo imageCreateInfo = VkImageCreateInfo();
+        imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCreateInfo.pNext = NULL;
+        imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageCreateInfo.format = m_videoProcessor->GetFrameImageFormat();
+        imageCreateInfo.extent = { imageWidth, imageHeight, 1 };
+        imageCreateInfo.mipLevels = 1;
+        imageCreateInfo.arrayLayers = 1;
+        imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCreateInfo.tiling = VK_IMAGE_TILING_LINEAR;
+        imageCreateInfo.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageCreateInfo.queueFamilyIndexCount = 1;
+        const uint32_t queueFamilyIndices = m_videoRenderer->m_vkDevCtx->GetGfxQueueFamilyIdx();
+        imageCreateInfo.pQueueFamilyIndices = &queueFamilyIndices;
+        imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+        imageCreateInfo.flags = 0;
+        m_videoRenderer->m_testFrameImage.CreateImage(m_videoRenderer->m_vkDevCtx, &imageCreateInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+            1 /* ColorPatternColorBars */, VK_EXTERNAL_MEMORY_HANDLE_TYPE_OPAQUE_FD_BIT);
+    }
 
     // Create per a frame draw context num == mSwapchainNumBufs.
 
@@ -214,7 +256,9 @@ int VulkanFrame::AttachSwapchain(const Shell& sh)
     };
 
     // Create Vulkan's RenderPass
-    m_videoRenderer->m_renderPass.CreateRenderPass(m_videoRenderer->m_vkDevCtx, ctx.format.format);
+    if (m_videoRenderer->m_renderPass.getRenderPass() == VK_NULL_HANDLE) {
+        m_videoRenderer->m_renderPass.CreateRenderPass(m_videoRenderer->m_vkDevCtx, ctx.format.format);
+    }
 
     m_videoRenderer->m_renderInfo.CreatePerDrawContexts(m_videoRenderer->m_vkDevCtx,
                                                        ctx.swapchain, &ctx.extent, &m_viewport, &m_scissor,
@@ -241,6 +285,209 @@ void VulkanFrame::PrepareViewport(const VkExtent2D& extent)
     m_scissor.extent = extent;
 }
 
+bool VulkanFrame::StartDecodeThread()
+{
+    m_exitDecodeThread = false;
+    m_decodeThreadEndOfStream = false;
+    m_decodeThread = std::thread(&VulkanFrame::DecodeThreadProc, this);
+    return m_decodeThread.joinable();
+}
+
+void VulkanFrame::StopDecodeThread()
+{
+    if (!m_decodeThread.joinable()) {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_decodedFramesMutex);
+        m_exitDecodeThread = true;
+    }
+    m_decodeThread.join();
+
+    // Return the frames the present side never consumed.
+    while (!m_decodedFramesQueue.empty()) {
+        DecodedFrame queuedFrame = m_decodedFramesQueue.front();
+        m_decodedFramesQueue.pop();
+        ReleaseUndisplayedFrame(&queuedFrame);
+    }
+}
+
+void VulkanFrame::DecodeThreadProc()
+{
+    VulkanThreadAffinity::PinCurrentThread(GetSettings().decodeThreadCpuSet, "decode");
+
+    bool endOfStream = false;
+    while (!endOfStream) {
+
+        DecodedFrame decodedFrame;
+        decodedFrame.Reset();
+        const int32_t numVideoFrames = m_videoProcessor->GetNextFrame(&decodedFrame, &endOfStream);
+
+        DecodedFrame dropFrame;
+        dropFrame.Reset();
+        {
+            std::unique_lock<std::mutex> lock(m_decodedFramesMutex);
+            if (m_exitDecodeThread) {
+                if (numVideoFrames > 0) {
+                    dropFrame = decodedFrame;
+                }
+                endOfStream = true;
+            } else if (numVideoFrames > 0) {
+                // Never stall the decode loop on a slow display: when the
+                // present side falls behind, drop the oldest queued frame to
+                // make room for the new one instead of blocking here.
+                if (m_decodedFramesQueue.size() >= maxQueuedDecodedFrames) {
+                    dropFrame = m_decodedFramesQueue.front();
+                    m_decodedFramesQueue.pop();
+                }
+                m_decodedFramesQueue.push(decodedFrame);
+                m_decodedFramesNotEmptyCond.notify_one();
+            }
+        }
+
+        if (dropFrame.pictureIndex != -1) {
+            ReleaseUndisplayedFrame(&dropFrame);
+        }
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_decodedFramesMutex);
+        m_decodeThreadEndOfStream = true;
+        m_decodedFramesNotEmptyCond.notify_all();
+    }
+}
+
+int32_t VulkanFrame::DequeueDecodedFrame(DecodedFrame* pFrame, bool* endOfStream)
+{
+    std::unique_lock<std::mutex> lock(m_decodedFramesMutex);
+    // The present pacing is the shell's own; when the display is faster than
+    // the decode, wait here for the next decoded frame, like GetNextFrame()
+    // does in the non-threaded mode.
+    m_decodedFramesNotEmptyCond.wait(lock, [this] {
+        return !m_decodedFramesQueue.empty() || m_decodeThreadEndOfStream;
+    });
+
+    if (!m_decodedFramesQueue.empty()) {
+        *pFrame = m_decodedFramesQueue.front();
+        m_decodedFramesQueue.pop();
+        *endOfStream = m_decodeThreadEndOfStream;
+        return 1;
+    }
+
+    *endOfStream = true;
+    return -1;
+}
+
+void VulkanFrame::ReleaseUndisplayedFrame(DecodedFrame* pFrame)
+{
+    // The frame was never handed to the graphics consumer, so only the decode
+    // completion needs to be waited on before returning the picture.
+    if (pFrame->frameCompleteTimelineSemaphore != VkSemaphore()) {
+        const VkSemaphoreWaitInfoKHR semaphoreWaitInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR, nullptr, 0,
+                                                           1, &pFrame->frameCompleteTimelineSemaphore,
+                                                           &pFrame->frameCompleteTimelineValue };
+        VkResult result = m_vkDevCtx->WaitSemaphoresKHR(*m_vkDevCtx, &semaphoreWaitInfo, 100 * 1000 * 1000 /* 100 mSec */);
+        assert(result == VK_SUCCESS);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nERROR: WaitSemaphoresKHR() result: 0x%x\n", result);
+        }
+    } else if (pFrame->frameCompleteFence != VkFence()) {
+        VkResult result = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &pFrame->frameCompleteFence, true, 100 * 1000 * 1000 /* 100 mSec */);
+        assert(result == VK_SUCCESS);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nERROR: WaitForFences() result: 0x%x\n", result);
+        }
+    }
+
+    if (pFrame->decodeDoneTimeNs == 0) {
+        pFrame->decodeDoneTimeNs = GetCurrentTimeNanoseconds();
+    }
+
+    if (!m_settings.perfCountersFile.empty() && (pFrame->pictureIndex != -1)) {
+        // The release below also counts the frame as displayed, so balance
+        // the books: this frame was dropped, not shown.
+        VulkanPerfCounters::Get().Add(VulkanPerfCounters::FRAMES_DROPPED);
+        VulkanPerfCounters::Get().Sub(VulkanPerfCounters::FRAMES_DISPLAYED);
+    }
+
+    m_videoProcessor->ReleaseDisplayedFrame(pFrame);
+    pFrame->Reset();
+}
+
+void VulkanFrame::ApplyDisplayDeadlinePolicy(DecodedFrame* pFrame, int32_t& numVideoFrames, bool& endOfStream)
+{
+    // Re-showing the previous picture means the display loop ran ahead of
+    // decode; only meaningful once playout has started.
+    if ((numVideoFrames <= 0) || (pFrame->pictureIndex == -1)) {
+        if (!endOfStream && (m_playoutBaseRealTimeNs != 0)) {
+            m_framesRepeated++;
+            if (!m_settings.perfCountersFile.empty()) {
+                VulkanPerfCounters::Get().Add(VulkanPerfCounters::FRAMES_REPEATED);
+            }
+        }
+        return;
+    }
+
+    // A stream discontinuity (seek, loop restart, un-pause) puts the target
+    // a long way from the wall clock; re-anchor the mapping instead of
+    // shedding everything after it.
+    const uint64_t resyncThresholdNs = 1000 * 1000 * 1000; // 1 second
+    const uint64_t budgetNs = (uint64_t)m_settings.displayDeadlineBudgetMs * 1000 * 1000;
+
+    while (true) {
+
+        if (pFrame->timestamp == 0) {
+            // No PTS came through for this frame - nothing to pace against.
+            return;
+        }
+
+        const uint64_t nowNs = GetCurrentTimeNanoseconds();
+        if (m_playoutBaseRealTimeNs == 0) {
+            // First timestamped frame anchors the PTS-to-wall-clock mapping.
+            m_playoutBaseRealTimeNs = nowNs - pFrame->timestamp;
+            return;
+        }
+
+        const uint64_t targetNs = m_playoutBaseRealTimeNs + pFrame->timestamp;
+        if (((targetNs + resyncThresholdNs) < nowNs) || (targetNs > (nowNs + resyncThresholdNs))) {
+            m_playoutBaseRealTimeNs = nowNs - pFrame->timestamp;
+            return;
+        }
+
+        if (nowNs <= targetNs) {
+            // On time (the early case is the shell pacer's business).
+            return;
+        }
+
+        if (nowNs <= (targetNs + budgetNs)) {
+            // Missed the target, but within the budget - display it and
+            // account for the slip.
+            m_framesLate++;
+            if (!m_settings.perfCountersFile.empty()) {
+                VulkanPerfCounters::Get().Add(VulkanPerfCounters::FRAMES_LATE);
+            }
+            return;
+        }
+
+        // Too late to be worth a draw and a present slot - shed the frame
+        // before it consumes graphics work and try the next one, which has
+        // a later deadline and may still make it.
+        m_framesDropped++;
+        ReleaseUndisplayedFrame(pFrame);
+        pFrame->Reset();
+
+        if (m_settings.enableDecoupledPresent) {
+            numVideoFrames = DequeueDecodedFrame(pFrame, &endOfStream);
+        } else {
+            numVideoFrames = m_videoProcessor->GetNextFrame(pFrame, &endOfStream);
+        }
+        if ((numVideoFrames <= 0) || (pFrame->pictureIndex == -1)) {
+            return;
+        }
+    }
+}
+
 bool VulkanFrame::OnKey(Key key)
 {
     switch (key) {
@@ -274,6 +521,16 @@ bool VulkanFrame::OnFrame( int32_t           renderIndex,
                           const VkSemaphore* pSignalSemaphores,
                           const DecodedFrame** ppOutFrame)
 {
+    // Mosaic composition (--mosaic): all the registered streams are
+    // advanced and composited in one pass. When the surface could not be
+    // created for the direct scanout copies the mode degrades to the
+    // regular single-stream path below (the AttachSwapchain() message
+    // already said so).
+    if (!m_mosaicStreams.empty() && m_useDirectScanout && (renderIndex >= 0)) {
+        return OnMosaicFrame(renderIndex, waitSemaphoreCount, pWaitSemaphores,
+                             signalSemaphoreCount, pSignalSemaphores);
+    }
+
     bool continueLoop = true;
     const bool dumpDebug = false;
     const bool trainFrame = (renderIndex < 0);
@@ -300,11 +557,33 @@ bool VulkanFrame::OnFrame( int32_t           renderIndex,
 
         pLastDecodedFrame = &data.lastDecodedFrame;
 
-        if ((gfxRendererIsEnabled == false) && (pLastDecodedFrame != nullptr)) {
+        // Deferred fence-wait: the frame buffer dequeues frames with their
+        // frame-complete fence and semaphores still attached, and everything
+        // that actually uses the frame synchronizes at the point of use -
+        // the file writer waits before its CPU readback and the decoder
+        // waits before it reuses the slot's images. The host wait here is
+        // only needed when the decode-complete time itself is consumed on
+        // this thread: the benchmark modes and the latency trace sample
+        // decodeDoneTimeNs below. Plain decode skips it and overlaps the
+        // CPU-side work of the next iteration with the tail of the decode.
+        const bool waitForDecodeComplete = (m_settings.benchmark ||
+                                            !m_settings.transcodeBenchmarkJsonFile.empty() ||
+                                            !m_settings.frameLatencyTraceFile.empty());
+
+        if ((gfxRendererIsEnabled == false) && (pLastDecodedFrame != nullptr) && waitForDecodeComplete) {
 
             // Graphics and present stages are not enabled.
             // Make sure the frame complete fence signaled (video frame is processed) before returning the frame.
-            if (pLastDecodedFrame->frameCompleteFence != VkFence()) {
+            if (pLastDecodedFrame->frameCompleteTimelineSemaphore != VkSemaphore()) {
+                const VkSemaphoreWaitInfoKHR semaphoreWaitInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR, nullptr, 0,
+                                                                   1, &pLastDecodedFrame->frameCompleteTimelineSemaphore,
+                                                                   &pLastDecodedFrame->frameCompleteTimelineValue };
+                VkResult result = m_vkDevCtx->WaitSemaphoresKHR(*m_vkDevCtx, &semaphoreWaitInfo, 100 * 1000 * 1000 /* 100 mSec */);
+                assert(result == VK_SUCCESS);
+                if (result != VK_SUCCESS) {
+                    fprintf(stderr, "\nERROR: WaitSemaphoresKHR() result: 0x%x\n", result);
+                }
+            } else if (pLastDecodedFrame->frameCompleteFence != VkFence()) {
                 VkResult result = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &pLastDecodedFrame->frameCompleteFence, true, 100 * 1000 * 1000 /* 100 mSec */);
                 assert(result == VK_SUCCESS);
                 if (result != VK_SUCCESS) {
@@ -316,6 +595,10 @@ bool VulkanFrame::OnFrame( int32_t           renderIndex,
                     fprintf(stderr, "\nERROR: GetFenceStatus() result: 0x%x\n", result);
                 }
             }
+
+            if ((pLastDecodedFrame->pictureIndex != -1) && (pLastDecodedFrame->decodeDoneTimeNs == 0)) {
+                pLastDecodedFrame->decodeDoneTimeNs = GetCurrentTimeNanoseconds();
+            }
         }
 
         m_videoProcessor->ReleaseDisplayedFrame(pLastDecodedFrame);
@@ -325,7 +608,19 @@ bool VulkanFrame::OnFrame( int32_t           renderIndex,
         bool endOfStream = false;
         int32_t numVideoFrames = 0;
 
-        numVideoFrames = m_videoProcessor->GetNextFrame(pLastDecodedFrame, &endOfStream);
+        if (m_settings.enableDecoupledPresent) {
+            if (!m_decodeThread.joinable()) {
+                StartDecodeThread();
+            }
+            numVideoFrames = DequeueDecodedFrame(pLastDecodedFrame, &endOfStream);
+        } else {
+            numVideoFrames = m_videoProcessor->GetNextFrame(pLastDecodedFrame, &endOfStream);
+        }
+
+        if (m_settings.displayDeadlineBudgetMs > 0) {
+            ApplyDisplayDeadlinePolicy(pLastDecodedFrame, numVideoFrames, endOfStream);
+        }
+
         if (endOfStream && (numVideoFrames < 0)) {
             continueLoop = false;
             bool displayTimeNow = true;
@@ -333,6 +628,12 @@ bool VulkanFrame::OnFrame( int32_t           renderIndex,
             if (displayTimeNow) {
                 std::cout << "\t\tFrame " << m_frameCount << ", FPS: " << fps << std::endl;
             }
+            if (m_settings.displayDeadlineBudgetMs > 0) {
+                std::cout << "Display deadline stats (budget "
+                          << m_settings.displayDeadlineBudgetMs << " ms): dropped "
+                          << m_framesDropped << ", late " << m_framesLate
+                          << ", repeated " << m_framesRepeated << std::endl;
+            }
         }
     }
 
@@ -415,46 +716,65 @@ VkResult VulkanFrame::DrawFrame( int32_t           renderIndex,
         displayHeight = inFrame->displayHeight;
     }
 
-    if (pPerDrawContext->samplerYcbcrConversion.GetSamplerYcbcrConversionCreateInfo().format != imageFormat) {
+    const VkCommandBuffer* pFrameCmdBuffer = nullptr;
+    if (m_useDirectScanout) {
+        // Present without the 3D engine: the decoded planes are copied
+        // straight into the swapchain image. For a test pattern frame no
+        // source exists yet, so only the transition of the swapchain image
+        // to the present layout is recorded.
+        pFrameCmdBuffer = pPerDrawContext->commandBuffer.GetOrRecordScanoutCopyCommandBuffer(
+            doTestPatternFrame ? nullptr : pRtImage,
+            displayWidth, displayHeight,
+            pPerDrawContext->frameBuffer.GetFbImage(), m_extent);
+    } else {
+
+        if (pPerDrawContext->samplerYcbcrConversion.GetSamplerYcbcrConversionCreateInfo().format != imageFormat) {
 
-        const static VkSamplerYcbcrConversionCreateInfo newSamplerYcbcrConversionCreateInfo = {
-            VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_CREATE_INFO,
-            NULL,
-            imageFormat,
-            m_samplerYcbcrModelConversion, // FIXME: consider/update the ITU 601, 709, 2020
-            m_samplerYcbcrRange,           // FIXME: consider/update the ITU range
+            const static VkSamplerYcbcrConversionCreateInfo newSamplerYcbcrConversionCreateInfo = {
+                VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_CREATE_INFO,
+                NULL,
+                imageFormat,
+                m_samplerYcbcrModelConversion, // FIXME: consider/update the ITU 601, 709, 2020
+                m_samplerYcbcrRange,           // FIXME: consider/update the ITU range
 #ifndef NV_RMAPI_TEGRA
-            { VK_COMPONENT_SWIZZLE_IDENTITY,
-                VK_COMPONENT_SWIZZLE_IDENTITY,
-                VK_COMPONENT_SWIZZLE_IDENTITY,
-                VK_COMPONENT_SWIZZLE_IDENTITY },
+                { VK_COMPONENT_SWIZZLE_IDENTITY,
+                    VK_COMPONENT_SWIZZLE_IDENTITY,
+                    VK_COMPONENT_SWIZZLE_IDENTITY,
+                    VK_COMPONENT_SWIZZLE_IDENTITY },
 #else
-            { VK_COMPONENT_SWIZZLE_B,
-                VK_COMPONENT_SWIZZLE_IDENTITY,
-                VK_COMPONENT_SWIZZLE_R,
-                VK_COMPONENT_SWIZZLE_IDENTITY },
+                { VK_COMPONENT_SWIZZLE_B,
+                    VK_COMPONENT_SWIZZLE_IDENTITY,
+                    VK_COMPONENT_SWIZZLE_R,
+                    VK_COMPONENT_SWIZZLE_IDENTITY },
 #endif
-            VK_CHROMA_LOCATION_MIDPOINT,
-            VK_CHROMA_LOCATION_MIDPOINT,
-            VK_FILTER_NEAREST,
-            false
-        };
-
-        if (pPerDrawContext->samplerYcbcrConversion.SamplerRequiresUpdate(nullptr, &newSamplerYcbcrConversionCreateInfo)) {
-            m_videoRenderer->m_renderInfo.UpdatePerDrawContexts(pPerDrawContext, &m_viewport, &m_scissor,
-                m_videoRenderer->m_renderPass.getRenderPass(), &defaultSamplerInfo,
-                &newSamplerYcbcrConversionCreateInfo);
+                VK_CHROMA_LOCATION_MIDPOINT,
+                VK_CHROMA_LOCATION_MIDPOINT,
+                VK_FILTER_NEAREST,
+                false
+            };
+
+            if (pPerDrawContext->samplerYcbcrConversion.SamplerRequiresUpdate(nullptr, &newSamplerYcbcrConversionCreateInfo)) {
+                m_videoRenderer->m_renderInfo.UpdatePerDrawContexts(pPerDrawContext, &m_viewport, &m_scissor,
+                    m_videoRenderer->m_renderPass.getRenderPass(), &defaultSamplerInfo,
+                    &newSamplerYcbcrConversionCreateInfo);
+            }
         }
-    }
-
-    pPerDrawContext->bufferDescriptorSet.WriteDescriptorSet(VkSampler(0), pRtImage->view);
 
-    pPerDrawContext->commandBuffer.CreateCommandBuffer(
-        m_videoRenderer->m_renderPass.getRenderPass(), pRtImage, displayWidth, displayHeight,
-        pPerDrawContext->frameBuffer.GetFbImage(),
-        pPerDrawContext->frameBuffer.GetFrameBuffer(), &m_scissor, pPerDrawContext->gfxPipeline.getPipeline(),
-        pPerDrawContext->bufferDescriptorSet.getPipelineLayout(), pPerDrawContext->bufferDescriptorSet.getDescriptorSet(),
-        &m_videoRenderer->m_vertexBuffer);
+        // The descriptor set is cached per decode output image view, so steady
+        // state rendering does not call vkUpdateDescriptorSets at all.
+        const VkDescriptorSet* pFrameDescriptorSet =
+            pPerDrawContext->bufferDescriptorSet.GetCachedDescriptorSet(VkSampler(0), pRtImage->view);
+
+        // The command buffer is pre-recorded per (decode output image view x
+        // display size) pair, so steady state rendering is reduced to the fence
+        // wait above plus the queue submission of an already recorded buffer.
+        pFrameCmdBuffer = pPerDrawContext->commandBuffer.GetOrRecordCommandBuffer(
+            m_videoRenderer->m_renderPass.getRenderPass(), pRtImage, displayWidth, displayHeight,
+            pPerDrawContext->frameBuffer.GetFbImage(),
+            pPerDrawContext->frameBuffer.GetFrameBuffer(), &m_scissor, pPerDrawContext->gfxPipeline.getPipeline(),
+            pPerDrawContext->bufferDescriptorSet.getPipelineLayout(), pFrameDescriptorSet,
+            &m_videoRenderer->m_vertexBuffer);
+    }
 
     if (dumpDebug) {
         LOG(INFO) << "Drawing Frame " << m_frameCount << " FB: " << renderIndex << std::endl;
@@ -492,6 +812,10 @@ VkResult VulkanFrame::DrawFrame( int32_t           renderIndex,
                     fprintf(stderr, "\nERROR: GetFenceStatus() result: 0x%x\n", result);
                 }
             }
+
+            if (inFrame->decodeDoneTimeNs == 0) {
+                inFrame->decodeDoneTimeNs = GetCurrentTimeNanoseconds();
+            }
         }
     }
 
@@ -578,7 +902,7 @@ VkResult VulkanFrame::DrawFrame( int32_t           renderIndex,
 
     primaryCmdSubmitInfo.waitSemaphoreCount = numWaitSemaphores;
     primaryCmdSubmitInfo.pWaitSemaphores = numWaitSemaphores ? waitSemaphores : NULL;
-    primaryCmdSubmitInfo.pCommandBuffers = pPerDrawContext->commandBuffer.getCommandBuffer();
+    primaryCmdSubmitInfo.pCommandBuffers = pFrameCmdBuffer;
 
     primaryCmdSubmitInfo.signalSemaphoreCount = numSignalSemaphores;
     primaryCmdSubmitInfo.pSignalSemaphores = numSignalSemaphores ? signalSemaphores : NULL;
@@ -630,6 +954,204 @@ VkResult VulkanFrame::DrawFrame( int32_t           renderIndex,
     return result;
 }
 
+int32_t VulkanFrame::AddMosaicStream(VkSharedBaseObj<VulkanVideoProcessor>& videoProcessor)
+{
+    MosaicStream stream;
+    stream.videoProcessor = videoProcessor;
+    stream.lastDecodedFrame.Reset();
+    stream.endOfStream = false;
+    m_mosaicStreams.push_back(stream);
+    return (int32_t)m_mosaicStreams.size();
+}
+
+bool VulkanFrame::OnMosaicFrame(int32_t renderIndex,
+                                uint32_t waitSemaphoreCount, const VkSemaphore* pWaitSemaphores,
+                                uint32_t signalSemaphoreCount, const VkSemaphore* pSignalSemaphores)
+{
+    m_frameCount++;
+
+    bool displayTimeNow = false;
+    float fps = GetFrameRateFps(displayTimeNow);
+    if (displayTimeNow) {
+        std::cout << "\t\tFrame " << m_frameCount << ", FPS: " << fps << std::endl;
+    }
+
+    // Advance every stream by one frame. A stream that ran out keeps its
+    // tile on the content it composited last.
+    uint32_t activeStreams = 0;
+    for (size_t streamIndx = 0; streamIndx < m_mosaicStreams.size(); streamIndx++) {
+
+        MosaicStream& stream = m_mosaicStreams[streamIndx];
+        if (stream.endOfStream) {
+            continue;
+        }
+
+        stream.videoProcessor->ReleaseDisplayedFrame(&stream.lastDecodedFrame);
+        stream.lastDecodedFrame.Reset();
+
+        bool endOfStream = false;
+        int32_t numVideoFrames = stream.videoProcessor->GetNextFrame(&stream.lastDecodedFrame, &endOfStream);
+        if (endOfStream && (numVideoFrames < 0)) {
+            stream.endOfStream = true;
+            stream.lastDecodedFrame.Reset();
+            continue;
+        }
+        activeStreams++;
+    }
+
+    if (activeStreams == 0) {
+        bool endDisplayTimeNow = true;
+        float endFps = GetFrameRateFps(endDisplayTimeNow);
+        if (endDisplayTimeNow) {
+            std::cout << "\t\tFrame " << m_frameCount << ", FPS: " << endFps << std::endl;
+        }
+        return false;
+    }
+
+    VkResult result = DrawMosaicFrame(renderIndex, waitSemaphoreCount, pWaitSemaphores,
+                                      signalSemaphoreCount, pSignalSemaphores);
+    return (result == VK_SUCCESS);
+}
+
+VkResult VulkanFrame::DrawMosaicFrame(int32_t renderIndex,
+                                      uint32_t waitSemaphoreCount, const VkSemaphore* pWaitSemaphores,
+                                      uint32_t signalSemaphoreCount, const VkSemaphore* pSignalSemaphores)
+{
+    vulkanVideoUtils::VulkanPerDrawContext* pPerDrawContext = m_videoRenderer->m_renderInfo.GetDrawContext(renderIndex);
+
+    const uint32_t numStreams = (uint32_t)m_mosaicStreams.size();
+
+    // Squarish tile grid. The cell sizes are kept even so the subsampled
+    // chroma planes stay aligned to their luma tiles.
+    uint32_t numColumns = 1;
+    while ((numColumns * numColumns) < numStreams) {
+        numColumns++;
+    }
+    const uint32_t numRows = (numStreams + numColumns - 1) / numColumns;
+    const uint32_t tileWidth = (m_extent.width / numColumns) & ~1u;
+    const uint32_t tileHeight = (m_extent.height / numRows) & ~1u;
+
+    // Member scratch - assign()/clear() reuse the capacity of the previous
+    // frame, so the steady-state composite does not touch the heap.
+    std::vector<vulkanVideoUtils::ImageResourceInfo>& tileImages = m_mosaicTileImages;
+    tileImages.assign(numStreams, vulkanVideoUtils::ImageResourceInfo());
+    std::vector<vulkanVideoUtils::MosaicCopyTile>& tiles = m_mosaicTiles;
+    tiles.assign(numStreams, vulkanVideoUtils::MosaicCopyTile());
+
+    std::vector<VkSemaphore>& waitSemaphores = m_mosaicWaitSemaphores;
+    std::vector<VkSemaphore>& signalSemaphores = m_mosaicSignalSemaphores;
+    waitSemaphores.clear();
+    signalSemaphores.clear();
+    waitSemaphores.reserve(numStreams + 1);
+    signalSemaphores.reserve(numStreams + 1);
+
+    assert(waitSemaphoreCount <= 1);
+    if ((waitSemaphoreCount > 0) && (pWaitSemaphores != nullptr)) {
+        waitSemaphores.push_back(*pWaitSemaphores);
+    }
+    assert(signalSemaphoreCount <= 1);
+    if ((signalSemaphoreCount > 0) && (pSignalSemaphores != nullptr)) {
+        signalSemaphores.push_back(*pSignalSemaphores);
+    }
+
+    VkFence frameConsumerDoneFence = VkFence();
+    VkResult result = VK_SUCCESS;
+
+    for (uint32_t streamIndx = 0; streamIndx < numStreams; streamIndx++) {
+
+        vulkanVideoUtils::MosaicCopyTile& tile = tiles[streamIndx];
+        tile.tileRect.offset = { (int32_t)((streamIndx % numColumns) * tileWidth),
+                                 (int32_t)((streamIndx / numColumns) * tileHeight) };
+        tile.tileRect.extent = { tileWidth, tileHeight };
+
+        DecodedFrame& frame = m_mosaicStreams[streamIndx].lastDecodedFrame;
+        if ((frame.pictureIndex == -1) ||
+                !frame.outputImageView ||
+                (frame.outputImageView->GetImageView() == VK_NULL_HANDLE)) {
+            continue;
+        }
+
+        VkImageResourceView* pView = frame.outputImageView;
+        VkImageResource* pImage = pView->GetImageResource();
+        if (pImage->GetImageCreateInfo().format != m_vkFormat) {
+            // vkCmdCopyImage cannot convert - a stream decoding to a format
+            // other than the swapchain's keeps its tile empty.
+            continue;
+        }
+
+        vulkanVideoUtils::ImageResourceInfo& rtImage = tileImages[streamIndx];
+        rtImage.imageFormat = pImage->GetImageCreateInfo().format;
+        rtImage.imageWidth = pImage->GetImageCreateInfo().extent.width;
+        rtImage.imageHeight = pImage->GetImageCreateInfo().extent.height;
+        rtImage.arrayLayer = pView->GetImageSubresourceRange().baseArrayLayer;
+        rtImage.imageLayout = VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR;
+        rtImage.image = pImage->GetImage();
+        rtImage.view = pView->GetImageView();
+
+        tile.inputImage = &rtImage;
+        tile.displayWidth = frame.displayWidth;
+        tile.displayHeight = frame.displayHeight;
+
+        // The composite waits for the decode on the GPU when the stream
+        // signals a semaphore and on the host otherwise - the same policy
+        // as the single-stream DrawFrame().
+        if (frame.frameCompleteSemaphore != VkSemaphore()) {
+            waitSemaphores.push_back(frame.frameCompleteSemaphore);
+        } else if (frame.frameCompleteFence != VkFence()) {
+            result = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &frame.frameCompleteFence, true, 100 * 1000 * 1000 /* 100 mSec */);
+            assert(result == VK_SUCCESS);
+            if (result != VK_SUCCESS) {
+                fprintf(stderr, "\nERROR: WaitForFences() result: 0x%x\n", result);
+            }
+        }
+        if (frame.decodeDoneTimeNs == 0) {
+            frame.decodeDoneTimeNs = GetCurrentTimeNanoseconds();
+        }
+
+        if (frame.frameConsumerDoneSemaphore != VkSemaphore()) {
+            signalSemaphores.push_back(frame.frameConsumerDoneSemaphore);
+            frame.hasConsummerSignalSemaphore = true;
+        }
+        if ((frameConsumerDoneFence == VkFence()) && (frame.frameConsumerDoneFence != VkFence())) {
+            // A submission signals a single fence; the remaining streams
+            // are covered by their consumer-done semaphores above.
+            frameConsumerDoneFence = frame.frameConsumerDoneFence;
+            frame.hasConsummerSignalFence = true;
+        }
+    }
+
+    // The entire tile grid goes into one command buffer; with the single
+    // submission below and the shell's single present this is one
+    // submit+present per display frame for all the streams.
+    const VkCommandBuffer* pFrameCmdBuffer =
+        pPerDrawContext->commandBuffer.GetOrRecordMosaicCopyCommandBuffer(tiles.data(), numStreams,
+                                                                          pPerDrawContext->frameBuffer.GetFbImage(),
+                                                                          m_extent);
+
+    std::vector<VkPipelineStageFlags>& primaryCmdSubmitWaitStages = m_mosaicWaitStages;
+    primaryCmdSubmitWaitStages.assign(waitSemaphores.size(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+    VkSubmitInfo primaryCmdSubmitInfo = VkSubmitInfo();
+    primaryCmdSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    primaryCmdSubmitInfo.pWaitDstStageMask = primaryCmdSubmitWaitStages.data();
+    primaryCmdSubmitInfo.commandBufferCount = 1;
+    primaryCmdSubmitInfo.pCommandBuffers = pFrameCmdBuffer;
+
+    primaryCmdSubmitInfo.waitSemaphoreCount = (uint32_t)waitSemaphores.size();
+    primaryCmdSubmitInfo.pWaitSemaphores = waitSemaphores.empty() ? NULL : waitSemaphores.data();
+
+    primaryCmdSubmitInfo.signalSemaphoreCount = (uint32_t)signalSemaphores.size();
+    primaryCmdSubmitInfo.pSignalSemaphores = signalSemaphores.empty() ? NULL : signalSemaphores.data();
+
+    result = m_vkDevCtx->QueueSubmit(m_gfxQueue, 1, &primaryCmdSubmitInfo, frameConsumerDoneFence);
+    if (result != VK_SUCCESS) {
+        assert(result == VK_SUCCESS);
+        fprintf(stderr, "\nERROR: QueueSubmit() result: 0x%x\n", result);
+        return result;
+    }
+
+    return result;
+}
+
 VkResult VulkanFrame::Create(const ProgramConfig& programConfig,
                              const VulkanDeviceContext* vkDevCtx,
                              VkSharedBaseObj<VulkanVideoProcessor>& videoProcessor,
@@ -20,6 +20,7 @@
 #include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <queue>
 #include <string>
 #include <thread>
 #include <vector>
@@ -78,6 +79,9 @@ public:
 
     int GetVideoWidth();
     int GetVideoHeight();
+    virtual VkFormat GetFrameImageFormat();
+
+    virtual int32_t AddMosaicStream(VkSharedBaseObj<VulkanVideoProcessor>& videoProcessor);
 
     // called by attach_swapchain
     void PrepareViewport(const VkExtent2D& extent);
@@ -88,6 +92,37 @@ private:
                 VkSharedBaseObj<VulkanVideoProcessor>& videoProcessor);
     virtual ~VulkanFrame();
 
+    // Decoupled present mode (see --decoupledPresent): the decode loop runs
+    // in its own thread, pushing DecodedFrames into a small queue that the
+    // shell's present loop consumes with its own pacing. When the swapchain
+    // blocks in vkQueuePresentKHR (FIFO vsync), only the present side stalls -
+    // the decode thread keeps going, dropping the oldest queued frame when
+    // the display falls behind.
+    bool StartDecodeThread();
+    void StopDecodeThread();
+    void DecodeThreadProc();
+    int32_t DequeueDecodedFrame(DecodedFrame* pFrame, bool* endOfStream);
+    void ReleaseUndisplayedFrame(DecodedFrame* pFrame);
+
+    // Deadline-aware display (see --displayDeadline): derives a target
+    // display time for the frame from its demuxed PTS, sheds frames that
+    // missed it by more than the configured budget before they consume
+    // graphics work, and keeps the dropped/late/repeated counts.
+    void ApplyDisplayDeadlinePolicy(DecodedFrame* pFrame, int32_t& numVideoFrames, bool& endOfStream);
+
+    // Mosaic composition mode (see --mosaic): one decode stream per tile,
+    // advanced in lockstep, composited into the swapchain image with a
+    // single command buffer, submission and present per display frame -
+    // instead of the one submit+present each stream would cost through the
+    // per-stream render path. The composite rides on the direct scanout
+    // copies, so it needs the swapchain in the decoder output format.
+    bool OnMosaicFrame(int32_t renderIndex,
+                       uint32_t waitSemaphoreCount, const VkSemaphore* pWaitSemaphores,
+                       uint32_t signalSemaphoreCount, const VkSemaphore* pSignalSemaphores);
+    VkResult DrawMosaicFrame(int32_t renderIndex,
+                             uint32_t waitSemaphoreCount, const VkSemaphore* pWaitSemaphores,
+                             uint32_t signalSemaphoreCount, const VkSemaphore* pSignalSemaphores);
+
 private:
     std::atomic<int32_t>                  m_refCount;
     const VulkanDeviceContext*            m_vkDevCtx;
@@ -102,6 +137,10 @@ public:
     bool                                  m_codecPaused;
     VkQueue                               m_gfxQueue;
     VkFormat                              m_vkFormat;
+    // Direct scanout (--directScanout): decoded frames are copied
+    // plane-for-plane into the swapchain image instead of being drawn
+    // through the render pass (see AttachSwapchain()).
+    bool                                  m_useDirectScanout;
 
     VkPhysicalDeviceProperties            m_physicalDevProps;
     std::vector<VkMemoryPropertyFlags>    m_memFlags;
@@ -114,6 +153,41 @@ public:
     std::vector<FrameData>                m_frameData;
     int                                   m_frameDataIndex;
 
+    // Decoupled present mode state (see DecodeThreadProc()).
+    static const uint32_t                 maxQueuedDecodedFrames = 4;
+    std::thread                           m_decodeThread;
+    std::mutex                            m_decodedFramesMutex;
+    std::condition_variable               m_decodedFramesNotEmptyCond;
+    std::queue<DecodedFrame>              m_decodedFramesQueue;
+    bool                                  m_exitDecodeThread;
+    bool                                  m_decodeThreadEndOfStream;
+
+    // Deadline-aware display state (see ApplyDisplayDeadlinePolicy()):
+    // the wall-clock time PTS 0 maps to, established from the first
+    // timestamped frame and re-established on discontinuities, plus the
+    // dropped/late/repeated accounting.
+    uint64_t                              m_playoutBaseRealTimeNs;
+    uint64_t                              m_framesDropped;
+    uint64_t                              m_framesLate;
+    uint64_t                              m_framesRepeated;
+
+    // Mosaic composition state (see OnMosaicFrame()): the registered decode
+    // streams and, per stream, the frame its tile currently shows. A stream
+    // that ran out keeps its endOfStream mark and its cell stops updating.
+    struct MosaicStream {
+        VkSharedBaseObj<VulkanVideoProcessor> videoProcessor;
+        DecodedFrame                          lastDecodedFrame;
+        bool                                  endOfStream;
+    };
+    std::vector<MosaicStream>             m_mosaicStreams;
+    // Per-frame scratch of DrawMosaicFrame(), kept here so the steady-state
+    // composite reuses the capacity instead of reallocating every frame.
+    std::vector<vulkanVideoUtils::ImageResourceInfo> m_mosaicTileImages;
+    std::vector<vulkanVideoUtils::MosaicCopyTile> m_mosaicTiles;
+    std::vector<VkSemaphore>              m_mosaicWaitSemaphores;
+    std::vector<VkSemaphore>              m_mosaicSignalSemaphores;
+    std::vector<VkPipelineStageFlags>     m_mosaicWaitStages;
+
     VkExtent2D                            m_extent;
     VkViewport                            m_viewport;
     VkRect2D                              m_scissor;
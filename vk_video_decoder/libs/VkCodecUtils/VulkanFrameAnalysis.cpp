@@ -0,0 +1,597 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <iomanip>
+#include <iostream>
+#include <string.h>
+#include "VkCodecUtils/Helpers.h"
+#include "VkCodecUtils/VulkanFrameAnalysis.h"
+#include "VkCodecUtils/VulkanShaderCompiler.h"
+
+// One workgroup per frame; every invocation strides over the luma texels,
+// accumulating a private histogram and a partial luma sum, and folds them
+// into the frame's record with one atomic per bin at the end, so the record
+// is a commutative sum and independent of the invocation scheduling. Slot 0
+// of the record buffer is the whole-stream record, the per-frame records
+// follow at slot (1 + frameIndex) while frameIndex is below the
+// tracked-frames limit. The luma sum is kept in 8-bit code values and
+// pre-shifted (see lumaSumShift in the header) so it cannot overflow 32 bits
+// even on 8K frames.
+static const char s_frameAnalysisShader[] =
+    "#version 450\n"
+    "layout(local_size_x = 64, local_size_y = 1, local_size_z = 1) in;\n"
+    "layout(set = 0, binding = 0) uniform sampler2D lumaPlane;\n"
+    "layout(set = 0, binding = 1) buffer Records { uint records[]; };\n"
+    "layout(push_constant) uniform PushConstants {\n"
+    "    uint frameSlot;    // 0 when the frame only folds into the stream record\n"
+    "    uint lumaWidth;\n"
+    "    uint lumaHeight;\n"
+    "} pc;\n"
+    "\n"
+    "const uint numBins = 64u;\n"
+    "const uint recordStride = numBins + 2u;\n"
+    "const uint lumaSumShift = 4u;\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    uint localBins[numBins];\n"
+    "    for (uint bin = 0u; bin < numBins; bin++) {\n"
+    "        localBins[bin] = 0u;\n"
+    "    }\n"
+    "    uint lumaPartial = 0u;\n"
+    "    const uint stride = gl_WorkGroupSize.x;\n"
+    "    for (uint y = 0u; y < pc.lumaHeight; y++) {\n"
+    "        for (uint x = gl_LocalInvocationID.x; x < pc.lumaWidth; x += stride) {\n"
+    "            float luma = texelFetch(lumaPlane, ivec2(x, y), 0).r;\n"
+    "            localBins[min(uint(luma * float(numBins)), numBins - 1u)]++;\n"
+    "            lumaPartial += uint(round(luma * 255.0));\n"
+    "        }\n"
+    "    }\n"
+    "    const uint frameBase = pc.frameSlot * recordStride;\n"
+    "    for (uint bin = 0u; bin < numBins; bin++) {\n"
+    "        if (localBins[bin] != 0u) {\n"
+    "            if (pc.frameSlot != 0u) {\n"
+    "                atomicAdd(records[frameBase + bin], localBins[bin]);\n"
+    "            }\n"
+    "            // Every frame also folds into the whole-stream record.\n"
+    "            atomicAdd(records[bin], localBins[bin]);\n"
+    "        }\n"
+    "    }\n"
+    "    if (pc.frameSlot != 0u) {\n"
+    "        atomicAdd(records[frameBase + numBins], lumaPartial >> lumaSumShift);\n"
+    "    }\n"
+    "    atomicAdd(records[numBins], lumaPartial >> lumaSumShift);\n"
+    "    if (gl_LocalInvocationID.x == 0u) {\n"
+    "        if (pc.frameSlot != 0u) {\n"
+    "            atomicAdd(records[frameBase + numBins + 1u], pc.lumaWidth * pc.lumaHeight);\n"
+    "        }\n"
+    "        atomicAdd(records[numBins + 1u], pc.lumaWidth * pc.lumaHeight);\n"
+    "    }\n"
+    "}\n";
+
+struct FrameAnalysisPushConstants {
+    uint32_t frameSlot;
+    uint32_t lumaWidth;
+    uint32_t lumaHeight;
+};
+
+VkResult VulkanFrameAnalysis::Create(const VulkanDeviceContext* vkDevCtx,
+                                     VkSharedBaseObj<VulkanFrameAnalysis>& frameAnalysis)
+{
+    VkSharedBaseObj<VulkanFrameAnalysis> newFrameAnalysis(new VulkanFrameAnalysis(vkDevCtx));
+    if (!newFrameAnalysis) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    frameAnalysis = newFrameAnalysis;
+    return VK_SUCCESS;
+}
+
+int32_t VulkanFrameAnalysis::AddRef()
+{
+    return ++m_refCount;
+}
+
+int32_t VulkanFrameAnalysis::Release()
+{
+    uint32_t ret = --m_refCount;
+    // Destroy the device if ref-count reaches zero
+    if (ret == 0) {
+        delete this;
+    }
+    return ret;
+}
+
+VulkanFrameAnalysis::~VulkanFrameAnalysis()
+{
+    Deinitialize();
+}
+
+// Maps the multi-planar decode format to the single-plane format the luma
+// image view is created with.
+static VkResult GetLumaPlaneFormat(VkFormat imageFormat, VkFormat* pLumaFormat)
+{
+    switch (imageFormat) {
+    case VK_FORMAT_G8_B8R8_2PLANE_420_UNORM:
+    case VK_FORMAT_G8_B8R8_2PLANE_422_UNORM:
+        *pLumaFormat = VK_FORMAT_R8_UNORM;
+        return VK_SUCCESS;
+    case VK_FORMAT_G10X6_B10X6R10X6_2PLANE_420_UNORM_3PACK16:
+    case VK_FORMAT_G10X6_B10X6R10X6_2PLANE_422_UNORM_3PACK16:
+        *pLumaFormat = VK_FORMAT_R10X6_UNORM_PACK16;
+        return VK_SUCCESS;
+    case VK_FORMAT_G12X4_B12X4R12X4_2PLANE_420_UNORM_3PACK16:
+    case VK_FORMAT_G12X4_B12X4R12X4_2PLANE_422_UNORM_3PACK16:
+        *pLumaFormat = VK_FORMAT_R12X4_UNORM_PACK16;
+        return VK_SUCCESS;
+    case VK_FORMAT_G16_B16R16_2PLANE_420_UNORM:
+    case VK_FORMAT_G16_B16R16_2PLANE_422_UNORM:
+        *pLumaFormat = VK_FORMAT_R16_UNORM;
+        return VK_SUCCESS;
+    default:
+        assert(!"Unsupported decode image format for the GPU frame analysis");
+        return VK_ERROR_FORMAT_NOT_SUPPORTED;
+    }
+}
+
+VkResult VulkanFrameAnalysis::Initialize(VkFormat imageFormat)
+{
+    if (m_imageFormat == imageFormat) {
+        // Already initialized for this format.
+        return VK_SUCCESS;
+    }
+
+    Deinitialize();
+
+    VkResult result = GetLumaPlaneFormat(imageFormat, &m_lumaPlaneFormat);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    const VkSamplerCreateInfo samplerCreateInfo = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO, nullptr, 0,
+                                                    VK_FILTER_NEAREST, VK_FILTER_NEAREST,
+                                                    VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                                                    VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                    VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                    VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE };
+    result = m_vkDevCtx->CreateSampler(*m_vkDevCtx, &samplerCreateInfo, nullptr, &m_sampler);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    const VkDescriptorSetLayoutBinding bindings[2] = {
+        { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, &m_sampler },
+        { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+    };
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    descriptorSetLayoutCreateInfo.bindingCount = 2;
+    descriptorSetLayoutCreateInfo.pBindings = bindings;
+    result = m_vkDevCtx->CreateDescriptorSetLayout(*m_vkDevCtx, &descriptorSetLayoutCreateInfo,
+                                                   nullptr, &m_descriptorSetLayout);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    const VkPushConstantRange pushConstantRange = { VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                                                    sizeof(FrameAnalysisPushConstants) };
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+    pipelineLayoutCreateInfo.setLayoutCount = 1;
+    pipelineLayoutCreateInfo.pSetLayouts = &m_descriptorSetLayout;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    result = m_vkDevCtx->CreatePipelineLayout(*m_vkDevCtx, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    vulkanVideoUtils::VulkanShaderCompiler shaderCompiler;
+    result = shaderCompiler.BuildGlslShader(s_frameAnalysisShader, strlen(s_frameAnalysisShader),
+                                            VK_SHADER_STAGE_COMPUTE_BIT,
+                                            m_vkDevCtx, &m_shaderModule);
+    if (result != VK_SUCCESS) {
+        assert(!"Could not compile the frame analysis shader!");
+        return result;
+    }
+
+    VkComputePipelineCreateInfo pipelineCreateInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+    pipelineCreateInfo.stage = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
+                                 VK_SHADER_STAGE_COMPUTE_BIT, m_shaderModule, "main", nullptr };
+    pipelineCreateInfo.layout = m_pipelineLayout;
+    result = m_vkDevCtx->CreateComputePipelines(*m_vkDevCtx, VkPipelineCache(), 1,
+                                                &pipelineCreateInfo, nullptr, &m_pipeline);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkCommandPoolCreateInfo cmdPoolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    cmdPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    cmdPoolCreateInfo.queueFamilyIndex = m_vkDevCtx->GetGfxQueueFamilyIdx();
+    result = m_vkDevCtx->CreateCommandPool(*m_vkDevCtx, &cmdPoolCreateInfo, nullptr, &m_cmdPool);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    const VkDescriptorPoolSize poolSizes[2] = {
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, numDispatchSlots },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         numDispatchSlots },
+    };
+    VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    descriptorPoolCreateInfo.maxSets = numDispatchSlots;
+    descriptorPoolCreateInfo.poolSizeCount = 2;
+    descriptorPoolCreateInfo.pPoolSizes = poolSizes;
+    result = m_vkDevCtx->CreateDescriptorPool(*m_vkDevCtx, &descriptorPoolCreateInfo, nullptr, &m_descriptorPool);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    for (uint32_t slot = 0; slot < numDispatchSlots; slot++) {
+
+        VkCommandBufferAllocateInfo cmdBufferAllocInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+        cmdBufferAllocInfo.commandPool = m_cmdPool;
+        cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmdBufferAllocInfo.commandBufferCount = 1;
+        result = m_vkDevCtx->AllocateCommandBuffers(*m_vkDevCtx, &cmdBufferAllocInfo,
+                                                    &m_dispatchSlots[slot].commandBuffer);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+
+        VkDescriptorSetAllocateInfo descriptorSetAllocInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+        descriptorSetAllocInfo.descriptorPool = m_descriptorPool;
+        descriptorSetAllocInfo.descriptorSetCount = 1;
+        descriptorSetAllocInfo.pSetLayouts = &m_descriptorSetLayout;
+        result = m_vkDevCtx->AllocateDescriptorSets(*m_vkDevCtx, &descriptorSetAllocInfo,
+                                                    &m_dispatchSlots[slot].descriptorSet);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+
+        const VkFenceCreateInfo fenceCreateInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+        result = m_vkDevCtx->CreateFence(*m_vkDevCtx, &fenceCreateInfo, nullptr, &m_dispatchSlots[slot].fence);
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+        m_dispatchSlots[slot].submitted = false;
+    }
+
+    result = CreateRecordBuffer();
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    m_imageFormat = imageFormat;
+    m_queuedFrameCount = 0;
+    return VK_SUCCESS;
+}
+
+VkResult VulkanFrameAnalysis::CreateRecordBuffer()
+{
+    const VkDeviceSize bufferSize = recordStrideWords * (1 + maxTrackedFrames) * sizeof(uint32_t);
+
+    VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    bufferCreateInfo.size = bufferSize;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkResult result = m_vkDevCtx->CreateBuffer(*m_vkDevCtx, &bufferCreateInfo, nullptr, &m_recordBuffer);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    m_vkDevCtx->GetBufferMemoryRequirements(*m_vkDevCtx, m_recordBuffer, &memoryRequirements);
+
+    // Host-visible, so the records can be read back directly at end of stream.
+    uint32_t memoryTypeIndex = 0;
+    result = vk::MapMemoryTypeToIndex(m_vkDevCtx, m_vkDevCtx->getPhysicalDevice(),
+                                      memoryRequirements.memoryTypeBits,
+                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                      &memoryTypeIndex);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkMemoryAllocateInfo memoryAllocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+    memoryAllocInfo.allocationSize = memoryRequirements.size;
+    memoryAllocInfo.memoryTypeIndex = memoryTypeIndex;
+    result = m_vkDevCtx->AllocateMemory(*m_vkDevCtx, &memoryAllocInfo, nullptr, &m_recordMemory);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    result = m_vkDevCtx->BindBufferMemory(*m_vkDevCtx, m_recordBuffer, m_recordMemory, 0);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    result = m_vkDevCtx->MapMemory(*m_vkDevCtx, m_recordMemory, 0, bufferSize, 0,
+                                   (void**)&m_pMappedRecords);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    memset(m_pMappedRecords, 0x00, (size_t)bufferSize);
+    return VK_SUCCESS;
+}
+
+VkResult VulkanFrameAnalysis::GetLumaImageView(VkImage decodedImage, VkImageView* pLumaView)
+{
+    auto cachedView = m_lumaViewCache.find(decodedImage);
+    if (cachedView != m_lumaViewCache.end()) {
+        *pLumaView = cachedView->second;
+        return VK_SUCCESS;
+    }
+
+    VkImageViewCreateInfo viewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+    viewCreateInfo.image = decodedImage;
+    viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewCreateInfo.format = m_lumaPlaneFormat;
+    viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_PLANE_0_BIT, 0, 1, 0, 1 };
+    VkResult result = m_vkDevCtx->CreateImageView(*m_vkDevCtx, &viewCreateInfo, nullptr, pLumaView);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    m_lumaViewCache[decodedImage] = *pLumaView;
+    return VK_SUCCESS;
+}
+
+VkResult VulkanFrameAnalysis::QueueFrameAnalysis(VkImage decodedImage,
+                                                 const VkExtent2D& codedExtent,
+                                                 VkImageLayout imageLayout,
+                                                 VkSemaphore timelineSemaphore,
+                                                 uint64_t timelineValue,
+                                                 uint32_t frameIndex)
+{
+    if (m_pipeline == VkPipeline()) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    if (timelineSemaphore == VkSemaphore()) {
+        assert(!"The GPU frame analysis requires the timeline frame synchronization");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    DispatchSlot& slot = m_dispatchSlots[m_queuedFrameCount % numDispatchSlots];
+
+    // Recycle the slot's command buffer.
+    if (slot.submitted) {
+        VkResult fenceResult = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &slot.fence, true,
+                                                         1000 * 1000 * 1000 /* 1000 ms */);
+        assert(fenceResult == VK_SUCCESS);
+        if (fenceResult != VK_SUCCESS) {
+            return fenceResult;
+        }
+        m_vkDevCtx->ResetFences(*m_vkDevCtx, 1, &slot.fence);
+        slot.submitted = false;
+    }
+
+    VkImageView lumaView = VkImageView();
+    VkResult result = GetLumaImageView(decodedImage, &lumaView);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    const VkDescriptorImageInfo imageInfo = { m_sampler, lumaView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    const VkDescriptorBufferInfo bufferInfo = { m_recordBuffer, 0, VK_WHOLE_SIZE };
+    const VkWriteDescriptorSet descriptorWrites[2] = {
+        { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, slot.descriptorSet, 0, 0, 1,
+          VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &imageInfo, nullptr, nullptr },
+        { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, slot.descriptorSet, 1, 0, 1,
+          VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &bufferInfo, nullptr },
+    };
+    m_vkDevCtx->UpdateDescriptorSets(*m_vkDevCtx, 2, descriptorWrites, 0, nullptr);
+
+    const VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, nullptr,
+                                                 VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+    m_vkDevCtx->BeginCommandBuffer(slot.commandBuffer, &beginInfo);
+
+    VkImageMemoryBarrier imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    imageBarrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    imageBarrier.oldLayout = imageLayout;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = decodedImage;
+    imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    m_vkDevCtx->CmdPipelineBarrier(slot.commandBuffer,
+                                   VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                   0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+    m_vkDevCtx->CmdBindPipeline(slot.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    m_vkDevCtx->CmdBindDescriptorSets(slot.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                      m_pipelineLayout, 0, 1, &slot.descriptorSet, 0, nullptr);
+
+    FrameAnalysisPushConstants pushConstants;
+    pushConstants.frameSlot = (frameIndex < maxTrackedFrames) ? (1 + frameIndex) : 0;
+    pushConstants.lumaWidth = codedExtent.width;
+    pushConstants.lumaHeight = codedExtent.height;
+    m_vkDevCtx->CmdPushConstants(slot.commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                                 0, sizeof(pushConstants), &pushConstants);
+
+    m_vkDevCtx->CmdDispatch(slot.commandBuffer, 1, 1, 1);
+
+    // Return the image to the layout the decoder and the consumers expect.
+    imageBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageBarrier.newLayout = imageLayout;
+    m_vkDevCtx->CmdPipelineBarrier(slot.commandBuffer,
+                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                   VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                   0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+    m_vkDevCtx->EndCommandBuffer(slot.commandBuffer);
+
+    // Wait for the decode-complete point of the picture on the session
+    // timeline. Timeline semaphores permit a wait submitted ahead of the
+    // signal, so the dispatch can be queued right after the decode is
+    // recorded, even when the decode submission itself is still batched.
+    const VkPipelineStageFlags waitDstStageMask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    VkTimelineSemaphoreSubmitInfoKHR timelineSubmitInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR };
+    timelineSubmitInfo.waitSemaphoreValueCount = 1;
+    timelineSubmitInfo.pWaitSemaphoreValues = &timelineValue;
+
+    VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO, &timelineSubmitInfo };
+    submitInfo.waitSemaphoreCount = 1;
+    submitInfo.pWaitSemaphores = &timelineSemaphore;
+    submitInfo.pWaitDstStageMask = &waitDstStageMask;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &slot.commandBuffer;
+
+    result = m_vkDevCtx->QueueSubmit(m_vkDevCtx->GetGfxQueue(), 1, &submitInfo, slot.fence);
+    if (result != VK_SUCCESS) {
+        assert(!"Could not submit the frame analysis dispatch!");
+        return result;
+    }
+
+    slot.submitted = true;
+    m_queuedFrameCount++;
+    return VK_SUCCESS;
+}
+
+VkResult VulkanFrameAnalysis::ReportStatistics(std::ostream& outStream)
+{
+    if (m_pMappedRecords == nullptr) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    // Drain the outstanding dispatches.
+    for (uint32_t slot = 0; slot < numDispatchSlots; slot++) {
+        if (m_dispatchSlots[slot].submitted) {
+            VkResult result = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &m_dispatchSlots[slot].fence,
+                                                        true, 1000 * 1000 * 1000 /* 1000 ms */);
+            assert(result == VK_SUCCESS);
+            if (result != VK_SUCCESS) {
+                return result;
+            }
+        }
+    }
+
+    const uint32_t reportedFrames = std::min(m_queuedFrameCount, maxTrackedFrames);
+    const std::ios_base::fmtflags savedFlags = outStream.flags();
+    outStream << "Decoded frame statistics (average luma in 8-bit code values):" << std::endl
+              << std::fixed << std::setprecision(1);
+    uint32_t blackFrames = 0;
+    uint32_t freezeFrames = 0;
+    for (uint32_t frame = 0; frame < reportedFrames; frame++) {
+        const uint32_t* record = &m_pMappedRecords[(1 + frame) * recordStrideWords];
+        const uint32_t sampleCount = record[numHistogramBins + 1];
+        const uint64_t lumaSum = (uint64_t)record[numHistogramBins] << lumaSumShift;
+        const double averageLuma = (sampleCount != 0) ? ((double)lumaSum / sampleCount) : 0.0;
+        const bool isBlack = (averageLuma < blackFrameLumaThreshold);
+        // A frame with a record identical to the previous frame's is flagged
+        // frozen; the histogram plus the luma sum makes an accidental
+        // collision between distinct frames very unlikely.
+        const bool isFrozen = (frame > 0) &&
+            (memcmp(record, record - recordStrideWords, recordStrideWords * sizeof(uint32_t)) == 0);
+        outStream << "  frame " << frame << ": " << averageLuma;
+        if (isBlack) {
+            outStream << " black";
+            blackFrames++;
+        }
+        if (isFrozen) {
+            outStream << " freeze";
+            freezeFrames++;
+        }
+        outStream << std::endl;
+    }
+
+    outStream << "Stream luma histogram over " << m_queuedFrameCount << " frames ("
+              << numHistogramBins << " bins):" << std::endl;
+    for (uint32_t bin = 0; bin < numHistogramBins; bin++) {
+        outStream << ((bin % 8 == 0) ? "  " : " ") << m_pMappedRecords[bin];
+        if (bin % 8 == 7) {
+            outStream << std::endl;
+        }
+    }
+    outStream << "Black frames: " << blackFrames << ", freeze frames: " << freezeFrames
+              << " (of " << reportedFrames << " tracked)" << std::endl;
+    outStream.flags(savedFlags);
+
+    return VK_SUCCESS;
+}
+
+void VulkanFrameAnalysis::Deinitialize()
+{
+    if (m_vkDevCtx == nullptr) {
+        return;
+    }
+
+    for (uint32_t slot = 0; slot < numDispatchSlots; slot++) {
+        if (m_dispatchSlots[slot].submitted) {
+            m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &m_dispatchSlots[slot].fence, true,
+                                      1000 * 1000 * 1000 /* 1000 ms */);
+            m_dispatchSlots[slot].submitted = false;
+        }
+        if (m_dispatchSlots[slot].fence != VkFence()) {
+            m_vkDevCtx->DestroyFence(*m_vkDevCtx, m_dispatchSlots[slot].fence, nullptr);
+            m_dispatchSlots[slot].fence = VkFence();
+        }
+        m_dispatchSlots[slot].commandBuffer = VkCommandBuffer();
+        m_dispatchSlots[slot].descriptorSet = VkDescriptorSet();
+    }
+
+    for (auto& cachedView : m_lumaViewCache) {
+        m_vkDevCtx->DestroyImageView(*m_vkDevCtx, cachedView.second, nullptr);
+    }
+    m_lumaViewCache.clear();
+
+    if (m_pMappedRecords != nullptr) {
+        m_vkDevCtx->UnmapMemory(*m_vkDevCtx, m_recordMemory);
+        m_pMappedRecords = nullptr;
+    }
+    if (m_recordBuffer != VkBuffer()) {
+        m_vkDevCtx->DestroyBuffer(*m_vkDevCtx, m_recordBuffer, nullptr);
+        m_recordBuffer = VkBuffer();
+    }
+    if (m_recordMemory != VkDeviceMemory()) {
+        m_vkDevCtx->FreeMemory(*m_vkDevCtx, m_recordMemory, nullptr);
+        m_recordMemory = VkDeviceMemory();
+    }
+    if (m_descriptorPool != VkDescriptorPool()) {
+        m_vkDevCtx->DestroyDescriptorPool(*m_vkDevCtx, m_descriptorPool, nullptr);
+        m_descriptorPool = VkDescriptorPool();
+    }
+    if (m_cmdPool != VkCommandPool()) {
+        m_vkDevCtx->DestroyCommandPool(*m_vkDevCtx, m_cmdPool, nullptr);
+        m_cmdPool = VkCommandPool();
+    }
+    if (m_pipeline != VkPipeline()) {
+        m_vkDevCtx->DestroyPipeline(*m_vkDevCtx, m_pipeline, nullptr);
+        m_pipeline = VkPipeline();
+    }
+    if (m_shaderModule != VkShaderModule()) {
+        m_vkDevCtx->DestroyShaderModule(*m_vkDevCtx, m_shaderModule, nullptr);
+        m_shaderModule = VkShaderModule();
+    }
+    if (m_pipelineLayout != VkPipelineLayout()) {
+        m_vkDevCtx->DestroyPipelineLayout(*m_vkDevCtx, m_pipelineLayout, nullptr);
+        m_pipelineLayout = VkPipelineLayout();
+    }
+    if (m_descriptorSetLayout != VkDescriptorSetLayout()) {
+        m_vkDevCtx->DestroyDescriptorSetLayout(*m_vkDevCtx, m_descriptorSetLayout, nullptr);
+        m_descriptorSetLayout = VkDescriptorSetLayout();
+    }
+    if (m_sampler != VkSampler()) {
+        m_vkDevCtx->DestroySampler(*m_vkDevCtx, m_sampler, nullptr);
+        m_sampler = VkSampler();
+    }
+
+    m_imageFormat = VK_FORMAT_UNDEFINED;
+}
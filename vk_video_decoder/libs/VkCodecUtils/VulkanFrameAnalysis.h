@@ -0,0 +1,147 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef LIBS_VKCODECUTILS_VULKANFRAMEANALYSIS_H_
+#define LIBS_VKCODECUTILS_VULKANFRAMEANALYSIS_H_
+
+#include <atomic>
+#include <ostream>
+#include <unordered_map>
+#include "VkVideoCore/VkVideoRefCountBase.h"
+#include "VkCodecUtils/VulkanDeviceContext.h"
+
+// GPU-side QC analysis taps on the decoded frames. For every decoded picture
+// a small compute dispatch is submitted on the graphics queue right after the
+// decode submission (the same scheme as VulkanFrameChecksum); it accumulates
+// a luma histogram and the luma sum of the picture into per-frame records in
+// a device buffer. The records are read back on the host only once, at the
+// end of the stream, where the derived per-frame statistics - average luma
+// and the black-frame and freeze-frame flags - are computed and reported, so
+// full-rate QC costs no per-frame readback.
+//
+// The records are indexed by the decode order of the pictures; the freeze
+// detection compares decode-order neighbors, which matches the presentation
+// order for the low-delay streams QC typically runs on.
+//
+// The dispatch waits for the decode on the session timeline semaphore, so the
+// timeline frame synchronization mode of the frame buffer must be enabled
+// (see VulkanVideoFrameBuffer::EnableTimelineFrameSync()).
+class VulkanFrameAnalysis : public VkVideoRefCountBase {
+public:
+
+    static VkResult Create(const VulkanDeviceContext* vkDevCtx,
+                           VkSharedBaseObj<VulkanFrameAnalysis>& frameAnalysis);
+
+    virtual int32_t AddRef();
+    virtual int32_t Release();
+
+    // Builds the compute pipeline and allocates the record buffer for the
+    // decoded image format. Must be called before the first frame is queued
+    // and may be called again on a format change.
+    VkResult Initialize(VkFormat imageFormat);
+
+    // Records and submits the compute dispatch accumulating the luma
+    // histogram and luma sum of decodedImage into its per-frame record. The
+    // dispatch waits for timelineValue on timelineSemaphore (the
+    // decode-complete point of the picture), transitions the image from
+    // imageLayout for sampling and back, and never blocks the decode loop for
+    // longer than the recycling of its small command-buffer ring.
+    VkResult QueueFrameAnalysis(VkImage decodedImage,
+                                const VkExtent2D& codedExtent,
+                                VkImageLayout imageLayout,
+                                VkSemaphore timelineSemaphore,
+                                uint64_t timelineValue,
+                                uint32_t frameIndex);
+
+    // Waits for the outstanding dispatches and prints the per-frame average
+    // luma with the black/freeze flags (up to maxTrackedFrames frames),
+    // followed by the whole-stream histogram and the flagged-frame counts.
+    VkResult ReportStatistics(std::ostream& outStream);
+
+    // Per-frame record slots kept in the device buffer; later frames only
+    // fold into the whole-stream record.
+    static const uint32_t maxTrackedFrames = 4096;
+
+    // Histogram bins per record; the luma range [0.0, 1.0] maps linearly
+    // onto the bins regardless of the bit depth of the stream.
+    static const uint32_t numHistogramBins = 64;
+
+private:
+    VulkanFrameAnalysis(const VulkanDeviceContext* vkDevCtx)
+        : m_refCount(0)
+        , m_vkDevCtx(vkDevCtx)
+        , m_imageFormat(VK_FORMAT_UNDEFINED)
+        , m_lumaPlaneFormat(VK_FORMAT_UNDEFINED)
+        , m_descriptorSetLayout()
+        , m_pipelineLayout()
+        , m_pipeline()
+        , m_shaderModule()
+        , m_sampler()
+        , m_cmdPool()
+        , m_descriptorPool()
+        , m_recordBuffer()
+        , m_recordMemory()
+        , m_pMappedRecords(nullptr)
+        , m_queuedFrameCount(0) { }
+
+    virtual ~VulkanFrameAnalysis();
+    void Deinitialize();
+
+    VkResult CreateRecordBuffer();
+    VkResult GetLumaImageView(VkImage decodedImage, VkImageView* pLumaView);
+
+    // Record layout, in uint32 words: the histogram bins, then the luma sum
+    // (in 8-bit code values, pre-shifted right by lumaSumShift in the shader
+    // so it cannot overflow 32 bits even on 8K frames), then the sampled
+    // texel count.
+    static const uint32_t recordStrideWords = numHistogramBins + 2;
+    static const uint32_t lumaSumShift = 4;
+
+    // Average luma (in 8-bit code values) below which a frame is flagged
+    // black; below the 16 studio-swing black point.
+    static constexpr double blackFrameLumaThreshold = 16.0;
+
+    // One in-flight analysis dispatch; the ring is recycled on the fence.
+    static const uint32_t numDispatchSlots = 8;
+    struct DispatchSlot {
+        VkCommandBuffer commandBuffer;
+        VkDescriptorSet descriptorSet;
+        VkFence         fence;
+        bool            submitted;
+    };
+
+    std::atomic<int32_t>        m_refCount;
+    const VulkanDeviceContext*  m_vkDevCtx;
+    VkFormat                    m_imageFormat;
+    VkFormat                    m_lumaPlaneFormat;
+    VkDescriptorSetLayout       m_descriptorSetLayout;
+    VkPipelineLayout            m_pipelineLayout;
+    VkPipeline                  m_pipeline;
+    VkShaderModule              m_shaderModule;
+    VkSampler                   m_sampler;
+    VkCommandPool               m_cmdPool;
+    VkDescriptorPool            m_descriptorPool;
+    DispatchSlot                m_dispatchSlots[numDispatchSlots];
+    VkBuffer                    m_recordBuffer;
+    VkDeviceMemory              m_recordMemory;
+    uint32_t*                   m_pMappedRecords;
+    uint32_t                    m_queuedFrameCount;
+    // The decoded images are recycled from a fixed pool, so the luma plane
+    // view is created once per image and reused.
+    std::unordered_map<VkImage, VkImageView> m_lumaViewCache;
+};
+
+#endif /* LIBS_VKCODECUTILS_VULKANFRAMEANALYSIS_H_ */
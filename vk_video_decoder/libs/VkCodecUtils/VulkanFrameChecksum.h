@@ -0,0 +1,129 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef LIBS_VKCODECUTILS_VULKANFRAMECHECKSUM_H_
+#define LIBS_VKCODECUTILS_VULKANFRAMECHECKSUM_H_
+
+#include <atomic>
+#include <ostream>
+#include <unordered_map>
+#include "VkVideoCore/VkVideoRefCountBase.h"
+#include "VkCodecUtils/VulkanDeviceContext.h"
+
+// GPU-side validation checksums of the decoded frames. For every decoded
+// picture a small compute dispatch is submitted on the graphics queue right
+// after the decode submission; it hashes the luma and the chroma plane of the
+// decoded image and accumulates the digests in a device buffer, which is read
+// back on the host only once, at the end of the stream. Compared to the
+// CPU-hashing validation path (linear output plus per-frame host readback),
+// the decode throughput stays close to the non-validating runs.
+//
+// The dispatch waits for the decode on the session timeline semaphore, so the
+// timeline frame synchronization mode of the frame buffer must be enabled
+// (see VulkanVideoFrameBuffer::EnableTimelineFrameSync()) - a binary
+// frame-complete semaphore cannot be waited on by both the checksum dispatch
+// and the frame consumer.
+class VulkanFrameChecksum : public VkVideoRefCountBase {
+public:
+
+    static VkResult Create(const VulkanDeviceContext* vkDevCtx,
+                           VkSharedBaseObj<VulkanFrameChecksum>& frameChecksum);
+
+    virtual int32_t AddRef();
+    virtual int32_t Release();
+
+    // Builds the compute pipeline and allocates the digest buffer for the
+    // decoded image format. Must be called before the first frame is queued
+    // and may be called again on a format change.
+    VkResult Initialize(VkFormat imageFormat);
+
+    // Records and submits the compute dispatch hashing both planes of
+    // decodedImage. The dispatch waits for timelineValue on timelineSemaphore
+    // (the decode-complete point of the picture), transitions the image from
+    // imageLayout for sampling and back, and never blocks the decode loop for
+    // longer than the recycling of its small command-buffer ring.
+    VkResult QueueFrameChecksum(VkImage decodedImage,
+                                const VkExtent2D& codedExtent,
+                                VkImageLayout imageLayout,
+                                VkSemaphore timelineSemaphore,
+                                uint64_t timelineValue,
+                                uint32_t frameIndex);
+
+    // Waits for the outstanding dispatches and prints the per-frame digests
+    // (up to maxTrackedFrames frames) followed by the whole-stream digest.
+    VkResult ReportChecksums(std::ostream& outStream);
+
+    // Per-frame digest slots kept in the device buffer; later frames only
+    // fold into the whole-stream digest.
+    static const uint32_t maxTrackedFrames = 4096;
+
+private:
+    VulkanFrameChecksum(const VulkanDeviceContext* vkDevCtx)
+        : m_refCount(0)
+        , m_vkDevCtx(vkDevCtx)
+        , m_imageFormat(VK_FORMAT_UNDEFINED)
+        , m_lumaPlaneFormat(VK_FORMAT_UNDEFINED)
+        , m_chromaPlaneFormat(VK_FORMAT_UNDEFINED)
+        , m_descriptorSetLayout()
+        , m_pipelineLayout()
+        , m_pipeline()
+        , m_shaderModule()
+        , m_sampler()
+        , m_cmdPool()
+        , m_descriptorPool()
+        , m_digestBuffer()
+        , m_digestMemory()
+        , m_pMappedDigests(nullptr)
+        , m_queuedFrameCount(0) { }
+
+    virtual ~VulkanFrameChecksum();
+    void Deinitialize();
+
+    VkResult CreateDigestBuffer();
+    VkResult GetPlaneImageViews(VkImage decodedImage, VkImageView planeViews[2]);
+
+    // One in-flight checksum dispatch; the ring is recycled on the fence.
+    static const uint32_t numDispatchSlots = 8;
+    struct DispatchSlot {
+        VkCommandBuffer commandBuffer;
+        VkDescriptorSet descriptorSet;
+        VkFence         fence;
+        bool            submitted;
+    };
+
+    std::atomic<int32_t>        m_refCount;
+    const VulkanDeviceContext*  m_vkDevCtx;
+    VkFormat                    m_imageFormat;
+    VkFormat                    m_lumaPlaneFormat;
+    VkFormat                    m_chromaPlaneFormat;
+    VkDescriptorSetLayout       m_descriptorSetLayout;
+    VkPipelineLayout            m_pipelineLayout;
+    VkPipeline                  m_pipeline;
+    VkShaderModule              m_shaderModule;
+    VkSampler                   m_sampler;
+    VkCommandPool               m_cmdPool;
+    VkDescriptorPool            m_descriptorPool;
+    DispatchSlot                m_dispatchSlots[numDispatchSlots];
+    VkBuffer                    m_digestBuffer;
+    VkDeviceMemory              m_digestMemory;
+    uint32_t*                   m_pMappedDigests;
+    uint32_t                    m_queuedFrameCount;
+    // The decoded images are recycled from a fixed pool, so the per-plane
+    // views are created once per image and reused.
+    std::unordered_map<VkImage, std::pair<VkImageView, VkImageView>> m_planeViewCache;
+};
+
+#endif /* LIBS_VKCODECUTILS_VULKANFRAMECHECKSUM_H_ */
@@ -0,0 +1,578 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <string.h>
+#include "VkCodecUtils/Helpers.h"
+#include "VkCodecUtils/VulkanFrameScaler.h"
+#include "VkCodecUtils/VulkanShaderCompiler.h"
+
+// One invocation per output word (4 packed bytes). Rows below dstHeight are
+// luma rows; the rows after them are the interleaved CbCr rows of the NV12
+// output. Each output sample is one bilinear tap at the center of its
+// footprint in the crop rectangle - adequate for thumbnail ratios, where
+// the taps land dense enough that no structured aliasing survives the
+// target size.
+static const char s_frameScalerShader[] =
+    "#version 450\n"
+    "layout(local_size_x = 16, local_size_y = 16, local_size_z = 1) in;\n"
+    "layout(set = 0, binding = 0) uniform sampler2D lumaPlane;\n"
+    "layout(set = 0, binding = 1) uniform sampler2D chromaPlane;\n"
+    "layout(set = 0, binding = 2) buffer ScaledOutput { uint words[]; };\n"
+    "layout(push_constant) uniform PushConstants {\n"
+    "    uint cropX;\n"
+    "    uint cropY;\n"
+    "    uint cropWidth;\n"
+    "    uint cropHeight;\n"
+    "    uint texWidth;     // coded extent the normalized coordinates span\n"
+    "    uint texHeight;\n"
+    "    uint dstWidth;\n"
+    "    uint dstHeight;\n"
+    "    uint rowPitchWords;\n"
+    "    uint chromaBaseWord;\n"
+    "} pc;\n"
+    "\n"
+    "vec2 SrcUv(float dstX, float dstY)\n"
+    "{\n"
+    "    float u = (float(pc.cropX) + ((dstX + 0.5) * float(pc.cropWidth) / float(pc.dstWidth))) / float(pc.texWidth);\n"
+    "    float v = (float(pc.cropY) + ((dstY + 0.5) * float(pc.cropHeight) / float(pc.dstHeight))) / float(pc.texHeight);\n"
+    "    return vec2(u, v);\n"
+    "}\n"
+    "\n"
+    "void main()\n"
+    "{\n"
+    "    uint wordX = gl_GlobalInvocationID.x;\n"
+    "    uint row = gl_GlobalInvocationID.y;\n"
+    "    uint chromaRows = pc.dstHeight / 2u;\n"
+    "    if ((wordX >= pc.rowPitchWords) || (row >= (pc.dstHeight + chromaRows))) {\n"
+    "        return;\n"
+    "    }\n"
+    "    uint word = 0u;\n"
+    "    if (row < pc.dstHeight) {\n"
+    "        for (uint b = 0u; b < 4u; b++) {\n"
+    "            uint x = min((wordX * 4u) + b, pc.dstWidth - 1u);\n"
+    "            vec2 uv = SrcUv(float(x), float(row));\n"
+    "            uint luma = uint(round(clamp(textureLod(lumaPlane, uv, 0.0).r, 0.0, 1.0) * 255.0));\n"
+    "            word |= (luma << (8u * b));\n"
+    "        }\n"
+    "        words[(row * pc.rowPitchWords) + wordX] = word;\n"
+    "    } else {\n"
+    "        uint chromaRow = row - pc.dstHeight;\n"
+    "        for (uint pair = 0u; pair < 2u; pair++) {\n"
+    "            uint cx = min((wordX * 2u) + pair, (pc.dstWidth / 2u) - 1u);\n"
+    "            // The chroma sample center in output luma coordinates.\n"
+    "            vec2 uv = SrcUv(float(2u * cx) + 0.5, float(2u * chromaRow) + 0.5);\n"
+    "            vec2 cbcr = clamp(textureLod(chromaPlane, uv, 0.0).rg, 0.0, 1.0);\n"
+    "            uint cb = uint(round(cbcr.r * 255.0));\n"
+    "            uint cr = uint(round(cbcr.g * 255.0));\n"
+    "            word |= (cb << (16u * pair)) | (cr << ((16u * pair) + 8u));\n"
+    "        }\n"
+    "        words[pc.chromaBaseWord + (chromaRow * pc.rowPitchWords) + wordX] = word;\n"
+    "    }\n"
+    "}\n";
+
+struct FrameScalerPushConstants {
+    uint32_t cropX;
+    uint32_t cropY;
+    uint32_t cropWidth;
+    uint32_t cropHeight;
+    uint32_t texWidth;
+    uint32_t texHeight;
+    uint32_t dstWidth;
+    uint32_t dstHeight;
+    uint32_t rowPitchWords;
+    uint32_t chromaBaseWord;
+};
+
+VkResult VulkanFrameScaler::Create(const VulkanDeviceContext* vkDevCtx,
+                                   VkSharedBaseObj<VulkanFrameScaler>& frameScaler)
+{
+    VkSharedBaseObj<VulkanFrameScaler> newFrameScaler(new VulkanFrameScaler(vkDevCtx));
+    if (!newFrameScaler) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    frameScaler = newFrameScaler;
+    return VK_SUCCESS;
+}
+
+int32_t VulkanFrameScaler::AddRef()
+{
+    return ++m_refCount;
+}
+
+int32_t VulkanFrameScaler::Release()
+{
+    uint32_t ret = --m_refCount;
+    // Destroy the device if ref-count reaches zero
+    if (ret == 0) {
+        delete this;
+    }
+    return ret;
+}
+
+VulkanFrameScaler::~VulkanFrameScaler()
+{
+    Deinitialize();
+}
+
+// The single-plane formats the per-plane sampling views are created with.
+static VkResult GetScalerPlaneFormats(VkFormat imageFormat, VkFormat* pLumaFormat, VkFormat* pChromaFormat)
+{
+    switch (imageFormat) {
+    case VK_FORMAT_G8_B8R8_2PLANE_420_UNORM:
+    case VK_FORMAT_G8_B8R8_2PLANE_422_UNORM:
+        *pLumaFormat   = VK_FORMAT_R8_UNORM;
+        *pChromaFormat = VK_FORMAT_R8G8_UNORM;
+        return VK_SUCCESS;
+    case VK_FORMAT_G10X6_B10X6R10X6_2PLANE_420_UNORM_3PACK16:
+    case VK_FORMAT_G10X6_B10X6R10X6_2PLANE_422_UNORM_3PACK16:
+        *pLumaFormat   = VK_FORMAT_R10X6_UNORM_PACK16;
+        *pChromaFormat = VK_FORMAT_R10X6G10X6_UNORM_2PACK16;
+        return VK_SUCCESS;
+    case VK_FORMAT_G12X4_B12X4R12X4_2PLANE_420_UNORM_3PACK16:
+    case VK_FORMAT_G12X4_B12X4R12X4_2PLANE_422_UNORM_3PACK16:
+        *pLumaFormat   = VK_FORMAT_R12X4_UNORM_PACK16;
+        *pChromaFormat = VK_FORMAT_R12X4G12X4_UNORM_2PACK16;
+        return VK_SUCCESS;
+    case VK_FORMAT_G16_B16R16_2PLANE_420_UNORM:
+    case VK_FORMAT_G16_B16R16_2PLANE_422_UNORM:
+        *pLumaFormat   = VK_FORMAT_R16_UNORM;
+        *pChromaFormat = VK_FORMAT_R16G16_UNORM;
+        return VK_SUCCESS;
+    default:
+        assert(!"Unsupported decode image format for the scaled output");
+        return VK_ERROR_FORMAT_NOT_SUPPORTED;
+    }
+}
+
+VkResult VulkanFrameScaler::Initialize(VkFormat imageFormat, uint32_t outputWidth, uint32_t outputHeight)
+{
+    // NV12 requires even dimensions.
+    outputWidth  = (outputWidth + 1)  & ~1u;
+    outputHeight = (outputHeight + 1) & ~1u;
+    if ((outputWidth == 0) || (outputHeight == 0)) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    if ((m_imageFormat == imageFormat) &&
+            (m_outputWidth == outputWidth) && (m_outputHeight == outputHeight)) {
+        // Already initialized for this format and size.
+        return VK_SUCCESS;
+    }
+
+    Deinitialize();
+
+    VkResult result = GetScalerPlaneFormats(imageFormat, &m_lumaPlaneFormat, &m_chromaPlaneFormat);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    // Bilinear taps do the downsampling.
+    const VkSamplerCreateInfo samplerCreateInfo = { VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO, nullptr, 0,
+                                                    VK_FILTER_LINEAR, VK_FILTER_LINEAR,
+                                                    VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                                                    VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                    VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                    VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE };
+    result = m_vkDevCtx->CreateSampler(*m_vkDevCtx, &samplerCreateInfo, nullptr, &m_sampler);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    const VkDescriptorSetLayoutBinding bindings[3] = {
+        { 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, &m_sampler },
+        { 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, &m_sampler },
+        { 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr },
+    };
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    descriptorSetLayoutCreateInfo.bindingCount = 3;
+    descriptorSetLayoutCreateInfo.pBindings = bindings;
+    result = m_vkDevCtx->CreateDescriptorSetLayout(*m_vkDevCtx, &descriptorSetLayoutCreateInfo,
+                                                   nullptr, &m_descriptorSetLayout);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    const VkPushConstantRange pushConstantRange = { VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                                                    sizeof(FrameScalerPushConstants) };
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+    pipelineLayoutCreateInfo.setLayoutCount = 1;
+    pipelineLayoutCreateInfo.pSetLayouts = &m_descriptorSetLayout;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    result = m_vkDevCtx->CreatePipelineLayout(*m_vkDevCtx, &pipelineLayoutCreateInfo, nullptr, &m_pipelineLayout);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    vulkanVideoUtils::VulkanShaderCompiler shaderCompiler;
+    result = shaderCompiler.BuildGlslShader(s_frameScalerShader, strlen(s_frameScalerShader),
+                                            VK_SHADER_STAGE_COMPUTE_BIT,
+                                            m_vkDevCtx, &m_shaderModule);
+    if (result != VK_SUCCESS) {
+        assert(!"Could not compile the frame scaler shader!");
+        return result;
+    }
+
+    VkComputePipelineCreateInfo pipelineCreateInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+    pipelineCreateInfo.stage = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
+                                 VK_SHADER_STAGE_COMPUTE_BIT, m_shaderModule, "main", nullptr };
+    pipelineCreateInfo.layout = m_pipelineLayout;
+    result = m_vkDevCtx->CreateComputePipelines(*m_vkDevCtx, VkPipelineCache(), 1,
+                                                &pipelineCreateInfo, nullptr, &m_pipeline);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkCommandPoolCreateInfo cmdPoolCreateInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    cmdPoolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    cmdPoolCreateInfo.queueFamilyIndex = m_vkDevCtx->GetGfxQueueFamilyIdx();
+    result = m_vkDevCtx->CreateCommandPool(*m_vkDevCtx, &cmdPoolCreateInfo, nullptr, &m_cmdPool);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkCommandBufferAllocateInfo cmdBufferAllocInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+    cmdBufferAllocInfo.commandPool = m_cmdPool;
+    cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmdBufferAllocInfo.commandBufferCount = 1;
+    result = m_vkDevCtx->AllocateCommandBuffers(*m_vkDevCtx, &cmdBufferAllocInfo, &m_cmdBuffer);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    const VkDescriptorPoolSize poolSizes[2] = {
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         1 },
+    };
+    VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    descriptorPoolCreateInfo.maxSets = 1;
+    descriptorPoolCreateInfo.poolSizeCount = 2;
+    descriptorPoolCreateInfo.pPoolSizes = poolSizes;
+    result = m_vkDevCtx->CreateDescriptorPool(*m_vkDevCtx, &descriptorPoolCreateInfo, nullptr, &m_descriptorPool);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkDescriptorSetAllocateInfo descriptorSetAllocInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    descriptorSetAllocInfo.descriptorPool = m_descriptorPool;
+    descriptorSetAllocInfo.descriptorSetCount = 1;
+    descriptorSetAllocInfo.pSetLayouts = &m_descriptorSetLayout;
+    result = m_vkDevCtx->AllocateDescriptorSets(*m_vkDevCtx, &descriptorSetAllocInfo, &m_descriptorSet);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    const VkFenceCreateInfo fenceCreateInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+    result = m_vkDevCtx->CreateFence(*m_vkDevCtx, &fenceCreateInfo, nullptr, &m_fence);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    m_outputWidth = outputWidth;
+    m_outputHeight = outputHeight;
+    m_rowPitchWords = (outputWidth + 3) / 4;
+
+    result = CreateOutputBuffer();
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    m_imageFormat = imageFormat;
+    return VK_SUCCESS;
+}
+
+VkResult VulkanFrameScaler::CreateOutputBuffer()
+{
+    const uint32_t numRows = m_outputHeight + (m_outputHeight / 2);
+    const VkDeviceSize bufferSize = (VkDeviceSize)numRows * m_rowPitchWords * sizeof(uint32_t);
+
+    VkBufferCreateInfo bufferCreateInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    bufferCreateInfo.size = bufferSize;
+    bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkResult result = m_vkDevCtx->CreateBuffer(*m_vkDevCtx, &bufferCreateInfo, nullptr, &m_outputBuffer);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkMemoryRequirements memoryRequirements;
+    m_vkDevCtx->GetBufferMemoryRequirements(*m_vkDevCtx, m_outputBuffer, &memoryRequirements);
+
+    // Host-visible, so the thumbnail is read back with a plain copy.
+    uint32_t memoryTypeIndex = 0;
+    result = vk::MapMemoryTypeToIndex(m_vkDevCtx, m_vkDevCtx->getPhysicalDevice(),
+                                      memoryRequirements.memoryTypeBits,
+                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                      &memoryTypeIndex);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkMemoryAllocateInfo memoryAllocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+    memoryAllocInfo.allocationSize = memoryRequirements.size;
+    memoryAllocInfo.memoryTypeIndex = memoryTypeIndex;
+    result = m_vkDevCtx->AllocateMemory(*m_vkDevCtx, &memoryAllocInfo, nullptr, &m_outputMemory);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    result = m_vkDevCtx->BindBufferMemory(*m_vkDevCtx, m_outputBuffer, m_outputMemory, 0);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    return m_vkDevCtx->MapMemory(*m_vkDevCtx, m_outputMemory, 0, bufferSize, 0,
+                                 (void**)&m_pMappedOutput);
+}
+
+VkResult VulkanFrameScaler::GetPlaneImageViews(VkImage decodedImage, VkImageView planeViews[2])
+{
+    auto cachedViews = m_planeViewCache.find(decodedImage);
+    if (cachedViews != m_planeViewCache.end()) {
+        planeViews[0] = cachedViews->second.first;
+        planeViews[1] = cachedViews->second.second;
+        return VK_SUCCESS;
+    }
+
+    VkImageViewCreateInfo viewCreateInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+    viewCreateInfo.image = decodedImage;
+    viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewCreateInfo.format = m_lumaPlaneFormat;
+    viewCreateInfo.subresourceRange = { VK_IMAGE_ASPECT_PLANE_0_BIT, 0, 1, 0, 1 };
+    VkResult result = m_vkDevCtx->CreateImageView(*m_vkDevCtx, &viewCreateInfo, nullptr, &planeViews[0]);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    viewCreateInfo.format = m_chromaPlaneFormat;
+    viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_PLANE_1_BIT;
+    result = m_vkDevCtx->CreateImageView(*m_vkDevCtx, &viewCreateInfo, nullptr, &planeViews[1]);
+    if (result != VK_SUCCESS) {
+        m_vkDevCtx->DestroyImageView(*m_vkDevCtx, planeViews[0], nullptr);
+        return result;
+    }
+
+    m_planeViewCache[decodedImage] = std::make_pair(planeViews[0], planeViews[1]);
+    return VK_SUCCESS;
+}
+
+VkResult VulkanFrameScaler::ScaleFrame(VkImage decodedImage,
+                                       const VkExtent2D& texExtent,
+                                       const VkRect2D& cropRect,
+                                       VkImageLayout imageLayout,
+                                       VkFence frameCompleteFence)
+{
+    if (m_pipeline == VkPipeline()) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    // The dispatch samples the image without a semaphore wait, so the
+    // decode must have completed on the device first.
+    if (frameCompleteFence != VkFence()) {
+        VkResult fenceResult = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &frameCompleteFence, true,
+                                                         1000 * 1000 * 1000 /* 1000 ms */);
+        assert(fenceResult == VK_SUCCESS);
+        if (fenceResult != VK_SUCCESS) {
+            return fenceResult;
+        }
+    }
+
+    VkImageView planeViews[2] = {};
+    VkResult result = GetPlaneImageViews(decodedImage, planeViews);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    const VkDescriptorImageInfo imageInfos[2] = {
+        { m_sampler, planeViews[0], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+        { m_sampler, planeViews[1], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+    };
+    const VkDescriptorBufferInfo bufferInfo = { m_outputBuffer, 0, VK_WHOLE_SIZE };
+    const VkWriteDescriptorSet descriptorWrites[3] = {
+        { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, m_descriptorSet, 0, 0, 1,
+          VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &imageInfos[0], nullptr, nullptr },
+        { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, m_descriptorSet, 1, 0, 1,
+          VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &imageInfos[1], nullptr, nullptr },
+        { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, m_descriptorSet, 2, 0, 1,
+          VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, nullptr, &bufferInfo, nullptr },
+    };
+    m_vkDevCtx->UpdateDescriptorSets(*m_vkDevCtx, 3, descriptorWrites, 0, nullptr);
+
+    const VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO, nullptr,
+                                                 VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT };
+    m_vkDevCtx->BeginCommandBuffer(m_cmdBuffer, &beginInfo);
+
+    VkImageMemoryBarrier imageBarrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    imageBarrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    imageBarrier.oldLayout = imageLayout;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = decodedImage;
+    imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    m_vkDevCtx->CmdPipelineBarrier(m_cmdBuffer,
+                                   VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                   0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+    m_vkDevCtx->CmdBindPipeline(m_cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    m_vkDevCtx->CmdBindDescriptorSets(m_cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                      m_pipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
+
+    FrameScalerPushConstants pushConstants;
+    pushConstants.cropX = (uint32_t)cropRect.offset.x;
+    pushConstants.cropY = (uint32_t)cropRect.offset.y;
+    pushConstants.cropWidth = cropRect.extent.width;
+    pushConstants.cropHeight = cropRect.extent.height;
+    pushConstants.texWidth = texExtent.width;
+    pushConstants.texHeight = texExtent.height;
+    pushConstants.dstWidth = m_outputWidth;
+    pushConstants.dstHeight = m_outputHeight;
+    pushConstants.rowPitchWords = m_rowPitchWords;
+    pushConstants.chromaBaseWord = m_outputHeight * m_rowPitchWords;
+    m_vkDevCtx->CmdPushConstants(m_cmdBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                                 0, sizeof(pushConstants), &pushConstants);
+
+    const uint32_t numRows = m_outputHeight + (m_outputHeight / 2);
+    m_vkDevCtx->CmdDispatch(m_cmdBuffer, (m_rowPitchWords + 15) / 16, (numRows + 15) / 16, 1);
+
+    // Return the image to the layout the decoder and the consumers expect.
+    imageBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    imageBarrier.newLayout = imageLayout;
+    m_vkDevCtx->CmdPipelineBarrier(m_cmdBuffer,
+                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                   VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                   0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+    // Make the buffer writes visible to the host copy.
+    VkMemoryBarrier hostReadBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    hostReadBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    hostReadBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    m_vkDevCtx->CmdPipelineBarrier(m_cmdBuffer,
+                                   VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                   VK_PIPELINE_STAGE_HOST_BIT,
+                                   0, 1, &hostReadBarrier, 0, nullptr, 0, nullptr);
+
+    m_vkDevCtx->EndCommandBuffer(m_cmdBuffer);
+
+    VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_cmdBuffer;
+    result = m_vkDevCtx->QueueSubmit(m_vkDevCtx->GetGfxQueue(), 1, &submitInfo, m_fence);
+    if (result != VK_SUCCESS) {
+        assert(!"Could not submit the frame scaler dispatch!");
+        return result;
+    }
+
+    result = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &m_fence, true,
+                                       1000 * 1000 * 1000 /* 1000 ms */);
+    m_vkDevCtx->ResetFences(*m_vkDevCtx, 1, &m_fence);
+    assert(result == VK_SUCCESS);
+    return result;
+}
+
+size_t VulkanFrameScaler::CopyScaledFrameToNv12(uint8_t* pDst, size_t maxDstSize) const
+{
+    if (m_pMappedOutput == nullptr) {
+        return 0;
+    }
+
+    const uint32_t numRows = m_outputHeight + (m_outputHeight / 2);
+    const size_t outputSize = (size_t)numRows * m_outputWidth;
+    if (outputSize > maxDstSize) {
+        assert(!"The scaled frame does not fit the output allocation!");
+        return 0;
+    }
+
+    const size_t rowPitchBytes = (size_t)m_rowPitchWords * sizeof(uint32_t);
+    const uint8_t* pSrc = m_pMappedOutput;
+    for (uint32_t row = 0; row < numRows; row++) {
+        memcpy(pDst, pSrc, m_outputWidth);
+        pDst += m_outputWidth;
+        pSrc += rowPitchBytes;
+    }
+    return outputSize;
+}
+
+void VulkanFrameScaler::Deinitialize()
+{
+    if (m_vkDevCtx == nullptr) {
+        return;
+    }
+
+    for (auto& cachedViews : m_planeViewCache) {
+        m_vkDevCtx->DestroyImageView(*m_vkDevCtx, cachedViews.second.first, nullptr);
+        m_vkDevCtx->DestroyImageView(*m_vkDevCtx, cachedViews.second.second, nullptr);
+    }
+    m_planeViewCache.clear();
+
+    if (m_pMappedOutput != nullptr) {
+        m_vkDevCtx->UnmapMemory(*m_vkDevCtx, m_outputMemory);
+        m_pMappedOutput = nullptr;
+    }
+    if (m_outputBuffer != VkBuffer()) {
+        m_vkDevCtx->DestroyBuffer(*m_vkDevCtx, m_outputBuffer, nullptr);
+        m_outputBuffer = VkBuffer();
+    }
+    if (m_outputMemory != VkDeviceMemory()) {
+        m_vkDevCtx->FreeMemory(*m_vkDevCtx, m_outputMemory, nullptr);
+        m_outputMemory = VkDeviceMemory();
+    }
+    if (m_fence != VkFence()) {
+        m_vkDevCtx->DestroyFence(*m_vkDevCtx, m_fence, nullptr);
+        m_fence = VkFence();
+    }
+    if (m_descriptorPool != VkDescriptorPool()) {
+        m_vkDevCtx->DestroyDescriptorPool(*m_vkDevCtx, m_descriptorPool, nullptr);
+        m_descriptorPool = VkDescriptorPool();
+        m_descriptorSet = VkDescriptorSet();
+    }
+    if (m_cmdPool != VkCommandPool()) {
+        m_vkDevCtx->DestroyCommandPool(*m_vkDevCtx, m_cmdPool, nullptr);
+        m_cmdPool = VkCommandPool();
+        m_cmdBuffer = VkCommandBuffer();
+    }
+    if (m_pipeline != VkPipeline()) {
+        m_vkDevCtx->DestroyPipeline(*m_vkDevCtx, m_pipeline, nullptr);
+        m_pipeline = VkPipeline();
+    }
+    if (m_shaderModule != VkShaderModule()) {
+        m_vkDevCtx->DestroyShaderModule(*m_vkDevCtx, m_shaderModule, nullptr);
+        m_shaderModule = VkShaderModule();
+    }
+    if (m_pipelineLayout != VkPipelineLayout()) {
+        m_vkDevCtx->DestroyPipelineLayout(*m_vkDevCtx, m_pipelineLayout, nullptr);
+        m_pipelineLayout = VkPipelineLayout();
+    }
+    if (m_descriptorSetLayout != VkDescriptorSetLayout()) {
+        m_vkDevCtx->DestroyDescriptorSetLayout(*m_vkDevCtx, m_descriptorSetLayout, nullptr);
+        m_descriptorSetLayout = VkDescriptorSetLayout();
+    }
+    if (m_sampler != VkSampler()) {
+        m_vkDevCtx->DestroySampler(*m_vkDevCtx, m_sampler, nullptr);
+        m_sampler = VkSampler();
+    }
+
+    m_imageFormat = VK_FORMAT_UNDEFINED;
+    m_outputWidth = 0;
+    m_outputHeight = 0;
+    m_rowPitchWords = 0;
+}
@@ -0,0 +1,134 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef LIBS_VKCODECUTILS_VULKANFRAMESCALER_H_
+#define LIBS_VKCODECUTILS_VULKANFRAMESCALER_H_
+
+#include <atomic>
+#include <unordered_map>
+#include "VkVideoCore/VkVideoRefCountBase.h"
+#include "VkCodecUtils/VulkanDeviceContext.h"
+
+// GPU scale/crop stage for the file output path (see --scaledOutput).
+// Instead of reading a full-resolution frame back through the linear
+// output image, a compute dispatch samples the decoded image with bilinear
+// taps and writes an 8-bit NV12 thumbnail into a small host-visible
+// buffer, so the copy-out and file I/O volume scales with the thumbnail
+// size rather than the coded size. The dispatch runs on the
+// compute-capable graphics queue, like the frame checksum stage, and is
+// waited on synchronously - at thumbnail sizes it is far cheaper than the
+// full-resolution row copies it replaces.
+//
+// The output is always 8 bit; 10/12/16-bit decode formats are sampled as
+// normalized values and rounded down to 8 bit, which is what the thumbnail
+// consumers expect.
+class VulkanFrameScaler : public VkVideoRefCountBase {
+public:
+
+    static VkResult Create(const VulkanDeviceContext* vkDevCtx,
+                           VkSharedBaseObj<VulkanFrameScaler>& frameScaler);
+
+    virtual int32_t AddRef();
+    virtual int32_t Release();
+
+    // Builds the compute pipeline for the decoded image format and
+    // allocates the readback buffer for outputWidth x outputHeight (both
+    // rounded up to even, as NV12 requires). Cheap when already
+    // initialized for the same format and size, so it can be called per
+    // frame like VulkanFrameChecksum::Initialize().
+    VkResult Initialize(VkFormat imageFormat, uint32_t outputWidth, uint32_t outputHeight);
+
+    // Records, submits and waits for the dispatch downsampling the
+    // cropRect region of decodedImage (cropRect in luma texels;
+    // texExtent is the image's coded extent the normalized sample
+    // coordinates are relative to). The image is transitioned from
+    // imageLayout for sampling and back. When frameCompleteFence is
+    // valid it is waited on first, so the decode is complete before the
+    // dispatch samples the image.
+    VkResult ScaleFrame(VkImage decodedImage,
+                        const VkExtent2D& texExtent,
+                        const VkRect2D& cropRect,
+                        VkImageLayout imageLayout,
+                        VkFence frameCompleteFence);
+
+    // Copies the scaled NV12 frame of the last ScaleFrame() into pDst,
+    // trimming the buffer's word-aligned row pitch; returns the number of
+    // bytes written (outputWidth * outputHeight * 3 / 2), or 0 when it
+    // does not fit in maxDstSize.
+    size_t CopyScaledFrameToNv12(uint8_t* pDst, size_t maxDstSize) const;
+
+    uint32_t GetOutputWidth() const { return m_outputWidth; }
+    uint32_t GetOutputHeight() const { return m_outputHeight; }
+
+private:
+    VulkanFrameScaler(const VulkanDeviceContext* vkDevCtx)
+        : m_refCount(0)
+        , m_vkDevCtx(vkDevCtx)
+        , m_imageFormat(VK_FORMAT_UNDEFINED)
+        , m_lumaPlaneFormat(VK_FORMAT_UNDEFINED)
+        , m_chromaPlaneFormat(VK_FORMAT_UNDEFINED)
+        , m_outputWidth(0)
+        , m_outputHeight(0)
+        , m_rowPitchWords(0)
+        , m_descriptorSetLayout()
+        , m_pipelineLayout()
+        , m_pipeline()
+        , m_shaderModule()
+        , m_sampler()
+        , m_cmdPool()
+        , m_cmdBuffer()
+        , m_descriptorPool()
+        , m_descriptorSet()
+        , m_fence()
+        , m_outputBuffer()
+        , m_outputMemory()
+        , m_pMappedOutput(nullptr) { }
+
+    virtual ~VulkanFrameScaler();
+    void Deinitialize();
+
+    VkResult CreateOutputBuffer();
+    VkResult GetPlaneImageViews(VkImage decodedImage, VkImageView planeViews[2]);
+
+    std::atomic<int32_t>        m_refCount;
+    const VulkanDeviceContext*  m_vkDevCtx;
+    VkFormat                    m_imageFormat;
+    VkFormat                    m_lumaPlaneFormat;
+    VkFormat                    m_chromaPlaneFormat;
+    uint32_t                    m_outputWidth;
+    uint32_t                    m_outputHeight;
+    // The shader packs 4 output bytes per 32-bit word, so rows are padded
+    // to a word multiple and trimmed on the host copy.
+    uint32_t                    m_rowPitchWords;
+    VkDescriptorSetLayout       m_descriptorSetLayout;
+    VkPipelineLayout            m_pipelineLayout;
+    VkPipeline                  m_pipeline;
+    VkShaderModule              m_shaderModule;
+    VkSampler                   m_sampler;
+    VkCommandPool               m_cmdPool;
+    VkCommandBuffer             m_cmdBuffer;
+    VkDescriptorPool            m_descriptorPool;
+    VkDescriptorSet             m_descriptorSet;
+    VkFence                     m_fence;
+    VkBuffer                    m_outputBuffer;
+    VkDeviceMemory              m_outputMemory;
+    uint8_t*                    m_pMappedOutput;
+    // The decoded images are recycled from a fixed pool, so the per-plane
+    // views are created once per image and reused.
+    std::unordered_map<VkImage, std::pair<VkImageView, VkImageView>> m_planeViewCache;
+};
+
+#endif /* LIBS_VKCODECUTILS_VULKANFRAMESCALER_H_ */
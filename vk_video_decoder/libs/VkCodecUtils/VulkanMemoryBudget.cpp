@@ -0,0 +1,169 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <assert.h>
+#include "VkCodecUtils/VulkanMemoryBudget.h"
+
+std::atomic<uint64_t> VulkanMemoryBudget::m_poolBytes[VulkanMemoryBudget::NUM_MEMORY_POOLS];
+std::atomic<uint32_t> VulkanMemoryBudget::m_poolAllocationCount[VulkanMemoryBudget::NUM_MEMORY_POOLS];
+std::atomic<uint64_t> VulkanMemoryBudget::m_poolPeakBytes[VulkanMemoryBudget::NUM_MEMORY_POOLS];
+uint64_t VulkanMemoryBudget::m_baselineBytes[VulkanMemoryBudget::NUM_MEMORY_POOLS];
+uint32_t VulkanMemoryBudget::m_baselineAllocationCount[VulkanMemoryBudget::NUM_MEMORY_POOLS];
+
+void VulkanMemoryBudget::RecordAllocation(MemoryPool pool, VkDeviceSize numBytes)
+{
+    assert(pool < NUM_MEMORY_POOLS);
+    const uint64_t liveBytes = (m_poolBytes[pool] += numBytes);
+    m_poolAllocationCount[pool]++;
+
+    // Keep the high-water mark; concurrent allocators race benignly, the
+    // loop settles on the maximum.
+    uint64_t peakBytes = m_poolPeakBytes[pool].load(std::memory_order_relaxed);
+    while ((liveBytes > peakBytes) &&
+           !m_poolPeakBytes[pool].compare_exchange_weak(peakBytes, liveBytes,
+                                                        std::memory_order_relaxed)) {
+    }
+}
+
+void VulkanMemoryBudget::RecordFree(MemoryPool pool, VkDeviceSize numBytes)
+{
+    assert(pool < NUM_MEMORY_POOLS);
+    assert(m_poolBytes[pool] >= numBytes);
+    assert(m_poolAllocationCount[pool] > 0);
+    m_poolBytes[pool] -= numBytes;
+    m_poolAllocationCount[pool]--;
+}
+
+void VulkanMemoryBudget::QueryDeviceLocalBudget(const VulkanDeviceContext* vkDevCtx,
+                                                VkDeviceSize& usageBytes, VkDeviceSize& budgetBytes)
+{
+    usageBytes = 0;
+    budgetBytes = 0;
+
+    if (!vkDevCtx->IsDeviceExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+        return;
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = VkPhysicalDeviceMemoryBudgetPropertiesEXT();
+    budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    VkPhysicalDeviceMemoryProperties2 memoryProperties2 = VkPhysicalDeviceMemoryProperties2();
+    memoryProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memoryProperties2.pNext = &budgetProperties;
+    vkDevCtx->GetPhysicalDeviceMemoryProperties2(vkDevCtx->getPhysicalDevice(), &memoryProperties2);
+
+    const VkPhysicalDeviceMemoryProperties& memoryProperties = memoryProperties2.memoryProperties;
+    for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++) {
+        if (memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            usageBytes += budgetProperties.heapUsage[heap];
+            budgetBytes += budgetProperties.heapBudget[heap];
+        }
+    }
+}
+
+VkDeviceSize VulkanMemoryBudget::GetDeviceLocalHeapSize(const VulkanDeviceContext* vkDevCtx)
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties = VkPhysicalDeviceMemoryProperties();
+    vkDevCtx->GetPhysicalDeviceMemoryProperties(vkDevCtx->getPhysicalDevice(), &memoryProperties);
+
+    VkDeviceSize heapSize = 0;
+    for (uint32_t heap = 0; heap < memoryProperties.memoryHeapCount; heap++) {
+        if (memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            heapSize += memoryProperties.memoryHeaps[heap].size;
+        }
+    }
+    return heapSize;
+}
+
+VulkanMemoryBudget::Snapshot VulkanMemoryBudget::GetSnapshot(const VulkanDeviceContext* vkDevCtx)
+{
+    Snapshot snapshot = Snapshot();
+    for (uint32_t pool = 0; pool < NUM_MEMORY_POOLS; pool++) {
+        snapshot.poolBytes[pool] = m_poolBytes[pool];
+        snapshot.poolAllocationCount[pool] = m_poolAllocationCount[pool];
+        snapshot.poolPeakBytes[pool] = m_poolPeakBytes[pool];
+        snapshot.trackedTotalBytes += snapshot.poolBytes[pool];
+    }
+    QueryDeviceLocalBudget(vkDevCtx, snapshot.deviceLocalUsageBytes, snapshot.deviceLocalBudgetBytes);
+    return snapshot;
+}
+
+bool VulkanMemoryBudget::CanAllocate(const VulkanDeviceContext* vkDevCtx, VkDeviceSize numAdditionalBytes)
+{
+    VkDeviceSize usageBytes = 0;
+    VkDeviceSize budgetBytes = 0;
+    QueryDeviceLocalBudget(vkDevCtx, usageBytes, budgetBytes);
+
+    if (budgetBytes > 0) {
+        return ((usageBytes + numAdditionalBytes) <= budgetBytes);
+    }
+
+    // Without VK_EXT_memory_budget only this process' tracked pools are
+    // known - admit up to a conservative fraction of the device-local heap,
+    // leaving room for untracked allocations and other applications.
+    const VkDeviceSize heapSize = GetDeviceLocalHeapSize(vkDevCtx);
+    if (heapSize == 0) {
+        return true;
+    }
+    const VkDeviceSize admissionLimit = (heapSize / 10) * 8; // 80%
+    const Snapshot snapshot = GetSnapshot(vkDevCtx);
+    return ((snapshot.trackedTotalBytes + numAdditionalBytes) <= admissionLimit);
+}
+
+static const char* poolNames[VulkanMemoryBudget::NUM_MEMORY_POOLS] = {
+    "images", "bitstream buffers", "picture parameters"
+};
+
+void VulkanMemoryBudget::MarkRestartBaseline()
+{
+    for (uint32_t pool = 0; pool < NUM_MEMORY_POOLS; pool++) {
+        m_baselineBytes[pool] = m_poolBytes[pool];
+        m_baselineAllocationCount[pool] = m_poolAllocationCount[pool];
+    }
+}
+
+void VulkanMemoryBudget::DumpRestartDelta(std::ostream& outStr)
+{
+    outStr << "Memory delta since previous loop:" << std::endl;
+    for (uint32_t pool = 0; pool < NUM_MEMORY_POOLS; pool++) {
+        const uint64_t liveBytes = m_poolBytes[pool];
+        const uint32_t liveCount = m_poolAllocationCount[pool];
+        const int64_t deltaBytes = (int64_t)liveBytes - (int64_t)m_baselineBytes[pool];
+        const int64_t deltaCount = (int64_t)liveCount - (int64_t)m_baselineAllocationCount[pool];
+        outStr << "\t" << poolNames[pool] << " : "
+               << (liveBytes / 1024) << " kB in " << liveCount << " objects, "
+               << ((deltaBytes >= 0) ? "+" : "") << (deltaBytes / 1024) << " kB "
+               << ((deltaCount >= 0) ? "+" : "") << deltaCount << " objects"
+               << ", peak " << (m_poolPeakBytes[pool] / 1024) << " kB" << std::endl;
+    }
+    MarkRestartBaseline();
+}
+
+void VulkanMemoryBudget::DumpSnapshot(const VulkanDeviceContext* vkDevCtx, std::ostream& outStr)
+{
+
+    const Snapshot snapshot = GetSnapshot(vkDevCtx);
+    outStr << "Device memory usage:" << std::endl;
+    for (uint32_t pool = 0; pool < NUM_MEMORY_POOLS; pool++) {
+        outStr << "\t" << poolNames[pool] << " : "
+               << (snapshot.poolBytes[pool] / 1024) << " kB in "
+               << snapshot.poolAllocationCount[pool] << " allocations" << std::endl;
+    }
+    if (snapshot.deviceLocalBudgetBytes > 0) {
+        outStr << "\tdevice-local usage / budget : "
+               << (snapshot.deviceLocalUsageBytes / 1024) << " kB / "
+               << (snapshot.deviceLocalBudgetBytes / 1024) << " kB" << std::endl;
+    }
+}
@@ -0,0 +1,103 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VULKANMEMORYBUDGET_H_
+#define _VULKANMEMORYBUDGET_H_
+
+#include <atomic>
+#include <iostream>
+#include "VkCodecUtils/VulkanDeviceContext.h"
+
+// Device memory accounting and admission control.
+//
+// The image pool (VkImageResource) and the bitstream buffers
+// (VulkanBitstreamBufferImpl) record their allocations here, so the bytes
+// held by each pool can be queried at any time instead of discovering
+// overcommit only when vkAllocateMemory fails mid-stream. When the device
+// was created with VK_EXT_memory_budget (see
+// VulkanDeviceContext::AddOptionalDeviceExtension()), GetSnapshot() also
+// reports the driver's device-local usage and budget, which cover the whole
+// process and other processes' residency pressure - not just the pools
+// tracked here.
+//
+// CanAllocate() is the admission-control hook: StartVideoSequence() uses it
+// to shrink a new image pool - or reject the new sequence - when the
+// requested surfaces would not fit the budget.
+class VulkanMemoryBudget {
+public:
+    enum MemoryPool {
+        MEMORY_POOL_IMAGES = 0,     // decode image pool (DPB and output images)
+        MEMORY_POOL_BITSTREAM = 1,  // bitstream buffers
+        // Session parameter objects (VkParserVideoPictureParameters). The
+        // recorded bytes are the host-side object size only - the
+        // device-side cost of the VkVideoSessionParametersKHR is opaque -
+        // so for this pool the live-object count is the leak signal.
+        MEMORY_POOL_PICTURE_PARAMETERS = 2,
+        NUM_MEMORY_POOLS = 3
+    };
+
+    struct Snapshot {
+        VkDeviceSize poolBytes[NUM_MEMORY_POOLS];
+        uint32_t     poolAllocationCount[NUM_MEMORY_POOLS];
+        // Highest live-bytes value each pool ever reached.
+        VkDeviceSize poolPeakBytes[NUM_MEMORY_POOLS];
+        VkDeviceSize trackedTotalBytes;
+        // From VK_EXT_memory_budget, summed over the device-local heaps;
+        // both are 0 when the extension is unavailable.
+        VkDeviceSize deviceLocalUsageBytes;
+        VkDeviceSize deviceLocalBudgetBytes;
+    };
+
+    static void RecordAllocation(MemoryPool pool, VkDeviceSize numBytes);
+    static void RecordFree(MemoryPool pool, VkDeviceSize numBytes);
+
+    static Snapshot GetSnapshot(const VulkanDeviceContext* vkDevCtx);
+
+    // Leak attribution across loops (--memoryDeltaReport): remembers the
+    // current live bytes and object counts of every pool as the baseline of
+    // the running iteration.
+    static void MarkRestartBaseline();
+
+    // Prints each pool's live bytes/objects, its high-water mark, and the
+    // signed growth since the last baseline - then re-baselines, so soak
+    // runs over looping content (VulkanVideoProcessor::Restart()) report
+    // the per-iteration growth that pinpoints an accreting pool in one run.
+    static void DumpRestartDelta(std::ostream& outStr);
+
+    // Whether numAdditionalBytes of device memory can still be allocated.
+    // With VK_EXT_memory_budget the driver's usage and budget are
+    // authoritative; without it the tracked totals are checked against a
+    // conservative fraction of the device-local heap size.
+    static bool CanAllocate(const VulkanDeviceContext* vkDevCtx, VkDeviceSize numAdditionalBytes);
+
+    static void DumpSnapshot(const VulkanDeviceContext* vkDevCtx, std::ostream& outStr);
+
+private:
+    // Sums the VK_EXT_memory_budget usage and budget over the device-local
+    // heaps; leaves both at 0 when the extension is not enabled.
+    static void QueryDeviceLocalBudget(const VulkanDeviceContext* vkDevCtx,
+                                       VkDeviceSize& usageBytes, VkDeviceSize& budgetBytes);
+
+    static VkDeviceSize GetDeviceLocalHeapSize(const VulkanDeviceContext* vkDevCtx);
+
+    static std::atomic<uint64_t> m_poolBytes[NUM_MEMORY_POOLS];
+    static std::atomic<uint32_t> m_poolAllocationCount[NUM_MEMORY_POOLS];
+    static std::atomic<uint64_t> m_poolPeakBytes[NUM_MEMORY_POOLS];
+    static uint64_t              m_baselineBytes[NUM_MEMORY_POOLS];
+    static uint32_t              m_baselineAllocationCount[NUM_MEMORY_POOLS];
+};
+
+#endif /* _VULKANMEMORYBUDGET_H_ */
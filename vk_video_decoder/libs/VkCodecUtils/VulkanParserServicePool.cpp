@@ -0,0 +1,169 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <cassert>
+
+#include "VkCodecUtils/VulkanParserServicePool.h"
+#include "VkCodecUtils/VulkanThreadAffinity.h"
+#include "VkCodecUtils/VulkanVideoProcessor.h"
+
+VulkanParserServicePool& VulkanParserServicePool::Get()
+{
+    static VulkanParserServicePool parserServicePool;
+    return parserServicePool;
+}
+
+bool VulkanParserServicePool::Start(uint32_t numWorkers, const std::string& workerCpuSet)
+{
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+
+    if (!m_workers.empty()) {
+        // Already running - the first configuration wins.
+        return true;
+    }
+
+    m_exitWorkers = false;
+    m_workerCpuSet = workerCpuSet;
+    for (uint32_t workerIndex = 0; workerIndex < numWorkers; workerIndex++) {
+        m_workers.emplace_back(&VulkanParserServicePool::WorkerThreadProc, this, workerIndex);
+    }
+
+    return !m_workers.empty();
+}
+
+void VulkanParserServicePool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+        if (m_workers.empty()) {
+            return;
+        }
+        assert(m_streams.empty());
+        m_exitWorkers = true;
+        m_workAvailableCond.notify_all();
+    }
+
+    for (size_t workerIndex = 0; workerIndex < m_workers.size(); workerIndex++) {
+        m_workers[workerIndex].join();
+    }
+    m_workers.clear();
+    m_workQueue.clear();
+}
+
+VulkanParserServicePool::StreamState* VulkanParserServicePool::FindStreamLocked(VulkanVideoProcessor* processor)
+{
+    for (size_t streamIndex = 0; streamIndex < m_streams.size(); streamIndex++) {
+        if (m_streams[streamIndex].processor == processor) {
+            return &m_streams[streamIndex];
+        }
+    }
+    return nullptr;
+}
+
+void VulkanParserServicePool::Schedule(VulkanVideoProcessor* processor)
+{
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+
+    StreamState* stream = FindStreamLocked(processor);
+    if (stream == nullptr) {
+        m_streams.push_back(StreamState{ processor, false, false, false });
+        stream = &m_streams.back();
+    }
+
+    if (stream->running) {
+        // The worker picks this up when the current quantum completes,
+        // so the stream never runs on two workers at once.
+        stream->rescheduleWanted = true;
+        return;
+    }
+
+    if (!stream->queued) {
+        stream->queued = true;
+        m_workQueue.push_back(processor);
+        m_workAvailableCond.notify_one();
+    }
+}
+
+void VulkanParserServicePool::Unregister(VulkanVideoProcessor* processor)
+{
+    std::unique_lock<std::mutex> lock(m_poolMutex);
+
+    StreamState* stream = FindStreamLocked(processor);
+    if (stream == nullptr) {
+        return;
+    }
+
+    // Wait out a quantum in flight; entries still sitting in the work queue
+    // are skipped by the workers once the state is gone.
+    m_streamIdleCond.wait(lock, [this, processor] {
+        StreamState* waitStream = FindStreamLocked(processor);
+        return (waitStream == nullptr) || !waitStream->running;
+    });
+
+    for (size_t streamIndex = 0; streamIndex < m_streams.size(); streamIndex++) {
+        if (m_streams[streamIndex].processor == processor) {
+            m_streams.erase(m_streams.begin() + streamIndex);
+            break;
+        }
+    }
+}
+
+void VulkanParserServicePool::WorkerThreadProc(uint32_t workerIndex)
+{
+    (void)workerIndex;
+    VulkanThreadAffinity::PinCurrentThread(m_workerCpuSet, "parser-pool");
+
+    for (;;) {
+        VulkanVideoProcessor* processor = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_poolMutex);
+            m_workAvailableCond.wait(lock, [this] {
+                return !m_workQueue.empty() || m_exitWorkers;
+            });
+            if (m_exitWorkers) {
+                break;
+            }
+
+            processor = m_workQueue.front();
+            m_workQueue.pop_front();
+
+            StreamState* stream = FindStreamLocked(processor);
+            if (stream == nullptr) {
+                // Unregistered while the entry sat in the queue.
+                continue;
+            }
+            stream->queued = false;
+            stream->running = true;
+        }
+
+        const bool wantsMoreWork = processor->ParserServiceRunQuantum();
+
+        {
+            std::lock_guard<std::mutex> lock(m_poolMutex);
+            StreamState* stream = FindStreamLocked(processor);
+            if (stream != nullptr) {
+                stream->running = false;
+                if ((wantsMoreWork || stream->rescheduleWanted) && !stream->queued) {
+                    stream->rescheduleWanted = false;
+                    stream->queued = true;
+                    m_workQueue.push_back(processor);
+                    m_workAvailableCond.notify_one();
+                }
+            }
+            m_streamIdleCond.notify_all();
+        }
+    }
+}
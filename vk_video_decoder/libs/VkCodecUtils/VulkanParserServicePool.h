@@ -0,0 +1,108 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VKCODECUTILS_VULKANPARSERSERVICEPOOL_H_
+#define _VKCODECUTILS_VULKANPARSERSERVICEPOOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class VulkanVideoProcessor;
+
+// Shared parser service (--parserWorkers <count>): a small process-wide pool
+// of worker threads runs the demux + CPU parse + decode submission quanta of
+// every registered stream, instead of the one dedicated parser thread per
+// stream of the pipelined parsing mode. Per-stream parser state stays inside
+// each stream's VulkanVideoProcessor and its parser instance - only the
+// worker threads are shared - so many streams of the same codec keep the
+// parse code hot in a few cores' caches rather than burning a thread (and a
+// scheduler slot) per stream. Backpressure stays per stream through the same
+// parsed-chunk credits the dedicated-thread mode uses: a stream whose credit
+// window is full is simply not rescheduled until its consumer frees a credit
+// (see VulkanVideoProcessor::ParserServiceRunQuantum()).
+class VulkanParserServicePool {
+public:
+    // The process-wide pool shared by all streams.
+    static VulkanParserServicePool& Get();
+
+    // Starts the workers on first use. The pool is process-wide, so later
+    // calls with a different count keep the first configuration. Returns
+    // false when no worker thread could be started.
+    bool Start(uint32_t numWorkers, const std::string& workerCpuSet);
+
+    // Stops and joins the workers; every stream must be unregistered first.
+    void Stop();
+
+    bool IsRunning() const
+    {
+        std::lock_guard<std::mutex> lock(m_poolMutex);
+        return !m_workers.empty();
+    }
+
+    // Queues one parse quantum for the stream, unless one is already queued.
+    // A stream currently running on a worker is marked for rescheduling
+    // instead, so no stream ever runs on two workers at once.
+    void Schedule(VulkanVideoProcessor* processor);
+
+    // Removes the stream from the pool, waiting until no worker still runs
+    // it. Must be called before the stream is rewound or torn down.
+    void Unregister(VulkanVideoProcessor* processor);
+
+private:
+    VulkanParserServicePool()
+        : m_poolMutex()
+        , m_workAvailableCond()
+        , m_streamIdleCond()
+        , m_workQueue()
+        , m_streams()
+        , m_workers()
+        , m_workerCpuSet()
+        , m_exitWorkers(false)
+    {
+    }
+
+    ~VulkanParserServicePool()
+    {
+        Stop();
+    }
+
+    void WorkerThreadProc(uint32_t workerIndex);
+
+    // Per registered stream scheduling state, protected by m_poolMutex.
+    struct StreamState {
+        VulkanVideoProcessor* processor;
+        bool queued;            // an entry for the stream sits in m_workQueue
+        bool running;           // a worker currently runs the stream's quantum
+        bool rescheduleWanted;  // Schedule() arrived while the stream was running
+    };
+
+    StreamState* FindStreamLocked(VulkanVideoProcessor* processor);
+
+    mutable std::mutex                m_poolMutex;
+    std::condition_variable           m_workAvailableCond;
+    std::condition_variable           m_streamIdleCond;
+    std::deque<VulkanVideoProcessor*> m_workQueue;
+    std::vector<StreamState>          m_streams;
+    std::vector<std::thread>          m_workers;
+    std::string                       m_workerCpuSet;
+    bool                              m_exitWorkers;
+};
+
+#endif /* _VKCODECUTILS_VULKANPARSERSERVICEPOOL_H_ */
@@ -0,0 +1,126 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cassert>
+
+#include "VkCodecUtils/VulkanPerfCounters.h"
+
+// Scrape names of the counters, indexed by CounterId.
+static const char* const perfCounterNames[VulkanPerfCounters::NUM_COUNTERS] = {
+    "vkvideo_frames_demuxed",
+    "vkvideo_frames_parsed",
+    "vkvideo_frames_decoded",
+    "vkvideo_frames_displayed",
+    "vkvideo_frames_dropped",
+    "vkvideo_frames_late",
+    "vkvideo_frames_repeated",
+    "vkvideo_frames_corrupted",
+    "vkvideo_bytes_in",
+    "vkvideo_bytes_out",
+    "vkvideo_decode_queue_depth",
+    "vkvideo_qos_submits_deferred",
+    "vkvideo_qos_realtime_blocked",
+};
+
+VulkanPerfCounters& VulkanPerfCounters::Get()
+{
+    static VulkanPerfCounters perfCounters;
+    return perfCounters;
+}
+
+bool VulkanPerfCounters::WriteSample()
+{
+    // Write a sibling temp file and rename it over the export file, so a
+    // scraper never observes a partially written sample.
+    const std::string tempFileName = m_exportFileName + ".tmp";
+    FILE* exportFile = fopen(tempFileName.c_str(), "w");
+    if (exportFile == nullptr) {
+        fprintf(stderr, "\nERROR: Could not write the performance counters file %s\n",
+                tempFileName.c_str());
+        return false;
+    }
+
+    for (uint32_t counterId = 0; counterId < NUM_COUNTERS; counterId++) {
+        fprintf(exportFile, "%s %llu\n", perfCounterNames[counterId],
+                (unsigned long long)GetValue((CounterId)counterId));
+    }
+
+    fclose(exportFile);
+
+    if (rename(tempFileName.c_str(), m_exportFileName.c_str()) != 0) {
+        fprintf(stderr, "\nERROR: Could not replace the performance counters file %s\n",
+                m_exportFileName.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+void VulkanPerfCounters::ExportThreadProc()
+{
+    std::unique_lock<std::mutex> lock(m_exportMutex);
+    for (;;) {
+        m_exportWakeCond.wait_for(lock, std::chrono::milliseconds(m_exportPeriodMs),
+                                  [this] { return m_exitExportThread; });
+        if (m_exitExportThread) {
+            break;
+        }
+        WriteSample();
+    }
+}
+
+bool VulkanPerfCounters::StartExport(const std::string& exportFileName, uint32_t samplePeriodMs)
+{
+    std::unique_lock<std::mutex> lock(m_exportMutex);
+
+    if (m_exportRunning) {
+        // Back-to-back streams share the running exporter.
+        return true;
+    }
+
+    m_exportFileName = exportFileName;
+    m_exportPeriodMs = (samplePeriodMs > 0) ? samplePeriodMs : 500;
+    m_exitExportThread = false;
+
+    // Fail early on an unwritable location, before the pipeline starts.
+    if (!WriteSample()) {
+        return false;
+    }
+
+    m_exportThread = std::thread(&VulkanPerfCounters::ExportThreadProc, this);
+    m_exportRunning = m_exportThread.joinable();
+    return m_exportRunning;
+}
+
+void VulkanPerfCounters::StopExport()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_exportMutex);
+        if (!m_exportRunning) {
+            return;
+        }
+        m_exitExportThread = true;
+        m_exportWakeCond.notify_all();
+    }
+
+    m_exportThread.join();
+
+    // Leave the totals of the run behind for a last scrape.
+    WriteSample();
+    m_exportRunning = false;
+}
@@ -0,0 +1,132 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VKCODECUTILS_VULKANPERFCOUNTERS_H_
+#define _VKCODECUTILS_VULKANPERFCOUNTERS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <condition_variable>
+
+// Runtime performance counters surface (--perfCountersFile).
+//
+// The pipeline stages feed a process-wide set of counters - frames demuxed,
+// parsed, decoded, displayed and dropped, bytes in and out, plus queue depth
+// gauges. A sampler thread periodically writes all of them to a text file
+// ("name value" per line, replaced atomically via rename), so fleet
+// monitoring can scrape live per-stream numbers without attaching to the
+// process or perturbing the pipeline.
+//
+// The hot-path cost is one relaxed atomic add on a counter padded to its own
+// cache line; the sampler only ever reads. This is the always-available,
+// runtime complement of the compile-time probe levels in
+// VulkanVideoInstrumentation.h.
+class VulkanPerfCounters {
+
+public:
+    enum CounterId {
+        FRAMES_DEMUXED = 0,    // bitstream packets delivered by the demuxer
+        FRAMES_PARSED,         // demuxed packets accepted by the parser
+        FRAMES_DECODED,        // decoded pictures handed to the consumer
+        FRAMES_DISPLAYED,      // pictures released after display/output
+        FRAMES_DROPPED,        // pictures discarded without being displayed
+        FRAMES_LATE,           // pictures displayed after their PTS deadline
+        FRAMES_REPEATED,       // display iterations that re-showed the previous picture
+        FRAMES_CORRUPTED,      // pictures dropped on a decode result error status
+        BYTES_IN,              // compressed bytes demuxed
+        BYTES_OUT,             // decoded bytes written to the output file
+        DECODE_QUEUE_DEPTH,    // gauge: decoded pictures waiting for display
+        QOS_SUBMITS_DEFERRED,  // best-effort decode submissions deferred behind a pending realtime submission
+        QOS_REALTIME_BLOCKED,  // realtime decode submissions that found their queue already busy submitting
+        NUM_COUNTERS
+    };
+
+    // The process-wide counter set shared by all pipeline stages.
+    static VulkanPerfCounters& Get();
+
+    void Add(CounterId counterId, uint64_t increment = 1)
+    {
+        m_counters[counterId].value.fetch_add(increment, std::memory_order_relaxed);
+    }
+
+    void Sub(CounterId counterId, uint64_t decrement = 1)
+    {
+        m_counters[counterId].value.fetch_sub(decrement, std::memory_order_relaxed);
+    }
+
+    // For occupancy-style values the last observation is the sample.
+    void SetGauge(CounterId counterId, uint64_t value)
+    {
+        m_counters[counterId].value.store(value, std::memory_order_relaxed);
+    }
+
+    uint64_t GetValue(CounterId counterId) const
+    {
+        return m_counters[counterId].value.load(std::memory_order_relaxed);
+    }
+
+    // Starts the sampler thread, rewriting exportFileName every
+    // samplePeriodMs. Starting an already running exporter is a no-op, so
+    // back-to-back streams of a batch run share one exporter. Returns false
+    // when the file cannot be written.
+    bool StartExport(const std::string& exportFileName, uint32_t samplePeriodMs);
+
+    // Stops the sampler thread after a final sample, so the file ends up
+    // with the totals of the run.
+    void StopExport();
+
+private:
+    VulkanPerfCounters()
+        : m_counters{}
+        , m_exportThread()
+        , m_exportMutex()
+        , m_exportWakeCond()
+        , m_exportFileName()
+        , m_exportPeriodMs(0)
+        , m_exitExportThread(false)
+        , m_exportRunning(false) { }
+
+    ~VulkanPerfCounters()
+    {
+        StopExport();
+    }
+
+    VulkanPerfCounters(const VulkanPerfCounters&) = delete;
+    VulkanPerfCounters& operator=(const VulkanPerfCounters&) = delete;
+
+    void ExportThreadProc();
+    bool WriteSample();
+
+    // One cache line per counter, so concurrent stages never contend on a
+    // line and the adds stay local to the incrementing core.
+    struct alignas(64) PaddedCounter {
+        std::atomic<uint64_t> value;
+    };
+
+    PaddedCounter           m_counters[NUM_COUNTERS];
+    std::thread             m_exportThread;
+    std::mutex              m_exportMutex;
+    std::condition_variable m_exportWakeCond;
+    std::string             m_exportFileName;
+    uint32_t                m_exportPeriodMs;
+    bool                    m_exitExportThread;
+    bool                    m_exportRunning;
+};
+
+#endif /* _VKCODECUTILS_VULKANPERFCOUNTERS_H_ */
@@ -16,12 +16,114 @@
 
 #include "VulkanShaderCompiler.h"
 #include <shaderc/shaderc.h>
+#include <stdio.h>
+#include <vector>
 #include <NvCodecUtils/Logger.h>
 #include "Helpers.h"
 #include "VkCodecUtils/VulkanDeviceContext.h"
 
 namespace vulkanVideoUtils {
 
+// Process-wide root of the on-disk shader and pipeline cache.
+// Empty when the cache is disabled (the default).
+static std::string s_shaderCacheDirectory;
+
+void VulkanShaderCompiler::SetShaderCacheDirectory(const char* cacheDirectory)
+{
+    s_shaderCacheDirectory = (cacheDirectory != nullptr) ? cacheDirectory : "";
+}
+
+const std::string& VulkanShaderCompiler::GetShaderCacheDirectory()
+{
+    return s_shaderCacheDirectory;
+}
+
+// FNV-1a 64-bit over the shader source - fast and adequate to key a trusted
+// local cache directory.
+static uint64_t HashShaderSource(const char* data, size_t size, uint64_t seed)
+{
+    uint64_t hash = 14695981039346656037ull ^ seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string VulkanShaderCompiler::GetDeviceCacheKey(const VulkanDeviceContext* vkDevCtx)
+{
+    VkPhysicalDeviceProperties deviceProperties{};
+    vkDevCtx->GetPhysicalDeviceProperties(vkDevCtx->getPhysicalDevice(), &deviceProperties);
+
+    char uuidString[(VK_UUID_SIZE * 2) + 1]{};
+    for (uint32_t i = 0; i < VK_UUID_SIZE; i++) {
+        snprintf(&uuidString[i * 2], 3, "%02x", deviceProperties.pipelineCacheUUID[i]);
+    }
+    return std::string(uuidString);
+}
+
+std::string VulkanShaderCompiler::GetCacheFilePath(const VulkanDeviceContext* vkDevCtx,
+                                                   const char* name, const char* extension)
+{
+    if (s_shaderCacheDirectory.empty()) {
+        return std::string();
+    }
+    return s_shaderCacheDirectory + "/" + GetDeviceCacheKey(vkDevCtx) + "-" + name + extension;
+}
+
+static std::vector<uint8_t> ReadCacheFile(const std::string& filePath)
+{
+    std::vector<uint8_t> data;
+    FILE* fp = fopen(filePath.c_str(), "rb");
+    if (fp == nullptr) {
+        return data;
+    }
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    if (size > 0) {
+        data.resize((size_t)size);
+        if (fread(data.data(), 1, data.size(), fp) != data.size()) {
+            data.clear();
+        }
+    }
+    fclose(fp);
+    return data;
+}
+
+static bool WriteCacheFile(const std::string& filePath, const uint8_t* pData, size_t size)
+{
+    FILE* fp = fopen(filePath.c_str(), "wb");
+    if (fp == nullptr) {
+        LOG(WARNING) << "VulkanShaderCompiler: could not write cache file " << filePath;
+        return false;
+    }
+    const bool success = (fwrite(pData, 1, size, fp) == size);
+    fclose(fp);
+    return success;
+}
+
+std::vector<uint8_t> VulkanShaderCompiler::LoadPipelineCacheData(const VulkanDeviceContext* vkDevCtx,
+                                                                 const char* cacheName)
+{
+    const std::string cacheFilePath = GetCacheFilePath(vkDevCtx, cacheName, ".pipelinecache");
+    if (cacheFilePath.empty()) {
+        return std::vector<uint8_t>();
+    }
+    return ReadCacheFile(cacheFilePath);
+}
+
+bool VulkanShaderCompiler::SavePipelineCacheData(const VulkanDeviceContext* vkDevCtx,
+                                                 const char* cacheName,
+                                                 const uint8_t* pCacheData, size_t cacheDataSize)
+{
+    const std::string cacheFilePath = GetCacheFilePath(vkDevCtx, cacheName, ".pipelinecache");
+    if (cacheFilePath.empty() || (cacheDataSize == 0)) {
+        return false;
+    }
+    return WriteCacheFile(cacheFilePath, pCacheData, cacheDataSize);
+}
+
 // Translate Vulkan Shader Type to shaderc shader type
 static shaderc_shader_kind getShadercShaderType(VkShaderStageFlagBits type)
 {
@@ -60,9 +162,40 @@ VulkanShaderCompiler::~VulkanShaderCompiler() {
     }
 }
 
+VkResult VulkanShaderCompiler::BuildShaderFromCachedSpirv(const std::string& cacheFilePath,
+                                                          const VulkanDeviceContext* vkDevCtx,
+                                                          VkShaderModule *shaderOut)
+{
+    std::vector<uint8_t> spirvCode = ReadCacheFile(cacheFilePath);
+    if (spirvCode.empty() || (spirvCode.size() % sizeof(uint32_t) != 0)) {
+        return VK_NOT_READY;
+    }
+
+    VkShaderModuleCreateInfo shaderModuleCreateInfo = VkShaderModuleCreateInfo();
+    shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shaderModuleCreateInfo.pNext = nullptr;
+    shaderModuleCreateInfo.codeSize = spirvCode.size();
+    shaderModuleCreateInfo.pCode = (const uint32_t *)spirvCode.data();
+    shaderModuleCreateInfo.flags = 0;
+    return vkDevCtx->CreateShaderModule(*vkDevCtx, &shaderModuleCreateInfo, nullptr, shaderOut);
+}
+
 VkResult VulkanShaderCompiler::BuildGlslShader(const char *shaderCode, size_t shaderSize, VkShaderStageFlagBits type,
                                                const VulkanDeviceContext* vkDevCtx, VkShaderModule *shaderOut)
 {
+    std::string cacheFilePath;
+    if (!s_shaderCacheDirectory.empty()) {
+        const uint64_t sourceHash = HashShaderSource(shaderCode, shaderSize, (uint64_t)type);
+        char hashName[32];
+        snprintf(hashName, sizeof(hashName), "%016llx", (unsigned long long)sourceHash);
+        cacheFilePath = GetCacheFilePath(vkDevCtx, hashName, ".spv");
+
+        // Cache hit: create the shader module without touching shaderc.
+        if (BuildShaderFromCachedSpirv(cacheFilePath, vkDevCtx, shaderOut) == VK_SUCCESS) {
+            return VK_SUCCESS;
+        }
+    }
+
     VkResult result = VK_NOT_READY;
     if (compilerHandle) {
         shaderc_compiler_t compiler = (shaderc_compiler_t)compilerHandle;
@@ -84,6 +217,12 @@ VkResult VulkanShaderCompiler::BuildGlslShader(const char *shaderCode, size_t sh
         shaderModuleCreateInfo.flags = 0;
         result = vkDevCtx->CreateShaderModule(*vkDevCtx, &shaderModuleCreateInfo, nullptr, shaderOut);
 
+        if ((result == VK_SUCCESS) && !cacheFilePath.empty()) {
+            WriteCacheFile(cacheFilePath,
+                           (const uint8_t*)shaderModuleCreateInfo.pCode,
+                           shaderModuleCreateInfo.codeSize);
+        }
+
         shaderc_result_release(spvShader);
     }
     return result;
@@ -17,6 +17,7 @@
 #ifndef LIBS_VKCODECUTILS_VULKANSHADERCOMPILER_H_
 #define LIBS_VKCODECUTILS_VULKANSHADERCOMPILER_H_
 
+#include <string>
 #include "VkCodecUtils/VulkanDeviceContext.h"
 
 namespace vulkanVideoUtils {
@@ -36,7 +37,33 @@ public:
                                  const VulkanDeviceContext* vkDevCtx,
                                  VkShaderModule *shaderOut);
 
+    // Enables the process-wide on-disk shader cache rooted at cacheDirectory.
+    // When enabled, BuildGlslShader() stores the compiled SPIR-V keyed by a
+    // hash of the GLSL source and the device's pipelineCacheUUID, and loads it
+    // back on subsequent runs, skipping the shaderc compilation entirely.
+    // The same directory is used to persist VkPipelineCache blobs
+    // (see LoadPipelineCacheData()/SavePipelineCacheData()).
+    static void SetShaderCacheDirectory(const char* cacheDirectory);
+    static const std::string& GetShaderCacheDirectory();
+
+    // Loads/saves a serialized VkPipelineCache blob from/to the shader cache
+    // directory. The cacheName distinguishes independent pipeline caches.
+    // Returns an empty vector if the cache is disabled or the blob is missing.
+    static std::vector<uint8_t> LoadPipelineCacheData(const VulkanDeviceContext* vkDevCtx,
+                                                      const char* cacheName);
+    static bool SavePipelineCacheData(const VulkanDeviceContext* vkDevCtx,
+                                      const char* cacheName,
+                                      const uint8_t* pCacheData, size_t cacheDataSize);
+
 private:
+    static std::string GetDeviceCacheKey(const VulkanDeviceContext* vkDevCtx);
+    static std::string GetCacheFilePath(const VulkanDeviceContext* vkDevCtx,
+                                        const char* name, const char* extension);
+
+    VkResult BuildShaderFromCachedSpirv(const std::string& cacheFilePath,
+                                        const VulkanDeviceContext* vkDevCtx,
+                                        VkShaderModule *shaderOut);
+
     void* compilerHandle;
 };
 
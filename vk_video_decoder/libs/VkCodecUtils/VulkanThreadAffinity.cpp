@@ -0,0 +1,148 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "VkCodecUtils/VulkanThreadAffinity.h"
+
+static std::atomic<bool> s_preferNumaLocalHostAllocations(false);
+
+#if defined(__linux__)
+// Parses a Linux cpulist ("0-7,16-23") into affinityMask; returns the
+// number of CPUs set, or 0 when the list is malformed.
+static int ParseCpuList(const char* cpuList, cpu_set_t* affinityMask)
+{
+    CPU_ZERO(affinityMask);
+    int numCpusSet = 0;
+
+    const char* str = cpuList;
+    while (*str != '\0') {
+        char* strEnd = nullptr;
+        long rangeFirst = strtol(str, &strEnd, 10);
+        long rangeLast = rangeFirst;
+        if ((strEnd == str) || (rangeFirst < 0) || (rangeFirst >= CPU_SETSIZE)) {
+            return 0;
+        }
+        if (*strEnd == '-') {
+            str = strEnd + 1;
+            rangeLast = strtol(str, &strEnd, 10);
+            if ((strEnd == str) || (rangeLast < rangeFirst) || (rangeLast >= CPU_SETSIZE)) {
+                return 0;
+            }
+        }
+        for (long cpu = rangeFirst; cpu <= rangeLast; cpu++) {
+            CPU_SET((int)cpu, affinityMask);
+            numCpusSet++;
+        }
+        if (*strEnd == ',') {
+            strEnd++;
+        } else if (*strEnd != '\0') {
+            return 0;
+        }
+        str = strEnd;
+    }
+    return numCpusSet;
+}
+#endif
+
+bool VulkanThreadAffinity::PinCurrentThread(const std::string& cpuSet, const char* roleName)
+{
+    if (cpuSet.empty()) {
+        return true;
+    }
+
+#if defined(__linux__)
+    cpu_set_t affinityMask;
+    if (ParseCpuList(cpuSet.c_str(), &affinityMask) == 0) {
+        fprintf(stderr, "\nWARNING: invalid CPU set '%s' for the %s thread - not pinned!\n",
+                cpuSet.c_str(), roleName);
+        return false;
+    }
+
+    int status = pthread_setaffinity_np(pthread_self(), sizeof(affinityMask), &affinityMask);
+    if (status != 0) {
+        fprintf(stderr, "\nWARNING: couldn't pin the %s thread to CPUs '%s' (error %d)!\n",
+                roleName, cpuSet.c_str(), status);
+        return false;
+    }
+    return true;
+#else
+    fprintf(stderr, "\nWARNING: thread pinning is not supported on this platform - "
+                    "the %s thread stays unpinned!\n", roleName);
+    return false;
+#endif
+}
+
+std::string VulkanThreadAffinity::GetDeviceLocalCpuSet(const VulkanDeviceContext* vkDevCtx)
+{
+#if defined(__linux__)
+    if (vkDevCtx->FindDeviceExtension(VK_EXT_PCI_BUS_INFO_EXTENSION_NAME) == nullptr) {
+        return std::string();
+    }
+
+    VkPhysicalDevicePCIBusInfoPropertiesEXT pciBusInfo = VkPhysicalDevicePCIBusInfoPropertiesEXT();
+    pciBusInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PCI_BUS_INFO_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2 properties2 = VkPhysicalDeviceProperties2();
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &pciBusInfo;
+    vkDevCtx->GetPhysicalDeviceProperties2(vkDevCtx->getPhysicalDevice(), &properties2);
+
+    char sysfsPath[128];
+    snprintf(sysfsPath, sizeof(sysfsPath), "/sys/bus/pci/devices/%04x:%02x:%02x.%x/local_cpulist",
+             pciBusInfo.pciDomain, pciBusInfo.pciBus, pciBusInfo.pciDevice, pciBusInfo.pciFunction);
+
+    FILE* cpuListFile = fopen(sysfsPath, "r");
+    if (cpuListFile == nullptr) {
+        return std::string();
+    }
+
+    char cpuList[256] = {};
+    const bool haveCpuList = (fgets(cpuList, sizeof(cpuList), cpuListFile) != nullptr);
+    fclose(cpuListFile);
+    if (!haveCpuList) {
+        return std::string();
+    }
+
+    std::string cpuSet(cpuList);
+    while (!cpuSet.empty() && ((cpuSet.back() == '\n') || (cpuSet.back() == ' '))) {
+        cpuSet.pop_back();
+    }
+    // On single-node hosts sysfs reports the full CPU set here, so pinning
+    // to it is effectively a no-op.
+    return cpuSet;
+#else
+    (void)vkDevCtx;
+    return std::string();
+#endif
+}
+
+void VulkanThreadAffinity::SetPreferNumaLocalHostAllocations(bool enable)
+{
+    s_preferNumaLocalHostAllocations = enable;
+}
+
+bool VulkanThreadAffinity::PreferNumaLocalHostAllocations()
+{
+    return s_preferNumaLocalHostAllocations;
+}
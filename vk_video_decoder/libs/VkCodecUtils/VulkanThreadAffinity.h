@@ -0,0 +1,54 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VULKANTHREADAFFINITY_H_
+#define _VULKANTHREADAFFINITY_H_
+
+#include <string>
+#include "VkCodecUtils/VulkanDeviceContext.h"
+
+// CPU placement of the pipeline threads on multi-socket hosts.
+//
+// On NUMA systems the demux, parse and output threads should run on the
+// node the GPU hangs off, so the mapped bitstream and readback memory they
+// touch stays node-local. Each pipeline role can be pinned to an explicit
+// CPU set (see the --pin*Thread options in ProgramConfig), or the set can
+// be derived from the GPU's PCIe locality with GetDeviceLocalCpuSet().
+//
+// All of this is best effort: on platforms without affinity support, or
+// when sysfs/VK_EXT_pci_bus_info is unavailable, the calls degrade to
+// no-ops and the threads stay wherever the scheduler puts them.
+class VulkanThreadAffinity {
+public:
+    // Pins the calling thread to the CPUs in cpuSet, a Linux cpulist such
+    // as "0-7,16-23". An empty set is a no-op; an invalid set or an
+    // unsupported platform logs a warning and leaves the thread unpinned.
+    static bool PinCurrentThread(const std::string& cpuSet, const char* roleName);
+
+    // The cpulist of the CPUs local to the device's PCIe root complex,
+    // from sysfs via VK_EXT_pci_bus_info; empty when it cannot be
+    // determined (non-Linux, extension not supported, no NUMA).
+    static std::string GetDeviceLocalCpuSet(const VulkanDeviceContext* vkDevCtx);
+
+    // When enabled, freshly mapped host-visible allocations are pre-faulted
+    // from the allocating thread (see VulkanDeviceMemoryImpl::Initialize()),
+    // so with the pipeline threads pinned above, first-touch places the
+    // pages on the GPU-local node.
+    static void SetPreferNumaLocalHostAllocations(bool enable);
+    static bool PreferNumaLocalHostAllocations();
+};
+
+#endif /* _VULKANTHREADAFFINITY_H_ */
@@ -0,0 +1,112 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include <chrono>
+#include <thread>
+
+#include "VkCodecUtils/VulkanVideoFrameReactor.h"
+
+void VulkanVideoFrameReactor::AddStream(const VkSharedBaseObj<VulkanVideoProcessor>& processor,
+                                        Client* client)
+{
+    StreamState stream;
+    stream.processor = processor;
+    stream.client = client;
+    stream.pendingFrame.Reset();
+    stream.framePending = false;
+    stream.completed = false;
+    m_streams.push_back(stream);
+}
+
+uint32_t VulkanVideoFrameReactor::PollOnce(bool* pMadeProgress)
+{
+    uint32_t activeStreams = 0;
+    bool madeProgress = false;
+
+    for (size_t streamIndx = 0; streamIndx < m_streams.size(); streamIndx++) {
+
+        StreamState& stream = m_streams[streamIndx];
+        if (stream.completed) {
+            continue;
+        }
+
+        if (stream.framePending) {
+
+            // The pending handle resolves when the frame-complete fence is
+            // observed signaled; frames submitted without a fence are
+            // complete by the time they are dequeued.
+            bool frameReady = true;
+            if (stream.pendingFrame.frameCompleteFence != VK_NULL_HANDLE) {
+                frameReady = (m_vkDevCtx->GetFenceStatus(*m_vkDevCtx,
+                                                         stream.pendingFrame.frameCompleteFence) == VK_SUCCESS);
+            }
+
+            if (frameReady) {
+                if (stream.pendingFrame.decodeDoneTimeNs == 0) {
+                    stream.pendingFrame.decodeDoneTimeNs = GetCurrentTimeNanoseconds();
+                }
+                bool endOfStream = false;
+                stream.processor->FinishFrame(&stream.pendingFrame, &endOfStream);
+                if (stream.client != nullptr) {
+                    stream.client->OnFrameReady(stream.processor, &stream.pendingFrame);
+                }
+                stream.processor->ReleaseDisplayedFrame(&stream.pendingFrame);
+                stream.framePending = false;
+                madeProgress = true;
+            }
+
+        } else {
+
+            stream.pendingFrame.Reset();
+            bool endOfStream = false;
+            int32_t result = stream.processor->TryGetNextFrame(&stream.pendingFrame, &endOfStream);
+            if (result > 0) {
+                stream.framePending = true;
+                madeProgress = true;
+            } else if (result < 0) {
+                stream.completed = true;
+                if (stream.client != nullptr) {
+                    stream.client->OnStreamComplete(stream.processor);
+                }
+                madeProgress = true;
+                continue;
+            }
+        }
+
+        activeStreams++;
+    }
+
+    if (pMadeProgress != nullptr) {
+        *pMadeProgress = madeProgress;
+    }
+    return activeStreams;
+}
+
+void VulkanVideoFrameReactor::Run()
+{
+    for (;;) {
+        bool madeProgress = false;
+        uint32_t activeStreams = PollOnce(&madeProgress);
+        if (activeStreams == 0) {
+            break;
+        }
+        if (!madeProgress) {
+            // Every stream is waiting on the GPU (or on its parser) - back
+            // off instead of spinning on the fence polls.
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
@@ -0,0 +1,92 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VKCODECUTILS_VULKANVIDEOFRAMEREACTOR_H_
+#define _VKCODECUTILS_VULKANVIDEOFRAMEREACTOR_H_
+
+#include <vector>
+#include "VkCodecUtils/VulkanVideoProcessor.h"
+#include "VulkanVideoFrameBuffer/VulkanVideoFrameBuffer.h"
+
+// Completion-driven decode loop (--reactorDecode): one thread multiplexes
+// any number of streams instead of dedicating a consumer thread to each.
+// Per stream the reactor dequeues frames with the non-blocking
+// VulkanVideoProcessor::TryGetNextFrame(), treats the dequeued frame as a
+// pending handle that resolves when its frameCompleteFence is observed
+// signaled (polled with vkGetFenceStatus, never waited on), and only then
+// runs the frame's completion - FinishFrame(), the client callback and the
+// release back to the frame buffer. The thread-per-stream model spends a
+// scheduler slot and its context switches per stream; here the only
+// blocking point is a short sleep when a full pass over the streams made
+// no progress. The reactor thread stays light when the streams parse on
+// the pipelined parser threads or the shared parser worker pool; in the
+// synchronous parsing mode each poll may run one parse quantum inline.
+class VulkanVideoFrameReactor {
+public:
+
+    // Per-stream completion callbacks. The callbacks run on the reactor's
+    // polling thread; a callback that blocks stalls every stream.
+    class Client {
+    public:
+        // The frame's decode is complete and its file output (if any) has
+        // been written. The frame is only valid for the duration of the
+        // call - the reactor releases it back to the frame buffer when the
+        // callback returns.
+        virtual void OnFrameReady(VulkanVideoProcessor* processor, const DecodedFrame* pFrame) = 0;
+
+        // The stream delivered its last frame and was removed from the
+        // reactor.
+        virtual void OnStreamComplete(VulkanVideoProcessor* processor) = 0;
+
+    protected:
+        virtual ~Client() {}
+    };
+
+    VulkanVideoFrameReactor(const VulkanDeviceContext* vkDevCtx)
+        : m_vkDevCtx(vkDevCtx)
+        , m_streams()
+    {
+    }
+
+    // Registers an initialized stream. client may be nullptr when only the
+    // decode (and its file output) is wanted. Not thread safe against a
+    // concurrent PollOnce()/Run() - register the streams up front.
+    void AddStream(const VkSharedBaseObj<VulkanVideoProcessor>& processor, Client* client);
+
+    // One non-blocking pass over the registered streams. Returns the number
+    // of streams still active; *pMadeProgress reports whether any stream
+    // dequeued or completed a frame, so callers can back off when idle.
+    uint32_t PollOnce(bool* pMadeProgress = nullptr);
+
+    // Drives PollOnce() on the calling thread until every registered stream
+    // has completed, sleeping briefly whenever a pass made no progress.
+    void Run();
+
+private:
+
+    struct StreamState {
+        VkSharedBaseObj<VulkanVideoProcessor> processor;
+        Client*      client;
+        DecodedFrame pendingFrame;   // valid while framePending
+        bool         framePending;   // a dequeued frame awaits its fence
+        bool         completed;
+    };
+
+    const VulkanDeviceContext* m_vkDevCtx;
+    std::vector<StreamState>   m_streams;
+};
+
+#endif /* _VKCODECUTILS_VULKANVIDEOFRAMEREACTOR_H_ */
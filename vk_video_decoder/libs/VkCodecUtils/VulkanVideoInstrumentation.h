@@ -0,0 +1,140 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VKCODECUTILS_VULKANVIDEOINSTRUMENTATION_H_
+#define _VKCODECUTILS_VULKANVIDEOINSTRUMENTATION_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+
+// Compile-time instrumentation levels for the decoder pipeline. The level is
+// selected at configure time with the VULKAN_VIDEO_INSTRUMENTATION_LEVEL CMake
+// cache variable and compiled in as VK_VIDEO_INSTRUMENTATION_LEVEL:
+//
+//   0 (off)      - the default. All probe macros below expand to ((void)0),
+//                  so production builds carry no instrumentation code at all.
+//   1 (counters) - cheap relaxed-atomic event counters at the probe points.
+//                  A summary is printed when the decoder is torn down.
+//   2 (trace)    - counters plus a per-event message stream on stderr,
+//                  replacing today's ad-hoc m_dumpDecodeData style prints
+//                  with a richer, always-consistent format.
+//
+// Probes are placed with the macros so that the surrounding code never pays
+// for a disabled level - not even a branch on a runtime flag.
+#define VK_VIDEO_INSTRUMENTATION_OFF      0
+#define VK_VIDEO_INSTRUMENTATION_COUNTERS 1
+#define VK_VIDEO_INSTRUMENTATION_TRACE    2
+
+#ifndef VK_VIDEO_INSTRUMENTATION_LEVEL
+#define VK_VIDEO_INSTRUMENTATION_LEVEL VK_VIDEO_INSTRUMENTATION_OFF
+#endif
+
+class VulkanVideoInstrumentation {
+
+public:
+    enum Counter {
+        DECODED_PICTURES = 0,   // pictures submitted for decode
+        BITSTREAM_BYTES,        // compressed bytes submitted for decode
+        CODEC_RESETS,           // VK_VIDEO_CODING_CONTROL_RESET_BIT_KHR issued
+        SESSION_CREATIONS,      // video session (re)creations
+        QUEUED_PICTURES,        // pictures queued to the frame buffer
+        DEQUEUED_PICTURES,      // pictures handed to the display/output path
+        NUM_COUNTERS
+    };
+
+    static constexpr int32_t Level() { return VK_VIDEO_INSTRUMENTATION_LEVEL; }
+
+    static constexpr bool CountersEnabled()
+    {
+        return Level() >= VK_VIDEO_INSTRUMENTATION_COUNTERS;
+    }
+
+    static constexpr bool TraceEnabled()
+    {
+        return Level() >= VK_VIDEO_INSTRUMENTATION_TRACE;
+    }
+
+    static void Count(Counter counter, uint64_t increment = 1)
+    {
+#if VK_VIDEO_INSTRUMENTATION_LEVEL >= VK_VIDEO_INSTRUMENTATION_COUNTERS
+        Counters()[counter].fetch_add(increment, std::memory_order_relaxed);
+#else
+        (void)counter;
+        (void)increment;
+#endif
+    }
+
+    static uint64_t GetCount(Counter counter)
+    {
+#if VK_VIDEO_INSTRUMENTATION_LEVEL >= VK_VIDEO_INSTRUMENTATION_COUNTERS
+        return Counters()[counter].load(std::memory_order_relaxed);
+#else
+        (void)counter;
+        return 0;
+#endif
+    }
+
+    // Prints the counter summary. A no-op when counters are compiled out, so
+    // callers do not need to guard the call themselves.
+    static void Report(std::ostream& outStr)
+    {
+#if VK_VIDEO_INSTRUMENTATION_LEVEL >= VK_VIDEO_INSTRUMENTATION_COUNTERS
+        outStr << "Instrumentation counters (level "
+               << VK_VIDEO_INSTRUMENTATION_LEVEL << "):" << std::endl;
+        outStr << "\tDecoded pictures:  " << GetCount(DECODED_PICTURES)  << std::endl;
+        outStr << "\tBitstream bytes:   " << GetCount(BITSTREAM_BYTES)   << std::endl;
+        outStr << "\tCodec resets:      " << GetCount(CODEC_RESETS)      << std::endl;
+        outStr << "\tSession creations: " << GetCount(SESSION_CREATIONS) << std::endl;
+        outStr << "\tQueued pictures:   " << GetCount(QUEUED_PICTURES)   << std::endl;
+        outStr << "\tDequeued pictures: " << GetCount(DEQUEUED_PICTURES) << std::endl;
+#else
+        (void)outStr;
+#endif
+    }
+
+#if VK_VIDEO_INSTRUMENTATION_LEVEL >= VK_VIDEO_INSTRUMENTATION_COUNTERS
+private:
+    // A function-local static keeps the header self-contained at C++11 (a
+    // static inline data member would require C++17) and still gives every
+    // translation unit the same zero-initialized counter instances.
+    static std::atomic<uint64_t>* Counters()
+    {
+        static std::atomic<uint64_t> counters[NUM_COUNTERS];
+        return counters;
+    }
+#endif
+};
+
+#if VK_VIDEO_INSTRUMENTATION_LEVEL >= VK_VIDEO_INSTRUMENTATION_COUNTERS
+#define VK_VIDEO_PROBE_COUNT(counter) \
+    VulkanVideoInstrumentation::Count(VulkanVideoInstrumentation::counter)
+#define VK_VIDEO_PROBE_COUNT_ADD(counter, increment) \
+    VulkanVideoInstrumentation::Count(VulkanVideoInstrumentation::counter, (uint64_t)(increment))
+#else
+#define VK_VIDEO_PROBE_COUNT(counter)                ((void)0)
+#define VK_VIDEO_PROBE_COUNT_ADD(counter, increment) ((void)0)
+#endif
+
+#if VK_VIDEO_INSTRUMENTATION_LEVEL >= VK_VIDEO_INSTRUMENTATION_TRACE
+#define VK_VIDEO_PROBE_TRACE(format, ...) \
+    fprintf(stderr, "TRACE: " format "\n", ##__VA_ARGS__)
+#else
+#define VK_VIDEO_PROBE_TRACE(format, ...) ((void)0)
+#endif
+
+#endif /* _VKCODECUTILS_VULKANVIDEOINSTRUMENTATION_H_ */
@@ -15,6 +15,7 @@
 */
 
 #include <assert.h>
+#include <chrono>
 #include <iostream>
 #include <mutex>
 #include <queue>
@@ -22,12 +23,20 @@
 #include <stdint.h>
 #include <string.h>
 #include <string>
+#include <thread>
 #include <vector>
 #include <fstream>
 
+#include "NvCodecUtils/H264HeaderScanner.h"
+#include "NvCodecUtils/TenBitPacker.h"
 #include "VkCodecUtils/Helpers.h"
+#include "VkCodecUtils/VulkanAllocationAudit.h"
 #include "VkCodecUtils/VulkanDeviceContext.h"
+#include "VkCodecUtils/VulkanMemoryBudget.h"
+#include "VkCodecUtils/VulkanParserServicePool.h"
+#include "VkCodecUtils/VulkanPerfCounters.h"
 #include "VkVideoCore/VulkanVideoCapabilities.h"
+#include "VkVideoDecoder/VkVideoDecoderPool.h"
 #include "VulkanVideoProcessor.h"
 #include "vulkan_interfaces.h"
 #include "nvidia_utils/vulkan/ycbcrvkinfo.h"
@@ -69,11 +78,20 @@ int32_t VulkanVideoProcessor::Initialize(const VulkanDeviceContext* vkDevCtx,
         return -1;
     }
 
+    // Decoder pooling (--decoderPool): park the previous stream's decoder
+    // and image pool before the stream teardown below releases them, so
+    // the next stream with a matching sequence gets them back.
+    if (m_enableDecoderPool && (m_vkDevCtx != nullptr)) {
+        VkVideoDecoderPool::GetInstance().Park(m_vkDevCtx, m_vkVideoDecoder, m_vkVideoFrameBuffer);
+    }
+
     Deinit();
 
     m_vkDevCtx = vkDevCtx;
 
-    CheckInputFile(filePath);
+    if (!VideoStreamDemuxer::IsStreamingInput(filePath)) {
+        CheckInputFile(filePath);
+    }
 
     VkResult result = VideoStreamDemuxer::Create(filePath,
                                                  forceCodecType,
@@ -81,6 +99,10 @@ int32_t VulkanVideoProcessor::Initialize(const VulkanDeviceContext* vkDevCtx,
                                                  defaultWidth,
                                                  defaultHeight,
                                                  defaultBitDepth,
+                                                 (programConfig.enableFastStartProbing == 1),
+                                                 programConfig.demuxReadAheadDepth,
+                                                 (size_t)programConfig.esChunkSizeKb * 1024,
+                                                 (size_t)programConfig.esReadAheadSizeKb * 1024,
                                                  m_videoStreamDemuxer);
 
     if (result != VK_SUCCESS) {
@@ -94,10 +116,64 @@ int32_t VulkanVideoProcessor::Initialize(const VulkanDeviceContext* vkDevCtx,
         m_videoStreamDemuxer->DumpStreamParameters();
     }
 
-    result =  VulkanVideoFrameBuffer::Create(vkDevCtx, m_vkVideoFrameBuffer);
-    assert(result == VK_SUCCESS);
-    if (result != VK_SUCCESS) {
-        fprintf(stderr, "\nERROR: Create VulkanVideoFrameBuffer result: 0x%x\n", result);
+    if (programConfig.enableStreamHeaderScan) {
+        ScanStreamHeaders();
+    }
+
+    // Decoder pooling (--decoderPool): a parked decoder whose configured
+    // sequence matches the new stream skips the session and image pool
+    // setup below; if the parsed sequence then differs after all, the
+    // regular StartVideoSequence() reconfiguration takes over.
+    m_enableDecoderPool = programConfig.enableDecoderPool;
+    m_enableBatchedFrameRelease = programConfig.enableBatchedFrameRelease;
+    m_enablePerfCounters = false;
+    if (!programConfig.perfCountersFile.empty()) {
+        m_enablePerfCounters = VulkanPerfCounters::Get().StartExport(programConfig.perfCountersFile,
+                                                                     programConfig.perfCountersPeriodMs);
+    }
+    m_enableMemoryDeltaReport = programConfig.enableMemoryDeltaReport;
+    if (m_enableMemoryDeltaReport) {
+        // The first loop's growth is measured against the pools as they
+        // stand before any of this stream's allocations.
+        VulkanMemoryBudget::MarkRestartBaseline();
+    }
+    m_enablePacked10BitOutput = programConfig.enablePacked10BitOutput;
+    m_enableP010Output = programConfig.enableP010Output;
+    m_enableErrorResilience = programConfig.enableErrorResilience;
+    // Demux watermark throttle (--parseAheadHighWatermark): an unset low
+    // mark defaults to half the high mark, and a low mark at or above the
+    // high mark would never unpause, so it is pulled below it.
+    m_parseAheadHighWatermarkFrames = std::max(programConfig.parseAheadHighWatermark, 0);
+    m_parseAheadLowWatermarkFrames = programConfig.parseAheadLowWatermark;
+    if (m_parseAheadHighWatermarkFrames > 0) {
+        if (m_parseAheadLowWatermarkFrames <= 0) {
+            m_parseAheadLowWatermarkFrames = std::max(m_parseAheadHighWatermarkFrames / 2, 1);
+        }
+        if (m_parseAheadLowWatermarkFrames >= m_parseAheadHighWatermarkFrames) {
+            m_parseAheadLowWatermarkFrames = m_parseAheadHighWatermarkFrames - 1;
+        }
+    }
+    m_demuxThrottled = false;
+    bool reusingPooledDecoder = false;
+    if (m_enableDecoderPool) {
+        VkVideoCoreProfile pooledVideoProfile(m_videoStreamDemuxer->GetVideoCodec(),
+                                              m_videoStreamDemuxer->GetChromaSubsampling(),
+                                              m_videoStreamDemuxer->GetLumaBitDepth(),
+                                              m_videoStreamDemuxer->GetChromaBitDepth(),
+                                              m_videoStreamDemuxer->GetProfileIdc());
+        reusingPooledDecoder = VkVideoDecoderPool::GetInstance().Acquire(vkDevCtx, pooledVideoProfile,
+                                                                         m_videoStreamDemuxer->GetWidth(),
+                                                                         m_videoStreamDemuxer->GetHeight(),
+                                                                         m_vkVideoDecoder,
+                                                                         m_vkVideoFrameBuffer);
+    }
+
+    if (!reusingPooledDecoder) {
+        result =  VulkanVideoFrameBuffer::Create(vkDevCtx, m_vkVideoFrameBuffer);
+        assert(result == VK_SUCCESS);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nERROR: Create VulkanVideoFrameBuffer result: 0x%x\n", result);
+        }
     }
 
     FILE* outFile = m_frameToFile.AttachFile(outputFileName);
@@ -106,17 +182,52 @@ int32_t VulkanVideoProcessor::Initialize(const VulkanDeviceContext* vkDevCtx,
         return -1;
     }
 
-    result = VkVideoDecoder::Create(vkDevCtx, m_vkVideoFrameBuffer,
-                                    videoQueueIndx, (outFile != nullptr),
-                                    numDecodeImagesInFlight,
-                                    numDecodeImagesToPreallocate,
-                                    numBitstreamBuffersToPreallocate,
-                                    m_vkVideoDecoder);
-    assert(result == VK_SUCCESS);
-    if (result != VK_SUCCESS) {
-        fprintf(stderr, "\nERROR: Create VkVideoDecoder result: 0x%x\n", result);
+    if ((outFile != nullptr) && programConfig.enableAsyncOutputToFile) {
+        if (!m_frameToFile.StartAsyncWriter(2, programConfig.outputThreadCpuSet)) {
+            fprintf(stderr, "Error starting the async output writer for %s", outputFileName);
+            return -1;
+        }
     }
 
+    if ((outFile != nullptr) && programConfig.enableMappedOutputToFile) {
+        if (programConfig.enableAsyncOutputToFile) {
+            fprintf(stderr, "Warning: --mappedOutput is ignored when --asyncOutput is enabled\n");
+        } else if (!m_frameToFile.StartMappedWriter()) {
+            fprintf(stderr, "Warning: mapped output is not supported on this platform, "
+                            "using buffered writes for %s\n", outputFileName);
+        }
+    }
+
+    if ((outFile != nullptr) && (programConfig.scaledOutputWidth > 0) && (programConfig.scaledOutputHeight > 0)) {
+        VkResult scalerResult = VulkanFrameScaler::Create(vkDevCtx, m_frameScaler);
+        if (scalerResult != VK_SUCCESS) {
+            fprintf(stderr, "\nERROR: Create VulkanFrameScaler result: 0x%x\n", scalerResult);
+            return -1;
+        }
+        m_scaledOutputWidth = (uint32_t)programConfig.scaledOutputWidth;
+        m_scaledOutputHeight = (uint32_t)programConfig.scaledOutputHeight;
+        m_scaledOutputCrop.offset.x = programConfig.scaledOutputCropX;
+        m_scaledOutputCrop.offset.y = programConfig.scaledOutputCropY;
+        m_scaledOutputCrop.extent.width = (uint32_t)programConfig.scaledOutputCropWidth;
+        m_scaledOutputCrop.extent.height = (uint32_t)programConfig.scaledOutputCropHeight;
+    }
+
+    if (!reusingPooledDecoder) {
+        result = VkVideoDecoder::Create(vkDevCtx, m_vkVideoFrameBuffer,
+                                        videoQueueIndx, (outFile != nullptr),
+                                        (programConfig.enableRealtimeDecodeQos != 0),
+                                        numDecodeImagesInFlight,
+                                        numDecodeImagesToPreallocate,
+                                        numBitstreamBuffersToPreallocate,
+                                        m_vkVideoDecoder);
+        assert(result == VK_SUCCESS);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nERROR: Create VkVideoDecoder result: 0x%x\n", result);
+        }
+    }
+
+    ApplyDecoderConfiguration(programConfig);
+
     VkVideoCoreProfile videoProfile(m_videoStreamDemuxer->GetVideoCodec(),
                                     m_videoStreamDemuxer->GetChromaSubsampling(),
                                     m_videoStreamDemuxer->GetLumaBitDepth(),
@@ -144,6 +255,27 @@ int32_t VulkanVideoProcessor::Initialize(const VulkanDeviceContext* vkDevCtx,
     }
 
     const uint32_t defaultMinBufferSize = 2 * 1024 * 1024; // 2MB
+
+    if (programConfig.enableZeroCopyDemux && (m_usesFramePreparser || m_usesStreamDemuxer)) {
+        // Let the demuxer write compressed data directly into a persistently
+        // mapped host-visible buffer, instead of bouncing each demuxed frame
+        // through an intermediate host allocation.
+        VkSharedBaseObj<VulkanBitstreamBufferImpl> bitstreamIngestBuffer;
+        result = VulkanBitstreamBufferImpl::Create(vkDevCtx,
+                                                   vkDevCtx->GetVideoDecodeQueueFamilyIdx(),
+                                                   defaultMinBufferSize,
+                                                   videoCapabilities.minBitstreamBufferOffsetAlignment,
+                                                   videoCapabilities.minBitstreamBufferSizeAlignment,
+                                                   nullptr, 0,
+                                                   bitstreamIngestBuffer);
+        assert(result == VK_SUCCESS);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nERROR: Create bitstream ingest buffer result: 0x%x\n", result);
+            return -result;
+        }
+        m_bitstreamIngestBuffer = bitstreamIngestBuffer;
+    }
+
     result = CreateParser(filePath,
                           m_videoStreamDemuxer->GetVideoCodec(),
                           defaultMinBufferSize,
@@ -154,10 +286,78 @@ int32_t VulkanVideoProcessor::Initialize(const VulkanDeviceContext* vkDevCtx,
         fprintf(stderr, "\nERROR: CreateParser() result: 0x%x\n", result);
     }
 
+    if ((result == VK_SUCCESS) && (programConfig.decodeDecimateRatio > 1)) {
+        m_vkParser->SetDecodeDecimation((uint32_t)programConfig.decodeDecimateRatio);
+    }
+
+    if ((result == VK_SUCCESS) &&
+            (programConfig.decodeImageLayoutMode == ProgramConfig::DecodeImageLayoutAutoBenchmark)) {
+        if (reusingPooledDecoder) {
+            fprintf(stderr, "Warning: --decodeImageLayout auto is ignored when a pooled decoder is reused\n");
+        } else if (VideoStreamDemuxer::IsStreamingInput(filePath)) {
+            fprintf(stderr, "Warning: --decodeImageLayout auto needs a rewindable input - "
+                            "keeping the default image layout\n");
+        } else if (BenchmarkDecodeImageLayouts(programConfig, filePath,
+                                               defaultMinBufferSize,
+                                               (uint32_t)videoCapabilities.minBitstreamBufferOffsetAlignment,
+                                               (uint32_t)videoCapabilities.minBitstreamBufferSizeAlignment,
+                                               (outFile != nullptr)) != 0) {
+            return -1;
+        }
+    }
+
     m_loopCount = loopCount;
     m_startFrame = startFrame;
     m_maxFrameCount =  maxFrameCount;
 
+    // Loop iterations reuse the probed demuxer and the decoder session, so
+    // every iteration after the first runs warm (see ReportLoopIterationFps()).
+    m_loopIterationIndex = 0;
+    m_loopIterationStartTimeNs = GetCurrentTimeNanoseconds();
+    m_steadyStateFrameCount = 0;
+    m_steadyStateTimeNs = 0;
+
+    m_seekStartTimeNs = (int64_t)(programConfig.startTime * 1e9);
+    if ((m_seekStartTimeNs > 0) && !m_videoStreamDemuxer->SeekToTimestamp(m_seekStartTimeNs)) {
+        std::cout << "The demuxer cannot seek in this stream - decoding from the start" << std::endl;
+        m_seekStartTimeNs = 0;
+    }
+    m_stopTimeNs = (int64_t)(programConfig.stopTime * 1e9);
+    m_alignStartTimeToNextKeyFrame = (programConfig.alignStartTimeToNextKeyFrame == 1);
+    // The seek above lands on the keyframe preceding the start time; in
+    // segment mode that GOP tail belongs to the previous segment's engine,
+    // so skip forward to the first keyframe at or after the start time.
+    m_awaitingSegmentStartKeyFrame = ((m_seekStartTimeNs > 0) && m_alignStartTimeToNextKeyFrame);
+
+    m_frameLatencyTraceFile = programConfig.frameLatencyTraceFile;
+    if (IsFrameLatencyTraceEnabled()) {
+        m_frameLatencyTrace.clear();
+        m_frameLatencyTrace.reserve(4096);
+    }
+
+    m_transcodeBenchmarkJsonFile = programConfig.transcodeBenchmarkJsonFile;
+
+    m_parserThreadCpuSet = programConfig.parserThreadCpuSet;
+
+    if (programConfig.parserWorkerCount > 0) {
+        // Shared parser service (--parserWorkers): the process-wide worker
+        // pool runs this stream's parse quanta instead of a dedicated
+        // per-stream thread (see VulkanParserServicePool).
+        if (!VulkanParserServicePool::Get().Start(programConfig.parserWorkerCount,
+                                                  programConfig.parserThreadCpuSet)) {
+            fprintf(stderr, "Error starting the parser worker pool\n");
+            return -1;
+        }
+        m_parsedChunksAhead = 0;
+        m_useParserService = true;
+        VulkanParserServicePool::Get().Schedule(this);
+    } else if (programConfig.enablePipelinedParsing) {
+        if (!StartParserThread()) {
+            fprintf(stderr, "Error starting the pipelined parser thread\n");
+            return -1;
+        }
+    }
+
     return 0;
 }
 
@@ -218,10 +418,52 @@ int32_t VulkanVideoProcessor::GetBitDepth()
     return m_videoStreamDemuxer->GetBitDepth();
 }
 
+int64_t VulkanVideoProcessor::GetStreamDurationNs()
+{
+    if (!m_videoStreamDemuxer) {
+        return -1;
+    }
+    return m_videoStreamDemuxer->GetStreamDurationNs();
+}
+
 void VulkanVideoProcessor::Deinit()
 {
+    StopParserThread();
+
+    DumpFrameLatencyTrace();
+    DumpTranscodeBenchmarkJson();
+
+    if (m_enablePerfCounters) {
+        // The final sample with the totals of the run stays behind.
+        VulkanPerfCounters::Get().StopExport();
+        m_enablePerfCounters = false;
+    }
+
+    if (VulkanAllocationAudit::Enabled()) {
+        VulkanAllocationAudit::Report(std::cout);
+    }
+
+    if (m_vkVideoFrameBuffer) {
+        FlushPendingFrameReleases();
+    }
 
     m_vkParser = nullptr;
+    m_bitstreamIngestBuffer = nullptr;
+
+    if (m_vkVideoDecoder) {
+        m_vkVideoDecoder->ReportGpuFrameChecksums(std::cout);
+        m_vkVideoDecoder->ReportGpuFrameAnalysis(std::cout);
+
+        VkVideoDecoder::DecodeGpuTimeStats gpuTimeStats;
+        if (m_vkVideoDecoder->GetDecodeGpuTimeStats(gpuTimeStats)) {
+            std::cout << "GPU decode time over " << gpuTimeStats.measuredFrameCount << " frames:" << std::endl
+                      << "\taverage: " << gpuTimeStats.averageFrameTimeMs << " ms" << std::endl
+                      << "\tmin:     " << gpuTimeStats.minFrameTimeMs << " ms" << std::endl
+                      << "\tmax:     " << gpuTimeStats.maxFrameTimeMs << " ms" << std::endl;
+        }
+    }
+
+    m_frameScaler = nullptr;
     m_vkVideoDecoder = nullptr;
     m_vkVideoFrameBuffer = nullptr;
     m_videoStreamDemuxer = nullptr;
@@ -369,11 +611,21 @@ size_t VulkanVideoProcessor::ConvertFrameToNv12(DecodedFrame* pFrame,
     VkSharedBaseObj<VulkanDeviceMemoryImpl> srcImageDeviceMemory(imageResource->GetMemory());
 
     const VkMpFormatInfo* mpInfo = YcbcrVkFormatInfo(format);
-    assert(pFrame->frameCompleteFence != VK_NULL_HANDLE);
+    assert((pFrame->frameCompleteFence != VK_NULL_HANDLE) ||
+           (pFrame->frameCompleteTimelineSemaphore != VK_NULL_HANDLE));
     const uint64_t fenceTimeout = 100 * 1000 * 1000 /* 100 mSec */;
     int32_t retryCount = 5;
     do {
-        result = m_vkDevCtx->WaitForFences(device, 1, &pFrame->frameCompleteFence, VK_TRUE, fenceTimeout);
+        if (pFrame->frameCompleteTimelineSemaphore != VK_NULL_HANDLE) {
+            // Timeline mode - wait for the frame's counter on the session
+            // timeline semaphore instead of the per-picture fence.
+            const VkSemaphoreWaitInfoKHR semaphoreWaitInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR, nullptr, 0,
+                                                               1, &pFrame->frameCompleteTimelineSemaphore,
+                                                               &pFrame->frameCompleteTimelineValue };
+            result = m_vkDevCtx->WaitSemaphoresKHR(device, &semaphoreWaitInfo, fenceTimeout);
+        } else {
+            result = m_vkDevCtx->WaitForFences(device, 1, &pFrame->frameCompleteFence, VK_TRUE, fenceTimeout);
+        }
         if (result != VK_SUCCESS) {
             std::cout << "WaitForFences timeout " << fenceTimeout
                     << " result " << result << " retry " << retryCount << std::endl << std::flush;
@@ -387,6 +639,12 @@ size_t VulkanVideoProcessor::ConvertFrameToNv12(DecodedFrame* pFrame,
                                                                maxSize);
     assert(readImagePtr != nullptr);
 
+    // One batched invalidate for the whole frame - a no-op on coherent
+    // memory types. This makes the decoded data visible to the host-cached
+    // mapping, so the row copies below read at cached speed instead of
+    // being bound by uncached read bandwidth.
+    srcImageDeviceMemory->InvalidateRange(imageResource->GetImageDeviceMemoryOffset(), maxSize);
+
     int secondaryPlaneHeight = pFrame->displayHeight;
     int imageHeight = pFrame->displayHeight;
     bool isUnnormalizedRgba = false;
@@ -506,6 +764,42 @@ size_t VulkanVideoProcessor::OutputFrameToFile(DecodedFrame* pFrame)
     assert(!!pFrame->outputImageView);
     assert(pFrame->pictureIndex != -1);
 
+    if (m_frameScaler) {
+        // Scaled output: downsample the decoded (optimal, sampled) image on
+        // the GPU and write the NV12 thumbnail; the full-resolution linear
+        // readback below is skipped entirely. Falls back to the
+        // full-resolution path when the scaler cannot handle the format.
+        VkSharedBaseObj<VkImageResource> decodedImageResource = pFrame->decodedImageView->GetImageResource();
+        const VkImageCreateInfo& decodedImageCreateInfo = decodedImageResource->GetImageCreateInfo();
+        VkResult scalerResult = m_frameScaler->Initialize(decodedImageCreateInfo.format,
+                                                          m_scaledOutputWidth, m_scaledOutputHeight);
+        if (scalerResult == VK_SUCCESS) {
+            VkRect2D cropRect = m_scaledOutputCrop;
+            if ((cropRect.extent.width == 0) || (cropRect.extent.height == 0)) {
+                cropRect.offset.x = 0;
+                cropRect.offset.y = 0;
+                cropRect.extent.width = (uint32_t)pFrame->displayWidth;
+                cropRect.extent.height = (uint32_t)pFrame->displayHeight;
+            }
+            const VkExtent2D texExtent = { decodedImageCreateInfo.extent.width,
+                                           decodedImageCreateInfo.extent.height };
+            scalerResult = m_frameScaler->ScaleFrame(decodedImageResource->GetImage(),
+                                                     texExtent, cropRect,
+                                                     VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR,
+                                                     pFrame->frameCompleteFence);
+        }
+        if (scalerResult == VK_SUCCESS) {
+            VkSharedBaseObj<VkImageResource> outputImageResource = pFrame->outputImageView->GetImageResource();
+            uint8_t* pScaledMemory = m_frameToFile.EnsureAllocation(m_vkDevCtx, outputImageResource);
+            assert(pScaledMemory != nullptr);
+            size_t scaledSize = m_frameScaler->CopyScaledFrameToNv12(pScaledMemory,
+                                                                     m_frameToFile.GetMaxFrameSize());
+            if (scaledSize != 0) {
+                return m_frameToFile.WriteDataToFile(0, scaledSize);
+            }
+        }
+    }
+
     VkSharedBaseObj<VkImageResource> imageResource = pFrame->outputImageView->GetImageResource();
     uint8_t* pLinearMemory = m_frameToFile.EnsureAllocation(m_vkDevCtx, imageResource);
     assert(pLinearMemory != nullptr);
@@ -513,25 +807,111 @@ size_t VulkanVideoProcessor::OutputFrameToFile(DecodedFrame* pFrame)
     // Needed allocation size can shrink, but may never grow. Frames will be allocated for maximum resolution upfront.
     assert((pFrame->displayWidth >= 0) && (pFrame->displayHeight >= 0));
 
+    const bool transcodeBenchmark = IsTranscodeBenchmarkEnabled();
+    uint64_t stageStartTimeNs = transcodeBenchmark ? GetCurrentTimeNanoseconds() : 0;
+
     // Convert frame to linear image format.
     size_t usedBufferSize = ConvertFrameToNv12(pFrame,
                                                imageResource,
                                                pLinearMemory,
                                                m_frameToFile.GetMaxFrameSize());
 
+    if (m_enablePacked10BitOutput || m_enableP010Output) {
+        // Optional 10-bit output transforms (see NvCodecUtils/TenBitPacker.h).
+        // ConvertFrameToNv12() reads >8bpc content back as MSB-aligned 16-bit
+        // words; either pack them to tight 10-bit groups - in place, the
+        // packed stream is strictly shorter - or zero the fractional LSBs so
+        // the file is canonical P010. 8-bit content passes through untouched.
+        const VkMpFormatInfo* mpInfo = YcbcrVkFormatInfo(imageResource->GetImageCreateInfo().format);
+        if ((mpInfo != nullptr) && (mpInfo->planesLayout.bpp != YCBCRA_8BPP)) {
+            uint16_t* pSamples = reinterpret_cast<uint16_t*>(pLinearMemory);
+            const size_t numSamples = usedBufferSize / sizeof(uint16_t);
+            if (m_enablePacked10BitOutput) {
+                usedBufferSize = PackMsb16SamplesTo10Bit(pSamples, numSamples, pLinearMemory);
+            } else {
+                ConvertMsb16SamplesToP010(pSamples, numSamples);
+            }
+        }
+    }
+
+    if (transcodeBenchmark) {
+        const uint64_t convertDoneTimeNs = GetCurrentTimeNanoseconds();
+        m_transcodeBenchmark.AddStageSample(TranscodeBenchmark::STAGE_CONVERT,
+                                            convertDoneTimeNs - stageStartTimeNs);
+        stageStartTimeNs = convertDoneTimeNs;
+    }
+
     // Write image to file.
-    return m_frameToFile.WriteDataToFile(0, usedBufferSize);
+    size_t writtenBytes = m_frameToFile.WriteDataToFile(0, usedBufferSize);
+
+    if (transcodeBenchmark) {
+        m_transcodeBenchmark.AddStageSample(TranscodeBenchmark::STAGE_WRITEBACK,
+                                            GetCurrentTimeNanoseconds() - stageStartTimeNs);
+    }
+
+    return writtenBytes;
 }
 
 void VulkanVideoProcessor::Restart(void)
 {
-    m_videoStreamDemuxer->Rewind();
+    // No surface may remain owned by the display across the rewind.
+    FlushPendingFrameReleases();
+
+    if (m_enableMemoryDeltaReport) {
+        // Attribute any accretion to its pool while the iteration boundary
+        // is exact - everything still live here survives into the next loop.
+        VulkanMemoryBudget::DumpRestartDelta(std::cout);
+    }
+
+    // With --startTime every loop re-enters the stream at the keyframe
+    // preceding the requested start position, not at the very beginning.
+    if ((m_seekStartTimeNs <= 0) || !m_videoStreamDemuxer->SeekToTimestamp(m_seekStartTimeNs)) {
+        m_videoStreamDemuxer->Rewind();
+    } else {
+        m_awaitingSegmentStartKeyFrame = m_alignStartTimeToNextKeyFrame;
+    }
     m_videoFrameNum = false;
     m_currentBitstreamOffset = 0;
 }
 
+void VulkanVideoProcessor::ReportLoopIterationFps()
+{
+    if ((m_loopCount <= 1) && (m_loopIterationIndex == 0)) {
+        // Not looping - the regular end-of-stream reporting covers the run.
+        return;
+    }
+
+    const uint64_t iterationEndTimeNs = GetCurrentTimeNanoseconds();
+    const uint64_t iterationTimeNs = iterationEndTimeNs - m_loopIterationStartTimeNs;
+    const double iterationFps = (iterationTimeNs > 0) ?
+            ((double)m_videoFrameNum * 1e9) / (double)iterationTimeNs : 0.0;
+    std::cout << "Loop iteration " << (m_loopIterationIndex + 1) << ": "
+              << m_videoFrameNum << " frames in " << (iterationTimeNs / 1000000) << " ms, "
+              << iterationFps << " FPS"
+              << ((m_loopIterationIndex == 0) ? " (cold start)" : "") << std::endl;
+
+    if (m_loopIterationIndex > 0) {
+        // The first iteration pays the probing and allocation cost; the warm
+        // iterations aggregate to the steady-state number below.
+        m_steadyStateFrameCount += m_videoFrameNum;
+        m_steadyStateTimeNs += iterationTimeNs;
+    }
+    m_loopIterationIndex++;
+    m_loopIterationStartTimeNs = iterationEndTimeNs;
+
+    // Called before StreamCompleted() consumes the loop, so 1 means this was
+    // the last iteration.
+    if ((m_loopCount == 1) && (m_steadyStateTimeNs > 0)) {
+        const double steadyStateFps = ((double)m_steadyStateFrameCount * 1e9) / (double)m_steadyStateTimeNs;
+        std::cout << "Steady-state: " << m_steadyStateFrameCount << " frames over "
+                  << (m_loopIterationIndex - 1) << " warm iterations, "
+                  << steadyStateFps << " FPS" << std::endl;
+    }
+}
+
 bool VulkanVideoProcessor::StreamCompleted()
 {
+    ReportLoopIterationFps();
     if (--m_loopCount > 0) {
         std::cout << "Restarting video stream with loop number " << (m_loopCount + 1) << std::endl;
         // Reload the file stream
@@ -549,30 +929,119 @@ int32_t VulkanVideoProcessor::ParserProcessNextDataChunk()
         return -1;
     }
 
+    // Watermark throttle on the demux/parse run-ahead
+    // (--parseAheadHighWatermark): once the decoded backlog the consumer has
+    // not drained yet reaches the high mark, the chunk performs no demux or
+    // parse work until the backlog falls to the low mark. This keeps the
+    // compressed-data buffering flat on fast storage and makes a
+    // stream-switch abort near-instant, since at most a high mark's worth
+    // of frames is ever committed. The hysteresis avoids oscillating around
+    // a single threshold chunk by chunk.
+    if (m_parseAheadHighWatermarkFrames > 0) {
+        const int32_t pendingFrames = m_vkVideoFrameBuffer->GetDisplayQueuePendingFrameCount();
+        if (m_demuxThrottled) {
+            if (pendingFrames <= m_parseAheadLowWatermarkFrames) {
+                m_demuxThrottled = false;
+            }
+        } else if (pendingFrames >= m_parseAheadHighWatermarkFrames) {
+            m_demuxThrottled = true;
+        }
+        if (m_demuxThrottled) {
+            // Let the consumer drain before the next attempt, so a dedicated
+            // parser thread does not spin on the backlog check.
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            return 0;
+        }
+    }
+
+    // The chunk runs demux, parse and decode submission back to back - the
+    // allocation audit tag is advanced at each hand-off below.
+    VK_VIDEO_ALLOC_AUDIT_SCOPE(STAGE_DEMUX);
+
     int32_t retValue = 0;
     int64_t bitstreamChunkSize = 0;
     size_t  bitstreamBytesConsumed = 0;
     const uint8_t* pBitstreamData = nullptr;
     bool requiresPartialParsing = false;
+    const bool transcodeBenchmark = IsTranscodeBenchmarkEnabled();
+    const uint64_t demuxStartTimeNs = transcodeBenchmark ? GetCurrentTimeNanoseconds() : 0;
     if (m_usesFramePreparser || m_usesStreamDemuxer) {
-        bitstreamChunkSize = m_videoStreamDemuxer->DemuxFrame(&pBitstreamData);
+        auto demuxNextFrame = [this, &pBitstreamData]() -> int64_t {
+            if (m_bitstreamIngestBuffer) {
+                return m_videoStreamDemuxer->DemuxFrameIntoBuffer(m_bitstreamIngestBuffer,
+                                                                  0, &pBitstreamData);
+            }
+            return m_videoStreamDemuxer->DemuxFrame(&pBitstreamData);
+        };
+        bitstreamChunkSize = demuxNextFrame();
+        // Keyframe-aligned segment handling: skip the demuxed frames before
+        // the first keyframe at or after the segment start, and end the
+        // stream at the first keyframe at or after the stop time.
+        while ((bitstreamChunkSize > 0) && m_awaitingSegmentStartKeyFrame) {
+            if (m_videoStreamDemuxer->IsLastPacketKeyFrame() &&
+                    (m_videoStreamDemuxer->GetLastPacketPtsNs() >= m_seekStartTimeNs)) {
+                m_awaitingSegmentStartKeyFrame = false;
+                break;
+            }
+            bitstreamChunkSize = demuxNextFrame();
+        }
+        if ((bitstreamChunkSize > 0) && (m_stopTimeNs > 0) &&
+                m_videoStreamDemuxer->IsLastPacketKeyFrame() &&
+                (m_videoStreamDemuxer->GetLastPacketPtsNs() >= m_stopTimeNs)) {
+            bitstreamChunkSize = 0;
+            pBitstreamData = nullptr;
+        }
         assert(bitstreamBytesConsumed <= (size_t)std::numeric_limits<int32_t>::max());
         retValue = (int32_t)bitstreamChunkSize;
     } else {
         bitstreamChunkSize = m_videoStreamDemuxer->ReadBitstreamData(&pBitstreamData, m_currentBitstreamOffset);
         requiresPartialParsing = true;
     }
+
+    if (transcodeBenchmark) {
+        m_transcodeBenchmark.AddStageSample(TranscodeBenchmark::STAGE_DEMUX,
+                                            GetCurrentTimeNanoseconds() - demuxStartTimeNs);
+    }
+
+    if (IsFrameLatencyTraceEnabled()) {
+        // Stamp before the parse below: every picture queued for decode out
+        // of this chunk inherits the demux-done time of the chunk.
+        m_vkVideoFrameBuffer->SetLastDemuxDoneTimeNs(GetCurrentTimeNanoseconds());
+    }
+
+    VK_VIDEO_ALLOC_AUDIT_STAGE(STAGE_PARSE);
+
     const bool bitstreamHasMoreData = ((bitstreamChunkSize > 0) && (pBitstreamData != nullptr));
     if (bitstreamHasMoreData) {
+        if (m_enablePerfCounters) {
+            VulkanPerfCounters::Get().Add(VulkanPerfCounters::FRAMES_DEMUXED);
+            VulkanPerfCounters::Get().Add(VulkanPerfCounters::BYTES_IN, (uint64_t)bitstreamChunkSize);
+        }
+        // Tag the packet with the demuxed presentation timestamp (in
+        // nanoseconds), so it comes back on the DecodedFrame in display
+        // order and deadline-aware display (see
+        // VulkanFrame::ApplyDisplayDeadlinePolicy()) can pace against it.
+        // Elementary streams report no PTS; the packet then stays untagged.
+        const int64_t lastPacketPtsNs = (m_usesStreamDemuxer || m_usesFramePreparser) ?
+                                                m_videoStreamDemuxer->GetLastPacketPtsNs() : -1;
+        const uint64_t parseStartTimeNs = transcodeBenchmark ? GetCurrentTimeNanoseconds() : 0;
         VkResult parserStatus = ParseVideoStreamData(pBitstreamData, bitstreamChunkSize,
                                                      &bitstreamBytesConsumed,
-                                                     requiresPartialParsing);
+                                                     requiresPartialParsing,
+                                                     0, (lastPacketPtsNs > 0) ? lastPacketPtsNs : 0);
+        if (transcodeBenchmark) {
+            m_transcodeBenchmark.AddStageSample(TranscodeBenchmark::STAGE_PARSE,
+                                                GetCurrentTimeNanoseconds() - parseStartTimeNs);
+        }
         if (parserStatus != VK_SUCCESS) {
             m_videoStreamsCompleted = true;
             std::cerr << "Parser: end of Video Stream with status  " << parserStatus << std::endl;
             retValue = -1;
         } else {
             retValue = (int32_t)bitstreamBytesConsumed;
+            if (m_enablePerfCounters) {
+                VulkanPerfCounters::Get().Add(VulkanPerfCounters::FRAMES_PARSED);
+            }
         }
         assert(bitstreamBytesConsumed <= (size_t)std::numeric_limits<int32_t>::max());
         m_currentBitstreamOffset += bitstreamBytesConsumed;
@@ -583,40 +1052,339 @@ int32_t VulkanVideoProcessor::ParserProcessNextDataChunk()
         retValue = 0;
     }
 
+    // Submit any decode work the batching mode is still holding back, before
+    // the consumer starts waiting on the frames produced by this chunk.
+    VK_VIDEO_ALLOC_AUDIT_STAGE(STAGE_DECODE);
+    m_vkVideoDecoder->FlushPendingSubmits();
+
     return retValue;
 }
 
+void VulkanVideoProcessor::ScanStreamHeaders()
+{
+    if (m_usesStreamDemuxer ||
+            (m_videoStreamDemuxer->GetVideoCodec() != VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR)) {
+        fprintf(stderr, "The lightweight header scan supports H.264 elementary streams only "
+                        "(container inputs carry their own keyframe index)\n");
+        return;
+    }
+
+    H264HeaderScanner scanner;
+    size_t numNalUnits = 0;
+    size_t numPictures = 0;
+    size_t numIdrPictures = 0;
+    size_t numReferencePictures = 0;
+
+    const uint64_t scanStartTimeNs = GetCurrentTimeNanoseconds();
+
+    // The elementary stream's ReadBitstreamData() is a stateless window
+    // into the mapping, so walking it here does not disturb the decode
+    // pass that follows.
+    int64_t offset = 0;
+    const uint8_t* pBitstreamData = nullptr;
+    int64_t chunkSize = m_videoStreamDemuxer->ReadBitstreamData(&pBitstreamData, offset);
+    while (chunkSize > 0) {
+        numNalUnits += scanner.ScanAnnexBBuffer(pBitstreamData, (size_t)chunkSize, (size_t)offset,
+            [&](size_t pictureOffset, const H264NalScanInfo& scanInfo) {
+                (void)pictureOffset;
+                numPictures++;
+                if (scanInfo.isIdr) {
+                    numIdrPictures++;
+                }
+                if (scanInfo.isReference) {
+                    numReferencePictures++;
+                }
+            });
+        offset += chunkSize;
+        chunkSize = m_videoStreamDemuxer->ReadBitstreamData(&pBitstreamData, offset);
+    }
+
+    const uint64_t scanTimeNs = GetCurrentTimeNanoseconds() - scanStartTimeNs;
+    const double scanTimeMs = (double)scanTimeNs / 1e6;
+    const double scanRateMBs = (scanTimeNs > 0) ?
+            (((double)offset * 1e9) / ((double)scanTimeNs * 1024.0 * 1024.0)) : 0.0;
+    std::cout << "Stream header scan: " << numNalUnits << " NAL units, "
+              << numPictures << " pictures (" << numIdrPictures << " IDR, "
+              << numReferencePictures << " reference) in "
+              << scanTimeMs << " ms (" << scanRateMBs << " MB/s)" << std::endl;
+}
+
+bool VulkanVideoProcessor::StartParserThread()
+{
+    if (IsParserThreadEnabled()) {
+        return true;
+    }
+
+    m_parsedChunksAhead = 0;
+    m_exitParserThread = false;
+    m_parserThread = std::thread(&VulkanVideoProcessor::ParserThreadProc, this);
+    return m_parserThread.joinable();
+}
+
+void VulkanVideoProcessor::StopParserThread()
+{
+    if (m_useParserService) {
+        // Shared worker pool mode - detach the stream from the pool instead
+        // of joining a dedicated thread. The pool itself stays up for the
+        // other streams.
+        VulkanParserServicePool::Get().Unregister(this);
+        m_useParserService = false;
+        return;
+    }
+
+    if (!IsParserThreadEnabled()) {
+        return;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(m_parserMutex);
+        m_exitParserThread = true;
+        m_parserWakeCond.notify_all();
+    }
+    m_parserThread.join();
+}
+
+void VulkanVideoProcessor::ParserThreadProc()
+{
+    VulkanThreadAffinity::PinCurrentThread(m_parserThreadCpuSet, "parser");
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_parserMutex);
+            m_parserWakeCond.wait(lock, [this] {
+                return (m_parsedChunksAhead < MAX_PARSED_CHUNKS_AHEAD) || m_exitParserThread;
+            });
+            if (m_exitParserThread) {
+                break;
+            }
+        }
+
+        // Runs the demux, the CPU parse and the decode submission of one
+        // chunk, while the consumer thread processes already decoded frames.
+        ParserProcessNextDataChunk();
+
+        {
+            std::unique_lock<std::mutex> lock(m_parserMutex);
+            m_parsedChunksAhead++;
+            m_parsedChunkCond.notify_one();
+            if (m_videoStreamsCompleted) {
+                // Make sure a consumer blocked on the chunk credits observes
+                // the end of the stream.
+                m_parsedChunkCond.notify_all();
+                break;
+            }
+        }
+    }
+}
+
+bool VulkanVideoProcessor::ParserServiceRunQuantum()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_parserMutex);
+        if (m_videoStreamsCompleted || (m_parsedChunksAhead >= MAX_PARSED_CHUNKS_AHEAD)) {
+            // Credit window full or stream done - the consumer reschedules
+            // the stream when it frees a credit.
+            return false;
+        }
+    }
+
+    // Runs the demux, the CPU parse and the decode submission of one chunk,
+    // exactly like one iteration of the dedicated parser thread.
+    ParserProcessNextDataChunk();
+
+    std::unique_lock<std::mutex> lock(m_parserMutex);
+    m_parsedChunksAhead++;
+    m_parsedChunkCond.notify_one();
+    if (m_videoStreamsCompleted) {
+        // Make sure a consumer blocked on the chunk credits observes the end
+        // of the stream.
+        m_parsedChunkCond.notify_all();
+        return false;
+    }
+    return (m_parsedChunksAhead < MAX_PARSED_CHUNKS_AHEAD);
+}
+
+// Contained recovery for corrupted input (--errorResilient): the frame
+// buffer's query harvester publishes each picture's decode result status
+// (statuses below VK_QUERY_RESULT_STATUS_NOT_READY_KHR are errors), and a
+// picture carrying an error status is released straight back to the decoder
+// here instead of reaching the display or the output file. The presentation
+// simply holds the last intact picture for one interval and decoding
+// continues from the next access unit, so transient bitstream corruption
+// costs single frames rather than a session reset.
+int32_t VulkanVideoProcessor::DequeueValidDecodedPicture(DecodedFrame* pFrame)
+{
+    int32_t framesInQueue = m_vkVideoFrameBuffer->DequeueDecodedPicture(pFrame);
+    if (!m_enableErrorResilience) {
+        return framesInQueue;
+    }
+
+    while ((framesInQueue > 0) && (pFrame->pictureIndex != -1) &&
+           (pFrame->decodeStatus < VK_QUERY_RESULT_STATUS_NOT_READY_KHR)) {
+
+        // An available error status implies the decode submission has
+        // completed, so the slot can be recycled without a fence wait.
+        fprintf(stderr, "\nWARNING: dropping corrupted picture %d (decode result status %d)\n",
+                pFrame->pictureIndex, (int32_t)pFrame->decodeStatus);
+        if (m_enablePerfCounters) {
+            VulkanPerfCounters::Get().Add(VulkanPerfCounters::FRAMES_CORRUPTED);
+        }
+
+        DecodedFrameRelease corruptedFrameRelease = { pFrame->pictureIndex };
+        DecodedFrameRelease* corruptedFrameReleasePtr = &corruptedFrameRelease;
+        corruptedFrameRelease.decodeOrder = pFrame->decodeOrder;
+        corruptedFrameRelease.displayOrder = pFrame->displayOrder;
+        corruptedFrameRelease.hasConsummerSignalFence = false;
+        corruptedFrameRelease.hasConsummerSignalSemaphore = false;
+        corruptedFrameRelease.timestamp = 0;
+        pFrame->pictureIndex = -1;
+        m_vkVideoFrameBuffer->ReleaseDisplayedPicture(&corruptedFrameReleasePtr, 1);
+
+        framesInQueue = m_vkVideoFrameBuffer->DequeueDecodedPicture(pFrame);
+    }
+
+    return framesInQueue;
+}
+
 int32_t VulkanVideoProcessor::GetNextFrame(DecodedFrame* pFrame, bool* endOfStream)
 {
     // The below call to DequeueDecodedPicture allows returning the next frame without parsing of the stream.
     // Parsing is only done when there are no more frames in the queue.
-    int32_t framesInQueue = m_vkVideoFrameBuffer->DequeueDecodedPicture(pFrame);
+    int32_t framesInQueue = DequeueValidDecodedPicture(pFrame);
 
     // Loop until a frame (or more) is parsed and added to the queue.
     while ((framesInQueue == 0) && !m_videoStreamsCompleted) {
 
-        ParserProcessNextDataChunk();
+        if (IsParserThreadEnabled() || m_useParserService) {
+            // The parser thread (or worker pool) produces the chunks -
+            // consume one chunk credit (or the end of the stream) and
+            // re-check the queue.
+            bool wakeService = false;
+            {
+                std::unique_lock<std::mutex> lock(m_parserMutex);
+                m_parsedChunkCond.wait(lock, [this] {
+                    return (m_parsedChunksAhead > 0) || m_videoStreamsCompleted;
+                });
+                if (m_parsedChunksAhead > 0) {
+                    m_parsedChunksAhead--;
+                    if (m_useParserService) {
+                        wakeService = true;
+                    } else {
+                        m_parserWakeCond.notify_one();
+                    }
+                }
+            }
+            if (wakeService) {
+                // A credit was freed - let the pool run another quantum for
+                // this stream.
+                VulkanParserServicePool::Get().Schedule(this);
+            }
+        } else {
+            ParserProcessNextDataChunk();
+        }
 
-        framesInQueue = m_vkVideoFrameBuffer->DequeueDecodedPicture(pFrame);
+        framesInQueue = DequeueValidDecodedPicture(pFrame);
+    }
+
+    return FinishDequeuedFrame(pFrame, framesInQueue, endOfStream);
+}
+
+int32_t VulkanVideoProcessor::TryGetNextFrame(DecodedFrame* pFrame, bool* endOfStream)
+{
+    int32_t framesInQueue = DequeueValidDecodedPicture(pFrame);
+
+    if ((framesInQueue == 0) && !m_videoStreamsCompleted) {
+
+        if (IsParserThreadEnabled() || m_useParserService) {
+            // Consume a parsed-chunk credit when one is available; never
+            // sleep on the producer like GetNextFrame() does.
+            bool wakeService = false;
+            {
+                std::unique_lock<std::mutex> lock(m_parserMutex);
+                if (m_parsedChunksAhead > 0) {
+                    m_parsedChunksAhead--;
+                    if (m_useParserService) {
+                        wakeService = true;
+                    } else {
+                        m_parserWakeCond.notify_one();
+                    }
+                }
+            }
+            if (wakeService) {
+                VulkanParserServicePool::Get().Schedule(this);
+            }
+        } else {
+            // Synchronous parsing mode - run one parse quantum inline.
+            ParserProcessNextDataChunk();
+        }
+
+        framesInQueue = DequeueValidDecodedPicture(pFrame);
+    }
+
+    if ((framesInQueue == 0) && !m_videoStreamsCompleted) {
+        *endOfStream = false;
+        return 0;
+    }
+
+    if (framesInQueue == 0) {
+        // Completed stream with nothing left in the queue.
+        *endOfStream = true;
+        return -1;
+    }
+
+    // The dequeued frame's fence may still be pending - the caller runs
+    // FinishFrame() once it has signaled.
+    *endOfStream = m_videoStreamsCompleted;
+    return 1;
+}
+
+int32_t VulkanVideoProcessor::FinishFrame(DecodedFrame* pFrame, bool* endOfStream)
+{
+    return FinishDequeuedFrame(pFrame, 1, endOfStream);
+}
+
+int32_t VulkanVideoProcessor::FinishDequeuedFrame(DecodedFrame* pFrame, int32_t framesInQueue, bool* endOfStream)
+{
+    VK_VIDEO_ALLOC_AUDIT_SCOPE(STAGE_DISPLAY);
+
+    if (m_enablePerfCounters) {
+        // The remaining occupancy after this dequeue is the live depth the
+        // display side sees.
+        VulkanPerfCounters::Get().SetGauge(VulkanPerfCounters::DECODE_QUEUE_DEPTH,
+                                           (framesInQueue > 0) ? (uint64_t)(framesInQueue - 1) : 0);
     }
 
     if (framesInQueue) {
 
+        if (m_enablePerfCounters) {
+            VulkanPerfCounters::Get().Add(VulkanPerfCounters::FRAMES_DECODED);
+        }
+
         if (m_videoFrameNum == 0) {
             DumpVideoFormat(m_vkVideoDecoder->GetVideoFormatInfo(), false);
         }
 
         if (m_frameToFile) {
-            OutputFrameToFile(pFrame);
+            size_t outputBytes = OutputFrameToFile(pFrame);
+            if (m_enablePerfCounters) {
+                VulkanPerfCounters::Get().Add(VulkanPerfCounters::BYTES_OUT, (uint64_t)outputBytes);
+            }
         }
 
         m_videoFrameNum++;
+
+        // The audit's frame boundary: every allocation of the pipeline since
+        // the previous boundary is charged to this frame.
+        VK_VIDEO_ALLOC_AUDIT_FRAME(m_videoFrameNum);
     }
 
     if ((m_maxFrameCount != -1) && (m_videoFrameNum >= (uint32_t)m_maxFrameCount)) {
         // Tell the FrameProcessor we're done after this frame is drawn.
         std::cout << "Number of video frames " << m_videoFrameNum
                   << " of max frame number " << m_maxFrameCount << std::endl;
+        // The parser thread must not touch the demuxer while the stream is
+        // completed (and possibly rewound) from the consumer thread.
+        StopParserThread();
         m_videoStreamsCompleted = StreamCompleted();
     }
 
@@ -631,7 +1399,40 @@ int32_t VulkanVideoProcessor::GetNextFrame(DecodedFrame* pFrame, bool* endOfStre
 
 int32_t VulkanVideoProcessor::ReleaseDisplayedFrame(DecodedFrame* pDisplayedFrame)
 {
+    VK_VIDEO_ALLOC_AUDIT_SCOPE(STAGE_DISPLAY);
+
     if (pDisplayedFrame->pictureIndex != -1) {
+
+        if (m_enablePerfCounters) {
+            VulkanPerfCounters::Get().Add(VulkanPerfCounters::FRAMES_DISPLAYED);
+        }
+
+        if (IsTranscodeBenchmarkEnabled()) {
+            m_transcodeBenchmark.AddFrame();
+            // The decode GPU stage runs from the queue submission to the
+            // frame-complete fence; frames whose stamps were never observed
+            // on the host contribute no sample.
+            if ((pDisplayedFrame->decodeSubmitTimeNs != 0) &&
+                    (pDisplayedFrame->decodeDoneTimeNs > pDisplayedFrame->decodeSubmitTimeNs)) {
+                m_transcodeBenchmark.AddStageSample(TranscodeBenchmark::STAGE_DECODE_GPU,
+                        pDisplayedFrame->decodeDoneTimeNs - pDisplayedFrame->decodeSubmitTimeNs);
+            }
+        }
+
+        if (IsFrameLatencyTraceEnabled()) {
+            // The frame leaves the pipeline here - record its trace row with
+            // the display/output-done stamp taken now.
+            FrameLatencyRecord record;
+            record.decodeOrder        = pDisplayedFrame->decodeOrder;
+            record.displayOrder       = pDisplayedFrame->displayOrder;
+            record.demuxDoneTimeNs    = pDisplayedFrame->demuxDoneTimeNs;
+            record.parseDoneTimeNs    = pDisplayedFrame->parseDoneTimeNs;
+            record.decodeSubmitTimeNs = pDisplayedFrame->decodeSubmitTimeNs;
+            record.decodeDoneTimeNs   = pDisplayedFrame->decodeDoneTimeNs;
+            record.displayDoneTimeNs  = GetCurrentTimeNanoseconds();
+            m_frameLatencyTrace.push_back(record);
+        }
+
         DecodedFrameRelease decodedFramesRelease = { pDisplayedFrame->pictureIndex };
         DecodedFrameRelease* decodedFramesReleasePtr = &decodedFramesRelease;
 
@@ -644,12 +1445,327 @@ int32_t VulkanVideoProcessor::ReleaseDisplayedFrame(DecodedFrame* pDisplayedFram
         decodedFramesRelease.hasConsummerSignalSemaphore = pDisplayedFrame->hasConsummerSignalSemaphore;
         decodedFramesRelease.timestamp = 0;
 
+        if (m_enableBatchedFrameRelease) {
+            // Defer the recycling: the frame buffer only gets one locked
+            // ReleaseDisplayedPicture() call per FRAME_RELEASE_BATCH_SIZE
+            // displayed frames.
+            assert(m_numPendingFrameReleases < FRAME_RELEASE_BATCH_SIZE);
+            m_pendingFrameReleases[m_numPendingFrameReleases++] = decodedFramesRelease;
+            if (m_numPendingFrameReleases == FRAME_RELEASE_BATCH_SIZE) {
+                return FlushPendingFrameReleases();
+            }
+            return 0;
+        }
+
         return m_vkVideoFrameBuffer->ReleaseDisplayedPicture(&decodedFramesReleasePtr, 1);
     }
 
     return -1;
 }
 
+int32_t VulkanVideoProcessor::FlushPendingFrameReleases()
+{
+    if (m_numPendingFrameReleases == 0) {
+        return 0;
+    }
+
+    DecodedFrameRelease* pendingReleases[FRAME_RELEASE_BATCH_SIZE];
+    for (uint32_t i = 0; i < m_numPendingFrameReleases; i++) {
+        pendingReleases[i] = &m_pendingFrameReleases[i];
+    }
+
+    int32_t result = m_vkVideoFrameBuffer->ReleaseDisplayedPicture(pendingReleases,
+                                                                   m_numPendingFrameReleases);
+    m_numPendingFrameReleases = 0;
+    return result;
+}
+
+void VulkanVideoProcessor::DumpTranscodeBenchmarkJson()
+{
+    if (!IsTranscodeBenchmarkEnabled() || (m_transcodeBenchmark.GetFrameCount() == 0)) {
+        return;
+    }
+
+    std::ofstream jsonFile(m_transcodeBenchmarkJsonFile);
+    if (!jsonFile.is_open()) {
+        std::cerr << "ERROR: Could not open the transcode benchmark file "
+                  << m_transcodeBenchmarkJsonFile << std::endl;
+        return;
+    }
+
+    m_transcodeBenchmark.ReportJson(jsonFile);
+}
+
+void VulkanVideoProcessor::DumpFrameLatencyTrace()
+{
+    if (!IsFrameLatencyTraceEnabled() || m_frameLatencyTrace.empty()) {
+        return;
+    }
+
+    std::ofstream traceFile(m_frameLatencyTraceFile);
+    if (!traceFile.is_open()) {
+        std::cerr << "ERROR: Could not open the frame latency trace file "
+                  << m_frameLatencyTraceFile << std::endl;
+        return;
+    }
+
+    const size_t extensionPos = m_frameLatencyTraceFile.find_last_of('.');
+    const bool writeJson = (extensionPos != std::string::npos) &&
+                           (m_frameLatencyTraceFile.substr(extensionPos) == ".json");
+
+    if (writeJson) {
+        traceFile << "[\n";
+        for (size_t frame = 0; frame < m_frameLatencyTrace.size(); frame++) {
+            const FrameLatencyRecord& record = m_frameLatencyTrace[frame];
+            traceFile << "  { \"decodeOrder\": "   << record.decodeOrder
+                      << ", \"displayOrder\": "    << record.displayOrder
+                      << ", \"demuxDoneNs\": "     << record.demuxDoneTimeNs
+                      << ", \"parseDoneNs\": "     << record.parseDoneTimeNs
+                      << ", \"decodeSubmitNs\": "  << record.decodeSubmitTimeNs
+                      << ", \"decodeDoneNs\": "    << record.decodeDoneTimeNs
+                      << ", \"displayDoneNs\": "   << record.displayDoneTimeNs
+                      << " }" << (((frame + 1) < m_frameLatencyTrace.size()) ? "," : "") << "\n";
+        }
+        traceFile << "]\n";
+    } else {
+        traceFile << "decodeOrder,displayOrder,demuxDoneNs,parseDoneNs,decodeSubmitNs,decodeDoneNs,displayDoneNs\n";
+        for (size_t frame = 0; frame < m_frameLatencyTrace.size(); frame++) {
+            const FrameLatencyRecord& record = m_frameLatencyTrace[frame];
+            traceFile << record.decodeOrder        << ',' << record.displayOrder     << ','
+                      << record.demuxDoneTimeNs    << ',' << record.parseDoneTimeNs  << ','
+                      << record.decodeSubmitTimeNs << ',' << record.decodeDoneTimeNs << ','
+                      << record.displayDoneTimeNs  << '\n';
+        }
+    }
+
+    std::cout << "Wrote the frame latency trace of " << m_frameLatencyTrace.size()
+              << " frames to " << m_frameLatencyTraceFile << std::endl;
+    m_frameLatencyTrace.clear();
+}
+
+void VulkanVideoProcessor::ApplyDecoderConfiguration(const ProgramConfig& programConfig)
+{
+    if (programConfig.enableDecodeGpuTimeStats) {
+        m_vkVideoDecoder->EnableDecodeGpuTimeStats(true);
+    }
+
+    if (programConfig.enableEncoderInputSharing) {
+        m_vkVideoDecoder->EnableEncoderInputSharing(true);
+    }
+
+    if (programConfig.enableOnDemandDpbAllocation) {
+        m_vkVideoDecoder->EnableOnDemandDpbAllocation(true);
+    }
+
+    if (programConfig.enableAdaptiveInFlight) {
+        m_vkVideoDecoder->EnableAdaptiveInFlightDepth(true);
+    }
+
+    if (programConfig.enableAdaptiveBitstreamPool) {
+        m_vkVideoDecoder->EnableAdaptiveBitstreamPool(programConfig.bitstreamPoolMinBuffers,
+                                                      programConfig.bitstreamPoolMaxBuffers);
+    }
+
+    if (programConfig.enableDisplayOrderPrediction) {
+        m_vkVideoDecoder->EnableDisplayOrderPrediction(true);
+    }
+
+    if (programConfig.enableTimelineFrameSync) {
+        // Requires the VK_KHR_timeline_semaphore device extension to be
+        // enabled (see the main application).
+        VkResult result = m_vkVideoFrameBuffer->EnableTimelineFrameSync();
+        if (result != VK_SUCCESS) {
+            std::cerr << "WARNING: timeline frame synchronization is not available,"
+                         " falling back to per-frame fences!" << std::endl;
+        }
+    }
+
+    if (programConfig.enableGpuFrameChecksums) {
+        // Also requires VK_KHR_timeline_semaphore; the decoder enables the
+        // timeline frame synchronization mode itself if it is not on yet.
+        m_vkVideoDecoder->EnableGpuFrameChecksums(true);
+    }
+
+    if (programConfig.enableGpuFrameAnalysis) {
+        // Same timeline-semaphore requirement as the checksum mode above.
+        m_vkVideoDecoder->EnableGpuFrameAnalysis(true);
+    }
+
+    if (programConfig.enableDecodedFrameExport) {
+        // Requires the VK_KHR_external_memory_fd and
+        // VK_KHR_external_semaphore_fd device extensions to be enabled (see
+        // the main application). Must precede the decoder's image pool
+        // creation, so the export handle types are declared at image and
+        // semaphore creation time.
+        VkResult result = m_vkVideoFrameBuffer->EnableDecodedFrameExport();
+        if (result != VK_SUCCESS) {
+            std::cerr << "WARNING: decoded frame export is not available,"
+                         " continuing without the exportable output images!" << std::endl;
+        }
+    }
+
+    if (programConfig.decodeSubmitBatchSize > 1) {
+        m_vkVideoDecoder->SetDecodeSubmitBatchSize((uint32_t)programConfig.decodeSubmitBatchSize);
+    }
+
+    // The explicit image layout overrides; the auto mode applies its
+    // per-trial override on top (see BenchmarkDecodeImageLayouts()).
+    switch (programConfig.decodeImageLayoutMode) {
+    case ProgramConfig::DecodeImageLayoutSeparateOutput:
+        m_vkVideoDecoder->SetImageLayoutPreferences(false, false, true);
+        break;
+    case ProgramConfig::DecodeImageLayoutImageArray:
+        m_vkVideoDecoder->SetImageLayoutPreferences(true, false, false);
+        break;
+    case ProgramConfig::DecodeImageLayoutImageViewArray:
+        m_vkVideoDecoder->SetImageLayoutPreferences(true, true, false);
+        break;
+    default:
+        break;
+    }
+}
+
+// Opt-in session-start auto-selection of the decode image layout
+// (--decodeImageLayout auto): the relative cost of discrete decode images,
+// image arrays and separate output images differs wildly across driver
+// versions and GPU generations, so instead of hardcoding a choice, a short
+// warmup of the stream is decoded in each viable configuration and the
+// fastest one is locked in for the run. The layout flags are baked into the
+// video session's image pool, so every trial gets a throwaway frame buffer,
+// decoder and parser; the demuxer is rewound in between.
+int32_t VulkanVideoProcessor::BenchmarkDecodeImageLayouts(const ProgramConfig& programConfig,
+                                                          const char* filePath,
+                                                          uint32_t defaultMinBufferSize,
+                                                          uint32_t bufferOffsetAlignment,
+                                                          uint32_t bufferSizeAlignment,
+                                                          bool useLinearOutput)
+{
+    struct LayoutCandidate {
+        const char* name;
+        bool useImageArray;
+        bool useImageViewArray;
+        bool forceSeparateOutputImages;
+    };
+    static const LayoutCandidate layoutCandidates[] = {
+        { "default",        false, false, false },
+        { "separateOutput", false, false, true  },
+        { "imageArray",     true,  false, false },
+        { "imageViewArray", true,  true,  false },
+    };
+    const uint32_t numCandidates = sizeof(layoutCandidates) / sizeof(layoutCandidates[0]);
+    const uint32_t warmupFrames = (programConfig.imageLayoutBenchmarkFrames > 0) ?
+            (uint32_t)programConfig.imageLayoutBenchmarkFrames : 1;
+    const int32_t videoQueueIndx = programConfig.queueId;
+    const int32_t numDecodeImagesInFlight = std::max(programConfig.numDecodeImagesInFlight, 4);
+    const int32_t numBitstreamBuffersToPreallocate = std::max(programConfig.numBitstreamBuffersToPreallocate, 4);
+    const uint64_t fenceTimeout = 100 * 1000 * 1000; // 100 mSec
+
+    // The trials always measure from the start of the stream; Initialize()
+    // re-applies the configured seek window after the winner is locked in.
+    m_seekStartTimeNs = 0;
+    m_stopTimeNs = 0;
+    m_awaitingSegmentStartKeyFrame = false;
+
+    uint32_t bestCandidate = 0;
+    double bestFps = 0.0;
+
+    // The pass at candidateIdx == numCandidates recreates the winner.
+    for (uint32_t candidateIdx = 0; candidateIdx <= numCandidates; candidateIdx++) {
+
+        const bool finalPass = (candidateIdx == numCandidates);
+        const LayoutCandidate& candidate = layoutCandidates[finalPass ? bestCandidate : candidateIdx];
+
+        m_vkParser = nullptr;
+        m_vkVideoDecoder = nullptr;
+        m_vkVideoFrameBuffer = nullptr;
+        m_videoStreamsCompleted = false;
+        m_currentBitstreamOffset = 0;
+        m_videoStreamDemuxer->Rewind();
+
+        VkResult result = VulkanVideoFrameBuffer::Create(m_vkDevCtx, m_vkVideoFrameBuffer);
+        if (result == VK_SUCCESS) {
+            result = VkVideoDecoder::Create(m_vkDevCtx, m_vkVideoFrameBuffer,
+                                            videoQueueIndx, useLinearOutput,
+                                            (programConfig.enableRealtimeDecodeQos != 0),
+                                            numDecodeImagesInFlight,
+                                            programConfig.numDecodeImagesToPreallocate,
+                                            numBitstreamBuffersToPreallocate,
+                                            m_vkVideoDecoder);
+        }
+        if (result == VK_SUCCESS) {
+            ApplyDecoderConfiguration(programConfig);
+            m_vkVideoDecoder->SetImageLayoutPreferences(candidate.useImageArray,
+                                                        candidate.useImageViewArray,
+                                                        candidate.forceSeparateOutputImages);
+            result = CreateParser(filePath, m_videoStreamDemuxer->GetVideoCodec(),
+                                  defaultMinBufferSize, bufferOffsetAlignment, bufferSizeAlignment);
+        }
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nERROR: BenchmarkDecodeImageLayouts(): could not set up the %s trial: 0x%x\n",
+                    candidate.name, result);
+            return -1;
+        }
+        if (programConfig.decodeDecimateRatio > 1) {
+            m_vkParser->SetDecodeDecimation((uint32_t)programConfig.decodeDecimateRatio);
+        }
+
+        if (finalPass) {
+            break;
+        }
+
+        const uint64_t trialStartTimeNs = GetCurrentTimeNanoseconds();
+        uint32_t decodedFrames = 0;
+        while ((decodedFrames < warmupFrames) && !m_videoStreamsCompleted) {
+
+            ParserProcessNextDataChunk();
+
+            DecodedFrame trialFrame;
+            trialFrame.Reset();
+            while ((decodedFrames < warmupFrames) &&
+                   (DequeueValidDecodedPicture(&trialFrame) > 0) && (trialFrame.pictureIndex != -1)) {
+                // The effective throughput includes the GPU time: wait for
+                // the frame like a real consumer would before recycling its
+                // slot.
+                if (trialFrame.frameCompleteTimelineSemaphore != VK_NULL_HANDLE) {
+                    const VkSemaphoreWaitInfoKHR semaphoreWaitInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR, nullptr, 0,
+                                                                       1, &trialFrame.frameCompleteTimelineSemaphore,
+                                                                       &trialFrame.frameCompleteTimelineValue };
+                    m_vkDevCtx->WaitSemaphoresKHR(m_vkDevCtx->getDevice(), &semaphoreWaitInfo, fenceTimeout);
+                } else if (trialFrame.frameCompleteFence != VK_NULL_HANDLE) {
+                    m_vkDevCtx->WaitForFences(m_vkDevCtx->getDevice(), 1, &trialFrame.frameCompleteFence,
+                                              VK_TRUE, fenceTimeout);
+                }
+
+                DecodedFrameRelease trialFrameRelease = { trialFrame.pictureIndex };
+                DecodedFrameRelease* trialFrameReleasePtr = &trialFrameRelease;
+                trialFrameRelease.decodeOrder = trialFrame.decodeOrder;
+                trialFrameRelease.displayOrder = trialFrame.displayOrder;
+                trialFrameRelease.hasConsummerSignalFence = false;
+                trialFrameRelease.hasConsummerSignalSemaphore = false;
+                trialFrameRelease.timestamp = 0;
+                m_vkVideoFrameBuffer->ReleaseDisplayedPicture(&trialFrameReleasePtr, 1);
+
+                decodedFrames++;
+                trialFrame.Reset();
+            }
+        }
+
+        const uint64_t trialTimeNs = GetCurrentTimeNanoseconds() - trialStartTimeNs;
+        const double trialFps = (trialTimeNs > 0) ?
+                (((double)decodedFrames * 1e9) / (double)trialTimeNs) : 0.0;
+        std::cout << "Decode image layout benchmark: " << candidate.name << " decoded "
+                  << decodedFrames << " frames at " << trialFps << " FPS" << std::endl;
+        if ((decodedFrames > 0) && (trialFps > bestFps)) {
+            bestFps = trialFps;
+            bestCandidate = candidateIdx;
+        }
+    }
+
+    std::cout << "Decode image layout benchmark: locking in "
+              << layoutCandidates[bestCandidate].name << std::endl;
+    return 0;
+}
+
 VkResult VulkanVideoProcessor::CreateParser(const char* filename,
                                             VkVideoCodecOperationFlagBitsKHR vkCodecType,
                                             uint32_t defaultMinBufferSize,
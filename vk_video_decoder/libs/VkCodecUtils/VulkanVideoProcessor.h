@@ -17,21 +17,57 @@
 #ifndef _VULKANVIDEOPROCESSOR_H_
 #define _VULKANVIDEOPROCESSOR_H_
 
+#include <condition_variable>
+#include <deque>
+#include <thread>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+#endif
+
 #include "NvCodecUtils/VideoStreamDemuxer.h"
 #include "VkVideoDecoder/VkVideoDecoder.h"
 #include "VkCodecUtils/ProgramConfig.h"
+#include "VkCodecUtils/TranscodeBenchmark.h"
+#include "VkCodecUtils/VulkanFrameScaler.h"
+#include "VkCodecUtils/VulkanThreadAffinity.h"
 
 class VkFrameVideoToFile {
 
+    enum { MAX_STAGING_BUFFERS = 4 };
+    enum { MAPPED_WINDOW_SIZE = 64 * 1024 * 1024 };
+
+    struct StagingBuffer {
+        uint8_t* pMemory;
+        size_t   allocationSize;
+        size_t   usedSize;
+    };
+
 public:
 
     VkFrameVideoToFile()
         : m_outputFile(),
           m_pLinearMemory()
-        , m_allocationSize() {}
+        , m_allocationSize()
+        , m_numStagingBuffers(0)
+        , m_stagingBuffers{}
+        , m_currentStagingBuffer(-1)
+        , m_exitWriterThread(false)
+        , m_writerThread()
+        , m_mappedWriterEnabled(false)
+        , m_pMappedWindow()
+        , m_mappedWindowOffset(0)
+        , m_mappedWindowSize(0)
+        , m_mappedWriteOffset(0)
+        , m_mappedFileSize(0) {}
 
     ~VkFrameVideoToFile()
     {
+        StopAsyncWriter();
+        StopMappedWriter();
+
         if (m_pLinearMemory) {
             delete[] m_pLinearMemory;
             m_pLinearMemory = nullptr;
@@ -52,6 +88,14 @@ public:
 
         VkDeviceSize imageMemorySize = imageResource->GetImageDeviceMemorySize();
 
+        if (IsAsyncWriterEnabled()) {
+            return EnsureStagingBufferAllocation((size_t)imageMemorySize);
+        }
+
+        if (IsMappedWriterEnabled()) {
+            return EnsureMappedWindow((size_t)imageMemorySize);
+        }
+
         if ((m_pLinearMemory == nullptr) || (imageMemorySize > m_allocationSize)) {
 
             if (m_outputFile) {
@@ -76,6 +120,9 @@ public:
 
     FILE* AttachFile(const char* fileName) {
 
+        StopAsyncWriter();
+        StopMappedWriter();
+
         if (m_outputFile) {
             fclose(m_outputFile);
             m_outputFile = nullptr;
@@ -102,17 +149,289 @@ public:
 
     size_t WriteDataToFile(size_t offset, size_t size)
     {
+        if (IsAsyncWriterEnabled()) {
+            return SubmitStagingBuffer(offset, size);
+        }
+        if (IsMappedWriterEnabled()) {
+            // The plane copies already stored the frame directly into the
+            // mapping (see EnsureMappedWindow()); just advance the file
+            // position and let the kernel flush the dirty pages behind us.
+            assert(offset == 0);
+            m_mappedWriteOffset += size;
+            return 1;
+        }
         return fwrite(m_pLinearMemory + offset, size, 1, m_outputFile);
     }
 
     size_t GetMaxFrameSize() {
+        if (IsAsyncWriterEnabled() && (m_currentStagingBuffer >= 0)) {
+            return m_stagingBuffers[m_currentStagingBuffer].allocationSize;
+        }
         return m_allocationSize;
     }
 
+    // Switches the attached file to memory-mapped output: the file is
+    // pre-sized with ftruncate(), EnsureAllocation() returns a pointer
+    // directly into an mmap()-ed window and WriteDataToFile() becomes a
+    // plain offset advance - collapsing the copy-out and the write into a
+    // single store stream with the kernel flushing pages asynchronously.
+    // Returns false on platforms without mmap support; the caller then
+    // stays on the buffered fwrite path.
+    bool StartMappedWriter()
+    {
+#if defined(__linux__)
+        if (m_outputFile == nullptr) {
+            return false;
+        }
+
+        if (IsAsyncWriterEnabled()) {
+            return false;
+        }
+
+        m_mappedWriterEnabled = true;
+        m_mappedWriteOffset = 0;
+        m_mappedFileSize = 0;
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Unmaps the current window and trims the preallocated file back to the
+    // bytes actually written.
+    void StopMappedWriter()
+    {
+        if (!IsMappedWriterEnabled()) {
+            return;
+        }
+
+#if defined(__linux__)
+        UnmapWindow();
+
+        if ((m_outputFile != nullptr) && (m_mappedFileSize != m_mappedWriteOffset)) {
+            int result = ftruncate(fileno(m_outputFile), (off_t)m_mappedWriteOffset);
+            if (result != 0) {
+                fprintf(stderr, "\nERROR: trimming the mapped output file failed\n");
+            }
+            // Keep the stdio position consistent for anybody touching the
+            // FILE* after us.
+            fseek(m_outputFile, (long)m_mappedWriteOffset, SEEK_SET);
+        }
+#endif
+        m_mappedWriterEnabled = false;
+        m_mappedWriteOffset = 0;
+        m_mappedFileSize = 0;
+    }
+
+    bool IsMappedWriterEnabled() const {
+        return m_mappedWriterEnabled;
+    }
+
+    // Starts the dedicated I/O thread with numStagingBuffers staging buffers, so
+    // the copy-out and fwrite of frame N can overlap the decode of frame N + 1.
+    // A non-empty cpuSet pins the thread (see ProgramConfig::outputThreadCpuSet).
+    bool StartAsyncWriter(uint32_t numStagingBuffers = 2, const std::string& cpuSet = std::string())
+    {
+        if (IsAsyncWriterEnabled()) {
+            return true;
+        }
+
+        m_writerThreadCpuSet = cpuSet;
+        m_numStagingBuffers = std::max(2u, std::min(numStagingBuffers, (uint32_t)MAX_STAGING_BUFFERS));
+        for (uint32_t i = 0; i < m_numStagingBuffers; i++) {
+            m_stagingBuffers[i] = StagingBuffer();
+            m_freeBuffers.push_back((int32_t)i);
+        }
+
+        m_exitWriterThread = false;
+        m_writerThread = std::thread(&VkFrameVideoToFile::WriterThreadProc, this);
+        return m_writerThread.joinable();
+    }
+
+    // Drains all pending writes and joins the I/O thread.
+    void StopAsyncWriter()
+    {
+        if (!IsAsyncWriterEnabled()) {
+            return;
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(m_writerMutex);
+            m_exitWriterThread = true;
+            m_pendingBuffersCond.notify_all();
+        }
+        m_writerThread.join();
+
+        for (uint32_t i = 0; i < m_numStagingBuffers; i++) {
+            if (m_stagingBuffers[i].pMemory != nullptr) {
+                delete[] m_stagingBuffers[i].pMemory;
+                m_stagingBuffers[i] = StagingBuffer();
+            }
+        }
+        m_freeBuffers.clear();
+        m_pendingBuffers.clear();
+        m_numStagingBuffers = 0;
+        m_currentStagingBuffer = -1;
+    }
+
+    bool IsAsyncWriterEnabled() const {
+        return m_writerThread.joinable();
+    }
+
+private:
+
+    // Picks (waiting, if all are in flight) a free staging buffer and makes sure
+    // it is large enough for the next frame.
+    uint8_t* EnsureStagingBufferAllocation(size_t imageMemorySize)
+    {
+        if (m_currentStagingBuffer < 0) {
+            std::unique_lock<std::mutex> lock(m_writerMutex);
+            m_freeBuffersCond.wait(lock, [this] { return !m_freeBuffers.empty(); });
+            m_currentStagingBuffer = m_freeBuffers.front();
+            m_freeBuffers.pop_front();
+        }
+
+        StagingBuffer& stagingBuffer = m_stagingBuffers[m_currentStagingBuffer];
+        if ((stagingBuffer.pMemory == nullptr) || (imageMemorySize > stagingBuffer.allocationSize)) {
+            if (stagingBuffer.pMemory != nullptr) {
+                delete[] stagingBuffer.pMemory;
+            }
+            stagingBuffer.allocationSize = imageMemorySize;
+            stagingBuffer.pMemory = new uint8_t[stagingBuffer.allocationSize];
+        }
+        return stagingBuffer.pMemory;
+    }
+
+#if defined(__linux__)
+    // Returns a pointer into the mapped window where the next frame's
+    // m_mappedWriteOffset lands, growing the file and sliding the window
+    // forward in MAPPED_WINDOW_SIZE steps as the output advances.
+    uint8_t* EnsureMappedWindow(size_t frameSize)
+    {
+        if ((m_pMappedWindow != nullptr) &&
+                ((m_mappedWriteOffset - m_mappedWindowOffset) + frameSize <= m_mappedWindowSize)) {
+            m_allocationSize = frameSize;
+            return m_pMappedWindow + (m_mappedWriteOffset - m_mappedWindowOffset);
+        }
+
+        UnmapWindow();
+
+        const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+        m_mappedWindowOffset = m_mappedWriteOffset & ~(pageSize - 1);
+        m_mappedWindowSize = std::max((size_t)MAPPED_WINDOW_SIZE,
+                                      (m_mappedWriteOffset - m_mappedWindowOffset) + frameSize);
+
+        // Pre-size the file before mapping: stores into a MAP_SHARED mapping
+        // beyond the end of the file would fault with SIGBUS.
+        if (m_mappedFileSize < (m_mappedWindowOffset + m_mappedWindowSize)) {
+            m_mappedFileSize = m_mappedWindowOffset + m_mappedWindowSize;
+            int result = ftruncate(fileno(m_outputFile), (off_t)m_mappedFileSize);
+            if (result != 0) {
+                fprintf(stderr, "\nERROR: pre-sizing the mapped output file failed\n");
+                return nullptr;
+            }
+        }
+
+        void* pMapping = mmap(nullptr, m_mappedWindowSize, PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fileno(m_outputFile), (off_t)m_mappedWindowOffset);
+        if (pMapping == MAP_FAILED) {
+            fprintf(stderr, "\nERROR: mapping the output file window failed\n");
+            return nullptr;
+        }
+
+        m_pMappedWindow = (uint8_t*)pMapping;
+        m_allocationSize = frameSize;
+        return m_pMappedWindow + (m_mappedWriteOffset - m_mappedWindowOffset);
+    }
+
+    void UnmapWindow()
+    {
+        if (m_pMappedWindow == nullptr) {
+            return;
+        }
+
+        // Kick off the writeback of the retired window without waiting for it.
+        msync(m_pMappedWindow, m_mappedWindowSize, MS_ASYNC);
+        munmap(m_pMappedWindow, m_mappedWindowSize);
+        m_pMappedWindow = nullptr;
+        m_mappedWindowOffset = 0;
+        m_mappedWindowSize = 0;
+    }
+#else
+    uint8_t* EnsureMappedWindow(size_t) { return nullptr; }
+    void UnmapWindow() {}
+#endif
+
+    size_t SubmitStagingBuffer(size_t offset, size_t size)
+    {
+        if (m_currentStagingBuffer < 0) {
+            return 0;
+        }
+
+        assert(offset == 0);
+        m_stagingBuffers[m_currentStagingBuffer].usedSize = size;
+        {
+            std::unique_lock<std::mutex> lock(m_writerMutex);
+            m_pendingBuffers.push_back(m_currentStagingBuffer);
+            m_pendingBuffersCond.notify_one();
+        }
+        m_currentStagingBuffer = -1;
+        return 1;
+    }
+
+    void WriterThreadProc()
+    {
+        VulkanThreadAffinity::PinCurrentThread(m_writerThreadCpuSet, "output writer");
+
+        for (;;) {
+            int32_t bufferIndex = -1;
+            {
+                std::unique_lock<std::mutex> lock(m_writerMutex);
+                m_pendingBuffersCond.wait(lock, [this] {
+                    return !m_pendingBuffers.empty() || m_exitWriterThread;
+                });
+                if (m_pendingBuffers.empty() && m_exitWriterThread) {
+                    break;
+                }
+                bufferIndex = m_pendingBuffers.front();
+                m_pendingBuffers.pop_front();
+            }
+
+            StagingBuffer& stagingBuffer = m_stagingBuffers[bufferIndex];
+            fwrite(stagingBuffer.pMemory, stagingBuffer.usedSize, 1, m_outputFile);
+            stagingBuffer.usedSize = 0;
+
+            {
+                std::unique_lock<std::mutex> lock(m_writerMutex);
+                m_freeBuffers.push_back(bufferIndex);
+                m_freeBuffersCond.notify_one();
+            }
+        }
+    }
+
 private:
     FILE*    m_outputFile;
     uint8_t* m_pLinearMemory;
     size_t   m_allocationSize;
+    // Async writer state (see StartAsyncWriter()).
+    uint32_t                m_numStagingBuffers;
+    StagingBuffer           m_stagingBuffers[MAX_STAGING_BUFFERS];
+    int32_t                 m_currentStagingBuffer;
+    std::deque<int32_t>     m_freeBuffers;
+    std::deque<int32_t>     m_pendingBuffers;
+    std::mutex              m_writerMutex;
+    std::condition_variable m_freeBuffersCond;
+    std::condition_variable m_pendingBuffersCond;
+    bool                    m_exitWriterThread;
+    std::thread             m_writerThread;
+    std::string             m_writerThreadCpuSet;
+    // Mapped-file writer state (see StartMappedWriter()).
+    bool     m_mappedWriterEnabled;
+    uint8_t* m_pMappedWindow;
+    size_t   m_mappedWindowOffset;
+    size_t   m_mappedWindowSize;
+    size_t   m_mappedWriteOffset;
+    size_t   m_mappedFileSize;
 };
 
 class VulkanVideoProcessor : public VkVideoRefCountBase {
@@ -131,6 +450,10 @@ public:
     int32_t GetWidth();
     int32_t GetHeight();
     int32_t GetBitDepth();
+    // Stream duration in nanoseconds from the demuxer's container metadata,
+    // or -1 when unknown; the parallel GOP decode mode derives its segment
+    // boundaries from it.
+    int64_t GetStreamDurationNs();
 
     void Deinit();
 
@@ -156,6 +479,29 @@ public:
     int32_t ParserProcessNextDataChunk();
     int32_t GetNextFrame(DecodedFrame* pFrame, bool* endOfStream);
 
+    // Non-blocking variant of GetNextFrame() for callers driving many
+    // streams from one thread (see VulkanVideoFrameReactor). Returns 1 with
+    // a dequeued frame whose frameCompleteFence may still be pending - the
+    // caller finishes it with FinishFrame() once the fence has signaled and
+    // returns it with ReleaseDisplayedFrame() - 0 when no frame is ready
+    // yet, and -1 at the end of the stream. Instead of sleeping on the
+    // parsed-chunk credits it consumes one only when available (or runs one
+    // parse quantum inline in the synchronous parsing mode).
+    int32_t TryGetNextFrame(DecodedFrame* pFrame, bool* endOfStream);
+
+    // Runs the post-dequeue half of GetNextFrame() - the perf accounting,
+    // the file output and the --maxFrameCount end-of-stream handling - for
+    // a frame obtained with TryGetNextFrame(). The frame's decode must be
+    // complete; the file output path reads the decoded image.
+    int32_t FinishFrame(DecodedFrame* pFrame, bool* endOfStream);
+
+    // Shared parser service mode (see ProgramConfig::parserWorkerCount and
+    // VulkanParserServicePool): runs one parse quantum - the demux, CPU
+    // parse and decode submission of one chunk - on a pool worker. Returns
+    // true while the stream wants another quantum right away (credit window
+    // not full, stream not completed), so the worker reschedules it.
+    bool ParserServiceRunQuantum();
+
     int32_t ReleaseDisplayedFrame(DecodedFrame* pDisplayedFrame);
 
     size_t OutputFrameToFile(DecodedFrame* pFrame);
@@ -163,6 +509,28 @@ public:
 
 private:
 
+    enum { MAX_PARSED_CHUNKS_AHEAD = 4 };
+
+    // How many displayed frames are accumulated before they are returned to
+    // the frame buffer in a single ReleaseDisplayedPicture() call (see
+    // ProgramConfig::enableBatchedFrameRelease). Kept small so the deferred
+    // surfaces do not starve the decoder's DPB pool.
+    enum { FRAME_RELEASE_BATCH_SIZE = 4 };
+
+    // One row of the per-frame pipeline latency trace (see
+    // ProgramConfig::frameLatencyTraceFile). All stamps are monotonic
+    // nanoseconds (GetCurrentTimeNanoseconds()); a stamp of 0 means the
+    // corresponding point was never observed on the host for this frame.
+    struct FrameLatencyRecord {
+        int32_t  decodeOrder;
+        int32_t  displayOrder;
+        uint64_t demuxDoneTimeNs;
+        uint64_t parseDoneTimeNs;
+        uint64_t decodeSubmitTimeNs;
+        uint64_t decodeDoneTimeNs;
+        uint64_t displayDoneTimeNs;
+    };
+
     VulkanVideoProcessor(const VulkanDeviceContext* vkDevCtx)
         : m_refCount(0),
           m_vkDevCtx(vkDevCtx),
@@ -170,15 +538,48 @@ private:
         , m_vkVideoFrameBuffer()
         , m_vkVideoDecoder()
         , m_vkParser()
+        , m_bitstreamIngestBuffer()
         , m_currentBitstreamOffset(0)
         , m_videoFrameNum(0)
         , m_videoStreamsCompleted(false)
         , m_usesStreamDemuxer(false)
         , m_usesFramePreparser(false)
+        , m_enableDecoderPool(false)
+        , m_enableBatchedFrameRelease(false)
+        , m_enablePerfCounters(false)
+        , m_enableMemoryDeltaReport(false)
+        , m_enablePacked10BitOutput(false)
+        , m_enableP010Output(false)
+        , m_enableErrorResilience(false)
+        , m_parseAheadHighWatermarkFrames(0)
+        , m_parseAheadLowWatermarkFrames(0)
+        , m_demuxThrottled(false)
         , m_frameToFile()
+        , m_frameScaler()
+        , m_scaledOutputCrop()
+        , m_scaledOutputWidth(0)
+        , m_scaledOutputHeight(0)
         , m_loopCount(1)
+        , m_loopIterationIndex(0)
+        , m_loopIterationStartTimeNs(0)
+        , m_steadyStateFrameCount(0)
+        , m_steadyStateTimeNs(0)
         , m_startFrame(0)
         , m_maxFrameCount(-1)
+        , m_seekStartTimeNs(0)
+        , m_stopTimeNs(0)
+        , m_alignStartTimeToNextKeyFrame(false)
+        , m_awaitingSegmentStartKeyFrame(false)
+        , m_frameLatencyTraceFile()
+        , m_frameLatencyTrace()
+        , m_transcodeBenchmarkJsonFile()
+        , m_transcodeBenchmark()
+        , m_pendingFrameReleases{}
+        , m_numPendingFrameReleases(0)
+        , m_parsedChunksAhead(0)
+        , m_exitParserThread(false)
+        , m_parserThread()
+        , m_useParserService(false)
     {
     }
 
@@ -200,6 +601,88 @@ private:
 
     bool StreamCompleted();
 
+    // Per-loop-iteration throughput reporting for --loop > 1: prints the
+    // completing iteration's frames/FPS (the first one marked as the cold
+    // start) and, with the last iteration, the steady-state FPS aggregated
+    // over the warm iterations. Must run before StreamCompleted() consumes
+    // the loop and Restart() clears the frame counter.
+    void ReportLoopIterationFps();
+
+    // Shared tail of GetNextFrame()/TryGetNextFrame(): per-frame accounting
+    // and file output when framesInQueue is non-zero, then the
+    // --maxFrameCount end-of-stream handling. Returns -1 when the stream is
+    // completed with no frame dequeued, 1 otherwise.
+    int32_t FinishDequeuedFrame(DecodedFrame* pFrame, int32_t framesInQueue, bool* endOfStream);
+
+    // DequeueDecodedPicture() with the contained corrupted-input recovery of
+    // --errorResilient layered on top: pictures whose decode result status
+    // query reports an error are released straight back to the decoder, so
+    // the caller only ever sees intact pictures.
+    int32_t DequeueValidDecodedPicture(DecodedFrame* pFrame);
+
+    // Applies the decoder and frame buffer options selected in programConfig
+    // to the freshly created m_vkVideoDecoder/m_vkVideoFrameBuffer pair. Kept
+    // separate from Initialize() so the image layout auto-benchmark can
+    // configure its trial decoders identically (see
+    // BenchmarkDecodeImageLayouts()).
+    void ApplyDecoderConfiguration(const ProgramConfig& programConfig);
+
+    // Session-start auto-selection of the decode image layout
+    // (--decodeImageLayout auto): decodes a short warmup of the stream with
+    // each viable image organization on a throwaway decoder, measures the
+    // effective throughput, and leaves m_vkVideoDecoder/m_vkVideoFrameBuffer/
+    // m_vkParser recreated with the fastest one. The demuxer is rewound
+    // between the trials, so the decode that follows still covers the whole
+    // stream. Requires a rewindable input.
+    int32_t BenchmarkDecodeImageLayouts(const ProgramConfig& programConfig,
+                                        const char* filePath,
+                                        uint32_t defaultMinBufferSize,
+                                        uint32_t bufferOffsetAlignment,
+                                        uint32_t bufferSizeAlignment,
+                                        bool useLinearOutput);
+
+    // Lightweight header pass over an H.264 elementary stream
+    // (--streamHeaderScan, see H264HeaderScanner): builds the picture/IDR
+    // index and validation counts from NAL types and the first slice header
+    // fields only, without running the full parser.
+    void ScanStreamHeaders();
+
+    // Pipelined parsing mode (see ProgramConfig::enablePipelinedParsing).
+    // The dedicated thread runs demux + CPU parse + decode submission and is
+    // kept at most MAX_PARSED_CHUNKS_AHEAD demuxed chunks ahead of the
+    // consumer in GetNextFrame(), overlapping the CPU parse of the next
+    // pictures with the GPU decode and the display/output of the current one.
+    bool StartParserThread();
+    void StopParserThread();
+    void ParserThreadProc();
+
+    bool IsParserThreadEnabled() const {
+        return m_parserThread.joinable();
+    }
+
+    bool IsFrameLatencyTraceEnabled() const {
+        return !m_frameLatencyTraceFile.empty();
+    }
+
+    bool IsTranscodeBenchmarkEnabled() const {
+        return !m_transcodeBenchmarkJsonFile.empty();
+    }
+
+    // Writes the stage-resolved timing collected in m_transcodeBenchmark to
+    // the file selected with --transcodeJson (see TranscodeBenchmark).
+    void DumpTranscodeBenchmarkJson();
+
+    // Writes the trace accumulated in ReleaseDisplayedFrame() to the file
+    // selected with --frameLatencyTrace; the format is picked by the file
+    // extension (".json" produces a JSON array, anything else CSV).
+    void DumpFrameLatencyTrace();
+
+    // Returns all releases deferred by ReleaseDisplayedFrame() to the frame
+    // buffer in one locked ReleaseDisplayedPicture() call. Must run before
+    // the stream is rewound or the frame buffer is torn down, so that no
+    // surface is left owned by the display.
+    int32_t FlushPendingFrameReleases();
+
 private:
     std::atomic<int32_t>       m_refCount;
     const VulkanDeviceContext* m_vkDevCtx;
@@ -207,15 +690,97 @@ private:
     VkSharedBaseObj<VulkanVideoFrameBuffer> m_vkVideoFrameBuffer;
     VkSharedBaseObj<VkVideoDecoder> m_vkVideoDecoder;
     VkSharedBaseObj<IVulkanVideoParser> m_vkParser;
+    // Optional persistently mapped, host-visible buffer the demuxer writes
+    // compressed data into directly (see ProgramConfig::enableZeroCopyDemux).
+    VkSharedBaseObj<VulkanBitstreamBuffer> m_bitstreamIngestBuffer;
     int64_t  m_currentBitstreamOffset;
     uint32_t m_videoFrameNum;
     uint32_t m_videoStreamsCompleted : 1;
     uint32_t m_usesStreamDemuxer : 1;
     uint32_t m_usesFramePreparser : 1;
+    // Park the decoder for reuse by the next stream with a matching
+    // sequence instead of destroying it (see VkVideoDecoderPool).
+    uint32_t m_enableDecoderPool : 1;
+    // Defer displayed-frame recycling and return the frames to the frame
+    // buffer FRAME_RELEASE_BATCH_SIZE at a time, cutting the display-queue
+    // lock acquisitions on the display path by the batch factor (see
+    // ProgramConfig::enableBatchedFrameRelease).
+    uint32_t m_enableBatchedFrameRelease : 1;
+    // Feed the process-wide runtime counters and keep their exporter running
+    // (see ProgramConfig::perfCountersFile and VulkanPerfCounters).
+    uint32_t m_enablePerfCounters : 1;
+    // Report the per-pool memory accounting deltas on every stream loop
+    // (see ProgramConfig::enableMemoryDeltaReport).
+    uint32_t m_enableMemoryDeltaReport : 1;
+    // Pack the 16-bit readback of 10-bit content to tight 10-bit groups
+    // before the file write (see ProgramConfig::enablePacked10BitOutput).
+    uint32_t m_enablePacked10BitOutput : 1;
+    // Normalize the 16-bit readback words to canonical P010 before the file
+    // write (see ProgramConfig::enableP010Output).
+    uint32_t m_enableP010Output : 1;
+    // Drop pictures whose decode result status reports an error instead of
+    // displaying or writing them (see DequeueValidDecodedPicture()).
+    uint32_t m_enableErrorResilience : 1;
+    // Demux watermark throttle (see ProgramConfig::parseAheadHighWatermark
+    // and ParserProcessNextDataChunk()): the demux pauses while the decoded
+    // backlog sits at the high mark and resumes at the low mark. Zero high
+    // mark disables the throttle.
+    int32_t m_parseAheadHighWatermarkFrames;
+    int32_t m_parseAheadLowWatermarkFrames;
+    bool    m_demuxThrottled;
     VkFrameVideoToFile m_frameToFile;
+    // Scaled file output (see ProgramConfig::scaledOutputWidth): when set,
+    // OutputFrameToFile() writes GPU-downsampled NV12 thumbnails instead of
+    // full-resolution frames. Zero crop extents scale the visible frame.
+    VkSharedBaseObj<VulkanFrameScaler> m_frameScaler;
+    VkRect2D  m_scaledOutputCrop;
+    uint32_t  m_scaledOutputWidth;
+    uint32_t  m_scaledOutputHeight;
     int32_t   m_loopCount;
+    // Per-loop-iteration FPS accounting (see ReportLoopIterationFps()).
+    uint32_t  m_loopIterationIndex;
+    uint64_t  m_loopIterationStartTimeNs;
+    uint64_t  m_steadyStateFrameCount;
+    uint64_t  m_steadyStateTimeNs;
     uint32_t  m_startFrame;
     int32_t   m_maxFrameCount;
+    // Initial stream position in nanoseconds (see ProgramConfig::startTime);
+    // Restart() re-seeks here on every loop.
+    int64_t   m_seekStartTimeNs;
+    // End of the decoded segment in nanoseconds (see ProgramConfig::stopTime);
+    // demuxing ends at the first keyframe at or after it, 0 decodes to the
+    // end of the stream.
+    int64_t   m_stopTimeNs;
+    // Keyframe-aligned segment start handling for the parallel GOP decode
+    // mode (see ProgramConfig::alignStartTimeToNextKeyFrame): while the
+    // awaiting flag is set, demuxed frames are dropped until the first
+    // keyframe at or after m_seekStartTimeNs.
+    uint32_t  m_alignStartTimeToNextKeyFrame : 1;
+    uint32_t  m_awaitingSegmentStartKeyFrame : 1;
+    // Per-frame latency trace state (see DumpFrameLatencyTrace()).
+    std::string                     m_frameLatencyTraceFile;
+    std::vector<FrameLatencyRecord> m_frameLatencyTrace;
+    // Stage-resolved transcode timing (--transcodeJson, see
+    // TranscodeBenchmark). Each stage is fed by a single thread - demux and
+    // parse by the parser, the frame stages by the consumer - so the
+    // per-stage sample vectors need no locking.
+    std::string                     m_transcodeBenchmarkJsonFile;
+    TranscodeBenchmark              m_transcodeBenchmark;
+    // Displayed frames not yet returned to the frame buffer (batched frame
+    // release mode only).
+    DecodedFrameRelease m_pendingFrameReleases[FRAME_RELEASE_BATCH_SIZE];
+    uint32_t            m_numPendingFrameReleases;
+    // Pipelined parsing state (see StartParserThread()).
+    std::mutex              m_parserMutex;
+    std::condition_variable m_parserWakeCond;
+    std::condition_variable m_parsedChunkCond;
+    uint32_t                m_parsedChunksAhead;
+    bool                    m_exitParserThread;
+    std::thread             m_parserThread;
+    std::string             m_parserThreadCpuSet;
+    // The stream is driven by the shared worker pool instead of a dedicated
+    // parser thread (see ParserServiceRunQuantum()).
+    bool                    m_useParserService;
 };
 
 #endif /* _VULKANVIDEOPROCESSOR_H_ */
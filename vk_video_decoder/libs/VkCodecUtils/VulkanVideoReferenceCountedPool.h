@@ -17,13 +17,33 @@
 #ifndef _VULKANVIDEOREFERENCECOUNTEDPOOL_H_
 #define _VULKANVIDEOREFERENCECOUNTEDPOOL_H_
 
+#include <array>
+#include <atomic>
 #include <vector>
-#include <bitset>
 #include <algorithm>
-#include <mutex>
 #include "VkVideoCore/VkVideoRefCountBase.h"
 
 
+// A fixed-capacity pool of reference-counted nodes with a lock-free
+// acquisition path. Each slot carries an atomic state word instead of the
+// previous pool-wide mutex plus bitsets, so concurrent acquirers (for ex.
+// the parser requesting bitstream buffers, while the decode thread returns
+// them by dropping the last external reference) never serialize on a lock:
+//
+//   SlotFree      - no node is installed in the slot.
+//   NodeAvailable - a node is installed and only the pool references it.
+//   NodeInFlight  - the node was handed out; it becomes reclaimable again
+//                   once the external references are dropped and only the
+//                   pool's own reference (refcount == 1) remains.
+//   NodeClaiming  - transient: exactly one thread owns the slot while it
+//                   installs a node or checks/copies the node's reference.
+//
+// Nodes are still recycled lazily: there is no explicit release call, so an
+// acquirer that finds no NodeAvailable slot probes the NodeInFlight ones,
+// claims them one at a time with a CAS to NodeClaiming and re-checks the
+// reference count. Holding NodeClaiming makes the refcount == 1 test stable:
+// a new reference to the node can only be minted by the pool, and the pool
+// hands nodes out only from slots it has claimed.
 template <class RefCountedNodeType, const size_t MAX_POOL_ENTRIES>
 class VulkanVideoRefCountedPool {
 
@@ -35,152 +55,183 @@ public:
     };
 
     VulkanVideoRefCountedPool(uint32_t maxNodes = 32)
-    : m_poolMutex()
-    , m_maxNodes(maxNodes)
-    , m_poolNodeSlotsInUseMask()
-    , m_poolNodesInUseMask()
-    , m_pool(MAX_POOL_ENTRIES) { }
+    : m_maxNodes(maxNodes)
+    , m_poolNodeState()
+    , m_pool(MAX_POOL_ENTRIES)
+    {
+        for (uint32_t i = 0; i < MAX_POOL_ENTRIES; i++) {
+            m_poolNodeState[i].store(SlotFree, std::memory_order_relaxed);
+        }
+    }
 
     virtual ~VulkanVideoRefCountedPool()
     {
-        std::lock_guard<std::mutex> lock(m_poolMutex);
-        uint32_t maxNodes = m_maxNodes;
-        m_maxNodes = 0; // make sure no additional nodes are added.
+        uint32_t maxNodes = m_maxNodes.exchange(0); // make sure no additional nodes are added.
         for (uint32_t i = 0; i < maxNodes; i++) {
             m_pool[i] = nullptr;
-            m_poolNodesInUseMask[i] = true;
+            m_poolNodeState[i].store(SlotFree, std::memory_order_relaxed);
         }
     }
 
     uint32_t SetMaxNodes(uint32_t maxNodes)
     {
-        std::lock_guard<std::mutex> lock(m_poolMutex);
-
-        m_maxNodes = std::min<uint32_t>(MAX_POOL_ENTRIES, maxNodes);
-        return m_maxNodes;
+        maxNodes = std::min<uint32_t>(MAX_POOL_ENTRIES, maxNodes);
+        m_maxNodes.store(maxNodes);
+        return maxNodes;
     }
 
     uint32_t GetMaxNodes()
     {
-        return m_maxNodes;
+        return m_maxNodes.load();
     }
 
     uint32_t VisitNodes(VulkanVideoRefCountedPoolIterator* it)
     {
-        std::lock_guard<std::mutex> lock(m_poolMutex);
-
-        for (uint32_t i = 0; i < m_maxNodes; i++) {
-            if (m_poolNodesInUseMask[i]) {
-                if (m_pool[i] && (1 == m_pool[i]->GetRefCount())) {
-                    m_poolNodesInUseMask[i] = false;
-                    it->VisitNode(m_pool[i], i, true, false);
-                }
-            } else if (m_pool[i]) {
-                assert(1 == m_pool[i]->GetRefCount());
-                it->VisitNode(m_pool[i], i, true, false);
-            } else {
-                it->VisitNode(m_pool[i], i, m_pool[i], m_poolNodesInUseMask[i]);
+        const uint32_t maxNodes = m_maxNodes.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < maxNodes; i++) {
+            uint32_t state = ClaimNodeSlot(i);
+            if (state == NodeClaiming) {
+                continue; // another thread owns the slot right now - skip it.
             }
+            const bool isValid = (m_pool[i] != nullptr);
+            const bool isAvailable = (state == NodeAvailable) ||
+                    ((state == NodeInFlight) && isValid && (1 == m_pool[i]->GetRefCount()));
+            it->VisitNode(m_pool[i], i, isValid, isAvailable);
+            m_poolNodeState[i].store(isAvailable ? NodeAvailable : state,
+                                     std::memory_order_release);
         }
-        return m_maxNodes;
+        return maxNodes;
     }
 
     uint32_t GetAvailableNodesNumber()
     {
-        std::lock_guard<std::mutex> lock(m_poolMutex);
-
-        uint32_t numFreeNodes = 0;
-        for (uint32_t i = 0; i < m_maxNodes; i++) {
-            if (m_poolNodesInUseMask[i]) {
+        const uint32_t maxNodes = m_maxNodes.load(std::memory_order_acquire);
+        uint32_t numAvailableNodes = 0;
+        for (uint32_t i = 0; i < maxNodes; i++) {
+            uint32_t state = ClaimNodeSlot(i);
+            if (state == NodeClaiming) {
+                continue;
+            }
+            if (state == NodeAvailable) {
+                numAvailableNodes++;
+                m_poolNodeState[i].store(NodeAvailable, std::memory_order_release);
+            } else if (state == NodeInFlight) {
+                // Reclaim the node if all of the external references are gone.
                 if (m_pool[i] && (1 == m_pool[i]->GetRefCount())) {
-                    m_poolNodesInUseMask[i] = false;
-                    numFreeNodes++;
+                    numAvailableNodes++;
+                    m_poolNodeState[i].store(NodeAvailable, std::memory_order_release);
+                } else {
+                    m_poolNodeState[i].store(NodeInFlight, std::memory_order_release);
                 }
-            } else if (m_pool[i]) {
-                assert(1 == m_pool[i]->GetRefCount());
-                numFreeNodes++;
+            } else {
+                m_poolNodeState[i].store(state, std::memory_order_release);
             }
         }
-        return numFreeNodes;
+        return numAvailableNodes;
     }
 
     int32_t GetAvailableNodeFromPool(VkSharedBaseObj<RefCountedNodeType>& availableNodeFromPool)
     {
-        std::lock_guard<std::mutex> lock(m_poolMutex);
-        int32_t availableNodeIndx = GetAvailableNodeIndx();
-        if (availableNodeIndx >= 0) {
-            assert((uint32_t)availableNodeIndx < m_maxNodes);
-            availableNodeFromPool = m_pool[availableNodeIndx];
+        const uint32_t maxNodes = m_maxNodes.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < maxNodes; i++) {
+            uint32_t state = ClaimNodeSlot(i);
+            if (state == NodeClaiming) {
+                continue; // another thread owns the slot right now - skip it.
+            }
+            if ((state == NodeAvailable) ||
+                    ((state == NodeInFlight) && m_pool[i] && (1 == m_pool[i]->GetRefCount()))) {
+                // The reference is copied while the slot is still claimed, so
+                // a concurrent acquirer can not observe refcount == 1 and hand
+                // the same node out twice.
+                availableNodeFromPool = m_pool[i];
+                m_poolNodeState[i].store(NodeInFlight, std::memory_order_release);
+                return i;
+            }
+            m_poolNodeState[i].store(state, std::memory_order_release);
         }
-        return availableNodeIndx;
+        return -1;
     }
 
     uint32_t GetFreeNodesNumber()
     {
-        std::lock_guard<std::mutex> lock(m_poolMutex);
-        return m_maxNodes - (uint32_t)m_poolNodeSlotsInUseMask.count();
+        const uint32_t maxNodes = m_maxNodes.load(std::memory_order_acquire);
+        uint32_t numFreeSlots = 0;
+        for (uint32_t i = 0; i < maxNodes; i++) {
+            if (m_poolNodeState[i].load(std::memory_order_acquire) == SlotFree) {
+                numFreeSlots++;
+            }
+        }
+        return numFreeSlots;
     }
 
     int32_t AddNodeToPool(VkSharedBaseObj<RefCountedNodeType>& newNodeToPool, bool setUnavailable)
     {
-        std::lock_guard<std::mutex> lock(m_poolMutex);
-        int32_t freeNodeSlotIndx = GetFreeNodeSlotIndx();
-        if (freeNodeSlotIndx >= 0) {
-            assert((uint32_t)freeNodeSlotIndx < m_maxNodes);
-            if (setUnavailable) {
-                m_poolNodesInUseMask[freeNodeSlotIndx] = true;
+        const uint32_t maxNodes = m_maxNodes.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < maxNodes; i++) {
+            uint32_t expected = SlotFree;
+            if (m_poolNodeState[i].compare_exchange_strong(expected, NodeClaiming,
+                                                           std::memory_order_acquire)) {
+                m_pool[i] = newNodeToPool;
+                m_poolNodeState[i].store(setUnavailable ? NodeInFlight : NodeAvailable,
+                                         std::memory_order_release);
+                return i;
             }
-            m_pool[freeNodeSlotIndx] = newNodeToPool;
         }
-        return freeNodeSlotIndx;
+        return -1;
     }
 
-private:
-    // These functions must be called with the m_poolMutex lock obtained unavailable
-    int32_t GetAvailableNodeIndx(bool setUnavailable = true) {
-        uint32_t i = 0;
-        for (; i < m_maxNodes; i++) {
-            if (m_poolNodesInUseMask[i]) {
-                if (m_pool[i] && (1 == m_pool[i]->GetRefCount())) {
-                    if (!setUnavailable) {
-                        m_poolNodesInUseMask[i] = false;
-                    }
-                    break;
-                }
-            } else if (m_pool[i]) {
-                assert(1 == m_pool[i]->GetRefCount());
-                if (setUnavailable) {
-                    m_poolNodesInUseMask[i] = true;
-                }
-                break;
+    // Removes one reclaimable node from the pool, freeing its slot, and
+    // hands the last reference out to the caller - the node's backing
+    // allocation is released when that reference is dropped. Used to shrink
+    // an idle pool; returns the freed slot index, or -1 when every node is
+    // still in flight.
+    int32_t RemoveAvailableNodeFromPool(VkSharedBaseObj<RefCountedNodeType>& removedNode)
+    {
+        const uint32_t maxNodes = m_maxNodes.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < maxNodes; i++) {
+            uint32_t state = ClaimNodeSlot(i);
+            if (state == NodeClaiming) {
+                continue; // another thread owns the slot right now - skip it.
+            }
+            if ((state == NodeAvailable) ||
+                    ((state == NodeInFlight) && m_pool[i] && (1 == m_pool[i]->GetRefCount()))) {
+                removedNode = m_pool[i];
+                m_pool[i] = nullptr;
+                m_poolNodeState[i].store(SlotFree, std::memory_order_release);
+                return i;
             }
+            m_poolNodeState[i].store(state, std::memory_order_release);
         }
-        return (i == m_maxNodes) ? -1 : i;
+        return -1;
     }
 
-    int32_t GetFreeNodeSlotIndx(bool allocate = true) {
-
-        if (!(m_poolNodeSlotsInUseMask.count() < m_maxNodes)) {
-            // No more slots are available
-            return -1;
-        }
+private:
+    enum NodeState : uint32_t {
+        SlotFree      = 0,
+        NodeAvailable = 1,
+        NodeInFlight  = 2,
+        NodeClaiming  = 3,
+    };
 
-        for (uint32_t i = 0; i < m_maxNodes; i++) {
-            if (m_poolNodeSlotsInUseMask[i] == false) {
-                if (allocate) {
-                    m_poolNodeSlotsInUseMask[i] = true;
-                }
-                return i;
+    // Claim exclusive ownership of the slot by moving whatever stable state
+    // it is in to NodeClaiming. Returns the previous state, or NodeClaiming
+    // if another thread already owns the slot. On success the caller must
+    // publish a stable state again with a release store.
+    uint32_t ClaimNodeSlot(uint32_t nodeIndx)
+    {
+        uint32_t state = m_poolNodeState[nodeIndx].load(std::memory_order_acquire);
+        while (state != NodeClaiming) {
+            if (m_poolNodeState[nodeIndx].compare_exchange_weak(state, NodeClaiming,
+                                                                std::memory_order_acquire)) {
+                return state;
             }
         }
-        return -1;
+        return NodeClaiming;
     }
 
 private:
-    std::mutex                                         m_poolMutex;
-    uint32_t                                           m_maxNodes;
-    std::bitset<MAX_POOL_ENTRIES>                      m_poolNodeSlotsInUseMask;
-    std::bitset<MAX_POOL_ENTRIES>                      m_poolNodesInUseMask;
+    std::atomic<uint32_t>                              m_maxNodes;
+    std::array<std::atomic<uint32_t>, MAX_POOL_ENTRIES> m_poolNodeState;
     std::vector<VkSharedBaseObj<RefCountedNodeType>>   m_pool;
 };
 
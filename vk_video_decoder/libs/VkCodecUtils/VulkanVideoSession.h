@@ -101,6 +101,12 @@ public:
 
     VkVideoSessionKHR GetVideoSession() const { return m_videoSession; }
 
+    // The limits the session was created with - a new sequence staying
+    // within them can reuse the session without a pipeline drain (see
+    // VkVideoDecoder::IsSequenceCompatibleWithCurrentConfig()).
+    const VkExtent2D& GetMaxCodedExtent() const { return m_createInfo.maxCodedExtent; }
+    uint32_t GetMaxDpbSlots() const { return m_createInfo.maxDpbSlots; }
+
 private:
 
     VulkanVideoSession(const VulkanDeviceContext* vkDevCtx,
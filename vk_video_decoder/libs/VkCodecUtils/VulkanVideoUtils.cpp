@@ -14,6 +14,7 @@
 * limitations under the License.
 */
 
+#include <algorithm>
 #include <vector>
 #include <vulkan_interfaces.h>
 #include "pattern.h"
@@ -24,6 +25,12 @@
 #include "VulkanVideoUtils.h"
 #include <nvidia_utils/vulkan/ycbcrvkinfo.h>
 
+#if defined(HAVE_PRECOMPILED_DISPLAY_SHADERS)
+// Generated at build time by the glsl-to-spirv step from
+// demos/vk-video-dec/VulkanVideoDisplay.vert.
+#include "VulkanVideoDisplay.vert.h"
+#endif
+
 // Vulkan call wrapper
 #define CALL_VK(func)                                                 \
   if (VK_SUCCESS != (func)) {                                         \
@@ -1035,9 +1042,9 @@ VkResult VulkanVertexBuffer::CreateVertexBuffer(const VulkanDeviceContext* vkDev
     return VK_SUCCESS;
 }
 
-VkResult VulkanDescriptorSet::WriteDescriptorSet(VkSampler sampler,
-                                                 VkImageView imageView, uint32_t dstArrayElement,
-                                                 VkImageLayout imageLayout)
+VkResult VulkanDescriptorSet::WriteImageDescriptor(VkDescriptorSet dstSet, VkSampler sampler,
+                                                   VkImageView imageView, uint32_t dstArrayElement,
+                                                   VkImageLayout imageLayout)
 {
     VkDescriptorImageInfo imageDsts;
     imageDsts.sampler = sampler;
@@ -1047,7 +1054,7 @@ VkResult VulkanDescriptorSet::WriteDescriptorSet(VkSampler sampler,
     VkWriteDescriptorSet writeDst = VkWriteDescriptorSet();
     writeDst.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     writeDst.pNext = nullptr;
-    writeDst.dstSet = descSet;
+    writeDst.dstSet = dstSet;
     writeDst.dstBinding = 0;
     writeDst.dstArrayElement = dstArrayElement;
     writeDst.descriptorCount = 1;
@@ -1060,6 +1067,55 @@ VkResult VulkanDescriptorSet::WriteDescriptorSet(VkSampler sampler,
     return VK_SUCCESS;
 }
 
+VkResult VulkanDescriptorSet::WriteDescriptorSet(VkSampler sampler,
+                                                 VkImageView imageView, uint32_t dstArrayElement,
+                                                 VkImageLayout imageLayout)
+{
+    return WriteImageDescriptor(descSet, sampler, imageView, dstArrayElement, imageLayout);
+}
+
+const VkDescriptorSet* VulkanDescriptorSet::GetCachedDescriptorSet(VkSampler sampler,
+                                                                   VkImageView imageView,
+                                                                   VkImageLayout imageLayout)
+{
+    for (size_t cacheIndex = 0; cacheIndex < cachedImageViews.size(); cacheIndex++) {
+        if (cachedImageViews[cacheIndex] == imageView) {
+            return &cachedDescSets[cacheIndex];
+        }
+    }
+
+    if (cachedDescSets.size() >= MAX_CACHED_DESCRIPTOR_SETS) {
+        // More distinct views than the cache covers - fall back to
+        // rewriting the shared set, as the pre-cache path did every frame.
+        WriteDescriptorSet(sampler, imageView, 0, imageLayout);
+        return &descSet;
+    }
+
+    if (cachedDescSets.capacity() == 0) {
+        // The returned pointers must stay valid while the cache grows.
+        cachedImageViews.reserve(MAX_CACHED_DESCRIPTOR_SETS);
+        cachedDescSets.reserve(MAX_CACHED_DESCRIPTOR_SETS);
+    }
+
+    VkDescriptorSetAllocateInfo alloc_info = VkDescriptorSetAllocateInfo();
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.pNext = nullptr;
+    alloc_info.descriptorPool = descPool;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &dscLayout;
+    VkDescriptorSet newDescSet = VkDescriptorSet(0);
+    VkResult result = m_vkDevCtx->AllocateDescriptorSets(*m_vkDevCtx, &alloc_info, &newDescSet);
+    if (result != VK_SUCCESS) {
+        WriteDescriptorSet(sampler, imageView, 0, imageLayout);
+        return &descSet;
+    }
+
+    WriteImageDescriptor(newDescSet, sampler, imageView, 0, imageLayout);
+    cachedImageViews.push_back(imageView);
+    cachedDescSets.push_back(newDescSet);
+    return &cachedDescSets.back();
+}
+
 VkResult VulkanDescriptorSet::CreateFragmentShaderOutput(VkDescriptorType outMode, uint32_t outSet, uint32_t outBinding, uint32_t outArrayIndex, std::stringstream& imageFss)
 {
     switch (outMode) {
@@ -1190,14 +1246,18 @@ VkResult VulkanDescriptorSet::CreateDescriptorSet(const VulkanDeviceContext* vkD
 
     if (descPool == VkDescriptorPool(0)) {
 
+        // Sized for the shared set plus the per-image-view cached sets
+        // (see GetCachedDescriptorSet()).
         VkDescriptorPoolSize type_count = VkDescriptorPoolSize();
         type_count.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        type_count.descriptorCount = descriptorCount * maxCombinedImageSamplerDescriptorCount;
+        type_count.descriptorCount = descriptorCount * maxCombinedImageSamplerDescriptorCount *
+                                     (1 + MAX_CACHED_DESCRIPTOR_SETS);
 
         VkDescriptorPoolCreateInfo descriptor_pool = VkDescriptorPoolCreateInfo();
         descriptor_pool.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
         descriptor_pool.pNext = nullptr;
-        descriptor_pool.maxSets = 1;
+        descriptor_pool.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+        descriptor_pool.maxSets = 1 + MAX_CACHED_DESCRIPTOR_SETS;
         descriptor_pool.poolSizeCount = 1;
         descriptor_pool.pPoolSizes = &type_count;
         CALL_VK(m_vkDevCtx->CreateDescriptorPool(*m_vkDevCtx, &descriptor_pool, nullptr, &descPool));
@@ -1221,12 +1281,15 @@ VkResult VulkanGraphicsPipeline::CreateGraphicsPipeline(const VulkanDeviceContex
     m_vkDevCtx = vkDevCtx;
 
     if (cache == VkPipelineCache(0)) {
-        // Create the pipeline cache
+        // Create the pipeline cache, primed from the on-disk blob when the
+        // shader cache directory is enabled (see SetShaderCacheDirectory()).
+        std::vector<uint8_t> pipelineCacheData =
+                VulkanShaderCompiler::LoadPipelineCacheData(m_vkDevCtx, "display");
         VkPipelineCacheCreateInfo pipelineCacheInfo = VkPipelineCacheCreateInfo();
         pipelineCacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
         pipelineCacheInfo.pNext = nullptr;
-        pipelineCacheInfo.initialDataSize = 0;
-        pipelineCacheInfo.pInitialData = nullptr;
+        pipelineCacheInfo.initialDataSize = pipelineCacheData.size();
+        pipelineCacheInfo.pInitialData = pipelineCacheData.empty() ? nullptr : pipelineCacheData.data();
         pipelineCacheInfo.flags = 0;  // reserved, must be 0
         CALL_VK(m_vkDevCtx->CreatePipelineCache(*m_vkDevCtx, &pipelineCacheInfo, nullptr, &cache));
     }
@@ -1239,6 +1302,8 @@ VkResult VulkanGraphicsPipeline::CreateGraphicsPipeline(const VulkanDeviceContex
     dynamicStateInfo.pDynamicStates = nullptr;
 
     // See https://vkguide.dev/docs/chapter-3/push_constants/
+    // Runtime fallback when the build did not embed the precompiled
+    // SPIR-V - keep in sync with demos/vk-video-dec/VulkanVideoDisplay.vert.
     static char const vss[] =
         "#version 450 core\n"
         "layout(location = 0) in vec2 aVertex;\n"
@@ -1286,9 +1351,24 @@ VkResult VulkanGraphicsPipeline::CreateGraphicsPipeline(const VulkanDeviceContex
     } else {
 
         if (mVertexShaderCache == VkShaderModule(0)) {
+#if defined(HAVE_PRECOMPILED_DISPLAY_SHADERS)
+            // The vertex shader is fixed, so the SPIR-V embedded at build
+            // time is used directly; only the YCbCr-sampler dependent
+            // fragment shader permutations below still go through the
+            // runtime compiler.
+            VkShaderModuleCreateInfo shaderModuleCreateInfo = VkShaderModuleCreateInfo();
+            shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            shaderModuleCreateInfo.pNext = nullptr;
+            shaderModuleCreateInfo.codeSize = sizeof(VulkanVideoDisplay_vert);
+            shaderModuleCreateInfo.pCode = VulkanVideoDisplay_vert;
+            shaderModuleCreateInfo.flags = 0;
+            CALL_VK(m_vkDevCtx->CreateShaderModule(*m_vkDevCtx, &shaderModuleCreateInfo,
+                                                   nullptr, &mVertexShaderCache));
+#else
             mVulkanShaderCompiler.BuildGlslShader(vss, strlen(vss),
                     VK_SHADER_STAGE_VERTEX_BIT,
                     m_vkDevCtx, &mVertexShaderCache);
+#endif
         }
 
         if (mFssCache.str() != imageFss.str()) {
@@ -1423,6 +1503,21 @@ VkResult VulkanGraphicsPipeline::CreateGraphicsPipeline(const VulkanDeviceContex
                                                                   &pipelineCreateInfo,
                                                                   nullptr, &pipeline);
 
+    if ((pipelineResult == VK_SUCCESS) &&
+            !VulkanShaderCompiler::GetShaderCacheDirectory().empty()) {
+        // Persist the pipeline cache so the next process start can skip the
+        // pipeline compilation.
+        size_t cacheDataSize = 0;
+        if ((m_vkDevCtx->GetPipelineCacheData(*m_vkDevCtx, cache, &cacheDataSize, nullptr) == VK_SUCCESS) &&
+                (cacheDataSize > 0)) {
+            std::vector<uint8_t> cacheData(cacheDataSize);
+            if (m_vkDevCtx->GetPipelineCacheData(*m_vkDevCtx, cache, &cacheDataSize, cacheData.data()) == VK_SUCCESS) {
+                VulkanShaderCompiler::SavePipelineCacheData(m_vkDevCtx, "display",
+                                                            cacheData.data(), cacheDataSize);
+            }
+        }
+    }
+
     return pipelineResult;
 }
 
@@ -1444,16 +1539,459 @@ VkResult VulkanCommandBuffer::CreateCommandBuffer(VkRenderPass renderPass, const
         CALL_VK(m_vkDevCtx->AllocateCommandBuffers(*m_vkDevCtx, &cmdBufferCreateInfo, &cmdBuffer));
     }
 
+    return RecordDrawCommands(cmdBuffer, renderPass, inputImageToDrawFrom,
+                              displayWidth, displayHeight,
+                              displayImage, framebuffer, pRenderArea,
+                              pipeline, pipelineLayout, pDescriptorSet,
+                              pVertexBuffer);
+}
+
+const VkCommandBuffer* VulkanCommandBuffer::GetOrRecordCommandBuffer(VkRenderPass renderPass,
+        const ImageResourceInfo* inputImageToDrawFrom,
+        int32_t displayWidth, int32_t displayHeight,
+        VkImage displayImage, VkFramebuffer framebuffer, VkRect2D* pRenderArea,
+        VkPipeline pipeline, VkPipelineLayout pipelineLayout, const VkDescriptorSet* pDescriptorSet,
+        VulkanVertexBuffer* pVertexBuffer)
+{
+    for (size_t entryIndex = 0; entryIndex < preRecordedDraws.size(); entryIndex++) {
+        const PreRecordedDraw& entry = preRecordedDraws[entryIndex];
+        if ((entry.inputView == inputImageToDrawFrom->view) &&
+                (entry.pipeline == pipeline) &&
+                (entry.descriptorSet == *pDescriptorSet) &&
+                (entry.displayWidth == displayWidth) &&
+                (entry.displayHeight == displayHeight)) {
+            return &preRecordedDraws[entryIndex].cmdBuffer;
+        }
+    }
+
+    if (preRecordedDraws.size() >= MAX_PRERECORDED_COMMAND_BUFFERS) {
+        // More distinct draws than the cache covers - fall back to
+        // re-recording the shared command buffer, as before.
+        CreateCommandBuffer(renderPass, inputImageToDrawFrom,
+                            displayWidth, displayHeight,
+                            displayImage, framebuffer, pRenderArea,
+                            pipeline, pipelineLayout, pDescriptorSet,
+                            pVertexBuffer);
+        return &cmdBuffer;
+    }
+
+    if (preRecordedDraws.capacity() == 0) {
+        // The returned pointers must stay valid while the cache grows.
+        preRecordedDraws.reserve(MAX_PRERECORDED_COMMAND_BUFFERS);
+    }
+
+    VkCommandBufferAllocateInfo cmdBufferCreateInfo = VkCommandBufferAllocateInfo();
+    cmdBufferCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmdBufferCreateInfo.pNext = nullptr;
+    cmdBufferCreateInfo.commandPool = cmdPool;
+    cmdBufferCreateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmdBufferCreateInfo.commandBufferCount = 1;
+
+    PreRecordedDraw newEntry = PreRecordedDraw();
+    newEntry.inputView = inputImageToDrawFrom->view;
+    newEntry.pipeline = pipeline;
+    newEntry.descriptorSet = *pDescriptorSet;
+    newEntry.displayWidth = displayWidth;
+    newEntry.displayHeight = displayHeight;
+    VkResult result = m_vkDevCtx->AllocateCommandBuffers(*m_vkDevCtx, &cmdBufferCreateInfo, &newEntry.cmdBuffer);
+    if (result != VK_SUCCESS) {
+        // Could not grow the cache - fall back to re-recording the shared
+        // command buffer, as before.
+        CreateCommandBuffer(renderPass, inputImageToDrawFrom,
+                            displayWidth, displayHeight,
+                            displayImage, framebuffer, pRenderArea,
+                            pipeline, pipelineLayout, pDescriptorSet,
+                            pVertexBuffer);
+        return &cmdBuffer;
+    }
+
+    RecordDrawCommands(newEntry.cmdBuffer, renderPass, inputImageToDrawFrom,
+                       displayWidth, displayHeight,
+                       displayImage, framebuffer, pRenderArea,
+                       pipeline, pipelineLayout, pDescriptorSet,
+                       pVertexBuffer);
+
+    preRecordedDraws.push_back(newEntry);
+    return &preRecordedDraws.back().cmdBuffer;
+}
+
+const VkCommandBuffer* VulkanCommandBuffer::GetOrRecordScanoutCopyCommandBuffer(
+        const ImageResourceInfo* inputImageToCopyFrom,
+        int32_t displayWidth, int32_t displayHeight,
+        VkImage displayImage, const VkExtent2D& displayImageExtent)
+{
+    // The scanout copy stream has no pipeline or descriptor set, so the
+    // null handles keep its cache entries distinct from the draw streams.
+    const VkImageView inputView = inputImageToCopyFrom ? inputImageToCopyFrom->view : VkImageView(0);
+    for (size_t entryIndex = 0; entryIndex < preRecordedDraws.size(); entryIndex++) {
+        const PreRecordedDraw& entry = preRecordedDraws[entryIndex];
+        if ((entry.inputView == inputView) &&
+                (entry.pipeline == VkPipeline(0)) &&
+                (entry.descriptorSet == VkDescriptorSet(0)) &&
+                (entry.displayWidth == displayWidth) &&
+                (entry.displayHeight == displayHeight)) {
+            return &preRecordedDraws[entryIndex].cmdBuffer;
+        }
+    }
+
+    VkCommandBufferAllocateInfo cmdBufferCreateInfo = VkCommandBufferAllocateInfo();
+    cmdBufferCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cmdBufferCreateInfo.pNext = nullptr;
+    cmdBufferCreateInfo.commandPool = cmdPool;
+    cmdBufferCreateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmdBufferCreateInfo.commandBufferCount = 1;
+
+    if (preRecordedDraws.size() >= MAX_PRERECORDED_COMMAND_BUFFERS) {
+        // More distinct copies than the cache covers - fall back to
+        // re-recording the shared command buffer.
+        if (cmdBuffer == VkCommandBuffer(0)) {
+            CALL_VK(m_vkDevCtx->AllocateCommandBuffers(*m_vkDevCtx, &cmdBufferCreateInfo, &cmdBuffer));
+        }
+        RecordScanoutCopyCommands(cmdBuffer, inputImageToCopyFrom,
+                                  displayWidth, displayHeight,
+                                  displayImage, displayImageExtent);
+        return &cmdBuffer;
+    }
+
+    if (preRecordedDraws.capacity() == 0) {
+        // The returned pointers must stay valid while the cache grows.
+        preRecordedDraws.reserve(MAX_PRERECORDED_COMMAND_BUFFERS);
+    }
+
+    PreRecordedDraw newEntry = PreRecordedDraw();
+    newEntry.inputView = inputView;
+    newEntry.pipeline = VkPipeline(0);
+    newEntry.descriptorSet = VkDescriptorSet(0);
+    newEntry.displayWidth = displayWidth;
+    newEntry.displayHeight = displayHeight;
+    VkResult result = m_vkDevCtx->AllocateCommandBuffers(*m_vkDevCtx, &cmdBufferCreateInfo, &newEntry.cmdBuffer);
+    if (result != VK_SUCCESS) {
+        // Could not grow the cache - fall back to re-recording the shared
+        // command buffer.
+        if (cmdBuffer == VkCommandBuffer(0)) {
+            CALL_VK(m_vkDevCtx->AllocateCommandBuffers(*m_vkDevCtx, &cmdBufferCreateInfo, &cmdBuffer));
+        }
+        RecordScanoutCopyCommands(cmdBuffer, inputImageToCopyFrom,
+                                  displayWidth, displayHeight,
+                                  displayImage, displayImageExtent);
+        return &cmdBuffer;
+    }
+
+    RecordScanoutCopyCommands(newEntry.cmdBuffer, inputImageToCopyFrom,
+                              displayWidth, displayHeight,
+                              displayImage, displayImageExtent);
+
+    preRecordedDraws.push_back(newEntry);
+    return &preRecordedDraws.back().cmdBuffer;
+}
+
+VkResult VulkanCommandBuffer::RecordScanoutCopyCommands(VkCommandBuffer recordCmdBuffer,
+        const ImageResourceInfo* inputImageToCopyFrom,
+        int32_t displayWidth, int32_t displayHeight,
+        VkImage displayImage, const VkExtent2D& displayImageExtent)
+{
+    VkCommandBufferBeginInfo cmdBufferBeginInfo = VkCommandBufferBeginInfo();
+    cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cmdBufferBeginInfo.pNext = nullptr;
+    cmdBufferBeginInfo.flags = 0;
+    cmdBufferBeginInfo.pInheritanceInfo = nullptr;
+    CALL_VK(m_vkDevCtx->BeginCommandBuffer(recordCmdBuffer, &cmdBufferBeginInfo));
+
+    ImageLayoutBarrierBatch layoutBarrierBatch;
+    if (inputImageToCopyFrom == nullptr) {
+        // Nothing decoded yet - only make the (undefined) swapchain image
+        // presentable.
+        layoutBarrierBatch.AddImageBarrier(displayImage,
+                       VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                       VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+        layoutBarrierBatch.RecordAndReset(m_vkDevCtx, recordCmdBuffer);
+
+        CALL_VK(m_vkDevCtx->EndCommandBuffer(recordCmdBuffer));
+        return VK_SUCCESS;
+    }
+
+    const VkMpFormatInfo* pFormatInfo = YcbcrVkFormatInfo(inputImageToCopyFrom->imageFormat);
+    const uint32_t numPlanes = pFormatInfo ?
+            ((uint32_t)pFormatInfo->planesLayout.numberOfExtraPlanes + 1) : 1;
+    assert(numPlanes <= 3);
+
+    layoutBarrierBatch.AddImageBarrier(displayImage,
+                   VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    for (uint32_t planeIndx = 0; planeIndx < numPlanes; planeIndx++) {
+        const VkImageAspectFlags planeAspect = pFormatInfo ?
+                (VkImageAspectFlags)(VK_IMAGE_ASPECT_PLANE_0_BIT_KHR << planeIndx) :
+                (VkImageAspectFlags)VK_IMAGE_ASPECT_COLOR_BIT;
+        layoutBarrierBatch.AddImageBarrier(inputImageToCopyFrom->image,
+                       VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                       VK_PIPELINE_STAGE_2_VIDEO_DECODE_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       planeAspect);
+    }
+    layoutBarrierBatch.RecordAndReset(m_vkDevCtx, recordCmdBuffer);
+
+    // The copy engine cannot scale: present the intersection of the video
+    // and the display mode, leaving any border of a larger mode untouched.
+    const uint32_t copyWidth = std::min((uint32_t)displayWidth, displayImageExtent.width);
+    const uint32_t copyHeight = std::min((uint32_t)displayHeight, displayImageExtent.height);
+
+    VkImageCopy copyRegions[3] = {};
+    for (uint32_t planeIndx = 0; planeIndx < numPlanes; planeIndx++) {
+        const VkImageAspectFlags planeAspect = pFormatInfo ?
+                (VkImageAspectFlags)(VK_IMAGE_ASPECT_PLANE_0_BIT_KHR << planeIndx) :
+                (VkImageAspectFlags)VK_IMAGE_ASPECT_COLOR_BIT;
+        uint32_t planeWidth = copyWidth;
+        uint32_t planeHeight = copyHeight;
+        if ((planeIndx > 0) && pFormatInfo) {
+            // Secondary plane extents are in (possibly subsampled) plane
+            // texels, rounded up for odd video sizes.
+            if (pFormatInfo->planesLayout.secondaryPlaneSubsampledX) {
+                planeWidth = (planeWidth + 1) / 2;
+            }
+            if (pFormatInfo->planesLayout.secondaryPlaneSubsampledY) {
+                planeHeight = (planeHeight + 1) / 2;
+            }
+        }
+        VkImageCopy& region = copyRegions[planeIndx];
+        region.srcSubresource.aspectMask = planeAspect;
+        region.srcSubresource.mipLevel = 0;
+        region.srcSubresource.baseArrayLayer = inputImageToCopyFrom->arrayLayer;
+        region.srcSubresource.layerCount = 1;
+        region.dstSubresource.aspectMask = planeAspect;
+        region.dstSubresource.mipLevel = 0;
+        region.dstSubresource.baseArrayLayer = 0;
+        region.dstSubresource.layerCount = 1;
+        region.extent = { planeWidth, planeHeight, 1 };
+    }
+
+    m_vkDevCtx->CmdCopyImage(recordCmdBuffer,
+                             inputImageToCopyFrom->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                             displayImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                             numPlanes, copyRegions);
+
+    // The reverse transitions back to present / decode destination are
+    // batched the same way.
+    layoutBarrierBatch.AddImageBarrier(displayImage,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    for (uint32_t planeIndx = 0; planeIndx < numPlanes; planeIndx++) {
+        const VkImageAspectFlags planeAspect = pFormatInfo ?
+                (VkImageAspectFlags)(VK_IMAGE_ASPECT_PLANE_0_BIT_KHR << planeIndx) :
+                (VkImageAspectFlags)VK_IMAGE_ASPECT_COLOR_BIT;
+        layoutBarrierBatch.AddImageBarrier(inputImageToCopyFrom->image,
+                       VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_2_VIDEO_DECODE_BIT_KHR,
+                       planeAspect);
+    }
+    layoutBarrierBatch.RecordAndReset(m_vkDevCtx, recordCmdBuffer);
+
+    CALL_VK(m_vkDevCtx->EndCommandBuffer(recordCmdBuffer));
+
+    return VK_SUCCESS;
+}
+
+const VkCommandBuffer* VulkanCommandBuffer::GetOrRecordMosaicCopyCommandBuffer(
+        const MosaicCopyTile* pTiles, uint32_t numTiles,
+        VkImage displayImage, const VkExtent2D& displayImageExtent)
+{
+    // The composite depends on every stream's current decode view, so a
+    // cache keyed on a single input view does not apply - the shared
+    // command buffer is re-recorded each display frame.
+    if (cmdBuffer == VkCommandBuffer(0)) {
+        VkCommandBufferAllocateInfo cmdBufferCreateInfo = VkCommandBufferAllocateInfo();
+        cmdBufferCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        cmdBufferCreateInfo.pNext = nullptr;
+        cmdBufferCreateInfo.commandPool = cmdPool;
+        cmdBufferCreateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmdBufferCreateInfo.commandBufferCount = 1;
+        CALL_VK(m_vkDevCtx->AllocateCommandBuffers(*m_vkDevCtx, &cmdBufferCreateInfo, &cmdBuffer));
+    }
+
+    RecordMosaicCopyCommands(cmdBuffer, pTiles, numTiles,
+                             displayImage, displayImageExtent);
+    return &cmdBuffer;
+}
+
+VkResult VulkanCommandBuffer::RecordMosaicCopyCommands(VkCommandBuffer recordCmdBuffer,
+        const MosaicCopyTile* pTiles, uint32_t numTiles,
+        VkImage displayImage, const VkExtent2D& displayImageExtent)
+{
+    VkCommandBufferBeginInfo cmdBufferBeginInfo = VkCommandBufferBeginInfo();
+    cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cmdBufferBeginInfo.pNext = nullptr;
+    cmdBufferBeginInfo.flags = 0;
+    cmdBufferBeginInfo.pInheritanceInfo = nullptr;
+    CALL_VK(m_vkDevCtx->BeginCommandBuffer(recordCmdBuffer, &cmdBufferBeginInfo));
+
+    uint32_t numActiveTiles = 0;
+    for (uint32_t tileIndx = 0; tileIndx < numTiles; tileIndx++) {
+        if (pTiles[tileIndx].inputImage != nullptr) {
+            numActiveTiles++;
+        }
+    }
+
+    ImageLayoutBarrierBatch layoutBarrierBatch;
+    if (numActiveTiles == 0) {
+        // Nothing decoded yet on any stream - only make the (undefined)
+        // swapchain image presentable.
+        layoutBarrierBatch.AddImageBarrier(displayImage,
+                       VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                       VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+        layoutBarrierBatch.RecordAndReset(m_vkDevCtx, recordCmdBuffer);
+
+        CALL_VK(m_vkDevCtx->EndCommandBuffer(recordCmdBuffer));
+        return VK_SUCCESS;
+    }
+
+    // All the transitions to the transfer layouts are batched into as few
+    // barriers as the batch capacity allows, the copies of every tile follow
+    // and the reverse transitions close the buffer - the same bracketing as
+    // the single-stream scanout copy, just over the whole tile set. The
+    // batch holds MAX_BARRIERS entries, so it is flushed at a tile boundary
+    // whenever the next tile's plane set no longer fits.
+    layoutBarrierBatch.AddImageBarrier(displayImage,
+                   VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    for (uint32_t tileIndx = 0; tileIndx < numTiles; tileIndx++) {
+        const MosaicCopyTile& tile = pTiles[tileIndx];
+        if (tile.inputImage == nullptr) {
+            continue;
+        }
+        const VkMpFormatInfo* pFormatInfo = YcbcrVkFormatInfo(tile.inputImage->imageFormat);
+        const uint32_t numPlanes = pFormatInfo ?
+                ((uint32_t)pFormatInfo->planesLayout.numberOfExtraPlanes + 1) : 1;
+        assert(numPlanes <= 3);
+        if (!layoutBarrierBatch.HasSpaceFor(numPlanes)) {
+            layoutBarrierBatch.RecordAndReset(m_vkDevCtx, recordCmdBuffer);
+        }
+        for (uint32_t planeIndx = 0; planeIndx < numPlanes; planeIndx++) {
+            const VkImageAspectFlags planeAspect = pFormatInfo ?
+                    (VkImageAspectFlags)(VK_IMAGE_ASPECT_PLANE_0_BIT_KHR << planeIndx) :
+                    (VkImageAspectFlags)VK_IMAGE_ASPECT_COLOR_BIT;
+            layoutBarrierBatch.AddImageBarrier(tile.inputImage->image,
+                           VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           VK_PIPELINE_STAGE_2_VIDEO_DECODE_BIT_KHR, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           planeAspect);
+        }
+    }
+    layoutBarrierBatch.RecordAndReset(m_vkDevCtx, recordCmdBuffer);
+
+    for (uint32_t tileIndx = 0; tileIndx < numTiles; tileIndx++) {
+
+        const MosaicCopyTile& tile = pTiles[tileIndx];
+        if (tile.inputImage == nullptr) {
+            continue;
+        }
+
+        const VkMpFormatInfo* pFormatInfo = YcbcrVkFormatInfo(tile.inputImage->imageFormat);
+        const uint32_t numPlanes = pFormatInfo ?
+                ((uint32_t)pFormatInfo->planesLayout.numberOfExtraPlanes + 1) : 1;
+
+        // The copy engine cannot scale: each tile shows the intersection of
+        // its video and its cell, clipped against the swapchain extent.
+        if (((uint32_t)tile.tileRect.offset.x >= displayImageExtent.width) ||
+                ((uint32_t)tile.tileRect.offset.y >= displayImageExtent.height)) {
+            continue;
+        }
+        const uint32_t copyWidth = std::min(std::min((uint32_t)tile.displayWidth, tile.tileRect.extent.width),
+                                            displayImageExtent.width - (uint32_t)tile.tileRect.offset.x);
+        const uint32_t copyHeight = std::min(std::min((uint32_t)tile.displayHeight, tile.tileRect.extent.height),
+                                             displayImageExtent.height - (uint32_t)tile.tileRect.offset.y);
+        if ((copyWidth == 0) || (copyHeight == 0)) {
+            continue;
+        }
+
+        VkImageCopy copyRegions[3] = {};
+        for (uint32_t planeIndx = 0; planeIndx < numPlanes; planeIndx++) {
+            const VkImageAspectFlags planeAspect = pFormatInfo ?
+                    (VkImageAspectFlags)(VK_IMAGE_ASPECT_PLANE_0_BIT_KHR << planeIndx) :
+                    (VkImageAspectFlags)VK_IMAGE_ASPECT_COLOR_BIT;
+            uint32_t planeWidth = copyWidth;
+            uint32_t planeHeight = copyHeight;
+            int32_t planeOffsetX = tile.tileRect.offset.x;
+            int32_t planeOffsetY = tile.tileRect.offset.y;
+            if ((planeIndx > 0) && pFormatInfo) {
+                // Secondary plane extents and offsets are in (possibly
+                // subsampled) plane texels; the cell offsets are even, so
+                // the halving is exact.
+                if (pFormatInfo->planesLayout.secondaryPlaneSubsampledX) {
+                    planeWidth = (planeWidth + 1) / 2;
+                    planeOffsetX /= 2;
+                }
+                if (pFormatInfo->planesLayout.secondaryPlaneSubsampledY) {
+                    planeHeight = (planeHeight + 1) / 2;
+                    planeOffsetY /= 2;
+                }
+            }
+            VkImageCopy& region = copyRegions[planeIndx];
+            region.srcSubresource.aspectMask = planeAspect;
+            region.srcSubresource.mipLevel = 0;
+            region.srcSubresource.baseArrayLayer = tile.inputImage->arrayLayer;
+            region.srcSubresource.layerCount = 1;
+            region.dstSubresource.aspectMask = planeAspect;
+            region.dstSubresource.mipLevel = 0;
+            region.dstSubresource.baseArrayLayer = 0;
+            region.dstSubresource.layerCount = 1;
+            region.dstOffset = { planeOffsetX, planeOffsetY, 0 };
+            region.extent = { planeWidth, planeHeight, 1 };
+        }
+
+        m_vkDevCtx->CmdCopyImage(recordCmdBuffer,
+                                 tile.inputImage->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                 displayImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                 numPlanes, copyRegions);
+    }
+
+    layoutBarrierBatch.AddImageBarrier(displayImage,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+                   VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+    for (uint32_t tileIndx = 0; tileIndx < numTiles; tileIndx++) {
+        const MosaicCopyTile& tile = pTiles[tileIndx];
+        if (tile.inputImage == nullptr) {
+            continue;
+        }
+        const VkMpFormatInfo* pFormatInfo = YcbcrVkFormatInfo(tile.inputImage->imageFormat);
+        const uint32_t numPlanes = pFormatInfo ?
+                ((uint32_t)pFormatInfo->planesLayout.numberOfExtraPlanes + 1) : 1;
+        if (!layoutBarrierBatch.HasSpaceFor(numPlanes)) {
+            layoutBarrierBatch.RecordAndReset(m_vkDevCtx, recordCmdBuffer);
+        }
+        for (uint32_t planeIndx = 0; planeIndx < numPlanes; planeIndx++) {
+            const VkImageAspectFlags planeAspect = pFormatInfo ?
+                    (VkImageAspectFlags)(VK_IMAGE_ASPECT_PLANE_0_BIT_KHR << planeIndx) :
+                    (VkImageAspectFlags)VK_IMAGE_ASPECT_COLOR_BIT;
+            layoutBarrierBatch.AddImageBarrier(tile.inputImage->image,
+                           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR,
+                           VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_2_VIDEO_DECODE_BIT_KHR,
+                           planeAspect);
+        }
+    }
+    layoutBarrierBatch.RecordAndReset(m_vkDevCtx, recordCmdBuffer);
+
+    CALL_VK(m_vkDevCtx->EndCommandBuffer(recordCmdBuffer));
+
+    return VK_SUCCESS;
+}
+
+VkResult VulkanCommandBuffer::RecordDrawCommands(VkCommandBuffer recordCmdBuffer,
+        VkRenderPass renderPass, const ImageResourceInfo* inputImageToDrawFrom,
+        int32_t displayWidth, int32_t displayHeight,
+        VkImage displayImage, VkFramebuffer framebuffer, VkRect2D* pRenderArea,
+        VkPipeline pipeline, VkPipelineLayout pipelineLayout, const VkDescriptorSet* pDescriptorSet,
+        VulkanVertexBuffer* pVertexBuffer)
+{
     // We start by creating and declare the "beginning" our command buffer
     VkCommandBufferBeginInfo cmdBufferBeginInfo = VkCommandBufferBeginInfo();
     cmdBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     cmdBufferBeginInfo.pNext = nullptr;
     cmdBufferBeginInfo.flags = 0;
     cmdBufferBeginInfo.pInheritanceInfo = nullptr;
-    CALL_VK(m_vkDevCtx->BeginCommandBuffer(cmdBuffer, &cmdBufferBeginInfo));
+    CALL_VK(m_vkDevCtx->BeginCommandBuffer(recordCmdBuffer, &cmdBufferBeginInfo));
 
-    // transition the buffer into color attachment
-    setImageLayout(m_vkDevCtx, cmdBuffer, displayImage,
+    // All the transitions of this dependency point - the display image into
+    // color attachment plus every plane of the input image into shader read -
+    // are collected and issued as a single arrayed barrier call.
+    ImageLayoutBarrierBatch layoutBarrierBatch;
+    layoutBarrierBatch.AddImageBarrier(displayImage,
                    VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
                    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
@@ -1462,20 +2000,21 @@ VkResult VulkanCommandBuffer::CreateCommandBuffer(VkRenderPass renderPass, const
     const VkMpFormatInfo * pFormatInfo = YcbcrVkFormatInfo(inputImageToDrawFrom->imageFormat);
     if (pFormatInfo == NULL) {
         // Non-planar input image.
-        setImageLayout(m_vkDevCtx, cmdBuffer, inputImageToDrawFrom->image,
+        layoutBarrierBatch.AddImageBarrier(inputImageToDrawFrom->image,
                        VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                        VK_PIPELINE_STAGE_2_VIDEO_DECODE_BIT_KHR, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
                        VK_IMAGE_ASPECT_COLOR_BIT);
     } else {
         // Multi-planar input image.
         for (uint32_t planeIndx = 0; (planeIndx < (uint32_t)pFormatInfo->planesLayout.numberOfExtraPlanes + 1); planeIndx++) {
-            setImageLayout(m_vkDevCtx, cmdBuffer, inputImageToDrawFrom->image,
+            layoutBarrierBatch.AddImageBarrier(inputImageToDrawFrom->image,
                        VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
                        VK_PIPELINE_STAGE_2_VIDEO_DECODE_BIT_KHR, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
                        (VK_IMAGE_ASPECT_PLANE_0_BIT_KHR << planeIndx));
 
         }
     }
+    layoutBarrierBatch.RecordAndReset(m_vkDevCtx, recordCmdBuffer);
     // Now we start a renderpass. Any draw command has to be recorded in a renderpass
     VkClearValue clearVals = VkClearValue();
     clearVals.color.float32[0] = 0.0f;
@@ -1492,14 +2031,14 @@ VkResult VulkanCommandBuffer::CreateCommandBuffer(VkRenderPass renderPass, const
     renderPassBeginInfo.clearValueCount = 1;
     renderPassBeginInfo.pClearValues = &clearVals;
 
-    m_vkDevCtx->CmdBeginRenderPass(cmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+    m_vkDevCtx->CmdBeginRenderPass(recordCmdBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
     // Bind what is necessary to the command buffer
-    m_vkDevCtx->CmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
-    m_vkDevCtx->CmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+    m_vkDevCtx->CmdBindPipeline(recordCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    m_vkDevCtx->CmdBindDescriptorSets(recordCmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                             pipelineLayout, 0, 1,
                             pDescriptorSet, 0, nullptr);
     VkDeviceSize offset = 0;
-    m_vkDevCtx->CmdBindVertexBuffers(cmdBuffer, 0, 1, &pVertexBuffer->get(), &offset);
+    m_vkDevCtx->CmdBindVertexBuffers(recordCmdBuffer, 0, 1, &pVertexBuffer->get(), &offset);
 
     bool scaleInput = true;
     TransformPushConstants constants;
@@ -1514,39 +2053,40 @@ VkResult VulkanCommandBuffer::CreateCommandBuffer(VkRenderPass renderPass, const
     }
 
     //upload the matrix to the GPU via push constants
-    m_vkDevCtx->CmdPushConstants(cmdBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(TransformPushConstants), &constants);
+    m_vkDevCtx->CmdPushConstants(recordCmdBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(TransformPushConstants), &constants);
 
     // Draw the quad
-    m_vkDevCtx->CmdDraw(cmdBuffer, pVertexBuffer->GetNumVertices(), 1, 0, 0);
+    m_vkDevCtx->CmdDraw(recordCmdBuffer, pVertexBuffer->GetNumVertices(), 1, 0, 0);
 
-    m_vkDevCtx->CmdEndRenderPass(cmdBuffer);
+    m_vkDevCtx->CmdEndRenderPass(recordCmdBuffer);
 
-    setImageLayout(m_vkDevCtx, cmdBuffer,
-                   displayImage,
+    // The reverse transitions back to present / decode destination are
+    // batched the same way.
+    layoutBarrierBatch.AddImageBarrier(displayImage,
                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
                    VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
                    VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
                    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
 
-
     if (pFormatInfo == NULL) {
         // Non-planar input image.
-        setImageLayout(m_vkDevCtx, cmdBuffer, inputImageToDrawFrom->image,
+        layoutBarrierBatch.AddImageBarrier(inputImageToDrawFrom->image,
                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR,
                        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_PIPELINE_STAGE_2_VIDEO_DECODE_BIT_KHR,
                        VK_IMAGE_ASPECT_COLOR_BIT);
     } else {
         // Multi-planar input image.
         for (uint32_t planeIndx = 0; (planeIndx < (uint32_t)pFormatInfo->planesLayout.numberOfExtraPlanes + 1); planeIndx++) {
-            setImageLayout(m_vkDevCtx, cmdBuffer, inputImageToDrawFrom->image,
+            layoutBarrierBatch.AddImageBarrier(inputImageToDrawFrom->image,
                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR,
                        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, VK_PIPELINE_STAGE_2_VIDEO_DECODE_BIT_KHR,
                        (VK_IMAGE_ASPECT_PLANE_0_BIT_KHR << planeIndx));
 
         }
     }
+    layoutBarrierBatch.RecordAndReset(m_vkDevCtx, recordCmdBuffer);
 
-    CALL_VK(m_vkDevCtx->EndCommandBuffer(cmdBuffer));
+    CALL_VK(m_vkDevCtx->EndCommandBuffer(recordCmdBuffer));
 
     return VK_SUCCESS;
 }
@@ -1634,7 +2174,8 @@ VkResult VulkanRenderInfo::CreatePerDrawContexts(const VulkanDeviceContext* vkDe
         mNumCtxs = 0;
     }
 
-    if (mNumCtxs == 0) {
+    const bool contextsAreNew = (mNumCtxs == 0);
+    if (contextsAreNew) {
         perDrawCtx = new VulkanPerDrawContext[numFbImages];
         if (!perDrawCtx) {
             return VK_ERROR_OUT_OF_HOST_MEMORY;
@@ -1650,18 +2191,44 @@ VkResult VulkanRenderInfo::CreatePerDrawContexts(const VulkanDeviceContext* vkDe
         pPerDrawContext->contextIndex = ctxsIndx;
         LOG(INFO) << "VkVideoUtils: " << "Init pPerDrawContext " << ctxsIndx;
 
-        LOG(INFO) << "VkVideoUtils: " << "CreateCommandBufferPool " << pPerDrawContext->contextIndex;
-        pPerDrawContext->commandBuffer.CreateCommandBufferPool(vkDevCtx);
+        if (contextsAreNew) {
+            LOG(INFO) << "VkVideoUtils: " << "CreateCommandBufferPool " << pPerDrawContext->contextIndex;
+            pPerDrawContext->commandBuffer.CreateCommandBufferPool(vkDevCtx);
+        }
+
+        if (renderPass == VK_NULL_HANDLE) {
+            // Scanout-only context: the swapchain image is a copy
+            // destination, not a render target, so only its handle is
+            // tracked - no view, framebuffer, sampler, descriptor set or
+            // pipeline is built for it.
+            pPerDrawContext->frameBuffer.DestroyFrameBuffer();
+            pPerDrawContext->frameBuffer.m_vkDevCtx = m_vkDevCtx;
+            pPerDrawContext->frameBuffer.mFbImage = fbImages[ctxsIndx];
+            if (contextsAreNew) {
+                pPerDrawContext->syncPrimitives.CreateSyncPrimitives(m_vkDevCtx);
+            }
+            continue;
+        }
 
         LOG(INFO) << "VkVideoUtils: " << "CreateFrameBuffer " << pPerDrawContext->contextIndex;
         pPerDrawContext->frameBuffer.CreateFrameBuffer(m_vkDevCtx, swapchain, pFbExtent2D, pSurfaceFormat,
                 fbImages[ctxsIndx], renderPass);
 
-        LOG(INFO) << "VkVideoUtils: " << "CreateSyncPrimitives " << pPerDrawContext->contextIndex;
-        pPerDrawContext->syncPrimitives.CreateSyncPrimitives(m_vkDevCtx);
-
-        UpdatePerDrawContexts(pPerDrawContext, pViewport, pScissor, renderPass,
-                pSamplerCreateInfo, pSamplerYcbcrConversionCreateInfo);
+        if (contextsAreNew) {
+            LOG(INFO) << "VkVideoUtils: " << "CreateSyncPrimitives " << pPerDrawContext->contextIndex;
+            pPerDrawContext->syncPrimitives.CreateSyncPrimitives(m_vkDevCtx);
+
+            UpdatePerDrawContexts(pPerDrawContext, pViewport, pScissor, renderPass,
+                    pSamplerCreateInfo, pSamplerYcbcrConversionCreateInfo);
+        } else {
+            // The contexts survived a swapchain resize: only the
+            // framebuffer above and the viewport-dependent pipeline need a
+            // rebuild - command pools, sync primitives, samplers and
+            // descriptor sets are not extent-sized and stay alive.
+            pPerDrawContext->gfxPipeline.CreateGraphicsPipeline(m_vkDevCtx,
+                    pViewport, pScissor, renderPass,
+                    &pPerDrawContext->bufferDescriptorSet);
+        }
     }
 
     return VK_SUCCESS;
@@ -1787,13 +2354,17 @@ VkResult AllocateMemoryTypeFromProperties(const VulkanDeviceContext* vkDevCtx,
     return VK_ERROR_MEMORY_MAP_FAILED;
 }
 
-void setImageLayout(const VulkanDeviceContext* vkDevCtx,
-                    VkCommandBuffer cmdBuffer, VkImage image,
+void ImageLayoutBarrierBatch::AddImageBarrier(VkImage image,
                     VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
                     VkPipelineStageFlags srcStages,
                     VkPipelineStageFlags destStages, VkImageAspectFlags aspectMask)
 {
-    VkImageMemoryBarrier2KHR imageMemoryBarrier = VkImageMemoryBarrier2KHR();
+    assert(m_numBarriers < MAX_BARRIERS);
+    if (m_numBarriers >= MAX_BARRIERS) {
+        return;
+    }
+    VkImageMemoryBarrier2KHR& imageMemoryBarrier = m_imageBarriers[m_numBarriers++];
+    imageMemoryBarrier = VkImageMemoryBarrier2KHR();
     imageMemoryBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
     imageMemoryBarrier.pNext = nullptr;
     imageMemoryBarrier.srcStageMask  = srcStages;
@@ -1878,6 +2449,13 @@ void setImageLayout(const VulkanDeviceContext* vkDevCtx,
     default:
         break;
     }
+}
+
+void ImageLayoutBarrierBatch::RecordAndReset(const VulkanDeviceContext* vkDevCtx, VkCommandBuffer cmdBuffer)
+{
+    if (m_numBarriers == 0) {
+        return;
+    }
 
     const VkDependencyInfoKHR dependencyInfo = {
             VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR,
@@ -1885,10 +2463,23 @@ void setImageLayout(const VulkanDeviceContext* vkDevCtx,
             VK_DEPENDENCY_BY_REGION_BIT,
             0, nullptr,
             0, nullptr,
-            1, &imageMemoryBarrier,
+            m_numBarriers, m_imageBarriers,
     };
 
     vkDevCtx->CmdPipelineBarrier2KHR(cmdBuffer, &dependencyInfo);
+    m_numBarriers = 0;
+}
+
+void setImageLayout(const VulkanDeviceContext* vkDevCtx,
+                    VkCommandBuffer cmdBuffer, VkImage image,
+                    VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
+                    VkPipelineStageFlags srcStages,
+                    VkPipelineStageFlags destStages, VkImageAspectFlags aspectMask)
+{
+    ImageLayoutBarrierBatch barrierBatch;
+    barrierBatch.AddImageBarrier(image, oldImageLayout, newImageLayout,
+                                 srcStages, destStages, aspectMask);
+    barrierBatch.RecordAndReset(vkDevCtx, cmdBuffer);
 }
 
 
@@ -707,7 +707,9 @@ public:
        dscLayout(),
        pipelineLayout(),
        descPool(),
-       descSet(VkDescriptorSet())
+       descSet(VkDescriptorSet()),
+       cachedImageViews(),
+       cachedDescSets()
     { }
 
     ~VulkanDescriptorSet()
@@ -720,6 +722,12 @@ public:
 
     void DestroyDescriptorSets()
     {
+        if (!cachedDescSets.empty()) {
+            m_vkDevCtx->FreeDescriptorSets(*m_vkDevCtx, descPool,
+                                           (uint32_t)cachedDescSets.size(), cachedDescSets.data());
+            cachedDescSets.clear();
+            cachedImageViews.clear();
+        }
         if (descSet) {
             m_vkDevCtx->FreeDescriptorSets(*m_vkDevCtx, descPool, 1, &descSet);
             descSet = VkDescriptorSet(0);
@@ -762,6 +770,15 @@ public:
     VkResult WriteDescriptorSet(VkSampler sampler, VkImageView imageView, uint32_t dstArrayElement = 0,
                                 VkImageLayout imageLayout = VK_IMAGE_LAYOUT_GENERAL);
 
+    // Returns a descriptor set permanently bound to the given image view,
+    // allocating and writing it on first use. The decode output image views
+    // are fixed after InitImagePool(), so after the first pass over the pool
+    // every draw binds a cached set without a vkUpdateDescriptorSets call.
+    // Recreating the layout (CreateDescriptorSet()) drops the cache, which
+    // covers the YCbCr sampler permutation changes.
+    const VkDescriptorSet* GetCachedDescriptorSet(VkSampler sampler, VkImageView imageView,
+                                                  VkImageLayout imageLayout = VK_IMAGE_LAYOUT_GENERAL);
+
     VkResult CreateFragmentShaderOutput(VkDescriptorType outMode, uint32_t outSet, uint32_t outBinding, uint32_t outArrayIndex, std::stringstream& imageFss);
 
     VkResult CreateFragmentShaderLayouts(const uint32_t* setIds, uint32_t numSets, std::stringstream& texFss);
@@ -779,7 +796,14 @@ public:
         return pipelineLayout;
     }
 
+    // Upper bound of per-image-view cached sets; must cover the largest
+    // decode image pool. The pool is sized for these plus the shared set.
+    static const uint32_t MAX_CACHED_DESCRIPTOR_SETS = 32;
+
 private:
+    VkResult WriteImageDescriptor(VkDescriptorSet dstSet, VkSampler sampler, VkImageView imageView,
+                                  uint32_t dstArrayElement, VkImageLayout imageLayout);
+
     const VulkanDeviceContext* m_vkDevCtx;
     VkDescriptorSetLayoutBinding descriptorSetLayoutBinding;
     VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo;
@@ -787,6 +811,9 @@ private:
     VkPipelineLayout pipelineLayout;
     VkDescriptorPool descPool;
     VkDescriptorSet  descSet;
+    // Parallel arrays of the per-image-view descriptor set cache.
+    std::vector<VkImageView>     cachedImageViews;
+    std::vector<VkDescriptorSet> cachedDescSets;
 };
 
 class VulkanGraphicsPipeline {
@@ -862,6 +889,23 @@ private:
 };
 
 
+// One tile of a mosaic composite (see
+// VulkanCommandBuffer::GetOrRecordMosaicCopyCommandBuffer()): the decoded
+// image the tile shows and the destination cell it occupies in the
+// swapchain image. A null inputImage leaves the cell untouched.
+struct MosaicCopyTile {
+    const ImageResourceInfo* inputImage;
+    int32_t                  displayWidth;   // visible video size of the tile's frame
+    int32_t                  displayHeight;
+    VkRect2D                 tileRect;       // destination cell; even offsets keep chroma aligned
+
+    MosaicCopyTile() : inputImage(nullptr),
+                       displayWidth(0),
+                       displayHeight(0),
+                       tileRect()
+    {}
+};
+
 class VulkanCommandBuffer {
 
 public:
@@ -869,7 +913,8 @@ public:
     VulkanCommandBuffer()
         :m_vkDevCtx(),
         cmdPool(),
-        cmdBuffer()
+        cmdBuffer(),
+        preRecordedDraws()
         {}
 
     VkResult CreateCommandBufferPool(const VulkanDeviceContext* vkDevCtx);
@@ -880,12 +925,56 @@ public:
             VkPipeline pipeline, VkPipelineLayout pipelineLayout, const VkDescriptorSet* pDescriptorSet,
             VulkanVertexBuffer* pVertexBuffer);
 
+    // Returns a command buffer pre-recorded for this exact draw, recording
+    // it on first use. For a given (input image view, descriptor set,
+    // pipeline, display size) the draw stream is identical frame to frame,
+    // so steady state playback submits prebuilt buffers without any
+    // re-recording. A recreated pipeline or changed dimensions miss the
+    // cache and record a fresh entry; DestroyCommandBuffer() drops them all.
+    const VkCommandBuffer* GetOrRecordCommandBuffer(VkRenderPass renderPass, const ImageResourceInfo* inputImageToDrawFrom,
+            int32_t displayWidth, int32_t displayHeight,
+            VkImage displayImage, VkFramebuffer framebuffer, VkRect2D* pRenderArea,
+            VkPipeline pipeline, VkPipelineLayout pipelineLayout, const VkDescriptorSet* pDescriptorSet,
+            VulkanVertexBuffer* pVertexBuffer);
+
+    // Direct scanout (--directScanout) variant of the above: the recorded
+    // stream is a plane-for-plane copy of the decoded image into the
+    // swapchain image, bracketed by the layout transitions the copy and the
+    // following present require - no render pass, pipeline or descriptor set
+    // is involved. A null input image records only the transition of the
+    // swapchain image to the present layout, so start-up frames with nothing
+    // decoded yet remain presentable. Pre-recorded buffers are cached the
+    // same way as the draw streams.
+    const VkCommandBuffer* GetOrRecordScanoutCopyCommandBuffer(const ImageResourceInfo* inputImageToCopyFrom,
+            int32_t displayWidth, int32_t displayHeight,
+            VkImage displayImage, const VkExtent2D& displayImageExtent);
+
+    // Mosaic variant of the scanout copy: one command buffer copies every
+    // tile's decoded planes into its cell of the swapchain image, so any
+    // number of streams composite with a single submission. The set of
+    // input views changes every display frame across the streams, so unlike
+    // the single-input streams the buffer is not cached but re-recorded
+    // into the shared command buffer on each call - recording a handful of
+    // copy regions is cheap next to the per-stream submits it replaces.
+    // Tiles with a null input image record only the layout transition that
+    // keeps the swapchain image presentable.
+    const VkCommandBuffer* GetOrRecordMosaicCopyCommandBuffer(const MosaicCopyTile* pTiles,
+            uint32_t numTiles,
+            VkImage displayImage, const VkExtent2D& displayImageExtent);
+
     ~VulkanCommandBuffer() {
         DestroyCommandBuffer();
         DestroyCommandBufferPool();
     }
 
     void DestroyCommandBuffer() {
+        if (!preRecordedDraws.empty()) {
+            for (size_t entryIndex = 0; entryIndex < preRecordedDraws.size(); entryIndex++) {
+                m_vkDevCtx->FreeCommandBuffers(*m_vkDevCtx, cmdPool, 1,
+                                               &preRecordedDraws[entryIndex].cmdBuffer);
+            }
+            preRecordedDraws.clear();
+        }
         if (cmdBuffer) {
             m_vkDevCtx->FreeCommandBuffers(*m_vkDevCtx, cmdPool, 1, &cmdBuffer);
             cmdBuffer = VkCommandBuffer(0);
@@ -907,10 +996,42 @@ public:
         return &cmdBuffer;
     }
 
+    // Upper bound of pre-recorded draws kept per context; must cover the
+    // largest decode image pool (one entry per decode surface).
+    static const uint32_t MAX_PRERECORDED_COMMAND_BUFFERS = 32;
+
 private:
+    // Everything the recorded draw stream depends on; a cache entry is
+    // only reused when all of it matches.
+    struct PreRecordedDraw {
+        VkImageView     inputView;
+        VkPipeline      pipeline;
+        VkDescriptorSet descriptorSet;
+        int32_t         displayWidth;
+        int32_t         displayHeight;
+        VkCommandBuffer cmdBuffer;
+    };
+
+    VkResult RecordDrawCommands(VkCommandBuffer recordCmdBuffer,
+            VkRenderPass renderPass, const ImageResourceInfo* inputImageToDrawFrom,
+            int32_t displayWidth, int32_t displayHeight,
+            VkImage displayImage, VkFramebuffer framebuffer, VkRect2D* pRenderArea,
+            VkPipeline pipeline, VkPipelineLayout pipelineLayout, const VkDescriptorSet* pDescriptorSet,
+            VulkanVertexBuffer* pVertexBuffer);
+
+    VkResult RecordScanoutCopyCommands(VkCommandBuffer recordCmdBuffer,
+            const ImageResourceInfo* inputImageToCopyFrom,
+            int32_t displayWidth, int32_t displayHeight,
+            VkImage displayImage, const VkExtent2D& displayImageExtent);
+
+    VkResult RecordMosaicCopyCommands(VkCommandBuffer recordCmdBuffer,
+            const MosaicCopyTile* pTiles, uint32_t numTiles,
+            VkImage displayImage, const VkExtent2D& displayImageExtent);
+
     const VulkanDeviceContext* m_vkDevCtx;
     VkCommandPool cmdPool;
     VkCommandBuffer cmdBuffer;
+    std::vector<PreRecordedDraw> preRecordedDraws;
 };
 
 class VulkanPerDrawContext {
@@ -969,7 +1090,11 @@ public:
         {}
 
 
-    // Create per draw contexts.
+    // Create per draw contexts. A VK_NULL_HANDLE renderPass creates
+    // scanout-only contexts: the swapchain images become copy destinations
+    // (see VulkanCommandBuffer::GetOrRecordScanoutCopyCommandBuffer()), so
+    // only their command pools and sync primitives are built - no view,
+    // framebuffer, sampler, descriptor set or pipeline.
     VkResult CreatePerDrawContexts(const VulkanDeviceContext* vkDevCtx,
             VkSwapchainKHR swapchain, const VkExtent2D* pFbExtent2D,
             VkViewport* pViewport, VkRect2D* pScissor, const VkSurfaceFormatKHR* pSurfaceFormat,
@@ -1094,6 +1219,37 @@ VkResult AllocateMemoryTypeFromProperties(const VulkanDeviceContext* vkDevCtx,
         VkFlags requirements_mask,
         uint32_t *typeIndex);
 
+// Collects the image layout transitions of one dependency point of a
+// recording pass and issues them as a single vkCmdPipelineBarrier2 with
+// arrayed image barriers, instead of a vkCmdPipelineBarrier2 call per image
+// (see setImageLayout() for the single-image convenience wrapper).
+class ImageLayoutBarrierBatch {
+public:
+    enum { MAX_BARRIERS = 8 };
+
+    ImageLayoutBarrierBatch() : m_numBarriers(0) { }
+
+    void AddImageBarrier(VkImage image,
+                         VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
+                         VkPipelineStageFlags srcStages, VkPipelineStageFlags destStages,
+                         VkImageAspectFlags aspectMask = VK_IMAGE_ASPECT_COLOR_BIT);
+
+    // The batch capacity is small - callers collecting a variable number of
+    // barriers (one set per mosaic tile, for ex.) must check the remaining
+    // space and flush with RecordAndReset() before adding the next set.
+    bool HasSpaceFor(uint32_t numBarriers) const {
+        return ((m_numBarriers + numBarriers) <= (uint32_t)MAX_BARRIERS);
+    }
+
+    // Records the collected barriers with a single vkCmdPipelineBarrier2 and
+    // empties the batch, so it can be reused for the next dependency point.
+    void RecordAndReset(const VulkanDeviceContext* vkDevCtx, VkCommandBuffer cmdBuffer);
+
+private:
+    uint32_t m_numBarriers;
+    VkImageMemoryBarrier2KHR m_imageBarriers[MAX_BARRIERS];
+};
+
 void setImageLayout(const VulkanDeviceContext* vkDevCtx,
                     VkCommandBuffer cmdBuffer, VkImage image,
                     VkImageLayout oldImageLayout, VkImageLayout newImageLayout,
@@ -14,6 +14,10 @@
 * limitations under the License.
 */
 
+#include <string.h>
+#include <mutex>
+#include <vector>
+
 #include <vulkan_interfaces.h>
 #include "Helpers.h"
 #include "VkCodecUtils/VulkanDeviceContext.h"
@@ -21,6 +25,21 @@
 
 namespace Pattern {
 
+// Replicates the pixel group at the start of the row across rowPixels
+// pixels with doubling memcpy, so the per-pixel work collapses to wide
+// memory moves the libc kernels vectorize.
+template <class colorType>
+static inline void replicateRowPixels(colorType *rowPtr, uint32_t channelsPerColor, uint32_t rowPixels)
+{
+    uint32_t pixelsDone = 1;
+    while (pixelsDone < rowPixels) {
+        const uint32_t pixelsToCopy = ((2 * pixelsDone) <= rowPixels) ? pixelsDone : (rowPixels - pixelsDone);
+        memcpy(rowPtr + ((size_t)pixelsDone * channelsPerColor), rowPtr,
+               (size_t)pixelsToCopy * channelsPerColor * sizeof(colorType));
+        pixelsDone += pixelsToCopy;
+    }
+}
+
 template <class colorType>
 void generateColorPatternRgba(ColorPattern pattern, colorType *dataPtr,
                               uint32_t width, uint32_t height,
@@ -30,6 +49,90 @@ void generateColorPatternRgba(ColorPattern pattern, colorType *dataPtr,
                               uint32_t skipChannelsMask, bool incOnSkip)
 {
     const uint32_t enabledChannelsMask = ~skipChannelsMask;
+
+    // With no skipped channels every pixel is written contiguously, so the
+    // row content can be composed once and replicated with memcpy instead
+    // of the per-channel scalar loops below: the color-bar and clear rows
+    // are identical for the whole frame and a gradient row is one repeated
+    // pixel. The scalar path remains for the channel-skip cases.
+    if ((skipChannelsMask == 0) && (width >= 8) && (height > 0)) {
+        switch (pattern) {
+        case ColorPatternColorBars: {
+            const colorType rgbBarColors[][4] = {
+                {maxC, maxC, maxC, alphaMax},  // White
+                {maxC, maxC, minC, alphaMax},  // Yellow
+                {minC, maxC, maxC, alphaMax},  // Cyan
+                {minC, maxC, minC, alphaMax},  // Green
+                {maxC, minC, maxC, alphaMax},  // Magenta
+                {maxC, minC, minC, alphaMax},  // Red
+                {minC, minC, maxC, alphaMax},  // Blue
+                {minC, minC, minC, alphaMax},  // Black
+            };
+
+            if (channelsPerColor > 4) {
+                channelsPerColor = 4;
+            }
+
+            const uint32_t numColorBars = 8;
+            const uint32_t barWidthPixels = width / numColorBars;  // FIXME: if 0 then 1;
+
+            // Compose the first row: one pixel per bar, replicated to the
+            // bar width.
+            colorType *rowPtr = dataPtr;
+            for (unsigned int bar = 0; bar < numColorBars; bar++) {
+                for (unsigned int pix = 0; pix < channelsPerColor; pix++) {
+                    rowPtr[pix] = rgbBarColors[bar][pix];
+                }
+                replicateRowPixels(rowPtr, channelsPerColor, barWidthPixels);
+                rowPtr += (size_t)barWidthPixels * channelsPerColor;
+            }
+
+            const size_t rowBytes = (size_t)numColorBars * barWidthPixels * channelsPerColor * sizeof(colorType);
+            colorType *rowStartPtr = dataPtr;
+            for (unsigned int row = 1; row < height; row++) {
+                rowStartPtr = (colorType *)((uint8_t *)rowStartPtr + strideBytes);
+                memcpy(rowStartPtr, dataPtr, rowBytes);
+            }
+            return;
+        }
+        case ColorPatternGrad: {
+            colorType grad[4];
+            grad[0] = grad[1] = grad[2] = minC;
+            grad[3] = alphaMax;
+            colorType step = (maxC - minC) / height;
+
+            colorType *rowStartPtr = dataPtr;
+            for (unsigned int i = 0; i < height; i++) {
+                for (unsigned int pix = 0; pix < channelsPerColor; pix++) {
+                    rowStartPtr[pix] = grad[pix];
+                }
+                replicateRowPixels(rowStartPtr, channelsPerColor, width);
+
+                rowStartPtr = (colorType *)((uint8_t *)rowStartPtr + strideBytes);
+
+                grad[0] += step;
+                grad[1] += step;
+                grad[2] += step;
+            }
+            return;
+        }
+        case ColorPatternClear: {
+            for (unsigned int pix = 0; pix < channelsPerColor; pix++) {
+                dataPtr[pix] = clearColor[pix];
+            }
+            replicateRowPixels(dataPtr, channelsPerColor, width);
+
+            const size_t rowBytes = (size_t)width * channelsPerColor * sizeof(colorType);
+            colorType *rowStartPtr = dataPtr;
+            for (unsigned int i = 1; i < height; i++) {
+                rowStartPtr = (colorType *)((uint8_t *)rowStartPtr + strideBytes);
+                memcpy(rowStartPtr, dataPtr, rowBytes);
+            }
+            return;
+        }
+        }
+    }
+
     switch (pattern) {
     case ColorPatternColorBars: {
         const colorType rgbBarColors[][4] = {
@@ -475,9 +578,106 @@ int ConvertRgbToYcbcr(const VkSamplerYcbcrConversionCreateInfo * pYcbcrConversio
     return -1;
 }
 
+// Synthetic pattern frames are deterministic for a given configuration, so
+// each unique converted frame is generated once and replayed with a single
+// memcpy afterwards - the per-pixel RGB-to-YCbCr conversion otherwise
+// dominates the synthetic-input generation time.
+struct CachedPatternFrame {
+    VkFormat             imageFormat;
+    uint32_t             width;
+    uint32_t             height;
+    ColorPattern         pattern;
+    uint8_t              clearColor[4];
+    VkImageAspectFlags   aspectMask;
+    VkFormat             aspectMainFormat;
+    VkSubresourceLayout  layouts[3];
+    VkDeviceSize         size;
+    std::vector<uint8_t> frameBytes;
+};
+
+enum { MAX_CACHED_PATTERN_FRAMES = 4 };
+static std::mutex cachedPatternFramesMutex; // guards the two statics below
+static std::vector<CachedPatternFrame> cachedPatternFrames;
+static uint32_t cachedPatternFramesNextEvict = 0;
+
+static bool matchesCachedPatternFrame(const CachedPatternFrame& frame, const ImageData* pImageData,
+                                      const VkSubresourceLayout layouts[3],
+                                      VkImageAspectFlags aspectMask, VkFormat aspectMainFormat,
+                                      VkDeviceSize size)
+{
+    return (frame.imageFormat == pImageData->imageFormat) &&
+           (frame.width == pImageData->width) &&
+           (frame.height == pImageData->height) &&
+           (frame.pattern == pImageData->patttern) &&
+           (memcmp(frame.clearColor, pImageData->clearColor, sizeof(frame.clearColor)) == 0) &&
+           (frame.aspectMask == aspectMask) &&
+           (frame.aspectMainFormat == aspectMainFormat) &&
+           (memcmp(frame.layouts, layouts, 3 * sizeof(VkSubresourceLayout)) == 0) &&
+           (frame.size == size);
+}
+
+static bool replayCachedPatternFrame(const ImageData* pImageData, const VkSubresourceLayout layouts[3],
+                                     VkImageAspectFlags aspectMask, VkFormat aspectMainFormat,
+                                     VkDeviceSize size, uint8_t* mappedPtr)
+{
+    std::lock_guard<std::mutex> lock(cachedPatternFramesMutex);
+    for (size_t i = 0; i < cachedPatternFrames.size(); i++) {
+        if (matchesCachedPatternFrame(cachedPatternFrames[i], pImageData, layouts,
+                                      aspectMask, aspectMainFormat, size)) {
+            memcpy(mappedPtr, cachedPatternFrames[i].frameBytes.data(), (size_t)size);
+            return true;
+        }
+    }
+    return false;
+}
+
+static void insertCachedPatternFrame(const ImageData* pImageData, const VkSubresourceLayout layouts[3],
+                                     VkImageAspectFlags aspectMask, VkFormat aspectMainFormat,
+                                     VkDeviceSize size, std::vector<uint8_t>&& frameBytes)
+{
+    CachedPatternFrame frame;
+    frame.imageFormat = pImageData->imageFormat;
+    frame.width = pImageData->width;
+    frame.height = pImageData->height;
+    frame.pattern = pImageData->patttern;
+    memcpy(frame.clearColor, pImageData->clearColor, sizeof(frame.clearColor));
+    frame.aspectMask = aspectMask;
+    frame.aspectMainFormat = aspectMainFormat;
+    memcpy(frame.layouts, layouts, 3 * sizeof(VkSubresourceLayout));
+    frame.size = size;
+    frame.frameBytes = std::move(frameBytes);
+
+    std::lock_guard<std::mutex> lock(cachedPatternFramesMutex);
+    if (cachedPatternFrames.size() < MAX_CACHED_PATTERN_FRAMES) {
+        cachedPatternFrames.push_back(std::move(frame));
+    } else {
+        cachedPatternFrames[cachedPatternFramesNextEvict] = std::move(frame);
+        cachedPatternFramesNextEvict = (cachedPatternFramesNextEvict + 1) % MAX_CACHED_PATTERN_FRAMES;
+    }
+}
+
 void VkFillYuv::fillVkCommon(const ImageData *pImageData, VkSubresourceLayout layouts[3], const VkSamplerYcbcrConversionCreateInfo* pSamplerYcbcrConversionCreateInfo,
-                             const VkMpFormatInfo *mpInfo, uint8_t *ptr, VkDeviceSize, VkImageAspectFlags aspectMask, VkFormat aspectMainFormat)
+                             const VkMpFormatInfo *mpInfo, uint8_t *mappedPtr, VkDeviceSize size, VkImageAspectFlags aspectMask, VkFormat aspectMainFormat)
 {
+    // The cache key must use the caller's layouts: the plane-aspect cases
+    // below patch layouts[] in place.
+    VkSubresourceLayout keyLayouts[3];
+    memcpy(keyLayouts, layouts, sizeof(keyLayouts));
+
+    const bool useFrameCache = (size != 0);
+    std::vector<uint8_t> generated;
+    uint8_t *ptr = mappedPtr;
+    if (useFrameCache) {
+        if (replayCachedPatternFrame(pImageData, keyLayouts, aspectMask, aspectMainFormat, size, mappedPtr)) {
+            return;
+        }
+        // Generate into host memory first: the frame is then copied to the
+        // mapped image with one memcpy and kept for replay, and the pattern
+        // and conversion loops never touch write-combined memory.
+        generated.resize((size_t)size, 0);
+        ptr = generated.data();
+    }
+
     VkDeviceSize offset = 0;
     VkDeviceSize rgbaPitch = 0;
     unsigned int rgbaChannelsPerColor = 4; // default 4
@@ -619,6 +819,11 @@ void VkFillYuv::fillVkCommon(const ImageData *pImageData, VkSubresourceLayout la
     if (rgbImageData) {
         delete [] rgbImageData;
     }
+
+    if (useFrameCache) {
+        memcpy(mappedPtr, generated.data(), (size_t)size);
+        insertCachedPatternFrame(pImageData, keyLayouts, aspectMask, aspectMainFormat, size, std::move(generated));
+    }
 }
 
 // Initialize the texture data, either directly into the texture itself
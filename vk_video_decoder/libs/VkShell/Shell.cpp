@@ -17,11 +17,14 @@
 
 #include <cassert>
 #include <array>
+#include <chrono>
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <set>
+#include <thread>
 #include "VkCodecUtils/Helpers.h"
+#include <nvidia_utils/vulkan/ycbcrvkinfo.h>
 #include "Shell.h"
 
 Shell::Shell(const VulkanDeviceContext* devCtx, VkSharedBaseObj<FrameProcessor>& frameProcessor)
@@ -29,7 +32,12 @@ Shell::Shell(const VulkanDeviceContext* devCtx, VkSharedBaseObj<FrameProcessor>&
     , m_frameProcessor(frameProcessor)
     , m_settings(frameProcessor->GetSettings())
     , m_ctx(devCtx), m_tick(1.0f / m_settings.ticksPerSecond)
-    , m_time(m_tick) { }
+    , m_time(m_tick)
+    , m_hasPendingResize(false)
+    , m_pendingResizeWidth(0)
+    , m_pendingResizeHeight(0)
+    , m_targetFrameTimeNs((m_settings.targetDisplayRate > 0) ? (1000000000LL / m_settings.targetDisplayRate) : 0)
+    , m_lastFrameTimeNs(0) { }
 
 Shell::AcquireBuffer::AcquireBuffer()
     : m_vkDevCtx(nullptr)
@@ -186,6 +194,23 @@ void Shell::CreateSwapchain() {
     vk::get(m_ctx.devCtx, m_ctx.devCtx->getPhysicalDevice(), m_ctx.surface, formats);
     m_ctx.format = formats[0];
 
+    if (m_settings.enableDirectScanout) {
+        // Prefer presenting the decoder output format itself, so decoded
+        // frames can be copied plane-for-plane to the display plane without
+        // the graphics render pass (see VulkanFrame::AttachSwapchain()).
+        const VkFormat decodeFormat = m_frameProcessor->GetFrameImageFormat();
+        for (const auto& format : formats) {
+            if (format.format == decodeFormat) {
+                m_ctx.format = format;
+                break;
+            }
+        }
+        if (m_ctx.format.format != decodeFormat) {
+            std::cout << "The display surface does not support the decode output format"
+                         " - --directScanout falls back to the render path" << std::endl;
+        }
+    }
+
     // Tegra hack __VkModesetApiNvdc::vkFormatToNvColorFormat() does not mapp the correct formats.
 #ifdef NV_RMAPI_TEGRA
     m_ctx.format.format = VK_FORMAT_A8B8G8R8_UNORM_PACK32;
@@ -250,10 +275,23 @@ void Shell::ResizeSwapchain(uint32_t width_hint, uint32_t height_hint) {
 
     // FIFO is the only mode universally supported
     VkPresentModeKHR mode = VK_PRESENT_MODE_FIFO_KHR;
-    for (auto m : modes) {
-        if ((m_settings.vsync && m == VK_PRESENT_MODE_MAILBOX_KHR) || (!m_settings.vsync && m == VK_PRESENT_MODE_IMMEDIATE_KHR)) {
-            mode = m;
-            break;
+    if (m_settings.presentMode != VK_PRESENT_MODE_MAX_ENUM_KHR) {
+        // An explicitly requested mode is used when the surface supports it.
+        for (auto m : modes) {
+            if (m == m_settings.presentMode) {
+                mode = m;
+                break;
+            }
+        }
+        if (mode != m_settings.presentMode) {
+            std::cout << "The requested present mode is not supported by the surface - using FIFO" << std::endl;
+        }
+    } else {
+        for (auto m : modes) {
+            if ((m_settings.vsync && m == VK_PRESENT_MODE_MAILBOX_KHR) || (!m_settings.vsync && m == VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+                mode = m;
+                break;
+            }
         }
     }
 
@@ -266,6 +304,13 @@ void Shell::ResizeSwapchain(uint32_t width_hint, uint32_t height_hint) {
     swapchain_info.imageExtent = extent;
     swapchain_info.imageArrayLayers = 1;
     swapchain_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    if (m_settings.enableDirectScanout &&
+            (caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) &&
+            (YcbcrVkFormatInfo(m_ctx.format.format) != nullptr)) {
+        // A swapchain carrying the decoder output format: its images are
+        // copy destinations for the decoded planes, not render targets.
+        swapchain_info.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
 
     std::vector<uint32_t> queueFamilies(1, m_ctx.devCtx->GetGfxQueueFamilyIdx());
     if (m_ctx.devCtx->GetGfxQueueFamilyIdx() != m_ctx.devCtx->GetPresentQueueFamilyIdx()) {
@@ -288,6 +333,7 @@ void Shell::ResizeSwapchain(uint32_t width_hint, uint32_t height_hint) {
                                                          &swapchain_info, nullptr,
                                                          &m_ctx.swapchain));
     m_ctx.extent = extent;
+    m_ctx.imageUsage = swapchain_info.imageUsage;
 
     // destroy the old swapchain
     if (swapchain_info.oldSwapchain != VK_NULL_HANDLE) {
@@ -300,7 +346,20 @@ void Shell::ResizeSwapchain(uint32_t width_hint, uint32_t height_hint) {
     m_frameProcessor->AttachSwapchain(*this);
 }
 
+void Shell::RequestResizeSwapchain(uint32_t width_hint, uint32_t height_hint) {
+    m_pendingResizeWidth = width_hint;
+    m_pendingResizeHeight = height_hint;
+    m_hasPendingResize = true;
+}
+
 void Shell::AcquireBackBuffer(bool trainFrame) {
+    // Apply the latest coalesced resize request before acquiring (see
+    // RequestResizeSwapchain()).
+    if (m_hasPendingResize) {
+        m_hasPendingResize = false;
+        ResizeSwapchain(m_pendingResizeWidth, m_pendingResizeHeight);
+    }
+
     // acquire just once when not presenting
     if (m_settings.noPresent && GetCurrentBackBuffer().GetAcquireSemaphore() != VK_NULL_HANDLE) return;
 
@@ -329,8 +388,29 @@ void Shell::AcquireBackBuffer(bool trainFrame) {
     m_ctx.acquiredFrameId++;
 }
 
+void Shell::PaceFrame() {
+    if (m_targetFrameTimeNs <= 0) {
+        return;
+    }
+
+    int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (m_lastFrameTimeNs != 0) {
+        const int64_t nextFrameTimeNs = m_lastFrameTimeNs + m_targetFrameTimeNs;
+        if (nowNs < nextFrameTimeNs) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(nextFrameTimeNs - nowNs));
+            // Pace against the ideal schedule, not the (late) wakeup time, so
+            // sleep jitter does not accumulate into a lower effective rate.
+            nowNs = nextFrameTimeNs;
+        }
+    }
+    m_lastFrameTimeNs = nowNs;
+}
+
 void Shell::PresentBackBuffer(bool trainFrame) {
 
+    PaceFrame();
+
     const BackBuffer& backBuffer = GetCurrentBackBuffer();
 
     if (!m_frameProcessor->OnFrame(trainFrame ? -(int32_t)backBuffer.GetImageIndex() :
@@ -122,6 +122,7 @@ public:
         , format()
         , swapchain()
         , extent()
+        , imageUsage()
         , acquiredFrameId() {}
 
         const VulkanDeviceContext* devCtx;
@@ -135,6 +136,10 @@ public:
 
         VkSwapchainKHR swapchain;
         VkExtent2D extent;
+        // The usage the swapchain images were created with; the frame
+        // processor checks it for the transfer-destination bit the direct
+        // scanout path needs (see ResizeSwapchain()).
+        VkImageUsageFlags imageUsage;
 
         uint64_t acquiredFrameId;
     };
@@ -167,9 +172,20 @@ protected:
 
     void ResizeSwapchain(uint32_t width_hint, uint32_t height_hint);
 
+    // Coalesces interactive resize events: only the latest requested extent
+    // is remembered, and the actual swapchain rebuild is deferred to the next
+    // AcquireBackBuffer() call - at most one rebuild per presented frame, no
+    // matter how many resize events the window system delivers in between.
+    void RequestResizeSwapchain(uint32_t width_hint, uint32_t height_hint);
+
     void AcquireBackBuffer(bool trainFrame = false);
     void PresentBackBuffer(bool trainFrame = false);
 
+    // Frame pacing (--targetDisplayRate): sleeps so consecutive presents stay
+    // on the requested display-rate schedule; a zero target is a no-op, so an
+    // IMMEDIATE-mode swapchain runs unthrottled.
+    void PaceFrame();
+
     VkSharedBaseObj<FrameProcessor> m_frameProcessor;
     const ProgramConfig &m_settings;
 
@@ -188,6 +204,11 @@ protected:
 private:
     const float m_tick;
     float       m_time;
+    bool        m_hasPendingResize;
+    uint32_t    m_pendingResizeWidth;
+    uint32_t    m_pendingResizeHeight;
+    const int64_t m_targetFrameTimeNs;
+    int64_t     m_lastFrameTimeNs;
 };
 
 #endif  // SHELL_H
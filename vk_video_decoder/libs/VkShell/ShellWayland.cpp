@@ -27,6 +27,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <linux/input.h>
+#include <poll.h>
 #include "VkCodecUtils/FrameProcessor.h"
 
 const std::vector<VkExtensionProperties> waylandSurfaceExtensions {
@@ -244,6 +245,24 @@ void ShellWayland::LoopPoll() {
     while (true) {
         if (m_quit_loop) break;
 
+        // Non-blocking event turn-around, in the wl_display_prepare_read()
+        // protocol: flush our requests, read from the compositor socket only
+        // when poll() reports pending data - with a zero timeout, so a slow
+        // compositor can never stall this loop - and dispatch whatever has
+        // arrived. Dispatching only ever works on already-read events, which
+        // keeps the present cadence below driven purely by the swapchain and
+        // the frame pacer (see Shell::PaceFrame()).
+        wl_display_flush(m_display);
+        if (wl_display_prepare_read(m_display) == 0) {
+            struct pollfd displayFd = {};
+            displayFd.fd = wl_display_get_fd(m_display);
+            displayFd.events = POLLIN;
+            if (poll(&displayFd, 1, 0) > 0) {
+                wl_display_read_events(m_display);
+            } else {
+                wl_display_cancel_read(m_display);
+            }
+        }
         wl_display_dispatch_pending(m_display);
 
         AcquireBackBuffer();
@@ -96,7 +96,7 @@ LRESULT ShellWin32::HandleMessage(UINT msg, WPARAM wparam, LPARAM lparam) {
         case WM_SIZE: {
             UINT w = LOWORD(lparam);
             UINT h = HIWORD(lparam);
-            ResizeSwapchain(w, h);
+            RequestResizeSwapchain(w, h);
         } break;
         case WM_KEYDOWN: {
             FrameProcessor::Key key;
@@ -61,7 +61,11 @@ ShellXcb::ShellXcb(const VulkanDeviceContext* vkDevCtx, VkSharedBaseObj<FramePro
     , m_winHeight()
     , m_wm_protocols()
     , m_wm_delete_window()
-    , m_quit_loop() {
+    , m_quit_loop()
+    , m_eventThread()
+    , m_eventMutex()
+    , m_pendingEvents()
+    , m_exitEventThread() {
 
     InitConnection();
 }
@@ -165,7 +169,7 @@ void ShellXcb::HandleEvent(const xcb_generic_event_t *ev) {
             m_winWidth  = notify->width;
             m_winHeight = notify->height;
 
-            ResizeSwapchain(notify->width, notify->height);
+            RequestResizeSwapchain(notify->width, notify->height);
         } break;
         case XCB_KEY_PRESS: {
             const xcb_key_press_event_t *press = reinterpret_cast<const xcb_key_press_event_t *>(ev);
@@ -258,6 +262,80 @@ void ShellXcb::LoopPoll() {
     }
 }
 
+// Runs the blocking event reads on a dedicated thread, so a display server
+// that is slow to deliver events can never stall the render loop. The thread
+// does nothing but read: the events are queued raw and handled on the render
+// thread (see DispatchPendingEvents()).
+void ShellXcb::EventThreadProc() {
+    while (!m_exitEventThread) {
+        xcb_generic_event_t *ev = xcb_wait_for_event(m_connection);
+        if (!ev) {
+            if (xcb_connection_has_error(m_connection)) {
+                break;
+            }
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_eventMutex);
+        m_pendingEvents.push_back(ev);
+    }
+}
+
+void ShellXcb::DispatchPendingEvents() {
+    std::vector<xcb_generic_event_t*> events;
+    {
+        std::lock_guard<std::mutex> lock(m_eventMutex);
+        events.swap(m_pendingEvents);
+    }
+
+    for (size_t evIndx = 0; evIndx < events.size(); evIndx++) {
+        HandleEvent(events[evIndx]);
+        free(events[evIndx]);
+    }
+}
+
+void ShellXcb::WakeEventThread() {
+    // Unblock xcb_wait_for_event() with a synthetic no-op message to our own
+    // window, so the thread notices m_exitEventThread. The message type is
+    // left zero and is ignored by HandleEvent().
+    xcb_client_message_event_t ev = {};
+    ev.response_type = XCB_CLIENT_MESSAGE;
+    ev.format = 32;
+    ev.window = m_window;
+    xcb_send_event(m_connection, false, m_window, XCB_EVENT_MASK_NO_EVENT,
+                   reinterpret_cast<const char*>(&ev));
+    xcb_flush(m_connection);
+}
+
+// The default loop: the event thread owns the blocking socket reads and the
+// render loop only drains the already-read events, so its present cadence is
+// driven purely by the swapchain and the frame pacer (see Shell::PaceFrame()).
+void ShellXcb::LoopEventThread() {
+
+    m_exitEventThread = false;
+    m_eventThread = std::thread(&ShellXcb::EventThreadProc, this);
+
+    while (true) {
+        DispatchPendingEvents();
+
+        if (m_quit_loop) break;
+
+        AcquireBackBuffer();
+
+        PresentBackBuffer();
+    }
+
+    m_exitEventThread = true;
+    WakeEventThread();
+    m_eventThread.join();
+
+    // Whatever arrived after the quit is not worth handling anymore.
+    for (size_t evIndx = 0; evIndx < m_pendingEvents.size(); evIndx++) {
+        free(m_pendingEvents[evIndx]);
+    }
+    m_pendingEvents.clear();
+}
+
 void ShellXcb::RunLoop() {
 
     CreateWindow();
@@ -265,11 +343,7 @@ void ShellXcb::RunLoop() {
     ResizeSwapchain(m_winWidth, m_winHeight);
 
     m_quit_loop = false;
-    if (true) {
-        LoopPoll();
-    } else {
-        LoopWait();
-    }
+    LoopEventThread();
 
     DestroyContext();
     DestroyWindow();
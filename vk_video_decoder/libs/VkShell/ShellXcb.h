@@ -18,6 +18,11 @@
 #ifndef SHELL_XCB_H
 #define SHELL_XCB_H
 
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include <xcb/xcb.h>
 #include "Shell.h"
 
@@ -42,6 +47,11 @@ private:
     void HandleEvent(const xcb_generic_event_t *ev);
     void LoopWait();
     void LoopPoll();
+    void LoopEventThread();
+
+    void EventThreadProc();
+    void DispatchPendingEvents();
+    void WakeEventThread();
 
     xcb_connection_t *m_connection;
     xcb_screen_t     *m_screen;
@@ -53,6 +63,15 @@ private:
     xcb_atom_t m_wm_delete_window;
 
     bool m_quit_loop;
+
+    // Dedicated event thread state (see EventThreadProc()): the thread only
+    // blocks on the connection socket and marshals the raw events here; they
+    // are handled on the render thread by DispatchPendingEvents(), so every
+    // existing handler stays single-threaded.
+    std::thread       m_eventThread;
+    std::mutex        m_eventMutex;
+    std::vector<xcb_generic_event_t*> m_pendingEvents;
+    std::atomic<bool> m_exitEventThread;
 };
 
 #endif  // SHELL_XCB_H
@@ -19,6 +19,217 @@
 const char* VkParserVideoPictureParameters::m_refClassId = "VkParserVideoPictureParameters";
 int32_t VkParserVideoPictureParameters::m_currentId = 0;
 
+// ---- content-hash helpers for the parameter-set deduplication cache ----
+//
+// FNV-1a over the std parameter-set payloads. The nested pointers are
+// excluded from the top-level struct bytes (their addresses change between
+// parser allocations even when the content repeats) and the pointed-to
+// payloads are hashed separately instead.
+
+static const uint64_t fnv1aOffsetBasis = 14695981039346656037ULL;
+
+static uint64_t HashBytes(const void* pData, size_t size, uint64_t hash)
+{
+    const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(pData);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ pBytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint64_t HashH264Sps(const StdVideoH264SequenceParameterSet* pSps, uint64_t hash)
+{
+    StdVideoH264SequenceParameterSet sps = *pSps;
+    sps.pOffsetForRefFrame = nullptr;
+    sps.pScalingLists = nullptr;
+    sps.pSequenceParameterSetVui = nullptr;
+    hash = HashBytes(&sps, sizeof(sps), hash);
+    if (pSps->pOffsetForRefFrame != nullptr) {
+        hash = HashBytes(pSps->pOffsetForRefFrame,
+                         pSps->num_ref_frames_in_pic_order_cnt_cycle * sizeof(int32_t), hash);
+    }
+    if (pSps->pScalingLists != nullptr) {
+        hash = HashBytes(pSps->pScalingLists, sizeof(*pSps->pScalingLists), hash);
+    }
+    if (pSps->pSequenceParameterSetVui != nullptr) {
+        StdVideoH264SequenceParameterSetVui vui = *pSps->pSequenceParameterSetVui;
+        vui.pHrdParameters = nullptr;
+        hash = HashBytes(&vui, sizeof(vui), hash);
+        if (pSps->pSequenceParameterSetVui->pHrdParameters != nullptr) {
+            hash = HashBytes(pSps->pSequenceParameterSetVui->pHrdParameters,
+                             sizeof(*pSps->pSequenceParameterSetVui->pHrdParameters), hash);
+        }
+    }
+    return hash;
+}
+
+static uint64_t HashH264Pps(const StdVideoH264PictureParameterSet* pPps, uint64_t hash)
+{
+    StdVideoH264PictureParameterSet pps = *pPps;
+    pps.pScalingLists = nullptr;
+    hash = HashBytes(&pps, sizeof(pps), hash);
+    if (pPps->pScalingLists != nullptr) {
+        hash = HashBytes(pPps->pScalingLists, sizeof(*pPps->pScalingLists), hash);
+    }
+    return hash;
+}
+
+static uint64_t HashH265Hrd(const StdVideoH265HrdParameters* pHrd, uint32_t numSubLayers, uint64_t hash)
+{
+    StdVideoH265HrdParameters hrd = *pHrd;
+    hrd.pSubLayerHrdParametersNal = nullptr;
+    hrd.pSubLayerHrdParametersVcl = nullptr;
+    hash = HashBytes(&hrd, sizeof(hrd), hash);
+    if (pHrd->pSubLayerHrdParametersNal != nullptr) {
+        hash = HashBytes(pHrd->pSubLayerHrdParametersNal,
+                         numSubLayers * sizeof(StdVideoH265SubLayerHrdParameters), hash);
+    }
+    if (pHrd->pSubLayerHrdParametersVcl != nullptr) {
+        hash = HashBytes(pHrd->pSubLayerHrdParametersVcl,
+                         numSubLayers * sizeof(StdVideoH265SubLayerHrdParameters), hash);
+    }
+    return hash;
+}
+
+static uint64_t HashH265Vps(const StdVideoH265VideoParameterSet* pVps, uint64_t hash)
+{
+    StdVideoH265VideoParameterSet vps = *pVps;
+    vps.pDecPicBufMgr = nullptr;
+    vps.pHrdParameters = nullptr;
+    vps.pProfileTierLevel = nullptr;
+    hash = HashBytes(&vps, sizeof(vps), hash);
+    if (pVps->pDecPicBufMgr != nullptr) {
+        hash = HashBytes(pVps->pDecPicBufMgr, sizeof(*pVps->pDecPicBufMgr), hash);
+    }
+    if (pVps->pHrdParameters != nullptr) {
+        hash = HashH265Hrd(pVps->pHrdParameters, pVps->vps_max_sub_layers_minus1 + 1u, hash);
+    }
+    if (pVps->pProfileTierLevel != nullptr) {
+        hash = HashBytes(pVps->pProfileTierLevel, sizeof(*pVps->pProfileTierLevel), hash);
+    }
+    return hash;
+}
+
+static uint64_t HashH265Sps(const StdVideoH265SequenceParameterSet* pSps, uint64_t hash)
+{
+    StdVideoH265SequenceParameterSet sps = *pSps;
+    sps.pProfileTierLevel = nullptr;
+    sps.pDecPicBufMgr = nullptr;
+    sps.pScalingLists = nullptr;
+    sps.pShortTermRefPicSet = nullptr;
+    sps.pLongTermRefPicsSps = nullptr;
+    sps.pSequenceParameterSetVui = nullptr;
+    sps.pPredictorPaletteEntries = nullptr;
+    hash = HashBytes(&sps, sizeof(sps), hash);
+    if (pSps->pProfileTierLevel != nullptr) {
+        hash = HashBytes(pSps->pProfileTierLevel, sizeof(*pSps->pProfileTierLevel), hash);
+    }
+    if (pSps->pDecPicBufMgr != nullptr) {
+        hash = HashBytes(pSps->pDecPicBufMgr, sizeof(*pSps->pDecPicBufMgr), hash);
+    }
+    if (pSps->pScalingLists != nullptr) {
+        hash = HashBytes(pSps->pScalingLists, sizeof(*pSps->pScalingLists), hash);
+    }
+    if (pSps->pShortTermRefPicSet != nullptr) {
+        hash = HashBytes(pSps->pShortTermRefPicSet,
+                         pSps->num_short_term_ref_pic_sets * sizeof(StdVideoH265ShortTermRefPicSet), hash);
+    }
+    if (pSps->pLongTermRefPicsSps != nullptr) {
+        hash = HashBytes(pSps->pLongTermRefPicsSps, sizeof(*pSps->pLongTermRefPicsSps), hash);
+    }
+    if (pSps->pSequenceParameterSetVui != nullptr) {
+        StdVideoH265SequenceParameterSetVui vui = *pSps->pSequenceParameterSetVui;
+        vui.pHrdParameters = nullptr;
+        hash = HashBytes(&vui, sizeof(vui), hash);
+        if (pSps->pSequenceParameterSetVui->pHrdParameters != nullptr) {
+            hash = HashH265Hrd(pSps->pSequenceParameterSetVui->pHrdParameters,
+                               pSps->sps_max_sub_layers_minus1 + 1u, hash);
+        }
+    }
+    if (pSps->pPredictorPaletteEntries != nullptr) {
+        hash = HashBytes(pSps->pPredictorPaletteEntries, sizeof(*pSps->pPredictorPaletteEntries), hash);
+    }
+    return hash;
+}
+
+static uint64_t HashH265Pps(const StdVideoH265PictureParameterSet* pPps, uint64_t hash)
+{
+    StdVideoH265PictureParameterSet pps = *pPps;
+    pps.pScalingLists = nullptr;
+    pps.pPredictorPaletteEntries = nullptr;
+    hash = HashBytes(&pps, sizeof(pps), hash);
+    if (pPps->pScalingLists != nullptr) {
+        hash = HashBytes(pPps->pScalingLists, sizeof(*pPps->pScalingLists), hash);
+    }
+    if (pPps->pPredictorPaletteEntries != nullptr) {
+        hash = HashBytes(pPps->pPredictorPaletteEntries, sizeof(*pPps->pPredictorPaletteEntries), hash);
+    }
+    return hash;
+}
+
+uint64_t VkParserVideoPictureParameters::ComputeContentHash(const StdVideoPictureParametersSet* pStdVideoPictureParametersSet)
+{
+    uint64_t hash = fnv1aOffsetBasis;
+    switch (pStdVideoPictureParametersSet->GetStdType())
+    {
+        case StdVideoPictureParametersSet::TYPE_H264_SPS:
+            return HashH264Sps(pStdVideoPictureParametersSet->GetStdH264Sps(), hash);
+        case StdVideoPictureParametersSet::TYPE_H264_PPS:
+            return HashH264Pps(pStdVideoPictureParametersSet->GetStdH264Pps(), hash);
+        case StdVideoPictureParametersSet::TYPE_H265_VPS:
+            return HashH265Vps(pStdVideoPictureParametersSet->GetStdH265Vps(), hash);
+        case StdVideoPictureParametersSet::TYPE_H265_SPS:
+            return HashH265Sps(pStdVideoPictureParametersSet->GetStdH265Sps(), hash);
+        case StdVideoPictureParametersSet::TYPE_H265_PPS:
+            return HashH265Pps(pStdVideoPictureParametersSet->GetStdH265Pps(), hash);
+        default:
+            assert(!"Invalid Parser format");
+    }
+    return hash;
+}
+
+uint32_t VkParserVideoPictureParameters::MakeParameterKey(const StdVideoPictureParametersSet* pStdVideoPictureParametersSet)
+{
+    bool isId = false;
+    int32_t id = -1;
+    switch (pStdVideoPictureParametersSet->GetParameterType()) {
+        case StdVideoPictureParametersSet::PPS_TYPE:
+            id = pStdVideoPictureParametersSet->GetPpsId(isId);
+            break;
+        case StdVideoPictureParametersSet::SPS_TYPE:
+            id = pStdVideoPictureParametersSet->GetSpsId(isId);
+            break;
+        case StdVideoPictureParametersSet::VPS_TYPE:
+            id = pStdVideoPictureParametersSet->GetVpsId(isId);
+            break;
+        default:
+            assert(!"Invalid StdVideoPictureParametersSet Parameter Type!");
+            break;
+    }
+    assert(isId && (id >= 0));
+    return ((uint32_t)pStdVideoPictureParametersSet->GetStdType() << 16) | (uint32_t)id;
+}
+
+bool VkParserVideoPictureParameters::IsIdenticalToAppliedSet(const StdVideoPictureParametersSet* pStdVideoPictureParametersSet) const
+{
+    if (pStdVideoPictureParametersSet == nullptr) {
+        return false;
+    }
+
+    const auto appliedHash = m_appliedParameterHashes.find(MakeParameterKey(pStdVideoPictureParametersSet));
+    if (appliedHash == m_appliedParameterHashes.end()) {
+        return false;
+    }
+
+    return (appliedHash->second == ComputeContentHash(pStdVideoPictureParametersSet));
+}
+
+void VkParserVideoPictureParameters::RecordAppliedSet(const StdVideoPictureParametersSet* pStdVideoPictureParametersSet)
+{
+    m_appliedParameterHashes[MakeParameterKey(pStdVideoPictureParametersSet)] =
+            ComputeContentHash(pStdVideoPictureParametersSet);
+}
+
 int32_t VkParserVideoPictureParameters::PopulateH264UpdateFields(const StdVideoPictureParametersSet* pStdPictureParametersSet,
                                                                  VkVideoDecodeH264SessionParametersAddInfoKHR& h264SessionParametersAddInfo)
 {
@@ -173,6 +384,9 @@ VkResult VkParserVideoPictureParameters::CreateParametersObject(const VulkanDevi
             m_vpsIdsUsed = pTemplatePictureParameters->m_vpsIdsUsed;
             m_spsIdsUsed = pTemplatePictureParameters->m_spsIdsUsed;
             m_ppsIdsUsed = pTemplatePictureParameters->m_ppsIdsUsed;
+            // The template's sets are part of the new object via
+            // videoSessionParametersTemplate, so their hashes carry over too.
+            m_appliedParameterHashes = pTemplatePictureParameters->m_appliedParameterHashes;
         }
 
         assert (currentId >= 0);
@@ -191,6 +405,7 @@ VkResult VkParserVideoPictureParameters::CreateParametersObject(const VulkanDevi
             default:
                 assert(!"Invalid StdVideoPictureParametersSet Parameter Type!");
         }
+        RecordAppliedSet(pStdVideoPictureParametersSet);
         m_Id = ++m_currentId;
     }
 
@@ -203,6 +418,14 @@ VkResult VkParserVideoPictureParameters::UpdateParametersObject(const StdVideoPi
         return VK_SUCCESS;
     }
 
+    // Streams carrying the parameter sets in-band repeat the same SPS/PPS
+    // periodically (typically on every GOP boundary). If the set is
+    // byte-identical to the one already applied under this id, the update
+    // would be a no-op - skip the driver call.
+    if (IsIdenticalToAppliedSet(pStdVideoPictureParametersSet)) {
+        return VK_SUCCESS;
+    }
+
     int32_t currentId = -1;
     VkVideoSessionParametersUpdateInfoKHR updateInfo = { VK_STRUCTURE_TYPE_VIDEO_SESSION_PARAMETERS_UPDATE_INFO_KHR };
     VkVideoDecodeH264SessionParametersAddInfoKHR h264SessionParametersAddInfo = { VK_STRUCTURE_TYPE_VIDEO_DECODE_H264_SESSION_PARAMETERS_ADD_INFO_KHR };
@@ -256,6 +479,7 @@ VkResult VkParserVideoPictureParameters::UpdateParametersObject(const StdVideoPi
             default:
                 assert(!"Invalid StdVideoPictureParametersSet Parameter Type!");
         }
+        RecordAppliedSet(pStdVideoPictureParametersSet);
 
     } else {
         assert(!"Could not update Session Parameters Object");
@@ -266,6 +490,8 @@ VkResult VkParserVideoPictureParameters::UpdateParametersObject(const StdVideoPi
 
 VkParserVideoPictureParameters::~VkParserVideoPictureParameters()
 {
+    VulkanMemoryBudget::RecordFree(VulkanMemoryBudget::MEMORY_POOL_PICTURE_PARAMETERS,
+                                   sizeof(*this));
     if (m_sessionParameters) {
         m_vkDevCtx->DestroyVideoSessionParametersKHR(*m_vkDevCtx, m_sessionParameters, nullptr);
         m_sessionParameters = VkVideoSessionParametersKHR();
@@ -443,6 +669,15 @@ VkParserVideoPictureParameters::AddPictureParameters(const VulkanDeviceContext*
 
     if (currentVideoPictureParameters) {
         currentVideoPictureParameters->FlushPictureParametersQueue(videoSession);
+
+        // A byte-identical in-band repeat of a set already applied to the
+        // current object (even one tagged with updateSequenceCount > 0) needs
+        // neither a new parameters object nor an update. The caller re-binds
+        // currentVideoPictureParameters as the set's client object, so
+        // returning early keeps the bookkeeping intact.
+        if (videoSession && currentVideoPictureParameters->IsIdenticalToAppliedSet(stdPictureParametersSet)) {
+            return VK_SUCCESS;
+        }
     }
 
     VkResult result;
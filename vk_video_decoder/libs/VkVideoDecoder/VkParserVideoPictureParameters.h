@@ -24,6 +24,7 @@
 #include <unordered_map>
 #include "VkVideoCore/VkVideoRefCountBase.h"
 #include "VkCodecUtils/VulkanDeviceContext.h"
+#include "VkCodecUtils/VulkanMemoryBudget.h"
 #include "vkvideo_parser/StdVideoPictureParametersSet.h"
 #include "VkVideoCore/VkVideoCoreProfile.h"
 #include "VkCodecUtils/VulkanVideoSession.h"
@@ -106,6 +107,19 @@ public:
     }
 
 
+    // Content hash of the std parameter-set payload, including the nested
+    // (scaling list, VUI, HRD, ...) payloads, used to recognize byte-identical
+    // in-band repeats of a parameter set. Broadcast streams repeat the same
+    // SPS/PPS every GOP and each repeat would otherwise trigger a
+    // vkUpdateVideoSessionParametersKHR() call or a re-creation of the whole
+    // session parameters object.
+    static uint64_t ComputeContentHash(const StdVideoPictureParametersSet* pStdVideoPictureParametersSet);
+
+    // Returns true when the given parameter set is byte-identical to the set
+    // already applied to this object under the same type and id, so applying
+    // it again would be a no-op for the driver.
+    bool IsIdenticalToAppliedSet(const StdVideoPictureParametersSet* pStdVideoPictureParametersSet) const;
+
     bool UpdatePictureParametersHierarchy(VkSharedBaseObj<StdVideoPictureParametersSet>& pictureParametersObject);
 
     VkResult AddPictureParametersToQueue(VkSharedBaseObj<StdVideoPictureParametersSet>& pictureParametersSet);
@@ -120,7 +134,13 @@ protected:
           m_vkDevCtx(vkDevCtx),
           m_videoSession(),
           m_sessionParameters(),
-          m_templatePictureParameters(templatePictureParameters) { }
+          m_templatePictureParameters(templatePictureParameters)
+    {
+        // The live-object count of this pool attributes parameter-object
+        // leaks across stream loops (see VulkanMemoryBudget).
+        VulkanMemoryBudget::RecordAllocation(VulkanMemoryBudget::MEMORY_POOL_PICTURE_PARAMETERS,
+                                             sizeof(*this));
+    }
 
     virtual ~VkParserVideoPictureParameters();
 
@@ -138,6 +158,13 @@ private:
     std::bitset<MAX_PPS_IDS>        m_ppsIdsUsed;
     VkSharedBaseObj<VkParserVideoPictureParameters> m_templatePictureParameters; // needed only for the create
 
+    // Key is ((StdType << 16) | parameter set id), value the content hash of
+    // the set last applied under that key (see ComputeContentHash()).
+    std::unordered_map<uint32_t, uint64_t> m_appliedParameterHashes;
+
+    static uint32_t MakeParameterKey(const StdVideoPictureParametersSet* pStdVideoPictureParametersSet);
+    void RecordAppliedSet(const StdVideoPictureParametersSet* pStdVideoPictureParametersSet);
+
     std::queue<VkSharedBaseObj<StdVideoPictureParametersSet>>  m_pictureParametersQueue;
     VkSharedBaseObj<StdVideoPictureParametersSet>              m_lastPictParamsQueue[StdVideoPictureParametersSet::NUM_OF_TYPES];
 };
@@ -0,0 +1,132 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "VkVideoDecoder/VkVideoDecodeSessionScheduler.h"
+
+VkResult VkVideoDecodeSessionScheduler::Create(const VulkanDeviceContext* vkDevCtx,
+                                              PlacementPolicy placementPolicy,
+                                              VkSharedBaseObj<VkVideoDecodeSessionScheduler>& videoDecodeSessionScheduler)
+{
+    if ((vkDevCtx->GetVideoDecodeQueueFamilyIdx() == -1) ||
+        (vkDevCtx->GetVideoDecodeNumQueues() < 1)) {
+        fprintf(stderr, "\nERROR: the video device does not expose any decode queues!\n");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    VkSharedBaseObj<VkVideoDecodeSessionScheduler> scheduler(
+            new VkVideoDecodeSessionScheduler(vkDevCtx, placementPolicy));
+    if (!scheduler) {
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    videoDecodeSessionScheduler = scheduler;
+    return VK_SUCCESS;
+}
+
+int32_t VkVideoDecodeSessionScheduler::AcquireVideoQueueIndex(QosClass qosClass)
+{
+    if (m_numVideoQueues < 1) {
+        return -1;
+    }
+
+    int32_t videoQueueIndx = 0;
+    if (qosClass == QOS_REALTIME) {
+
+        // Realtime sessions always go to the queue instance hosting the
+        // fewest realtime sessions, ignoring the placement policy - two
+        // realtime streams sharing a queue while another sits idle would
+        // defeat the class. Total load breaks the ties.
+        int32_t minRealtime = m_videoQueueQosSessionCounts[QOS_REALTIME][0].load(std::memory_order_relaxed);
+        int32_t minSessions = m_videoQueueSessionCounts[0].load(std::memory_order_relaxed);
+        for (int32_t queueIndx = 1; queueIndx < m_numVideoQueues; queueIndx++) {
+            const int32_t numRealtime = m_videoQueueQosSessionCounts[QOS_REALTIME][queueIndx].load(std::memory_order_relaxed);
+            const int32_t numSessions = m_videoQueueSessionCounts[queueIndx].load(std::memory_order_relaxed);
+            if ((numRealtime < minRealtime) ||
+                ((numRealtime == minRealtime) && (numSessions < minSessions))) {
+                minRealtime = numRealtime;
+                minSessions = numSessions;
+                videoQueueIndx = queueIndx;
+            }
+        }
+
+    } else if (m_placementPolicy == PLACEMENT_ROUND_ROBIN) {
+
+        // Rotate as before, but skip the queue instances hosting realtime
+        // sessions while an instance without one remains.
+        for (int32_t attempt = 0; attempt < m_numVideoQueues; attempt++) {
+            videoQueueIndx = m_nextVideoQueueIndx.fetch_add(1, std::memory_order_relaxed) % m_numVideoQueues;
+            if (m_videoQueueQosSessionCounts[QOS_REALTIME][videoQueueIndx].load(std::memory_order_relaxed) == 0) {
+                break;
+            }
+        }
+
+    } else { // PLACEMENT_LEAST_LOADED
+
+        // Queues free of realtime sessions always win over queues hosting
+        // one, however lightly those are loaded otherwise.
+        int32_t minRealtime = m_videoQueueQosSessionCounts[QOS_REALTIME][0].load(std::memory_order_relaxed);
+        int32_t minSessions = m_videoQueueSessionCounts[0].load(std::memory_order_relaxed);
+        for (int32_t queueIndx = 1; queueIndx < m_numVideoQueues; queueIndx++) {
+            const int32_t numRealtime = m_videoQueueQosSessionCounts[QOS_REALTIME][queueIndx].load(std::memory_order_relaxed);
+            const int32_t numSessions = m_videoQueueSessionCounts[queueIndx].load(std::memory_order_relaxed);
+            if (((numRealtime == 0) && (minRealtime > 0)) ||
+                (((numRealtime == 0) == (minRealtime == 0)) && (numSessions < minSessions))) {
+                minRealtime = numRealtime;
+                minSessions = numSessions;
+                videoQueueIndx = queueIndx;
+            }
+        }
+    }
+
+    m_videoQueueSessionCounts[videoQueueIndx]++;
+    m_videoQueueQosSessionCounts[qosClass][videoQueueIndx]++;
+    return videoQueueIndx;
+}
+
+void VkVideoDecodeSessionScheduler::ReleaseVideoQueueIndex(int32_t videoQueueIndx, QosClass qosClass)
+{
+    assert((videoQueueIndx >= 0) && (videoQueueIndx < m_numVideoQueues));
+    const int32_t numQosSessions = --m_videoQueueQosSessionCounts[qosClass][videoQueueIndx];
+    const int32_t numSessions = --m_videoQueueSessionCounts[videoQueueIndx];
+    assert((numSessions >= 0) && (numQosSessions >= 0));
+    (void)numSessions;
+    (void)numQosSessions;
+}
+
+VkResult VkVideoDecodeSessionScheduler::CreateDecoder(VkSharedBaseObj<VulkanVideoFrameBuffer>& videoFrameBuffer,
+                                                      bool useLinearOutput, QosClass qosClass,
+                                                      VkSharedBaseObj<VkVideoDecoder>& vkVideoDecoder,
+                                                      int32_t& videoQueueIndx)
+{
+    videoQueueIndx = AcquireVideoQueueIndex(qosClass);
+    if (videoQueueIndx < 0) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    VkResult result = VkVideoDecoder::Create(m_vkDevCtx, videoFrameBuffer,
+                                             videoQueueIndx, useLinearOutput,
+                                             (qosClass == QOS_REALTIME),
+                                             8,  // numDecodeImagesInFlight
+                                             -1, // numDecodeImagesToPreallocate
+                                             8,  // numBitstreamBuffersToPreallocate
+                                             vkVideoDecoder);
+    if (result != VK_SUCCESS) {
+        ReleaseVideoQueueIndex(videoQueueIndx, qosClass);
+        videoQueueIndx = -1;
+    }
+
+    return result;
+}
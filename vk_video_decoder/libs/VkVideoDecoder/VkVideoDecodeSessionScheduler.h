@@ -0,0 +1,138 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#ifndef _VKVIDEODECODESESSIONSCHEDULER_H_
+#define _VKVIDEODECODESESSIONSCHEDULER_H_
+
+#include <array>
+#include <atomic>
+#include <mutex>
+
+#include "VkCodecUtils/VulkanDeviceContext.h"
+#include "VkVideoDecoder/VkVideoDecoder.h"
+
+/**
+ * @brief Places multiple decode sessions across the available video decode queue instances.
+ *
+ * A single process can create many VkVideoDecoder instances (one per stream). Each decoder
+ * submits to exactly one decode queue instance, selected at Create() time via videoQueueIndx.
+ * This scheduler picks that queue index for each new session so that sessions are spread
+ * across all decode queue instances exposed by VulkanDeviceContext, instead of all sessions
+ * serializing on the default queue. Queue submission itself stays safe via the per-queue
+ * mutexes that VulkanDeviceContext::MultiThreadedQueueSubmit() already takes.
+ *
+ * Sessions carry a QoS class. Realtime sessions are spread by realtime load first, and
+ * best-effort sessions avoid the queue instances hosting realtime sessions as long as a
+ * queue without one exists - so a deadline-driven stream shares its queue with best-effort
+ * work only when the device is oversubscribed. The submission-order half of the policy
+ * lives in VulkanDeviceContext::MultiThreadedQueueSubmitBatchQos(), driven by the
+ * realtimePriority the created decoders are given.
+ */
+class VkVideoDecodeSessionScheduler : public VkVideoRefCountBase {
+public:
+
+    enum PlacementPolicy {
+        PLACEMENT_ROUND_ROBIN = 0, // rotate over the queue instances in creation order
+        PLACEMENT_LEAST_LOADED,    // pick the queue instance with the fewest active sessions
+    };
+
+    enum QosClass {
+        QOS_BEST_EFFORT = 0, // batch/offline streams with no deadline
+        QOS_REALTIME,        // deadline-driven streams; never starved behind best-effort work
+        NUM_QOS_CLASSES
+    };
+
+    static VkResult Create(const VulkanDeviceContext* vkDevCtx,
+                           PlacementPolicy placementPolicy,
+                           VkSharedBaseObj<VkVideoDecodeSessionScheduler>& videoDecodeSessionScheduler);
+
+    virtual int32_t AddRef()
+    {
+        return ++m_refCount;
+    }
+
+    virtual int32_t Release()
+    {
+        uint32_t ret = --m_refCount;
+        // Destroy the device if ref-count reaches zero
+        if (ret == 0) {
+            delete this;
+        }
+        return ret;
+    }
+
+    // Picks a decode queue instance for a new session of the class and marks
+    // it busy. Returns a negative value if the device does not expose any
+    // decode queues.
+    int32_t AcquireVideoQueueIndex(QosClass qosClass = QOS_BEST_EFFORT);
+
+    // Returns a decode queue instance obtained from AcquireVideoQueueIndex()
+    // after the session that used it has been destroyed. The class must be
+    // the one the queue instance was acquired with.
+    void ReleaseVideoQueueIndex(int32_t videoQueueIndx, QosClass qosClass = QOS_BEST_EFFORT);
+
+    // Creates a new decoder instance on a scheduler-selected decode queue,
+    // with realtime submission priority when the class is QOS_REALTIME. The
+    // scheduler slot is released when ReleaseVideoQueueIndex() is called with
+    // the created decoder's queue index (see GetVideoQueueSessionCount()).
+    VkResult CreateDecoder(VkSharedBaseObj<VulkanVideoFrameBuffer>& videoFrameBuffer,
+                           bool useLinearOutput, QosClass qosClass,
+                           VkSharedBaseObj<VkVideoDecoder>& vkVideoDecoder,
+                           int32_t& videoQueueIndx);
+
+    int32_t GetVideoQueueSessionCount(int32_t videoQueueIndx) const
+    {
+        assert((videoQueueIndx >= 0) && (videoQueueIndx < m_numVideoQueues));
+        return m_videoQueueSessionCounts[videoQueueIndx].load(std::memory_order_relaxed);
+    }
+
+    int32_t GetVideoQueueQosSessionCount(int32_t videoQueueIndx, QosClass qosClass) const
+    {
+        assert((videoQueueIndx >= 0) && (videoQueueIndx < m_numVideoQueues));
+        return m_videoQueueQosSessionCounts[qosClass][videoQueueIndx].load(std::memory_order_relaxed);
+    }
+
+    int32_t GetNumVideoQueues() const { return m_numVideoQueues; }
+
+private:
+
+    VkVideoDecodeSessionScheduler(const VulkanDeviceContext* vkDevCtx,
+                                  PlacementPolicy placementPolicy)
+        : m_refCount(0)
+        , m_vkDevCtx(vkDevCtx)
+        , m_placementPolicy(placementPolicy)
+        , m_numVideoQueues(vkDevCtx->GetVideoDecodeNumQueues())
+        , m_nextVideoQueueIndx(0)
+        , m_videoQueueSessionCounts{}
+        , m_videoQueueQosSessionCounts{}
+    {
+        assert(m_numVideoQueues <= VulkanDeviceContext::MAX_QUEUE_INSTANCES);
+    }
+
+    virtual ~VkVideoDecodeSessionScheduler() {}
+
+private:
+    std::atomic<int32_t>        m_refCount;
+    const VulkanDeviceContext*  m_vkDevCtx;
+    const PlacementPolicy       m_placementPolicy;
+    const int32_t               m_numVideoQueues;
+    std::atomic<int32_t>        m_nextVideoQueueIndx;
+    std::array<std::atomic<int32_t>, VulkanDeviceContext::MAX_QUEUE_INSTANCES> m_videoQueueSessionCounts;
+    std::array<std::array<std::atomic<int32_t>, VulkanDeviceContext::MAX_QUEUE_INSTANCES>,
+               NUM_QOS_CLASSES> m_videoQueueQosSessionCounts;
+};
+
+#endif /* _VKVIDEODECODESESSIONSCHEDULER_H_ */
@@ -19,6 +19,8 @@
 #include <iostream>
 
 #include "VkVideoCore/VulkanVideoCapabilities.h"
+#include "VkCodecUtils/VulkanMemoryBudget.h"
+#include "VkCodecUtils/VulkanVideoInstrumentation.h"
 #include "VkVideoDecoder/VkVideoDecoder.h"
 #include "nvidia_utils/vulkan/ycbcrvkinfo.h"
 
@@ -28,6 +30,11 @@
 #define GPU_ALIGN(x) (((x) + 0xff) & ~0xff)
 
 const uint64_t gFenceTimeout = 100 * 1000 * 1000 /* 100 mSec */;
+// How long the adaptive in-flight throttle is allowed to hold a submission
+// back (see DecodePictureWithParameters()). Intentionally short: a longer
+// wait means the consumer is genuinely behind and the right response is to
+// grow the window, not to stall the decode queue.
+const uint64_t gInFlightWaitTimeout = 4 * 1000 * 1000 /* 4 mSec */;
 
 const char* VkVideoDecoder::GetVideoCodecString(VkVideoCodecOperationFlagBitsKHR codec)
 {
@@ -74,6 +81,47 @@ const char* VkVideoDecoder::GetVideoChromaFormatString(VkVideoChromaSubsamplingF
     return "Unknown";
 }
 
+bool VkVideoDecoder::IsSequenceCompatibleWithCurrentConfig(const VkParserDetectedVideoFormat* pVideoFormat) const
+{
+    if (!m_videoSession || !(m_videoFormat.coded_width && m_videoFormat.coded_height)) {
+        // The decoder has not been configured yet.
+        return false;
+    }
+
+    // The decode format must be unchanged - any of those mismatching requires
+    // a new video session and/or a new image pool.
+    if ((m_videoFormat.codec             != pVideoFormat->codec) ||
+        (m_videoFormat.codecProfile      != pVideoFormat->codecProfile) ||
+        (m_videoFormat.chromaSubsampling != pVideoFormat->chromaSubsampling) ||
+        (m_videoFormat.lumaBitDepth      != pVideoFormat->lumaBitDepth) ||
+        (m_videoFormat.chromaBitDepth    != pVideoFormat->chromaBitDepth) ||
+        (m_videoFormat.progressive_sequence != pVideoFormat->progressive_sequence)) {
+        return false;
+    }
+
+    // The coded extent does not have to match exactly: the video session
+    // accepts any extent up to the maxCodedExtent it was created with and
+    // the pool images were sized for at least that much, so an SPS update
+    // that repeats or shrinks the extent (SPS repeats are common splice and
+    // error-recovery practice, and adaptive streams switch down) keeps every
+    // device object. Display-area-only changes are always compatible - the
+    // crop travels with each picture's display info, not with the session.
+    if ((pVideoFormat->coded_width  > m_videoSession->GetMaxCodedExtent().width) ||
+        (pVideoFormat->coded_height > m_videoSession->GetMaxCodedExtent().height)) {
+        return false;
+    }
+
+    // The current DPB must be deep enough for the new sequence. The session
+    // creation limit is the reference here, not the previous sequence's
+    // requirement, which may have been lower.
+    if (((pVideoFormat->minNumDecodeSurfaces + m_numDecodeImagesInFlight) > m_numDecodeSurfaces) ||
+        (pVideoFormat->maxNumDpbSlots > m_videoSession->GetMaxDpbSlots())) {
+        return false;
+    }
+
+    return true;
+}
+
 /* Callback function to be registered for getting a callback when decoding of
  * sequence starts. Return value from HandleVideoSequence() are interpreted as :
  *  0: fail, 1: suceeded, > 1: override dpb size of parser (set by
@@ -81,6 +129,25 @@ const char* VkVideoDecoder::GetVideoChromaFormatString(VkVideoChromaSubsamplingF
  */
 int32_t VkVideoDecoder::StartVideoSequence(VkParserDetectedVideoFormat* pVideoFormat)
 {
+    // Looped playback, playlist splice points and mid-stream SPS updates
+    // restart the sequence, usually with unchanged or merely repeated
+    // parameters. When the new sequence is compatible with the current
+    // configuration, keep the video session, the DPB image pool, the query
+    // pool and the bitstream buffers alive and just continue decoding - no
+    // device or queue idle, no in-flight frame drain and no reallocation.
+    if (IsSequenceCompatibleWithCurrentConfig(pVideoFormat)) {
+        if (m_dumpDecodeData) {
+            std::cout << "Compatible video sequence change - reusing the current video session and image pool." << std::endl;
+        }
+        // The (possibly shrunken) coded extent is stamped into the picture
+        // resources of every decode queued from here on; pictures already in
+        // flight keep the extent they were submitted with.
+        VkExtent2D newCodedExtent = { pVideoFormat->coded_width, pVideoFormat->coded_height };
+        m_videoFrameBuffer->SetCodedExtent(newCodedExtent);
+        m_videoFormat = *pVideoFormat;
+        return m_numDecodeSurfaces;
+    }
+
     const bool testUseLargestSurfaceExtent = false;
     // Assume 4k content for testing surfaces
     const uint32_t surfaceMinWidthExtent  = 4096;
@@ -112,6 +179,11 @@ int32_t VkVideoDecoder::StartVideoSequence(VkParserDetectedVideoFormat* pVideoFo
 
     m_numDecodeSurfaces = std::max(m_numDecodeSurfaces, (pVideoFormat->minNumDecodeSurfaces + m_numDecodeImagesInFlight));
 
+    // The image pool below recreates the per-picture fences, so the adaptive
+    // throttle must forget the previous sequence's handles and re-measure.
+    m_inFlightConsumerFences.clear();
+    m_inFlightDepthController.Reset(m_numDecodeImagesInFlight);
+
     VkResult result = VK_SUCCESS;
 
     int32_t videoQueueFamily = m_vkDevCtx->GetVideoDecodeQueueFamilyIdx();
@@ -186,6 +258,22 @@ int32_t VkVideoDecoder::StartVideoSequence(VkParserDetectedVideoFormat* pVideoFo
         return -1;
     }
 
+    // Zero-copy presentation: when the implementation decodes with the
+    // output picture coinciding with the DPB picture, the display path
+    // samples the decode image directly through the immutable Y'CbCr
+    // sampler (see VulkanVideoUtils), so no separate output image and no
+    // full-frame copy is needed per displayed frame. A linear host-visible
+    // output still needs its own image, and DISTINCT-only implementations
+    // keep the separate-image copy path as the fallback.
+    m_capabilityFlags = (VkVideoDecodeCapabilityFlagBitsKHR)videoDecodeCapabilities.flags;
+    m_dpbAndOutputCoincide =
+            ((m_capabilityFlags & VK_VIDEO_DECODE_CAPABILITY_DPB_AND_OUTPUT_COINCIDE_BIT_KHR) != 0) ? 1 : 0;
+    if (!m_dpbAndOutputCoincide || m_forceSeparateOutputImages) {
+        m_useSeparateOutputImages = true;
+    } else if (!m_useLinearOutput) {
+        m_useSeparateOutputImages = false;
+    }
+
     imageExtent.width  = std::max(imageExtent.width, videoCapabilities.minCodedExtent.width);
     imageExtent.height = std::max(imageExtent.height, videoCapabilities.minCodedExtent.height);
 
@@ -217,6 +305,92 @@ int32_t VkVideoDecoder::StartVideoSequence(VkParserDetectedVideoFormat* pVideoFo
         // after creating a new video session, we need codec reset.
         m_resetDecoder = true;
         assert(result == VK_SUCCESS);
+        VK_VIDEO_PROBE_COUNT(SESSION_CREATIONS);
+        VK_VIDEO_PROBE_TRACE("StartVideoSequence: created video session %ux%u, maxDpbSlotCount %u",
+                             imageExtent.width, imageExtent.height, maxDpbSlotCount);
+    }
+
+    VkImageUsageFlags imageUsage = VK_IMAGE_USAGE_SAMPLED_BIT |
+                                   VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                                   VK_IMAGE_USAGE_VIDEO_DECODE_DST_BIT_KHR |
+                                   VK_IMAGE_USAGE_VIDEO_DECODE_DPB_BIT_KHR;
+
+    // Zero-copy transcode mode (see EnableEncoderInputSharing()): the decoded
+    // pictures feed an encoder directly, so the images also need the encode
+    // input usage, the matching encode profile in their profile list and
+    // sharing with the encode queue family.
+    VkVideoCoreProfile encodeProfile;
+    const VkVideoProfileInfoKHR* pEncodeProfile = nullptr;
+    uint32_t encodeQueueFamilyIndex = (uint32_t)-1;
+    if (m_enableEncoderInputSharing) {
+        if (m_vkDevCtx->GetVideoEncodeQueueFamilyIdx() != -1) {
+            const VkVideoProfileInfoKHR* pDecodeProfile = videoProfile.GetProfile();
+            const VkVideoCodecOperationFlagBitsKHR encodeCodec =
+                    (videoCodec == VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR) ?
+                            VK_VIDEO_CODEC_OPERATION_ENCODE_H265_BIT_EXT :
+                            VK_VIDEO_CODEC_OPERATION_ENCODE_H264_BIT_EXT;
+            const uint32_t encodeProfileIdc =
+                    (encodeCodec == VK_VIDEO_CODEC_OPERATION_ENCODE_H265_BIT_EXT) ?
+                            (uint32_t)STD_VIDEO_H265_PROFILE_IDC_MAIN :
+                            (uint32_t)STD_VIDEO_H264_PROFILE_IDC_HIGH;
+            encodeProfile = VkVideoCoreProfile(encodeCodec,
+                                               pDecodeProfile->chromaSubsampling,
+                                               pDecodeProfile->lumaBitDepth,
+                                               pDecodeProfile->chromaBitDepth,
+                                               encodeProfileIdc);
+            pEncodeProfile = encodeProfile.GetProfile();
+            encodeQueueFamilyIndex = (uint32_t)m_vkDevCtx->GetVideoEncodeQueueFamilyIdx();
+            imageUsage |= VK_IMAGE_USAGE_VIDEO_ENCODE_SRC_BIT_KHR;
+        } else {
+            fprintf(stderr, "\nWARNING: No encode queue on the device - the decoded images will not be shareable with an encoder.\n");
+            m_enableEncoderInputSharing = false;
+        }
+    }
+
+    // Admission control for the image pool: when the device-local budget
+    // cannot fit all requested surfaces, downgrade the pool instead of
+    // failing an allocation mid-stream later. The sequence is rejected only
+    // when even the parser-required minimum surface count does not fit.
+    uint32_t chromaBytesNum = 3, chromaBytesDen = 2; // 4:2:0
+    if (pVideoFormat->chromaSubsampling == VK_VIDEO_CHROMA_SUBSAMPLING_422_BIT_KHR) {
+        chromaBytesNum = 2; chromaBytesDen = 1;
+    } else if (pVideoFormat->chromaSubsampling == VK_VIDEO_CHROMA_SUBSAMPLING_444_BIT_KHR) {
+        chromaBytesNum = 3; chromaBytesDen = 1;
+    } else if (pVideoFormat->chromaSubsampling == VK_VIDEO_CHROMA_SUBSAMPLING_MONOCHROME_BIT_KHR) {
+        chromaBytesNum = 1; chromaBytesDen = 1;
+    }
+    const VkDeviceSize bytesPerPel = (pVideoFormat->bit_depth_luma_minus8 > 0) ? 2 : 1;
+    VkDeviceSize estimatedBytesPerSurface = (((VkDeviceSize)imageExtent.width * imageExtent.height *
+                                                     chromaBytesNum) / chromaBytesDen) * bytesPerPel;
+    if (m_useSeparateOutputImages) {
+        estimatedBytesPerSurface *= 2;
+    }
+    const uint32_t requestedDecodeSurfaces = m_numDecodeSurfaces;
+    const uint32_t minRequiredSurfaces = pVideoFormat->minNumDecodeSurfaces;
+    while ((m_numDecodeSurfaces > minRequiredSurfaces) &&
+            !VulkanMemoryBudget::CanAllocate(m_vkDevCtx, m_numDecodeSurfaces * estimatedBytesPerSurface)) {
+        m_numDecodeSurfaces--;
+    }
+    if (!VulkanMemoryBudget::CanAllocate(m_vkDevCtx, m_numDecodeSurfaces * estimatedBytesPerSurface)) {
+        fprintf(stderr, "\nERROR: StartVideoSequence(): the device memory budget cannot fit "
+                        "the minimum of %u decode surfaces\n", m_numDecodeSurfaces);
+        VulkanMemoryBudget::DumpSnapshot(m_vkDevCtx, std::cout);
+        return -1;
+    }
+    if (m_numDecodeSurfaces < requestedDecodeSurfaces) {
+        fprintf(stderr, "\nWARNING: StartVideoSequence(): the device memory budget only fits "
+                        "%u of the %u requested decode surfaces\n",
+                m_numDecodeSurfaces, requestedDecodeSurfaces);
+    }
+
+    int32_t numDecodeImagesToPreallocate = m_numDecodeImagesToPreallocate;
+    if (m_useOnDemandDpbAllocation) {
+        // On-demand DPB backing: defer every surface and let the image pool
+        // create one only when the stream first references its slot. Needs
+        // discrete images - an image array is one shared allocation.
+        m_useImageArray = false;
+        m_useImageViewArray = false;
+        numDecodeImagesToPreallocate = 0;
     }
 
     int32_t ret =
@@ -226,39 +400,113 @@ int32_t VkVideoDecoder::StartVideoSequence(VkParserDetectedVideoFormat* pVideoFo
                                        codedExtent,
                                        imageExtent,
                                        VK_IMAGE_TILING_OPTIMAL,
-                                       VK_IMAGE_USAGE_SAMPLED_BIT |
-                                       VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-                                            VK_IMAGE_USAGE_VIDEO_DECODE_DST_BIT_KHR |
-                                            VK_IMAGE_USAGE_VIDEO_DECODE_DPB_BIT_KHR,
+                                       imageUsage,
                                        m_vkDevCtx->GetVideoDecodeQueueFamilyIdx(),
-                                       m_numDecodeImagesToPreallocate,
+                                       numDecodeImagesToPreallocate,
                                        m_useImageArray, m_useImageViewArray,
-                                       m_useSeparateOutputImages, m_useLinearOutput);
+                                       m_useSeparateOutputImages, m_useLinearOutput,
+                                       pEncodeProfile, encodeQueueFamilyIndex,
+                                       m_useOnDemandDpbAllocation);
 
     assert((uint32_t)ret == m_numDecodeSurfaces);
     if ((uint32_t)ret != m_numDecodeSurfaces) {
         fprintf(stderr, "\nERROR: InitImagePool() ret(%d) != m_numDecodeSurfaces(%d)\n", ret, m_numDecodeSurfaces);
     }
 
+    if (m_enableGpuFrameChecksums) {
+        // The checksum dispatch waits for the decode-complete point on the
+        // session timeline semaphore, so the timeline mode is required.
+        result = m_videoFrameBuffer->EnableTimelineFrameSync();
+        if ((result == VK_SUCCESS) && !m_frameChecksum) {
+            result = VulkanFrameChecksum::Create(m_vkDevCtx, m_frameChecksum);
+        }
+        if (result != VK_SUCCESS) {
+            std::cerr << "WARNING: GPU frame checksums are not available - continuing without validation!" << std::endl;
+            m_enableGpuFrameChecksums = false;
+            m_frameChecksum = nullptr;
+        }
+    }
+
+    if (m_enableGpuFrameAnalysis) {
+        // The analysis dispatch waits on the session timeline semaphore the
+        // same way the checksum dispatch does.
+        result = m_videoFrameBuffer->EnableTimelineFrameSync();
+        if ((result == VK_SUCCESS) && !m_frameAnalysis) {
+            result = VulkanFrameAnalysis::Create(m_vkDevCtx, m_frameAnalysis);
+        }
+        if (result != VK_SUCCESS) {
+            std::cerr << "WARNING: GPU frame analysis is not available - continuing without the QC statistics!" << std::endl;
+            m_enableGpuFrameAnalysis = false;
+            m_frameAnalysis = nullptr;
+        }
+    }
+
     if (m_dumpDecodeData) {
         std::cout << "Allocating Video Device Memory" << std::endl
                   << "Allocating " << m_numDecodeSurfaces << " Num Decode Surfaces and "
                   << maxDpbSlotCount << " Video Device Memory Images for DPB " << std::endl
                   << imageExtent.width << " x " << imageExtent.height << std::endl;
+        VulkanMemoryBudget::DumpSnapshot(m_vkDevCtx, std::cout);
     }
     m_maxDecodeFramesCount = m_numDecodeSurfaces;
 
     // There will be no more than 32 frames in the queue.
     m_decodeFramesData.resize(std::max<uint32_t>(m_maxDecodeFramesCount, 32));
 
+    // A pending batch can never hold more pictures than there are decode
+    // slots, so reserving here keeps the per-picture push_back in
+    // DecodePictureWithParameters() allocation-free.
+    m_pendingDecodeSubmits.reserve(std::max<uint32_t>(m_maxDecodeFramesCount, 32));
+
+    // Same bound for the QoS window's fence list - the push_back in
+    // DecodePictureWithParameters() caps its size at the in-flight depth.
+    m_inFlightConsumerFences.reserve(std::max<uint32_t>(m_maxDecodeFramesCount, 32));
+
+    // When the device has a dedicated DMA queue, the copy to the separate or
+    // linear output image is moved off the decode queue, so the decode of the
+    // next frame overlaps the readback copy of the previous one. Without one
+    // the copy stays on the decode queue, recorded after the decode commands.
+    // No copy resources are needed in the direct-to-output decode mode of
+    // DISTINCT-only implementations (see DecodePictureWithParameters()).
+    const bool outputNeedsCopy = m_useLinearOutput ||
+            (m_useSeparateOutputImages && m_dpbAndOutputCoincide);
+    if (outputNeedsCopy) {
+        if (m_vkDevCtx->GetTransferQueueFamilyIdx() != -1) {
+            result = CreateTransferCopyResources(std::max<uint32_t>(m_maxDecodeFramesCount, 32));
+            if (result != VK_SUCCESS) {
+                std::cerr << "WARNING: could not set up the transfer-queue output copy - "
+                             "keeping the copies on the decode queue!" << std::endl;
+                DestroyTransferCopyResources();
+            }
+        }
+    }
+
+    if (m_enableDecodeGpuTimeStats) {
+        CreateGpuTimestampQueryPool(std::max<uint32_t>(m_maxDecodeFramesCount, 32));
+    }
+
+
+    // The adaptive pool manager allocates buffers off the hot path and needs
+    // the alignments the capabilities mandate (see BitstreamPoolManagerProc()).
+    m_bitstreamBufferOffsetAlignment = videoCapabilities.minBitstreamBufferOffsetAlignment;
+    m_bitstreamBufferSizeAlignment   = videoCapabilities.minBitstreamBufferSizeAlignment;
+
+    // In the adaptive pool mode the preallocation only seeds the configured
+    // minimum; the manager grows the pool from the observed misses.
+    int32_t targetPreallocatedBuffers = m_numBitstreamBuffersToPreallocate;
+    if (m_enableAdaptiveBitstreamPool) {
+        m_bitstreamPoolMaxBuffers = (int32_t)m_decodeFramesData.GetBitstreamBuffersQueue().
+                                                          SetMaxNodes(m_bitstreamPoolMaxBuffers);
+        targetPreallocatedBuffers = m_bitstreamPoolMinBuffers;
+    }
 
     int32_t availableBuffers = (int32_t)m_decodeFramesData.GetBitstreamBuffersQueue().
                                                       GetAvailableNodesNumber();
-    if (availableBuffers < m_numBitstreamBuffersToPreallocate) {
+    if (availableBuffers < targetPreallocatedBuffers) {
 
         uint32_t allocateNumBuffers = std::min<uint32_t>(
                 m_decodeFramesData.GetBitstreamBuffersQueue().GetMaxNodes(),
-                (m_numBitstreamBuffersToPreallocate - availableBuffers));
+                (targetPreallocatedBuffers - availableBuffers));
 
         allocateNumBuffers = std::min<uint32_t>(allocateNumBuffers,
                 m_decodeFramesData.GetBitstreamBuffersQueue().GetFreeNodesNumber());
@@ -266,7 +514,11 @@ int32_t VkVideoDecoder::StartVideoSequence(VkParserDetectedVideoFormat* pVideoFo
         for (uint32_t i = 0; i < allocateNumBuffers; i++) {
 
             VkSharedBaseObj<VulkanBitstreamBufferImpl> bitstreamBuffer;
+            // The predictor carries the access-unit statistics of the
+            // previous stream across a sequence restart, so the pool for the
+            // next stream starts out at the right size.
             size_t allocSize = std::max<size_t>(m_maxStreamBufferSize, 2 * 1024 * 1024);
+            allocSize = std::max(allocSize, m_bitstreamSizePredictor.GetPredictedSize());
 
             result = VulkanBitstreamBufferImpl::Create(m_vkDevCtx,
                     m_vkDevCtx->GetVideoDecodeQueueFamilyIdx(),
@@ -289,6 +541,12 @@ int32_t VkVideoDecoder::StartVideoSequence(VkParserDetectedVideoFormat* pVideoFo
         }
     }
 
+    // Kept running across sequence reconfigurations, like the frame buffer's
+    // query harvester - the pool and its statistics outlive the sequence.
+    if (m_enableAdaptiveBitstreamPool && !m_bitstreamPoolManagerThread.joinable()) {
+        StartBitstreamPoolManagerThread();
+    }
+
     // Save the original config
     m_videoFormat = *pVideoFormat;
     return m_numDecodeSurfaces;
@@ -302,6 +560,29 @@ bool VkVideoDecoder::UpdatePictureParameters(VkSharedBaseObj<StdVideoPicturePara
                                                                            pictureParametersObject,
                                                                            m_currentPictureParameters);
 
+    // Display-order output prediction (see EnableDisplayOrderPrediction()):
+    // the reorder depth the active SPS commits the stream to. A stream that
+    // does not signal its depth keeps the prediction off (-1) - the parser's
+    // conservative output delay is the only correct behavior then.
+    if (m_enableDisplayOrderPrediction && (pictureParametersObject != nullptr)) {
+        int32_t reorderDepth = -1;
+        const StdVideoH264SequenceParameterSet* h264Sps = pictureParametersObject->GetStdH264Sps();
+        const StdVideoH265SequenceParameterSet* h265Sps = pictureParametersObject->GetStdH265Sps();
+        if (h264Sps != nullptr) {
+            if (h264Sps->flags.vui_parameters_present_flag &&
+                    (h264Sps->pSequenceParameterSetVui != nullptr) &&
+                    h264Sps->pSequenceParameterSetVui->flags.bitstream_restriction_flag) {
+                reorderDepth = h264Sps->pSequenceParameterSetVui->max_num_reorder_frames;
+            }
+            m_videoFrameBuffer->SetDisplayOrderPredictionDepth(reorderDepth);
+        } else if (h265Sps != nullptr) {
+            if (h265Sps->pDecPicBufMgr != nullptr) {
+                reorderDepth = h265Sps->pDecPicBufMgr->max_num_reorder_pics[h265Sps->sps_max_sub_layers_minus1];
+            }
+            m_videoFrameBuffer->SetDisplayOrderPredictionDepth(reorderDepth);
+        }
+    }
+
     client = m_currentPictureParameters;
     return (result == VK_SUCCESS);
 }
@@ -397,6 +678,20 @@ int VkVideoDecoder::DecodePictureWithParameters(VkParserPerFrameDecodeParameters
         fprintf(stderr, "\nERROR: DecodePictureWithParameters() retPicIdx(%d) != currPicIdx(%d)\n", retPicIdx, currPicIdx);
     }
 
+    // If this decode slot still has a submission pending in the batch, flush
+    // the batch before the slot's fence and command buffer get recycled below.
+    for (size_t pendingIdx = 0; pendingIdx < m_pendingDecodeSubmits.size(); pendingIdx++) {
+        if (m_pendingDecodeSubmits[pendingIdx].commandBuffer == frameDataSlot.commandBuffer) {
+            FlushPendingSubmits();
+            break;
+        }
+    }
+
+    if (m_enableDecodeGpuTimeStats) {
+        // Collect the GPU time of the previous decode that used this slot.
+        HarvestGpuTimestamps((uint32_t)currPicIdx);
+    }
+
     assert(pPicParams->bitstreamData->GetMaxSize() >= pPicParams->bitstreamDataLen);
 
     pPicParams->decodeFrameInfo.srcBuffer = pPicParams->bitstreamData->GetBuffer();
@@ -404,6 +699,11 @@ int VkVideoDecoder::DecodePictureWithParameters(VkParserPerFrameDecodeParameters
     assert(pPicParams->firstSliceIndex == 0);
     pPicParams->decodeFrameInfo.srcBufferOffset = pPicParams->bitstreamDataOffset;
     pPicParams->decodeFrameInfo.srcBufferRange = pPicParams->bitstreamDataLen;
+
+    VK_VIDEO_PROBE_COUNT(DECODED_PICTURES);
+    VK_VIDEO_PROBE_COUNT_ADD(BITSTREAM_BYTES, pPicParams->bitstreamDataLen);
+    VK_VIDEO_PROBE_TRACE("DecodePictureWithParameters: picIdx %d, decodeOrder %d, bitstreamDataLen %zu",
+                         currPicIdx, picNumInDecodeOrder, (size_t)pPicParams->bitstreamDataLen);
     // pPicParams->decodeFrameInfo.dstImageView = VkImageView();
 
     VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
@@ -431,6 +731,18 @@ int VkVideoDecoder::DecodePictureWithParameters(VkParserPerFrameDecodeParameters
         assert(!"GetImageResourcesByIndex has failed");
     }
 
+    // DISTINCT-only implementation: the decoder writes the output picture
+    // directly into the separate output image while the setup reference
+    // slot receives the reconstructed DPB picture, so no output copy is
+    // recorded and the display samples the output image as-is. The linear
+    // host output keeps the copy, since a linear image cannot be a decode
+    // destination.
+    const bool decodeDirectToOutput = m_useSeparateOutputImages && !m_useLinearOutput &&
+                                      !m_dpbAndOutputCoincide;
+    if (decodeDirectToOutput) {
+        pPicParams->decodeFrameInfo.dstPictureResource = currentOutputPictureResource;
+    }
+
     assert(pPicParams->decodeFrameInfo.srcBuffer);
     const VkBufferMemoryBarrier2KHR bitstreamBufferMemoryBarrier = {
         VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2_KHR,
@@ -471,7 +783,9 @@ int VkVideoDecoder::DecodePictureWithParameters(VkParserPerFrameDecodeParameters
             } },
     };
 
-    VkImageMemoryBarrier2KHR imageBarriers[VkParserPerFrameDecodeParameters::MAX_DPB_REF_AND_SETUP_SLOTS];
+    // One extra entry for the separate output image in the direct-to-output
+    // decode mode.
+    VkImageMemoryBarrier2KHR imageBarriers[VkParserPerFrameDecodeParameters::MAX_DPB_REF_AND_SETUP_SLOTS + 1];
     uint32_t numDpbBarriers = 0;
 
     if (currentDpbPictureResourceInfo.currentImageLayout == VK_IMAGE_LAYOUT_UNDEFINED) {
@@ -484,6 +798,19 @@ int VkVideoDecoder::DecodePictureWithParameters(VkParserPerFrameDecodeParameters
         numDpbBarriers++;
     }
 
+    if (decodeDirectToOutput &&
+            (currentOutputPictureResourceInfo.currentImageLayout != VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR)) {
+        imageBarriers[numDpbBarriers] = dpbBarrierTemplates[0];
+        imageBarriers[numDpbBarriers].oldLayout = currentOutputPictureResourceInfo.currentImageLayout;
+        imageBarriers[numDpbBarriers].newLayout = VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR;
+        imageBarriers[numDpbBarriers].image = currentOutputPictureResourceInfo.image;
+        imageBarriers[numDpbBarriers].dstAccessMask = VK_ACCESS_2_VIDEO_DECODE_WRITE_BIT_KHR;
+        // The separate output image is never an array layer.
+        imageBarriers[numDpbBarriers].subresourceRange.baseArrayLayer = 0;
+        assert(imageBarriers[numDpbBarriers].image);
+        numDpbBarriers++;
+    }
+
     VulkanVideoFrameBuffer::PictureResourceInfo pictureResourcesInfo[VkParserPerFrameDecodeParameters::MAX_DPB_REF_AND_SETUP_SLOTS];
     memset(&pictureResourcesInfo[0], 0, sizeof(pictureResourcesInfo));
     const int8_t* pGopReferenceImagesIndexes = pPicParams->pGopReferenceImagesIndexes;
@@ -577,10 +904,15 @@ int VkVideoDecoder::DecodePictureWithParameters(VkParserPerFrameDecodeParameters
     VkFence frameConsumerDoneFence = frameSynchronizationInfo.frameConsumerDoneFence;
     VkSemaphore frameCompleteSemaphore = frameSynchronizationInfo.frameCompleteSemaphore;
     VkSemaphore frameConsumerDoneSemaphore = frameSynchronizationInfo.frameConsumerDoneSemaphore;
+    VkSemaphore frameCompleteTimelineSemaphore = frameSynchronizationInfo.frameCompleteTimelineSemaphore;
+    const uint64_t frameCompleteTimelineValue = frameSynchronizationInfo.frameCompleteTimelineValue;
 
     // m_vkDevCtx->ResetQueryPool(m_vkDev, queryFrameInfo.queryPool, queryFrameInfo.query, 1);
 
     m_vkDevCtx->CmdResetQueryPool(frameDataSlot.commandBuffer, frameSynchronizationInfo.queryPool, frameSynchronizationInfo.startQueryId, frameSynchronizationInfo.numQueries);
+    if (m_gpuTimestampQueryPool != VK_NULL_HANDLE) {
+        m_vkDevCtx->CmdResetQueryPool(frameDataSlot.commandBuffer, m_gpuTimestampQueryPool, (uint32_t)currPicIdx * 2, 2);
+    }
     m_vkDevCtx->CmdBeginVideoCodingKHR(frameDataSlot.commandBuffer, &decodeBeginInfo);
 
     if (m_resetDecoder != false) {
@@ -592,6 +924,8 @@ int VkVideoDecoder::DecodePictureWithParameters(VkParserPerFrameDecodeParameters
         m_vkDevCtx->CmdControlVideoCodingKHR(frameDataSlot.commandBuffer, &codingControlInfo);
         // Done with the reset
         m_resetDecoder = false;
+        VK_VIDEO_PROBE_COUNT(CODEC_RESETS);
+        VK_VIDEO_PROBE_TRACE("DecodePictureWithParameters: codec reset at picIdx %d", currPicIdx);
     }
 
     const VkDependencyInfoKHR dependencyInfo = {
@@ -609,14 +943,29 @@ int VkVideoDecoder::DecodePictureWithParameters(VkParserPerFrameDecodeParameters
 
     m_vkDevCtx->CmdBeginQuery(frameDataSlot.commandBuffer, frameSynchronizationInfo.queryPool, frameSynchronizationInfo.startQueryId, VkQueryControlFlags());
 
+    if (m_gpuTimestampQueryPool != VK_NULL_HANDLE) {
+        m_vkDevCtx->CmdWriteTimestamp(frameDataSlot.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                      m_gpuTimestampQueryPool, (uint32_t)currPicIdx * 2);
+    }
+
     m_vkDevCtx->CmdDecodeVideoKHR(frameDataSlot.commandBuffer, &pPicParams->decodeFrameInfo);
 
+    if (m_gpuTimestampQueryPool != VK_NULL_HANDLE) {
+        m_vkDevCtx->CmdWriteTimestamp(frameDataSlot.commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                      m_gpuTimestampQueryPool, ((uint32_t)currPicIdx * 2) + 1);
+        m_gpuTimestampPending[currPicIdx] = 1;
+    }
+
     m_vkDevCtx->CmdEndQuery(frameDataSlot.commandBuffer, frameSynchronizationInfo.queryPool, frameSynchronizationInfo.startQueryId);
 
     VkVideoEndCodingInfoKHR decodeEndInfo = { VK_STRUCTURE_TYPE_VIDEO_END_CODING_INFO_KHR };
     m_vkDevCtx->CmdEndVideoCodingKHR(frameDataSlot.commandBuffer, &decodeEndInfo);
 
-    if (m_useSeparateOutputImages || m_useLinearOutput) {
+    const bool useTransferQueueCopy = (m_useSeparateOutputImages || m_useLinearOutput) &&
+                                          !decodeDirectToOutput &&
+                                          UseTransferQueueCopy() &&
+                                          ((uint32_t)currPicIdx < m_transferCmdBuffers.size());
+    if ((m_useSeparateOutputImages || m_useLinearOutput) && !decodeDirectToOutput && !useTransferQueueCopy) {
         CopyOptimalToLinearImage(frameDataSlot.commandBuffer,
                                  pPicParams->decodeFrameInfo.dstPictureResource,
                                  currentDpbPictureResourceInfo,
@@ -627,49 +976,181 @@ int VkVideoDecoder::DecodePictureWithParameters(VkParserPerFrameDecodeParameters
 
     m_vkDevCtx->EndCommandBuffer(frameDataSlot.commandBuffer);
 
-    VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr };
-    submitInfo.waitSemaphoreCount = (frameConsumerDoneSemaphore == VkSemaphore()) ? 0 : 1;
-    submitInfo.pWaitSemaphores = &frameConsumerDoneSemaphore;
-    VkPipelineStageFlags videoDecodeSubmitWaitStages = VK_PIPELINE_STAGE_2_VIDEO_DECODE_BIT_KHR;
-    submitInfo.pWaitDstStageMask = &videoDecodeSubmitWaitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &frameDataSlot.commandBuffer;
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &frameCompleteSemaphore;
+    VkCommandBuffer transferCmdBuffer = VkCommandBuffer();
+    VkSemaphore copyOffloadSemaphore = VkSemaphore();
+    if (useTransferQueueCopy) {
+        // Record the copy in the slot's transfer-queue command buffer instead.
+        // The execution and memory dependency on the decode output comes from
+        // the handoff semaphore the transfer submission waits on (see
+        // FlushPendingSubmits()). The previous use of the slot has already
+        // signaled its frame-complete fence, so the command buffer is free.
+        transferCmdBuffer = m_transferCmdBuffers[currPicIdx];
+        copyOffloadSemaphore = m_copyOffloadSemaphores[currPicIdx];
+        m_vkDevCtx->BeginCommandBuffer(transferCmdBuffer, &beginInfo);
+        CopyOptimalToLinearImage(transferCmdBuffer,
+                                 pPicParams->decodeFrameInfo.dstPictureResource,
+                                 currentDpbPictureResourceInfo,
+                                 currentOutputPictureResource,
+                                 currentOutputPictureResourceInfo,
+                                 &frameSynchronizationInfo);
+        m_vkDevCtx->EndCommandBuffer(transferCmdBuffer);
+    }
 
     VkResult result = VK_SUCCESS;
-    if ((frameConsumerDoneSemaphore == VkSemaphore()) && (frameConsumerDoneFence != VkFence())) {
-        result = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &frameConsumerDoneFence, true, gFenceTimeout);
+    const bool waitsOnConsumerFence = (frameConsumerDoneSemaphore == VkSemaphore()) &&
+                                      (frameConsumerDoneFence != VkFence());
+    bool blockedForSurface = false;
+    uint64_t blockedNs = 0;
+    if (m_enableAdaptiveInFlightDepth && waitsOnConsumerFence) {
+        // Adaptive in-flight throttle (see EnableAdaptiveInFlightDepth()):
+        // retire the pictures the consumer is already done with, then hold
+        // this submission back until the outstanding depth fits the current
+        // window. Both sides of the trade are soft. A fence the consumer has
+        // not started drawing from yet still reads as signaled from its
+        // previous wait, so the throttle errs towards not stalling; and when
+        // the oldest picture is still unconsumed after the short timeout the
+        // consumer is genuinely behind (e.g. its releases are batched), so
+        // the picture proceeds anyway and the measurement below makes the
+        // controller grow the window instead.
+        while (!m_inFlightConsumerFences.empty() &&
+               (m_vkDevCtx->GetFenceStatus(*m_vkDevCtx, m_inFlightConsumerFences[0]) == VK_SUCCESS)) {
+            m_inFlightConsumerFences.erase(m_inFlightConsumerFences.begin());
+        }
+        if ((int32_t)m_inFlightConsumerFences.size() >= m_inFlightDepthController.GetWindow()) {
+            blockedForSurface = true;
+            const auto waitStart = std::chrono::steady_clock::now();
+            result = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &m_inFlightConsumerFences[0], true,
+                                               gInFlightWaitTimeout);
+            blockedNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - waitStart).count();
+            if (result == VK_SUCCESS) {
+                m_inFlightConsumerFences.erase(m_inFlightConsumerFences.begin());
+            }
+        }
+    }
+    VkFence deferredConsumerDoneFence = VkFence();
+    if (waitsOnConsumerFence && !m_enableAdaptiveInFlightDepth) {
+        // Hold the wait for the consumer's release of this slot back until
+        // FlushPendingSubmits(): the recording above only reads CPU-side
+        // state, so the parser thread can keep marshalling and recording the
+        // remaining pictures of the batch while the consumer is still
+        // presenting from this slot. The adaptive mode keeps waiting here -
+        // its controller sizes the in-flight window from exactly these
+        // stalls.
+        deferredConsumerDoneFence = frameConsumerDoneFence;
+    } else if (waitsOnConsumerFence) {
+        if (m_vkDevCtx->GetFenceStatus(*m_vkDevCtx, frameConsumerDoneFence) == VK_NOT_READY) {
+            // The parser is reusing this slot before the consumer released
+            // its previous picture - the strongest sign the window is too
+            // shallow, so time the stall for the controller.
+            blockedForSurface = true;
+            const auto waitStart = std::chrono::steady_clock::now();
+            result = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &frameConsumerDoneFence, true, gFenceTimeout);
+            blockedNs += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - waitStart).count();
+        } else {
+            result = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &frameConsumerDoneFence, true, gFenceTimeout);
+        }
         assert(result == VK_SUCCESS);
         result = m_vkDevCtx->GetFenceStatus(*m_vkDevCtx, frameConsumerDoneFence);
         assert(result == VK_SUCCESS);
     }
-
-    result = m_vkDevCtx->GetFenceStatus(*m_vkDevCtx, frameCompleteFence);
-    if (result == VK_NOT_READY) {
-        std::cout << "\t *************** WARNING: frameCompleteFence is not done *************< " << currPicIdx << " >**********************" << std::endl;
-        assert(!"frameCompleteFence is not signaled yet");
+    if (m_enableAdaptiveInFlightDepth) {
+        if (waitsOnConsumerFence) {
+            // Track the picture now taking the slot. The cap keeps a slot
+            // that is reused before its older ring entry retires from
+            // growing the ring without bound.
+            m_inFlightConsumerFences.push_back(frameConsumerDoneFence);
+            if ((int32_t)m_inFlightConsumerFences.size() > m_numDecodeImagesInFlight) {
+                m_inFlightConsumerFences.erase(m_inFlightConsumerFences.begin());
+            }
+        }
+        m_inFlightDepthController.RecordSubmission(blockedForSurface, blockedNs);
     }
 
-    const bool checkDecodeFences = false; // For decoder fences debugging
-    if (checkDecodeFences) { // For fence/sync debugging
-        result = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &frameCompleteFence, true, gFenceTimeout);
-        assert(result == VK_SUCCESS);
-
+    // In the timeline mode the frame buffer does not hand out a per-picture
+    // fence (frameCompleteFence is NULL), so there is no fence to check and
+    // reset here - completion is tracked by the session timeline value.
+    if (frameCompleteFence != VkFence()) {
         result = m_vkDevCtx->GetFenceStatus(*m_vkDevCtx, frameCompleteFence);
         if (result == VK_NOT_READY) {
-            std::cout << "\t *********** WARNING: frameCompleteFence is still not done *************< " << currPicIdx << " >**********************" << std::endl;
+            std::cout << "\t *************** WARNING: frameCompleteFence is not done *************< " << currPicIdx << " >**********************" << std::endl;
+            assert(!"frameCompleteFence is not signaled yet");
+        }
+
+        const bool checkDecodeFences = false; // For decoder fences debugging
+        if (checkDecodeFences) { // For fence/sync debugging
+            result = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &frameCompleteFence, true, gFenceTimeout);
+            assert(result == VK_SUCCESS);
+
+            result = m_vkDevCtx->GetFenceStatus(*m_vkDevCtx, frameCompleteFence);
+            if (result == VK_NOT_READY) {
+                std::cout << "\t *********** WARNING: frameCompleteFence is still not done *************< " << currPicIdx << " >**********************" << std::endl;
+            }
+            assert(result == VK_SUCCESS);
         }
+
+        result = m_vkDevCtx->ResetFences(*m_vkDevCtx, 1, &frameCompleteFence);
         assert(result == VK_SUCCESS);
+        result = m_vkDevCtx->GetFenceStatus(*m_vkDevCtx, frameCompleteFence);
+        assert(result == VK_NOT_READY);
     }
 
-    result = m_vkDevCtx->ResetFences(*m_vkDevCtx, 1, &frameCompleteFence);
-    assert(result == VK_SUCCESS);
-    result = m_vkDevCtx->GetFenceStatus(*m_vkDevCtx, frameCompleteFence);
-    assert(result == VK_NOT_READY);
+    m_pendingDecodeSubmits.push_back(PendingDecodeSubmit{ frameDataSlot.commandBuffer,
+                                                          frameConsumerDoneSemaphore,
+                                                          deferredConsumerDoneFence,
+                                                          frameCompleteSemaphore,
+                                                          frameCompleteFence,
+                                                          frameCompleteTimelineSemaphore,
+                                                          frameCompleteTimelineValue,
+                                                          transferCmdBuffer,
+                                                          copyOffloadSemaphore });
+
+    // Field pictures are waited on with their fence right below, so they must
+    // not linger in the pending batch.
+    const bool submitNow = (m_pendingDecodeSubmits.size() >= std::max<uint32_t>(m_decodeSubmitBatchSize, 1)) ||
+                           pDecodePictureInfo->flags.fieldPic;
+    if (submitNow) {
+        FlushPendingSubmits();
+    }
+
+    // Latency trace stamp: in the batched mode (see
+    // SetDecodeSubmitBatchSize()) the actual queue submission of this picture
+    // can still be held back until a later FlushPendingSubmits().
+    m_videoFrameBuffer->SetPicDecodeSubmittedTimeNs(currPicIdx, GetCurrentTimeNanoseconds());
+
+    // GPU validation mode: hash both planes of the decoded picture with a
+    // compute dispatch on the graphics queue, waiting for this picture's
+    // timeline value. The digests accumulate in a device buffer and are read
+    // back only once, at end of stream (see ReportGpuFrameChecksums()).
+    if (m_frameChecksum && (frameCompleteTimelineSemaphore != VkSemaphore())) {
+        result = m_frameChecksum->Initialize(currentOutputPictureResourceInfo.imageFormat);
+        if (result == VK_SUCCESS) {
+            m_frameChecksum->QueueFrameChecksum(currentOutputPictureResourceInfo.image,
+                                                pPicParams->decodeFrameInfo.dstPictureResource.codedExtent,
+                                                VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR,
+                                                frameCompleteTimelineSemaphore,
+                                                frameCompleteTimelineValue,
+                                                (uint32_t)picNumInDecodeOrder);
+        }
+    }
 
-    m_vkDevCtx->MultiThreadedQueueSubmit(VulkanDeviceContext::DECODE, m_defaultVideoQueueIndx,
-                                         1, &submitInfo, frameCompleteFence);
+    // GPU QC analysis mode: accumulate the luma histogram and luma sum of the
+    // decoded picture with a compute dispatch on the graphics queue, waiting
+    // for this picture's timeline value. The per-frame records accumulate in
+    // a device buffer and are read back only once, at end of stream (see
+    // ReportGpuFrameAnalysis()).
+    if (m_frameAnalysis && (frameCompleteTimelineSemaphore != VkSemaphore())) {
+        result = m_frameAnalysis->Initialize(currentOutputPictureResourceInfo.imageFormat);
+        if (result == VK_SUCCESS) {
+            m_frameAnalysis->QueueFrameAnalysis(currentOutputPictureResourceInfo.image,
+                                                pPicParams->decodeFrameInfo.dstPictureResource.codedExtent,
+                                                VK_IMAGE_LAYOUT_VIDEO_DECODE_DST_KHR,
+                                                frameCompleteTimelineSemaphore,
+                                                frameCompleteTimelineValue,
+                                                (uint32_t)picNumInDecodeOrder);
+        }
+    }
 
     if (m_dumpDecodeData) {
         std::cout << "\t +++++++++++++++++++++++++++< " << currPicIdx << " >++++++++++++++++++++++++++++++" << std::endl;
@@ -696,10 +1177,17 @@ int VkVideoDecoder::DecodePictureWithParameters(VkParserPerFrameDecodeParameters
 
     // For fence/sync debugging
     if (pDecodePictureInfo->flags.fieldPic) {
-        result = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &frameCompleteFence, true, gFenceTimeout);
-        assert(result == VK_SUCCESS);
-        result = m_vkDevCtx->GetFenceStatus(*m_vkDevCtx, frameCompleteFence);
-        assert(result == VK_SUCCESS);
+        if (frameCompleteTimelineSemaphore != VkSemaphore()) {
+            const VkSemaphoreWaitInfoKHR semaphoreWaitInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR, nullptr, 0,
+                                                               1, &frameCompleteTimelineSemaphore, &frameCompleteTimelineValue };
+            result = m_vkDevCtx->WaitSemaphoresKHR(*m_vkDevCtx, &semaphoreWaitInfo, gFenceTimeout);
+            assert(result == VK_SUCCESS);
+        } else {
+            result = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1, &frameCompleteFence, true, gFenceTimeout);
+            assert(result == VK_SUCCESS);
+            result = m_vkDevCtx->GetFenceStatus(*m_vkDevCtx, frameCompleteFence);
+            assert(result == VK_SUCCESS);
+        }
     }
 
     const bool checkDecodeStatus = false; // Check the queries
@@ -727,6 +1215,417 @@ int VkVideoDecoder::DecodePictureWithParameters(VkParserPerFrameDecodeParameters
     return currPicIdx;
 }
 
+VkResult VkVideoDecoder::CreateGpuTimestampQueryPool(uint32_t maxFramesCount)
+{
+    if (m_gpuTimestampQueryPool != VK_NULL_HANDLE) {
+        return VK_SUCCESS;
+    }
+
+    std::vector<VkQueueFamilyProperties2> queues;
+    std::vector<VkQueueFamilyVideoPropertiesKHR> videoQueues;
+    std::vector<VkQueueFamilyQueryResultStatusPropertiesKHR> queryResultStatus;
+    vk::get(m_vkDevCtx, m_vkDevCtx->getPhysicalDevice(), queues, videoQueues, queryResultStatus);
+
+    const uint32_t videoQueueFamilyIdx = (uint32_t)m_vkDevCtx->GetVideoDecodeQueueFamilyIdx();
+    assert(videoQueueFamilyIdx < queues.size());
+    const uint32_t timestampValidBits = queues[videoQueueFamilyIdx].queueFamilyProperties.timestampValidBits;
+    if (timestampValidBits == 0) {
+        fprintf(stderr, "\nERROR: The video decode queue family does not support timestamp queries\n");
+        m_enableDecodeGpuTimeStats = false;
+        return VK_ERROR_FEATURE_NOT_PRESENT;
+    }
+    m_timestampValidBitsMask = (timestampValidBits >= 64) ? ~0ULL :
+                                   ((1ULL << timestampValidBits) - 1);
+
+    VkPhysicalDeviceProperties deviceProperties;
+    m_vkDevCtx->GetPhysicalDeviceProperties(m_vkDevCtx->getPhysicalDevice(), &deviceProperties);
+    m_timestampPeriodNs = deviceProperties.limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo queryPoolCreateInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+    queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    queryPoolCreateInfo.queryCount = maxFramesCount * 2; // a begin/end timestamp pair per decode slot
+    VkResult result = m_vkDevCtx->CreateQueryPool(*m_vkDevCtx, &queryPoolCreateInfo, nullptr, &m_gpuTimestampQueryPool);
+    assert(result == VK_SUCCESS);
+    if (result != VK_SUCCESS) {
+        fprintf(stderr, "\nERROR: CreateQueryPool() result: 0x%x\n", result);
+        m_enableDecodeGpuTimeStats = false;
+        return result;
+    }
+
+    m_gpuTimestampPending.clear();
+    m_gpuTimestampPending.resize(maxFramesCount, 0);
+    return VK_SUCCESS;
+}
+
+void VkVideoDecoder::DestroyGpuTimestampQueryPool()
+{
+    if (m_gpuTimestampQueryPool != VK_NULL_HANDLE) {
+        m_vkDevCtx->DestroyQueryPool(*m_vkDevCtx, m_gpuTimestampQueryPool, nullptr);
+        m_gpuTimestampQueryPool = VK_NULL_HANDLE;
+    }
+    m_gpuTimestampPending.clear();
+}
+
+void VkVideoDecoder::HarvestGpuTimestamps(uint32_t slot)
+{
+    if ((m_gpuTimestampQueryPool == VK_NULL_HANDLE) ||
+            (slot >= m_gpuTimestampPending.size()) ||
+            (m_gpuTimestampPending[slot] == 0)) {
+        return;
+    }
+
+    // The decode that wrote this slot's timestamps has already signaled its
+    // frame-complete fence before the slot got recycled, so the results are
+    // available without blocking the submission path.
+    uint64_t timestamps[2] = {};
+    VkResult result = m_vkDevCtx->GetQueryPoolResults(*m_vkDevCtx, m_gpuTimestampQueryPool,
+                                                      slot * 2, 2,
+                                                      sizeof(timestamps), timestamps, sizeof(uint64_t),
+                                                      VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+    m_gpuTimestampPending[slot] = 0;
+    assert(result == VK_SUCCESS);
+    if (result != VK_SUCCESS) {
+        return;
+    }
+
+    const uint64_t elapsedTicks = (timestamps[1] - timestamps[0]) & m_timestampValidBitsMask;
+    const double elapsedMs = ((double)elapsedTicks * m_timestampPeriodNs) / 1e6;
+
+    std::lock_guard<std::mutex> lock(m_gpuTimeStatsMutex);
+    m_gpuTimeFrameCount++;
+    m_gpuTimeTotalMs += elapsedMs;
+    m_gpuTimeLastMs = elapsedMs;
+    m_gpuTimeMinMs = (m_gpuTimeFrameCount == 1) ? elapsedMs : std::min(m_gpuTimeMinMs, elapsedMs);
+    m_gpuTimeMaxMs = std::max(m_gpuTimeMaxMs, elapsedMs);
+}
+
+VkResult VkVideoDecoder::CreateTransferCopyResources(uint32_t maxFramesCount)
+{
+    if ((m_transferCmdPool != VK_NULL_HANDLE) && (m_transferCmdBuffers.size() >= maxFramesCount)) {
+        return VK_SUCCESS;
+    }
+    DestroyTransferCopyResources();
+
+    assert(m_vkDevCtx->GetTransferQueueFamilyIdx() != -1);
+    VkCommandPoolCreateInfo cmdPoolInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+    cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    cmdPoolInfo.queueFamilyIndex = (uint32_t)m_vkDevCtx->GetTransferQueueFamilyIdx();
+    VkResult result = m_vkDevCtx->CreateCommandPool(*m_vkDevCtx, &cmdPoolInfo, nullptr, &m_transferCmdPool);
+    assert(result == VK_SUCCESS);
+    if (result != VK_SUCCESS) {
+        fprintf(stderr, "\nERROR: CreateCommandPool() result: 0x%x\n", result);
+        return result;
+    }
+
+    m_transferCmdBuffers.resize(maxFramesCount, VkCommandBuffer());
+    VkCommandBufferAllocateInfo cmdBufferAllocInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+    cmdBufferAllocInfo.commandPool = m_transferCmdPool;
+    cmdBufferAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    cmdBufferAllocInfo.commandBufferCount = maxFramesCount;
+    result = m_vkDevCtx->AllocateCommandBuffers(*m_vkDevCtx, &cmdBufferAllocInfo, m_transferCmdBuffers.data());
+    assert(result == VK_SUCCESS);
+    if (result != VK_SUCCESS) {
+        fprintf(stderr, "\nERROR: AllocateCommandBuffers() result: 0x%x\n", result);
+        return result;
+    }
+
+    m_copyOffloadSemaphores.resize(maxFramesCount, VkSemaphore());
+    const VkSemaphoreCreateInfo semaphoreInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+    for (uint32_t i = 0; i < maxFramesCount; i++) {
+        result = m_vkDevCtx->CreateSemaphore(*m_vkDevCtx, &semaphoreInfo, nullptr, &m_copyOffloadSemaphores[i]);
+        assert(result == VK_SUCCESS);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nERROR: CreateSemaphore() result: 0x%x\n", result);
+            return result;
+        }
+    }
+
+    return VK_SUCCESS;
+}
+
+void VkVideoDecoder::DestroyTransferCopyResources()
+{
+    for (size_t i = 0; i < m_copyOffloadSemaphores.size(); i++) {
+        if (m_copyOffloadSemaphores[i] != VkSemaphore()) {
+            m_vkDevCtx->DestroySemaphore(*m_vkDevCtx, m_copyOffloadSemaphores[i], nullptr);
+        }
+    }
+    m_copyOffloadSemaphores.clear();
+
+    if (m_transferCmdPool != VK_NULL_HANDLE) {
+        if (!m_transferCmdBuffers.empty()) {
+            m_vkDevCtx->FreeCommandBuffers(*m_vkDevCtx, m_transferCmdPool,
+                                           (uint32_t)m_transferCmdBuffers.size(), m_transferCmdBuffers.data());
+        }
+        m_vkDevCtx->DestroyCommandPool(*m_vkDevCtx, m_transferCmdPool, nullptr);
+        m_transferCmdPool = VK_NULL_HANDLE;
+    }
+    m_transferCmdBuffers.clear();
+}
+
+VkResult VkVideoDecoder::FlushPendingSubmits()
+{
+    if (m_pendingDecodeSubmits.empty()) {
+        return VK_SUCCESS;
+    }
+
+    const uint32_t submitCount = (uint32_t)m_pendingDecodeSubmits.size();
+    static const VkPipelineStageFlags videoDecodeSubmitWaitStages = VK_PIPELINE_STAGE_2_VIDEO_DECODE_BIT_KHR;
+
+    // Deferred consumer-release waits (see DecodePictureWithParameters()):
+    // the pictures of this batch were recorded without waiting for the
+    // consumer to release their slots, so the releases are collected here,
+    // right before the slots' pictures are handed to the decode queue.
+    for (uint32_t i = 0; i < submitCount; i++) {
+        if (m_pendingDecodeSubmits[i].frameConsumerDoneFence != VkFence()) {
+            VkResult waitResult = m_vkDevCtx->WaitForFences(*m_vkDevCtx, 1,
+                                                            &m_pendingDecodeSubmits[i].frameConsumerDoneFence,
+                                                            true, gFenceTimeout);
+            assert(waitResult == VK_SUCCESS);
+            (void)waitResult;
+        }
+    }
+
+    // Pictures submitted within the same batch execute in submission order on
+    // the decode queue, so no extra semaphore chaining between them is needed.
+    // Only the last picture's fence can be attached to the vkQueueSubmit; the
+    // other pictures' fences are signaled with fence-only submissions issued
+    // under the same queue lock (see MultiThreadedQueueSubmitBatch()).
+    std::vector<VkSubmitInfo>& submitInfos = m_flushSubmitInfos;
+    submitInfos.assign(submitCount, VkSubmitInfo());
+    std::vector<VkFence>& signalOnlyFences = m_flushSignalOnlyFences;
+    signalOnlyFences.clear();
+    signalOnlyFences.reserve(submitCount - 1);
+    // Scratch storage for the timeline mode: each submit then signals both
+    // the binary frame-complete semaphore (kept for the WSI present path) and
+    // the session timeline semaphore with the picture's assigned value.
+    std::vector<VkSemaphore>& signalSemaphores = m_flushSignalSemaphores;
+    signalSemaphores.assign(2 * submitCount, VkSemaphore());
+    std::vector<uint64_t>& signalSemaphoreValues = m_flushSignalSemaphoreValues;
+    signalSemaphoreValues.assign(2 * submitCount, 0);
+    std::vector<VkTimelineSemaphoreSubmitInfoKHR>& timelineSubmitInfos = m_flushTimelineSubmitInfos;
+    timelineSubmitInfos.assign(submitCount, VkTimelineSemaphoreSubmitInfoKHR());
+    for (uint32_t i = 0; i < submitCount; i++) {
+        const PendingDecodeSubmit& pendingSubmit = m_pendingDecodeSubmits[i];
+        VkSubmitInfo& submitInfo = submitInfos[i];
+        submitInfo = VkSubmitInfo{ VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr };
+        submitInfo.waitSemaphoreCount = (pendingSubmit.frameConsumerDoneSemaphore == VkSemaphore()) ? 0 : 1;
+        submitInfo.pWaitSemaphores = &pendingSubmit.frameConsumerDoneSemaphore;
+        submitInfo.pWaitDstStageMask = &videoDecodeSubmitWaitStages;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &pendingSubmit.commandBuffer;
+        const bool copyOffload = (pendingSubmit.transferCommandBuffer != VkCommandBuffer());
+        if (copyOffload) {
+            // The frame-complete signals and the fence move to the
+            // transfer-queue copy submission below; the decode submission
+            // only hands off to it with the slot's copy semaphore.
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &pendingSubmit.copyOffloadSemaphore;
+        } else if (pendingSubmit.frameCompleteTimelineSemaphore != VkSemaphore()) {
+            signalSemaphores[(2 * i) + 0] = pendingSubmit.frameCompleteSemaphore;
+            signalSemaphores[(2 * i) + 1] = pendingSubmit.frameCompleteTimelineSemaphore;
+            signalSemaphoreValues[(2 * i) + 0] = 0; // ignored for the binary semaphore
+            signalSemaphoreValues[(2 * i) + 1] = pendingSubmit.frameCompleteTimelineValue;
+            timelineSubmitInfos[i] = VkTimelineSemaphoreSubmitInfoKHR{ VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr };
+            timelineSubmitInfos[i].signalSemaphoreValueCount = 2;
+            timelineSubmitInfos[i].pSignalSemaphoreValues = &signalSemaphoreValues[2 * i];
+            submitInfo.pNext = &timelineSubmitInfos[i];
+            submitInfo.signalSemaphoreCount = 2;
+            submitInfo.pSignalSemaphores = &signalSemaphores[2 * i];
+        } else {
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &pendingSubmit.frameCompleteSemaphore;
+        }
+
+        // In the timeline mode the per-picture fences are not in use.
+        if (!copyOffload && (i < (submitCount - 1)) && (pendingSubmit.frameCompleteFence != VkFence())) {
+            signalOnlyFences.push_back(pendingSubmit.frameCompleteFence);
+        }
+    }
+
+    const VkFence decodeBatchFence =
+            (m_pendingDecodeSubmits[submitCount - 1].transferCommandBuffer != VkCommandBuffer()) ?
+                    VkFence() : m_pendingDecodeSubmits[submitCount - 1].frameCompleteFence;
+    VkResult result = m_vkDevCtx->MultiThreadedQueueSubmitBatchQos(VulkanDeviceContext::DECODE, m_defaultVideoQueueIndx,
+                                                                   (m_realtimePriority != 0),
+                                                                   submitCount, submitInfos.data(),
+                                                                   decodeBatchFence,
+                                                                   (uint32_t)signalOnlyFences.size(), signalOnlyFences.data());
+    assert(result == VK_SUCCESS);
+    if (result != VK_SUCCESS) {
+        fprintf(stderr, "\nERROR: FlushPendingSubmits() result: 0x%x\n", result);
+    }
+
+    // Queue the transfer-queue copy stages of the offloaded pictures. Their
+    // binary handoff semaphores require the decode signal operations to have
+    // been submitted first, so this must follow the decode batch submission.
+    // Each copy signals the picture's frame-complete semaphore (and timeline
+    // value) and its fence, so the consumers see the frame only after the
+    // output image copy has finished.
+    static const VkPipelineStageFlags transferSubmitWaitStages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    for (uint32_t i = 0; (result == VK_SUCCESS) && (i < submitCount); i++) {
+        const PendingDecodeSubmit& pendingSubmit = m_pendingDecodeSubmits[i];
+        if (pendingSubmit.transferCommandBuffer == VkCommandBuffer()) {
+            continue;
+        }
+        VkSubmitInfo transferSubmitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO, nullptr };
+        transferSubmitInfo.waitSemaphoreCount = 1;
+        transferSubmitInfo.pWaitSemaphores = &pendingSubmit.copyOffloadSemaphore;
+        transferSubmitInfo.pWaitDstStageMask = &transferSubmitWaitStages;
+        transferSubmitInfo.commandBufferCount = 1;
+        transferSubmitInfo.pCommandBuffers = &pendingSubmit.transferCommandBuffer;
+        VkSemaphore transferSignalSemaphores[2];
+        uint64_t transferSignalSemaphoreValues[2];
+        VkTimelineSemaphoreSubmitInfoKHR transferTimelineSubmitInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR, nullptr };
+        if (pendingSubmit.frameCompleteTimelineSemaphore != VkSemaphore()) {
+            transferSignalSemaphores[0] = pendingSubmit.frameCompleteSemaphore;
+            transferSignalSemaphores[1] = pendingSubmit.frameCompleteTimelineSemaphore;
+            transferSignalSemaphoreValues[0] = 0; // ignored for the binary semaphore
+            transferSignalSemaphoreValues[1] = pendingSubmit.frameCompleteTimelineValue;
+            transferTimelineSubmitInfo.signalSemaphoreValueCount = 2;
+            transferTimelineSubmitInfo.pSignalSemaphoreValues = transferSignalSemaphoreValues;
+            transferSubmitInfo.pNext = &transferTimelineSubmitInfo;
+            transferSubmitInfo.signalSemaphoreCount = 2;
+            transferSubmitInfo.pSignalSemaphores = transferSignalSemaphores;
+        } else {
+            transferSubmitInfo.signalSemaphoreCount = 1;
+            transferSubmitInfo.pSignalSemaphores = &pendingSubmit.frameCompleteSemaphore;
+        }
+
+        result = m_vkDevCtx->MultiThreadedQueueSubmit(VulkanDeviceContext::TRANSFER, 0,
+                                                      1, &transferSubmitInfo,
+                                                      pendingSubmit.frameCompleteFence);
+        assert(result == VK_SUCCESS);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nERROR: FlushPendingSubmits() transfer copy result: 0x%x\n", result);
+        }
+    }
+
+    m_pendingDecodeSubmits.clear();
+    return result;
+}
+
+bool VkVideoDecoder::GetDecodeGpuTimeStats(DecodeGpuTimeStats& stats) const
+{
+    std::lock_guard<std::mutex> lock(m_gpuTimeStatsMutex);
+    stats.measuredFrameCount = m_gpuTimeFrameCount;
+    stats.lastFrameTimeMs    = m_gpuTimeLastMs;
+    stats.minFrameTimeMs     = m_gpuTimeMinMs;
+    stats.maxFrameTimeMs     = m_gpuTimeMaxMs;
+    stats.averageFrameTimeMs = (m_gpuTimeFrameCount != 0) ?
+                                   (m_gpuTimeTotalMs / (double)m_gpuTimeFrameCount) : 0.0;
+    return (m_gpuTimeFrameCount != 0);
+}
+
+VkResult VkVideoDecoder::ReportGpuFrameChecksums(std::ostream& outStream)
+{
+    if (!m_frameChecksum) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    return m_frameChecksum->ReportChecksums(outStream);
+}
+
+VkResult VkVideoDecoder::ReportGpuFrameAnalysis(std::ostream& outStream)
+{
+    if (!m_frameAnalysis) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    return m_frameAnalysis->ReportStatistics(outStream);
+}
+
+void VkVideoDecoder::StartBitstreamPoolManagerThread()
+{
+    m_exitBitstreamPoolManager = false;
+    m_bitstreamPoolManagerThread = std::thread(&VkVideoDecoder::BitstreamPoolManagerProc, this);
+}
+
+void VkVideoDecoder::StopBitstreamPoolManagerThread()
+{
+    if (!m_bitstreamPoolManagerThread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_bitstreamPoolManagerMutex);
+        m_exitBitstreamPoolManager = true;
+    }
+    m_bitstreamPoolManagerCv.notify_one();
+    m_bitstreamPoolManagerThread.join();
+}
+
+// The adaptive bitstream pool manager (see EnableAdaptiveBitstreamPool()).
+// One sizing decision per tick: observed misses grow the pool right away,
+// shrinking waits for idleTicksBeforeShrink consecutive surplus ticks and
+// then retires one buffer per tick, so a bitrate burst a few seconds later
+// still finds most of the spares in place.
+void VkVideoDecoder::BitstreamPoolManagerProc()
+{
+    const std::chrono::milliseconds tickPeriod(50);
+    const uint32_t idleTicksBeforeShrink = 64; // ~3 seconds of sustained surplus
+
+    uint32_t idleTicks = 0;
+    std::unique_lock<std::mutex> lock(m_bitstreamPoolManagerMutex);
+    while (!m_exitBitstreamPoolManager) {
+
+        m_bitstreamPoolManagerCv.wait_for(lock, tickPeriod);
+        if (m_exitBitstreamPoolManager) {
+            break;
+        }
+
+        VulkanBitstreamBufferPool& pool = m_decodeFramesData.GetBitstreamBuffersQueue();
+        const uint32_t occupiedNodes = pool.GetMaxNodes() - pool.GetFreeNodesNumber();
+        const uint32_t misses = m_bitstreamPoolMissCount.exchange(0, std::memory_order_relaxed);
+
+        if (misses > 0) {
+
+            idleTicks = 0;
+
+            // Each miss was already covered by a reactive allocation that
+            // joined the pool - provision the same number of spares on top,
+            // so the next burst of this depth is served from the pool alone.
+            uint32_t numSpares = misses;
+            if ((occupiedNodes + numSpares) > (uint32_t)m_bitstreamPoolMaxBuffers) {
+                numSpares = ((uint32_t)m_bitstreamPoolMaxBuffers > occupiedNodes) ?
+                        ((uint32_t)m_bitstreamPoolMaxBuffers - occupiedNodes) : 0;
+            }
+
+            for (uint32_t i = 0; i < numSpares; i++) {
+
+                VkSharedBaseObj<VulkanBitstreamBufferImpl> bitstreamBuffer;
+                size_t allocSize = std::max<size_t>(m_maxStreamBufferSize, 2 * 1024 * 1024);
+                VkResult result = VulkanBitstreamBufferImpl::Create(m_vkDevCtx,
+                        m_vkDevCtx->GetVideoDecodeQueueFamilyIdx(),
+                        allocSize,
+                        m_bitstreamBufferOffsetAlignment,
+                        m_bitstreamBufferSizeAlignment,
+                        nullptr, 0, bitstreamBuffer);
+                if (result != VK_SUCCESS) {
+                    fprintf(stderr, "\nERROR: CreateVideoBitstreamBuffer() result: 0x%x\n", result);
+                    break;
+                }
+
+                if (pool.AddNodeToPool(bitstreamBuffer, false) < 0) {
+                    break; // every slot is taken - the pool is at capacity.
+                }
+            }
+
+        } else if ((occupiedNodes > (uint32_t)m_bitstreamPoolMinBuffers) &&
+                   (pool.GetAvailableNodesNumber() > 0)) {
+
+            if (++idleTicks >= idleTicksBeforeShrink) {
+                // The retired buffer's allocation is released right here,
+                // when the last reference goes out of scope.
+                VkSharedBaseObj<VulkanBitstreamBufferImpl> retiredBuffer;
+                pool.RemoveAvailableNodeFromPool(retiredBuffer);
+                idleTicks = idleTicksBeforeShrink; // keep retiring one per surplus tick
+            }
+
+        } else {
+            idleTicks = 0;
+        }
+    }
+}
+
 size_t VkVideoDecoder::GetBitstreamBuffer(size_t size,
                                           size_t minBitstreamBufferOffsetAlignment,
                                           size_t minBitstreamBufferSizeAlignment,
@@ -735,10 +1634,15 @@ size_t VkVideoDecoder::GetBitstreamBuffer(size_t size,
                                           VkSharedBaseObj<VulkanBitstreamBuffer>& bitstreamBuffer)
 {
     assert(initializeBufferMemorySize <= size);
-    // size_t newSize = 4 * 1024 * 1024;
-    size_t newSize = size;
     assert(m_vkDevCtx);
 
+    // Feed the rolling statistics and size fresh allocations for a high
+    // percentile of the recent access units rather than just this one, so
+    // scene cuts in high-bitrate content do not trigger mid-decode growth.
+    m_bitstreamSizePredictor.Record(size);
+    const size_t predictedSize = std::max(size, m_bitstreamSizePredictor.GetPredictedSize());
+    size_t newSize = predictedSize;
+
     VkSharedBaseObj<VulkanBitstreamBufferImpl> newBitstreamBuffer;
 
     const bool enablePool = true;
@@ -748,6 +1652,13 @@ size_t VkVideoDecoder::GetBitstreamBuffer(size_t size,
         availablePoolNode = m_decodeFramesData.GetBitstreamBuffersQueue().GetAvailableNodeFromPool(newBitstreamBuffer);
     }
     if (!(availablePoolNode >= 0)) {
+        if (m_enableAdaptiveBitstreamPool) {
+            // The reactive allocation below covers this request; the pool
+            // manager sees the miss and provisions spares asynchronously
+            // (see BitstreamPoolManagerProc()).
+            m_bitstreamPoolMissCount.fetch_add(1, std::memory_order_relaxed);
+            m_bitstreamPoolManagerCv.notify_one();
+        }
         VkResult result = VulkanBitstreamBufferImpl::Create(m_vkDevCtx,
                 m_vkDevCtx->GetVideoDecodeQueueFamilyIdx(),
                 newSize, minBitstreamBufferOffsetAlignment,
@@ -773,6 +1684,12 @@ size_t VkVideoDecoder::GetBitstreamBuffer(size_t size,
 
         assert(newBitstreamBuffer);
         newSize = newBitstreamBuffer->GetMaxSize();
+        if (newSize < predictedSize) {
+            // Grow the recycled buffer now, while it is idle, instead of
+            // letting the parser resize it reactively while appending slice
+            // data on the decode critical path.
+            newSize = newBitstreamBuffer->Resize(predictedSize);
+        }
         assert(initializeBufferMemorySize <= newSize);
 
         size_t copySize = std::min(initializeBufferMemorySize, newSize);
@@ -805,6 +1722,7 @@ size_t VkVideoDecoder::GetBitstreamBuffer(size_t size,
 VkResult VkVideoDecoder::Create(const VulkanDeviceContext* vkDevCtx,
                                 VkSharedBaseObj<VulkanVideoFrameBuffer>& videoFrameBuffer,
                                 int32_t videoQueueIndx, bool useLinearOutput,
+                                bool realtimePriority,
                                 int32_t numDecodeImagesInFlight,
                                 int32_t numDecodeImagesToPreallocate,
                                 int32_t numBitstreamBuffersToPreallocate,
@@ -814,7 +1732,9 @@ VkResult VkVideoDecoder::Create(const VulkanDeviceContext* vkDevCtx,
                                                                  videoFrameBuffer,
                                                                  videoQueueIndx,
                                                                  useLinearOutput,
+                                                                 realtimePriority,
                                                                  numDecodeImagesInFlight,
+                                                                 numDecodeImagesToPreallocate,
                                                                  numBitstreamBuffersToPreallocate));
     if (vkDecoder) {
         vkVideoDecoder = vkDecoder;
@@ -824,12 +1744,35 @@ VkResult VkVideoDecoder::Create(const VulkanDeviceContext* vkDevCtx,
     return VK_ERROR_OUT_OF_HOST_MEMORY;
 }
 
+void VkVideoDecoder::ResetForNewStream()
+{
+    FlushPendingSubmits();
+
+    // Let any in-flight work of the previous stream finish before the new
+    // stream's parser starts feeding the decoder.
+    m_vkDevCtx->MultiThreadedQueueWaitIdle(VulkanDeviceContext::DECODE, m_defaultVideoQueueIndx);
+
+    m_decodePicCount = 0;
+    // The pool's fences survive into the new stream, but the measurements
+    // behind the current window do not - re-arm the adaptive throttle.
+    m_inFlightConsumerFences.clear();
+    m_inFlightDepthController.Reset(m_numDecodeImagesInFlight);
+    // The video spec requires a codec reset before the first frame of the
+    // new stream; the next sequence start then reuses the current session
+    // when it is compatible (see IsSequenceCompatibleWithCurrentConfig()).
+    m_resetDecoder = true;
+}
+
 void VkVideoDecoder::Deinitialize()
 {
     if (m_vkDevCtx == nullptr) {
         return;
     }
 
+    StopBitstreamPoolManagerThread();
+
+    FlushPendingSubmits();
+
     if (m_vkDevCtx->GetVideoDecodeNumQueues() > 1) {
         for (uint32_t queueId = 0; queueId <  (uint32_t)m_vkDevCtx->GetVideoDecodeNumQueues(); queueId++) {
             m_vkDevCtx->MultiThreadedQueueWaitIdle(VulkanDeviceContext::DECODE, queueId);
@@ -837,8 +1780,20 @@ void VkVideoDecoder::Deinitialize()
     } else {
         m_vkDevCtx->MultiThreadedQueueWaitIdle(VulkanDeviceContext::DECODE, m_defaultVideoQueueIndx);
     }
+    if (UseTransferQueueCopy()) {
+        m_vkDevCtx->MultiThreadedQueueWaitIdle(VulkanDeviceContext::TRANSFER, 0);
+    }
     // m_vkDevCtx->DeviceWaitIdle();
 
+    DestroyTransferCopyResources();
+    DestroyGpuTimestampQueryPool();
+
+    if (VulkanVideoInstrumentation::CountersEnabled()) {
+        VulkanVideoInstrumentation::Report(std::cout);
+    }
+
+    m_frameChecksum = nullptr;
+    m_frameAnalysis = nullptr;
     m_videoFrameBuffer = nullptr;
     m_decodeFramesData.deinit();
     m_videoSession = nullptr;
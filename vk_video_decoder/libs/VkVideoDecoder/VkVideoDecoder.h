@@ -18,21 +18,27 @@
 
 #include <assert.h>
 #include <atomic>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
 #include <queue>
 #include <sstream>
 #include <stdint.h>
 #include <string.h>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "vulkan_interfaces.h"
 #include "VkCodecUtils/VulkanVideoReferenceCountedPool.h"
+#include "VkCodecUtils/VulkanCommandPoolShards.h"
 #include "VkCodecUtils/VulkanDeviceContext.h"
 #include "VkCodecUtils/Helpers.h"
 #include "VkVideoDecoder/VulkanBistreamBufferImpl.h"
 #include "VkVideoCore/VkVideoCoreProfile.h"
 #include "VkCodecUtils/VulkanVideoSession.h"
+#include "VkCodecUtils/VulkanFrameAnalysis.h"
+#include "VkCodecUtils/VulkanFrameChecksum.h"
 #include "VulkanVideoFrameBuffer/VulkanVideoFrameBuffer.h"
 #include "VulkanVideoParser.h"
 #include "VulkanVideoParserIf.h"
@@ -62,17 +68,13 @@ class NvVkDecodeFrameData {
 public:
     NvVkDecodeFrameData(const VulkanDeviceContext* vkDevCtx)
        : m_vkDevCtx(vkDevCtx),
-         m_videoCommandPool(),
+         m_videoCommandPools(),
          m_bitstreamBuffersQueue() {}
 
     void deinit() {
 
-        if (m_videoCommandPool) {
-            assert(m_vkDevCtx);
-            m_vkDevCtx->FreeCommandBuffers(*m_vkDevCtx, m_videoCommandPool, (uint32_t)m_commandBuffers.size(), &m_commandBuffers[0]);
-            m_vkDevCtx->DestroyCommandPool(*m_vkDevCtx, m_videoCommandPool, NULL);
-            m_videoCommandPool = VkCommandPool();
-        }
+        m_commandBuffers.clear();
+        m_videoCommandPools.Deinit();
     }
 
     ~NvVkDecodeFrameData() {
@@ -84,29 +86,25 @@ public:
         assert(m_vkDevCtx);
 
         size_t allocatedCommandBuffers = 0;
-        if (!m_videoCommandPool) {
-            VkCommandPoolCreateInfo cmdPoolInfo = {};
-            cmdPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-            cmdPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-            cmdPoolInfo.queueFamilyIndex = m_vkDevCtx->GetVideoDecodeQueueFamilyIdx();
-            VkResult result = m_vkDevCtx->CreateCommandPool(*m_vkDevCtx, &cmdPoolInfo, nullptr, &m_videoCommandPool);
+        if (!m_videoCommandPools.IsInitialized()) {
+            // The decode command pools are sharded per recording thread
+            // (see VulkanCommandPoolShards), so a second thread recording
+            // decode commands transparently gets its own pool instead of
+            // serializing on this one. The per-slot command buffers below
+            // all come from the setup thread's shard - the decode slot
+            // recording itself is single-threaded per decoder instance.
+            VkResult result = m_videoCommandPools.Init(m_vkDevCtx,
+                                                       m_vkDevCtx->GetVideoDecodeQueueFamilyIdx());
             assert(result == VK_SUCCESS);
             if (result != VK_SUCCESS) {
-                fprintf(stderr, "\nERROR: CreateCommandPool() result: 0x%x\n", result);
+                fprintf(stderr, "\nERROR: decode command pool Init() result: 0x%x\n", result);
+                return 0;
             }
 
-            VkCommandBufferAllocateInfo cmdInfo = {};
-            cmdInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-            cmdInfo.commandBufferCount = (uint32_t)maxDecodeFramesCount;
-            cmdInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-            cmdInfo.commandPool = m_videoCommandPool;
-
             m_commandBuffers.resize(maxDecodeFramesCount);
-            result = m_vkDevCtx->AllocateCommandBuffers(*m_vkDevCtx, &cmdInfo, &m_commandBuffers[0]);
-            assert(result == VK_SUCCESS);
-            if (result != VK_SUCCESS) {
-                fprintf(stderr, "\nERROR: AllocateCommandBuffers() result: 0x%x\n", result);
-            } else {
+            result = m_videoCommandPools.GetRecordingContext()->AllocateCommandBuffers(
+                    (uint32_t)maxDecodeFramesCount, &m_commandBuffers[0]);
+            if (result == VK_SUCCESS) {
                 allocatedCommandBuffers = maxDecodeFramesCount;
             }
         } else {
@@ -126,11 +124,13 @@ public:
         return m_commandBuffers.size();
     }
 
+    VulkanCommandPoolShards& GetCommandPools() { return m_videoCommandPools; }
+
     VulkanBitstreamBufferPool& GetBitstreamBuffersQueue() { return m_bitstreamBuffersQueue; }
 
 private:
     const VulkanDeviceContext*                                m_vkDevCtx;
-    VkCommandPool                                             m_videoCommandPool;
+    VulkanCommandPoolShards                                   m_videoCommandPools;
     std::vector<VkCommandBuffer>                              m_commandBuffers;
     VulkanBitstreamBufferPool                                 m_bitstreamBuffersQueue;
 };
@@ -145,10 +145,15 @@ public:
 
     static VkSharedBaseObj<VkVideoDecoder> invalidVkDecoder;
 
+    // realtimePriority places the decoder in the realtime QoS class: its
+    // queue submissions take precedence over best-effort decoders sharing
+    // the same decode queue instance (see
+    // VulkanDeviceContext::MultiThreadedQueueSubmitBatchQos()).
     static VkResult Create(const VulkanDeviceContext* vkDevCtx,
                            VkSharedBaseObj<VulkanVideoFrameBuffer>& videoFrameBuffer,
                            int32_t videoQueueIndx = 0,
                            bool useLinearOutput = false,
+                           bool realtimePriority = false,
                            int32_t numDecodeImagesInFlight = 8,
                            int32_t numDecodeImagesToPreallocate = -1, // preallocate the maximum required
                            int32_t numBitstreamBuffersToPreallocate = 8,
@@ -188,12 +193,172 @@ public:
                                       const uint8_t* pInitializeBufferMemory,
                                       size_t initializeBufferMemorySize,
                                       VkSharedBaseObj<VulkanBitstreamBuffer>& bitstreamBuffer);
+
+    // GPU execution time statistics of the decode submissions, in milliseconds.
+    // Collected only when the timestamp instrumentation is enabled
+    // (see EnableDecodeGpuTimeStats()).
+    struct DecodeGpuTimeStats {
+        uint64_t measuredFrameCount;
+        double   lastFrameTimeMs;
+        double   minFrameTimeMs;
+        double   maxFrameTimeMs;
+        double   averageFrameTimeMs;
+    };
+
+    // Opt-in instrumentation mode: brackets every vkCmdDecodeVideoKHR with a
+    // vkCmdWriteTimestamp pair, so the GPU engine time of each frame can be
+    // separated from host-side submission overhead. The results are harvested
+    // asynchronously when the decode slot is recycled, after the
+    // frame-complete fence of the previous decode has already been waited on,
+    // so the submission path is never stalled.
+    // Must be enabled before the first frame is decoded.
+    void EnableDecodeGpuTimeStats(bool enable) { m_enableDecodeGpuTimeStats = enable ? 1 : 0; }
+
+    // Returns true if at least one frame has been measured.
+    bool GetDecodeGpuTimeStats(DecodeGpuTimeStats& stats) const;
+
+    // Batched submission mode (see --decodeSubmitBatchSize): when batchSize
+    // is greater than one, up to batchSize decoded pictures are recorded and
+    // then submitted with a single vkQueueSubmit, reducing the per-submit
+    // overhead and the decode queue mutex contention when many streams share
+    // the device. The batch size should stay well below the number of decode
+    // images in flight. A batch size of 0 or 1 keeps the one-submit-per-picture
+    // behavior.
+    void SetDecodeSubmitBatchSize(uint32_t batchSize) { m_decodeSubmitBatchSize = batchSize; }
+
+    // Submits any pictures recorded but not yet submitted by the batching
+    // mode. Called for the tail of a stream, so the last (partial) batch is
+    // not held back waiting for more pictures.
+    VkResult FlushPendingSubmits();
+
+    // Zero-copy transcode mode: the decode output images are created with an
+    // additional encode profile, the encode-input usage bit and concurrent
+    // sharing with the device's encode queue family, so an encoder can consume
+    // the DecodedFrame images in place - waiting on frameCompleteSemaphore and
+    // signaling the consumer-done semaphore - with no linear readback or host
+    // copy in between. Requires an encode queue on the device and must be
+    // enabled before the first frame is decoded.
+    void EnableEncoderInputSharing(bool enable) { m_enableEncoderInputSharing = enable ? 1 : 0; }
+
+    // GPU validation mode (see VulkanFrameChecksum): every decoded picture is
+    // hashed by a compute dispatch submitted right after its decode, with the
+    // digests accumulated on the device and read back once at end of stream.
+    // Implies the timeline frame synchronization mode, so the dispatch can
+    // wait for the decode without consuming the frame-complete semaphore.
+    // Requires VK_KHR_timeline_semaphore and must be enabled before the first
+    // frame is decoded.
+    void EnableGpuFrameChecksums(bool enable) { m_enableGpuFrameChecksums = enable ? 1 : 0; }
+
+    // GPU QC analysis mode (see VulkanFrameAnalysis): every decoded picture
+    // feeds a compute dispatch submitted right after its decode, accumulating
+    // its luma histogram and luma sum on the device; the per-frame statistics
+    // (average luma, black/freeze flags) are derived on the host once at end
+    // of stream, without any per-frame readback. Implies the timeline frame
+    // synchronization mode, like the checksum mode above. Requires
+    // VK_KHR_timeline_semaphore and must be enabled before the first frame is
+    // decoded.
+    void EnableGpuFrameAnalysis(bool enable) { m_enableGpuFrameAnalysis = enable ? 1 : 0; }
+
+    // Caps the worst-case DPB memory: the image pool defers every decode
+    // surface and backs one only when the stream first references its slot,
+    // instead of provisioning the level-mandated maximum up front. Forces
+    // discrete (non-array) DPB images, since an image array is one shared
+    // allocation. Must be enabled before the first frame is decoded.
+    void EnableOnDemandDpbAllocation(bool enable) { m_useOnDemandDpbAllocation = enable ? 1 : 0; }
+
+    // Adaptive in-flight depth: instead of always running the full
+    // numDecodeImagesInFlight pictures ahead of the consumer, the decoder
+    // throttles its submissions to a window that grows when it measurably
+    // stalls waiting for a free decode surface and shrinks while the consumer
+    // keeps up, within the preallocated image pool (see
+    // InFlightDepthController and DecodePictureWithParameters()).
+    void EnableAdaptiveInFlightDepth(bool enable) { m_enableAdaptiveInFlightDepth = enable ? 1 : 0; }
+
+    // Adaptive bitstream buffer pool sizing (see --adaptiveBitstreamPool):
+    // instead of keeping the pool at the fixed preallocation count, a
+    // background manager closes the loop on the pool's runtime occupancy.
+    // Pool misses - a parser request finding no recyclable buffer, paying
+    // for a reactive allocation on the decode critical path - make the
+    // manager allocate the same number of spare buffers asynchronously, so
+    // a high-bitrate burst pays the allocation cost at most once; after
+    // sustained surplus the pool shrinks one buffer at a time, so a
+    // low-latency stream does not sit on a burst's worth of memory for the
+    // rest of the session. The pool never shrinks below minBuffers occupied
+    // slots and never grows above maxBuffers (see
+    // BitstreamPoolManagerProc()). Must be enabled before the first frame
+    // is decoded.
+    void EnableAdaptiveBitstreamPool(int32_t minBuffers, int32_t maxBuffers)
+    {
+        m_enableAdaptiveBitstreamPool = 1;
+        m_bitstreamPoolMinBuffers = std::max<int32_t>(minBuffers, 1);
+        m_bitstreamPoolMaxBuffers = std::max<int32_t>(maxBuffers, m_bitstreamPoolMinBuffers);
+    }
+
+    // Display-order output prediction: the reorder depth of the stream is
+    // read from the SPS (max_num_reorder_frames / max_num_reorder_pics) as
+    // the parameter sets arrive, and a depth of zero lets the frame buffer
+    // release every picture to the display queue as soon as it is queued for
+    // decode, instead of after the parser's conservative DPB output delay
+    // (see VulkanVideoFrameBuffer::SetDisplayOrderPredictionDepth()). Cuts
+    // the glass-to-glass latency of no-B-frame streams by the full reorder
+    // window. Streams that do not signal their reorder depth stay on the
+    // parser-driven display path.
+    void EnableDisplayOrderPrediction(bool enable) { m_enableDisplayOrderPrediction = enable ? 1 : 0; }
+
+    // Image layout override for the decode image pool (see
+    // --decodeImageLayout): selects between discrete decode images, one
+    // image array shared by all DPB slots, an image view array on top of it,
+    // and forcing separate output images even when the implementation can
+    // decode with DPB and output coinciding. The relative cost of these
+    // organizations differs across drivers and GPU generations; the layouts
+    // can also be measured against each other at session start (see
+    // VulkanVideoProcessor::BenchmarkDecodeImageLayouts()). Must be set
+    // before the first frame is decoded.
+    void SetImageLayoutPreferences(bool useImageArray, bool useImageViewArray,
+                                   bool forceSeparateOutputImages)
+    {
+        m_useImageArray = useImageArray ? 1 : 0;
+        m_useImageViewArray = useImageViewArray ? 1 : 0;
+        m_forceSeparateOutputImages = forceSeparateOutputImages ? 1 : 0;
+    }
+
+    // The in-flight window the adaptive controller has currently settled on;
+    // the configured maximum while the adaptive mode is disabled.
+    int32_t GetCurrentInFlightDepth() const
+    {
+        return m_enableAdaptiveInFlightDepth ? m_inFlightDepthController.GetWindow()
+                                             : m_numDecodeImagesInFlight;
+    }
+
+    // Prints the accumulated frame checksums; returns VK_SUCCESS only when
+    // the checksum mode is enabled and frames have been hashed.
+    VkResult ReportGpuFrameChecksums(std::ostream& outStream);
+
+    // Prints the accumulated per-frame statistics; returns VK_SUCCESS only
+    // when the analysis mode is enabled and frames have been analyzed.
+    VkResult ReportGpuFrameAnalysis(std::ostream& outStream);
+
+    // Whether StartVideoSequence() has configured a video session, i.e. the
+    // decoder carries sequence state worth reusing (see VkVideoDecoderPool).
+    bool IsSequenceConfigured() const
+    {
+        return (m_videoSession != nullptr) && (m_videoFormat.coded_width != 0) &&
+               (m_videoFormat.coded_height != 0);
+    }
+
+    // Prepares a parked decoder for its next stream (see VkVideoDecoderPool):
+    // the video session, image pool, parameter objects and bitstream buffers
+    // are all kept - only the per-stream decode state is cleared and a codec
+    // reset is queued for the first frame of the new stream.
+    void ResetForNewStream();
+
 private:
 
     VkVideoDecoder(const VulkanDeviceContext* vkDevCtx,
                    VkSharedBaseObj<VulkanVideoFrameBuffer>& videoFrameBuffer,
                    int32_t videoQueueIndx = 0,
                    bool useLinearOutput = false,
+                   bool realtimePriority = false,
                    int32_t numDecodeImagesInFlight = 8,
                    int32_t numDecodeImagesToPreallocate = -1, // preallocate the maximum required
                    int32_t numBitstreamBuffersToPreallocate = 8)
@@ -214,10 +379,49 @@ private:
         , m_useImageViewArray(false)
         , m_useSeparateOutputImages(useLinearOutput)
         , m_useLinearOutput(useLinearOutput)
+        , m_forceSeparateOutputImages(false)
+        , m_realtimePriority(realtimePriority)
         , m_resetDecoder(true)
         , m_dumpDecodeData(false)
+        , m_enableDecodeGpuTimeStats(false)
+        , m_enableEncoderInputSharing(false)
+        , m_enableGpuFrameChecksums(false)
+        , m_enableGpuFrameAnalysis(false)
+        , m_useOnDemandDpbAllocation(false)
+        , m_enableAdaptiveInFlightDepth(false)
+        , m_enableDisplayOrderPrediction(false)
+        , m_enableAdaptiveBitstreamPool(false)
+        , m_dpbAndOutputCoincide(true)
         , m_numBitstreamBuffersToPreallocate(numBitstreamBuffersToPreallocate)
+        , m_bitstreamPoolMinBuffers(0)
+        , m_bitstreamPoolMaxBuffers(0)
+        , m_bitstreamBufferOffsetAlignment(0)
+        , m_bitstreamBufferSizeAlignment(0)
+        , m_bitstreamPoolMissCount(0)
+        , m_exitBitstreamPoolManager(false)
+        , m_bitstreamPoolManagerThread()
         , m_maxStreamBufferSize()
+        , m_bitstreamSizePredictor()
+        , m_inFlightDepthController()
+        , m_inFlightConsumerFences()
+        , m_decodeSubmitBatchSize(1)
+        , m_pendingDecodeSubmits()
+        , m_flushSubmitInfos()
+        , m_flushSignalOnlyFences()
+        , m_flushSignalSemaphores()
+        , m_flushSignalSemaphoreValues()
+        , m_flushTimelineSubmitInfos()
+        , m_transferCmdPool()
+        , m_frameChecksum()
+        , m_frameAnalysis()
+        , m_gpuTimestampQueryPool()
+        , m_timestampPeriodNs(0.0f)
+        , m_timestampValidBitsMask(0)
+        , m_gpuTimeFrameCount(0)
+        , m_gpuTimeTotalMs(0.0)
+        , m_gpuTimeLastMs(0.0)
+        , m_gpuTimeMinMs(0.0)
+        , m_gpuTimeMaxMs(0.0)
     {
 
         assert(m_vkDevCtx->GetVideoDecodeQueueFamilyIdx() != -1);
@@ -255,6 +459,160 @@ private:
         return -1;
     }
 
+    VkResult CreateGpuTimestampQueryPool(uint32_t maxFramesCount);
+    void DestroyGpuTimestampQueryPool();
+    void HarvestGpuTimestamps(uint32_t slot);
+
+    // The adaptive bitstream pool manager thread (see
+    // EnableAdaptiveBitstreamPool()).
+    void StartBitstreamPoolManagerThread();
+    void StopBitstreamPoolManagerThread();
+    void BitstreamPoolManagerProc();
+
+    // Returns true when the sequence reported by the parser matches the
+    // sequence the decoder is already configured for, so the current video
+    // session, DPB image pool, query pool and bitstream buffers can keep
+    // being used without any reconfiguration (see StartVideoSequence()).
+    bool IsSequenceCompatibleWithCurrentConfig(const VkParserDetectedVideoFormat* pVideoFormat) const;
+
+    // Transfer-queue offload of the copy to the separate/linear output image
+    // (see StartVideoSequence()): the copy is recorded in a per-slot command
+    // buffer submitted on the dedicated DMA queue, handed off from the decode
+    // submission with the slot's copy semaphore, so the decode of the next
+    // frame overlaps the readback copy of the previous one.
+    VkResult CreateTransferCopyResources(uint32_t maxFramesCount);
+    void DestroyTransferCopyResources();
+    bool UseTransferQueueCopy() const { return (m_transferCmdPool != VK_NULL_HANDLE); }
+
+    // One not yet submitted decode submission, recorded by the batching mode.
+    struct PendingDecodeSubmit {
+        VkCommandBuffer commandBuffer;
+        VkSemaphore     frameConsumerDoneSemaphore; // optional wait
+        VkFence         frameConsumerDoneFence;     // optional wait, deferred to FlushPendingSubmits()
+        VkSemaphore     frameCompleteSemaphore;     // signal
+        VkFence         frameCompleteFence;         // optional - not used in the timeline mode
+        VkSemaphore     frameCompleteTimelineSemaphore; // optional timeline signal
+        uint64_t        frameCompleteTimelineValue;
+        VkCommandBuffer transferCommandBuffer;      // optional transfer-queue copy stage
+        VkSemaphore     copyOffloadSemaphore;       // decode-to-transfer handoff
+    };
+
+    // Rolling access-unit size statistics for predictive bitstream buffer
+    // sizing (see GetBitstreamBuffer()). Buffers are allocated and recycled
+    // buffers are grown to a high percentile of the recently observed sizes,
+    // so a large access unit at a scene cut rarely forces a reactive
+    // vkCreateBuffer/vkAllocateMemory plus copy in the middle of decode.
+    class BitstreamSizePredictor {
+    public:
+        BitstreamSizePredictor()
+            : m_sizeWindow{}
+            , m_nextEntry(0)
+            , m_numEntries(0) {}
+
+        void Record(size_t size)
+        {
+            m_sizeWindow[m_nextEntry] = size;
+            m_nextEntry = (m_nextEntry + 1) % WINDOW_SIZE;
+            m_numEntries = std::min<uint32_t>(m_numEntries + 1, WINDOW_SIZE);
+        }
+
+        // The 95th percentile of the window, rounded up to the allocation
+        // granularity; 0 until enough access units have been observed.
+        size_t GetPredictedSize() const
+        {
+            if (m_numEntries < MIN_ENTRIES_FOR_PREDICTION) {
+                return 0;
+            }
+
+            size_t sortedSizes[WINDOW_SIZE];
+            std::copy(m_sizeWindow, m_sizeWindow + m_numEntries, sortedSizes);
+            const uint32_t percentileEntry = (m_numEntries - 1) * 95 / 100;
+            std::nth_element(sortedSizes, sortedSizes + percentileEntry,
+                             sortedSizes + m_numEntries);
+            return (sortedSizes[percentileEntry] + (SIZE_GRANULARITY - 1)) &
+                   ~((size_t)SIZE_GRANULARITY - 1);
+        }
+
+    private:
+        enum { WINDOW_SIZE = 64 };
+        enum { MIN_ENTRIES_FOR_PREDICTION = 8 };
+        enum { SIZE_GRANULARITY = 256 * 1024 };
+
+        size_t   m_sizeWindow[WINDOW_SIZE];
+        uint32_t m_nextEntry;
+        uint32_t m_numEntries;
+    };
+
+    // Grows and shrinks the decoder's in-flight picture window at runtime
+    // (see EnableAdaptiveInFlightDepth()). Every ADAPT_PERIOD_FRAMES
+    // submissions the controller looks at how often - and for how long - the
+    // decoder had to block on a consumer-done fence during the period: any
+    // significant blocking means the window is too shallow and it grows by
+    // one; a period with no blocking at all means the consumer kept up and
+    // the window shrinks by one, never below MIN_WINDOW and never above the
+    // configured numDecodeImagesInFlight.
+    class InFlightDepthController {
+    public:
+        InFlightDepthController()
+            : m_currentWindow(0)
+            , m_maxWindow(0)
+            , m_framesThisPeriod(0)
+            , m_blockedThisPeriod(0)
+            , m_blockedNsThisPeriod(0) {}
+
+        // (Re)arms the controller for a new sequence. The window starts at
+        // the configured maximum, so the first periods decode at the proven
+        // depth and only then trade it away against the measurements.
+        void Reset(int32_t maxWindow)
+        {
+            m_maxWindow = std::max<int32_t>(maxWindow, MIN_WINDOW);
+            m_currentWindow = m_maxWindow;
+            m_framesThisPeriod = 0;
+            m_blockedThisPeriod = 0;
+            m_blockedNsThisPeriod = 0;
+        }
+
+        void RecordSubmission(bool blockedForSurface, uint64_t blockedNs)
+        {
+            m_framesThisPeriod++;
+            if (blockedForSurface) {
+                m_blockedThisPeriod++;
+                m_blockedNsThisPeriod += blockedNs;
+            }
+
+            if (m_framesThisPeriod < ADAPT_PERIOD_FRAMES) {
+                return;
+            }
+
+            if ((m_blockedThisPeriod > (ADAPT_PERIOD_FRAMES / 8)) ||
+                (m_blockedNsThisPeriod > ((uint64_t)ADAPT_PERIOD_FRAMES * GROW_BLOCKED_NS_PER_FRAME))) {
+                m_currentWindow = std::min<int32_t>(m_currentWindow + 1, m_maxWindow);
+            } else if (m_blockedThisPeriod == 0) {
+                m_currentWindow = std::max<int32_t>(m_currentWindow - 1, MIN_WINDOW);
+            }
+
+            m_framesThisPeriod = 0;
+            m_blockedThisPeriod = 0;
+            m_blockedNsThisPeriod = 0;
+        }
+
+        int32_t GetWindow() const { return m_currentWindow; }
+
+    private:
+        enum { MIN_WINDOW = 2 };
+        enum { ADAPT_PERIOD_FRAMES = 32 };
+        // Average blocked time per frame the controller tolerates before
+        // growing - half a millisecond barely registers against a 60 fps
+        // frame budget, anything above it does.
+        enum { GROW_BLOCKED_NS_PER_FRAME = 500 * 1000 };
+
+        int32_t  m_currentWindow;
+        int32_t  m_maxWindow;
+        uint32_t m_framesThisPeriod;
+        uint32_t m_blockedThisPeriod;
+        uint64_t m_blockedNsThisPeriod;
+    };
+
 private:
     const VulkanDeviceContext*  m_vkDevCtx;
     int32_t                     m_defaultVideoQueueIndx;
@@ -277,8 +635,81 @@ private:
     uint32_t m_useImageViewArray : 1;
     uint32_t m_useSeparateOutputImages : 1;
     uint32_t m_useLinearOutput : 1;
+    // Keeps m_useSeparateOutputImages set even when the implementation can
+    // decode with DPB and output coinciding (see SetImageLayoutPreferences()).
+    uint32_t m_forceSeparateOutputImages : 1;
+    // Realtime QoS class: this decoder's submissions take precedence on the
+    // shared decode queue instance (see FlushPendingSubmits()).
+    uint32_t m_realtimePriority : 1;
     uint32_t m_resetDecoder : 1;
     uint32_t m_dumpDecodeData : 1;
+    uint32_t m_enableDecodeGpuTimeStats : 1;
+    uint32_t m_enableEncoderInputSharing : 1;
+    uint32_t m_enableGpuFrameChecksums : 1;
+    uint32_t m_enableGpuFrameAnalysis : 1;
+    uint32_t m_useOnDemandDpbAllocation : 1;
+    uint32_t m_enableAdaptiveInFlightDepth : 1;
+    uint32_t m_enableDisplayOrderPrediction : 1;
+    uint32_t m_enableAdaptiveBitstreamPool : 1;
+    // The implementation decodes with the output picture coinciding with the
+    // DPB picture (see StartVideoSequence()). When clear, the decoder writes
+    // the separate output image directly and no output copy is recorded.
+    uint32_t m_dpbAndOutputCoincide : 1;
     int32_t  m_numBitstreamBuffersToPreallocate;
+    // Adaptive bitstream pool state (see EnableAdaptiveBitstreamPool()).
+    // The miss counter is bumped by the parser thread in
+    // GetBitstreamBuffer() and drained by the manager thread; the alignments
+    // are captured from the video capabilities at sequence start, so the
+    // manager can allocate buffers off the hot path.
+    int32_t  m_bitstreamPoolMinBuffers;
+    int32_t  m_bitstreamPoolMaxBuffers;
+    size_t   m_bitstreamBufferOffsetAlignment;
+    size_t   m_bitstreamBufferSizeAlignment;
+    std::atomic<uint32_t>   m_bitstreamPoolMissCount;
+    std::mutex              m_bitstreamPoolManagerMutex;
+    std::condition_variable m_bitstreamPoolManagerCv;
+    bool                    m_exitBitstreamPoolManager;
+    std::thread             m_bitstreamPoolManagerThread;
     size_t   m_maxStreamBufferSize;
+    BitstreamSizePredictor m_bitstreamSizePredictor;
+    InFlightDepthController m_inFlightDepthController;
+    // The consumer-done fences of the submitted pictures the consumer has
+    // not caught up with yet, in submission order - the adaptive throttle
+    // waits on the front entry (see DecodePictureWithParameters()).
+    std::vector<VkFence>    m_inFlightConsumerFences;
+    uint32_t m_decodeSubmitBatchSize;
+    std::vector<PendingDecodeSubmit> m_pendingDecodeSubmits;
+    // Persistent FlushPendingSubmits() scratch. The capacity grows to the
+    // largest batch ever flushed and is then reused, so a steady-state flush
+    // performs no heap allocation.
+    std::vector<VkSubmitInfo> m_flushSubmitInfos;
+    std::vector<VkFence> m_flushSignalOnlyFences;
+    std::vector<VkSemaphore> m_flushSignalSemaphores;
+    std::vector<uint64_t> m_flushSignalSemaphoreValues;
+    std::vector<VkTimelineSemaphoreSubmitInfoKHR> m_flushTimelineSubmitInfos;
+
+    // Transfer-queue copy offload state - a command buffer and a handoff
+    // semaphore per decode slot (see CreateTransferCopyResources()).
+    VkCommandPool                m_transferCmdPool;
+    std::vector<VkCommandBuffer> m_transferCmdBuffers;
+    std::vector<VkSemaphore>     m_copyOffloadSemaphores;
+
+    // GPU validation checksums of the decoded frames (see EnableGpuFrameChecksums()).
+    VkSharedBaseObj<VulkanFrameChecksum> m_frameChecksum;
+
+    // GPU QC statistics of the decoded frames (see EnableGpuFrameAnalysis()).
+    VkSharedBaseObj<VulkanFrameAnalysis> m_frameAnalysis;
+
+    // GPU timestamp instrumentation state - two timestamp queries per decode
+    // slot, harvested on slot reuse (see HarvestGpuTimestamps()).
+    VkQueryPool          m_gpuTimestampQueryPool;
+    float                m_timestampPeriodNs;
+    uint64_t             m_timestampValidBitsMask;
+    std::vector<uint8_t> m_gpuTimestampPending;
+    mutable std::mutex   m_gpuTimeStatsMutex;
+    uint64_t             m_gpuTimeFrameCount;
+    double               m_gpuTimeTotalMs;
+    double               m_gpuTimeLastMs;
+    double               m_gpuTimeMinMs;
+    double               m_gpuTimeMaxMs;
 };
@@ -0,0 +1,124 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "VkVideoDecoder/VkVideoDecoderPool.h"
+
+VkVideoDecoderPool& VkVideoDecoderPool::GetInstance()
+{
+    static VkVideoDecoderPool decoderPool;
+    return decoderPool;
+}
+
+// The profile idc carried by the codec-specific profile structure, on the
+// same scale as the parser-detected codecProfile of the parked sequence.
+static uint32_t GetVideoProfileIdc(const VkVideoCoreProfile& videoProfile)
+{
+    switch (videoProfile.GetCodecType()) {
+    case VK_VIDEO_CODEC_OPERATION_DECODE_H264_BIT_KHR:
+        return (uint32_t)videoProfile.GetDecodeH264Profile()->stdProfileIdc;
+    case VK_VIDEO_CODEC_OPERATION_DECODE_H265_BIT_KHR:
+        return (uint32_t)videoProfile.GetDecodeH265Profile()->stdProfileIdc;
+    default:
+        return 0;
+    }
+}
+
+bool VkVideoDecoderPool::Park(const VulkanDeviceContext* vkDevCtx,
+                              const VkSharedBaseObj<VkVideoDecoder>& decoder,
+                              const VkSharedBaseObj<VulkanVideoFrameBuffer>& frameBuffer)
+{
+    if (!decoder || !frameBuffer || !decoder->IsSequenceConfigured()) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    if (m_entries.size() >= MAX_PARKED_DECODERS) {
+        return false;
+    }
+
+    const VkParserDetectedVideoFormat* pVideoFormat = decoder->GetVideoFormatInfo();
+    Entry entry = Entry();
+    entry.vkDevCtx          = vkDevCtx;
+    entry.codec             = pVideoFormat->codec;
+    entry.codecProfile      = pVideoFormat->codecProfile;
+    entry.chromaSubsampling = pVideoFormat->chromaSubsampling;
+    entry.lumaBitDepth      = pVideoFormat->lumaBitDepth;
+    entry.chromaBitDepth    = pVideoFormat->chromaBitDepth;
+    entry.maxCodedWidth     = pVideoFormat->coded_width;
+    entry.maxCodedHeight    = pVideoFormat->coded_height;
+    entry.decoder           = decoder;
+    entry.frameBuffer       = frameBuffer;
+    m_entries.push_back(entry);
+    return true;
+}
+
+bool VkVideoDecoderPool::Acquire(const VulkanDeviceContext* vkDevCtx,
+                                 const VkVideoCoreProfile& videoProfile,
+                                 int32_t codedWidth, int32_t codedHeight,
+                                 VkSharedBaseObj<VkVideoDecoder>& decoder,
+                                 VkSharedBaseObj<VulkanVideoFrameBuffer>& frameBuffer)
+{
+    const VkVideoProfileInfoKHR* pProfileInfo = videoProfile.GetProfile();
+    if (pProfileInfo == nullptr) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    for (size_t e = 0; e < m_entries.size(); e++) {
+        const Entry& entry = m_entries[e];
+        if (entry.vkDevCtx != vkDevCtx) {
+            continue;
+        }
+        if ((entry.codec != videoProfile.GetCodecType()) ||
+                (entry.codecProfile != GetVideoProfileIdc(videoProfile)) ||
+                ((entry.chromaSubsampling & pProfileInfo->chromaSubsampling) == 0) ||
+                ((entry.lumaBitDepth & pProfileInfo->lumaBitDepth) == 0) ||
+                ((entry.chromaBitDepth & pProfileInfo->chromaBitDepth) == 0)) {
+            continue;
+        }
+        // The parked surfaces must be large enough for the new stream.
+        if (((codedWidth > 0) && ((uint32_t)codedWidth > entry.maxCodedWidth)) ||
+                ((codedHeight > 0) && ((uint32_t)codedHeight > entry.maxCodedHeight))) {
+            continue;
+        }
+
+        decoder = m_entries[e].decoder;
+        frameBuffer = m_entries[e].frameBuffer;
+        m_entries.erase(m_entries.begin() + e);
+
+        decoder->ResetForNewStream();
+        return true;
+    }
+    return false;
+}
+
+void VkVideoDecoderPool::Clear(const VulkanDeviceContext* vkDevCtx)
+{
+    std::lock_guard<std::mutex> lock(m_poolMutex);
+    for (size_t e = m_entries.size(); e-- > 0;) {
+        if ((vkDevCtx == nullptr) || (m_entries[e].vkDevCtx == vkDevCtx)) {
+            m_entries.erase(m_entries.begin() + e);
+        }
+    }
+}
+
+VkVideoDecoderPool::~VkVideoDecoderPool()
+{
+    // Parked decoders hold device objects - the users of the pool must
+    // Clear() it before their device goes away, so nothing should be left
+    // here at process teardown.
+    assert(m_entries.empty());
+}
@@ -0,0 +1,86 @@
+/*
+* Copyright 2023 NVIDIA Corporation.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*    http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "VkVideoDecoder/VkVideoDecoder.h"
+
+// Decoder reuse across streams (--decoderPool): when a stream closes, its
+// fully initialized decoder - video session, DPB image pool, parameter
+// objects and bitstream buffers - is parked here instead of being
+// destroyed, and the next stream with a matching video profile whose coded
+// size fits the configured surfaces gets it back after a lightweight codec
+// reset (see VkVideoDecoder::ResetForNewStream()). For playout
+// applications that constantly switch between streams of the same codec
+// and resolution this removes the session and image pool setup from the
+// channel-change path, leaving it limited only by IDR acquisition.
+//
+// Entries are keyed by the device context, so independent devices (see
+// --multiGpu) never exchange decoders. Parked decoders hold Vulkan device
+// objects - every path using the pool must Clear() it before its device
+// is destroyed.
+class VkVideoDecoderPool {
+public:
+    static VkVideoDecoderPool& GetInstance();
+
+    // Parks a decoder and its frame buffer for later reuse. Returns false -
+    // leaving ownership with the caller - when the decoder has not
+    // configured a video sequence yet or the pool is full.
+    bool Park(const VulkanDeviceContext* vkDevCtx,
+              const VkSharedBaseObj<VkVideoDecoder>& decoder,
+              const VkSharedBaseObj<VulkanVideoFrameBuffer>& frameBuffer);
+
+    // Hands back a parked decoder of the same device whose configured
+    // sequence matches the profile and whose surfaces fit the coded size,
+    // reset and ready for the new stream. A codedWidth/codedHeight of 0
+    // (not known before parsing) matches any parked resolution; should the
+    // sequence then turn out incompatible, the regular
+    // StartVideoSequence() reconfiguration handles it.
+    bool Acquire(const VulkanDeviceContext* vkDevCtx,
+                 const VkVideoCoreProfile& videoProfile,
+                 int32_t codedWidth, int32_t codedHeight,
+                 VkSharedBaseObj<VkVideoDecoder>& decoder,
+                 VkSharedBaseObj<VulkanVideoFrameBuffer>& frameBuffer);
+
+    // Releases the parked decoders of the given device, or of every device
+    // when vkDevCtx is nullptr.
+    void Clear(const VulkanDeviceContext* vkDevCtx = nullptr);
+
+    ~VkVideoDecoderPool();
+
+private:
+    // Bounds the device memory the parked image pools keep resident.
+    static const size_t MAX_PARKED_DECODERS = 4;
+
+    struct Entry {
+        const VulkanDeviceContext*              vkDevCtx;
+        VkVideoCodecOperationFlagBitsKHR        codec;
+        uint32_t                                codecProfile;
+        VkVideoChromaSubsamplingFlagBitsKHR     chromaSubsampling;
+        VkVideoComponentBitDepthFlagsKHR        lumaBitDepth;
+        VkVideoComponentBitDepthFlagsKHR        chromaBitDepth;
+        uint32_t                                maxCodedWidth;
+        uint32_t                                maxCodedHeight;
+        VkSharedBaseObj<VkVideoDecoder>         decoder;
+        VkSharedBaseObj<VulkanVideoFrameBuffer> frameBuffer;
+    };
+
+    std::mutex         m_poolMutex;
+    std::vector<Entry> m_entries;
+};
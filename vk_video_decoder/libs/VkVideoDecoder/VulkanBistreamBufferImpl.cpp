@@ -17,6 +17,7 @@
 #include <string.h>
 #include "VkVideoDecoder/VulkanBistreamBufferImpl.h"
 #include "VkCodecUtils/Helpers.h"
+#include "VkCodecUtils/VulkanMemoryBudget.h"
 
 VkResult
 VulkanBitstreamBufferImpl::Create(const VulkanDeviceContext* vkDevCtx, uint32_t queueFamilyIndex,
@@ -69,6 +70,18 @@ VkResult VulkanBitstreamBufferImpl::CreateBuffer(const VulkanDeviceContext* vkDe
     createBufferInfo.queueFamilyIndexCount = 1;
     createBufferInfo.pQueueFamilyIndices = &queueFamilyIndex;
 
+    // When huge-page staging is enabled the backing memory may be an
+    // imported host allocation, and only buffers created with the matching
+    // external handle type are allowed to bind it.
+    VkExternalMemoryBufferCreateInfo externalBufferInfo = VkExternalMemoryBufferCreateInfo();
+    const bool allowHostImport = ((VulkanDeviceMemoryImpl::GetHostHugePageThreshold() != 0) &&
+                                  vkDevCtx->IsDeviceExtensionEnabled(VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME));
+    if (allowHostImport) {
+        externalBufferInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+        externalBufferInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+        createBufferInfo.pNext = &externalBufferInfo;
+    }
+
     VkResult result = vkDevCtx->CreateBuffer(*vkDevCtx, &createBufferInfo, nullptr, &buffer);
     if (result != VK_SUCCESS) {
         assert(!"Create Buffer failed!");
@@ -86,14 +99,17 @@ VkResult VulkanBitstreamBufferImpl::CreateBuffer(const VulkanDeviceContext* vkDe
                                             pInitializeBufferMemory,
                                             initializeBufferMemorySize,
                                             true, // clearMemory
-                                            vkDeviceMemory);
+                                            vkDeviceMemory,
+                                            allowHostImport);
     if (result != VK_SUCCESS) {
         vkDevCtx->DestroyBuffer(*vkDevCtx, buffer, nullptr);
         assert(!"Create Memory Failed!");
         return result;
     }
 
-    result = vkDevCtx->BindBufferMemory(*vkDevCtx, buffer, *vkDeviceMemory, bufferOffset);
+    // The memory can be a slice suballocated from the shared arena - bind at
+    // the slice offset. bufferOffset stays relative to the memory impl.
+    result = vkDevCtx->BindBufferMemory(*vkDevCtx, buffer, *vkDeviceMemory, vkDeviceMemory->GetMemoryOffset());
     if (result != VK_SUCCESS) {
         vkDevCtx->DestroyBuffer(*vkDevCtx, buffer, nullptr);
         assert(!"Bind buffer memory failed!");
@@ -140,6 +156,7 @@ VkResult VulkanBitstreamBufferImpl::Initialize(VkDeviceSize bufferSize,
     }
 
     m_bufferSize = bufferSize;
+    VulkanMemoryBudget::RecordAllocation(VulkanMemoryBudget::MEMORY_POOL_BITSTREAM, m_bufferSize);
 
     return result;
 }
@@ -149,6 +166,7 @@ void VulkanBitstreamBufferImpl::Deinitialize()
     if (m_buffer) {
         m_vkDevCtx->DestroyBuffer(*m_vkDevCtx, m_buffer, nullptr);
         m_buffer = VK_NULL_HANDLE;
+        VulkanMemoryBudget::RecordFree(VulkanMemoryBudget::MEMORY_POOL_BITSTREAM, m_bufferSize);
     }
 
     m_vulkanDeviceMemory = nullptr;
@@ -240,6 +258,7 @@ size_t VulkanBitstreamBufferImpl::Resize(size_t newSize, size_t copySize, size_t
     m_bufferOffset = newBufferOffset;
     m_bufferSize = newSize;
     m_memoryPropertyFlags = newMemoryPropertyFlags;
+    VulkanMemoryBudget::RecordAllocation(VulkanMemoryBudget::MEMORY_POOL_BITSTREAM, m_bufferSize);
 
     return newSize;
 }
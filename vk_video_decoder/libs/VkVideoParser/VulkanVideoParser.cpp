@@ -501,6 +501,11 @@ public:
                                     size_t* pParsedBytes,
                                     bool doPartialParsing = false);
 
+    virtual void SetDecodeDecimation(uint32_t keepEveryNth)
+    {
+        m_decodeDecimationRatio = keepEveryNth;
+    }
+
     // Interface to allow decoder to communicate with the client implementing
     // INvVideoDecoderClient
 
@@ -618,6 +623,20 @@ protected:
     uint32_t m_outOfBandPictureParameters : 1;
     uint32_t m_inlinedPictureParametersUseBeginCoding : 1;
     int8_t m_pictureToDpbSlotMap[MAX_FRM_CNT];
+    // Decode decimation (see SetDecodeDecimation()): with a ratio N > 1 only
+    // every Nth non-reference picture is submitted for decode. The indices of
+    // the dropped pictures are remembered in a bitmask (MAX_FRM_CNT <= 32) so
+    // their display callbacks are dropped as well.
+    uint32_t m_decodeDecimationRatio;
+    uint32_t m_decimationPictureCount;
+    uint32_t m_skippedPictureIndexMask;
+    // Per-picture codec-specific parameter scratch, reset and refilled by
+    // DecodePicture() for every access unit. Only the block matching
+    // m_codecType is active; owning both per parser instance instead of
+    // declaring them on the stack avoids re-initializing the large inactive
+    // block on every picture.
+    nvVideoH264PicParameters m_h264PicParameters;
+    nvVideoH265PicParameters m_hevcPicParameters;
 
 public:
     static bool m_dumpParserData;
@@ -642,6 +661,22 @@ bool VulkanVideoParser::DecodePicture(VkParserPictureData* pd)
         return result;
     }
 
+    if (picIdx >= 0) {
+        // Non-reference pictures are never sampled by later pictures, so in
+        // the decimation mode all but every Nth of them are dropped here,
+        // before any decode submission work is done. Reference pictures are
+        // always decoded - the DPB must stay valid. The skipped index keeps
+        // its mask bit until DisplayPicture() drops the matching display
+        // callback; a decoded picture reusing the index clears it.
+        m_skippedPictureIndexMask &= ~((uint32_t)1 << picIdx);
+        if ((m_decodeDecimationRatio > 1) && !pd->ref_pic_flag) {
+            if ((++m_decimationPictureCount % m_decodeDecimationRatio) != 0) {
+                m_skippedPictureIndexMask |= ((uint32_t)1 << picIdx);
+                return true;
+            }
+        }
+    }
+
     if (m_dumpParserData) {
         std::cout
             << "\t ==> VulkanVideoParser::DecodePicture " << picIdx << std::endl
@@ -711,6 +746,13 @@ bool VulkanVideoParser::DisplayPicture(VkPicIf* pPicBuff, int64_t timestamp)
     }
     assert(picIdx != -1);
 
+    // The decode of this picture was dropped by the decimation mode, so the
+    // display request is dropped with it.
+    if ((picIdx >= 0) && ((m_skippedPictureIndexMask & ((uint32_t)1 << picIdx)) != 0)) {
+        m_skippedPictureIndexMask &= ~((uint32_t)1 << picIdx);
+        return true;
+    }
+
     assert(m_videoFrameBufferCb);
     if (m_videoFrameBufferCb && (picIdx != -1)) {
         VulkanVideoDisplayPictureInfo dispInfo = VulkanVideoDisplayPictureInfo();
@@ -800,6 +842,11 @@ VulkanVideoParser::VulkanVideoParser(VkVideoCodecOperationFlagBitsKHR codecType,
     , m_dpb(3)
     , m_outOfBandPictureParameters(true)
     , m_inlinedPictureParametersUseBeginCoding(false)
+    , m_decodeDecimationRatio(0)
+    , m_decimationPictureCount(0)
+    , m_skippedPictureIndexMask(0)
+    , m_h264PicParameters()
+    , m_hevcPicParameters()
 {
     memset(&m_nvsi, 0, sizeof(m_nvsi));
     for (uint32_t picId = 0; picId < MAX_FRM_CNT; picId++) {
@@ -1661,8 +1708,8 @@ bool VulkanVideoParser::DecodePicture(
     bool bRet = false;
 
     // union {
-    nvVideoH264PicParameters h264;
-    nvVideoH265PicParameters hevc;
+    nvVideoH264PicParameters& h264 = m_h264PicParameters;
+    nvVideoH265PicParameters& hevc = m_hevcPicParameters;
     // };
 
     if (m_decoderHandler == NULL) {
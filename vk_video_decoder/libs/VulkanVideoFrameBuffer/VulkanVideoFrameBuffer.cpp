@@ -24,11 +24,14 @@
 #include <sstream>
 #include <string.h>
 #include <string>
+#include <thread>
+#include <unistd.h>
 
 #include "vulkan_interfaces.h"
 #include "PictureBufferBase.h"
 #include "VkCodecUtils/HelpersDispatchTable.h"
 #include "VkCodecUtils/VulkanDeviceContext.h"
+#include "VkCodecUtils/VulkanVideoInstrumentation.h"
 #include "VkCodecUtils/VulkanVideoUtils.h"
 #include "VkVideoCore/VkVideoCoreProfile.h"
 #include "VulkanVideoFrameBuffer.h"
@@ -44,6 +47,10 @@ public:
         , m_frameCompleteSemaphore()
         , m_frameConsumerDoneFence()
         , m_frameConsumerDoneSemaphore()
+        , m_frameCompleteTimelineValue(0)
+        , m_demuxDoneTimeNs(0)
+        , m_parseDoneTimeNs(0)
+        , m_decodeSubmitTimeNs(0)
         , m_hasFrameCompleteSignalFence(false)
         , m_hasFrameCompleteSignalSemaphore(false)
         , m_hasConsummerSignalFence(false)
@@ -51,12 +58,15 @@ public:
         , m_inDecodeQueue(false)
         , m_inDisplayQueue(false)
         , m_ownedByDisplay(false)
+        , m_displayOrderPredicted(false)
         , m_recreateImage(false)
         , m_currentDpbImageLayerLayout(VK_IMAGE_LAYOUT_UNDEFINED)
         , m_currentOutputImageLayout(VK_IMAGE_LAYOUT_UNDEFINED)
         , m_vkDevCtx()
         , m_frameImageView()
         , m_displayImageView()
+        , m_displayViewImageResource()
+        , m_displayViewSubresourceRange()
     {
     }
 
@@ -67,9 +77,17 @@ public:
                           VkSharedBaseObj<VkImageResource>&  imageArrayParent,
                           VkSharedBaseObj<VkImageResourceView>& imageViewArrayParent,
                           bool useSeparateOutputImage = false,
-                          bool useLinearOutput = false);
+                          bool useLinearOutput = false,
+                          bool exportImageMemory = false);
 
-    VkResult init( const VulkanDeviceContext* vkDevCtx);
+    VkResult init( const VulkanDeviceContext* vkDevCtx,
+                   bool exportFrameCompleteSemaphore = false);
+
+    // Fills the cross-process export handles of this slot's output picture
+    // (see VulkanVideoFrameBuffer::ExportDecodedFrame()). Only valid when
+    // the images were created with exportImageMemory and the semaphore with
+    // exportFrameCompleteSemaphore.
+    VkResult ExportFrameHandles(VulkanVideoFrameBuffer::ExportedFrameHandles* pExportedFrameHandles);
 
     void Deinit();
 
@@ -90,7 +108,8 @@ public:
     }
 
     VkSharedBaseObj<VkImageResourceView>& GetDisplayImageView() {
-        if (ImageExist()) {
+        std::lock_guard<std::mutex> slotLock(m_slotMutex);
+        if (ImageExist() && EnsureDisplayImageViewLocked()) {
             return m_displayImageView;
         } else {
             return emptyImageView;
@@ -102,6 +121,18 @@ public:
         return (!!m_frameImageView && (m_frameImageView->GetImageView() != VK_NULL_HANDLE));
     }
 
+    // Drops the slot's image resources so their memory is reclaimed right
+    // away. Only valid while nothing references the images; the slot is
+    // recreated from the current create info on its next use (see
+    // m_recreateImage).
+    void ReleaseImages() {
+        m_frameImageView = nullptr;
+        m_displayImageView = nullptr;
+        m_displayViewImageResource = nullptr;
+        m_currentDpbImageLayerLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        m_currentOutputImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+
     bool GetImageSetNewLayout(VkImageLayout newDpbImageLayout,
                               VkVideoPictureResourceInfoKHR* pDpbPictureResource,
                               VulkanVideoFrameBuffer::PictureResourceInfo* pDpbPictureResourceInfo,
@@ -128,6 +159,15 @@ public:
             pDpbPictureResource->imageViewBinding = m_frameImageView->GetImageView();
         }
 
+        if ((pOutputPictureResourceInfo != nullptr) || (pOutputPictureResource != nullptr)) {
+            // The display/output view is created on first output use (see
+            // EnsureDisplayImageViewLocked()); DPB-only reference slots
+            // never pay for it.
+            if (!EnsureDisplayImageViewLocked()) {
+                return false;
+            }
+        }
+
         if (pOutputPictureResourceInfo) {
             pOutputPictureResourceInfo->image = m_displayImageView->GetImageResource()->GetImage();
             pOutputPictureResourceInfo->imageFormat = m_displayImageView->GetImageResource()->GetImageCreateInfo().format;
@@ -150,6 +190,16 @@ public:
     VkSemaphore m_frameCompleteSemaphore;
     VkFence m_frameConsumerDoneFence;
     VkSemaphore m_frameConsumerDoneSemaphore;
+    // The session timeline value assigned to the last decode of this picture
+    // (see VkVideoFrameBuffer::EnableTimelineFrameSync()).
+    uint64_t m_frameCompleteTimelineValue;
+    // Pipeline latency stamps of the last decode of this picture, handed out
+    // with the DecodedFrame (see the stamp fields there). The submit stamp is
+    // atomic because the decode submission thread sets it without taking the
+    // display queue mutex (see SetPicDecodeSubmittedTimeNs()).
+    uint64_t m_demuxDoneTimeNs;
+    uint64_t m_parseDoneTimeNs;
+    std::atomic<uint64_t> m_decodeSubmitTimeNs;
     uint32_t m_hasFrameCompleteSignalFence : 1;
     uint32_t m_hasFrameCompleteSignalSemaphore : 1;
     uint32_t m_hasConsummerSignalFence : 1;
@@ -157,6 +207,11 @@ public:
     uint32_t m_inDecodeQueue : 1;
     uint32_t m_inDisplayQueue : 1;
     uint32_t m_ownedByDisplay : 1;
+    // The picture was released to the display queue straight from
+    // QueuePictureForDecode() by the display-order prediction; the parser's
+    // own display callback for it is dropped when it arrives (see
+    // SetDisplayOrderPredictionDepth()).
+    uint32_t m_displayOrderPredicted : 1;
     uint32_t m_recreateImage : 1;
     // VPS
     VkSharedBaseObj<VkVideoRefCountBase>  stdVps;
@@ -167,12 +222,42 @@ public:
     // The bitstream Buffer
     VkSharedBaseObj<VkVideoRefCountBase>  bitstreamData;
 
+    // Guards this slot's image resources and layout state, so the per-slot
+    // resource accessors do not serialize on the frame buffer's display queue
+    // mutex. Taken after m_displayQueueMutex when both are held.
+    std::mutex m_slotMutex;
+
 private:
+    // Creates the deferred display/output view on its first use. CreateImage()
+    // only records the image and subresource the view spans, so slots that are
+    // never displayed or output (pure reference slots) skip the driver call
+    // entirely and StartVideoSequence() does not pay for it up front. Must be
+    // called with m_slotMutex held. Returns true when the view is available.
+    bool EnsureDisplayImageViewLocked() {
+        if (m_displayImageView) {
+            return true;
+        }
+        if (!m_displayViewImageResource) {
+            return false;
+        }
+        VkResult result = VkImageResourceView::Create(m_vkDevCtx, m_displayViewImageResource,
+                                                      m_displayViewSubresourceRange,
+                                                      m_displayImageView);
+        assert(result == VK_SUCCESS);
+        return (result == VK_SUCCESS);
+    }
+
     VkImageLayout                        m_currentDpbImageLayerLayout;
     VkImageLayout                        m_currentOutputImageLayout;
     const VulkanDeviceContext* m_vkDevCtx;
     VkSharedBaseObj<VkImageResourceView> m_frameImageView;
     VkSharedBaseObj<VkImageResourceView> m_displayImageView;
+    // Deferred display view state (see EnsureDisplayImageViewLocked()): the
+    // image and the subresource the view is created from on first use; an
+    // empty image resource means the display view coincides with
+    // m_frameImageView or the slot has no image yet.
+    VkSharedBaseObj<VkImageResource>     m_displayViewImageResource;
+    VkImageSubresourceRange              m_displayViewSubresourceRange;
 };
 
 class NvPerFrameDecodeImageSet {
@@ -182,6 +267,10 @@ public:
 
     NvPerFrameDecodeImageSet()
         : m_queueFamilyIndex((uint32_t)-1)
+        , m_encodeQueueFamilyIndex((uint32_t)-1)
+        , m_sharedQueueFamilyIndices{(uint32_t)-1, (uint32_t)-1}
+        , m_imageProfiles{}
+        , m_imageProfileList()
         , m_imageCreateInfo()
         , m_requiredMemProps(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
         , m_numImages(0)
@@ -189,9 +278,12 @@ public:
         , m_usesImageViewArray(false)
         , m_usesSeparateOutputImage(false)
         , m_usesLinearOutput(false)
+        , m_exportDecodedFrames(false)
         , m_perFrameDecodeResources(maxImages)
         , m_imageArray()
         , m_imageViewArray()
+        , m_arrayImage()
+        , m_arrayLayerState{}
     {
     }
 
@@ -203,11 +295,15 @@ public:
         VkImageTiling         tiling,
         VkImageUsageFlags     usage,
         uint32_t              queueFamilyIndex,
+        int32_t               numImagesToPreallocate = -1, // -1 creates all numImages up-front
         VkMemoryPropertyFlags requiredMemProps = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         bool useImageArray = false,
         bool useImageViewArray = false,
         bool useSeparateOutputImages = false,
-        bool useLinearOutput = false);
+        bool useLinearOutput = false,
+        const VkVideoProfileInfoKHR* pEncodeProfile = nullptr,
+        uint32_t encodeQueueFamilyIndex = (uint32_t)-1,
+        bool exportDecodedFrames = false);
 
     void Deinit();
 
@@ -236,6 +332,56 @@ public:
                                   VkVideoPictureResourceInfoKHR* pOutputPictureResource = nullptr,
                                   VulkanVideoFrameBuffer::PictureResourceInfo* pOutputPictureResourceInfo = nullptr) {
 
+        if (m_usesImageArray) {
+            // Bulk array path: the image set is fully resident after init() -
+            // no on-demand creation, no per-slot compaction - and the only
+            // mutable per-layer word is the DPB layout, written from the
+            // decode submission thread alone. The reference lookups therefore
+            // read the flat layer state directly, skipping the slot mutex and
+            // the shared-pointer chase of the discrete path.
+            ArrayLayerState& layerState = m_arrayLayerState[imageIndex];
+            if (pDpbPictureResourceInfo) {
+                pDpbPictureResourceInfo->image = m_arrayImage;
+                pDpbPictureResourceInfo->imageFormat = m_imageCreateInfo.format;
+                pDpbPictureResourceInfo->currentImageLayout = layerState.currentDpbLayout;
+            }
+            if (VK_IMAGE_LAYOUT_MAX_ENUM != newDpbImageLayout) {
+                layerState.currentDpbLayout = newDpbImageLayout;
+            }
+            if (pDpbPictureResource) {
+                pDpbPictureResource->imageViewBinding = layerState.view;
+                // The shared array view spans all the layers, so the resource
+                // must select this slot's; a per-layer view already does.
+                pDpbPictureResource->baseArrayLayer = m_usesImageViewArray ? imageIndex : 0;
+            }
+
+            if ((pOutputPictureResource == nullptr) && (pOutputPictureResourceInfo == nullptr)) {
+                return VK_SUCCESS;
+            }
+
+            // The output/display side stays on the slot - the deferred
+            // display views and the separate output images are per slot even
+            // when the DPB is an array.
+            std::lock_guard<std::mutex> slotLock(m_perFrameDecodeResources[imageIndex].m_slotMutex);
+            if (pOutputPictureResource) {
+                // Output pictures currently are only allocated as discrete
+                // Let the image view sub-resource specify the image layer.
+                pOutputPictureResource->baseArrayLayer = 0;
+            }
+            bool validOutput = m_perFrameDecodeResources[imageIndex].GetImageSetNewLayout(
+                                   VK_IMAGE_LAYOUT_MAX_ENUM, nullptr, nullptr,
+                                   newOutputImageLayout,
+                                   pOutputPictureResource,
+                                   pOutputPictureResourceInfo);
+            assert(validOutput);
+            return validOutput ? VK_SUCCESS : VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        // Slot-local locking: concurrent callers touching different pictures
+        // proceed in parallel; only the on-demand image creation below and
+        // the warm-up thread (see EnsureImageExists()) contend per slot.
+        std::lock_guard<std::mutex> slotLock(m_perFrameDecodeResources[imageIndex].m_slotMutex);
+
         VkResult result = VK_SUCCESS;
         if (pDpbPictureResource) {
             if (m_imageViewArray) {
@@ -271,7 +417,8 @@ public:
                                m_imageArray,
                                m_imageViewArray,
                                m_usesSeparateOutputImage,
-                               m_usesLinearOutput);
+                               m_usesLinearOutput,
+                               m_exportDecodedFrames);
 
             if (result == VK_SUCCESS) {
                 validImage = m_perFrameDecodeResources[imageIndex].GetImageSetNewLayout(
@@ -289,8 +436,41 @@ public:
         return result;
     }
 
+    // Creates the image backing imageIndex, if init() deferred its creation.
+    // Used by the background warm-up thread; takes the slot's own mutex, so
+    // the warm-up never races the on-demand creation in
+    // GetImageSetNewLayout().
+    VkResult EnsureImageExists(const VulkanDeviceContext* vkDevCtx, uint32_t imageIndex)
+    {
+        std::lock_guard<std::mutex> slotLock(m_perFrameDecodeResources[imageIndex].m_slotMutex);
+
+        if ((imageIndex >= m_numImages) ||
+                (m_perFrameDecodeResources[imageIndex].ImageExist() &&
+                 !m_perFrameDecodeResources[imageIndex].m_recreateImage)) {
+            return VK_SUCCESS;
+        }
+
+        return m_perFrameDecodeResources[imageIndex].CreateImage(vkDevCtx,
+                                                                 &m_imageCreateInfo,
+                                                                 m_requiredMemProps,
+                                                                 imageIndex,
+                                                                 m_imageArray,
+                                                                 m_imageViewArray,
+                                                                 m_usesSeparateOutputImage,
+                                                                 m_usesLinearOutput,
+                                                                 m_exportDecodedFrames);
+    }
+
 private:
     uint32_t                             m_queueFamilyIndex;
+    // Zero-copy encoder sharing state (see init()): the encode profile is
+    // appended to the image profile list and the images are shared
+    // concurrently between the decode and the encode queue families.
+    uint32_t                             m_encodeQueueFamilyIndex;
+    uint32_t                             m_sharedQueueFamilyIndices[2];
+    VkVideoCoreProfile                   m_encodeProfile;
+    VkVideoProfileInfoKHR                m_imageProfiles[2];
+    VkVideoProfileListInfoKHR            m_imageProfileList;
     VkVideoCoreProfile                   m_videoProfile;
     VkImageCreateInfo                    m_imageCreateInfo;
     VkMemoryPropertyFlags                m_requiredMemProps;
@@ -299,15 +479,94 @@ private:
     uint32_t                             m_usesImageViewArray:1;
     uint32_t                             m_usesSeparateOutputImage:1;
     uint32_t                             m_usesLinearOutput:1;
+    // The output pictures and the frame-complete semaphores are created
+    // exportable for cross-process consumption (see
+    // VulkanVideoFrameBuffer::EnableDecodedFrameExport()).
+    uint32_t                             m_exportDecodedFrames:1;
     std::vector<NvPerFrameDecodeResources> m_perFrameDecodeResources;
     VkSharedBaseObj<VkImageResource>     m_imageArray;     // must be valid if m_usesImageArray is true
     VkSharedBaseObj<VkImageResourceView> m_imageViewArray; // must be valid if m_usesImageViewArray is true
+
+    // Flat per-layer state of the image-array path (see init()): the array
+    // DPB is one image, one allocation and one bind, and after init() the
+    // only per-layer word that ever changes is the last recorded DPB layout.
+    // Everything the reference lookups need is therefore kept as PODs
+    // indexed by slot, so GetImageSetNewLayout() fills the DPB resources
+    // without the slot mutexes or the slots' shared-pointer bookkeeping.
+    struct ArrayLayerState {
+        VkImageView   view;            // the layer's view, or the shared array view
+        VkImageLayout currentDpbLayout;
+    };
+    VkImage                              m_arrayImage;     // raw handle of m_imageArray
+    ArrayLayerState                      m_arrayLayerState[maxImages];
+};
+
+// Lock-free single-producer / single-consumer ring of picture indexes queued
+// for display. The decoder thread is the only producer and the display
+// (present) thread the only consumer, so the head and tail indexes need only
+// acquire/release ordering and the display queue mutex is no longer required
+// on the per-frame enqueue/dequeue path. One extra entry distinguishes a full
+// ring from an empty one.
+class DisplayFrameRing {
+public:
+
+    enum { RingEntries = 33 }; // maxFramebufferImages + 1
+
+    DisplayFrameRing()
+        : m_head(0)
+        , m_tail(0)
+        , m_ring{} { }
+
+    bool Push(uint8_t pictureIndex)
+    {
+        const uint32_t head = m_head.load(std::memory_order_relaxed);
+        const uint32_t nextHead = NextEntry(head);
+        if (nextHead == m_tail.load(std::memory_order_acquire)) {
+            return false; // The ring is full - must never happen with a correctly sized ring.
+        }
+        m_ring[head] = pictureIndex;
+        m_head.store(nextHead, std::memory_order_release);
+        return true;
+    }
+
+    bool Pop(uint8_t& pictureIndex)
+    {
+        const uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        pictureIndex = m_ring[tail];
+        m_tail.store(NextEntry(tail), std::memory_order_release);
+        return true;
+    }
+
+    bool Empty() const
+    {
+        return (m_tail.load(std::memory_order_acquire) ==
+                m_head.load(std::memory_order_acquire));
+    }
+
+    size_t Size() const
+    {
+        const uint32_t head = m_head.load(std::memory_order_acquire);
+        const uint32_t tail = m_tail.load(std::memory_order_acquire);
+        return (head >= tail) ? (head - tail) : (RingEntries - tail + head);
+    }
+
+private:
+    static uint32_t NextEntry(uint32_t entry) { return (entry + 1) % RingEntries; }
+
+    std::atomic<uint32_t> m_head; // written by the producer only
+    std::atomic<uint32_t> m_tail; // written by the consumer only
+    uint8_t               m_ring[RingEntries];
 };
 
 class VkVideoFrameBuffer : public VulkanVideoFrameBuffer {
 public:
 
     static constexpr size_t maxFramebufferImages = 32;
+    static_assert(maxFramebufferImages < DisplayFrameRing::RingEntries,
+                  "the display frame ring must have room for all framebuffer images");
 
     VkVideoFrameBuffer(const VulkanDeviceContext* vkDevCtx)
         : m_vkDevCtx(vkDevCtx)
@@ -316,12 +575,23 @@ public:
         , m_perFrameDecodeImageSet()
         , m_displayFrames()
         , m_queryPool()
+        , m_frameTimelineSemaphore()
+        , m_frameTimelineValue(0)
         , m_ownedByDisplayMask(0)
         , m_frameNumInDecodeOrder(0)
         , m_frameNumInDisplayOrder(0)
+        , m_displayOrderPredictionDepth(-1)
+        , m_lastDemuxDoneTimeNs(0)
         , m_codedExtent { 0, 0 }
         , m_numberParameterUpdates(0)
         , m_debug()
+        , m_exportDecodedFrames()
+        , m_exitImageWarmUpThread(false)
+        , m_imageWarmUpThread()
+        , m_queryPendingMask(0)
+        , m_decodeStatus{}
+        , m_exitQueryHarvestThread(false)
+        , m_queryHarvestThread()
     {
     }
 
@@ -353,15 +623,64 @@ public:
         }
     }
 
+    virtual VkResult EnableTimelineFrameSync()
+    {
+        std::lock_guard<std::mutex> lock(m_displayQueueMutex);
+
+        if (m_frameTimelineSemaphore != VkSemaphore()) {
+            return VK_SUCCESS;
+        }
+
+        VkSemaphoreTypeCreateInfoKHR semTypeInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR, nullptr,
+                                                     VK_SEMAPHORE_TYPE_TIMELINE_KHR, 0 };
+        const VkSemaphoreCreateInfo semInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, &semTypeInfo };
+        VkResult result = m_vkDevCtx->CreateSemaphore(*m_vkDevCtx, &semInfo, nullptr, &m_frameTimelineSemaphore);
+        assert(result == VK_SUCCESS);
+        if (result != VK_SUCCESS) {
+            std::cerr << "ERROR: Could not create the timeline frame synchronization semaphore: " << result << std::endl;
+        }
+
+        return result;
+    }
+
+    virtual VkResult EnableDecodedFrameExport()
+    {
+        std::lock_guard<std::mutex> lock(m_displayQueueMutex);
+
+        if (m_perFrameDecodeImageSet.size() != 0) {
+            // The export handle types must be declared when the images and
+            // semaphores are created - too late once the pool exists.
+            assert(!"EnableDecodedFrameExport() must be called before InitImagePool()!");
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        m_exportDecodedFrames = true;
+        return VK_SUCCESS;
+    }
+
+    virtual VkResult ExportDecodedFrame(int8_t picId, ExportedFrameHandles* pExportedFrameHandles)
+    {
+        if ((pExportedFrameHandles == nullptr) || !m_exportDecodedFrames) {
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        if ((picId < 0) || ((size_t)picId >= m_perFrameDecodeImageSet.size())) {
+            assert(!"Invalid picture index for frame export!");
+            return VK_ERROR_INITIALIZATION_FAILED;
+        }
+
+        return m_perFrameDecodeImageSet[(uint32_t)picId].ExportFrameHandles(pExportedFrameHandles);
+    }
+
     uint32_t  FlushDisplayQueue()
     {
         std::lock_guard<std::mutex> lock(m_displayQueueMutex);
 
         uint32_t flushedImages = 0;
-        while (!m_displayFrames.empty()) {
-            int8_t pictureIndex = m_displayFrames.front();
+        uint8_t displayPictureIndex = 0;
+        while (m_displayFrames.Pop(displayPictureIndex)) {
+            int8_t pictureIndex = (int8_t)displayPictureIndex;
             assert((pictureIndex >= 0) && ((uint32_t)pictureIndex < m_perFrameDecodeImageSet.size()));
-            m_displayFrames.pop();
             if (m_perFrameDecodeImageSet[(uint32_t)pictureIndex].IsAvailable()) {
                 // The frame is not released yet - force release it.
                 m_perFrameDecodeImageSet[(uint32_t)pictureIndex].Release();
@@ -384,39 +703,187 @@ public:
                                   bool                     useImageArray = false,
                                   bool                     useImageViewArray = false,
                                   bool                     useSeparateOutputImage = false,
-                                  bool                     useLinearOutput = false)
+                                  bool                     useLinearOutput = false,
+                                  const VkVideoProfileInfoKHR* pEncodeProfile = nullptr,
+                                  uint32_t                 encodeQueueFamilyIndex = (uint32_t)-1,
+                                  bool                     useOnDemandAllocation = false)
     {
-        std::lock_guard<std::mutex> lock(m_displayQueueMutex);
+        // A previous sequence may still be warming up its images.
+        StopImageWarmUpThread();
 
-        assert(numImages && (numImages <= maxFramebufferImages) && pDecodeProfile);
+        int32_t imageSetCreateResult = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_displayQueueMutex);
 
-        VkResult result = CreateVideoQueries(numImages, m_vkDevCtx, pDecodeProfile);
-        if (result != VK_SUCCESS) {
-            return 0;
+            assert(numImages && (numImages <= maxFramebufferImages) && pDecodeProfile);
+
+            VkResult result = CreateVideoQueries(numImages, m_vkDevCtx, pDecodeProfile);
+            if (result != VK_SUCCESS) {
+                return 0;
+            }
+
+            // m_extent is for the codedExtent, not the max image resolution
+            m_codedExtent = codedExtent;
+
+            imageSetCreateResult =
+                    m_perFrameDecodeImageSet.init(m_vkDevCtx,
+                                                  pDecodeProfile,
+                                                  numImages,
+                                                  imageFormat,
+                                                  maxImageExtent,
+                                                  tiling,
+                                                  usage,
+                                                  queueFamilyIndex,
+                                                  numImagesToPreallocate,
+                                                  VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                                  useImageArray, useImageViewArray,
+                                                  useSeparateOutputImage, useLinearOutput,
+                                                  pEncodeProfile, encodeQueueFamilyIndex,
+                                                  m_exportDecodedFrames);
+            m_numberParameterUpdates++;
         }
 
-        // m_extent is for the codedExtent, not the max image resolution
-        m_codedExtent = codedExtent;
+        // Finish allocating the images the init() above deferred, while the
+        // decode of the first frames proceeds against the preallocated ones.
+        // In the on-demand allocation mode no warm-up runs: a deferred
+        // surface stays unbacked until the decoder first references its
+        // slot, so level-mandated worst-case slots never cost real memory.
+        if ((imageSetCreateResult > 0) && !useImageArray && !useOnDemandAllocation &&
+                (numImagesToPreallocate >= 0) && ((uint32_t)numImagesToPreallocate < numImages)) {
+            StartImageWarmUpThread(numImages);
+        }
 
-        int32_t imageSetCreateResult =
-                m_perFrameDecodeImageSet.init(m_vkDevCtx,
-                                              pDecodeProfile,
-                                              numImages,
-                                              imageFormat,
-                                              maxImageExtent,
-                                              tiling,
-                                              usage,
-                                              queueFamilyIndex,
-                                              VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-                                              useImageArray, useImageViewArray,
-                                              useSeparateOutputImage, useLinearOutput);
-        m_numberParameterUpdates++;
+        // The harvester is kept running across sequence reconfigurations -
+        // the query pool is only destroyed at Deinitialize() time.
+        if ((imageSetCreateResult > 0) && !m_queryHarvestThread.joinable()) {
+            StartQueryHarvestThread();
+        }
 
         return imageSetCreateResult;
     }
 
+    virtual int32_t SetCodedExtent(const VkExtent2D& codedExtent)
+    {
+        std::lock_guard<std::mutex> lock(m_displayQueueMutex);
+        m_codedExtent = codedExtent;
+        return 0;
+    }
+
+    virtual int32_t SetDisplayOrderPredictionDepth(int32_t maxNumReorderFrames)
+    {
+        std::lock_guard<std::mutex> lock(m_displayQueueMutex);
+        m_displayOrderPredictionDepth = maxNumReorderFrames;
+        return 0;
+    }
+
+    // Background warm-up of the DPB images that InitImagePool() deferred in
+    // the incremental allocation mode. One image is created per mutex
+    // acquisition, so the decoder is never stalled behind more than a single
+    // allocation and the images it needs first are created on demand.
+    void StartImageWarmUpThread(uint32_t numImages)
+    {
+        assert(!m_imageWarmUpThread.joinable());
+        m_exitImageWarmUpThread = false;
+        m_imageWarmUpThread = std::thread(&VkVideoFrameBuffer::ImageWarmUpThreadProc, this, numImages);
+    }
+
+    void StopImageWarmUpThread()
+    {
+        if (!m_imageWarmUpThread.joinable()) {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_displayQueueMutex);
+            m_exitImageWarmUpThread = true;
+        }
+        m_imageWarmUpThread.join();
+    }
+
+    void ImageWarmUpThreadProc(uint32_t numImages)
+    {
+        for (uint32_t imageIndex = 0; imageIndex < numImages; imageIndex++) {
+
+            std::lock_guard<std::mutex> lock(m_displayQueueMutex);
+            if (m_exitImageWarmUpThread) {
+                break;
+            }
+
+            VkResult result = m_perFrameDecodeImageSet.EnsureImageExists(m_vkDevCtx, imageIndex);
+            if (result != VK_SUCCESS) {
+                // Leave the remaining images to the on-demand path, which
+                // reports the error on the picture that needs them.
+                break;
+            }
+        }
+    }
+
+    // Background harvesting of the per-slot decode result-status queries.
+    // The harvester polls the slots queued for decode without the WAIT bit,
+    // so it never blocks the GPU-facing threads, and publishes each available
+    // status into the atomic per-slot array. DequeueDecodedPicture() then
+    // only reads the atomic and never has to call vkGetQueryPoolResults() on
+    // the display path.
+    void StartQueryHarvestThread()
+    {
+        assert(!m_queryHarvestThread.joinable());
+        m_exitQueryHarvestThread = false;
+        m_queryHarvestThread = std::thread(&VkVideoFrameBuffer::QueryHarvestThreadProc, this);
+    }
+
+    void StopQueryHarvestThread()
+    {
+        if (!m_queryHarvestThread.joinable()) {
+            return;
+        }
+
+        m_exitQueryHarvestThread = true;
+        m_queryHarvestThread.join();
+    }
+
+    void QueryHarvestThreadProc()
+    {
+        while (!m_exitQueryHarvestThread) {
+
+            uint32_t pendingMask = m_queryPendingMask.load(std::memory_order_acquire);
+            for (uint32_t slot = 0; pendingMask != 0; slot++, pendingMask >>= 1) {
+                if (!(pendingMask & 1)) {
+                    continue;
+                }
+
+                // Without the WAIT bit the call never blocks; the appended
+                // availability word tells whether the status word is valid.
+                struct {
+                    VkQueryResultStatusKHR status;
+                    uint32_t available;
+                } queryResult = { VK_QUERY_RESULT_STATUS_NOT_READY_KHR, 0 };
+                VkResult result = m_vkDevCtx->GetQueryPoolResults(*m_vkDevCtx, m_queryPool,
+                                                                  slot, 1,
+                                                                  sizeof(queryResult), &queryResult, sizeof(queryResult),
+                                                                  VK_QUERY_RESULT_WITH_STATUS_BIT_KHR |
+                                                                  VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+                if ((result == VK_SUCCESS) && queryResult.available) {
+                    // Error statuses are negative.
+                    if (queryResult.status < VK_QUERY_RESULT_STATUS_NOT_READY_KHR) {
+                        std::cerr << "ERROR: decode result status " << queryResult.status
+                                  << " for picture index " << slot << std::endl;
+                    }
+                    m_decodeStatus[slot].store(queryResult.status, std::memory_order_release);
+                    m_queryPendingMask.fetch_and(~(1u << slot), std::memory_order_release);
+                }
+            }
+
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    }
+
     void Deinitialize() {
 
+        StopImageWarmUpThread();
+
+        // Must be stopped before the query pool is destroyed below.
+        StopQueryHarvestThread();
+
         FlushDisplayQueue();
 
         DestroyVideoQueries();
@@ -424,6 +891,8 @@ public:
         m_ownedByDisplayMask = 0;
         m_frameNumInDecodeOrder = 0;
         m_frameNumInDisplayOrder = 0;
+        m_displayOrderPredictionDepth = -1;
+        m_lastDemuxDoneTimeNs = 0;
 
         m_perFrameDecodeImageSet.Deinit();
 
@@ -431,6 +900,12 @@ public:
             m_vkDevCtx->DestroyQueryPool(*m_vkDevCtx, m_queryPool, NULL);
             m_queryPool = VkQueryPool();
         }
+
+        if (m_frameTimelineSemaphore != VkSemaphore()) {
+            m_vkDevCtx->DestroySemaphore(*m_vkDevCtx, m_frameTimelineSemaphore, nullptr);
+            m_frameTimelineSemaphore = VkSemaphore();
+        }
+        m_frameTimelineValue = 0;
     };
 
     virtual int32_t QueueDecodedPictureForDisplay(int8_t picId, VulkanVideoDisplayPictureInfo* pDispInfo)
@@ -438,12 +913,21 @@ public:
         assert((uint32_t)picId < m_perFrameDecodeImageSet.size());
 
         std::lock_guard<std::mutex> lock(m_displayQueueMutex);
+        if (m_perFrameDecodeImageSet[picId].m_displayOrderPredicted) {
+            // The picture was already released to the display queue by the
+            // display-order prediction, ahead of this parser callback (see
+            // QueuePictureForDecode()).
+            m_perFrameDecodeImageSet[picId].m_displayOrderPredicted = false;
+            return picId;
+        }
         m_perFrameDecodeImageSet[picId].m_displayOrder = m_frameNumInDisplayOrder++;
         m_perFrameDecodeImageSet[picId].m_timestamp = pDispInfo->timestamp;
         m_perFrameDecodeImageSet[picId].m_inDisplayQueue = true;
         m_perFrameDecodeImageSet[picId].AddRef();
 
-        m_displayFrames.push((uint8_t)picId);
+        const bool pushSuccess = m_displayFrames.Push((uint8_t)picId);
+        assert(pushSuccess);
+        (void)pushSuccess;
 
         if (m_debug) {
             std::cout << "==> Queue Display Picture picIdx: " << (uint32_t)picId
@@ -468,13 +952,28 @@ public:
         m_perFrameDecodeImageSet[picId].stdVps = const_cast<VkVideoRefCountBase*>(pReferencedObjectsInfo->pStdVps);
         m_perFrameDecodeImageSet[picId].bitstreamData = const_cast<VkVideoRefCountBase*>(pReferencedObjectsInfo->pBitstreamData);
 
+        // Latency trace stamps: the picture is fully parsed once it is queued
+        // for decode; the demux stamp is the one of the last chunk the
+        // demuxer handed to the parser (see SetLastDemuxDoneTimeNs()).
+        m_perFrameDecodeImageSet[picId].m_demuxDoneTimeNs = m_lastDemuxDoneTimeNs.load(std::memory_order_relaxed);
+        m_perFrameDecodeImageSet[picId].m_parseDoneTimeNs = GetCurrentTimeNanoseconds();
+        m_perFrameDecodeImageSet[picId].m_decodeSubmitTimeNs = 0;
+
+        VK_VIDEO_PROBE_COUNT(QUEUED_PICTURES);
+        VK_VIDEO_PROBE_TRACE("QueuePictureForDecode: picIdx %u, decodeOrder %d",
+                             (uint32_t)picId, m_perFrameDecodeImageSet[picId].m_decodeOrder.load());
+
         if (m_debug) {
             std::cout << "==> Queue Decode Picture picIdx: " << (uint32_t)picId
                       << "\t\tdisplayOrder: " << m_perFrameDecodeImageSet[picId].m_displayOrder << "\tdecodeOrder: " << m_perFrameDecodeImageSet[picId].m_decodeOrder
                       << "\tFrameType " << m_perFrameDecodeImageSet[picId].m_picDispInfo.videoFrameType << std::endl;
         }
 
-        if (pFrameSynchronizationInfo->hasFrameCompleteSignalFence) {
+        // In the timeline mode the per-picture fence is not handed out at all:
+        // the decoder and the consumers wait on the session timeline value
+        // instead, so no fence has to be reset and re-submitted per picture.
+        if (pFrameSynchronizationInfo->hasFrameCompleteSignalFence &&
+                (m_frameTimelineSemaphore == VkSemaphore())) {
             pFrameSynchronizationInfo->frameCompleteFence = m_perFrameDecodeImageSet[picId].m_frameCompleteFence;
             if (pFrameSynchronizationInfo->frameCompleteFence) {
                 m_perFrameDecodeImageSet[picId].m_hasFrameCompleteSignalFence = true;
@@ -498,28 +997,86 @@ public:
             m_perFrameDecodeImageSet[picId].m_hasConsummerSignalSemaphore = false;
         }
 
+        if (m_frameTimelineSemaphore != VkSemaphore()) {
+            // One value per queued picture: the decode submit signals the
+            // session timeline to this value when the picture is done.
+            m_perFrameDecodeImageSet[picId].m_frameCompleteTimelineValue = ++m_frameTimelineValue;
+            pFrameSynchronizationInfo->frameCompleteTimelineSemaphore = m_frameTimelineSemaphore;
+            pFrameSynchronizationInfo->frameCompleteTimelineValue = m_perFrameDecodeImageSet[picId].m_frameCompleteTimelineValue;
+        }
+
         pFrameSynchronizationInfo->queryPool = m_queryPool;
         pFrameSynchronizationInfo->startQueryId = picId;
         pFrameSynchronizationInfo->numQueries = 1;
 
+        // Hand the slot to the background harvester. The in-band query reset
+        // has not executed yet, so the harvester can pick up the previous
+        // decode's status of this slot once more before the reset lands; the
+        // next poll then publishes the status of this decode.
+        m_decodeStatus[picId].store(VK_QUERY_RESULT_STATUS_NOT_READY_KHR, std::memory_order_relaxed);
+        m_queryPendingMask.fetch_or(1u << picId, std::memory_order_release);
+
+        // Display-order prediction: with an SPS-signaled reorder depth of
+        // zero the output order is the decode order, so the picture goes to
+        // the display queue right away instead of waiting out the parser's
+        // DPB output delay. Only progressive frames are predicted - field
+        // pairing is left to the parser. The consumer still synchronizes on
+        // the frame-complete fence/timeline value handed out above, so the
+        // early queueing never exposes an unfinished decode.
+        m_perFrameDecodeImageSet[picId].m_displayOrderPredicted = false;
+        if ((m_displayOrderPredictionDepth == 0) &&
+                !pDecodePictureInfo->flags.fieldPic) {
+            m_perFrameDecodeImageSet[picId].m_displayOrder = m_frameNumInDisplayOrder++;
+            m_perFrameDecodeImageSet[picId].m_timestamp = 0;
+            m_perFrameDecodeImageSet[picId].m_inDisplayQueue = true;
+            m_perFrameDecodeImageSet[picId].m_displayOrderPredicted = true;
+            m_perFrameDecodeImageSet[picId].AddRef();
+
+            const bool pushSuccess = m_displayFrames.Push((uint8_t)picId);
+            assert(pushSuccess);
+            (void)pushSuccess;
+
+            if (m_debug) {
+                std::cout << "==> Queue Display Picture (predicted) picIdx: " << (uint32_t)picId
+                          << "\t\tdisplayOrder: " << m_perFrameDecodeImageSet[picId].m_displayOrder
+                          << "\tdecodeOrder: " << m_perFrameDecodeImageSet[picId].m_decodeOrder << std::endl;
+            }
+        }
+
         return picId;
     }
 
+    virtual int32_t GetDisplayQueuePendingFrameCount()
+    {
+        return (int32_t)m_displayFrames.Size();
+    }
+
     // dequeue
     virtual int32_t DequeueDecodedPicture(DecodedFrame* pDecodedFrame)
     {
         int numberofPendingFrames = 0;
         int pictureIndex = -1;
+
+        // Fast path: the consumer can poll an empty display ring without
+        // touching the display queue mutex at all.
+        if (m_displayFrames.Empty()) {
+            return 0;
+        }
+
         std::lock_guard<std::mutex> lock(m_displayQueueMutex);
-        if (!m_displayFrames.empty()) {
-            numberofPendingFrames = (int)m_displayFrames.size();
-            pictureIndex = m_displayFrames.front();
+        uint8_t displayPictureIndex = 0;
+        numberofPendingFrames = (int)m_displayFrames.Size();
+        if (m_displayFrames.Pop(displayPictureIndex)) {
+            pictureIndex = displayPictureIndex;
             assert((pictureIndex >= 0) && ((uint32_t)pictureIndex < m_perFrameDecodeImageSet.size()));
             assert(!(m_ownedByDisplayMask & (1 << pictureIndex)));
             m_ownedByDisplayMask |= (1 << pictureIndex);
-            m_displayFrames.pop();
             m_perFrameDecodeImageSet[pictureIndex].m_inDisplayQueue = false;
             m_perFrameDecodeImageSet[pictureIndex].m_ownedByDisplay = true;
+
+            VK_VIDEO_PROBE_COUNT(DEQUEUED_PICTURES);
+            VK_VIDEO_PROBE_TRACE("DequeueDecodedPicture: picIdx %d, displayOrder %d",
+                                 pictureIndex, m_perFrameDecodeImageSet[pictureIndex].m_displayOrder.load());
         }
 
         if ((uint32_t)pictureIndex < m_perFrameDecodeImageSet.size()) {
@@ -548,13 +1105,23 @@ public:
             pDecodedFrame->frameConsumerDoneFence = m_perFrameDecodeImageSet[pictureIndex].m_frameConsumerDoneFence;
             pDecodedFrame->frameConsumerDoneSemaphore = m_perFrameDecodeImageSet[pictureIndex].m_frameConsumerDoneSemaphore;
 
+            pDecodedFrame->frameCompleteTimelineSemaphore = m_frameTimelineSemaphore;
+            pDecodedFrame->frameCompleteTimelineValue = m_perFrameDecodeImageSet[pictureIndex].m_frameCompleteTimelineValue;
+
             pDecodedFrame->timestamp = m_perFrameDecodeImageSet[pictureIndex].m_timestamp;
+            pDecodedFrame->demuxDoneTimeNs = m_perFrameDecodeImageSet[pictureIndex].m_demuxDoneTimeNs;
+            pDecodedFrame->parseDoneTimeNs = m_perFrameDecodeImageSet[pictureIndex].m_parseDoneTimeNs;
+            pDecodedFrame->decodeSubmitTimeNs = m_perFrameDecodeImageSet[pictureIndex].m_decodeSubmitTimeNs;
             pDecodedFrame->decodeOrder = m_perFrameDecodeImageSet[pictureIndex].m_decodeOrder;
             pDecodedFrame->displayOrder = m_perFrameDecodeImageSet[pictureIndex].m_displayOrder;
 
             pDecodedFrame->queryPool = m_queryPool;
             pDecodedFrame->startQueryId = pictureIndex;
             pDecodedFrame->numQueries = 1;
+
+            // Non-blocking: the published value of the background harvester.
+            pDecodedFrame->decodeStatus =
+                    (VkQueryResultStatusKHR)m_decodeStatus[pictureIndex].load(std::memory_order_acquire);
         }
 
         if (m_debug) {
@@ -597,7 +1164,8 @@ public:
                                                 VkImageLayout newDpbImageLayerLayout = VK_IMAGE_LAYOUT_VIDEO_DECODE_DPB_KHR)
     {
         assert(dpbPictureResources);
-        std::lock_guard<std::mutex> lock(m_displayQueueMutex);
+        // No display queue lock here: GetImageSetNewLayout() takes the
+        // per-slot mutex, so concurrent slot-local accessors do not convoy.
         for (unsigned int resId = 0; resId < numResources; resId++) {
             if ((uint32_t)referenceSlotIndexes[resId] < m_perFrameDecodeImageSet.size()) {
 
@@ -629,7 +1197,7 @@ public:
                                                    VkImageLayout newOutputImageLayerLayout = VK_IMAGE_LAYOUT_MAX_ENUM)
     {
         assert(dpbPictureResource);
-        std::lock_guard<std::mutex> lock(m_displayQueueMutex);
+        // Slot-local; see GetDpbImageResourcesByIndex() above.
         if ((uint32_t)referenceSlotIndex < m_perFrameDecodeImageSet.size()) {
 
             VkResult result = m_perFrameDecodeImageSet.GetImageSetNewLayout(m_vkDevCtx,
@@ -661,22 +1229,27 @@ public:
 
     virtual int32_t ReleaseImageResources(uint32_t numResources, const uint32_t* indexes)
     {
+        // Pool reconfiguration: keep the global lock and additionally take
+        // each slot's mutex, so in-flight slot-local accessors finish before
+        // their images are torn down.
         std::lock_guard<std::mutex> lock(m_displayQueueMutex);
         for (unsigned int resId = 0; resId < numResources; resId++) {
             if ((uint32_t)indexes[resId] < m_perFrameDecodeImageSet.size()) {
+                std::lock_guard<std::mutex> slotLock(m_perFrameDecodeImageSet[indexes[resId]].m_slotMutex);
                 m_perFrameDecodeImageSet[indexes[resId]].Deinit();
             }
         }
         return (int32_t)m_perFrameDecodeImageSet.size();
     }
 
+    // The ordering counters and time stamps below are per-slot atomics; the
+    // pool size only changes during reconfiguration while decoding is
+    // quiesced, so the size check does not need the display queue lock.
     virtual int32_t SetPicNumInDecodeOrder(int32_t picId, int32_t picNumInDecodeOrder)
     {
-        std::lock_guard<std::mutex> lock(m_displayQueueMutex);
         if ((uint32_t)picId < m_perFrameDecodeImageSet.size()) {
-            int32_t oldPicNumInDecodeOrder = m_perFrameDecodeImageSet[picId].m_decodeOrder;
-            m_perFrameDecodeImageSet[picId].m_decodeOrder = picNumInDecodeOrder;
-            return oldPicNumInDecodeOrder;
+            return m_perFrameDecodeImageSet[picId].m_decodeOrder.exchange(picNumInDecodeOrder,
+                                                                          std::memory_order_relaxed);
         }
         assert(false);
         return -1;
@@ -684,11 +1257,26 @@ public:
 
     virtual int32_t SetPicNumInDisplayOrder(int32_t picId, int32_t picNumInDisplayOrder)
     {
-        std::lock_guard<std::mutex> lock(m_displayQueueMutex);
         if ((uint32_t)picId < m_perFrameDecodeImageSet.size()) {
-            int32_t oldPicNumInDisplayOrder = m_perFrameDecodeImageSet[picId].m_displayOrder;
-            m_perFrameDecodeImageSet[picId].m_displayOrder = picNumInDisplayOrder;
-            return oldPicNumInDisplayOrder;
+            return m_perFrameDecodeImageSet[picId].m_displayOrder.exchange(picNumInDisplayOrder,
+                                                                           std::memory_order_relaxed);
+        }
+        assert(false);
+        return -1;
+    }
+
+    virtual int32_t SetLastDemuxDoneTimeNs(uint64_t timeNs)
+    {
+        m_lastDemuxDoneTimeNs.store(timeNs, std::memory_order_relaxed);
+        return 0;
+    }
+
+    virtual int32_t SetPicDecodeSubmittedTimeNs(int32_t picId, uint64_t timeNs)
+    {
+        if ((uint32_t)picId < m_perFrameDecodeImageSet.size()) {
+            m_perFrameDecodeImageSet[picId].m_decodeSubmitTimeNs.store(timeNs,
+                                                                      std::memory_order_relaxed);
+            return picId;
         }
         assert(false);
         return -1;
@@ -742,14 +1330,37 @@ private:
     std::atomic<int32_t>     m_refCount;
     std::mutex               m_displayQueueMutex;
     NvPerFrameDecodeImageSet m_perFrameDecodeImageSet;
-    std::queue<uint8_t>      m_displayFrames;
+    DisplayFrameRing         m_displayFrames;
     VkQueryPool              m_queryPool;
+    // Timeline frame synchronization state (see EnableTimelineFrameSync()).
+    VkSemaphore              m_frameTimelineSemaphore;
+    uint64_t                 m_frameTimelineValue;
     uint32_t                 m_ownedByDisplayMask;
     int32_t                  m_frameNumInDecodeOrder;
     int32_t                  m_frameNumInDisplayOrder;
+    // The SPS-signaled reorder depth, or negative while unknown (see
+    // SetDisplayOrderPredictionDepth()).
+    int32_t                  m_displayOrderPredictionDepth;
+    // The demux-done stamp of the last chunk handed to the parser (see
+    // SetLastDemuxDoneTimeNs()).
+    std::atomic<uint64_t>    m_lastDemuxDoneTimeNs;
     VkExtent2D               m_codedExtent;               // for the codedExtent, not the max image resolution
     uint32_t                 m_numberParameterUpdates;
     uint32_t                 m_debug : 1;
+    // Cross-process frame export state (see EnableDecodedFrameExport()).
+    uint32_t                 m_exportDecodedFrames : 1;
+    // Incremental DPB allocation state (see StartImageWarmUpThread()).
+    bool                     m_exitImageWarmUpThread;
+    std::thread              m_imageWarmUpThread;
+    // Background decode-status harvesting state (see
+    // StartQueryHarvestThread()). m_queryPendingMask holds one bit per query
+    // slot with a harvest outstanding; m_decodeStatus is the per-slot
+    // published result. Both are shared with the harvester thread without
+    // taking the display queue mutex.
+    std::atomic<uint32_t>    m_queryPendingMask;
+    std::atomic<int32_t>     m_decodeStatus[maxFramebufferImages];
+    std::atomic<bool>        m_exitQueryHarvestThread;
+    std::thread              m_queryHarvestThread;
 };
 
 VkResult VulkanVideoFrameBuffer::Create(const VulkanDeviceContext* vkDevCtx,
@@ -786,7 +1397,8 @@ VkResult NvPerFrameDecodeResources::CreateImage( const VulkanDeviceContext* vkDe
                                                  VkSharedBaseObj<VkImageResource>& imageArrayParent,
                                                  VkSharedBaseObj<VkImageResourceView>& imageViewArrayParent,
                                                  bool useSeparateOutputImage,
-                                                 bool useLinearOutput)
+                                                 bool useLinearOutput,
+                                                 bool exportImageMemory)
 {
     VkResult result = VK_SUCCESS;
 
@@ -796,12 +1408,18 @@ VkResult NvPerFrameDecodeResources::CreateImage( const VulkanDeviceContext* vkDe
 
         m_currentDpbImageLayerLayout = pImageCreateInfo->initialLayout;
         m_currentOutputImageLayout = pImageCreateInfo->initialLayout;
+        m_displayViewImageResource = nullptr;
 
         VkSharedBaseObj<VkImageResource> imageResource;
         if (!imageArrayParent) {
+            // When the DPB picture coincides with the output, the DPB image
+            // itself is what the consumer process imports.
+            const bool exportThisImage = exportImageMemory &&
+                    !(useSeparateOutputImage || useLinearOutput);
             result = VkImageResource::Create(vkDevCtx,
                                              pImageCreateInfo, requiredMemProps,
-                                             imageResource);
+                                             imageResource,
+                                             exportThisImage);
             if (result != VK_SUCCESS) {
                 return result;
             }
@@ -831,13 +1449,12 @@ VkResult NvPerFrameDecodeResources::CreateImage( const VulkanDeviceContext* vkDe
             m_frameImageView = imageViewArrayParent;
 
             if (!(useSeparateOutputImage || useLinearOutput)) {
-                VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, imageIndex, 1 };
-                result = VkImageResourceView::Create(vkDevCtx, imageResource,
-                                                     subresourceRange,
-                                                     m_displayImageView);
-                if (result != VK_SUCCESS) {
-                    return result;
-                }
+                // The per-layer display view is only needed when the slot is
+                // actually displayed or output; record what it spans and let
+                // EnsureDisplayImageViewLocked() create it on first use.
+                m_displayImageView = nullptr;
+                m_displayViewImageResource = imageResource;
+                m_displayViewSubresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, imageIndex, 1 };
             }
         }
 
@@ -863,18 +1480,17 @@ VkResult NvPerFrameDecodeResources::CreateImage( const VulkanDeviceContext* vkDe
             result = VkImageResource::Create(vkDevCtx,
                                              &separateImageCreateInfo,
                                              useLinearOutput ? linearRequiredMemProps : requiredMemProps,
-                                             displayImageResource);
+                                             displayImageResource,
+                                             exportImageMemory);
             if (result != VK_SUCCESS) {
                 return result;
             }
 
-            VkImageSubresourceRange subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
-            result = VkImageResourceView::Create(vkDevCtx, displayImageResource,
-                                                 subresourceRange,
-                                                 m_displayImageView);
-            if (result != VK_SUCCESS) {
-                return result;
-            }
+            // Defer the separate output image's view the same way; decode
+            // runs that never output this slot skip the view creation.
+            m_displayImageView = nullptr;
+            m_displayViewImageResource = displayImageResource;
+            m_displayViewSubresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
         }
     }
 
@@ -885,7 +1501,49 @@ VkResult NvPerFrameDecodeResources::CreateImage( const VulkanDeviceContext* vkDe
     return result;
 }
 
-VkResult NvPerFrameDecodeResources::init(const VulkanDeviceContext* vkDevCtx)
+VkResult NvPerFrameDecodeResources::ExportFrameHandles(VulkanVideoFrameBuffer::ExportedFrameHandles* pExportedFrameHandles)
+{
+    std::lock_guard<std::mutex> slotLock(m_slotMutex);
+
+    if (!ImageExist()) {
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    // The consumer imports the output picture: the separate/linear output
+    // image when one exists, otherwise the DPB image the output coincides
+    // with (see CreateImage()).
+    VkSharedBaseObj<VkImageResource> outputImageResource(m_displayViewImageResource ?
+            m_displayViewImageResource : m_frameImageView->GetImageResource());
+
+    const VkImageCreateInfo& imageCreateInfo = outputImageResource->GetImageCreateInfo();
+    pExportedFrameHandles->memorySize     = outputImageResource->GetImageDeviceMemorySize();
+    pExportedFrameHandles->imageFormat    = imageCreateInfo.format;
+    pExportedFrameHandles->maxImageExtent = { imageCreateInfo.extent.width, imageCreateInfo.extent.height };
+    pExportedFrameHandles->baseArrayLayer = m_displayViewSubresourceRange.baseArrayLayer;
+
+    VkResult result = outputImageResource->GetMemoryFd(&pExportedFrameHandles->memoryFd);
+    if (result != VK_SUCCESS) {
+        assert(!"Could not export the output image's memory fd!");
+        return result;
+    }
+
+    VkSemaphoreGetFdInfoKHR semGetFdInfo = VkSemaphoreGetFdInfoKHR();
+    semGetFdInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_GET_FD_INFO_KHR;
+    semGetFdInfo.semaphore = m_frameCompleteSemaphore;
+    semGetFdInfo.handleType = VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT;
+    result = m_vkDevCtx->GetSemaphoreFdKHR(*m_vkDevCtx, &semGetFdInfo,
+                                           &pExportedFrameHandles->frameCompleteSemaphoreFd);
+    if (result != VK_SUCCESS) {
+        assert(!"Could not export the frame-complete semaphore fd!");
+        close(pExportedFrameHandles->memoryFd);
+        pExportedFrameHandles->memoryFd = -1;
+    }
+
+    return result;
+}
+
+VkResult NvPerFrameDecodeResources::init(const VulkanDeviceContext* vkDevCtx,
+                                         bool exportFrameCompleteSemaphore)
 {
 
     m_vkDevCtx = vkDevCtx;
@@ -900,7 +1558,15 @@ VkResult NvPerFrameDecodeResources::init(const VulkanDeviceContext* vkDevCtx)
     assert(result == VK_SUCCESS);
 
     const VkSemaphoreCreateInfo semInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, nullptr };
-    result = m_vkDevCtx->CreateSemaphore(*m_vkDevCtx, &semInfo, nullptr, &m_frameCompleteSemaphore);
+    // The frame-complete semaphore is what an importing process waits on
+    // before sampling the exported picture, so it is the one created with
+    // the opaque-fd export handle type (see ExportFrameHandles()).
+    const VkExportSemaphoreCreateInfo exportSemInfo = { VK_STRUCTURE_TYPE_EXPORT_SEMAPHORE_CREATE_INFO, nullptr,
+                                                        VK_EXTERNAL_SEMAPHORE_HANDLE_TYPE_OPAQUE_FD_BIT };
+    const VkSemaphoreCreateInfo exportableSemInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, &exportSemInfo };
+    result = m_vkDevCtx->CreateSemaphore(*m_vkDevCtx,
+                                         exportFrameCompleteSemaphore ? &exportableSemInfo : &semInfo,
+                                         nullptr, &m_frameCompleteSemaphore);
     assert(result == VK_SUCCESS);
     result = m_vkDevCtx->CreateSemaphore(*m_vkDevCtx, &semInfo, nullptr, &m_frameConsumerDoneSemaphore);
     assert(result == VK_SUCCESS);
@@ -949,6 +1615,7 @@ void NvPerFrameDecodeResources::Deinit()
 
     m_frameImageView = nullptr;
     m_displayImageView = nullptr;
+    m_displayViewImageResource = nullptr;
 
     m_vkDevCtx = nullptr;
 
@@ -963,11 +1630,15 @@ int32_t NvPerFrameDecodeImageSet::init(const VulkanDeviceContext* vkDevCtx,
                                        VkImageTiling         tiling,
                                        VkImageUsageFlags     usage,
                                        uint32_t              queueFamilyIndex,
+                                       int32_t               numImagesToPreallocate,
                                        VkMemoryPropertyFlags requiredMemProps,
                                        bool useImageArray,
                                        bool useImageViewArray,
                                        bool useSeparateOutputImage,
-                                       bool useLinearOutput)
+                                       bool useLinearOutput,
+                                       const VkVideoProfileInfoKHR* pEncodeProfile,
+                                       uint32_t encodeQueueFamilyIndex,
+                                       bool exportDecodedFrames)
 {
     if (numImages > m_perFrameDecodeResources.size()) {
         assert(!"Number of requested images exceeds the max size of the image array");
@@ -980,8 +1651,42 @@ int32_t NvPerFrameDecodeImageSet::init(const VulkanDeviceContext* vkDevCtx,
                (m_imageCreateInfo.extent.width < maxImageExtent.width) ||
                (m_imageCreateInfo.extent.height < maxImageExtent.height));
 
+    // Downswitch compaction: when an adaptive stream drops to a coded size
+    // of at most half the current surface area, the old, larger surfaces are
+    // surplus. Surfaces nothing references anymore are released here, so
+    // their memory is reclaimed immediately; surfaces still pinned by the
+    // DPB or the display are only marked for recreation and shrink on the
+    // slot's next use. Image arrays are one shared allocation and cannot be
+    // compacted per slot.
+    const bool compactImages = !reconfigureImages && !useImageArray &&
+        (m_numImages != 0) && (m_imageCreateInfo.sType == VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO) &&
+        (m_imageCreateInfo.format == imageFormat) &&
+        (((uint64_t)maxImageExtent.width * maxImageExtent.height * 2) <=
+         ((uint64_t)m_imageCreateInfo.extent.width * m_imageCreateInfo.extent.height));
+
+    if (compactImages) {
+        for (uint32_t imageIndex = 0; imageIndex < m_numImages; imageIndex++) {
+
+            NvPerFrameDecodeResources& decodeResources = m_perFrameDecodeResources[imageIndex];
+            std::lock_guard<std::mutex> slotLock(decodeResources.m_slotMutex);
+
+            if (!decodeResources.ImageExist()) {
+                continue;
+            }
+
+            decodeResources.m_recreateImage = true;
+
+            if (decodeResources.IsAvailable() &&
+                    !decodeResources.m_inDecodeQueue &&
+                    !decodeResources.m_inDisplayQueue &&
+                    !decodeResources.m_ownedByDisplay) {
+                decodeResources.ReleaseImages();
+            }
+        }
+    }
+
     for (uint32_t imageIndex = m_numImages; imageIndex < numImages; imageIndex++) {
-        VkResult result = m_perFrameDecodeResources[imageIndex].init(vkDevCtx);
+        VkResult result = m_perFrameDecodeResources[imageIndex].init(vkDevCtx, exportDecodedFrames);
         assert(result == VK_SUCCESS);
         if (result != VK_SUCCESS) {
             return -1;
@@ -995,10 +1700,21 @@ int32_t NvPerFrameDecodeImageSet::init(const VulkanDeviceContext* vkDevCtx,
     m_videoProfile.InitFromProfile(pDecodeProfile);
 
     m_queueFamilyIndex = queueFamilyIndex;
+    m_encodeQueueFamilyIndex = encodeQueueFamilyIndex;
     m_requiredMemProps = requiredMemProps;
     m_imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     // m_imageCreateInfo.pNext = m_videoProfile.GetProfile();
     m_imageCreateInfo.pNext = m_videoProfile.GetProfileListInfo();
+    if (pEncodeProfile != nullptr) {
+        // Zero-copy hand-off to an encoder: the images must carry both the
+        // decode and the encode profile in their profile list, so they are
+        // valid as decode DPB/output and as encode input at the same time.
+        m_encodeProfile.InitFromProfile(pEncodeProfile);
+        m_imageProfiles[0] = *m_videoProfile.GetProfile();
+        m_imageProfiles[1] = *m_encodeProfile.GetProfile();
+        m_imageProfileList = { VK_STRUCTURE_TYPE_VIDEO_PROFILE_LIST_INFO_KHR, nullptr, 2, m_imageProfiles };
+        m_imageCreateInfo.pNext = &m_imageProfileList;
+    }
     m_imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
     m_imageCreateInfo.format = imageFormat;
     m_imageCreateInfo.extent = { maxImageExtent.width, maxImageExtent.height, 1 };
@@ -1007,17 +1723,31 @@ int32_t NvPerFrameDecodeImageSet::init(const VulkanDeviceContext* vkDevCtx,
     m_imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     m_imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     m_imageCreateInfo.usage = usage;
-    m_imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    m_imageCreateInfo.queueFamilyIndexCount = 1;
-    m_imageCreateInfo.pQueueFamilyIndices = &m_queueFamilyIndex;
+    if ((m_encodeQueueFamilyIndex != (uint32_t)-1) && (m_encodeQueueFamilyIndex != m_queueFamilyIndex)) {
+        // The encoder consumes the decoded pictures on its own queue family.
+        m_sharedQueueFamilyIndices[0] = m_queueFamilyIndex;
+        m_sharedQueueFamilyIndices[1] = m_encodeQueueFamilyIndex;
+        m_imageCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        m_imageCreateInfo.queueFamilyIndexCount = 2;
+        m_imageCreateInfo.pQueueFamilyIndices = m_sharedQueueFamilyIndices;
+    } else {
+        m_imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        m_imageCreateInfo.queueFamilyIndexCount = 1;
+        m_imageCreateInfo.pQueueFamilyIndices = &m_queueFamilyIndex;
+    }
     m_imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     m_imageCreateInfo.flags = 0;
 
     if (useImageArray) {
         // Create an image that has the same number of layers as the DPB images required.
+        // When the output coincides with the DPB array, the whole array
+        // allocation is what gets exported; the consumer selects a slot by
+        // its base array layer (see ExportFrameHandles()).
         VkResult result = VkImageResource::Create(vkDevCtx,
                                                   &m_imageCreateInfo, requiredMemProps,
-                                                  m_imageArray);
+                                                  m_imageArray,
+                                                  exportDecodedFrames &&
+                                                      !(useSeparateOutputImage || useLinearOutput));
         if (result != VK_SUCCESS) {
             return -1;
         }
@@ -1039,16 +1769,50 @@ int32_t NvPerFrameDecodeImageSet::init(const VulkanDeviceContext* vkDevCtx,
         }
     }
 
+    // In the incremental mode, create only the first numImagesToPreallocate
+    // images here; the remainder are created by the background warm-up thread
+    // or, if the decoder gets to them first, on first use in
+    // GetImageSetNewLayout(). Image arrays are a single allocation and are
+    // always created in full.
+    const bool deferImageCreation = (numImagesToPreallocate >= 0) && !useImageArray;
+
     uint32_t firstIndex = reconfigureImages ? 0 : m_numImages;
     uint32_t maxNumImages = std::max(m_numImages, numImages);
     for (uint32_t imageIndex = firstIndex; imageIndex < maxNumImages; imageIndex++) {
 
         if (m_perFrameDecodeResources[imageIndex].ImageExist() && reconfigureImages) {
 
-            m_perFrameDecodeResources[imageIndex].m_recreateImage = true;
+            if (useImageArray) {
+                // The flat layer state captured below is per init, so the
+                // array path rebinds its slots to the new array image eagerly
+                // instead of on first use; the old views stay alive through
+                // the references the in-flight frames still hold.
+                std::lock_guard<std::mutex> slotLock(m_perFrameDecodeResources[imageIndex].m_slotMutex);
+                m_perFrameDecodeResources[imageIndex].ReleaseImages();
+                VkResult result =
+                         m_perFrameDecodeResources[imageIndex].CreateImage(vkDevCtx,
+                                                                     &m_imageCreateInfo,
+                                                                      m_requiredMemProps,
+                                                                      imageIndex,
+                                                                      m_imageArray,
+                                                                      m_imageViewArray,
+                                                                      useSeparateOutputImage,
+                                                                      useLinearOutput,
+                                                                      exportDecodedFrames);
+                assert(result == VK_SUCCESS);
+                if (result != VK_SUCCESS) {
+                    return -1;
+                }
+            } else {
+                m_perFrameDecodeResources[imageIndex].m_recreateImage = true;
+            }
 
         } else if (!m_perFrameDecodeResources[imageIndex].ImageExist()) {
 
+            if (deferImageCreation && (imageIndex >= (uint32_t)numImagesToPreallocate)) {
+                continue;
+            }
+
             VkResult result =
                      m_perFrameDecodeResources[imageIndex].CreateImage(vkDevCtx,
                                                                  &m_imageCreateInfo,
@@ -1057,7 +1821,8 @@ int32_t NvPerFrameDecodeImageSet::init(const VulkanDeviceContext* vkDevCtx,
                                                                   m_imageArray,
                                                                   m_imageViewArray,
                                                                   useSeparateOutputImage,
-                                                                  useLinearOutput);
+                                                                  useLinearOutput,
+                                                                  exportDecodedFrames);
 
             assert(result == VK_SUCCESS);
             if (result != VK_SUCCESS) {
@@ -1066,11 +1831,27 @@ int32_t NvPerFrameDecodeImageSet::init(const VulkanDeviceContext* vkDevCtx,
         }
     }
 
+    if (useImageArray) {
+        // The array path is fully resident after the loop above - capture the
+        // flat per-layer state the reference lookups read from now on (see
+        // GetImageSetNewLayout()).
+        m_arrayImage = m_imageArray->GetImage();
+        for (uint32_t imageIndex = 0; imageIndex < numImages; imageIndex++) {
+            m_arrayLayerState[imageIndex].view = useImageViewArray ?
+                    m_imageViewArray->GetImageView() :
+                    m_perFrameDecodeResources[imageIndex].GetFrameImageView()->GetImageView();
+            m_arrayLayerState[imageIndex].currentDpbLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+    } else {
+        m_arrayImage = VkImage();
+    }
+
     m_numImages = numImages;
     m_usesImageArray          = useImageArray;
     m_usesImageViewArray      = useImageViewArray;
     m_usesSeparateOutputImage = useSeparateOutputImage;
     m_usesLinearOutput        = useLinearOutput;
+    m_exportDecodedFrames     = exportDecodedFrames;
 
     return (int32_t)numImages;
 }
@@ -1081,5 +1862,6 @@ void NvPerFrameDecodeImageSet::Deinit()
         m_perFrameDecodeResources[ndx].Deinit();
     }
 
+    m_arrayImage = VkImage();
     m_numImages = 0;
 }
@@ -19,12 +19,33 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <chrono>
 
 #include "VkVideoCore/VkVideoRefCountBase.h"
 #include "VulkanVideoParser.h"
 #include "vulkan_interfaces.h"
 #include "VkCodecUtils/VkImageResource.h"
 
+// The monotonic host clock used for the per-frame pipeline latency stamps
+// below (see the --frameLatencyTrace option of the decoder application).
+inline uint64_t GetCurrentTimeNanoseconds()
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// One decoded picture handed to a consumer (display, readback or a video
+// encoder). The consumer must wait on frameCompleteSemaphore (or
+// frameCompleteFence) before reading the image, and signal the consumer-done
+// semaphore/fence (setting the hasConsummerSignal* bits) before releasing the
+// picture, so the decoder does not recycle the image while it is still in
+// use. When the image pool was created with an encode profile (see
+// InitImagePool()), the decoded image can be used directly as encode input
+// on the encode queue without any intermediate copy. When the frame buffer
+// uses timeline synchronization (see EnableTimelineFrameSync()), the session
+// timeline semaphore reaching frameCompleteTimelineValue marks the same
+// decode-complete point and can be waited on from the host with
+// vkWaitSemaphoresKHR() instead of the per-picture fence.
 struct DecodedFrame {
     int32_t pictureIndex;
     int32_t displayWidth;
@@ -35,13 +56,29 @@ struct DecodedFrame {
     VkFence frameConsumerDoneFence; // If valid, the fence is signaled when the consumer (graphics, compute or display) is done using the frame.
     VkSemaphore frameCompleteSemaphore; // If valid, the semaphore is signaled when the decoder is done decoding the frame.
     VkSemaphore frameConsumerDoneSemaphore; // If valid, the semaphore is signaled when the consumer (graphics, compute or display) is done using the frame.
+    VkSemaphore frameCompleteTimelineSemaphore; // If valid, the session timeline semaphore reaching frameCompleteTimelineValue indicates the decoder is done decoding the frame.
+    uint64_t frameCompleteTimelineValue;
     VkQueryPool queryPool; // queryPool handle used for the video queries.
     int32_t startQueryId;  // query Id used for the this frame.
     uint32_t numQueries;   // usually one query per frame
+    // The decode result status last harvested for this picture's query slot
+    // by the background query harvester, VK_QUERY_RESULT_STATUS_NOT_READY_KHR
+    // while the result is not available yet. Reading it never blocks.
+    VkQueryResultStatusKHR decodeStatus;
     // If multiple queues are available, submittedVideoQueueIndex is the queue index that the video frame was submitted to.
     // if only one queue is available, submittedVideoQueueIndex will always have a value of "0".
     int32_t  submittedVideoQueueIndex;
     uint64_t timestamp;
+    // Pipeline latency stamps in monotonic nanoseconds (see
+    // GetCurrentTimeNanoseconds() and the --frameLatencyTrace option): when
+    // the demuxer produced the chunk this picture came from, when the parser
+    // queued the picture for decode, when the decode was submitted to the
+    // video queue, and when the host first observed the decode complete
+    // (left 0 when the host never had to wait for this frame).
+    uint64_t demuxDoneTimeNs;
+    uint64_t parseDoneTimeNs;
+    uint64_t decodeSubmitTimeNs;
+    uint64_t decodeDoneTimeNs;
     uint32_t hasConsummerSignalFence : 1;
     uint32_t hasConsummerSignalSemaphore : 1;
     // For debugging
@@ -59,11 +96,18 @@ struct DecodedFrame {
         frameConsumerDoneFence = VkFence();
         frameCompleteSemaphore = VkSemaphore();
         frameConsumerDoneSemaphore = VkSemaphore();
+        frameCompleteTimelineSemaphore = VkSemaphore();
+        frameCompleteTimelineValue = 0;
         queryPool = VkQueryPool();
         startQueryId = 0;
         numQueries = 0;
+        decodeStatus = VK_QUERY_RESULT_STATUS_NOT_READY_KHR;
         submittedVideoQueueIndex = 0;
         timestamp = 0;
+        demuxDoneTimeNs = 0;
+        parseDoneTimeNs = 0;
+        decodeSubmitTimeNs = 0;
+        decodeDoneTimeNs = 0;
         hasConsummerSignalFence = false;
         hasConsummerSignalSemaphore = false;
         // For debugging
@@ -93,6 +137,8 @@ public:
         VkSemaphore frameCompleteSemaphore;
         VkFence frameConsumerDoneFence;
         VkSemaphore frameConsumerDoneSemaphore;
+        VkSemaphore frameCompleteTimelineSemaphore;
+        uint64_t frameCompleteTimelineValue;
         VkQueryPool queryPool;
         int32_t startQueryId;
         uint32_t numQueries;
@@ -127,6 +173,15 @@ public:
         VkImageLayout currentImageLayout;
     };
 
+    // When pEncodeProfile is provided, the images are created with both the
+    // decode and the encode profile in their profile list and are shared
+    // concurrently with encodeQueueFamilyIndex, so a video encoder can consume
+    // the decoded pictures in place (usage should then also include
+    // VK_IMAGE_USAGE_VIDEO_ENCODE_SRC_BIT_KHR).
+    // With useOnDemandAllocation the pool never allocates ahead of use: no
+    // background warm-up is started and each deferred surface is only backed
+    // by memory when the decoder first references its slot, capping the
+    // worst-case DPB provisioning at the surfaces the stream actually uses.
     virtual int32_t InitImagePool(const VkVideoProfileInfoKHR* pDecodeProfile,
                                   uint32_t                 numImages,
                                   VkFormat                 imageFormat,
@@ -139,12 +194,90 @@ public:
                                   bool                     useImageArray = false,
                                   bool                     useImageViewArray = false,
                                   bool                     useSeparateOutputImage = false,
-                                  bool                     useLinearOutput = false) = 0;
+                                  bool                     useLinearOutput = false,
+                                  const VkVideoProfileInfoKHR* pEncodeProfile = nullptr,
+                                  uint32_t                 encodeQueueFamilyIndex = (uint32_t)-1,
+                                  bool                     useOnDemandAllocation = false) = 0;
+
+    // Switches the frame-complete synchronization to a single timeline
+    // semaphore shared by all pictures of the decode session. Each picture
+    // queued for decode is assigned the next monotonically increasing
+    // timeline value, so the host and cross-queue consumers can wait for any
+    // frame counter with vkWaitSemaphoresKHR() and no per-picture fence has
+    // to be handed out, reset and waited on. The per-picture binary
+    // frameCompleteSemaphore is still signaled for the WSI present path,
+    // which cannot wait on timeline semaphores. Requires the
+    // VK_KHR_timeline_semaphore device extension; call it before the first
+    // picture is queued for decode.
+    virtual VkResult EnableTimelineFrameSync() = 0;
+
+    // The handles a consumer process needs to import one decoded output
+    // picture: the opaque fd of the image allocation, the geometry to
+    // recreate a matching image on the import side, and the opaque fd of the
+    // frame-complete semaphore to wait on before sampling. The fds are owned
+    // by the caller, which typically passes them over a Unix domain socket
+    // (SCM_RIGHTS) to the compositor and closes them afterwards.
+    struct ExportedFrameHandles {
+        int           memoryFd;
+        VkDeviceSize  memorySize;
+        VkFormat      imageFormat;
+        VkExtent2D    maxImageExtent;
+        uint32_t      baseArrayLayer;
+        int           frameCompleteSemaphoreFd;
+    };
+
+    // Switches the output pictures to cross-process exportable allocations:
+    // the output images are created with an opaque-fd external memory handle
+    // type (VK_KHR_external_memory_fd) on dedicated allocations, and the
+    // per-picture frame-complete semaphores are created exportable
+    // (VK_KHR_external_semaphore_fd), so a compositor process imports the
+    // decoded picture and samples it directly - no linear readback and no
+    // shared-memory copy crosses the process boundary. Must be called before
+    // InitImagePool().
+    virtual VkResult EnableDecodedFrameExport() = 0;
+
+    // Fills the export handles of picId's output picture (see
+    // ExportedFrameHandles). Each call hands out fresh fds the caller owns.
+    // The memory fd stays valid for the life of the exported allocation, so
+    // a consumer only needs one import per pool slot; the semaphore fd has
+    // reference semantics as well and the per-slot semaphore is reused by
+    // every decode landing in the slot.
+    virtual VkResult ExportDecodedFrame(int8_t picId, ExportedFrameHandles* pExportedFrameHandles) = 0;
+
+    // Updates the coded extent stamped into the picture resources of the
+    // pictures queued from now on, so a compatible mid-stream sequence
+    // change does not have to reinitialize the image pool (see
+    // VkVideoDecoder::IsSequenceCompatibleWithCurrentConfig()).
+    virtual int32_t SetCodedExtent(const VkExtent2D& codedExtent) = 0;
+
+    // Display-order output prediction: sets the reorder depth the stream's
+    // SPS commits to (max_num_reorder_frames / max_num_reorder_pics), or a
+    // negative value when the depth is unknown. With a depth of zero the
+    // output order is the decode order, so QueuePictureForDecode() hands the
+    // picture to the display queue right away instead of after the parser's
+    // conservative DPB output delay, and the parser's own display callback
+    // for the picture is dropped when it eventually arrives. Any other
+    // depth keeps the parser-driven display path. The predicted frames carry
+    // no presentation timestamp - the PTS only becomes known with the late
+    // display callback (see VkVideoDecoder::EnableDisplayOrderPrediction()).
+    virtual int32_t SetDisplayOrderPredictionDepth(int32_t maxNumReorderFrames) = 0;
 
     virtual int32_t QueuePictureForDecode(int8_t picId, VkParserDecodePictureInfo* pDecodePictureInfo,
                                           ReferencedObjectsInfo* pReferencedObjectsInfo,
                                           FrameSynchronizationInfo* pFrameSynchronizationInfo) = 0;
+    // Pops the next displayable frame without any host synchronization: the
+    // frame-complete fence and semaphores come back attached to the
+    // DecodedFrame and the decode may still be in flight. Consumers defer
+    // the wait to the point of actual use - a GPU consumer waits on the
+    // semaphore in its submission, a CPU reader waits on the fence right
+    // before touching the pixels - so queueing the frame for later display
+    // overlaps the consumer's preparation with the tail of the decode.
     virtual int32_t DequeueDecodedPicture(DecodedFrame* pDecodedFrame) = 0;
+    // The number of decoded pictures sitting in the display queue that the
+    // consumer has not dequeued yet. Lock-free - the demux watermark
+    // throttle polls it per chunk (see
+    // VulkanVideoProcessor::ParserProcessNextDataChunk()).
+    virtual int32_t GetDisplayQueuePendingFrameCount() = 0;
     virtual int32_t ReleaseDisplayedPicture(DecodedFrameRelease** pDecodedFramesRelease, uint32_t numFramesToRelease) = 0;
     virtual int32_t GetDpbImageResourcesByIndex(uint32_t numResources, const int8_t* referenceSlotIndexes,
                                                 VkVideoPictureResourceInfoKHR* pictureResources,
@@ -160,6 +293,11 @@ public:
     virtual int32_t ReleaseImageResources(uint32_t numResources, const uint32_t* indexes) = 0;
     virtual int32_t SetPicNumInDecodeOrder(int32_t picId, int32_t picNumInDecodeOrder) = 0;
     virtual int32_t SetPicNumInDisplayOrder(int32_t picId, int32_t picNumInDisplayOrder) = 0;
+    // Latency trace stamps (see DecodedFrame): every picture queued for
+    // decode inherits the demux-done time last set here, until the decoder
+    // stamps the decode-submit time of the individual picture.
+    virtual int32_t SetLastDemuxDoneTimeNs(uint64_t timeNs) = 0;
+    virtual int32_t SetPicDecodeSubmittedTimeNs(int32_t picId, uint64_t timeNs) = 0;
     virtual size_t GetSize() = 0;
 
     virtual ~VulkanVideoFrameBuffer() { }
@@ -14,25 +14,151 @@
  * limitations under the License.
  */
 
+#include <thread>
+#include <vector>
+
 #include "NvEncodeApp.h"
 #include "nvidia_utils/vulkan/ycbcrvkinfo.h"
 
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+static void copyLumaRows(const uint8_t* yuvLuma, int32_t srcStride,
+                         uint8_t* nv12Luma, int32_t dstStride,
+                         int32_t width, int32_t startRow, int32_t endRow)
+{
+    for (int32_t y = startRow; y < endRow; y++) {
+        memcpy(nv12Luma + (dstStride * y), yuvLuma + (srcStride * y), width);
+    }
+}
+
+// Interleaves the planar Cb/Cr rows [startRow, endRow) into the NV12 chroma
+// plane, processing a full vector of pixels per iteration where the target
+// supports it and falling back to the byte loop for the row tail.
+static void interleaveChromaRows(const uint8_t* yuvCb, const uint8_t* yuvCr, int32_t srcChromaStride,
+                                 uint8_t* nv12Chroma, int32_t dstStride,
+                                 int32_t width, int32_t startRow, int32_t endRow)
+{
+    for (int32_t y = startRow; y < endRow; y++) {
+        const uint8_t* cbRow = yuvCb + (srcChromaStride * y);
+        const uint8_t* crRow = yuvCr + (srcChromaStride * y);
+        uint8_t* dstRow = nv12Chroma + (y * dstStride);
+
+        int32_t x = 0;
+#if defined(__AVX2__)
+        for (; (x + 64) <= width; x += 64) {
+            __m256i cb = _mm256_loadu_si256((const __m256i*)(cbRow + (x >> 1)));
+            __m256i cr = _mm256_loadu_si256((const __m256i*)(crRow + (x >> 1)));
+            __m256i lo = _mm256_unpacklo_epi8(cb, cr);
+            __m256i hi = _mm256_unpackhi_epi8(cb, cr);
+            // The unpacks interleave within each 128-bit lane - recombine the
+            // lanes so the stores are in pixel order.
+            _mm256_storeu_si256((__m256i*)(dstRow + x),      _mm256_permute2x128_si256(lo, hi, 0x20));
+            _mm256_storeu_si256((__m256i*)(dstRow + x + 32), _mm256_permute2x128_si256(lo, hi, 0x31));
+        }
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+        for (; (x + 32) <= width; x += 32) {
+            __m128i cb = _mm_loadu_si128((const __m128i*)(cbRow + (x >> 1)));
+            __m128i cr = _mm_loadu_si128((const __m128i*)(crRow + (x >> 1)));
+            _mm_storeu_si128((__m128i*)(dstRow + x),      _mm_unpacklo_epi8(cb, cr));
+            _mm_storeu_si128((__m128i*)(dstRow + x + 16), _mm_unpackhi_epi8(cb, cr));
+        }
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+        for (; (x + 32) <= width; x += 32) {
+            uint8x16x2_t cbcr;
+            cbcr.val[0] = vld1q_u8(cbRow + (x >> 1));
+            cbcr.val[1] = vld1q_u8(crRow + (x >> 1));
+            vst2q_u8(dstRow + x, cbcr);
+        }
+#endif
+        for (; x < width; x += 2) {
+            dstRow[x] = cbRow[x >> 1];
+            dstRow[x + 1] = crRow[x >> 1];
+        }
+    }
+}
+
+// Fills one NV12 frame of the benchmark input ring with vertical color bars,
+// rotated by ringIndex so consecutive ring slots differ. Adapted from the
+// decoder's color-bar pattern generator, which is tied to its own device
+// context and RGBA output and cannot be reused here directly.
+static void generateBenchmarkFrameNV12(uint8_t* luma, uint8_t* chroma,
+                                       uint32_t width, uint32_t height,
+                                       uint32_t stride, uint32_t ringIndex)
+{
+    static const uint8_t barLuma[8] = { 235, 210, 170, 145, 106,  81,  41,  16 };
+    static const uint8_t barCb[8]   = { 128,  16, 166,  54, 202,  90, 240, 128 };
+    static const uint8_t barCr[8]   = { 128, 146,  16,  34, 222, 240, 110, 128 };
+
+    for (uint32_t y = 0; y < height; y++) {
+        uint8_t* lumaRow = luma + ((size_t)y * stride);
+        for (uint32_t x = 0; x < width; x++) {
+            lumaRow[x] = barLuma[(((x * 8) / width) + ringIndex) % 8];
+        }
+    }
+
+    const uint32_t chromaHeight = (height + 1) / 2;
+    for (uint32_t y = 0; y < chromaHeight; y++) {
+        uint8_t* chromaRow = chroma + ((size_t)y * stride);
+        for (uint32_t x = 0; x < width; x += 2) {
+            const uint32_t bar = (((x * 8) / width) + ringIndex) % 8;
+            chromaRow[x] = barCb[bar];
+            chromaRow[x + 1] = barCr[bar];
+        }
+    }
+}
+
 void EncodeApp::convertYUVpitchtoNV12(const uint8_t *yuvLuma, const uint8_t *yuvCb, const uint8_t *yuvCr, uint8_t *nv12Luma,
                                       uint8_t *nv12Chroma, int32_t width, int32_t height, int32_t srcStride, int32_t dstStride)
 {
-    int32_t x, y;
+    const int32_t srcChromaStride = (srcStride + 1) / 2;
+    const int32_t chromaHeight = (height + 1) / 2;
+
+    // Partition the rows across a few worker threads for large frames. The
+    // conversion is memory-bound, so a handful of threads is enough to
+    // saturate the bandwidth; small frames are not worth the thread spawn.
+    const int32_t minRowsPerThread = 512;
+    uint32_t numThreads = 1;
+    if (height >= (2 * minRowsPerThread)) {
+        numThreads = std::min<uint32_t>({std::thread::hardware_concurrency(),
+                                         (uint32_t)(height / minRowsPerThread), 4u});
+    }
 
-    for (y = 0; y < height; y++) {
-        memcpy(nv12Luma + (dstStride * y), yuvLuma + (srcStride * y), width);
+    if (numThreads <= 1) {
+        copyLumaRows(yuvLuma, srcStride, nv12Luma, dstStride, width, 0, height);
+        if (nv12Chroma) {
+            interleaveChromaRows(yuvCb, yuvCr, srcChromaStride, nv12Chroma, dstStride,
+                                 width, 0, chromaHeight);
+        }
+        return;
     }
 
-    if (nv12Chroma) {
-        for (y = 0; y < (height + 1) / 2; y++) {
-            for (x = 0; x < width; x += 2) {
-                nv12Chroma[(y * dstStride) + x] = yuvCb[(((srcStride + 1) / 2) * y) + (x >> 1)];
-                nv12Chroma[(y * dstStride) + (x + 1)] = yuvCr[(((srcStride + 1) / 2) * y) + (x >> 1)];
-            }
+    // Keep the partition boundaries at even luma rows, so each worker owns
+    // whole chroma rows.
+    const int32_t rowsPerThread = AlignSize<int32_t>((height + numThreads - 1) / numThreads, 2);
+    std::vector<std::thread> workers;
+    for (uint32_t threadNum = 0; threadNum < numThreads; threadNum++) {
+        const int32_t startRow = threadNum * rowsPerThread;
+        const int32_t endRow = std::min<int32_t>(startRow + rowsPerThread, height);
+        if (startRow >= endRow) {
+            break;
         }
+        const int32_t chromaEndRow = (endRow == height) ? chromaHeight : (endRow / 2);
+        workers.emplace_back([=]() {
+            copyLumaRows(yuvLuma, srcStride, nv12Luma, dstStride, width, startRow, endRow);
+            if (nv12Chroma) {
+                interleaveChromaRows(yuvCb, yuvCr, srcChromaStride, nv12Chroma, dstStride,
+                                     width, startRow / 2, chromaEndRow);
+            }
+        });
+    }
+
+    for (auto& worker : workers) {
+        worker.join();
     }
 };
 
@@ -296,7 +422,8 @@ StdVideoH264PictureParameterSet EncodeApp::getStdVideoH264PictureParameterSet (v
 }
 
 
-IntraFrameInfo::IntraFrameInfo(uint32_t frameCount, uint32_t width, uint32_t height, StdVideoH264SequenceParameterSet sps, StdVideoH264PictureParameterSet pps, bool isIdr)
+IntraFrameInfo::IntraFrameInfo(uint32_t frameCount, uint32_t width, uint32_t height, StdVideoH264SequenceParameterSet sps, StdVideoH264PictureParameterSet pps, bool isIdr,
+                               uint32_t slicesPerFrame)
 {
     const uint32_t MaxPicOrderCntLsb = 1 << (sps.log2_max_pic_order_cnt_lsb_minus4 + 4);
 
@@ -305,24 +432,44 @@ IntraFrameInfo::IntraFrameInfo(uint32_t frameCount, uint32_t width, uint32_t hei
     m_sliceHeaderFlags.adaptive_ref_pic_marking_mode_flag = 0;
     m_sliceHeaderFlags.no_prior_references_available_flag = 0;
 
-    m_sliceHeader.flags = m_sliceHeaderFlags;
-    m_sliceHeader.slice_type = STD_VIDEO_H264_SLICE_TYPE_I;
-    m_sliceHeader.idr_pic_id = 0;
-    m_sliceHeader.num_ref_idx_l0_active_minus1 = 0;
-    m_sliceHeader.num_ref_idx_l1_active_minus1 = 0;
-    m_sliceHeader.cabac_init_idc = (StdVideoH264CabacInitIdc)0;
-    m_sliceHeader.disable_deblocking_filter_idc = (StdVideoH264DisableDeblockingFilterIdc)0;
-    m_sliceHeader.slice_alpha_c0_offset_div2 = 0;
-    m_sliceHeader.slice_beta_offset_div2 = 0;
-
     uint32_t picWidthInMbs = sps.pic_width_in_mbs_minus1 + 1;
     uint32_t picHeightInMbs = sps.pic_height_in_map_units_minus1 + 1;
-    uint32_t iPicSizeInMbs = picWidthInMbs * picHeightInMbs;
 
-    m_sliceInfo.sType = VK_STRUCTURE_TYPE_VIDEO_ENCODE_H264_NALU_SLICE_INFO_EXT;
-    m_sliceInfo.pNext = NULL;
-    m_sliceInfo.pSliceHeaderStd = &m_sliceHeader;
-    m_sliceInfo.mbCount = iPicSizeInMbs;
+    uint32_t numSlices = (slicesPerFrame > 0) ? slicesPerFrame : 1;
+    if (numSlices > (uint32_t)MAX_SLICES_PER_FRAME) {
+        numSlices = MAX_SLICES_PER_FRAME;
+    }
+    if (numSlices > picHeightInMbs) {
+        numSlices = picHeightInMbs; // at least one MB row per slice
+    }
+
+    // The frame is split on MB-row boundaries; the last slice takes the
+    // remaining rows when the height does not divide evenly.
+    const uint32_t rowsPerSlice = (picHeightInMbs + numSlices - 1) / numSlices;
+    uint32_t firstMbRow = 0;
+    for (uint32_t slice = 0; slice < numSlices; slice++) {
+        const uint32_t sliceRows = ((firstMbRow + rowsPerSlice) <= picHeightInMbs) ?
+                rowsPerSlice : (picHeightInMbs - firstMbRow);
+
+        m_sliceHeaders[slice].flags = m_sliceHeaderFlags;
+        m_sliceHeaders[slice].first_mb_in_slice = firstMbRow * picWidthInMbs;
+        m_sliceHeaders[slice].slice_type = STD_VIDEO_H264_SLICE_TYPE_I;
+        m_sliceHeaders[slice].idr_pic_id = 0;
+        m_sliceHeaders[slice].num_ref_idx_l0_active_minus1 = 0;
+        m_sliceHeaders[slice].num_ref_idx_l1_active_minus1 = 0;
+        m_sliceHeaders[slice].cabac_init_idc = (StdVideoH264CabacInitIdc)0;
+        m_sliceHeaders[slice].disable_deblocking_filter_idc = (StdVideoH264DisableDeblockingFilterIdc)0;
+        m_sliceHeaders[slice].slice_alpha_c0_offset_div2 = 0;
+        m_sliceHeaders[slice].slice_beta_offset_div2 = 0;
+
+        m_sliceInfos[slice].sType = VK_STRUCTURE_TYPE_VIDEO_ENCODE_H264_NALU_SLICE_INFO_EXT;
+        m_sliceInfos[slice].pNext = NULL;
+        m_sliceInfos[slice].pSliceHeaderStd = &m_sliceHeaders[slice];
+        m_sliceInfos[slice].mbCount = sliceRows * picWidthInMbs;
+
+        firstMbRow += sliceRows;
+    }
+    assert(firstMbRow == picHeightInMbs);
 
     if (isIdr) {
         m_pictureInfoFlags.idr_flag = 1;
@@ -344,8 +491,8 @@ IntraFrameInfo::IntraFrameInfo(uint32_t frameCount, uint32_t width, uint32_t hei
 
     m_encodeH264FrameInfo.sType = VK_STRUCTURE_TYPE_VIDEO_ENCODE_H264_VCL_FRAME_INFO_EXT;
     m_encodeH264FrameInfo.pNext = NULL;
-    m_encodeH264FrameInfo.naluSliceEntryCount = 1;
-    m_encodeH264FrameInfo.pNaluSliceEntries = &m_sliceInfo;
+    m_encodeH264FrameInfo.naluSliceEntryCount = numSlices;
+    m_encodeH264FrameInfo.pNaluSliceEntries = m_sliceInfos;
     m_encodeH264FrameInfo.pCurrentPictureInfo = &m_stdPictureInfo;
 }
 
@@ -372,18 +519,18 @@ VideoSessionParametersInfo::VideoSessionParametersInfo(VkVideoSessionKHR videoSe
     m_encodeSessionParametersCreateInfo.videoSession = m_videoSession;
 }
 
-int32_t EncodeApp::selectNvidiaGPU(std::vector<uint32_t> compatibleDevices, nvvk::ContextCreateInfo ctxInfo, uint32_t deviceID = 0)
+int32_t EncodeApp::selectNvidiaGPU(nvvk::Context& ctx, std::vector<uint32_t> compatibleDevices, nvvk::ContextCreateInfo ctxInfo, uint32_t deviceID = 0)
 {
     uint32_t nbElems;
     std::vector<VkPhysicalDeviceGroupProperties> groups;
     std::vector<VkPhysicalDevice>                physicalDevices;
 
     if(ctxInfo.useDeviceGroups) {
-        groups  = m_ctx.getPhysicalDeviceGroups();
+        groups  = ctx.getPhysicalDeviceGroups();
         nbElems = static_cast<uint32_t>(groups.size());
     }
     else {
-        physicalDevices = m_ctx.getPhysicalDevices();
+        physicalDevices = ctx.getPhysicalDevices();
         nbElems         = static_cast<uint32_t>(physicalDevices.size());
     }
 
@@ -405,10 +552,8 @@ int32_t EncodeApp::selectNvidiaGPU(std::vector<uint32_t> compatibleDevices, nvvk
     return -1;
 }
 
-int32_t EncodeApp::initEncoder(EncodeConfig* encodeConfig)
+nvvk::Context* EncodeApp::createContext(EncodeConfig* encodeConfig, uint32_t numSessions)
 {
-    VkResult result = VK_SUCCESS;
-
     nvvk::ContextCreateInfo ctxInfo;
     // Add all the required device extensions
     ctxInfo.addDeviceExtension(VK_EXT_YCBCR_2PLANE_444_FORMATS_EXTENSION_NAME, false);
@@ -418,39 +563,103 @@ int32_t EncodeApp::initEncoder(EncodeConfig* encodeConfig)
     ctxInfo.addDeviceExtension(VK_EXT_VIDEO_ENCODE_H264_EXTENSION_NAME, false);
     ctxInfo.removeInstanceLayer("VK_LAYER_KHRONOS_validation"); // may need to disable validation layers
 
-    ctxInfo.addRequestedQueue(VK_QUEUE_VIDEO_ENCODE_BIT_KHR, 1, 1.0f);
+    // One encode queue instance per session, so concurrent sessions are
+    // distributed across the device's encode queues.
+    ctxInfo.addRequestedQueue(VK_QUEUE_VIDEO_ENCODE_BIT_KHR, numSessions, 1.0f);
+    if (encodeConfig->enableGpuConversion) {
+        // dedicated queues for the input conversion compute stage
+        ctxInfo.addRequestedQueue(VK_QUEUE_COMPUTE_BIT, numSessions, 1.0f);
+    }
+
+    nvvk::Context* ctx = new nvvk::Context();
+
     // Checks required/available vulkan version
     // Checks available instance layers and extensions
     // Checks used instance layers and extensions
     // Creates vulkan instance
-    m_ctx.initInstance(ctxInfo);
+    ctx->initInstance(ctxInfo);
 
     // Find all physical devices compatible with the mandatory extensions
     // Look for devices that support vulkan video
-    std::vector<uint32_t> compatibleDevices = m_ctx.getCompatibleDevices(ctxInfo);
+    std::vector<uint32_t> compatibleDevices = ctx->getCompatibleDevices(ctxInfo);
 
     // Check if at least one compatible physical device is available
     if(compatibleDevices.empty()) {
         fprintf(stderr, "\nInitEncoder Error: Failed to find any compatible devices.\n");
-        return -1;
+        delete ctx;
+        return NULL;
     }
 
     // From the detected compatible devices pick the first Nvidia one (if available)
-    uint32_t nvidiaCompatibleDevice = selectNvidiaGPU(compatibleDevices, ctxInfo);
+    int32_t nvidiaCompatibleDevice = selectNvidiaGPU(*ctx, compatibleDevices, ctxInfo);
     if(nvidiaCompatibleDevice < 0) {
         fprintf(stderr, "\nInitEncoder Error: Failed to find an Nvidia compatible device.\n");
-        return -1;
+        delete ctx;
+        return NULL;
     }
 
     // Init selected Nvidia device
-    m_ctx.initDevice(nvidiaCompatibleDevice, ctxInfo);
+    ctx->initDevice(nvidiaCompatibleDevice, ctxInfo);
+
+    return ctx;
+}
+
+int32_t EncodeApp::initEncoder(EncodeConfig* encodeConfig, nvvk::Context* sharedCtx)
+{
+    VkResult result = VK_SUCCESS;
+
+    if (sharedCtx != NULL) {
+        m_pCtx = sharedCtx;
+        m_ownsCtx = false;
+    } else {
+        m_pCtx = createContext(encodeConfig, 1);
+        if (m_pCtx == NULL) {
+            return -1;
+        }
+        m_ownsCtx = true;
+    }
 
     // Create queue for video encoding
-    m_queue = m_ctx.createQueue(VK_QUEUE_VIDEO_ENCODE_BIT_KHR, "q_encode", 1.0f);
+    m_queue = m_pCtx->createQueue(VK_QUEUE_VIDEO_ENCODE_BIT_KHR, "q_encode", 1.0f);
+    if (m_queue.queue == VK_NULL_HANDLE) {
+        // More sessions than dedicated encode queue instances: share the
+        // family's first queue. The sessions are driven from one thread, so
+        // no extra queue synchronization is needed.
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(m_pCtx->m_physicalDevice, &queueFamilyCount, NULL);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(m_pCtx->m_physicalDevice, &queueFamilyCount, queueFamilies.data());
+        for (uint32_t familyIndex = 0; familyIndex < queueFamilyCount; familyIndex++) {
+            if (queueFamilies[familyIndex].queueFlags & VK_QUEUE_VIDEO_ENCODE_BIT_KHR) {
+                m_queue.familyIndex = familyIndex;
+                m_queue.queueIndex = 0;
+                vkGetDeviceQueue(m_pCtx->m_device, familyIndex, 0, &m_queue.queue);
+                break;
+            }
+        }
+        if (m_queue.queue == VK_NULL_HANDLE) {
+            fprintf(stderr, "\nInitEncoder Error: Failed to get a video encode queue.\n");
+            return -1;
+        }
+    }
+
+    if (encodeConfig->benchmark && encodeConfig->enableGpuConversion) {
+        // The benchmark ring is pre-generated directly in the staging buffers,
+        // so there is no per-frame conversion to offload.
+        encodeConfig->enableGpuConversion = false;
+    }
+
+    if (encodeConfig->enableGpuConversion) {
+        m_queueCompute = m_pCtx->createQueue(VK_QUEUE_COMPUTE_BIT, "q_compute", 1.0f);
+        if (m_queueCompute.queue == VK_NULL_HANDLE) {
+            fprintf(stderr, "\nInitEncoder Warning: No compute queue is available - falling back to CPU input conversion.\n");
+            encodeConfig->enableGpuConversion = false;
+        }
+    }
 
     // Command Buffer Pool Generator
 
-    m_cmdPoolVideoEncode.init(m_ctx.m_device, m_queue.familyIndex,
+    m_cmdPoolVideoEncode.init(m_pCtx->m_device, m_queue.familyIndex,
                               VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT |
                               VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);  // Flags: to use command buffer for several recordings
 
@@ -467,13 +676,13 @@ int32_t EncodeApp::initEncoder(EncodeConfig* encodeConfig)
     uint32_t formatCountIn = sizeof(supportedInputFormats) / sizeof(supportedInputFormats[0]);
     uint32_t formatCountRecon = sizeof(supportedReconstructedPicturesFormats) / sizeof(supportedReconstructedPicturesFormats[0]);
 
-    result = getVideoFormats(m_ctx.m_physicalDevice, &m_videoProfile, (VK_IMAGE_USAGE_VIDEO_ENCODE_SRC_BIT_KHR), formatCountIn, supportedInputFormats);
+    result = getVideoFormats(m_pCtx->m_physicalDevice, &m_videoProfile, (VK_IMAGE_USAGE_VIDEO_ENCODE_SRC_BIT_KHR), formatCountIn, supportedInputFormats);
     if(result != VK_SUCCESS) {
         fprintf(stderr, "\nInitEncoder Error: Failed to get desired video format for input images.\n");
         return -1;
     }
 
-    result = getVideoFormats(m_ctx.m_physicalDevice, &m_videoProfile, (VK_IMAGE_USAGE_VIDEO_ENCODE_DPB_BIT_KHR), formatCountRecon, supportedReconstructedPicturesFormats);
+    result = getVideoFormats(m_pCtx->m_physicalDevice, &m_videoProfile, (VK_IMAGE_USAGE_VIDEO_ENCODE_DPB_BIT_KHR), formatCountRecon, supportedReconstructedPicturesFormats);
     if(result != VK_SUCCESS) {
         fprintf(stderr, "\nInitEncoder Error: Failed to get desired video format for the decoded picture buffer.\n");
         return -1;
@@ -486,7 +695,7 @@ int32_t EncodeApp::initEncoder(EncodeConfig* encodeConfig)
     videoCapabilities.pNext = &videoEncodeCapabilities;
     videoEncodeCapabilities.pNext = &h264Capabilities;
 
-    result = getVideoCapabilities(m_ctx.m_physicalDevice, &m_videoProfile, &videoCapabilities);
+    result = getVideoCapabilities(m_pCtx->m_physicalDevice, &m_videoProfile, &videoCapabilities);
     if(result != VK_SUCCESS) {
         fprintf(stderr, "\nInitEncoder Error: Failed to get desired video capabilities.\n");
         return -1;
@@ -501,13 +710,13 @@ int32_t EncodeApp::initEncoder(EncodeConfig* encodeConfig)
     }
 
     // create and initialize device allocator
-    m_devAlloc.init(m_ctx.m_device, m_ctx.m_physicalDevice);
+    m_devAlloc.init(m_pCtx->m_device, m_pCtx->m_physicalDevice);
     m_maxCodedExtent = { encodeConfig->width, encodeConfig->height }; // codedSize
     m_maxReferencePicturesSlotsCount = DECODED_PICTURE_BUFFER_SIZE;
 
     // start video coding session
     result = NvVideoSession::create(&m_devAlloc,
-                                    &m_ctx,
+                                    m_pCtx,
                                     m_queue.familyIndex,
                                     &m_videoProfile,
                                     m_imageFormat,
@@ -523,9 +732,21 @@ int32_t EncodeApp::initEncoder(EncodeConfig* encodeConfig)
 
     m_inputNumFrames = INPUT_FRAME_BUFFER_SIZE;
     m_dpbNumFrames = DECODED_PICTURE_BUFFER_SIZE;
-    m_resAlloc.init(m_ctx.m_device, m_ctx.m_physicalDevice);
+    m_resAlloc.init(m_pCtx->m_device, m_pCtx->m_physicalDevice);
+
+    // The compute conversion stage writes the input images through per-plane
+    // storage views, which needs extra usage and create flags on the images.
+    VkImageUsageFlags inputImageUsage = VK_IMAGE_USAGE_VIDEO_ENCODE_SRC_BIT_KHR;
+    VkImageCreateFlags inputImageCreateFlags = 0;
+    int32_t computeQueueFamilyIndex = -1;
+    if (encodeConfig->enableGpuConversion) {
+        inputImageUsage |= VK_IMAGE_USAGE_STORAGE_BIT;
+        inputImageCreateFlags = VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+        computeQueueFamilyIndex = (int32_t)m_queueCompute.familyIndex;
+    }
+
     // init input frame pool
-    m_pictureBuffer.initFramePool(  &m_ctx,
+    m_pictureBuffer.initFramePool(  m_pCtx,
                                     m_videoProfile.GetProfile(),  // query pool is done here
                                     m_inputNumFrames,
                                     m_imageFormat,
@@ -533,14 +754,16 @@ int32_t EncodeApp::initEncoder(EncodeConfig* encodeConfig)
                                     encodeConfig->alignedHeight,
                                     encodeConfig->fullImageSize,
                                     VK_IMAGE_TILING_OPTIMAL,
-                                    VK_IMAGE_USAGE_VIDEO_ENCODE_SRC_BIT_KHR,
+                                    inputImageUsage,
                                     &m_resAlloc,
                                     &m_cmdPoolVideoEncode,
-                                    m_queue.familyIndex);
-    // init DPB pool
+                                    m_queue.familyIndex,
+                                    inputImageCreateFlags,
+                                    computeQueueFamilyIndex);
+    // init DPB pool - recycles the previous session's images when the
+    // profile, format and extent match (see NvEncoderPicturePool)
     m_pictureBuffer.initReferenceFramePool(m_dpbNumFrames,
-                                           m_imageFormat,
-                                           &m_resAlloc);
+                                           m_imageFormat);
 
     // create SPS and PPS
     m_videoSessionParameters.m_sequenceParameterSet = getStdVideoH264SequenceParameterSet(encodeConfig->width, encodeConfig->height, NULL);
@@ -550,7 +773,7 @@ int32_t EncodeApp::initEncoder(EncodeConfig* encodeConfig)
             &m_videoSessionParameters.m_sequenceParameterSet,
             &m_videoSessionParameters.m_pictureParameterSet);
     VkVideoSessionParametersCreateInfoKHR* encodeSessionParametersCreateInfo = videoSessionParametersInfo.getVideoSessionParametersInfo();
-    result = vkCreateVideoSessionParametersKHR(m_ctx.m_device, encodeSessionParametersCreateInfo, NULL, &m_videoSessionParameters.m_encodeSessionParameters);
+    result = vkCreateVideoSessionParametersKHR(m_pCtx->m_device, encodeSessionParametersCreateInfo, NULL, &m_videoSessionParameters.m_encodeSessionParameters);
     if(result != VK_SUCCESS) {
         fprintf(stderr, "\nEncodeFrame Error: Failed to get create video session parameters.\n");
         return -1;
@@ -568,6 +791,75 @@ int32_t EncodeApp::initEncoder(EncodeConfig* encodeConfig)
 
     m_cmdPoolVideoEncode.submitAndWait(cmdBuf);
 
+    if (encodeConfig->enableGpuConversion) {
+        result = m_gpuFrameConverter.init(m_pCtx, m_queueCompute, m_inputNumFrames,
+                                          encodeConfig->width, encodeConfig->height);
+        for (uint32_t i = 0; (result == VK_SUCCESS) && (i < m_inputNumFrames); i++) {
+            EncodeFrameData* frameData = m_pictureBuffer.getEncodeFrameData(i);
+            result = m_gpuFrameConverter.registerFrameImage(i, m_pictureBuffer.getInputStagingBuffer(),
+                                                            m_pictureBuffer.getInputStagingSlotOffset(i),
+                                                            m_pictureBuffer.getInputStagingSlotSize(),
+                                                            frameData->m_picture.m_image.image,
+                                                            VK_IMAGE_LAYOUT_VIDEO_ENCODE_SRC_KHR);
+        }
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nInitEncoder Warning: GPU input conversion setup failed - falling back to CPU input conversion.\n");
+            m_gpuFrameConverter.deinit();
+            encodeConfig->enableGpuConversion = false;
+        }
+    }
+
+    if (encodeConfig->enableAsyncOutput) {
+        m_bitstreamWriter.init(encodeConfig->outputVid, INPUT_FRAME_BUFFER_SIZE);
+    }
+
+    if ((encodeConfig->lookAheadDepth > 0) && !encodeConfig->benchmark) {
+        // Prefetch and pre-convert the upcoming input frames on worker
+        // threads while the GPU encodes; loadFrame then only copies each
+        // prepared frame into its slot's staging buffer (see
+        // NvLookAheadQueue). The prepared size depends on the input path:
+        // the raw planar frame for the GPU conversion, the aligned NV12
+        // layout for the CPU conversion.
+        m_lookAheadFrameSize = m_gpuFrameConverter.isEnabled()
+                ? (((size_t)encodeConfig->width * encodeConfig->height) +
+                   (2 * (size_t)(((encodeConfig->width + 1) / 2) * ((encodeConfig->height + 1) / 2))))
+                : encodeConfig->fullImageSize;
+        m_lookAheadQueue.init(encodeConfig->lookAheadDepth, 2, m_lookAheadFrameSize,
+                              0, encodeConfig->numFrames,
+                              [this, encodeConfig](uint32_t frameIndex, uint8_t* dst) {
+                                  size_t preparedSize = 0;
+                                  return prepareInputFrame(encodeConfig, frameIndex, dst, preparedSize);
+                              });
+    }
+
+    if (encodeConfig->benchmark) {
+        // Pre-generate one synthetic frame per ring slot, so the measured loop
+        // contains no file reads and no format conversion - just the staging
+        // buffer copy, the encode and the bitstream readback.
+        for (uint32_t i = 0; i < m_inputNumFrames; i++) {
+            uint8_t* stagingBuffer = m_pictureBuffer.getInputStagingSlotMappedData(i);
+            generateBenchmarkFrameNV12(stagingBuffer, stagingBuffer + encodeConfig->lumaPlaneSize,
+                                       encodeConfig->width, encodeConfig->height,
+                                       encodeConfig->alignedWidth, i);
+            m_pictureBuffer.flushInputStagingSlotMappedData(i);
+        }
+
+        // Per-frame GPU time comes from a pair of timestamps around each
+        // encode command buffer.
+        VkPhysicalDeviceProperties deviceProperties;
+        vkGetPhysicalDeviceProperties(m_pCtx->m_physicalDevice, &deviceProperties);
+        m_timestampPeriod = deviceProperties.limits.timestampPeriod;
+
+        VkQueryPoolCreateInfo timestampPoolInfo = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        timestampPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        timestampPoolInfo.queryCount = 2 * INPUT_FRAME_BUFFER_SIZE;
+        result = vkCreateQueryPool(m_pCtx->m_device, &timestampPoolInfo, NULL, &m_gpuTimeQueryPool);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nInitEncoder Warning: Failed to create the timestamp query pool - no GPU frame times will be reported.\n");
+            m_gpuTimeQueryPool = VK_NULL_HANDLE;
+        }
+    }
+
     return 0;
 }
 
@@ -615,23 +907,66 @@ int32_t EncodeApp::initRateControl(VkCommandBuffer cmdBuf, uint32_t qp)
 // 3. copy nv12 input image to the correct input vkimage slot (staging buffer)
 int32_t EncodeApp::loadFrame(EncodeConfig* encodeConfig, uint32_t frameCount, uint32_t currentFrameBufferIdx)
 {
-    EncodeFrameData* currentEncodeFrameData = m_pictureBuffer.getEncodeFrameData(currentFrameBufferIdx);
-    VkImage inputImage = currentEncodeFrameData->m_picture.m_image.image;
-    nvvk::Buffer inputStagingBuffer = currentEncodeFrameData->m_inputStagingBuffer;
-    VkCommandBuffer cmdBuf = currentEncodeFrameData->m_cmdBufVideoEncode;
-    // map Vkbuffer to uint8_t pointer so the input image can be copied (Host visible)
-    uint8_t* stagingBuffer = reinterpret_cast<uint8_t*>(m_resAlloc.map(inputStagingBuffer));
-    uint8_t* currentFrame[2];
-    currentFrame[0] = stagingBuffer;
-    currentFrame[1] = currentFrame[0] + encodeConfig->lumaPlaneSize;
-
-    // Load current frame from file and convert to NV12
-    loadCurrentFrame(currentFrame, encodeConfig->inputVideoMmap, frameCount,
-                     encodeConfig->width, encodeConfig->height,
-                     encodeConfig->width, encodeConfig->alignedWidth,
-                     encodeConfig->inputVkFormat);
-
-    m_resAlloc.unmap(inputStagingBuffer);
+    if (encodeConfig->benchmark) {
+        // The staging ring was pre-filled with synthetic frames in
+        // initEncoder; the benchmark loop re-encodes it without any file I/O.
+        return 0;
+    }
+
+    // The upload ring stays persistently mapped, so the slot's segment is
+    // written through the mapping directly - no per-frame map/unmap (see
+    // NvPictureBuffer::getInputStagingSlotMappedData()).
+    uint8_t* stagingBuffer = m_pictureBuffer.getInputStagingSlotMappedData(currentFrameBufferIdx);
+
+    int32_t loadResult = 0;
+    if (m_lookAheadQueue.isEnabled()) {
+        // The look-ahead workers have already prefetched and converted this
+        // frame - all that is left is the copy into the slot's staging
+        // buffer.
+        const uint8_t* preparedFrame = m_lookAheadQueue.acquireFrame(frameCount);
+        memcpy(stagingBuffer, preparedFrame, m_lookAheadFrameSize);
+        m_lookAheadQueue.releaseFrame(frameCount);
+    } else {
+        size_t preparedSize = 0;
+        loadResult = prepareInputFrame(encodeConfig, frameCount, stagingBuffer, preparedSize);
+    }
+
+    m_pictureBuffer.flushInputStagingSlotMappedData(currentFrameBufferIdx);
+    return loadResult;
+}
+
+int32_t EncodeApp::prepareInputFrame(EncodeConfig* encodeConfig, uint32_t frameCount, uint8_t* dst,
+                                     size_t& preparedSize)
+{
+    if (m_gpuFrameConverter.isEnabled()) {
+        // GPU conversion path: copy the raw planar frame as-is; the compute
+        // shader interleaves the planes into the input image, so the CPU
+        // never touches the individual planes.
+        const uint32_t chromaPlaneSize = ((encodeConfig->width + 1) / 2) * ((encodeConfig->height + 1) / 2);
+        const size_t frameSize = ((size_t)encodeConfig->width * encodeConfig->height) + (2 * (size_t)chromaPlaneSize);
+        const size_t fileOffset = frameSize * frameCount;
+        assert(encodeConfig->inputVideoMmap.is_mapped());
+        if (encodeConfig->inputVideoMmap.mapped_length() < (fileOffset + frameSize)) {
+            printf("File overflow at frameIndex %d, width %d, height %d, frameSize %d\n",
+                   frameCount, encodeConfig->width, encodeConfig->height, (uint32_t)frameSize);
+            assert(0);
+            return -1;
+        }
+        memcpy(dst, encodeConfig->inputVideoMmap.data() + fileOffset, frameSize);
+        preparedSize = frameSize;
+    } else {
+        uint8_t* currentFrame[2];
+        currentFrame[0] = dst;
+        currentFrame[1] = currentFrame[0] + encodeConfig->lumaPlaneSize;
+
+        // Load current frame from file and convert to NV12
+        loadCurrentFrame(currentFrame, encodeConfig->inputVideoMmap, frameCount,
+                         encodeConfig->width, encodeConfig->height,
+                         encodeConfig->width, encodeConfig->alignedWidth,
+                         encodeConfig->inputVkFormat);
+        preparedSize = encodeConfig->fullImageSize;
+    }
+
     return 0;
 }
 
@@ -654,7 +989,9 @@ int32_t EncodeApp::encodeFrame(EncodeConfig* encodeConfig, uint32_t frameCount,
     m_pictureBuffer.addRefPic(currentFrameBufferIdx, currentFrameBufferIdx, frameCount);
 
     EncodeFrameData* currentEncodeFrameData = m_pictureBuffer.getEncodeFrameData(currentFrameBufferIdx);
-    VkBuffer outBitstream = currentEncodeFrameData->m_outBitstreamBuffer.buffer;
+    VkBuffer outBitstream = m_pictureBuffer.getOutBitstreamBuffer();
+    // This slot's segment of the shared output bitstream buffer.
+    VkDeviceSize bitstreamSlotOffset = m_pictureBuffer.getOutBitstreamSlotOffset(currentFrameBufferIdx);
     VkCommandBuffer cmdBuf = currentEncodeFrameData->m_cmdBufVideoEncode;
 
     // Begin command buffer
@@ -662,7 +999,25 @@ int32_t EncodeApp::encodeFrame(EncodeConfig* encodeConfig, uint32_t frameCount,
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
     vkBeginCommandBuffer(cmdBuf, &beginInfo);
 
-    m_pictureBuffer.copyToVkImage(currentFrameBufferIdx, 0, cmdBuf);
+    if (m_gpuTimeQueryPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(cmdBuf, m_gpuTimeQueryPool, currentFrameBufferIdx * 2, 2);
+        vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_gpuTimeQueryPool, currentFrameBufferIdx * 2);
+    }
+
+    if (m_gpuFrameConverter.isEnabled()) {
+        // Convert the staged planes into the input image on the compute queue.
+        // The encode batch submit waits on the producer semaphore instead of a
+        // buffer-to-image copy in this command buffer.
+        result = m_gpuFrameConverter.submitConvert(currentFrameBufferIdx,
+                                                   currentEncodeFrameData->m_frameProducerDoneSemaphore);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nEncodeFrame Error: Failed to submit the GPU input conversion.\n");
+            return -1;
+        }
+        currentEncodeFrameData->m_gpuConvertPending = true;
+    } else {
+        m_pictureBuffer.copyToVkImage(currentFrameBufferIdx, 0, cmdBuf);
+    }
 
     // Begin video coding
 
@@ -686,7 +1041,7 @@ int32_t EncodeApp::encodeFrame(EncodeConfig* encodeConfig, uint32_t frameCount,
         // Encode Non VCL data - SPS and PPS
         EncodeInfoNonVcl encodeInfoNonVcl(&m_videoSessionParameters.m_sequenceParameterSet,
                                           &m_videoSessionParameters.m_pictureParameterSet,
-                                          &outBitstream);
+                                          &outBitstream, bitstreamSlotOffset);
         VkVideoEncodeInfoKHR* videoEncodeInfoNonVcl = encodeInfoNonVcl.getVideoEncodeInfo();
         vkCmdResetQueryPool(cmdBuf, queryPool, querySlotIdNonVCL, 1);
         vkCmdBeginQuery(cmdBuf, queryPool, querySlotIdNonVCL, VkQueryControlFlags());
@@ -699,7 +1054,8 @@ int32_t EncodeApp::encodeFrame(EncodeConfig* encodeConfig, uint32_t frameCount,
     IntraFrameInfo intraFrameInfo(frameCount, encodeConfig->width, encodeConfig->height,
                                   m_videoSessionParameters.m_sequenceParameterSet,
                                   m_videoSessionParameters.m_pictureParameterSet,
-                                  frameCount == 0);
+                                  frameCount == 0,
+                                  encodeConfig->slicesPerFrame);
     VkVideoEncodeH264VclFrameInfoEXT* encodeH264FrameInfo = intraFrameInfo.getEncodeH264FrameInfo();
 
     VkVideoPictureResourceInfoKHR inputPicResource = {VK_STRUCTURE_TYPE_VIDEO_PICTURE_RESOURCE_INFO_KHR};
@@ -707,7 +1063,7 @@ int32_t EncodeApp::encodeFrame(EncodeConfig* encodeConfig, uint32_t frameCount,
     m_pictureBuffer.getFrameResourcesByIndex(currentFrameBufferIdx, &inputPicResource);
     m_pictureBuffer.getReferenceFrameResourcesByIndex(currentFrameBufferIdx, &dpbPicResource);
 
-    EncodeInfoVcl encodeInfoVcl(&outBitstream, bitstreamOffset, encodeH264FrameInfo, &inputPicResource, &dpbPicResource);
+    EncodeInfoVcl encodeInfoVcl(&outBitstream, bitstreamSlotOffset + bitstreamOffset, encodeH264FrameInfo, &inputPicResource, &dpbPicResource);
     VkVideoEncodeInfoKHR* videoEncodeInfoVcl = encodeInfoVcl.getVideoEncodeInfo();
 
     vkCmdResetQueryPool(cmdBuf, queryPool, querySlotIdVCL, 1);
@@ -717,6 +1073,11 @@ int32_t EncodeApp::encodeFrame(EncodeConfig* encodeConfig, uint32_t frameCount,
 
     VkVideoEndCodingInfoKHR encodeEndInfo = {VK_STRUCTURE_TYPE_VIDEO_END_CODING_INFO_KHR};
     vkCmdEndVideoCodingKHR(cmdBuf, &encodeEndInfo);
+
+    if (m_gpuTimeQueryPool != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_gpuTimeQueryPool, (currentFrameBufferIdx * 2) + 1);
+    }
+
     vkEndCommandBuffer(cmdBuf);
 
     // reset ref pic
@@ -730,37 +1091,87 @@ int32_t EncodeApp::batchSubmit(uint32_t firstFrameBufferIdx, uint32_t framesInBa
     if (!(framesInBatch > 0)) {
         return 0;
     }
-    const uint32_t maxFramesInBatch = 8;
-    assert(framesInBatch <= maxFramesInBatch);
-    VkCommandBuffer cmdBuf[maxFramesInBatch];
-
+    // Each frame is submitted with its own per-slot completion fence, so the
+    // readback side can wait on exactly the frame it wants to assemble while
+    // later frames keep uploading and encoding.
     for(uint32_t cmdBufIdx = 0; cmdBufIdx < framesInBatch; cmdBufIdx++) {
         EncodeFrameData* currentEncodeFrameData = m_pictureBuffer.getEncodeFrameData(firstFrameBufferIdx + cmdBufIdx);
-        cmdBuf[cmdBufIdx] = currentEncodeFrameData->m_cmdBufVideoEncode;
+
+        // The slot's query is reset inside this command buffer - drop any
+        // stale cached result for it and grow the batched poll range to
+        // cover the slot.
+        m_vclQueryResults[firstFrameBufferIdx + cmdBufIdx].available = 0;
+        if ((firstFrameBufferIdx + cmdBufIdx + 1) > m_vclQueryBatchSize) {
+            m_vclQueryBatchSize = firstFrameBufferIdx + cmdBufIdx + 1;
+        }
+
+        VkSemaphore waitSemaphore = VK_NULL_HANDLE;
+        VkPipelineStageFlags waitStageMask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        if (currentEncodeFrameData->m_gpuConvertPending) {
+            // Wait for the compute queue conversion of this input image.
+            waitSemaphore = currentEncodeFrameData->m_frameProducerDoneSemaphore;
+            currentEncodeFrameData->m_gpuConvertPending = false;
+        }
+
+        VkSubmitInfo submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO, NULL};
+        submitInfo.waitSemaphoreCount = (waitSemaphore != VK_NULL_HANDLE) ? 1 : 0;
+        submitInfo.pWaitSemaphores = (waitSemaphore != VK_NULL_HANDLE) ? &waitSemaphore : NULL;
+        submitInfo.pWaitDstStageMask = (waitSemaphore != VK_NULL_HANDLE) ? &waitStageMask : NULL;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &currentEncodeFrameData->m_cmdBufVideoEncode;
+        submitInfo.signalSemaphoreCount = 0;
+        submitInfo.pSignalSemaphores = NULL;
+
+        vkResetFences(m_pCtx->m_device, 1, &currentEncodeFrameData->m_frameCompleteFence);
+        VkResult result = vkQueueSubmit(m_queue, 1, &submitInfo, currentEncodeFrameData->m_frameCompleteFence);
+        if (result != VK_SUCCESS) {
+            return -1;
+        }
+
         currentEncodeFrameData->m_frameSubmitted = true;
     }
 
-    VkSubmitInfo submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO, NULL};
-    submitInfo.waitSemaphoreCount = 0;
-    submitInfo.pWaitSemaphores = NULL;
-    submitInfo.pWaitDstStageMask = NULL;
-    submitInfo.commandBufferCount = framesInBatch;
-    submitInfo.pCommandBuffers = cmdBuf;
-    submitInfo.signalSemaphoreCount = 0;
-    submitInfo.pSignalSemaphores = NULL;
+    return framesInBatch;
+}
 
-    VkResult result = vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE);
+int32_t EncodeApp::pollVclQueryResults()
+{
+    if (m_vclQueryBatchSize == 0) {
+        return 0;
+    }
 
-    if (result == VK_SUCCESS) {
-        return framesInBatch;
+    // One vkGetQueryPoolResults call covers the VCL queries of every slot
+    // submitted so far. Without WAIT the call returns immediately; slots
+    // whose encodes are still in flight come back with a cleared
+    // availability word and are simply re-polled on the next refresh.
+    VkResult result = vkGetQueryPoolResults(m_pCtx->m_device, m_pictureBuffer.getQueryPool(), 0, m_vclQueryBatchSize,
+                                            m_vclQueryBatchSize * sizeof(nvVideoEncodeStatus), m_vclQueryResults,
+                                            sizeof(nvVideoEncodeStatus),
+                                            VK_QUERY_RESULT_WITH_STATUS_BIT_KHR | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if ((result != VK_SUCCESS) && (result != VK_NOT_READY)) {
+        fprintf(stderr, "\nRetrieveData Error: Failed to poll the batched vcl query results.\n");
+        return -1;
     }
 
-    return -1;
+    // An available result is only trusted once the slot's command buffer has
+    // fully retired: between a resubmit and the GPU executing the slot's
+    // query reset, the query still reports the previous frame's result as
+    // available.
+    for (uint32_t slotIdx = 0; slotIdx < m_vclQueryBatchSize; slotIdx++) {
+        if (m_vclQueryResults[slotIdx].available &&
+                (vkGetFenceStatus(m_pCtx->m_device,
+                                  m_pictureBuffer.getEncodeFrameData(slotIdx)->m_frameCompleteFence) != VK_SUCCESS)) {
+            m_vclQueryResults[slotIdx].available = 0;
+        }
+    }
+
+    return 0;
 }
 
 // 11. gather results
 // 12. write results to file
-int32_t EncodeApp::assembleBitstreamData(EncodeConfig* encodeConfig, bool nonVcl, uint32_t currentFrameBufferIdx)
+int32_t EncodeApp::assembleBitstreamData(EncodeConfig* encodeConfig, bool nonVcl, uint32_t currentFrameBufferIdx,
+                                         bool waitForResults)
 {
     VkResult result = VK_SUCCESS;
 
@@ -769,18 +1180,47 @@ int32_t EncodeApp::assembleBitstreamData(EncodeConfig* encodeConfig, bool nonVcl
         return 0;
     }
 
-    nvvk::Buffer outBitstreamBuffer = currentEncodeFrameData->m_outBitstreamBuffer;
+    if (!waitForResults) {
+        // Poll instead of blocking: consult the batched VCL query result
+        // cache, refreshing it with a single driver call covering every
+        // slot when this slot's entry is not available yet, and check that
+        // the command buffer has fully retired, so the caller can keep
+        // submitting other frames.
+        if (!m_vclQueryResults[currentFrameBufferIdx].available) {
+            if (pollVclQueryResults() != 0) {
+                return -1;
+            }
+            if (!m_vclQueryResults[currentFrameBufferIdx].available) {
+                return 1;
+            }
+        }
+        if (vkGetFenceStatus(m_pCtx->m_device, currentEncodeFrameData->m_frameCompleteFence) == VK_NOT_READY) {
+            // Results are available but the slot's command buffer is still
+            // executing; the slot cannot be recycled yet.
+            return 1;
+        }
+    } else {
+        // Wait for this frame's own completion fence, so only the slot being
+        // assembled gates the readback while later submissions keep encoding.
+        result = vkWaitForFences(m_pCtx->m_device, 1, &currentEncodeFrameData->m_frameCompleteFence, VK_TRUE, UINT64_MAX);
+        if (result != VK_SUCCESS) {
+            fprintf(stderr, "\nRetrieveData Error: Failed to wait for the frame complete fence.\n");
+            return -1;
+        }
+    }
 
     // get output results
-    struct nvVideoEncodeStatus {
-        uint32_t bitstreamStartOffset;
-        uint32_t bitstreamSize;
-        VkQueryResultStatusKHR status;
-    };
     nvVideoEncodeStatus encodeResult[2]; // 2nd slot is non vcl data
     memset(&encodeResult, 0, sizeof(encodeResult));
 
-    int8_t* data = reinterpret_cast<int8_t*>(m_resAlloc.map(outBitstreamBuffer));
+    // This slot's segment of the persistently mapped shared readback
+    // buffer; no per-frame map/unmap.
+    int8_t* data = m_pictureBuffer.getOutBitstreamSlotMappedData(currentFrameBufferIdx);
+    result = m_pictureBuffer.invalidateOutBitstreamSlotMappedData(currentFrameBufferIdx);
+    if (result != VK_SUCCESS) {
+        fprintf(stderr, "\nRetrieveData Error: Failed to invalidate the mapped bitstream data.\n");
+        return -1;
+    }
 
     VkQueryPool queryPool = m_pictureBuffer.getQueryPool();
 
@@ -789,25 +1229,50 @@ int32_t EncodeApp::assembleBitstreamData(EncodeConfig* encodeConfig, bool nonVcl
         // only on frame 0
         bitstreamOffset = NON_VCL_BITSTREAM_OFFSET;
         uint32_t querySlotIdNonVCL = currentFrameBufferIdx + INPUT_FRAME_BUFFER_SIZE;
-        result = vkGetQueryPoolResults(m_ctx.m_device, queryPool, querySlotIdNonVCL, 1, sizeof(nvVideoEncodeStatus),
+        result = vkGetQueryPoolResults(m_pCtx->m_device, queryPool, querySlotIdNonVCL, 1, sizeof(nvVideoEncodeStatus),
                                        &encodeResult[1], sizeof(nvVideoEncodeStatus), VK_QUERY_RESULT_WITH_STATUS_BIT_KHR | VK_QUERY_RESULT_WAIT_BIT);
         if(result != VK_SUCCESS) {
             fprintf(stderr, "\nRetrieveData Error: Failed to get non vcl query pool results.\n");
             return -1;
         }
-        fwrite(data + encodeResult[1].bitstreamStartOffset, 1, encodeResult[1].bitstreamSize, encodeConfig->outputVid);
+        if (m_bitstreamWriter.isEnabled()) {
+            m_bitstreamWriter.write(data + encodeResult[1].bitstreamStartOffset, encodeResult[1].bitstreamSize);
+        } else {
+            fwrite(data + encodeResult[1].bitstreamStartOffset, 1, encodeResult[1].bitstreamSize, encodeConfig->outputVid);
+        }
     }
 
-    uint32_t querySlotIdVCL = currentFrameBufferIdx;
-    result = vkGetQueryPoolResults(m_ctx.m_device, queryPool, querySlotIdVCL, 1, sizeof(nvVideoEncodeStatus),
-                                   &encodeResult[0], sizeof(nvVideoEncodeStatus), VK_QUERY_RESULT_WITH_STATUS_BIT_KHR | VK_QUERY_RESULT_WAIT_BIT);
-    if(result != VK_SUCCESS) {
-        fprintf(stderr, "\nRetrieveData Error: Failed to get vcl query pool results.\n");
-        return -1;
+    if (m_vclQueryResults[currentFrameBufferIdx].available) {
+        // The batched poll already fetched this slot's VCL result; consume
+        // the cached entry instead of issuing another per-frame fetch.
+        encodeResult[0] = m_vclQueryResults[currentFrameBufferIdx];
+        m_vclQueryResults[currentFrameBufferIdx].available = 0;
+    } else {
+        uint32_t querySlotIdVCL = currentFrameBufferIdx;
+        result = vkGetQueryPoolResults(m_pCtx->m_device, queryPool, querySlotIdVCL, 1, sizeof(nvVideoEncodeStatus),
+                                       &encodeResult[0], sizeof(nvVideoEncodeStatus), VK_QUERY_RESULT_WITH_STATUS_BIT_KHR | VK_QUERY_RESULT_WAIT_BIT);
+        if(result != VK_SUCCESS) {
+            fprintf(stderr, "\nRetrieveData Error: Failed to get vcl query pool results.\n");
+            return -1;
+        }
+    }
+    if (m_bitstreamWriter.isEnabled()) {
+        // The writer copies the chunk into a pooled buffer, so the slot's
+        // segment can be reused before the write hits the disk.
+        m_bitstreamWriter.write(data + bitstreamOffset + encodeResult[0].bitstreamStartOffset, encodeResult[0].bitstreamSize);
+    } else {
+        fwrite(data + bitstreamOffset + encodeResult[0].bitstreamStartOffset, 1, encodeResult[0].bitstreamSize, encodeConfig->outputVid);
     }
-    fwrite(data + bitstreamOffset + encodeResult[0].bitstreamStartOffset, 1, encodeResult[0].bitstreamSize, encodeConfig->outputVid);
 
-    m_resAlloc.unmap(outBitstreamBuffer);
+    if (m_gpuTimeQueryPool != VK_NULL_HANDLE) {
+        uint64_t timestamps[2] = {};
+        result = vkGetQueryPoolResults(m_pCtx->m_device, m_gpuTimeQueryPool, currentFrameBufferIdx * 2, 2,
+                                       sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if ((result == VK_SUCCESS) && (timestamps[1] > timestamps[0])) {
+            m_totalGpuTimeNs += (double)(timestamps[1] - timestamps[0]) * m_timestampPeriod;
+            m_gpuTimeFrameCount++;
+        }
+    }
 
     currentEncodeFrameData->m_frameSubmitted = false;
 
@@ -819,7 +1284,17 @@ int32_t EncodeApp::assembleBitstreamData(EncodeConfig* encodeConfig, bool nonVcl
 int32_t EncodeApp::deinitEncoder()
 {
     vkQueueWaitIdle(m_queue);
-    vkDestroyVideoSessionParametersKHR(m_ctx.m_device, m_videoSessionParameters.m_encodeSessionParameters, NULL);
+    if (m_queueCompute.queue != VK_NULL_HANDLE) {
+        vkQueueWaitIdle(m_queueCompute.queue);
+    }
+    m_gpuFrameConverter.deinit();
+    m_lookAheadQueue.deinit(); // stops the input prefetcher threads
+    m_bitstreamWriter.deinit(); // flushes any bitstream chunks still queued
+    if (m_gpuTimeQueryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(m_pCtx->m_device, m_gpuTimeQueryPool, NULL);
+        m_gpuTimeQueryPool = VK_NULL_HANDLE;
+    }
+    vkDestroyVideoSessionParametersKHR(m_pCtx->m_device, m_videoSessionParameters.m_encodeSessionParameters, NULL);
 
     delete m_pVideoSession;
     m_pictureBuffer.deinitReferenceFramePool();
@@ -827,7 +1302,14 @@ int32_t EncodeApp::deinitEncoder()
     m_resAlloc.deinit();
     m_devAlloc.deinit();
     m_cmdPoolVideoEncode.deinit();
-    m_ctx.deinit();
+    if (m_ownsCtx) {
+        // Final teardown of the device: flush the DPB images parked for
+        // session-to-session reuse before it goes away.
+        NvEncoderPicturePool::GetInstance().clear();
+        m_pCtx->deinit();
+        delete m_pCtx;
+    }
+    m_pCtx = NULL;
 
     return 0;
 }
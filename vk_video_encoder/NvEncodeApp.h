@@ -23,6 +23,9 @@
 #include "VkVideoCore/VkVideoCoreProfile.h"
 #include "VkCodecUtils/NvVideoSession.h"
 #include "VkCodecUtils/NvPictureBuffer.h"
+#include "VkCodecUtils/NvGpuFrameConverter.h"
+#include "VkCodecUtils/NvAsyncBitstreamWriter.h"
+#include "VkCodecUtils/NvLookAheadQueue.h"
 
 #include "nvh/fileoperations.hpp"
 #include "nvh/inputparser.h"
@@ -50,31 +53,56 @@ struct EncodeConfig {
     uint32_t fullImageSize;
     uint32_t startFrame;
     uint32_t numFrames;
+    uint32_t numSessions; // concurrent encode sessions sharing one device
+    // Benchmark mode only: when nonzero, the whole encode is repeated for
+    // every session count K in [1, benchmarkSweepMaxSessions] and a scaling
+    // report row is recorded per K (see --benchmarkSweep).
+    uint32_t benchmarkSweepMaxSessions;
+    char benchmarkReportFileName[256]; // CSV scaling report, empty writes to stdout
     uint32_t codecBlockAlignment; // 16 - H264
     uint32_t qp;
+    // Number of NALU slices per coded frame (see IntraFrameInfo); more
+    // slices smooth the per-packet latency of low-latency links at a small
+    // compression cost. 0 or 1 keeps the single-slice frames.
+    uint32_t slicesPerFrame;
+    // Depth of the bounded input look-ahead queue (0 disables): worker
+    // threads prefetch and pre-convert this many upcoming input frames while
+    // the GPU encodes (see NvLookAheadQueue). Ignored in benchmark mode,
+    // which has no input file.
+    uint32_t lookAheadDepth;
     char inFileName[256];
     char outFileName[256];
     uint32_t chromaFormatIDC;
     VkFormat inputVkFormat;
     uint32_t bytepp; // 1 bytepp = 8 bpp
     uint32_t bpp;
-    FILE *inputVid; // YUV file
-    mio::basic_mmap<mio::access_mode::read, uint8_t> inputVideoMmap;
+    mio::basic_mmap<mio::access_mode::read, uint8_t> inputVideoMmap; // memory-mapped YUV input file
     FILE *outputVid; // compressed H264 file
     uint32_t logBatchEncoding : 1;
+    uint32_t enableGpuConversion : 1; // convert the input planes on the compute queue instead of the CPU
+    uint32_t enableAsyncOutput : 1; // write the bitstream from a dedicated writer thread
+    uint32_t benchmark : 1; // encode a pre-generated synthetic frame ring and report encode-only throughput
 };
 
 class IntraFrameInfo {
 public:
-    IntraFrameInfo(uint32_t frameCount, uint32_t width, uint32_t height, StdVideoH264SequenceParameterSet sps, StdVideoH264PictureParameterSet pps, bool isIdr);
+    // Upper bound on the slices of one coded frame; the ctor clamps the
+    // requested count to this and to one MB row per slice.
+    enum { MAX_SLICES_PER_FRAME = 64 };
+
+    IntraFrameInfo(uint32_t frameCount, uint32_t width, uint32_t height, StdVideoH264SequenceParameterSet sps, StdVideoH264PictureParameterSet pps, bool isIdr,
+                   uint32_t slicesPerFrame = 1);
     inline VkVideoEncodeH264VclFrameInfoEXT* getEncodeH264FrameInfo()
     {
         return &m_encodeH264FrameInfo;
     };
 private:
     StdVideoEncodeH264SliceHeaderFlags m_sliceHeaderFlags = {};
-    StdVideoEncodeH264SliceHeader m_sliceHeader = {};
-    VkVideoEncodeH264NaluSliceInfoEXT m_sliceInfo = {};
+    // One header/NALU entry per slice: the frame is split on MB-row
+    // boundaries so each slice can leave the encoder (and the network
+    // stack) before the rest of the frame is coded.
+    StdVideoEncodeH264SliceHeader m_sliceHeaders[MAX_SLICES_PER_FRAME] = {};
+    VkVideoEncodeH264NaluSliceInfoEXT m_sliceInfos[MAX_SLICES_PER_FRAME] = {};
     StdVideoEncodeH264PictureInfoFlags m_pictureInfoFlags = {};
     StdVideoEncodeH264PictureInfo m_stdPictureInfo = {};
     VkVideoEncodeH264VclFrameInfoEXT m_encodeH264FrameInfo = {};
@@ -106,7 +134,8 @@ protected:
 
 class EncodeInfoNonVcl : public EncodeInfo {
 public:
-    EncodeInfoNonVcl(StdVideoH264SequenceParameterSet* sps, StdVideoH264PictureParameterSet* pps, VkBuffer* dstBitstreamBuffer)
+    EncodeInfoNonVcl(StdVideoH264SequenceParameterSet* sps, StdVideoH264PictureParameterSet* pps, VkBuffer* dstBitstreamBuffer,
+                     VkDeviceSize dstBitstreamBufferOffset)
         : m_emitParameters{}
     {
         m_emitParameters.sType = VK_STRUCTURE_TYPE_VIDEO_ENCODE_H264_EMIT_PICTURE_PARAMETERS_INFO_EXT;
@@ -120,6 +149,7 @@ public:
         m_encodeInfo.sType = VK_STRUCTURE_TYPE_VIDEO_ENCODE_INFO_KHR;
         m_encodeInfo.pNext = &m_emitParameters;
         m_encodeInfo.dstBitstreamBuffer = *dstBitstreamBuffer;
+        m_encodeInfo.dstBitstreamBufferOffset = dstBitstreamBufferOffset;
     }
 private:
     VkVideoEncodeH264EmitPictureParametersInfoEXT m_emitParameters;
@@ -156,10 +186,22 @@ public:
     VkVideoSessionParametersKHR m_encodeSessionParameters;
 };
 
+// Layout of one VK_QUERY_TYPE_VIDEO_ENCODE_BITSTREAM_BUFFER_RANGE_KHR result
+// fetched with both WITH_STATUS and WITH_AVAILABILITY: the availability word
+// trails the status. bitstreamStartOffset is relative to the frame's
+// dstBitstreamBufferOffset.
+struct nvVideoEncodeStatus {
+    uint32_t bitstreamStartOffset;
+    uint32_t bitstreamSize;
+    VkQueryResultStatusKHR status;
+    uint32_t available;
+};
+
 class EncodeApp {
 public:
     EncodeApp()
-        : m_ctx()
+        : m_pCtx(NULL)
+        , m_ownsCtx(false)
         , m_cmdPoolVideoEncode()
         , m_videoProfile()
         , m_pVideoSession(NULL)
@@ -171,17 +213,52 @@ public:
         , m_devAlloc()
         , m_resAlloc()
         , m_pictureBuffer()
+        , m_gpuFrameConverter()
+        , m_gpuTimeQueryPool()
+        , m_timestampPeriod(0.0f)
+        , m_totalGpuTimeNs(0.0)
+        , m_gpuTimeFrameCount(0)
+        , m_bitstreamWriter()
+        , m_lookAheadQueue()
+        , m_lookAheadFrameSize(0)
+        , m_vclQueryResults{}
+        , m_vclQueryBatchSize(0)
     {
     };
-    int32_t initEncoder(EncodeConfig* encodeConfig);
+    // Creates the Vulkan instance and device shared by numSessions encode
+    // sessions, with one video encode (and compute, when GPU conversion is
+    // enabled) queue instance requested per session. Returns NULL on failure.
+    static nvvk::Context* createContext(EncodeConfig* encodeConfig, uint32_t numSessions);
+
+    // When sharedCtx is NULL the encoder creates and owns its own context;
+    // otherwise the caller-owned context is used and each session picks up
+    // its own encode queue instance from it.
+    int32_t initEncoder(EncodeConfig* encodeConfig, nvvk::Context* sharedCtx = NULL);
     int32_t loadFrame(EncodeConfig* encodeConfig, uint32_t frameCount, uint32_t currentFrameBufferIdx);
+    // Fills dst with the staging-buffer-ready content of one input frame:
+    // the raw planar frame on the GPU conversion path, the CPU-converted
+    // NV12 layout otherwise. Stateless per frame, so the look-ahead workers
+    // run it concurrently (see NvLookAheadQueue).
+    int32_t prepareInputFrame(EncodeConfig* encodeConfig, uint32_t frameCount, uint8_t* dst,
+                              size_t& preparedSize);
     int32_t encodeFrame(EncodeConfig* encodeConfig, uint32_t frameCount, bool nonVcl, uint32_t currentFrameBufferIdx);
-    int32_t assembleBitstreamData(EncodeConfig* encodeConfig, bool nonVcl, uint32_t currentFrameBufferIdx);
+    // Reads back the encode results of one slot and writes its bitstream.
+    // With waitForResults == false the slot is only polled: returns 1 without
+    // blocking when the results are not available yet, 0 once assembled.
+    int32_t assembleBitstreamData(EncodeConfig* encodeConfig, bool nonVcl, uint32_t currentFrameBufferIdx,
+                                  bool waitForResults = true);
     int32_t batchSubmit(uint32_t firstFrameBufferIdx, uint32_t framesInBatch);
     int32_t deinitEncoder();
 
+    // Average GPU time per encoded frame in milliseconds, accumulated from
+    // the per-slot timestamp queries in benchmark mode.
+    double getAverageGpuTimeMs() const
+    {
+        return (m_gpuTimeFrameCount > 0) ? (m_totalGpuTimeNs / (1e6 * m_gpuTimeFrameCount)) : 0.0;
+    }
+
     int32_t initRateControl(VkCommandBuffer cmdBuf, uint32_t qp);
-    int32_t selectNvidiaGPU(std::vector<uint32_t> compatibleDevices, nvvk::ContextCreateInfo ctxInfo, uint32_t deviceID);
+    static int32_t selectNvidiaGPU(nvvk::Context& ctx, std::vector<uint32_t> compatibleDevices, nvvk::ContextCreateInfo ctxInfo, uint32_t deviceID);
     VkResult getVideoFormats(VkPhysicalDevice physicalDevice, VkVideoCoreProfile* pVideoProfile, VkImageUsageFlags imageUsage, uint32_t& formatCount, VkFormat* formats);
     VkResult getVideoCapabilities(VkPhysicalDevice physicalDevice, VkVideoCoreProfile* pVideoProfile, VkVideoCapabilitiesKHR* pVideoEncodeCapabilities);
     VkVideoComponentBitDepthFlagBitsKHR getComponentBitDepthFlagBits(uint32_t bpp);
@@ -198,7 +275,13 @@ public:
 
 
 private:
-    nvvk::Context m_ctx;
+    // Refreshes m_vclQueryResults for every submitted frame slot with a
+    // single vkGetQueryPoolResults call. Returns 0 on success, -1 on error.
+    int32_t pollVclQueryResults();
+
+private:
+    nvvk::Context* m_pCtx;
+    bool m_ownsCtx; // the context is deleted in deinitEncoder unless it is shared
     nvvk::CommandPool m_cmdPoolVideoEncode;
     VkVideoCoreProfile m_videoProfile;
     NvVideoSession* m_pVideoSession;
@@ -211,5 +294,25 @@ private:
     nvvk::DedicatedMemoryAllocator m_devAlloc;
     nvvk::ResourceAllocatorDedicated m_resAlloc;
     NvPictureBuffer m_pictureBuffer;
+    NvGpuFrameConverter m_gpuFrameConverter;
+    VkQueryPool m_gpuTimeQueryPool; // two timestamps per frame slot, benchmark mode only
+    float m_timestampPeriod;
+    double m_totalGpuTimeNs;
+    uint32_t m_gpuTimeFrameCount;
+    NvAsyncBitstreamWriter m_bitstreamWriter;
+    // Bounded input look-ahead (--lookAhead): prefetcher threads prepare the
+    // upcoming frames into pooled host buffers, turning loadFrame into a
+    // single staging-buffer copy. m_lookAheadFrameSize is the prepared byte
+    // count of one frame for the active input path.
+    NvLookAheadQueue m_lookAheadQueue;
+    size_t m_lookAheadFrameSize;
+    // Batched VCL query result cache: one vkGetQueryPoolResults call in
+    // pollVclQueryResults covers all slots in [0, m_vclQueryBatchSize) at
+    // once, and assembleBitstreamData consumes the cached entries instead of
+    // polling and fetching each slot's query separately. A consumed entry
+    // has its availability word cleared so a recycled slot is re-polled.
+    nvVideoEncodeStatus m_vclQueryResults[INPUT_FRAME_BUFFER_SIZE];
+    uint32_t m_vclQueryBatchSize; // highest slot index submitted so far + 1
     nvvk::Context::Queue m_queue;
+    nvvk::Context::Queue m_queueCompute;
 };
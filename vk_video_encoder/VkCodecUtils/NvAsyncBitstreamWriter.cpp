@@ -0,0 +1,103 @@
+/*
+ * Copyright 2022 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NvAsyncBitstreamWriter.h"
+
+#include <assert.h>
+#include <string.h>
+
+void NvAsyncBitstreamWriter::init(FILE* outputFile, uint32_t numPooledBuffers)
+{
+    assert(outputFile != NULL);
+    assert(numPooledBuffers > 0);
+    assert(!isEnabled());
+
+    m_outputFile = outputFile;
+    m_exitWriterThread = false;
+    m_bufferPool.resize(numPooledBuffers);
+    m_writerThread = std::thread(&NvAsyncBitstreamWriter::writerThreadProc, this);
+}
+
+void NvAsyncBitstreamWriter::write(const void* data, size_t size)
+{
+    assert(isEnabled());
+
+    if (size == 0) {
+        return;
+    }
+
+    std::vector<uint8_t> chunk;
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_bufferFreeCond.wait(lock, [this] { return !m_bufferPool.empty(); });
+        chunk = std::move(m_bufferPool.back());
+        m_bufferPool.pop_back();
+    }
+
+    chunk.resize(size);
+    memcpy(chunk.data(), data, size);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pendingChunks.push_back(std::move(chunk));
+    }
+    m_chunkQueuedCond.notify_one();
+}
+
+void NvAsyncBitstreamWriter::writerThreadProc()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+
+        m_chunkQueuedCond.wait(lock, [this] {
+            return !m_pendingChunks.empty() || m_exitWriterThread;
+        });
+
+        if (m_pendingChunks.empty()) {
+            assert(m_exitWriterThread);
+            break;
+        }
+
+        std::vector<uint8_t> chunk(std::move(m_pendingChunks.front()));
+        m_pendingChunks.pop_front();
+
+        lock.unlock();
+        fwrite(chunk.data(), 1, chunk.size(), m_outputFile);
+        lock.lock();
+
+        // Return the buffer (with its grown capacity) to the pool.
+        m_bufferPool.push_back(std::move(chunk));
+        m_bufferFreeCond.notify_one();
+    }
+}
+
+void NvAsyncBitstreamWriter::deinit()
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exitWriterThread = true;
+    }
+    m_chunkQueuedCond.notify_one();
+    m_writerThread.join();
+
+    assert(m_pendingChunks.empty());
+    m_bufferPool.clear();
+    m_outputFile = NULL;
+}
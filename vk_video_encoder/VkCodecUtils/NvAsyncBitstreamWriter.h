@@ -0,0 +1,71 @@
+/*
+ * Copyright 2022 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _NVASYNCBITSTREAMWRITER_H_
+#define _NVASYNCBITSTREAMWRITER_H_
+
+#include <stdio.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Hands the encoded bitstream chunks to a dedicated writer thread through a
+// pooled buffer queue, so the file write latency never stalls the encode
+// loop. The producer only blocks when all pooled buffers are queued for
+// writing (i.e. the disk cannot keep up with the encoder).
+class NvAsyncBitstreamWriter {
+public:
+    NvAsyncBitstreamWriter()
+        : m_outputFile()
+        , m_exitWriterThread(false)
+        , m_writerThread()
+    {
+    }
+
+    ~NvAsyncBitstreamWriter()
+    {
+        deinit();
+    }
+
+    // Starts the writer thread with numPooledBuffers reusable chunk buffers.
+    void init(FILE* outputFile, uint32_t numPooledBuffers);
+
+    bool isEnabled() const { return m_writerThread.joinable(); }
+
+    // Copies the chunk into a pooled buffer and queues it for writing.
+    // Blocks only while the buffer pool is exhausted.
+    void write(const void* data, size_t size);
+
+    // Flushes all pending chunks and stops the writer thread.
+    void deinit();
+
+private:
+    void writerThreadProc();
+
+    FILE*                              m_outputFile;
+    std::mutex                         m_mutex;
+    std::condition_variable            m_chunkQueuedCond;   // signaled to the writer thread
+    std::condition_variable            m_bufferFreeCond;    // signaled back to the producer
+    std::deque<std::vector<uint8_t>>   m_pendingChunks;
+    std::vector<std::vector<uint8_t>>  m_bufferPool;
+    bool                               m_exitWriterThread;
+    std::thread                        m_writerThread;
+};
+
+#endif
@@ -0,0 +1,292 @@
+/*
+ * Copyright 2022 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NvGpuFrameConverter.h"
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "nvh/fileoperations.hpp"
+
+VkResult NvGpuFrameConverter::init(nvvk::Context* ctx, const nvvk::Context::Queue& computeQueue,
+                                   uint32_t numFrames, uint32_t width, uint32_t height)
+{
+    m_pCtx = ctx;
+    m_computeQueue = computeQueue;
+    m_width = width;
+    m_height = height;
+
+    const std::vector<std::string> searchPaths = { ".", "shaders", "vk_video_encoder" };
+    std::string shaderCode = nvh::loadFile("convert_yuv_to_nv12.comp.spv", true, searchPaths);
+    if (shaderCode.empty() || (shaderCode.size() % sizeof(uint32_t)) != 0) {
+        fprintf(stderr, "\nWarning: could not load convert_yuv_to_nv12.comp.spv - GPU conversion disabled\n");
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    VkShaderModuleCreateInfo shaderModuleCreateInfo = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    shaderModuleCreateInfo.codeSize = shaderCode.size();
+    shaderModuleCreateInfo.pCode = (const uint32_t*)shaderCode.data();
+    VkResult result = vkCreateShaderModule(m_pCtx->m_device, &shaderModuleCreateInfo, NULL, &m_shaderModule);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkDescriptorSetLayoutBinding bindings[3] = {};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[2].binding = 2;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[2].descriptorCount = 1;
+    bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutCreateInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    descriptorSetLayoutCreateInfo.bindingCount = 3;
+    descriptorSetLayoutCreateInfo.pBindings = bindings;
+    result = vkCreateDescriptorSetLayout(m_pCtx->m_device, &descriptorSetLayoutCreateInfo, NULL, &m_descriptorSetLayout);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkDescriptorPoolSize poolSizes[2] = {};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = numFrames;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = numFrames * 2;
+
+    VkDescriptorPoolCreateInfo descriptorPoolCreateInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    descriptorPoolCreateInfo.maxSets = numFrames;
+    descriptorPoolCreateInfo.poolSizeCount = 2;
+    descriptorPoolCreateInfo.pPoolSizes = poolSizes;
+    result = vkCreateDescriptorPool(m_pCtx->m_device, &descriptorPoolCreateInfo, NULL, &m_descriptorPool);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PushConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    pipelineLayoutCreateInfo.setLayoutCount = 1;
+    pipelineLayoutCreateInfo.pSetLayouts = &m_descriptorSetLayout;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+    result = vkCreatePipelineLayout(m_pCtx->m_device, &pipelineLayoutCreateInfo, NULL, &m_pipelineLayout);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkComputePipelineCreateInfo computePipelineCreateInfo = {VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+    computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computePipelineCreateInfo.stage.module = m_shaderModule;
+    computePipelineCreateInfo.stage.pName = "main";
+    computePipelineCreateInfo.layout = m_pipelineLayout;
+    result = vkCreateComputePipelines(m_pCtx->m_device, VK_NULL_HANDLE, 1, &computePipelineCreateInfo, NULL, &m_pipeline);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    m_cmdPoolCompute.init(m_pCtx->m_device, m_computeQueue.familyIndex,
+                          VK_COMMAND_POOL_CREATE_TRANSIENT_BIT, m_computeQueue.queue);
+    m_frameResources.resize(numFrames);
+
+    return VK_SUCCESS;
+}
+
+VkResult NvGpuFrameConverter::createPlaneStorageView(VkImage image, VkImageAspectFlagBits planeAspect,
+                                                     VkFormat planeFormat, VkImageView& imageView)
+{
+    VkImageViewCreateInfo imageViewCreateInfo = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    imageViewCreateInfo.image = image;
+    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCreateInfo.format = planeFormat;
+    imageViewCreateInfo.subresourceRange.aspectMask = planeAspect;
+    imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+    imageViewCreateInfo.subresourceRange.levelCount = 1;
+    imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+    imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+    return vkCreateImageView(m_pCtx->m_device, &imageViewCreateInfo, NULL, &imageView);
+}
+
+VkResult NvGpuFrameConverter::registerFrameImage(uint32_t index, VkBuffer stagingBuffer,
+                                                 VkDeviceSize stagingOffset, VkDeviceSize stagingRange,
+                                                 VkImage image, VkImageLayout imageLayout)
+{
+    assert(isEnabled());
+    assert(index < m_frameResources.size());
+    FrameResources& frame = m_frameResources[index];
+    frame.m_image = image;
+    frame.m_stagingBuffer = stagingBuffer;
+
+    // The per-plane storage views require VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT |
+    // VK_IMAGE_CREATE_EXTENDED_USAGE_BIT and VK_IMAGE_USAGE_STORAGE_BIT on the
+    // input image - see initFramePool.
+    VkResult result = createPlaneStorageView(image, VK_IMAGE_ASPECT_PLANE_0_BIT, VK_FORMAT_R8_UNORM,
+                                             frame.m_lumaStorageView);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+    result = createPlaneStorageView(image, VK_IMAGE_ASPECT_PLANE_1_BIT, VK_FORMAT_R8G8_UNORM,
+                                    frame.m_chromaStorageView);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    VkDescriptorSetAllocateInfo descriptorSetAllocateInfo = {VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    descriptorSetAllocateInfo.descriptorPool = m_descriptorPool;
+    descriptorSetAllocateInfo.descriptorSetCount = 1;
+    descriptorSetAllocateInfo.pSetLayouts = &m_descriptorSetLayout;
+    result = vkAllocateDescriptorSets(m_pCtx->m_device, &descriptorSetAllocateInfo, &frame.m_descriptorSet);
+    if (result != VK_SUCCESS) {
+        return result;
+    }
+
+    // The slots share one upload ring buffer; the descriptor's offset and
+    // range restrict the binding to this slot's segment.
+    VkDescriptorBufferInfo bufferInfo = { stagingBuffer, stagingOffset, stagingRange };
+    VkDescriptorImageInfo lumaInfo = { VK_NULL_HANDLE, frame.m_lumaStorageView, VK_IMAGE_LAYOUT_GENERAL };
+    VkDescriptorImageInfo chromaInfo = { VK_NULL_HANDLE, frame.m_chromaStorageView, VK_IMAGE_LAYOUT_GENERAL };
+
+    VkWriteDescriptorSet writes[3] = {};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = frame.m_descriptorSet;
+    writes[0].dstBinding = 0;
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[0].pBufferInfo = &bufferInfo;
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].dstSet = frame.m_descriptorSet;
+    writes[1].dstBinding = 1;
+    writes[1].descriptorCount = 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[1].pImageInfo = &lumaInfo;
+    writes[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[2].dstSet = frame.m_descriptorSet;
+    writes[2].dstBinding = 2;
+    writes[2].descriptorCount = 1;
+    writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[2].pImageInfo = &chromaInfo;
+    vkUpdateDescriptorSets(m_pCtx->m_device, 3, writes, 0, NULL);
+
+    // The conversion of a slot is identical each frame (same buffer, same image),
+    // so record its command buffer once and resubmit it.
+    frame.m_cmdBufConvert = m_cmdPoolCompute.createCommandBuffer(VK_COMMAND_BUFFER_LEVEL_PRIMARY, false);
+
+    VkCommandBufferBeginInfo beginInfo = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    vkBeginCommandBuffer(frame.m_cmdBufConvert, &beginInfo);
+
+    VkImageSubresourceRange range = {};
+    range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    range.baseMipLevel = 0;
+    range.levelCount = 1;
+    range.baseArrayLayer = 0;
+    range.layerCount = 1;
+
+    nvvk::cmdBarrierImageLayout(frame.m_cmdBufConvert, image, imageLayout,
+                                VK_IMAGE_LAYOUT_GENERAL, range);
+
+    vkCmdBindPipeline(frame.m_cmdBufConvert, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(frame.m_cmdBufConvert, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout,
+                            0, 1, &frame.m_descriptorSet, 0, NULL);
+
+    // The staging buffer holds the raw frame straight from the input file:
+    // tightly packed Y, Cb, Cr planes at the full frame resolution.
+    PushConstants pushConstants = {};
+    pushConstants.width = m_width;
+    pushConstants.height = m_height;
+    pushConstants.srcLumaStride = m_width;
+    pushConstants.srcChromaStride = (m_width + 1) / 2;
+    pushConstants.cbPlaneOffset = m_width * m_height;
+    pushConstants.crPlaneOffset = pushConstants.cbPlaneOffset +
+                                  (pushConstants.srcChromaStride * ((m_height + 1) / 2));
+    vkCmdPushConstants(frame.m_cmdBufConvert, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(pushConstants), &pushConstants);
+
+    const uint32_t chromaWidth = (m_width + 1) / 2;
+    const uint32_t chromaHeight = (m_height + 1) / 2;
+    vkCmdDispatch(frame.m_cmdBufConvert, (chromaWidth + 15) / 16, (chromaHeight + 15) / 16, 1);
+
+    nvvk::cmdBarrierImageLayout(frame.m_cmdBufConvert, image, VK_IMAGE_LAYOUT_GENERAL,
+                                imageLayout, range);
+
+    return vkEndCommandBuffer(frame.m_cmdBufConvert);
+}
+
+VkResult NvGpuFrameConverter::submitConvert(uint32_t index, VkSemaphore signalSemaphore)
+{
+    assert(isEnabled());
+    assert(index < m_frameResources.size());
+    FrameResources& frame = m_frameResources[index];
+    assert(frame.m_cmdBufConvert != VK_NULL_HANDLE);
+
+    VkSubmitInfo submitInfo = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frame.m_cmdBufConvert;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &signalSemaphore;
+
+    return vkQueueSubmit(m_computeQueue.queue, 1, &submitInfo, VK_NULL_HANDLE);
+}
+
+void NvGpuFrameConverter::deinit()
+{
+    if (m_pCtx == NULL) {
+        return;
+    }
+
+    for (size_t i = 0; i < m_frameResources.size(); i++) {
+        FrameResources& frame = m_frameResources[i];
+        if (frame.m_lumaStorageView != VK_NULL_HANDLE) {
+            vkDestroyImageView(m_pCtx->m_device, frame.m_lumaStorageView, NULL);
+        }
+        if (frame.m_chromaStorageView != VK_NULL_HANDLE) {
+            vkDestroyImageView(m_pCtx->m_device, frame.m_chromaStorageView, NULL);
+        }
+        frame = FrameResources();
+    }
+    m_frameResources.clear();
+
+    if (m_pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_pCtx->m_device, m_pipeline, NULL);
+        m_pipeline = VK_NULL_HANDLE;
+    }
+    if (m_pipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(m_pCtx->m_device, m_pipelineLayout, NULL);
+        m_pipelineLayout = VK_NULL_HANDLE;
+    }
+    if (m_descriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(m_pCtx->m_device, m_descriptorPool, NULL);
+        m_descriptorPool = VK_NULL_HANDLE;
+    }
+    if (m_descriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(m_pCtx->m_device, m_descriptorSetLayout, NULL);
+        m_descriptorSetLayout = VK_NULL_HANDLE;
+    }
+    if (m_shaderModule != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(m_pCtx->m_device, m_shaderModule, NULL);
+        m_shaderModule = VK_NULL_HANDLE;
+    }
+    m_cmdPoolCompute.deinit();
+}
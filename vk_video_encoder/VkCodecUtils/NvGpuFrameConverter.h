@@ -0,0 +1,122 @@
+/*
+ * Copyright 2022 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _NVGPUFRAMECONVERTER_H_
+#define _NVGPUFRAMECONVERTER_H_
+
+#define VK_ENABLE_BETA_EXTENSIONS 1
+#include "vulkan/vulkan.hpp"
+
+#include <vector>
+
+#include "nvvk/context_vk.hpp"
+#include "nvvk/commands_vk.hpp"
+
+// GPU input conversion stage for the encoder: the raw planar YUV planes are
+// uploaded to the input staging buffer unconverted and a compute shader
+// interleaves them directly into the multi-planar encoder input image on the
+// compute queue, so the CPU plane conversion disappears from the encode loop.
+//
+// The input images must be created with VK_IMAGE_USAGE_STORAGE_BIT,
+// VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT and VK_IMAGE_CREATE_EXTENDED_USAGE_BIT
+// (for the per-plane storage views) and shared with the compute queue family.
+class NvGpuFrameConverter {
+public:
+    NvGpuFrameConverter()
+        : m_pCtx()
+        , m_computeQueue()
+        , m_cmdPoolCompute()
+        , m_width(0)
+        , m_height(0)
+        , m_descriptorSetLayout()
+        , m_descriptorPool()
+        , m_pipelineLayout()
+        , m_shaderModule()
+        , m_pipeline()
+        , m_frameResources()
+    {
+    }
+
+    // Creates the compute pipeline from the compiled converter shader.
+    // Fails (so the caller falls back to the CPU conversion path) when the
+    // shader binary can not be found next to the executable.
+    VkResult init(nvvk::Context* ctx, const nvvk::Context::Queue& computeQueue,
+                  uint32_t numFrames, uint32_t width, uint32_t height);
+
+    bool isEnabled() const { return m_pipeline != VK_NULL_HANDLE; }
+
+    // Creates the per-plane storage views and the descriptor set of one input
+    // frame slot and records its conversion command buffer. stagingOffset
+    // and stagingRange select the slot's segment of the shared upload ring
+    // (see NvPictureBuffer::getInputStagingSlotOffset()).
+    VkResult registerFrameImage(uint32_t index, VkBuffer stagingBuffer,
+                                VkDeviceSize stagingOffset, VkDeviceSize stagingRange,
+                                VkImage image, VkImageLayout imageLayout);
+
+    // Submits the recorded conversion of the frame slot on the compute queue.
+    // The submit signals signalSemaphore, which the encode batch submission
+    // must wait on before reading the input image.
+    VkResult submitConvert(uint32_t index, VkSemaphore signalSemaphore);
+
+    void deinit();
+
+private:
+    // Must match the push_constant block in convert_yuv_to_nv12.comp.glsl.
+    struct PushConstants {
+        uint32_t width;
+        uint32_t height;
+        uint32_t srcLumaStride;
+        uint32_t srcChromaStride;
+        uint32_t cbPlaneOffset;
+        uint32_t crPlaneOffset;
+    };
+
+    struct FrameResources {
+        FrameResources()
+            : m_image()
+            , m_stagingBuffer()
+            , m_lumaStorageView()
+            , m_chromaStorageView()
+            , m_descriptorSet()
+            , m_cmdBufConvert()
+        {
+        }
+
+        VkImage         m_image;
+        VkBuffer        m_stagingBuffer;
+        VkImageView     m_lumaStorageView;
+        VkImageView     m_chromaStorageView;
+        VkDescriptorSet m_descriptorSet; // lifetime owned by m_descriptorPool
+        VkCommandBuffer m_cmdBufConvert;
+    };
+
+    VkResult createPlaneStorageView(VkImage image, VkImageAspectFlagBits planeAspect,
+                                    VkFormat planeFormat, VkImageView& imageView);
+
+    nvvk::Context*              m_pCtx;
+    nvvk::Context::Queue        m_computeQueue;
+    nvvk::CommandPool           m_cmdPoolCompute;
+    uint32_t                    m_width;
+    uint32_t                    m_height;
+    VkDescriptorSetLayout       m_descriptorSetLayout;
+    VkDescriptorPool            m_descriptorPool;
+    VkPipelineLayout            m_pipelineLayout;
+    VkShaderModule              m_shaderModule;
+    VkPipeline                  m_pipeline;
+    std::vector<FrameResources> m_frameResources;
+};
+
+#endif
@@ -0,0 +1,153 @@
+/*
+ * Copyright 2022 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "NvLookAheadQueue.h"
+
+#include <assert.h>
+
+void NvLookAheadQueue::init(uint32_t depth, uint32_t numWorkers, size_t entrySize,
+                            uint32_t firstFrame, uint32_t numFrames,
+                            PrepareFrameFunc prepareFrame)
+{
+    assert(depth > 0);
+    assert(numWorkers > 0);
+    assert(entrySize > 0);
+    assert(!isEnabled());
+
+    m_entries.resize(depth);
+    for (uint32_t i = 0; i < depth; i++) {
+        m_entries[i].data.resize(entrySize);
+        m_entries[i].frameIndex = 0;
+        m_entries[i].preparing = false;
+        m_entries[i].ready = false;
+        m_entries[i].acquired = false;
+    }
+
+    m_prepareFrame = prepareFrame;
+    m_nextFrameToPrepare = firstFrame;
+    m_endFrame = firstFrame + numFrames;
+    m_exitWorkers = false;
+
+    for (uint32_t i = 0; i < numWorkers; i++) {
+        m_workers.emplace_back(&NvLookAheadQueue::workerThreadProc, this);
+    }
+}
+
+void NvLookAheadQueue::workerThreadProc()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+
+        // The frames are prepared strictly in order, each into the ring
+        // entry its index maps to, so a frame can only be claimed once the
+        // entry of its depth-older predecessor has been released.
+        m_entryFreeCond.wait(lock, [this] {
+            if (m_exitWorkers || (m_nextFrameToPrepare >= m_endFrame)) {
+                return true;
+            }
+            const Entry& entry = m_entries[m_nextFrameToPrepare % m_entries.size()];
+            return !entry.preparing && !entry.ready && !entry.acquired;
+        });
+
+        if (m_exitWorkers || (m_nextFrameToPrepare >= m_endFrame)) {
+            break;
+        }
+
+        const uint32_t frameIndex = m_nextFrameToPrepare++;
+        Entry& entry = m_entries[frameIndex % m_entries.size()];
+        entry.frameIndex = frameIndex;
+        entry.preparing = true;
+
+        lock.unlock();
+        m_prepareFrame(frameIndex, entry.data.data());
+        lock.lock();
+
+        entry.preparing = false;
+        entry.ready = true;
+        m_entryReadyCond.notify_all();
+        // Another worker may have been waiting for the ring slot of the next
+        // frame index.
+        m_entryFreeCond.notify_one();
+    }
+}
+
+const uint8_t* NvLookAheadQueue::acquireFrame(uint32_t frameIndex)
+{
+    assert(isEnabled());
+    assert(frameIndex < m_endFrame);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Entry& entry = m_entries[frameIndex % m_entries.size()];
+    m_entryReadyCond.wait(lock, [&entry, frameIndex] {
+        return entry.ready && (entry.frameIndex == frameIndex);
+    });
+    entry.acquired = true;
+    return entry.data.data();
+}
+
+void NvLookAheadQueue::releaseFrame(uint32_t frameIndex)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Entry& entry = m_entries[frameIndex % m_entries.size()];
+        assert(entry.acquired && (entry.frameIndex == frameIndex));
+        entry.acquired = false;
+        entry.ready = false;
+    }
+    m_entryFreeCond.notify_one();
+}
+
+const uint8_t* NvLookAheadQueue::peekPreparedFrame(uint32_t frameIndex) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Entry& entry = m_entries[frameIndex % m_entries.size()];
+    if (entry.ready && (entry.frameIndex == frameIndex)) {
+        return entry.data.data();
+    }
+    return NULL;
+}
+
+uint32_t NvLookAheadQueue::getPreparedAheadCount(uint32_t currentFrameIndex) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t preparedAhead = 0;
+    for (size_t i = 0; i < m_entries.size(); i++) {
+        if (m_entries[i].ready && !m_entries[i].acquired &&
+                (m_entries[i].frameIndex >= currentFrameIndex)) {
+            preparedAhead++;
+        }
+    }
+    return preparedAhead;
+}
+
+void NvLookAheadQueue::deinit()
+{
+    if (!isEnabled()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_exitWorkers = true;
+    }
+    m_entryFreeCond.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+    m_entries.clear();
+    m_prepareFrame = PrepareFrameFunc();
+}
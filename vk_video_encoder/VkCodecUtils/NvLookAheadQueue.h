@@ -0,0 +1,112 @@
+/*
+ * Copyright 2022 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _NVLOOKAHEADQUEUE_H_
+#define _NVLOOKAHEADQUEUE_H_
+
+#include <stdint.h>
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Bounded look-ahead input queue (--lookAhead <depth>): worker threads
+// prefetch and pre-convert the upcoming input frames into a ring of pooled
+// host buffers while the GPU encodes the current one, so the encode loop's
+// frame upload shrinks to a single staging-buffer copy instead of the file
+// read plus plane conversion it used to be. The window of prepared frames is
+// also readable in place (see peekPreparedFrame()), so future rate-control
+// logic can estimate the complexity of upcoming frames before they are
+// encoded. The workers only block while every ring entry holds a prepared
+// but not yet consumed frame (i.e. the encoder cannot keep up with them).
+class NvLookAheadQueue {
+public:
+    // Fills dst (entrySize bytes) with the prepared content of frameIndex.
+    // Returns 0 on success; a failed entry is still handed out, so the
+    // consumer sees the error where the inline load used to report it.
+    typedef std::function<int32_t(uint32_t frameIndex, uint8_t* dst)> PrepareFrameFunc;
+
+    NvLookAheadQueue()
+        : m_entries()
+        , m_workers()
+        , m_prepareFrame()
+        , m_nextFrameToPrepare(0)
+        , m_endFrame(0)
+        , m_exitWorkers(false)
+    {
+    }
+
+    ~NvLookAheadQueue()
+    {
+        deinit();
+    }
+
+    // Starts numWorkers prefetcher threads over a ring of depth entries of
+    // entrySize bytes each, preparing frames [firstFrame, firstFrame +
+    // numFrames) in order.
+    void init(uint32_t depth, uint32_t numWorkers, size_t entrySize,
+              uint32_t firstFrame, uint32_t numFrames, PrepareFrameFunc prepareFrame);
+
+    bool isEnabled() const { return !m_workers.empty(); }
+
+    // Blocks until frameIndex is prepared and returns its buffer. The entry
+    // stays owned by the caller until releaseFrame(). The frames must be
+    // acquired in the order given to init().
+    const uint8_t* acquireFrame(uint32_t frameIndex);
+
+    // Returns the entry of frameIndex to the prefetchers.
+    void releaseFrame(uint32_t frameIndex);
+
+    // Read-only view of a prepared (and not yet released) frame, NULL when
+    // frameIndex is not resident in the ring. Rate-control logic can sample
+    // the upcoming frames through this without disturbing the prefetchers.
+    const uint8_t* peekPreparedFrame(uint32_t frameIndex) const;
+
+    // Prepared, not yet acquired frames ahead of currentFrameIndex - the
+    // look-ahead window rate control has available right now.
+    uint32_t getPreparedAheadCount(uint32_t currentFrameIndex) const;
+
+    // Stops and joins the prefetcher threads and drops the ring buffers.
+    void deinit();
+
+private:
+    // One ring entry; all fields are protected by m_mutex except data's
+    // contents, which only the preparing worker (until ready) or the
+    // acquiring consumer (until released) touches.
+    struct Entry {
+        std::vector<uint8_t> data;
+        uint32_t frameIndex;
+        bool preparing; // a worker is converting into data
+        bool ready;     // data holds the prepared frameIndex
+        bool acquired;  // handed to the consumer, not yet released
+    };
+
+    void workerThreadProc();
+
+    mutable std::mutex       m_mutex;
+    std::condition_variable  m_entryFreeCond;  // signaled to the workers
+    std::condition_variable  m_entryReadyCond; // signaled to the consumer
+    std::vector<Entry>       m_entries;
+    std::vector<std::thread> m_workers;
+    PrepareFrameFunc         m_prepareFrame;
+    uint32_t                 m_nextFrameToPrepare;
+    uint32_t                 m_endFrame;
+    bool                     m_exitWorkers;
+};
+
+#endif
@@ -17,6 +17,35 @@
 #include "NvPictureBuffer.h"
 #include "nvidia_utils/vulkan/ycbcrvkinfo.h"
 
+// Readback buffers prefer host-cached memory: the CPU copies out of the
+// encoded bitstream run several times faster than over an uncached
+// coherent mapping. A cached non-coherent type needs an explicit
+// vkInvalidateMappedMemoryRanges before each readback, so the selected
+// flags are kept around for the readback path to check.
+static VkMemoryPropertyFlags selectHostReadbackMemoryProps(VkPhysicalDevice physicalDevice)
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    const VkMemoryPropertyFlags preferenceChain[] = {
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT |
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    };
+
+    for (size_t chainIdx = 0; chainIdx < (sizeof(preferenceChain) / sizeof(preferenceChain[0])); chainIdx++) {
+        for (uint32_t typeIdx = 0; typeIdx < memoryProperties.memoryTypeCount; typeIdx++) {
+            if ((memoryProperties.memoryTypes[typeIdx].propertyFlags & preferenceChain[chainIdx]) ==
+                    preferenceChain[chainIdx]) {
+                return preferenceChain[chainIdx];
+            }
+        }
+    }
+
+    return VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+}
+
 VkResult NvPictureBuffer::createVideoQueries(uint32_t numSlots, nvvk::Context* deviceInfo, const VkVideoProfileInfoKHR* pEncodeProfile)
 {
     VkQueryPoolCreateInfo queryPoolCreateInfo = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
@@ -42,16 +71,54 @@ void NvPictureBuffer::initImageLayout(VkCommandBuffer cmdBuf, Picture* picture,
     picture->m_imageLayout = layout;
 }
 
-void NvPictureBuffer::initReferenceFramePool(uint32_t                   numImages,
-        VkFormat                   imageFormat,
-        nvvk::ResourceAllocator*   rAlloc)
+NvEncoderPicturePool& NvEncoderPicturePool::GetInstance()
+{
+    static NvEncoderPicturePool picturePool;
+    return picturePool;
+}
+
+bool NvEncoderPicturePool::matchesSession(VkDevice device, const VkVideoCoreProfile& videoProfile,
+                                          VkFormat imageFormat, const VkExtent2D& extent,
+                                          uint32_t queueFamilyIndex) const
+{
+    return m_poolAllocActive &&
+           (device == m_device) &&
+           (imageFormat == m_imageFormat) &&
+           (extent.width == m_extent.width) &&
+           (extent.height == m_extent.height) &&
+           (queueFamilyIndex == m_queueFamilyIndex) &&
+           (videoProfile == m_videoProfile);
+}
+
+uint32_t NvEncoderPicturePool::acquireImages(VkDevice device, VkPhysicalDevice physicalDevice,
+                                             const VkVideoCoreProfile& videoProfile,
+                                             VkFormat imageFormat,
+                                             const VkExtent2D& extent,
+                                             uint32_t queueFamilyIndex,
+                                             uint32_t numImages,
+                                             Picture* pictures)
 {
+    if (!matchesSession(device, videoProfile, imageFormat, extent, queueFamilyIndex)) {
+        // A different session shape invalidates everything parked so far.
+        clear();
+    }
+
+    if (!m_poolAllocActive) {
+        m_poolAlloc.init(device, physicalDevice);
+        m_poolAllocActive = true;
+        m_device = device;
+        m_videoProfile = videoProfile;
+        m_imageFormat = imageFormat;
+        m_extent = extent;
+        m_queueFamilyIndex = queueFamilyIndex;
+    }
+
     VkImageCreateInfo tmpImgCreateInfo;
 
     tmpImgCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     tmpImgCreateInfo.pNext = m_videoProfile.GetProfile();
     tmpImgCreateInfo.imageType = VK_IMAGE_TYPE_2D;
-    tmpImgCreateInfo.format = imageFormat;
+    tmpImgCreateInfo.format = m_imageFormat;
     tmpImgCreateInfo.extent = { m_extent.width, m_extent.height, 1 };
     tmpImgCreateInfo.mipLevels = 1;
     tmpImgCreateInfo.arrayLayers = 1;
@@ -64,18 +131,68 @@ void NvPictureBuffer::initReferenceFramePool(uint32_t                   numImage
     tmpImgCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     tmpImgCreateInfo.flags = 0;
 
-    m_dpbSize = numImages;
-
-    for(uint32_t i = 0; i < numImages; i++) {
-        nvvk::Image currentRefImage = rAlloc->createImage(tmpImgCreateInfo);
+    uint32_t recycledCount = 0;
+    for (uint32_t i = 0; i < numImages; i++) {
+        if (!m_parkedPictures.empty()) {
+            // Recycled pictures keep the layout they were parked with, so
+            // a follow-up prepareReferenceImages() transitions them from
+            // their true current layout.
+            pictures[i] = m_parkedPictures.back();
+            m_parkedPictures.pop_back();
+            recycledCount++;
+            continue;
+        }
+        nvvk::Image currentRefImage = m_poolAlloc.createImage(tmpImgCreateInfo);
         assert(currentRefImage.image != VK_NULL_HANDLE);
-        VkImageViewCreateInfo currentRefImageViewCreateInfo = nvvk::makeImage2DViewCreateInfo(currentRefImage.image, imageFormat);
-        nvvk::Texture currentRefImageView = rAlloc->createTexture(currentRefImage, currentRefImageViewCreateInfo);
+        VkImageViewCreateInfo currentRefImageViewCreateInfo = nvvk::makeImage2DViewCreateInfo(currentRefImage.image, m_imageFormat);
+        nvvk::Texture currentRefImageView = m_poolAlloc.createTexture(currentRefImage, currentRefImageViewCreateInfo);
         assert(currentRefImageView.descriptor.imageView != VK_NULL_HANDLE);
-        Picture refPic(currentRefImage, currentRefImageView, tmpImgCreateInfo.initialLayout);
-        m_dpb[i] = refPic;
+        pictures[i] = Picture(currentRefImage, currentRefImageView, tmpImgCreateInfo.initialLayout);
+    }
+
+    return recycledCount;
+}
+
+void NvEncoderPicturePool::recycleImages(Picture* pictures, uint32_t numImages)
+{
+    for (uint32_t ndx = 0; ndx < numImages; ndx++) {
+        m_parkedPictures.push_back(pictures[ndx]);
+    }
+}
+
+void NvEncoderPicturePool::clear()
+{
+    for (size_t ndx = 0; ndx < m_parkedPictures.size(); ndx++) {
+        m_poolAlloc.destroy(m_parkedPictures[ndx].m_imageView);
+
+        // Destroying the Texture also frees the Image.
+    }
+    m_parkedPictures.clear();
+
+    if (m_poolAllocActive) {
+        m_poolAlloc.deinit();
+        m_poolAllocActive = false;
     }
+    m_device = VK_NULL_HANDLE;
+}
+
+void NvPictureBuffer::initReferenceFramePool(uint32_t                   numImages,
+        VkFormat                   imageFormat)
+{
+    m_dpbSize = numImages;
 
+    // The DPB images come from the process-wide recycling pool:
+    // back-to-back sessions with the same profile, format and extent adopt
+    // the previous session's images instead of re-paying the dedicated
+    // allocations (see NvEncoderPicturePool).
+    NvEncoderPicturePool::GetInstance().acquireImages(m_pCtx->m_device,
+                                                      m_pCtx->m_physicalDevice,
+                                                      m_videoProfile,
+                                                      imageFormat,
+                                                      m_extent,
+                                                      m_queueFamilyIndex,
+                                                      numImages,
+                                                      m_dpb);
 }
 
 void NvPictureBuffer::prepareReferenceImages(VkCommandBuffer cmdBuf)
@@ -107,7 +224,9 @@ int32_t NvPictureBuffer::initFramePool( nvvk::Context* ctx,
                                         VkImageUsageFlags        usage,
                                         nvvk::ResourceAllocatorDedicated* rAlloc,
                                         nvvk::CommandPool*       cmdPoolVideoEncode,
-                                        uint32_t                 queueFamilyIndex)
+                                        uint32_t                 queueFamilyIndex,
+                                        VkImageCreateFlags       imageCreateFlags,
+                                        int32_t                  computeQueueFamilyIndex)
 {
     m_pCtx = ctx;
     if (m_queryPool != VK_NULL_HANDLE) {
@@ -136,11 +255,20 @@ int32_t NvPictureBuffer::initFramePool( nvvk::Context* ctx,
     m_imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     m_imageCreateInfo.tiling = tiling;
     m_imageCreateInfo.usage = usage;
-    m_imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    m_imageCreateInfo.queueFamilyIndexCount = 1;
-    m_imageCreateInfo.pQueueFamilyIndices = &m_queueFamilyIndex;
+    if ((computeQueueFamilyIndex >= 0) && ((uint32_t)computeQueueFamilyIndex != queueFamilyIndex)) {
+        // The GPU conversion stage writes the input images on the compute queue.
+        m_queueFamilyIndices[0] = queueFamilyIndex;
+        m_queueFamilyIndices[1] = (uint32_t)computeQueueFamilyIndex;
+        m_imageCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        m_imageCreateInfo.queueFamilyIndexCount = 2;
+        m_imageCreateInfo.pQueueFamilyIndices = m_queueFamilyIndices;
+    } else {
+        m_imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        m_imageCreateInfo.queueFamilyIndexCount = 1;
+        m_imageCreateInfo.pQueueFamilyIndices = &m_queueFamilyIndex;
+    }
     m_imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    m_imageCreateInfo.flags = 0;
+    m_imageCreateInfo.flags = imageCreateFlags;
 
     m_maxBitstreamSize = ((maxImageWidth > 3840) ? 8 : 4) * 1024 * 1024 /* 4MB or 8MB each for 8k use case */;
 
@@ -201,6 +329,43 @@ size_t NvPictureBuffer::size()
     return m_frameBufferSize;
 }
 
+VkResult NvPictureBuffer::invalidateOutBitstreamSlotMappedData(uint32_t index)
+{
+    if ((m_outBitstreamMemoryProps & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0) {
+        return VK_SUCCESS;
+    }
+
+    // Host-cached non-coherent memory type: a single invalidate of the
+    // slot's segment makes the encoded data visible through the persistent
+    // mapping. m_maxBitstreamSize keeps the range nonCoherentAtomSize
+    // aligned within the allocation.
+    nvvk::MemAllocator::MemInfo memInfo =
+            m_resAlloc->getMemoryAllocator()->getMemoryInfo(m_outBitstreamBuffer.memHandle);
+    VkMappedMemoryRange invalidateRange = { VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
+    invalidateRange.memory = memInfo.memory;
+    invalidateRange.offset = memInfo.offset + getOutBitstreamSlotOffset(index);
+    invalidateRange.size   = m_maxBitstreamSize;
+    return vkInvalidateMappedMemoryRanges(m_pCtx->m_device, 1, &invalidateRange);
+}
+
+VkResult NvPictureBuffer::flushInputStagingSlotMappedData(uint32_t index)
+{
+    if ((m_inputStagingMemoryProps & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0) {
+        return VK_SUCCESS;
+    }
+
+    // Non-coherent memory type: a single flush of the slot's segment makes
+    // the host writes visible to the device. m_inputStagingSlotSize keeps
+    // the range nonCoherentAtomSize aligned within the allocation.
+    nvvk::MemAllocator::MemInfo memInfo =
+            m_resAlloc->getMemoryAllocator()->getMemoryInfo(m_inputStagingBuffer.memHandle);
+    VkMappedMemoryRange flushRange = { VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
+    flushRange.memory = memInfo.memory;
+    flushRange.offset = memInfo.offset + getInputStagingSlotOffset(index);
+    flushRange.size   = m_inputStagingSlotSize;
+    return vkFlushMappedMemoryRanges(m_pCtx->m_device, 1, &flushRange);
+}
+
 void NvPictureBuffer::deinitFramePool()
 {
     if (m_queryPool != VK_NULL_HANDLE) {
@@ -211,16 +376,34 @@ void NvPictureBuffer::deinitFramePool()
     for (uint32_t ndx = 0; ndx < m_frameBufferSize; ndx++) {
         m_encodeFrameData[ndx].deinitFramePool(m_resAlloc);
     }
+
+    if (m_outBitstreamMappedData != nullptr) {
+        m_resAlloc->unmap(m_outBitstreamBuffer);
+        m_outBitstreamMappedData = nullptr;
+    }
+    if (m_outBitstreamBuffer.buffer != VK_NULL_HANDLE) {
+        m_resAlloc->destroy(m_outBitstreamBuffer);
+    }
+
+    if (m_inputStagingMappedData != nullptr) {
+        m_resAlloc->unmap(m_inputStagingBuffer);
+        m_inputStagingMappedData = nullptr;
+    }
+    if (m_inputStagingBuffer.buffer != VK_NULL_HANDLE) {
+        m_resAlloc->destroy(m_inputStagingBuffer);
+    }
+
     m_frameBufferSize = 0;
 }
 
 void NvPictureBuffer::deinitReferenceFramePool()
 {
+    // Park the images for the next session of the same shape instead of
+    // destroying them; an incompatible follow-up session flushes them from
+    // the pool (see NvEncoderPicturePool).
+    NvEncoderPicturePool::GetInstance().recycleImages(m_dpb, (uint32_t)m_dpbSize);
     for (uint32_t ndx = 0; ndx < m_dpbSize; ndx++) {
-        m_resAlloc->destroy(m_dpb[ndx].m_imageView);
-
-        // Destroying the Texture also frees the Image.
-        m_dpb[ndx].m_image = nvvk::Image();
+        m_dpb[ndx] = Picture();
     }
     m_dpbSize = 0;
 }
@@ -251,10 +434,6 @@ void EncodeFrameData::deinitFramePool(nvvk::ResourceAllocatorDedicated* rAlloc)
         m_frameProducerDoneSemaphore = VK_NULL_HANDLE;
     }
 
-    rAlloc->destroy(m_inputStagingBuffer);
-
-    rAlloc->destroy(m_outBitstreamBuffer);
-
     rAlloc->destroy(m_picture.m_imageView);
 
     // Destroying the Texture also frees the Image.
@@ -322,6 +501,36 @@ uint32_t NvPictureBuffer::initFrame(uint32_t numImages,
     VkSemaphoreCreateInfo semInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
 
     m_resAlloc = rAlloc;
+    m_outBitstreamMemoryProps = selectHostReadbackMemoryProps(m_pCtx->m_physicalDevice);
+
+    // One shared readback buffer segmented per frame slot instead of one
+    // small buffer per slot. A single allocation is mapped persistently
+    // here, so the per-frame readback neither maps nor unmaps, and one
+    // invalidate range covers any slot.
+    VkBufferCreateInfo outBitstreamCreateInfo = nvvk::makeBufferCreateInfo((VkDeviceSize)numImages * m_maxBitstreamSize,
+                                                                           VK_BUFFER_USAGE_VIDEO_ENCODE_DST_BIT_KHR);
+    m_outBitstreamBuffer = rAlloc->createBuffer(outBitstreamCreateInfo, m_outBitstreamMemoryProps);
+    m_outBitstreamMappedData = reinterpret_cast<int8_t*>(rAlloc->map(m_outBitstreamBuffer));
+
+    // The input staging memory is the same scheme on the upload side: one
+    // shared ring segmented per frame slot, mapped persistently here. The
+    // staging memory is only ever written by the host - uncached
+    // write-combined coherent memory is the right type for uploads. The slot
+    // stride pads m_fullImageSize so every slot offset is valid as a copy
+    // source, a storage buffer binding (the GPU conversion reads the slot as
+    // a storage buffer - see NvGpuFrameConverter) and a flush range.
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(m_pCtx->m_physicalDevice, &deviceProperties);
+    const VkDeviceSize slotAlignment = std::max({ deviceProperties.limits.nonCoherentAtomSize,
+                                                  deviceProperties.limits.minStorageBufferOffsetAlignment,
+                                                  deviceProperties.limits.optimalBufferCopyOffsetAlignment });
+    m_inputStagingSlotSize = ((m_fullImageSize + slotAlignment - 1) / slotAlignment) * slotAlignment;
+    m_inputStagingMemoryProps = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkBufferCreateInfo inputStagingCreateInfo = nvvk::makeBufferCreateInfo((VkDeviceSize)numImages * m_inputStagingSlotSize,
+                                                                           VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    m_inputStagingBuffer = rAlloc->createBuffer(inputStagingCreateInfo, m_inputStagingMemoryProps);
+    m_inputStagingMappedData = reinterpret_cast<uint8_t*>(rAlloc->map(m_inputStagingBuffer));
 
     for (uint8_t imageIndex = 0; imageIndex < numImages; imageIndex++) {
         m_encodeFrameData[imageIndex].m_device = dev;
@@ -342,12 +551,6 @@ uint32_t NvPictureBuffer::initFrame(uint32_t numImages,
         result = vkCreateSemaphore(dev, &semInfo, nullptr, &m_encodeFrameData[imageIndex].m_frameProducerDoneSemaphore);
         assert(result == VK_SUCCESS);
 
-        VkBufferCreateInfo outBitstreamCreateInfo = nvvk::makeBufferCreateInfo(m_maxBitstreamSize, VK_BUFFER_USAGE_VIDEO_ENCODE_DST_BIT_KHR);
-        m_encodeFrameData[imageIndex].m_outBitstreamBuffer = rAlloc->createBuffer(outBitstreamCreateInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT); //FLAGS - map buffer to host
-
-        VkBufferCreateInfo stagingBufferCreateInfo = nvvk::makeBufferCreateInfo(m_fullImageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
-        m_encodeFrameData[imageIndex].m_inputStagingBuffer = rAlloc->createBuffer(stagingBufferCreateInfo, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-
         m_encodeFrameData[imageIndex].m_cmdBufVideoEncode = cmdPoolVideoEncode->createCommandBuffer();
     }
 
@@ -360,7 +563,10 @@ VkResult NvPictureBuffer::copyToVkImage(uint32_t index, uint32_t bufferOffset, V
     Picture* picture = &currentEncodeFrameData->m_picture;
 
     VkImage inputImage = picture->m_image.image;
-    VkBuffer inputStaging = currentEncodeFrameData->m_inputStagingBuffer.buffer;
+    VkBuffer inputStaging = m_inputStagingBuffer.buffer;
+    // bufferOffset is relative to the slot's segment of the shared upload
+    // ring.
+    VkDeviceSize planeBufferOffset = getInputStagingSlotOffset(index) + bufferOffset;
 
     uint32_t width = m_imageCreateInfo.extent.width;
     uint32_t height = m_imageCreateInfo.extent.height;
@@ -402,7 +608,7 @@ VkResult NvPictureBuffer::copyToVkImage(uint32_t index, uint32_t bufferOffset, V
             h = height;
         }
 
-        region.bufferOffset = bufferOffset;
+        region.bufferOffset = planeBufferOffset;
         region.bufferRowLength =  w;
         region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_PLANE_0_BIT << plane;
         region.imageExtent.width = w;
@@ -410,7 +616,7 @@ VkResult NvPictureBuffer::copyToVkImage(uint32_t index, uint32_t bufferOffset, V
 
         copyRegions.push_back(region);
 
-        bufferOffset += w * h; // w * h is the size of the plane
+        planeBufferOffset += w * h; // w * h is the size of the plane
     }
 
     if (picture->m_imageLayout != VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
@@ -60,6 +60,65 @@ public:
 private:
 
 };
+
+// Process-wide recycling pool for the reconstructed/reference (DPB) images.
+// In the per-job model the encoder is torn down and recreated for every
+// input, re-paying the dedicated image allocations each time. Sessions park
+// their DPB images here on teardown and the next session of identical
+// profile, format, extent and queue family adopts them instead of
+// reallocating; a session with a different shape flushes the parked images.
+// The pool owns its own resource allocator, so the parked images safely
+// outlive the per-session allocators destroyed in EncodeApp::deinitEncoder().
+class NvEncoderPicturePool {
+public:
+    static NvEncoderPicturePool& GetInstance();
+
+    // Fills pictures[0..numImages), adopting parked images while they last
+    // and creating the rest from the pool allocator. Returns the number of
+    // images that were recycled.
+    uint32_t acquireImages(VkDevice device, VkPhysicalDevice physicalDevice,
+                           const VkVideoCoreProfile& videoProfile,
+                           VkFormat imageFormat,
+                           const VkExtent2D& extent,
+                           uint32_t queueFamilyIndex,
+                           uint32_t numImages,
+                           Picture* pictures);
+
+    // Takes back numImages pictures previously handed out by
+    // acquireImages(). The caller must be done submitting work against them.
+    void recycleImages(Picture* pictures, uint32_t numImages);
+
+    // Frees every parked image and the pool allocator. Must be called while
+    // the device the images were created against is still alive.
+    void clear();
+
+private:
+    NvEncoderPicturePool()
+        : m_device()
+        , m_videoProfile()
+        , m_imageFormat()
+        , m_extent { 0, 0 }
+        , m_queueFamilyIndex((uint32_t)-1)
+        , m_poolAlloc()
+        , m_poolAllocActive(false)
+        , m_parkedPictures()
+    {
+    }
+
+    bool matchesSession(VkDevice device, const VkVideoCoreProfile& videoProfile,
+                        VkFormat imageFormat, const VkExtent2D& extent,
+                        uint32_t queueFamilyIndex) const;
+
+    VkDevice                          m_device;
+    VkVideoCoreProfile                m_videoProfile;
+    VkFormat                          m_imageFormat;
+    VkExtent2D                        m_extent;
+    uint32_t                          m_queueFamilyIndex;
+    nvvk::ResourceAllocatorDedicated  m_poolAlloc;
+    bool                              m_poolAllocActive;
+    std::vector<Picture>              m_parkedPictures;
+};
+
 class ReferenceFrameData {
 public:
     ReferenceFrameData()
@@ -91,6 +150,7 @@ public:
         , m_extent { 0, 0 }
         , m_cmdBufVideoEncode()
         , m_frameSubmitted(false)
+        , m_gpuConvertPending(false)
     {
     }
 
@@ -109,10 +169,9 @@ public:
     uint32_t m_queueFamilyIndex;
     VkVideoCoreProfile m_videoProfile;
     VkExtent2D m_extent;
-    nvvk::Buffer m_outBitstreamBuffer;
-    nvvk::Buffer m_inputStagingBuffer;
     VkCommandBuffer m_cmdBufVideoEncode;
     uint32_t m_frameSubmitted:1;
+    uint32_t m_gpuConvertPending:1; // GPU conversion submitted; encode must wait on m_frameProducerDoneSemaphore
 };
 
 class NvPictureBuffer {
@@ -120,6 +179,7 @@ public:
     NvPictureBuffer()
         : m_pCtx()
         , m_queueFamilyIndex((uint32_t)-1)
+        , m_queueFamilyIndices{ (uint32_t)-1, (uint32_t)-1 }
         , m_videoProfile()
         , m_imageCreateInfo()
         , m_encodeFrameData()
@@ -131,6 +191,15 @@ public:
         , m_fullImageSize(0)
         , m_maxBitstreamSize(0)
         , m_imageFormat()
+        , m_outBitstreamBuffer()
+        , m_outBitstreamMappedData()
+        , m_outBitstreamMemoryProps(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+        , m_inputStagingBuffer()
+        , m_inputStagingMappedData()
+        , m_inputStagingSlotSize(0)
+        , m_inputStagingMemoryProps(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
     {
     }
     VkResult createVideoQueries(uint32_t numSlots, nvvk::Context* deviceInfo, const VkVideoProfileInfoKHR* pEncodeProfile);
@@ -146,12 +215,13 @@ public:
                            VkImageUsageFlags        usage,
                            nvvk::ResourceAllocatorDedicated* rAlloc,
                            nvvk::CommandPool*        cmdPoolVideoEncode,
-                           uint32_t                 queueFamilyIndex);
+                           uint32_t                 queueFamilyIndex,
+                           VkImageCreateFlags       imageCreateFlags = 0,
+                           int32_t                  computeQueueFamilyIndex = -1);
     void prepareInputImages(VkCommandBuffer cmdBuf);
 
     void initReferenceFramePool( uint32_t                   numImages,
-                                 VkFormat                   imageFormat,
-                                 nvvk::ResourceAllocator*   rAlloc);
+                                 VkFormat                   imageFormat);
     void prepareReferenceImages(VkCommandBuffer cmdBuf);
 
     void getFrameResourcesByIndex( int8_t referenceSlotIndexes,
@@ -176,6 +246,39 @@ public:
     EncodeFrameData* getEncodeFrameData(uint32_t index);
     VkQueryPool getQueryPool();
     size_t size();
+    // The memory property flags the output bitstream buffer was actually
+    // allocated with. When HOST_COHERENT is not among them, the readback
+    // path must invalidate the mapped range before reading.
+    VkMemoryPropertyFlags getOutBitstreamMemoryProps() const { return m_outBitstreamMemoryProps; }
+
+    // The output bitstream is one shared readback buffer segmented per frame
+    // slot: slot index idx owns the m_maxBitstreamSize bytes starting at
+    // getOutBitstreamSlotOffset(idx). The buffer stays persistently mapped
+    // for the lifetime of the frame pool, so the readback path never has to
+    // map and unmap per assembled frame.
+    VkBuffer getOutBitstreamBuffer() const { return m_outBitstreamBuffer.buffer; }
+    VkDeviceSize getOutBitstreamSlotOffset(uint32_t index) const { return (VkDeviceSize)index * m_maxBitstreamSize; }
+    int8_t* getOutBitstreamSlotMappedData(uint32_t index) { return m_outBitstreamMappedData + ((size_t)index * m_maxBitstreamSize); }
+    // Makes one slot's encoded data visible through the persistent mapping.
+    // A no-op when the buffer lives in host-coherent memory.
+    VkResult invalidateOutBitstreamSlotMappedData(uint32_t index);
+
+    // The input staging memory mirrors the output bitstream buffer: one
+    // shared upload ring segmented per frame slot, where slot index idx owns
+    // the getInputStagingSlotSize() bytes starting at
+    // getInputStagingSlotOffset(idx). The ring stays persistently mapped for
+    // the lifetime of the frame pool, so the per-frame upload neither maps
+    // nor unmaps and the host writes stream through write combining
+    // uninterrupted.
+    VkBuffer getInputStagingBuffer() const { return m_inputStagingBuffer.buffer; }
+    // m_fullImageSize padded so every slot offset is valid as a copy source,
+    // a storage buffer binding and a flush range (see initFrame()).
+    VkDeviceSize getInputStagingSlotSize() const { return m_inputStagingSlotSize; }
+    VkDeviceSize getInputStagingSlotOffset(uint32_t index) const { return (VkDeviceSize)index * m_inputStagingSlotSize; }
+    uint8_t* getInputStagingSlotMappedData(uint32_t index) { return m_inputStagingMappedData + ((size_t)index * m_inputStagingSlotSize); }
+    // Makes one slot's host writes visible to the device with an explicit
+    // flush range. A no-op when the ring lives in host-coherent memory.
+    VkResult flushInputStagingSlotMappedData(uint32_t index);
 
     void deinitReferenceFramePool();
     void deinitFramePool();
@@ -190,6 +293,7 @@ private:
 private:
     nvvk::Context*                      m_pCtx;
     uint32_t                            m_queueFamilyIndex;
+    uint32_t                            m_queueFamilyIndices[2]; // encode + compute, when shared concurrently
     VkVideoCoreProfile                  m_videoProfile;
     VkImageCreateInfo                   m_imageCreateInfo;
     size_t                              m_frameBufferSize;
@@ -202,6 +306,13 @@ private:
     VkExtent2D                          m_extent;
     uint32_t                            m_fullImageSize;
     VkFormat                            m_imageFormat;
+    nvvk::Buffer                        m_outBitstreamBuffer; // shared by all slots, persistently mapped
+    int8_t*                             m_outBitstreamMappedData;
+    VkMemoryPropertyFlags               m_outBitstreamMemoryProps;
+    nvvk::Buffer                        m_inputStagingBuffer; // shared by all slots, persistently mapped
+    uint8_t*                            m_inputStagingMappedData;
+    VkDeviceSize                        m_inputStagingSlotSize;
+    VkMemoryPropertyFlags               m_inputStagingMemoryProps;
 };
 
 #endif
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2022 NVIDIA Corporation.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#version 450
+
+// Converts the raw planar 8-bit YUV 4:2:0 frame in the input staging buffer
+// into the two planes of the semi-planar (NV12) encoder input image. One
+// invocation converts a 2x2 luma block and the corresponding Cb/Cr pair, so
+// the dispatch is sized to the chroma resolution.
+
+layout(local_size_x = 16, local_size_y = 16) in;
+
+layout(push_constant) uniform PushConstants {
+    uint width;           // luma width in pixels
+    uint height;          // luma height in pixels
+    uint srcLumaStride;   // in bytes
+    uint srcChromaStride; // in bytes
+    uint cbPlaneOffset;   // byte offset of the Cb plane in the buffer
+    uint crPlaneOffset;   // byte offset of the Cr plane in the buffer
+};
+
+layout(set = 0, binding = 0, std430) readonly buffer SrcPlanes { uint srcData[]; };
+layout(set = 0, binding = 1, r8) uniform writeonly image2D dstLuma;
+layout(set = 0, binding = 2, rg8) uniform writeonly image2D dstChroma;
+
+float fetchByte(uint byteOffset)
+{
+    uint word = srcData[byteOffset >> 2];
+    return float((word >> ((byteOffset & 3u) * 8u)) & 0xFFu) / 255.0;
+}
+
+void main()
+{
+    uvec2 chromaPos = gl_GlobalInvocationID.xy;
+    uvec2 lumaPos = chromaPos * 2u;
+    if ((lumaPos.x >= width) || (lumaPos.y >= height)) {
+        return;
+    }
+
+    for (uint y = 0u; y < 2u; y++) {
+        for (uint x = 0u; x < 2u; x++) {
+            uvec2 pos = lumaPos + uvec2(x, y);
+            if ((pos.x < width) && (pos.y < height)) {
+                imageStore(dstLuma, ivec2(pos), vec4(fetchByte((pos.y * srcLumaStride) + pos.x)));
+            }
+        }
+    }
+
+    uint chromaIndex = (chromaPos.y * srcChromaStride) + chromaPos.x;
+    imageStore(dstChroma, ivec2(chromaPos),
+               vec4(fetchByte(cbPlaneOffset + chromaIndex),
+                    fetchByte(crPlaneOffset + chromaIndex), 0.0, 0.0));
+}
@@ -14,6 +14,10 @@
  * limitations under the License.
  */
 
+#include <chrono>
+#include <memory>
+#include <vector>
+
 #include "NvEncodeApp.h"
 
 int8_t parseArguments(EncodeConfig *encodeConfig, int argc, char *argv[])
@@ -70,16 +74,57 @@ int8_t parseArguments(EncodeConfig *encodeConfig, int argc, char *argv[])
             }
             providedQP = true;
         }
+        else if (strcmp(argv[i], "--slicesPerFrame") == 0) {
+            if (++i >= argc || sscanf(argv[i], "%u", &encodeConfig->slicesPerFrame) != 1) {
+                fprintf(stderr, "invalid parameter for %s\n", argv[i - 1]);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--lookAhead") == 0) {
+            if (++i >= argc || sscanf(argv[i], "%u", &encodeConfig->lookAheadDepth) != 1) {
+                fprintf(stderr, "invalid parameter for %s\n", argv[i - 1]);
+                return -1;
+            }
+        }
         else if (strcmp(argv[i], "--logBatchEncoding") == 0) {
             encodeConfig->logBatchEncoding = true;
         }
+        else if (strcmp(argv[i], "--gpuConvert") == 0) {
+            encodeConfig->enableGpuConversion = true;
+        }
+        else if (strcmp(argv[i], "--asyncOutput") == 0) {
+            encodeConfig->enableAsyncOutput = true;
+        }
+        else if (strcmp(argv[i], "--numSessions") == 0) {
+            if (++i >= argc || sscanf(argv[i], "%u", &encodeConfig->numSessions) != 1) {
+                fprintf(stderr, "invalid parameter for %s\n", argv[i - 1]);
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--benchmarkSweep") == 0) {
+            if (++i >= argc || sscanf(argv[i], "%u", &encodeConfig->benchmarkSweepMaxSessions) != 1) {
+                fprintf(stderr, "invalid parameter for %s\n", argv[i - 1]);
+                return -1;
+            }
+            encodeConfig->benchmark = true;
+        }
+        else if (strcmp(argv[i], "--benchmarkReport") == 0) {
+            if (++i >= argc) {
+                fprintf(stderr, "invalid parameter for %s\n", argv[i - 1]);
+                return -1;
+            }
+            strcpy(encodeConfig->benchmarkReportFileName, argv[i]);
+        }
+        else if (strcmp(argv[i], "--benchmark") == 0) {
+            encodeConfig->benchmark = true;
+        }
         else {
             fprintf(stderr, "Unrecognized option: %s\n", argv[i]);
             return -1;
         }
     }
 
-    if (!providedInputFileName) {
+    if (!providedInputFileName && !encodeConfig->benchmark) {
         fprintf(stderr, "The input file was not specified\n");
         return -1;
     }
@@ -130,7 +175,15 @@ void printHelp()
     --width                         <integer> : Encode Width \n\
     --height                        <integer> : Encode Height \n\
     -qp                             <integer> : QP value in the range [0, 51] \n\
-    --logBatchEncoding              Enable verbose logging of batch recording and submission of commands \n"
+    --slicesPerFrame                <integer> : Number of NALU slices per coded frame (split on MB-row boundaries) \n\
+    --lookAhead                     <integer> : Depth of the bounded input look-ahead queue (frames prefetched and pre-converted on worker threads) \n\
+    --logBatchEncoding              Enable verbose logging of batch recording and submission of commands \n\
+    --gpuConvert                    Convert the input planes to NV12 with a compute shader instead of the CPU \n\
+    --asyncOutput                   Write the output bitstream from a dedicated writer thread \n\
+    --numSessions                   <integer> : Number of concurrent encode sessions sharing one device \n\
+    --benchmark                     Encode a pre-generated synthetic frame ring (no input file) and report the encode throughput \n\
+    --benchmarkSweep                <integer> : Repeat the benchmark for every session count K in [1, N] and emit a scaling report \n\
+    --benchmarkReport               .csv Scaling report file name (default: print the report to stdout) \n"
     );
 }
 
@@ -143,22 +196,21 @@ int32_t handle_error(const std::error_code& error)
 
 int32_t openFiles(EncodeConfig *encodeConfig)
 {
-    encodeConfig->inputVid = fopen(encodeConfig->inFileName, "rb");
-    if (!encodeConfig->inputVid) {
-        fprintf(stderr, "Failed to open input file %s",encodeConfig->inFileName);
-        return -1;
-    }
+    // The input file is only read through the memory mapping below - all the
+    // per-frame plane accesses go straight into the mapped region. Benchmark
+    // mode has no input file: the frames are generated at init time.
+    if (!encodeConfig->benchmark) {
+        std::error_code error;
+        encodeConfig->inputVideoMmap.map(encodeConfig->inFileName,
+                                         0, mio::map_entire_file, error);
+        if (error) {
+            return handle_error(error);
+            return -1;
+        }
 
-    std::error_code error;
-    encodeConfig->inputVideoMmap.map(encodeConfig->inFileName,
-                                     0, mio::map_entire_file, error);
-    if (error) {
-        return handle_error(error);
-        return -1;
+        printf("Input file size is: %zd\n", encodeConfig->inputVideoMmap.length());
     }
 
-    printf("Input file size is: %zd\n", encodeConfig->inputVideoMmap.length());
-
     encodeConfig->outputVid = fopen(encodeConfig->outFileName, "wb");
     if (!encodeConfig->outputVid) {
         fprintf(stderr, "Failed to open output file %s",encodeConfig->outFileName);
@@ -170,11 +222,6 @@ int32_t openFiles(EncodeConfig *encodeConfig)
 
 int8_t closeFiles(EncodeConfig *encodeConfig)
 {
-    if(fclose(encodeConfig->inputVid)) {
-        fprintf(stderr, "Failed to close input file %s",encodeConfig->inFileName);
-        return -1;
-    }
-
     encodeConfig->inputVideoMmap.unmap();
 
     if(fclose(encodeConfig->outputVid)) {
@@ -186,6 +233,160 @@ int8_t closeFiles(EncodeConfig *encodeConfig)
     return 0;
 }
 
+// One independent encode session: its own config (input mapping and output
+// file), frame pools and encode queue, optionally on a device shared with
+// the other sessions.
+struct EncodeSession {
+    EncodeApp app;
+    EncodeConfig config;
+    uint32_t oldestPendingFrame = 0; // frames [oldestPendingFrame, curFrameIndex) are in flight
+};
+
+// Gives each session its own output file: "out.264" -> "out_1.264".
+static void appendSessionSuffix(char* fileName, uint32_t sessionIndex)
+{
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%u", sessionIndex);
+    char* ext = strrchr(fileName, '.');
+    if (ext != NULL) {
+        memmove(ext + strlen(suffix), ext, strlen(ext) + 1);
+        memcpy(ext, suffix, strlen(suffix));
+    } else {
+        strcat(fileName, suffix);
+    }
+}
+
+// Runs one complete multi-session encode: session setup, the pipelined
+// encode loop, the drain and the teardown. On success elapsedSeconds holds
+// the wall time of the encode loop (first upload to last bitstream readback)
+// and perSessionGpuTimeMs each session's average GPU encode time.
+static int32_t runEncodeSessions(EncodeConfig* encodeConfig, uint32_t numSessions,
+                                 int argc, char** argv,
+                                 double* elapsedSeconds,
+                                 std::vector<double>* perSessionGpuTimeMs)
+{
+    // With multiple sessions the instance and device are created once and
+    // shared, with one encode queue instance requested per session.
+    nvvk::Context* sharedCtx = NULL;
+    if (numSessions > 1) {
+        sharedCtx = EncodeApp::createContext(encodeConfig, numSessions);
+        if (sharedCtx == NULL)
+            return -1;
+    }
+
+    std::vector<std::unique_ptr<EncodeSession>> sessions(numSessions);
+    for (uint32_t sessionIdx = 0; sessionIdx < numSessions; sessionIdx++) {
+        sessions[sessionIdx].reset(new EncodeSession());
+        EncodeConfig* sessionConfig = &sessions[sessionIdx]->config;
+        memset(sessionConfig, 0, sizeof(EncodeConfig));
+        // Each session encodes the same stream with the same parameters.
+        if(parseArguments(sessionConfig, argc, argv))
+            return -1;
+        if (numSessions > 1) {
+            appendSessionSuffix(sessionConfig->outFileName, sessionIdx);
+        }
+        if(openFiles(sessionConfig))
+            return -1;
+        if(sessions[sessionIdx]->app.initEncoder(sessionConfig, sharedCtx))
+            return -1;
+    }
+
+    // Pipelined encoding loop: the frame buffer slots form a ring with up to
+    // maxFramesInFlight submitted frames. A slot is only drained (bitstream
+    // readback and file write) right before it is reused, so while frame K
+    // encodes on the GPU, frame K+1 is uploaded and recorded and the bitstream
+    // of frame K+1-maxFramesInFlight is read back, each gated by its own
+    // per-slot fence instead of a global drain point.
+    const bool logBatchEnc = encodeConfig->logBatchEncoding;
+    const uint32_t maxFramesInFlight = INPUT_FRAME_BUFFER_SIZE;
+    const uint32_t totalFrames = encodeConfig->numFrames;
+    if (logBatchEnc) fprintf(stdout, "encodeConfig.startFrame %d, totalFrames  %d, encodeConfig.endFrame  %d\n", encodeConfig->startFrame, totalFrames, encodeConfig->numFrames);
+
+    const auto encodeStartTime = std::chrono::steady_clock::now();
+
+    // The sessions are driven round robin, one frame per session per
+    // iteration, so their submissions interleave across the encode queues.
+    for (uint32_t curFrameIndex = 0; curFrameIndex < totalFrames; curFrameIndex++) {
+
+        const uint32_t frameBufferIdx = curFrameIndex % maxFramesInFlight;
+
+        for (uint32_t sessionIdx = 0; sessionIdx < numSessions; sessionIdx++) {
+            EncodeSession* session = sessions[sessionIdx].get();
+
+            // 1. Opportunistically harvest frames whose results are already
+            //    available, polled oldest first (the bitstream must be written
+            //    in frame order) without ever blocking.
+            while (session->oldestPendingFrame < curFrameIndex) {
+                int32_t assembleResult = session->app.assembleBitstreamData(&session->config, (session->oldestPendingFrame == 0),
+                                                                            session->oldestPendingFrame % maxFramesInFlight, false);
+                if (assembleResult != 0) {
+                    break; // not available yet (or error, reported by the drain below)
+                }
+                if (logBatchEnc) fprintf(stdout, "\tSession %d: harvested asmFrameIndex %d, frameBufferIdx %d\n", sessionIdx, session->oldestPendingFrame, session->oldestPendingFrame % maxFramesInFlight);
+                session->oldestPendingFrame++;
+            }
+
+            // 2. Block only when the slot of the current frame is still
+            //    occupied by the frame submitted maxFramesInFlight frames ago.
+            if ((curFrameIndex >= maxFramesInFlight) && (session->oldestPendingFrame <= (curFrameIndex - maxFramesInFlight))) {
+                if (logBatchEnc) fprintf(stdout, "\tSession %d: assemble asmFrameIndex %d, frameBufferIdx %d\n", sessionIdx, session->oldestPendingFrame, frameBufferIdx);
+                session->app.assembleBitstreamData(&session->config, (session->oldestPendingFrame == 0), frameBufferIdx);
+                session->oldestPendingFrame++;
+            }
+
+            // 3. Upload and record the current frame into the now free slot.
+            if (logBatchEnc) fprintf(stdout, "\tSession %d: loadFrame curFrameIndex %d, frameBufferIdx %d\n", sessionIdx, curFrameIndex, frameBufferIdx);
+            session->app.loadFrame(&session->config, curFrameIndex, frameBufferIdx);
+            if (logBatchEnc) fprintf(stdout, "\tSession %d: record frame curFrameIndex %d, frameBufferIdx %d\n", sessionIdx, curFrameIndex, frameBufferIdx);
+            session->app.encodeFrame(&session->config, curFrameIndex, (curFrameIndex == 0), frameBufferIdx);
+
+            // 4. Submit it to the session's encode queue with the slot's own fence.
+            if (logBatchEnc) fprintf(stdout, "\tSession %d: submit to the HW encoder curFrameIndex %d, frameBufferIdx %d\n", sessionIdx, curFrameIndex, frameBufferIdx);
+            session->app.batchSubmit(frameBufferIdx, 1);
+        }
+    }
+
+    // Drain the frames still in flight, in submission order.
+    for (uint32_t sessionIdx = 0; sessionIdx < numSessions; sessionIdx++) {
+        EncodeSession* session = sessions[sessionIdx].get();
+        while (session->oldestPendingFrame < totalFrames) {
+            const uint32_t frameBufferIdx = session->oldestPendingFrame % maxFramesInFlight;
+            if (logBatchEnc) fprintf(stdout, "\tSession %d: drain asmFrameIndex %d, frameBufferIdx %d\n", sessionIdx, session->oldestPendingFrame, frameBufferIdx);
+            session->app.assembleBitstreamData(&session->config, (session->oldestPendingFrame == 0), frameBufferIdx);
+            session->oldestPendingFrame++;
+        }
+    }
+
+    // The measured interval spans from the first upload to the last
+    // bitstream readback; init (frame generation) and deinit are excluded.
+    *elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - encodeStartTime).count();
+    perSessionGpuTimeMs->clear();
+    for (uint32_t sessionIdx = 0; sessionIdx < numSessions; sessionIdx++) {
+        perSessionGpuTimeMs->push_back(sessions[sessionIdx]->app.getAverageGpuTimeMs());
+    }
+
+    if (encodeConfig->benchmark && (totalFrames > 0)) {
+        for (uint32_t sessionIdx = 0; sessionIdx < numSessions; sessionIdx++) {
+            fprintf(stdout, "Session %d: encoded %u frames in %.3f s -> %.2f FPS, average GPU encode time %.3f ms/frame\n",
+                    sessionIdx, totalFrames, *elapsedSeconds, totalFrames / *elapsedSeconds,
+                    (*perSessionGpuTimeMs)[sessionIdx]);
+        }
+    }
+
+    for (uint32_t sessionIdx = 0; sessionIdx < numSessions; sessionIdx++) {
+        sessions[sessionIdx]->app.deinitEncoder();
+        if(closeFiles(&sessions[sessionIdx]->config))
+            return -1;
+    }
+
+    if (sharedCtx != NULL) {
+        sharedCtx->deinit();
+        delete sharedCtx;
+    }
+
+    return 0;
+}
+
 //--------------------------------------------------------------------------------------------------
 // Entry of the example
 //
@@ -203,87 +404,54 @@ int main(int argc, char** argv)
     if(parseArguments(&encodeConfig, argc, argv))
         return -1;
 
-    if(openFiles(&encodeConfig))
-        return -1;
+    double elapsedSeconds = 0.0;
+    std::vector<double> perSessionGpuTimeMs;
 
-    EncodeApp encodeApp;
-    encodeApp.initEncoder(&encodeConfig);
+    if (encodeConfig.benchmarkSweepMaxSessions == 0) {
+        return runEncodeSessions(&encodeConfig, std::max(1u, encodeConfig.numSessions),
+                                 argc, argv, &elapsedSeconds, &perSessionGpuTimeMs);
+    }
 
-    // Encoding loop
-    const bool logBatchEnc = encodeConfig.logBatchEncoding;
-    const uint32_t batchSize = 8;
-    const uint32_t numBatches = 2;
-    assert((batchSize > 0) && !(batchSize & (batchSize - 1)));
-    const uint32_t maxFramesInFlight = INPUT_FRAME_BUFFER_SIZE;
-    assert(batchSize * numBatches <= maxFramesInFlight);
-    uint32_t batchId = 0;
-    uint32_t framesToProcess = encodeConfig.numFrames;
-    if (logBatchEnc) fprintf(stdout, "encodeConfig.startFrame %d, totalFrames  %d, encodeConfig.endFrame  %d\n", encodeConfig.startFrame, framesToProcess, encodeConfig.numFrames);
-    uint32_t firstAsmBufferIdx = 0;
-    uint32_t numAsmBuffers = 0;
-    uint32_t curFrameIndex = 0;
-    uint32_t asmFrameIndex = 0;
-
-    // Encoding loop
-    while (framesToProcess || numAsmBuffers) {
-
-        if (logBatchEnc) fprintf(stdout, "####################################################################################\n");
-        if (logBatchEnc) fprintf(stdout, "Process framesToProcess %d, numAsmBuffers %d\n", framesToProcess, numAsmBuffers);
-
-        // 1. Process the first/next batch of encode frames
-        // #################################################################################################################
-        uint32_t numFramesLoadRecordCmd = std::min((uint32_t)batchSize, framesToProcess);
-        assert(numFramesLoadRecordCmd <= batchSize);
-        uint32_t firstLoadRecordCmdIndx = batchId * batchSize;
-
-        if (logBatchEnc) fprintf(stdout, "### Load and record command buffer for encoder batchId %d, numFramesLoadRecordCmd %d ###\n", batchId, numFramesLoadRecordCmd);
-        for(uint32_t cpuBatchIdx = 0; cpuBatchIdx < numFramesLoadRecordCmd; cpuBatchIdx++) {
-            const uint32_t cpuFrameBufferIdx = firstLoadRecordCmdIndx + cpuBatchIdx;
-            if (logBatchEnc) fprintf(stdout, "\tloadFrame curFrameIndex %d, cpuBatchIdx %d, cpuFrameBufferIdx %d\n", curFrameIndex, cpuBatchIdx, cpuFrameBufferIdx);
-            // load frame data for the current frame index
-            encodeApp.loadFrame(&encodeConfig, curFrameIndex, cpuFrameBufferIdx);
-            if (logBatchEnc) fprintf(stdout, "\tRecord frame curFrameIndex %d, cpuBatchIdx %d, cpuFrameBufferIdx %d\n", curFrameIndex, cpuBatchIdx, cpuFrameBufferIdx);
-            // encode frame for the current frame index
-            encodeApp.encodeFrame(&encodeConfig, curFrameIndex, (curFrameIndex == 0), cpuFrameBufferIdx);
-            curFrameIndex++;
+    // Scaling sweep (--benchmarkSweep N): the whole benchmark is repeated
+    // for every session count K in [1, N] and one report row is emitted per
+    // session per K, so the session count a GPU sustains at the configured
+    // resolution can be read straight off the aggregate FPS column.
+    FILE* report = stdout;
+    if (encodeConfig.benchmarkReportFileName[0] != '\0') {
+        report = fopen(encodeConfig.benchmarkReportFileName, "w");
+        if (report == NULL) {
+            fprintf(stderr, "Failed to open the benchmark report file %s\n",
+                    encodeConfig.benchmarkReportFileName);
+            return -1;
         }
-        // #################################################################################################################
-
-        // 2. Submit the current batch to the encoder's queue
-        // #################################################################################################################
-        if (logBatchEnc) fprintf(stdout, "### Submit to the HW encoder batchId %d, numFramesLoadRecordCmd %d, firstLoadRecordCmdIndx %d ###\n", batchId, numFramesLoadRecordCmd, firstLoadRecordCmdIndx);
-        // submit the current batch
-        encodeApp.batchSubmit(firstLoadRecordCmdIndx, numFramesLoadRecordCmd);
-        // #################################################################################################################
-
-        // 3. Assemble the frame data from the previous batch processing (if any) of the submitted to the HW encoded frames.
-        // #################################################################################################################
-        if (logBatchEnc) fprintf(stdout, "### Assemble firstAsmBufferIdx %d, numAsmBuffers %d ###\n", firstAsmBufferIdx, numAsmBuffers);
-        for(uint32_t asmBufferIdx = firstAsmBufferIdx; asmBufferIdx < firstAsmBufferIdx + numAsmBuffers; asmBufferIdx++) {
-            if (logBatchEnc) fprintf(stdout, "\tAssemble asmFrameIndex %d, asmBatchIdx %d\n", asmFrameIndex, asmBufferIdx);
-            encodeApp.assembleBitstreamData(&encodeConfig, (asmFrameIndex == 0), asmBufferIdx);
-            asmFrameIndex++;
+    }
+    fprintf(report, "numSessions,session,width,height,frames,elapsedSeconds,sessionFps,aggregateFps,avgGpuTimeMs\n");
+
+    for (uint32_t numSessions = 1; numSessions <= encodeConfig.benchmarkSweepMaxSessions; numSessions++) {
+        fprintf(stdout, "Benchmark sweep: running %u concurrent session%s\n",
+                numSessions, (numSessions > 1) ? "s" : "");
+        if (runEncodeSessions(&encodeConfig, numSessions, argc, argv,
+                              &elapsedSeconds, &perSessionGpuTimeMs)) {
+            if (report != stdout) {
+                fclose(report);
+            }
+            return -1;
         }
-        // #################################################################################################################
-
-        // Assemble frames with submitted firstSubmitFrameId and batchSize.
-        firstAsmBufferIdx = firstLoadRecordCmdIndx;
-        numAsmBuffers     = numFramesLoadRecordCmd;
-
-        framesToProcess -= numFramesLoadRecordCmd;
 
-        assert(framesToProcess < encodeConfig.numFrames);
-
-        // increment the current batchID
-        batchId++;
-        batchId %= numBatches;
-        if (logBatchEnc) fprintf(stdout, "####################################################################################\n\n");
+        // Every session encodes the same frame count over the same measured
+        // interval, so the aggregate is numSessions times the session rate.
+        const double sessionFps = (elapsedSeconds > 0.0) ? (encodeConfig.numFrames / elapsedSeconds) : 0.0;
+        for (uint32_t sessionIdx = 0; sessionIdx < numSessions; sessionIdx++) {
+            fprintf(report, "%u,%u,%u,%u,%u,%.6f,%.2f,%.2f,%.3f\n",
+                    numSessions, sessionIdx, encodeConfig.width, encodeConfig.height,
+                    encodeConfig.numFrames, elapsedSeconds, sessionFps,
+                    sessionFps * numSessions, perSessionGpuTimeMs[sessionIdx]);
+        }
     }
 
-    encodeApp.deinitEncoder();
-
-    if(closeFiles(&encodeConfig))
-        return -1;
+    if (report != stdout) {
+        fclose(report);
+    }
 
     return 0;
 }